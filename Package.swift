@@ -59,12 +59,15 @@ let cSources = [
     "src/async/imap/MCIMAPCheckAccountOperation.cpp",
     "src/async/imap/MCIMAPConnectOperation.cpp",
     "src/async/imap/MCIMAPFetchFoldersOperation.cpp",
+    "src/async/imap/MCIMAPFetchFoldersWithStatusOperation.cpp",
     "src/async/imap/MCIMAPCustomCommandOperation.cpp",
     "src/async/imap/MCIMAPRenameFolderOperation.cpp",
     "src/async/imap/MCIMAPDeleteFolderOperation.cpp",
     "src/async/imap/MCIMAPCreateFolderOperation.cpp",
     "src/async/imap/MCIMAPSubscribeFolderOperation.cpp",
     "src/async/imap/MCIMAPAppendMessageOperation.cpp",
+    "src/async/imap/MCIMAPAppendMessagesOperation.cpp",
+    "src/async/imap/MCIMAPSyncFolderMirrorOperation.cpp",
     "src/async/imap/MCIMAPCopyMessagesOperation.cpp",
     "src/async/imap/MCIMAPMoveMessagesOperation.cpp",
     "src/async/imap/MCIMAPExpungeOperation.cpp",
@@ -75,6 +78,9 @@ let cSources = [
     "src/async/imap/MCIMAPStoreFlagsOperation.cpp",
     "src/async/imap/MCIMAPStoreLabelsOperation.cpp",
     "src/async/imap/MCIMAPSearchOperation.cpp",
+    "src/async/imap/MCIMAPThreadOperation.cpp",
+    "src/async/imap/MCIMAPSortOperation.cpp",
+    "src/async/imap/MCIMAPFolderWatcher.cpp",
     "src/async/imap/MCIMAPIdleOperation.cpp",
     "src/async/imap/MCIMAPFetchNamespaceOperation.cpp",
     "src/async/imap/MCIMAPIdentityOperation.cpp",
@@ -82,6 +88,7 @@ let cSources = [
     "src/async/imap/MCIMAPFolderInfo.cpp",
     "src/async/imap/MCIMAPCapabilityOperation.cpp",
     "src/async/imap/MCIMAPQuotaOperation.cpp",
+    "src/async/imap/MCIMAPBatchOperation.cpp",
     "src/async/imap/MCIMAPFolderStatusOperation.cpp",
     "src/async/imap/MCIMAPDisconnectOperation.cpp",
     "src/async/imap/MCIMAPMessageRenderingOperation.cpp",
@@ -169,6 +176,10 @@ let cSources = [
     "src/core/basetypes/MCObject.cpp",
     "src/core/basetypes/MCOperation.cpp",
     "src/core/basetypes/MCOperationQueue.cpp",
+    "src/core/basetypes/MCOperationTimingStatistics.cpp",
+    "src/core/basetypes/MCConnectionMetrics.cpp",
+    "src/core/basetypes/MCEventLoop.cpp",
+    "src/core/basetypes/MCOperationTiming.cpp",
     "src/core/basetypes/MCRange.cpp",
     "src/core/basetypes/MCSet.cpp",
     "src/core/basetypes/MCString.cpp",
@@ -184,6 +195,19 @@ let cSources = [
     "src/core/imap/MCIMAPSession.cpp",
     "src/core/imap/MCIMAPSyncResult.cpp",
     "src/core/imap/MCIMAPFolderStatus.cpp",
+    "src/core/imap/MCIMAPAppendItem.cpp",
+    "src/core/imap/MCIMAPSearchResult.cpp",
+    "src/core/imap/MCIMAPNotifyEvent.cpp",
+    "src/core/imap/MCIMAPResponseBuffer.cpp",
+    "src/core/imap/MCIMAPBodyCache.cpp",
+    "src/core/imap/MCIMAPSearchIndex.cpp",
+    "src/core/imap/MCIMAPSearchEvaluator.cpp",
+    "src/core/imap/MCIMAPMessageTable.cpp",
+    "src/core/imap/MCIMAPBodyStructure.cpp",
+    "src/core/imap/MCIMAPThread.cpp",
+    "src/core/imap/MCIMAPSortCriterion.cpp",
+    "src/core/imap/MCIMAPFolderMirror.cpp",
+    "src/core/imap/MCIMAPGmailMirror.cpp",
     "src/core/imap/MCIMAPIdentity.cpp",
     "src/core/pop/MCPOPMessageInfo.cpp",
     "src/core/pop/MCPOPSession.cpp",
@@ -266,6 +290,20 @@ let objCSources = [
     "src/objc/imap/MCOIMAPIdentityOperation.mm",
     "src/objc/imap/MCOIMAPCapabilityOperation.mm",
     "src/objc/imap/MCOIMAPQuotaOperation.mm",
+    "src/objc/imap/MCOIMAPBodyCache.mm",
+    "src/objc/imap/MCOIMAPFolderWatcher.mm",
+    "src/objc/imap/MCOIMAPNotifyEvent.mm",
+    "src/objc/imap/MCOIMAPFetchFoldersWithStatusOperation.mm",
+    "src/objc/imap/MCOIMAPSearchResult.mm",
+    "src/objc/imap/MCOIMAPThread.mm",
+    "src/objc/imap/MCOIMAPThreadOperation.mm",
+    "src/objc/imap/MCOIMAPSortCriterion.mm",
+    "src/objc/imap/MCOIMAPSortOperation.mm",
+    "src/objc/imap/MCOIMAPFolderMirror.mm",
+    "src/objc/imap/MCOIMAPSyncFolderMirrorOperation.mm",
+    "src/objc/imap/MCOIMAPAppendMessagesOperation.mm",
+    "src/objc/imap/MCOIMAPAppendItem.mm",
+    "src/objc/imap/MCOIMAPBatchOperation.mm",
     "src/objc/imap/MCOIMAPSearchExpression.mm",
     "src/objc/imap/MCOIMAPFolderStatus.mm",
     "src/objc/imap/MCOIMAPFolderStatusOperation.mm",
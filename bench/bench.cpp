@@ -0,0 +1,604 @@
+#include <MailCore/MailCore.h>
+#include <arpa/inet.h>
+#include <dirent.h>
+#include <netinet/in.h>
+#include <pthread.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace mailcore;
+
+// Measures the streaming fetch against a buffered fetch from a local stand-in server, and the local
+// structures that don't need a server: the search index, the search evaluator, the message table and
+// the body structure. Each one is compared with the way it's done without it.
+
+static const char * words[] = {
+    "report", "meeting", "lunch", "budget", "invoice", "review", "release", "travel", "holiday", "project",
+    "update", "question", "schedule", "contract", "figures", "draft", "agenda", "notes", "order", "payment",
+};
+static const unsigned int wordsCount = sizeof(words) / sizeof(words[0]);
+
+static uint32_t randomState = 1;
+
+static uint32_t nextRandom(void)
+{
+    randomState = randomState * 1103515245 + 12345;
+    return (randomState >> 16) & 0x7fff;
+}
+
+static double now(void)
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (double) tv.tv_sec + (double) tv.tv_usec / 1000000.;
+}
+
+static void printDuration(const char * name, double start, unsigned int iterations)
+{
+    double duration = now() - start;
+    printf("  %-42s %10.3f ms", name, duration * 1000.);
+    if (iterations > 1) {
+        printf(" (%.3f ms each)", duration * 1000. / iterations);
+    }
+    printf("\n");
+}
+
+static String * randomText(unsigned int wordsInText)
+{
+    String * text = String::string();
+    for(unsigned int i = 0 ; i < wordsInText ; i ++) {
+        if (i > 0) {
+            text->appendUTF8Characters(" ");
+        }
+        text->appendUTF8Characters(words[nextRandom() % wordsCount]);
+    }
+    return text;
+}
+
+static Array * benchMessages(unsigned int count)
+{
+    randomState = 1;
+    time_t date = 978307200;
+    Array * messages = Array::array();
+    for(unsigned int i = 0 ; i < count ; i ++) {
+        IMAPMessage * message = new IMAPMessage();
+        uint32_t uid = i + 1;
+        message->setUid(uid);
+        message->setSize(1000 + nextRandom() % 100000);
+        message->setFlags((nextRandom() % 4) == 0 ? MessageFlagSeen : MessageFlagNone);
+        String * from = String::stringWithUTF8Format("user%u@example.com", nextRandom() % 500);
+        message->header()->setFrom(Address::addressWithMailbox(from));
+        String * to = String::stringWithUTF8Format("user%u@example.com", nextRandom() % 500);
+        message->header()->setTo(Array::arrayWithObject(Address::addressWithMailbox(to)));
+        message->header()->setSubject(randomText(5));
+        message->header()->setDate(date + nextRandom() * 60);
+        message->header()->setReceivedDate(date + i * 60);
+        message->header()->setMessageID(String::stringWithUTF8Format("%u@example.com", uid));
+        messages->addObject(message);
+        message->release();
+    }
+    return messages;
+}
+
+static String * temporaryDirectory(void)
+{
+    char path[] = "/tmp/mailcore-bench-XXXXXX";
+    if (mkdtemp(path) == NULL) {
+        return NULL;
+    }
+    return String::stringWithFileSystemRepresentation(path);
+}
+
+static void removeDirectory(String * path)
+{
+    DIR * dir = opendir(path->fileSystemRepresentation());
+    if (dir != NULL) {
+        struct dirent * ent;
+        while ((ent = readdir(dir)) != NULL) {
+            if ((strcmp(ent->d_name, ".") == 0) || (strcmp(ent->d_name, "..") == 0)) {
+                continue;
+            }
+            String * filename = path->stringByAppendingPathComponent(String::stringWithFileSystemRepresentation(ent->d_name));
+            if (unlink(filename->fileSystemRepresentation()) < 0) {
+                removeDirectory(filename);
+            }
+        }
+        closedir(dir);
+    }
+    rmdir(path->fileSystemRepresentation());
+}
+
+static long long fileSize(String * path)
+{
+    struct stat info;
+    if (stat(path->fileSystemRepresentation(), &info) < 0) {
+        return 0;
+    }
+    return (long long) info.st_size;
+}
+
+static void benchSearchIndex(Array * messages, unsigned int iterations)
+{
+    printf("search index, %u messages\n", messages->count());
+
+    String * directory = temporaryDirectory();
+    MCAssert(directory != NULL);
+    String * path = directory->stringByAppendingPathComponent(MCSTR("index"));
+
+    randomState = 2;
+    Array * bodies = Array::array();
+    for(unsigned int i = 0 ; i < messages->count() ; i ++) {
+        bodies->addObject(randomText(50));
+    }
+
+    IMAPSearchIndex * index = new IMAPSearchIndex();
+    index->setPath(path);
+    index->setUidValidity(1);
+    double start = now();
+    // The last messages are added after the first save.
+    unsigned int firstCount = messages->count() - messages->count() / 100;
+    for(unsigned int i = 0 ; i < firstCount ; i ++) {
+        index->addMessage((IMAPMessage *) messages->objectAtIndex(i), (String *) bodies->objectAtIndex(i));
+    }
+    printDuration("index headers and bodies", start, 1);
+    start = now();
+    index->save();
+    printDuration("save", start, 1);
+    printf("  %-42s %10lld bytes\n", "index file", fileSize(path));
+
+    start = now();
+    for(unsigned int i = firstCount ; i < messages->count() ; i ++) {
+        index->addMessage((IMAPMessage *) messages->objectAtIndex(i), (String *) bodies->objectAtIndex(i));
+    }
+    index->save();
+    printDuration("add 1% of the messages and save", start, 1);
+    printf("  %-42s %10lld bytes\n", "journal file", fileSize(path->stringByAppendingUTF8Format(".log")));
+    index->release();
+
+    index = new IMAPSearchIndex();
+    index->setPath(path);
+    start = now();
+    index->load();
+    printDuration("load", start, 1);
+
+    IMAPSearchExpression * expression = IMAPSearchExpression::searchAnd(IMAPSearchExpression::searchSubject(MCSTR("budget")),
+                                                                        IMAPSearchExpression::searchBody(MCSTR("invoice")));
+    unsigned int matchesCount = 0;
+    start = now();
+    for(unsigned int k = 0 ; k < iterations ; k ++) {
+        AutoreleasePool * pool = new AutoreleasePool();
+        matchesCount = index->search(expression)->count();
+        pool->release();
+    }
+    printDuration("search with the index", start, iterations);
+    index->release();
+
+    // Without the index, the text of each message is searched.
+    unsigned int scanMatchesCount = 0;
+    start = now();
+    for(unsigned int k = 0 ; k < iterations ; k ++) {
+        AutoreleasePool * pool = new AutoreleasePool();
+        scanMatchesCount = 0;
+        for(unsigned int i = 0 ; i < messages->count() ; i ++) {
+            IMAPMessage * message = (IMAPMessage *) messages->objectAtIndex(i);
+            if (message->header()->subject()->lowercaseString()->locationOfString(MCSTR("budget")) == -1) {
+                continue;
+            }
+            if (((String *) bodies->objectAtIndex(i))->lowercaseString()->locationOfString(MCSTR("invoice")) == -1) {
+                continue;
+            }
+            scanMatchesCount ++;
+        }
+        pool->release();
+    }
+    printDuration("search by scanning the messages", start, iterations);
+    printf("  %-42s %10u / %u\n", "matches (index / scan)", matchesCount, scanMatchesCount);
+
+    removeDirectory(directory);
+}
+
+static void benchSearchEvaluator(Array * messages, IMAPMessageTable * table, unsigned int iterations)
+{
+    printf("search evaluator, %u messages\n", messages->count());
+
+    IMAPSearchExpression * expression = IMAPSearchExpression::searchAnd(IMAPSearchExpression::searchUnread(),
+                                                                        IMAPSearchExpression::searchOr(IMAPSearchExpression::searchSubject(MCSTR("lunch")),
+                                                                                                       IMAPSearchExpression::searchSizeLarger(90000)));
+    IMAPSearchEvaluator * evaluator = new IMAPSearchEvaluator();
+    evaluator->setExpression(expression);
+
+    unsigned int arrayMatchesCount = 0;
+    double start = now();
+    for(unsigned int k = 0 ; k < iterations ; k ++) {
+        AutoreleasePool * pool = new AutoreleasePool();
+        arrayMatchesCount = evaluator->matchingUIDs(messages)->count();
+        pool->release();
+    }
+    printDuration("evaluate on IMAPMessage objects", start, iterations);
+
+    unsigned int tableMatchesCount = 0;
+    start = now();
+    for(unsigned int k = 0 ; k < iterations ; k ++) {
+        AutoreleasePool * pool = new AutoreleasePool();
+        tableMatchesCount = table->matchingUIDs(evaluator)->count();
+        pool->release();
+    }
+    printDuration("evaluate on the message table", start, iterations);
+    printf("  %-42s %10u / %u\n", "matches (objects / table)", arrayMatchesCount, tableMatchesCount);
+
+    evaluator->release();
+}
+
+static void benchMessageTable(Array * messages, unsigned int iterations)
+{
+    printf("message table, %u messages\n", messages->count());
+
+    IMAPMessageTable * table = new IMAPMessageTable();
+    double start = now();
+    table->addMessages(messages);
+    printDuration("add the messages", start, 1);
+    printf("  %-42s %10lu bytes\n", "memory used by the table", (unsigned long) table->memoryUsage());
+
+    Array * criteria = Array::array();
+    criteria->addObject(IMAPSortCriterion::criterion(IMAPSortKindSubject));
+    criteria->addObject(IMAPSortCriterion::criterion(IMAPSortKindDate, true));
+
+    start = now();
+    for(unsigned int k = 0 ; k < iterations ; k ++) {
+        AutoreleasePool * pool = new AutoreleasePool();
+        IMAPSortCriterion::sortedMessages(messages, criteria);
+        pool->release();
+    }
+    printDuration("sort IMAPMessage objects", start, iterations);
+
+    start = now();
+    for(unsigned int k = 0 ; k < iterations ; k ++) {
+        AutoreleasePool * pool = new AutoreleasePool();
+        table->sortWithCriteria(criteria);
+        pool->release();
+    }
+    printDuration("sort the message table", start, iterations);
+
+    benchSearchEvaluator(messages, table, iterations);
+
+    table->release();
+}
+
+static IMAPPart * benchPart(String * partID, const char * mimeType, unsigned int idx)
+{
+    IMAPPart * part = new IMAPPart();
+    part->autorelease();
+    part->setPartID(partID);
+    part->setMimeType(String::stringWithUTF8Characters(mimeType));
+    part->setEncoding(EncodingBase64);
+    part->setSize(1000 + idx);
+    part->setContentID(String::stringWithUTF8Format("part%u@example.com", idx));
+    part->setFilename(String::stringWithUTF8Format("image%u.jpg", idx));
+    part->setAttachment(true);
+    return part;
+}
+
+static void benchBodyStructure(unsigned int partsCount, unsigned int iterations)
+{
+    printf("body structure, %u parts\n", partsCount);
+
+    IMAPMultipart * multipart = new IMAPMultipart();
+    multipart->setPartID(MCSTR(""));
+    multipart->setMimeType(MCSTR("multipart/mixed"));
+    Array * parts = Array::array();
+    for(unsigned int i = 0 ; i < partsCount ; i ++) {
+        parts->addObject(benchPart(String::stringWithUTF8Format("%u", i + 1), "image/jpeg", i));
+    }
+    multipart->setParts(parts);
+
+    double start = now();
+    IMAPBodyStructure * bodyStructure = IMAPBodyStructure::bodyStructureWithPart(multipart);
+    printDuration("build", start, 1);
+    printf("  %-42s %10lu bytes\n", "memory used by the body structure", (unsigned long) bodyStructure->memoryUsage());
+
+    unsigned int found = 0;
+    start = now();
+    for(unsigned int k = 0 ; k < iterations ; k ++) {
+        AutoreleasePool * pool = new AutoreleasePool();
+        for(unsigned int i = 0 ; i < partsCount ; i ++) {
+            if (bodyStructure->indexForContentID(String::stringWithUTF8Format("part%u@example.com", i)) != -1) {
+                found ++;
+            }
+        }
+        pool->release();
+    }
+    printDuration("look up all the parts by content-ID", start, iterations);
+
+    unsigned int treeFound = 0;
+    start = now();
+    for(unsigned int k = 0 ; k < iterations ; k ++) {
+        AutoreleasePool * pool = new AutoreleasePool();
+        for(unsigned int i = 0 ; i < partsCount ; i ++) {
+            if (multipart->partForContentID(String::stringWithUTF8Format("part%u@example.com", i)) != NULL) {
+                treeFound ++;
+            }
+        }
+        pool->release();
+    }
+    printDuration("look up all the parts in the tree of parts", start, iterations);
+    printf("  %-42s %10u / %u\n", "found (body structure / tree)", found, treeFound);
+
+    start = now();
+    for(unsigned int k = 0 ; k < iterations ; k ++) {
+        AutoreleasePool * pool = new AutoreleasePool();
+        bodyStructure->mainPart();
+        pool->release();
+    }
+    printDuration("create the tree of parts", start, iterations);
+
+    multipart->release();
+}
+
+// A local stand-in for an IMAP server: it answers the commands needed to select a folder and
+// returns the envelopes of messagesCount messages to any fetch.
+
+struct StandInServer {
+    int listenFd;
+    unsigned int messagesCount;
+};
+
+static void writeAll(int fd, const char * bytes, size_t length)
+{
+    while (length > 0) {
+        ssize_t written = write(fd, bytes, length);
+        if (written <= 0) {
+            return;
+        }
+        bytes += written;
+        length -= written;
+    }
+}
+
+static bool readLine(int fd, char * line, size_t size)
+{
+    size_t length = 0;
+    while (length + 1 < size) {
+        char c;
+        if (read(fd, &c, 1) != 1) {
+            return false;
+        }
+        if (c == '\n') {
+            break;
+        }
+        if (c != '\r') {
+            line[length] = c;
+            length ++;
+        }
+    }
+    line[length] = 0;
+    return true;
+}
+
+static void writeFetchResponses(int fd, unsigned int messagesCount)
+{
+    char buffer[65536];
+    size_t length = 0;
+    for(unsigned int i = 1 ; i <= messagesCount ; i ++) {
+        length += snprintf(buffer + length, sizeof(buffer) - length,
+                           "* %u FETCH (UID %u FLAGS (\\Seen) RFC822.SIZE %u ENVELOPE "
+                           "(\"Mon, 1 Jan 2001 00:00:00 +0000\" \"subject of message %u\" "
+                           "((\"User\" NIL \"user%u\" \"example.com\")) NIL NIL "
+                           "((\"Me\" NIL \"me\" \"example.com\")) NIL NIL NIL \"<%u@example.com>\"))\r\n",
+                           i, i, 1000 + i % 100000, i, i % 500, i);
+        if (length > sizeof(buffer) - 1024) {
+            writeAll(fd, buffer, length);
+            length = 0;
+        }
+    }
+    writeAll(fd, buffer, length);
+}
+
+static void * standInServerRun(void * context)
+{
+    StandInServer * server = (StandInServer *) context;
+    int fd = accept(server->listenFd, NULL, NULL);
+    if (fd < 0) {
+        return NULL;
+    }
+
+    char line[4096];
+    char response[1024];
+    const char * greeting = "* OK [CAPABILITY IMAP4rev1] stand-in ready\r\n";
+    writeAll(fd, greeting, strlen(greeting));
+    while (readLine(fd, line, sizeof(line))) {
+        char * command = strchr(line, ' ');
+        if (command == NULL) {
+            continue;
+        }
+        * command = 0;
+        command ++;
+        const char * tag = line;
+        if (strncasecmp(command, "CAPABILITY", 10) == 0) {
+            snprintf(response, sizeof(response), "* CAPABILITY IMAP4rev1\r\n%s OK done\r\n", tag);
+        }
+        else if ((strncasecmp(command, "SELECT", 6) == 0) || (strncasecmp(command, "EXAMINE", 7) == 0)) {
+            snprintf(response, sizeof(response),
+                     "* FLAGS (\\Seen)\r\n* %u EXISTS\r\n* 0 RECENT\r\n* OK [UIDVALIDITY 1] ok\r\n"
+                     "* OK [UIDNEXT %u] ok\r\n%s OK [READ-WRITE] done\r\n",
+                     server->messagesCount, server->messagesCount + 1, tag);
+        }
+        else if ((strncasecmp(command, "UID FETCH", 9) == 0) || (strncasecmp(command, "FETCH", 5) == 0)) {
+            writeFetchResponses(fd, server->messagesCount);
+            snprintf(response, sizeof(response), "%s OK done\r\n", tag);
+        }
+        else if (strncasecmp(command, "LOGOUT", 6) == 0) {
+            snprintf(response, sizeof(response), "* BYE\r\n%s OK done\r\n", tag);
+            writeAll(fd, response, strlen(response));
+            break;
+        }
+        else {
+            snprintf(response, sizeof(response), "%s OK done\r\n", tag);
+        }
+        writeAll(fd, response, strlen(response));
+    }
+    close(fd);
+    return NULL;
+}
+
+class BenchStreamCallback : public Object, public IMAPMessageStreamCallback {
+public:
+    BenchStreamCallback()
+    {
+        firstMessage = 0;
+        count = 0;
+    }
+
+    virtual void messageFetched(IMAPSession * session, IMAPMessage * message)
+    {
+        if (count == 0) {
+            firstMessage = now();
+        }
+        count ++;
+    }
+
+    double firstMessage;
+    unsigned int count;
+};
+
+// Peak resident size of the current process, in kilobytes.
+static long peakResidentSize(void)
+{
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+#if defined(__APPLE__)
+    return usage.ru_maxrss / 1024;
+#else
+    return usage.ru_maxrss;
+#endif
+}
+
+// Runs in its own process so that the peak resident size only accounts for this fetch.
+static void benchFetchMode(unsigned int messagesCount, bool streaming)
+{
+    AutoreleasePool * pool = new AutoreleasePool();
+
+    StandInServer server;
+    server.messagesCount = messagesCount;
+    server.listenFd = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = 0;
+    socklen_t addressLength = sizeof(address);
+    if ((bind(server.listenFd, (struct sockaddr *) &address, sizeof(address)) < 0) ||
+        (listen(server.listenFd, 1) < 0) ||
+        (getsockname(server.listenFd, (struct sockaddr *) &address, &addressLength) < 0)) {
+        fprintf(stderr, "could not start the stand-in server\n");
+        exit(EXIT_FAILURE);
+    }
+    pthread_t thread;
+    pthread_create(&thread, NULL, standInServerRun, &server);
+
+    IMAPSession * session = new IMAPSession();
+    session->setHostname(MCSTR("127.0.0.1"));
+    session->setPort(ntohs(address.sin_port));
+    session->setConnectionType(ConnectionTypeClear);
+    session->setUsername(MCSTR("user"));
+    session->setPassword(MCSTR("password"));
+
+    ErrorCode error = ErrorNone;
+    session->login(&error);
+    if (error == ErrorNone) {
+        session->select(MCSTR("INBOX"), &error);
+    }
+    if (error != ErrorNone) {
+        fprintf(stderr, "could not open the stand-in folder: %i\n", error);
+        exit(EXIT_FAILURE);
+    }
+
+    long residentSizeBefore = peakResidentSize();
+    IndexSet * uids = IndexSet::indexSetWithRange(RangeMake(1, UINT64_MAX));
+    IMAPMessagesRequestKind kind = (IMAPMessagesRequestKind) (IMAPMessagesRequestKindUid | IMAPMessagesRequestKindFlags |
+                                                              IMAPMessagesRequestKindHeaders | IMAPMessagesRequestKindSize);
+    double start = now();
+    double firstMessage;
+    unsigned int count;
+    if (streaming) {
+        BenchStreamCallback * callback = new BenchStreamCallback();
+        session->streamMessagesByUID(MCSTR("INBOX"), kind, uids, 0, NULL, callback, NULL, &error);
+        firstMessage = callback->firstMessage;
+        count = callback->count;
+        callback->release();
+    }
+    else {
+        // Disables the fetch windows so that the whole folder is fetched in one response.
+        session->setFetchWindowSize(0);
+        Array * messages = session->fetchMessagesByUID(MCSTR("INBOX"), kind, uids, NULL, &error);
+        // The first message is delivered with the others, once the whole response has been parsed.
+        firstMessage = now();
+        count = messages != NULL ? messages->count() : 0;
+    }
+    double end = now();
+    long residentSize = peakResidentSize();
+
+    const char * name = streaming ? "streaming fetch" : "buffered fetch";
+    printf("  %-42s %10.3f ms (first message after %.3f ms)\n", name, (end - start) * 1000., (firstMessage - start) * 1000.);
+    printf("  %-42s %10li kB (%li kB more than before the fetch)\n", "  peak resident size", residentSize,
+           residentSize - residentSizeBefore);
+    if ((error != ErrorNone) || (count != messagesCount)) {
+        printf("  %-42s error %i, %u messages\n", "  failed", error, count);
+    }
+
+    session->disconnect();
+    session->release();
+    pthread_join(thread, NULL);
+    close(server.listenFd);
+
+    pool->release();
+}
+
+static void benchStreamingFetch(unsigned int messagesCount)
+{
+    printf("fetch from a local server, %u messages\n", messagesCount);
+    fflush(stdout);
+    bool modes[] = { false, true };
+    for(unsigned int i = 0 ; i < sizeof(modes) / sizeof(modes[0]) ; i ++) {
+        pid_t pid = fork();
+        if (pid == 0) {
+            benchFetchMode(messagesCount, modes[i]);
+            fflush(stdout);
+            _exit(EXIT_SUCCESS);
+        }
+        waitpid(pid, NULL, 0);
+    }
+}
+
+int main(int argc, char ** argv)
+{
+    setenv("TZ", "EST8EDT", 1);
+    tzset();
+
+    unsigned int messagesCount = 20000;
+    if (argc >= 2) {
+        messagesCount = (unsigned int) strtoul(argv[1], NULL, 10);
+    }
+    if (messagesCount < 100) {
+        fprintf(stderr, "syntax: benchcpp [messagescount, at least 100]\n");
+        exit(EXIT_FAILURE);
+    }
+    unsigned int iterations = 10;
+
+    // Runs first so that the forked processes don't start with the memory of the other benchmarks.
+    benchStreamingFetch(messagesCount);
+
+    AutoreleasePool * pool = new AutoreleasePool();
+
+    Array * messages = benchMessages(messagesCount);
+    benchSearchIndex(messages, iterations);
+    benchMessageTable(messages, iterations);
+    benchBodyStructure(200, iterations);
+
+    pool->release();
+
+    exit(EXIT_SUCCESS);
+}
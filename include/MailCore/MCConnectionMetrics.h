@@ -0,0 +1 @@
+../../src/core/basetypes/MCConnectionMetrics.h
\ No newline at end of file
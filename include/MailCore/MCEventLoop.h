@@ -0,0 +1 @@
+../../src/core/basetypes/MCEventLoop.h
\ No newline at end of file
@@ -0,0 +1 @@
+../../src/core/imap/MCIMAPAppendItem.h
\ No newline at end of file
@@ -0,0 +1 @@
+../../src/async/imap/MCIMAPAppendMessagesOperation.h
\ No newline at end of file
@@ -0,0 +1 @@
+../../src/async/imap/MCIMAPBatchOperation.h
\ No newline at end of file
@@ -0,0 +1 @@
+../../src/core/imap/MCIMAPBodyCache.h
\ No newline at end of file
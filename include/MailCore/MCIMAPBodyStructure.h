@@ -0,0 +1 @@
+../../src/core/imap/MCIMAPBodyStructure.h
\ No newline at end of file
@@ -0,0 +1 @@
+../../src/async/imap/MCIMAPFetchFoldersWithStatusOperation.h
\ No newline at end of file
@@ -0,0 +1 @@
+../../src/core/imap/MCIMAPFolderMirror.h
\ No newline at end of file
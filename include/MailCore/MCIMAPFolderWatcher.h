@@ -0,0 +1 @@
+../../src/async/imap/MCIMAPFolderWatcher.h
\ No newline at end of file
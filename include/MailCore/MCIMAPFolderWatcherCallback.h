@@ -0,0 +1 @@
+../../src/async/imap/MCIMAPFolderWatcherCallback.h
\ No newline at end of file
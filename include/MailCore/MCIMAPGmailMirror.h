@@ -0,0 +1 @@
+../../src/core/imap/MCIMAPGmailMirror.h
\ No newline at end of file
@@ -0,0 +1 @@
+../../src/core/imap/MCIMAPMessageStreamCallback.h
\ No newline at end of file
@@ -0,0 +1 @@
+../../src/core/imap/MCIMAPMessageTable.h
\ No newline at end of file
@@ -0,0 +1 @@
+../../src/core/imap/MCIMAPNotifyEvent.h
\ No newline at end of file
@@ -0,0 +1 @@
+../../src/core/imap/MCIMAPResponseBuffer.h
\ No newline at end of file
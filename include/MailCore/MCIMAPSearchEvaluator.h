@@ -0,0 +1 @@
+../../src/core/imap/MCIMAPSearchEvaluator.h
\ No newline at end of file
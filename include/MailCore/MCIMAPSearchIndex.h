@@ -0,0 +1 @@
+../../src/core/imap/MCIMAPSearchIndex.h
\ No newline at end of file
@@ -0,0 +1 @@
+../../src/core/imap/MCIMAPSearchResult.h
\ No newline at end of file
@@ -0,0 +1 @@
+../../src/core/imap/MCIMAPSortCriterion.h
\ No newline at end of file
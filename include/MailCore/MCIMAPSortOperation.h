@@ -0,0 +1 @@
+../../src/async/imap/MCIMAPSortOperation.h
\ No newline at end of file
@@ -0,0 +1 @@
+../../src/async/imap/MCIMAPSyncFolderMirrorOperation.h
\ No newline at end of file
@@ -0,0 +1 @@
+../../src/core/imap/MCIMAPThread.h
\ No newline at end of file
@@ -0,0 +1 @@
+../../src/async/imap/MCIMAPThreadOperation.h
\ No newline at end of file
@@ -0,0 +1 @@
+../../src/objc/imap/MCOIMAPAppendItem.h
\ No newline at end of file
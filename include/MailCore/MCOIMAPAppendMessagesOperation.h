@@ -0,0 +1 @@
+../../src/objc/imap/MCOIMAPAppendMessagesOperation.h
\ No newline at end of file
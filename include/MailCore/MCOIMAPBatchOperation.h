@@ -0,0 +1 @@
+../../src/objc/imap/MCOIMAPBatchOperation.h
\ No newline at end of file
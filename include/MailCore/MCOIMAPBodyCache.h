@@ -0,0 +1 @@
+../../src/objc/imap/MCOIMAPBodyCache.h
\ No newline at end of file
@@ -0,0 +1 @@
+../../src/objc/imap/MCOIMAPFetchFoldersWithStatusOperation.h
\ No newline at end of file
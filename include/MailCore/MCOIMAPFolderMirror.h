@@ -0,0 +1 @@
+../../src/objc/imap/MCOIMAPFolderMirror.h
\ No newline at end of file
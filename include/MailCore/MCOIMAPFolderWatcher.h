@@ -0,0 +1 @@
+../../src/objc/imap/MCOIMAPFolderWatcher.h
\ No newline at end of file
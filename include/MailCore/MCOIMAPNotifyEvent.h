@@ -0,0 +1 @@
+../../src/objc/imap/MCOIMAPNotifyEvent.h
\ No newline at end of file
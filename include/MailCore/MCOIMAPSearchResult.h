@@ -0,0 +1 @@
+../../src/objc/imap/MCOIMAPSearchResult.h
\ No newline at end of file
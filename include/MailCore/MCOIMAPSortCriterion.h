@@ -0,0 +1 @@
+../../src/objc/imap/MCOIMAPSortCriterion.h
\ No newline at end of file
@@ -0,0 +1 @@
+../../src/objc/imap/MCOIMAPSortOperation.h
\ No newline at end of file
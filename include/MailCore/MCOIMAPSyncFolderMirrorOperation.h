@@ -0,0 +1 @@
+../../src/objc/imap/MCOIMAPSyncFolderMirrorOperation.h
\ No newline at end of file
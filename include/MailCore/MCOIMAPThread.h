@@ -0,0 +1 @@
+../../src/objc/imap/MCOIMAPThread.h
\ No newline at end of file
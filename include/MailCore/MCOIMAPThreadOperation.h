@@ -0,0 +1 @@
+../../src/objc/imap/MCOIMAPThreadOperation.h
\ No newline at end of file
@@ -0,0 +1 @@
+../../src/core/basetypes/MCOperationTiming.h
\ No newline at end of file
@@ -0,0 +1 @@
+../../src/core/basetypes/MCOperationTimingStatistics.h
\ No newline at end of file
@@ -13,7 +13,10 @@
 #include <MailCore/MCIMAPAsyncSession.h>
 #include <MailCore/MCIMAPOperation.h>
 #include <MailCore/MCIMAPFetchFoldersOperation.h>
+#include <MailCore/MCIMAPFetchFoldersWithStatusOperation.h>
 #include <MailCore/MCIMAPAppendMessageOperation.h>
+#include <MailCore/MCIMAPAppendMessagesOperation.h>
+#include <MailCore/MCIMAPSyncFolderMirrorOperation.h>
 #include <MailCore/MCIMAPCopyMessagesOperation.h>
 #include <MailCore/MCIMAPMoveMessagesOperation.h>
 #include <MailCore/MCIMAPFetchMessagesOperation.h>
@@ -21,6 +24,8 @@
 #include <MailCore/MCIMAPFetchContentToFileOperation.h>
 #include <MailCore/MCIMAPFetchParsedContentOperation.h>
 #include <MailCore/MCIMAPIdleOperation.h>
+#include <MailCore/MCIMAPFolderWatcher.h>
+#include <MailCore/MCIMAPFolderWatcherCallback.h>
 #include <MailCore/MCIMAPFolderInfo.h>
 #include <MailCore/MCIMAPFolderInfoOperation.h>
 #include <MailCore/MCIMAPFolderStatusOperation.h>
@@ -28,11 +33,14 @@
 #include <MailCore/MCIMAPNamespace.h>
 #include <MailCore/MCIMAPIdentity.h>
 #include <MailCore/MCIMAPSearchOperation.h>
+#include <MailCore/MCIMAPSortOperation.h>
+#include <MailCore/MCIMAPThreadOperation.h>
 #include <MailCore/MCIMAPSearchExpression.h>
 #include <MailCore/MCIMAPFetchNamespaceOperation.h>
 #include <MailCore/MCIMAPIdentityOperation.h>
 #include <MailCore/MCIMAPCapabilityOperation.h>
 #include <MailCore/MCIMAPQuotaOperation.h>
+#include <MailCore/MCIMAPBatchOperation.h>
 #include <MailCore/MCIMAPOperationCallback.h>
 #include <MailCore/MCIMAPMessageRenderingOperation.h>
 #include <MailCore/MCIMAPCustomCommandOperation.h>
@@ -0,0 +1,49 @@
+//
+//  MCIMAPAppendMessagesOperation.cpp
+//  mailcore2
+//
+//  Created by agent on 10/18/26.
+//  Copyright (c) 2026 MailCore. All rights reserved.
+//
+
+#include "MCIMAPAppendMessagesOperation.h"
+
+#include "MCIMAPSession.h"
+#include "MCIMAPAsyncConnection.h"
+
+using namespace mailcore;
+
+IMAPAppendMessagesOperation::IMAPAppendMessagesOperation()
+{
+    mItems = NULL;
+    mCreatedUIDs = NULL;
+}
+
+IMAPAppendMessagesOperation::~IMAPAppendMessagesOperation()
+{
+    MC_SAFE_RELEASE(mItems);
+    MC_SAFE_RELEASE(mCreatedUIDs);
+}
+
+void IMAPAppendMessagesOperation::setItems(Array * items)
+{
+    MC_SAFE_REPLACE_COPY(Array, mItems, items);
+}
+
+Array * IMAPAppendMessagesOperation::items()
+{
+    return mItems;
+}
+
+IndexSet * IMAPAppendMessagesOperation::createdUIDs()
+{
+    return mCreatedUIDs;
+}
+
+void IMAPAppendMessagesOperation::main()
+{
+    ErrorCode error;
+    IndexSet * createdUIDs = session()->session()->appendMessages(folder(), mItems, this, &error);
+    MC_SAFE_REPLACE_RETAIN(IndexSet, mCreatedUIDs, createdUIDs);
+    setError(error);
+}
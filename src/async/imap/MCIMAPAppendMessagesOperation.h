@@ -0,0 +1,44 @@
+//
+//  MCIMAPAppendMessagesOperation.h
+//  mailcore2
+//
+//  Created by agent on 10/18/26.
+//  Copyright (c) 2026 MailCore. All rights reserved.
+//
+
+#ifndef MAILCORE_MCIMAPAPPENDMESSAGESOPERATION_H
+
+#define MAILCORE_MCIMAPAPPENDMESSAGESOPERATION_H
+
+#include <MailCore/MCIMAPOperation.h>
+#include <MailCore/MCMessageConstants.h>
+
+#ifdef __cplusplus
+
+namespace mailcore {
+    
+    class MAILCORE_EXPORT IMAPAppendMessagesOperation : public IMAPOperation {
+    public:
+        IMAPAppendMessagesOperation();
+        virtual ~IMAPAppendMessagesOperation();
+        
+        virtual void setItems(Array * /* IMAPAppendItem */ items);
+        virtual Array * items();
+        
+        // Result.
+        virtual IndexSet * createdUIDs();
+        
+    public: // subclass behavior
+        virtual void main();
+        
+    private:
+        Array * mItems;
+        IndexSet * mCreatedUIDs;
+        
+    };
+    
+}
+
+#endif
+
+#endif
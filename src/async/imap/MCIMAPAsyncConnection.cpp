@@ -112,6 +112,10 @@ IMAPAsyncConnection::IMAPAsyncConnection()
     mAutomaticConfigurationEnabled = true;
     mQueueRunning = false;
     mScheduledAutomaticDisconnect = false;
+    mOperationCoalescingEnabled = false;
+    mLastOperation = NULL;
+    mCoalescingOperations = new Array();
+    mCoalescedOperationsCount = 0;
 }
 
 IMAPAsyncConnection::~IMAPAsyncConnection()
@@ -122,6 +126,8 @@ IMAPAsyncConnection::~IMAPAsyncConnection()
     cancelDelayedPerformMethod((Object::Method) &IMAPAsyncConnection::tryAutomaticDisconnectAfterDelay, NULL);
 #endif
     pthread_mutex_destroy(&mConnectionLoggerLock);
+    MC_SAFE_RELEASE(mCoalescingOperations);
+    MC_SAFE_RELEASE(mLastOperation);
     MC_SAFE_RELEASE(mInternalLogger);
     MC_SAFE_RELEASE(mQueueCallback);
     MC_SAFE_RELEASE(mLastFolder);
@@ -231,6 +237,26 @@ bool IMAPAsyncConnection::isVoIPEnabled()
     return mSession->isVoIPEnabled();
 }
 
+void IMAPAsyncConnection::setFetchWindowSize(unsigned int windowSize)
+{
+    mSession->setFetchWindowSize(windowSize);
+}
+
+unsigned int IMAPAsyncConnection::fetchWindowSize()
+{
+    return mSession->fetchWindowSize();
+}
+
+void IMAPAsyncConnection::setMaximumPipelinedCommands(unsigned int maximumPipelinedCommands)
+{
+    mSession->setMaximumPipelinedCommands(maximumPipelinedCommands);
+}
+
+unsigned int IMAPAsyncConnection::maximumPipelinedCommands()
+{
+    return mSession->maximumPipelinedCommands();
+}
+
 void IMAPAsyncConnection::setDefaultNamespace(IMAPNamespace * ns)
 {
     mSession->setDefaultNamespace(ns);
@@ -278,9 +304,33 @@ unsigned int IMAPAsyncConnection::operationsCount()
 
 void IMAPAsyncConnection::cancelAllOperations()
 {
+    // Operations merged into a queued one are not known by the queue.
+    mc_foreacharray(IMAPOperation, operation, mCoalescingOperations) {
+        operation->cancelCoalescedOperations();
+    }
     mQueue->cancelAllOperations();
 }
 
+void IMAPAsyncConnection::setOperationCoalescingEnabled(bool enabled)
+{
+    mOperationCoalescingEnabled = enabled;
+}
+
+bool IMAPAsyncConnection::isOperationCoalescingEnabled()
+{
+    return mOperationCoalescingEnabled;
+}
+
+unsigned int IMAPAsyncConnection::coalescedOperationsCount()
+{
+    return mCoalescedOperationsCount;
+}
+
+void IMAPAsyncConnection::coalescedOperationsFinished(IMAPOperation * operation)
+{
+    mCoalescingOperations->removeObject(operation);
+}
+
 void IMAPAsyncConnection::runOperation(IMAPOperation * operation)
 {
     if (mScheduledAutomaticDisconnect) {
@@ -292,6 +342,23 @@ void IMAPAsyncConnection::runOperation(IMAPOperation * operation)
         mOwner->release();
         mScheduledAutomaticDisconnect = false;
     }
+    
+    // Only the most recently queued operation is considered, so that the merged request
+    // doesn't run ahead of operations that were queued in between.
+    if (mOperationCoalescingEnabled && (mLastOperation != NULL) && (mLastOperation != operation)) {
+        if (mLastOperation->addCoalescedOperation(operation)) {
+            if (operation->timing() != NULL) {
+                operation->timing()->markEnqueued();
+            }
+            if (mCoalescingOperations->indexOfObject(mLastOperation) == -1) {
+                mCoalescingOperations->addObject(mLastOperation);
+            }
+            mCoalescedOperationsCount ++;
+            return;
+        }
+    }
+    
+    MC_SAFE_REPLACE_RETAIN(IMAPOperation, mLastOperation, operation);
     mQueue->addOperation(operation);
 }
 
@@ -342,6 +409,8 @@ void IMAPAsyncConnection::queueStartRunning()
 
 void IMAPAsyncConnection::queueStoppedRunning()
 {
+    MC_SAFE_RELEASE(mLastOperation);
+    mCoalescingOperations->removeAllObjects();
     mOwner->release();
     this->release();
 }
@@ -356,6 +425,11 @@ String * IMAPAsyncConnection::lastFolder()
     return mLastFolder;
 }
 
+String * IMAPAsyncConnection::selectedFolder()
+{
+    return mSession->selectedFolder();
+}
+
 void IMAPAsyncConnection::setOwner(IMAPAsyncSession * owner)
 {
     mOwner = owner;
@@ -379,6 +453,26 @@ void IMAPAsyncConnection::setConnectionLogger(ConnectionLogger * logger)
     }
 }
 
+void IMAPAsyncConnection::setConnectionMetrics(ConnectionMetrics * metrics)
+{
+    mSession->setConnectionMetrics(metrics);
+}
+
+ConnectionMetrics * IMAPAsyncConnection::connectionMetrics()
+{
+    return mSession->connectionMetrics();
+}
+
+void IMAPAsyncConnection::setBodyCache(IMAPBodyCache * cache)
+{
+    mSession->setBodyCache(cache);
+}
+
+IMAPBodyCache * IMAPAsyncConnection::bodyCache()
+{
+    return mSession->bodyCache();
+}
+
 ConnectionLogger * IMAPAsyncConnection::connectionLogger()
 {
     ConnectionLogger * result;
@@ -34,6 +34,7 @@ namespace mailcore {
     class IMAPMessageRenderingOperation;
     class IMAPMessage;
     class IMAPIdentity;
+    class IMAPBodyCache;
     
     class MAILCORE_EXPORT IMAPAsyncConnection : public Object {
     public:
@@ -70,6 +71,12 @@ namespace mailcore {
         virtual void setVoIPEnabled(bool enabled);
         virtual bool isVoIPEnabled();
         
+        virtual void setFetchWindowSize(unsigned int windowSize);
+        virtual unsigned int fetchWindowSize();
+        
+        virtual void setMaximumPipelinedCommands(unsigned int maximumPipelinedCommands);
+        virtual unsigned int maximumPipelinedCommands();
+        
         virtual void setAutomaticConfigurationEnabled(bool enabled);
         virtual bool isAutomaticConfigurationEnabled();
         
@@ -83,12 +90,24 @@ namespace mailcore {
         virtual void setConnectionLogger(ConnectionLogger * logger);
         virtual ConnectionLogger * connectionLogger();
         
+        virtual void setConnectionMetrics(ConnectionMetrics * metrics);
+        virtual ConnectionMetrics * connectionMetrics();
+        
+        virtual void setBodyCache(IMAPBodyCache * cache);
+        virtual IMAPBodyCache * bodyCache();
+        
 #ifdef __APPLE__
         virtual void setDispatchQueue(dispatch_queue_t dispatchQueue);
         virtual dispatch_queue_t dispatchQueue();
 #endif
         
         virtual IMAPOperation * disconnectOperation();
+        
+        virtual void setOperationCoalescingEnabled(bool enabled);
+        virtual bool isOperationCoalescingEnabled();
+        
+        // Number of operations that have been merged into a pending one instead of being sent.
+        virtual unsigned int coalescedOperationsCount();
 
     private:
         IMAPSession * mSession;
@@ -104,11 +123,16 @@ namespace mailcore {
         bool mAutomaticConfigurationEnabled;
         bool mQueueRunning;
         bool mScheduledAutomaticDisconnect;
+        bool mOperationCoalescingEnabled;
+        IMAPOperation * mLastOperation;
+        Array * mCoalescingOperations;
+        unsigned int mCoalescedOperationsCount;
         
         virtual void tryAutomaticDisconnectAfterDelay(void * context);
 
     public: // private
         virtual void runOperation(IMAPOperation * operation);
+        virtual void coalescedOperationsFinished(IMAPOperation * operation);
         virtual IMAPSession * session();
         
         virtual void cancelAllOperations();
@@ -116,6 +140,9 @@ namespace mailcore {
         
         virtual void setLastFolder(String * folder);
         virtual String * lastFolder();
+        // Folder that is actually selected by the connection. It can differ from lastFolder() when
+        // operations are queued, when the selection failed or after a disconnection.
+        virtual String * selectedFolder();
         
         virtual void tryAutomaticDisconnect();
         virtual void queueStartRunning();
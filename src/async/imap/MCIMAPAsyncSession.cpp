@@ -19,12 +19,17 @@
 #include "MCIMAPFolderInfoOperation.h"
 #include "MCIMAPFolderStatusOperation.h"
 #include "MCIMAPFetchFoldersOperation.h"
+#include "MCIMAPFetchFoldersWithStatusOperation.h"
 #include "MCIMAPRenameFolderOperation.h"
 #include "MCIMAPDeleteFolderOperation.h"
 #include "MCIMAPCreateFolderOperation.h"
 #include "MCIMAPSubscribeFolderOperation.h"
 #include "MCIMAPExpungeOperation.h"
 #include "MCIMAPAppendMessageOperation.h"
+#include "MCIMAPAppendMessagesOperation.h"
+#include "MCIMAPSyncFolderMirrorOperation.h"
+#include "MCIMAPFolderMirror.h"
+#include "MCIMAPBodyCache.h"
 #include "MCIMAPCopyMessagesOperation.h"
 #include "MCIMAPMoveMessagesOperation.h"
 #include "MCIMAPFetchMessagesOperation.h"
@@ -34,10 +39,13 @@
 #include "MCIMAPStoreFlagsOperation.h"
 #include "MCIMAPStoreLabelsOperation.h"
 #include "MCIMAPSearchOperation.h"
+#include "MCIMAPSortOperation.h"
+#include "MCIMAPThreadOperation.h"
 #include "MCIMAPConnectOperation.h"
 #include "MCIMAPCheckAccountOperation.h"
 #include "MCIMAPFetchNamespaceOperation.h"
 #include "MCIMAPIdleOperation.h"
+#include "MCIMAPFolderWatcher.h"
 #include "MCIMAPIdentityOperation.h"
 #include "MCIMAPCapabilityOperation.h"
 #include "MCIMAPQuotaOperation.h"
@@ -45,6 +53,7 @@
 #include "MCIMAPNoopOperation.h"
 #include "MCIMAPMessageRenderingOperation.h"
 #include "MCIMAPCustomCommandOperation.h"
+#include "MCIMAPBatchOperation.h"
 
 #define DEFAULT_MAX_CONNECTIONS 3
 
@@ -65,9 +74,16 @@ IMAPAsyncSession::IMAPAsyncSession()
     mConnectionType = ConnectionTypeClear;
     mCheckCertificateEnabled = true;
     mVoIPEnabled = true;
+    mFetchWindowSize = 1000;
+    mMaximumPipelinedCommands = 1;
     mDefaultNamespace = NULL;
     mTimeout = 30.;
     mConnectionLogger = NULL;
+    mOperationCoalescingEnabled = false;
+    mOperationTimingEnabled = false;
+    mOperationTimingStatistics = new OperationTimingStatistics();
+    mConnectionMetrics = NULL;
+    mBodyCache = NULL;
     mAutomaticConfigurationDone = false;
     mServerIdentity = new IMAPIdentity();
     mClientIdentity = new IMAPIdentity();
@@ -87,6 +103,9 @@ IMAPAsyncSession::~IMAPAsyncSession()
         dispatch_release(mDispatchQueue);
     }
 #endif
+    MC_SAFE_RELEASE(mBodyCache);
+    MC_SAFE_RELEASE(mConnectionMetrics);
+    MC_SAFE_RELEASE(mOperationTimingStatistics);
     MC_SAFE_RELEASE(mGmailUserDisplayName);
     MC_SAFE_RELEASE(mServerIdentity);
     MC_SAFE_RELEASE(mClientIdentity);
@@ -198,6 +217,26 @@ bool IMAPAsyncSession::isVoIPEnabled()
     return mVoIPEnabled;
 }
 
+void IMAPAsyncSession::setFetchWindowSize(unsigned int windowSize)
+{
+    mFetchWindowSize = windowSize;
+}
+
+unsigned int IMAPAsyncSession::fetchWindowSize()
+{
+    return mFetchWindowSize;
+}
+
+void IMAPAsyncSession::setMaximumPipelinedCommands(unsigned int maximumPipelinedCommands)
+{
+    mMaximumPipelinedCommands = maximumPipelinedCommands;
+}
+
+unsigned int IMAPAsyncSession::maximumPipelinedCommands()
+{
+    return mMaximumPipelinedCommands;
+}
+
 IMAPNamespace * IMAPAsyncSession::defaultNamespace()
 {
     return mDefaultNamespace;
@@ -257,6 +296,8 @@ IMAPAsyncConnection * IMAPAsyncSession::session()
 {
     IMAPAsyncConnection * session = new IMAPAsyncConnection();
     session->setConnectionLogger(mConnectionLogger);
+    session->setConnectionMetrics(mConnectionMetrics);
+    session->setBodyCache(mBodyCache);
     session->setOwner(this);
     session->autorelease();
 
@@ -270,8 +311,11 @@ IMAPAsyncConnection * IMAPAsyncSession::session()
     session->setTimeout(mTimeout);
     session->setCheckCertificateEnabled(mCheckCertificateEnabled);
     session->setVoIPEnabled(mVoIPEnabled);
+    session->setFetchWindowSize(mFetchWindowSize);
+    session->setMaximumPipelinedCommands(mMaximumPipelinedCommands);
     session->setDefaultNamespace(mDefaultNamespace);
     session->setClientIdentity(mClientIdentity);
+    session->setOperationCoalescingEnabled(mOperationCoalescingEnabled);
 #if __APPLE__
     session->setDispatchQueue(mDispatchQueue);
 #endif
@@ -316,6 +360,61 @@ IMAPAsyncConnection * IMAPAsyncSession::sessionForFolder(String * folder, bool u
     }
 }
 
+Array * IMAPAsyncSession::sessionsForFolders(Array * folders)
+{
+    Array * result = Array::array();
+    Array * unassignedSessions = Array::array();
+    Array * assignedSessions = Array::array();
+    
+    // First pass: keep folders on the connections they're already selected on.
+    mc_foreacharray(String, folder, folders) {
+        IMAPAsyncConnection * s = sessionWithMinQueue(true, folder);
+        if (s != NULL) {
+            result->addObject(s);
+            assignedSessions->addObject(s);
+        }
+        else {
+            result->addObject(Null::null());
+        }
+    }
+    
+    for(unsigned int i = 0 ; i < mSessions->count() ; i ++) {
+        IMAPAsyncConnection * s = (IMAPAsyncConnection *) mSessions->objectAtIndex(i);
+        if ((s->operationsCount() == 0) && (assignedSessions->indexOfObject(s) == -1)) {
+            unassignedSessions->addObject(s);
+        }
+    }
+    
+    // Second pass: other folders go to idle connections, then new ones,
+    // then they're distributed in turn over the connections already used.
+    unsigned int next = 0;
+    for(unsigned int i = 0 ; i < folders->count() ; i ++) {
+        if (result->objectAtIndex(i) != Null::null()) {
+            continue;
+        }
+        
+        IMAPAsyncConnection * s = NULL;
+        if (unassignedSessions->count() > 0) {
+            s = (IMAPAsyncConnection *) unassignedSessions->objectAtIndex(0);
+            unassignedSessions->removeObjectAtIndex(0);
+            assignedSessions->addObject(s);
+        }
+        else if ((assignedSessions->count() == 0) || (mMaximumConnections == 0) || (mSessions->count() < mMaximumConnections)) {
+            s = availableSession();
+            if (assignedSessions->indexOfObject(s) == -1) {
+                assignedSessions->addObject(s);
+            }
+        }
+        else {
+            s = (IMAPAsyncConnection *) assignedSessions->objectAtIndex(next % assignedSessions->count());
+            next ++;
+        }
+        result->replaceObject(i, s);
+    }
+    
+    return result;
+}
+
 IMAPAsyncConnection * IMAPAsyncSession::availableSession()
 {
     // try find existant session with empty queue for reusing.
@@ -375,8 +474,9 @@ IMAPAsyncConnection * IMAPAsyncSession::sessionWithMinQueue(bool filterByFolder,
             bool matched = true;
             if (filterByFolder) {
                 // filter by last selested folder
-                matched = ((folder != NULL && s->lastFolder() != NULL && s->lastFolder()->isEqual(folder))
-                           || (folder == NULL && s->lastFolder() == NULL));
+                String * sessionFolder = folderForSession(s);
+                matched = ((folder != NULL && sessionFolder != NULL && sessionFolder->isEqual(folder))
+                           || (folder == NULL && sessionFolder == NULL));
             }
             if (matched) {
                 chosenSession = s;
@@ -388,6 +488,16 @@ IMAPAsyncConnection * IMAPAsyncSession::sessionWithMinQueue(bool filterByFolder,
     return chosenSession;
 }
 
+// The queued operations will select lastFolder(). Without operations, the folder that is actually
+// selected is used: the selection could have failed or the connection could have been closed.
+String * IMAPAsyncSession::folderForSession(IMAPAsyncConnection * session)
+{
+    if (session->operationsCount() > 0) {
+        return session->lastFolder();
+    }
+    return session->selectedFolder();
+}
+
 IMAPFolderInfoOperation * IMAPAsyncSession::folderInfoOperation(String * folder)
 {
     IMAPFolderInfoOperation * op = new IMAPFolderInfoOperation();
@@ -423,6 +533,14 @@ IMAPFetchFoldersOperation * IMAPAsyncSession::fetchAllFoldersOperation()
     return op;
 }
 
+IMAPFetchFoldersWithStatusOperation * IMAPAsyncSession::fetchAllFoldersWithStatusOperation()
+{
+    IMAPFetchFoldersWithStatusOperation * op = new IMAPFetchFoldersWithStatusOperation();
+    op->setMainSession(this);
+    op->autorelease();
+    return op;
+}
+
 IMAPOperation * IMAPAsyncSession::renameFolderOperation(String * folder, String * otherName)
 {
     IMAPRenameFolderOperation * op = new IMAPRenameFolderOperation();
@@ -494,6 +612,16 @@ IMAPAppendMessageOperation * IMAPAsyncSession::appendMessageOperation(String * f
     return op;
 }
 
+IMAPAppendMessagesOperation * IMAPAsyncSession::appendMessagesOperation(String * folder, Array * items)
+{
+    IMAPAppendMessagesOperation * op = new IMAPAppendMessagesOperation();
+    op->setMainSession(this);
+    op->setFolder(folder);
+    op->setItems(items);
+    op->autorelease();
+    return op;
+}
+
 IMAPCopyMessagesOperation * IMAPAsyncSession::copyMessagesOperation(String * folder, IndexSet * uids, String * destFolder)
 {
     IMAPCopyMessagesOperation * op = new IMAPCopyMessagesOperation();
@@ -564,6 +692,16 @@ IMAPFetchMessagesOperation * IMAPAsyncSession::syncMessagesByUIDOperation(String
     return op;
 }
 
+IMAPSyncFolderMirrorOperation * IMAPAsyncSession::syncFolderMirrorOperation(IMAPFolderMirror * mirror)
+{
+    IMAPSyncFolderMirrorOperation * op = new IMAPSyncFolderMirrorOperation();
+    op->setMainSession(this);
+    op->setFolder(mirror->folder());
+    op->setMirror(mirror);
+    op->autorelease();
+    return op;
+}
+
 IMAPFetchContentOperation * IMAPAsyncSession::fetchMessageByUIDOperation(String * folder, uint32_t uid, bool urgent)
 {
     IMAPFetchContentOperation * op = new IMAPFetchContentOperation();
@@ -715,6 +853,41 @@ IMAPOperation * IMAPAsyncSession::storeLabelsByNumberOperation(String * folder,
     return op;
 }
 
+IMAPBatchOperation * IMAPAsyncSession::batchStoreFlagsOperation(HashMap * folderUids, IMAPStoreFlagsRequestKind kind, MessageFlag flags, Array * customFlags)
+{
+    IMAPBatchOperation * op = new IMAPBatchOperation();
+    op->setMainSession(this);
+    op->setAction(IMAPBatchActionStoreFlags);
+    op->setFolderUids(folderUids);
+    op->setKind(kind);
+    op->setFlags(flags);
+    op->setCustomFlags(customFlags);
+    op->autorelease();
+    return op;
+}
+
+IMAPBatchOperation * IMAPAsyncSession::batchCopyMessagesOperation(HashMap * folderUids, String * destFolder)
+{
+    IMAPBatchOperation * op = new IMAPBatchOperation();
+    op->setMainSession(this);
+    op->setAction(IMAPBatchActionCopy);
+    op->setFolderUids(folderUids);
+    op->setDestFolder(destFolder);
+    op->autorelease();
+    return op;
+}
+
+IMAPBatchOperation * IMAPAsyncSession::batchMoveMessagesOperation(HashMap * folderUids, String * destFolder)
+{
+    IMAPBatchOperation * op = new IMAPBatchOperation();
+    op->setMainSession(this);
+    op->setAction(IMAPBatchActionMove);
+    op->setFolderUids(folderUids);
+    op->setDestFolder(destFolder);
+    op->autorelease();
+    return op;
+}
+
 IMAPSearchOperation * IMAPAsyncSession::searchOperation(String * folder, IMAPSearchKind kind, String * searchString)
 {
     IMAPSearchOperation * op = new IMAPSearchOperation();
@@ -736,6 +909,55 @@ IMAPSearchOperation * IMAPAsyncSession::searchOperation(String * folder, IMAPSea
     return op;
 }
 
+IMAPSearchOperation * IMAPAsyncSession::extendedSearchOperation(String * folder, IMAPSearchExpression * expression,
+                                                                IMAPSearchReturnOption options)
+{
+    IMAPSearchOperation * op = new IMAPSearchOperation();
+    op->setMainSession(this);
+    op->setFolder(folder);
+    op->setSearchExpression(expression);
+    op->setReturnOptions(options);
+    op->autorelease();
+    return op;
+}
+
+IMAPSearchOperation * IMAPAsyncSession::partialSearchOperation(String * folder, IMAPSearchExpression * expression,
+                                                               Range positions, bool fromEnd)
+{
+    IMAPSearchOperation * op = new IMAPSearchOperation();
+    op->setMainSession(this);
+    op->setFolder(folder);
+    op->setSearchExpression(expression);
+    op->setPartialRange(positions);
+    op->setPartialFromEnd(fromEnd);
+    op->autorelease();
+    return op;
+}
+
+IMAPSortOperation * IMAPAsyncSession::sortOperation(String * folder, Array * criteria,
+                                                    IMAPSearchExpression * expression)
+{
+    IMAPSortOperation * op = new IMAPSortOperation();
+    op->setMainSession(this);
+    op->setFolder(folder);
+    op->setCriteria(criteria);
+    op->setSearchExpression(expression);
+    op->autorelease();
+    return op;
+}
+
+IMAPThreadOperation * IMAPAsyncSession::threadOperation(String * folder, IMAPThreadAlgorithm algorithm,
+                                                        IMAPSearchExpression * expression)
+{
+    IMAPThreadOperation * op = new IMAPThreadOperation();
+    op->setMainSession(this);
+    op->setFolder(folder);
+    op->setAlgorithm(algorithm);
+    op->setSearchExpression(expression);
+    op->autorelease();
+    return op;
+}
+
 IMAPIdleOperation * IMAPAsyncSession::idleOperation(String * folder, uint32_t lastKnownUID)
 {
     IMAPIdleOperation * op = new IMAPIdleOperation();
@@ -746,6 +968,35 @@ IMAPIdleOperation * IMAPAsyncSession::idleOperation(String * folder, uint32_t la
     return op;
 }
 
+// Session with the settings of the account that is not used by the queues of the async session.
+IMAPSession * IMAPAsyncSession::detachedSession()
+{
+    IMAPSession * session = new IMAPSession();
+    session->autorelease();
+    session->setHostname(mHostname);
+    session->setPort(mPort);
+    session->setUsername(mUsername);
+    session->setPassword(mPassword);
+    session->setOAuth2Token(mOAuth2Token);
+    session->setAuthType(mAuthType);
+    session->setConnectionType(mConnectionType);
+    session->setTimeout(mTimeout);
+    session->setCheckCertificateEnabled(mCheckCertificateEnabled);
+    session->setVoIPEnabled(mVoIPEnabled);
+    session->setDefaultNamespace(mDefaultNamespace);
+    session->setClientIdentity(mClientIdentity);
+    return session;
+}
+
+IMAPFolderWatcher * IMAPAsyncSession::folderWatcher(Array * folders)
+{
+    IMAPFolderWatcher * watcher = new IMAPFolderWatcher();
+    watcher->setSession(detachedSession());
+    watcher->setFolders(folders);
+    watcher->autorelease();
+    return watcher;
+}
+
 IMAPFetchNamespaceOperation * IMAPAsyncSession::fetchNamespaceOperation()
 {
     IMAPFetchNamespaceOperation * op = new IMAPFetchNamespaceOperation();
@@ -828,6 +1079,91 @@ ConnectionLogger * IMAPAsyncSession::connectionLogger()
     return mConnectionLogger;
 }
 
+void IMAPAsyncSession::setOperationCoalescingEnabled(bool enabled)
+{
+    mOperationCoalescingEnabled = enabled;
+    for(unsigned int i = 0 ; i < mSessions->count() ; i ++) {
+        IMAPAsyncConnection * currentSession = (IMAPAsyncConnection *) mSessions->objectAtIndex(i);
+        currentSession->setOperationCoalescingEnabled(enabled);
+    }
+}
+
+bool IMAPAsyncSession::isOperationCoalescingEnabled()
+{
+    return mOperationCoalescingEnabled;
+}
+
+void IMAPAsyncSession::setOperationTimingEnabled(bool enabled)
+{
+    mOperationTimingEnabled = enabled;
+}
+
+bool IMAPAsyncSession::isOperationTimingEnabled()
+{
+    return mOperationTimingEnabled;
+}
+
+OperationTimingStatistics * IMAPAsyncSession::operationTimingStatistics()
+{
+    return mOperationTimingStatistics;
+}
+
+void IMAPAsyncSession::setConnectionMetrics(ConnectionMetrics * metrics)
+{
+    MC_SAFE_REPLACE_RETAIN(ConnectionMetrics, mConnectionMetrics, metrics);
+    for(unsigned int i = 0 ; i < mSessions->count() ; i ++) {
+        IMAPAsyncConnection * currentSession = (IMAPAsyncConnection *) mSessions->objectAtIndex(i);
+        currentSession->setConnectionMetrics(metrics);
+    }
+}
+
+ConnectionMetrics * IMAPAsyncSession::connectionMetrics()
+{
+    return mConnectionMetrics;
+}
+
+void IMAPAsyncSession::setBodyCache(IMAPBodyCache * cache)
+{
+    MC_SAFE_REPLACE_RETAIN(IMAPBodyCache, mBodyCache, cache);
+    for(unsigned int i = 0 ; i < mSessions->count() ; i ++) {
+        IMAPAsyncConnection * currentSession = (IMAPAsyncConnection *) mSessions->objectAtIndex(i);
+        currentSession->setBodyCache(cache);
+    }
+}
+
+IMAPBodyCache * IMAPAsyncSession::bodyCache()
+{
+    return mBodyCache;
+}
+
+unsigned int IMAPAsyncSession::selectsCount()
+{
+    unsigned int count = 0;
+    mc_foreacharray(IMAPAsyncConnection, s, mSessions) {
+        count += s->session()->selectsCount();
+    }
+    return count;
+}
+
+unsigned int IMAPAsyncSession::selectsAvoidedCount()
+{
+    unsigned int count = 0;
+    mc_foreacharray(IMAPAsyncConnection, s, mSessions) {
+        count += s->session()->selectsAvoidedCount();
+    }
+    return count;
+}
+
+unsigned int IMAPAsyncSession::coalescedOperationsCount()
+{
+    unsigned int count = 0;
+    for(unsigned int i = 0 ; i < mSessions->count() ; i ++) {
+        IMAPAsyncConnection * currentSession = (IMAPAsyncConnection *) mSessions->objectAtIndex(i);
+        count += currentSession->coalescedOperationsCount();
+    }
+    return count;
+}
+
 IMAPMessageRenderingOperation * IMAPAsyncSession::renderingOperation(IMAPMessage * message,
                                                                      String * folder,
                                                                      IMAPMessageRenderingType type)
@@ -19,7 +19,9 @@ namespace mailcore {
     
     class IMAPOperation;
     class IMAPFetchFoldersOperation;
+    class IMAPFetchFoldersWithStatusOperation;
     class IMAPAppendMessageOperation;
+    class IMAPAppendMessagesOperation;
     class IMAPCopyMessagesOperation;
     class IMAPMoveMessagesOperation;
     class IMAPFetchMessagesOperation;
@@ -44,6 +46,13 @@ namespace mailcore {
     class OperationQueueCallback;
     class IMAPCustomCommandOperation;
     class IMAPCheckAccountOperation;
+    class IMAPBatchOperation;
+    class IMAPFolderMirror;
+    class IMAPSyncFolderMirrorOperation;
+    class IMAPSortOperation;
+    class IMAPThreadOperation;
+    class IMAPFolderWatcher;
+    class IMAPBodyCache;
     
     class MAILCORE_EXPORT IMAPAsyncSession : public Object {
     public:
@@ -82,6 +91,15 @@ namespace mailcore {
         virtual void setVoIPEnabled(bool enabled);
         virtual bool isVoIPEnabled();
         
+        // See IMAPSession::setFetchWindowSize(). Default is 1000. A windowed fetch is still a single operation.
+        // When it fails, IMAPFetchMessagesOperation::completedIndexes() tells where to resume from.
+        virtual void setFetchWindowSize(unsigned int windowSize);
+        virtual unsigned int fetchWindowSize();
+        
+        // See IMAPSession::setMaximumPipelinedCommands().
+        virtual void setMaximumPipelinedCommands(unsigned int maximumPipelinedCommands);
+        virtual unsigned int maximumPipelinedCommands();
+        
         virtual void setDefaultNamespace(IMAPNamespace * ns);
         virtual IMAPNamespace * defaultNamespace();
         
@@ -94,6 +112,35 @@ namespace mailcore {
         virtual void setConnectionLogger(ConnectionLogger * logger);
         virtual ConnectionLogger * connectionLogger();
         
+        // When enabled, folder info, folder status, store flags and fetch messages operations
+        // queued right after a compatible pending operation are merged into it.
+        // Operations that are merged share the result objects of the pending operation.
+        virtual void setOperationCoalescingEnabled(bool enabled);
+        virtual bool isOperationCoalescingEnabled();
+        
+        // Number of round trips saved by coalescing.
+        virtual unsigned int coalescedOperationsCount();
+        
+        // When enabled, queue wait, connect, login, select, first byte, parse and callback durations
+        // and bytes transferred are collected for each operation and aggregated per operation class.
+        virtual void setOperationTimingEnabled(bool enabled);
+        virtual bool isOperationTimingEnabled();
+        virtual OperationTimingStatistics * operationTimingStatistics();
+        
+        // Bytes per direction, command counts and round-trip durations per verb and TLS handshake durations
+        // of all the connections. It can be read from any thread.
+        virtual void setConnectionMetrics(ConnectionMetrics * metrics);
+        virtual ConnectionMetrics * connectionMetrics();
+        
+        // On-disk cache of message contents and attachments fetched by UID, shared by all the connections.
+        virtual void setBodyCache(IMAPBodyCache * cache);
+        virtual IMAPBodyCache * bodyCache();
+        
+        // Number of SELECT sent by all the connections and number of SELECT that were not needed
+        // because the folder was already selected on the connection.
+        virtual unsigned int selectsCount();
+        virtual unsigned int selectsAvoidedCount();
+        
 #ifdef __APPLE__
         virtual void setDispatchQueue(dispatch_queue_t dispatchQueue);
         virtual dispatch_queue_t dispatchQueue();
@@ -117,6 +164,8 @@ namespace mailcore {
         
         virtual IMAPFetchFoldersOperation * fetchSubscribedFoldersOperation();
         virtual IMAPFetchFoldersOperation * fetchAllFoldersOperation();
+        // Fetches all the folders and their status. See IMAPSession::fetchAllFoldersWithStatus().
+        virtual IMAPFetchFoldersWithStatusOperation * fetchAllFoldersWithStatusOperation();
         
         virtual IMAPOperation * renameFolderOperation(String * folder, String * otherName);
         virtual IMAPOperation * deleteFolderOperation(String * folder);
@@ -127,6 +176,8 @@ namespace mailcore {
         
         virtual IMAPAppendMessageOperation * appendMessageOperation(String * folder, Data * messageData, MessageFlag flags, Array * customFlags = NULL);
         virtual IMAPAppendMessageOperation * appendMessageOperation(String * folder, String * messagePath, MessageFlag flags, Array * customFlags = NULL);
+        // Bulk import of IMAPAppendItem in a single operation. See IMAPSession::appendMessages().
+        virtual IMAPAppendMessagesOperation * appendMessagesOperation(String * folder, Array * /* IMAPAppendItem */ items);
 
         virtual IMAPCopyMessagesOperation * copyMessagesOperation(String * folder, IndexSet * uids, String * destFolder);
         virtual IMAPMoveMessagesOperation * moveMessagesOperation(String * folder, IndexSet * uids, String * destFolder);
@@ -139,6 +190,8 @@ namespace mailcore {
                                                                             IndexSet * indexes);
         virtual IMAPFetchMessagesOperation * syncMessagesByUIDOperation(String * folder, IMAPMessagesRequestKind requestKind,
                                                                         IndexSet * indexes, uint64_t modSeq);
+        // Updates the mirror of mirror->folder() and saves it. See IMAPFolderMirror::sync().
+        virtual IMAPSyncFolderMirrorOperation * syncFolderMirrorOperation(IMAPFolderMirror * mirror);
         
         virtual IMAPFetchContentOperation * fetchMessageByUIDOperation(String * folder, uint32_t uid, bool urgent = false);
         virtual IMAPFetchContentOperation * fetchMessageAttachmentByUIDOperation(String * folder, uint32_t uid, String * partID,
@@ -163,10 +216,27 @@ namespace mailcore {
         virtual IMAPOperation * storeLabelsByUIDOperation(String * folder, IndexSet * uids, IMAPStoreFlagsRequestKind kind, Array * labels);
         virtual IMAPOperation * storeLabelsByNumberOperation(String * folder, IndexSet * numbers, IMAPStoreFlagsRequestKind kind, Array * labels);
         
+        // folderUids maps folder names to IndexSet of UIDs.
+        virtual IMAPBatchOperation * batchStoreFlagsOperation(HashMap * folderUids, IMAPStoreFlagsRequestKind kind, MessageFlag flags, Array * customFlags = NULL);
+        virtual IMAPBatchOperation * batchCopyMessagesOperation(HashMap * folderUids, String * destFolder);
+        virtual IMAPBatchOperation * batchMoveMessagesOperation(HashMap * folderUids, String * destFolder);
+        
         virtual IMAPSearchOperation * searchOperation(String * folder, IMAPSearchKind kind, String * searchString);
         virtual IMAPSearchOperation * searchOperation(String * folder, IMAPSearchExpression * expression);
+        // See IMAPSession::extendedSearch() and IMAPSession::partialSearch(). The result is in searchResult().
+        virtual IMAPSearchOperation * extendedSearchOperation(String * folder, IMAPSearchExpression * expression,
+                                                              IMAPSearchReturnOption options);
+        virtual IMAPSearchOperation * partialSearchOperation(String * folder, IMAPSearchExpression * expression,
+                                                             Range positions, bool fromEnd);
+        // expression can be NULL to sort or thread all the messages of the folder.
+        virtual IMAPSortOperation * sortOperation(String * folder, Array * /* IMAPSortCriterion */ criteria,
+                                                  IMAPSearchExpression * expression);
+        virtual IMAPThreadOperation * threadOperation(String * folder, IMAPThreadAlgorithm algorithm,
+                                                      IMAPSearchExpression * expression);
         
         virtual IMAPIdleOperation * idleOperation(String * folder, uint32_t lastKnownUID);
+        // Returns a watcher with its own connection. Many watchers can be started without using one thread each.
+        virtual IMAPFolderWatcher * folderWatcher(Array * /* String */ folders);
         
         virtual IMAPFetchNamespaceOperation * fetchNamespaceOperation();
         
@@ -190,6 +260,10 @@ namespace mailcore {
         virtual void automaticConfigurationDone(IMAPSession * session);
         virtual void operationRunningStateChanged();
         virtual IMAPAsyncConnection * sessionForFolder(String * folder, bool urgent = false);
+        /*! Returns the connections to use for the given folders, in the same order.
+         A folder goes to the connection that has it selected, otherwise folders are spread
+         over the idle connections. The caller is responsible for updating lastFolder(). */
+        virtual Array * /* IMAPAsyncConnection */ sessionsForFolders(Array * /* String */ folders);
         
     private:
         Array * mSessions;
@@ -203,11 +277,18 @@ namespace mailcore {
         ConnectionType mConnectionType;
         bool mCheckCertificateEnabled;
         bool mVoIPEnabled;
+        unsigned int mFetchWindowSize;
+        unsigned int mMaximumPipelinedCommands;
         IMAPNamespace * mDefaultNamespace;
         time_t mTimeout;
         bool mAllowsFolderConcurrentAccessEnabled;
         unsigned int mMaximumConnections;
         ConnectionLogger * mConnectionLogger;
+        bool mOperationCoalescingEnabled;
+        bool mOperationTimingEnabled;
+        OperationTimingStatistics * mOperationTimingStatistics;
+        ConnectionMetrics * mConnectionMetrics;
+        IMAPBodyCache * mBodyCache;
         bool mAutomaticConfigurationDone;
         IMAPIdentity * mServerIdentity;
         IMAPIdentity * mClientIdentity;
@@ -221,17 +302,20 @@ namespace mailcore {
 
         /*! Create new IMAP session */
         virtual IMAPAsyncConnection * session();
+        virtual IMAPSession * detachedSession();
         /*! Returns a new or an existing session, it is best suited to run the IMAP command
          in the specified folder. */
         virtual IMAPAsyncConnection * matchingSessionForFolder(String * folder);
         /*! Returns a session with minimum operation queue among already created ones.
          If @param filterByFolder is true, then function filters sessions with
          predicate ( lastFolder() EQUALS TO @param folder ). In case of param folder is NULL
-         the function would search a session among non-selected ones. */
+         the function would search a session among non-selected ones. The folder that is actually
+         selected is used for the sessions with an empty queue. */
         virtual IMAPAsyncConnection * sessionWithMinQueue(bool filterByFolder, String * folder);
         /*! Returns existant or new session with empty operation queue, if it can.
          Otherwise, returns the session with the minimum size of the operation queue. */
         virtual IMAPAsyncConnection * availableSession();
+        virtual String * folderForSession(IMAPAsyncConnection * session);
         virtual IMAPMessageRenderingOperation * renderingOperation(IMAPMessage * message,
                                                                    String * folder,
                                                                    IMAPMessageRenderingType type);
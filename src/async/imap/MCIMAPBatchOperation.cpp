@@ -0,0 +1,340 @@
+//
+//  MCIMAPBatchOperation.cpp
+//  mailcore2
+//
+//  Created by agent on 10/18/26.
+//  Copyright (c) 2026 MailCore. All rights reserved.
+//
+
+#include "MCIMAPBatchOperation.h"
+
+#include "MCIMAPSession.h"
+#include "MCIMAPAsyncSession.h"
+#include "MCIMAPAsyncConnection.h"
+
+using namespace mailcore;
+
+// Number of commands of a folder sent before waiting for their completion.
+#define BATCH_PIPELINED_COMMANDS 8
+
+namespace mailcore {
+
+    // Processes the folders assigned to one connection, in a row.
+    class IMAPBatchFoldersOperation : public IMAPOperation {
+    public:
+        IMAPBatchFoldersOperation(IMAPBatchOperation * batchOperation) {
+            // Parameters are copied: the batch operation might go away when it's cancelled.
+            mAction = batchOperation->action();
+            mFolderUids = (HashMap *) batchOperation->folderUids()->retain();
+            mDestFolder = (String *) MC_SAFE_RETAIN(batchOperation->destFolder());
+            mKind = batchOperation->kind();
+            mFlags = batchOperation->flags();
+            mCustomFlags = (Array *) MC_SAFE_RETAIN(batchOperation->customFlags());
+            mFolders = new Array();
+            mFolderErrors = new HashMap();
+            mUidMappings = new HashMap();
+        }
+
+        virtual ~IMAPBatchFoldersOperation() {
+            MC_SAFE_RELEASE(mUidMappings);
+            MC_SAFE_RELEASE(mFolderErrors);
+            MC_SAFE_RELEASE(mFolders);
+            MC_SAFE_RELEASE(mCustomFlags);
+            MC_SAFE_RELEASE(mDestFolder);
+            MC_SAFE_RELEASE(mFolderUids);
+        }
+
+        virtual Array * folders() {
+            return mFolders;
+        }
+
+        virtual HashMap * folderErrors() {
+            return mFolderErrors;
+        }
+
+        virtual HashMap * uidMappings() {
+            return mUidMappings;
+        }
+
+        virtual void main() {
+            ErrorCode firstError = ErrorNone;
+            ErrorCode connectionError = ErrorNone;
+
+            // The commands are pipelined even if the session doesn't pipeline the other requests.
+            IMAPSession * imapSession = session()->session();
+            unsigned int maximumPipelinedCommands = imapSession->maximumPipelinedCommands();
+            if (maximumPipelinedCommands < BATCH_PIPELINED_COMMANDS) {
+                imapSession->setMaximumPipelinedCommands(BATCH_PIPELINED_COMMANDS);
+            }
+
+            mc_foreacharray(String, folder, mFolders) {
+                ErrorCode error = ErrorNone;
+                HashMap * uidMapping = NULL;
+                IndexSet * uids = (IndexSet *) mFolderUids->objectForKey(folder);
+
+                if (isCancelled()) {
+                    break;
+                }
+
+                if (connectionError != ErrorNone) {
+                    // Don't wait for a timeout on each remaining folder.
+                    error = connectionError;
+                }
+                else {
+                    switch (mAction) {
+                        case IMAPBatchActionStoreFlags:
+                            imapSession->storeFlagsAndCustomFlagsByUID(folder, uids, mKind, mFlags, mCustomFlags, &error);
+                            break;
+                        case IMAPBatchActionCopy:
+                            imapSession->copyMessages(folder, uids, mDestFolder, &uidMapping, &error);
+                            break;
+                        case IMAPBatchActionMove:
+                            imapSession->moveMessages(folder, uids, mDestFolder, &uidMapping, &error);
+                            break;
+                    }
+                    if ((error == ErrorConnection) || (error == ErrorTLSNotAvailable) || (error == ErrorCertificate) ||
+                        (error == ErrorAuthentication)) {
+                        connectionError = error;
+                    }
+                }
+
+                if (error != ErrorNone) {
+                    mFolderErrors->setObjectForKey(folder, Value::valueWithIntValue(error));
+                    if (firstError == ErrorNone) {
+                        firstError = error;
+                    }
+                }
+                if (uidMapping != NULL) {
+                    mUidMappings->setObjectForKey(folder, uidMapping);
+                }
+            }
+            imapSession->setMaximumPipelinedCommands(maximumPipelinedCommands);
+
+            setError(firstError);
+        }
+
+    private:
+        IMAPBatchAction mAction;
+        HashMap * mFolderUids;
+        String * mDestFolder;
+        IMAPStoreFlagsRequestKind mKind;
+        MessageFlag mFlags;
+        Array * mCustomFlags;
+        Array * mFolders;
+        HashMap * mFolderErrors;
+        HashMap * mUidMappings;
+    };
+
+}
+
+IMAPBatchOperation::IMAPBatchOperation()
+{
+    mAction = IMAPBatchActionStoreFlags;
+    mFolderUids = NULL;
+    mDestFolder = NULL;
+    mKind = IMAPStoreFlagsRequestKindAdd;
+    mFlags = MessageFlagNone;
+    mCustomFlags = NULL;
+    mFolderErrors = NULL;
+    mUidMappings = NULL;
+    mOperations = new Array();
+    mFinishedCount = 0;
+    mRunning = false;
+}
+
+IMAPBatchOperation::~IMAPBatchOperation()
+{
+    MC_SAFE_RELEASE(mOperations);
+    MC_SAFE_RELEASE(mUidMappings);
+    MC_SAFE_RELEASE(mFolderErrors);
+    MC_SAFE_RELEASE(mCustomFlags);
+    MC_SAFE_RELEASE(mDestFolder);
+    MC_SAFE_RELEASE(mFolderUids);
+}
+
+void IMAPBatchOperation::setAction(IMAPBatchAction action)
+{
+    mAction = action;
+}
+
+IMAPBatchAction IMAPBatchOperation::action()
+{
+    return mAction;
+}
+
+void IMAPBatchOperation::setFolderUids(HashMap * folderUids)
+{
+    MC_SAFE_REPLACE_COPY(HashMap, mFolderUids, folderUids);
+}
+
+HashMap * IMAPBatchOperation::folderUids()
+{
+    return mFolderUids;
+}
+
+void IMAPBatchOperation::setDestFolder(String * destFolder)
+{
+    MC_SAFE_REPLACE_COPY(String, mDestFolder, destFolder);
+}
+
+String * IMAPBatchOperation::destFolder()
+{
+    return mDestFolder;
+}
+
+void IMAPBatchOperation::setKind(IMAPStoreFlagsRequestKind kind)
+{
+    mKind = kind;
+}
+
+IMAPStoreFlagsRequestKind IMAPBatchOperation::kind()
+{
+    return mKind;
+}
+
+void IMAPBatchOperation::setFlags(MessageFlag flags)
+{
+    mFlags = flags;
+}
+
+MessageFlag IMAPBatchOperation::flags()
+{
+    return mFlags;
+}
+
+void IMAPBatchOperation::setCustomFlags(Array * customFlags)
+{
+    MC_SAFE_REPLACE_RETAIN(Array, mCustomFlags, customFlags);
+}
+
+Array * IMAPBatchOperation::customFlags()
+{
+    return mCustomFlags;
+}
+
+HashMap * IMAPBatchOperation::folderErrors()
+{
+    return mFolderErrors;
+}
+
+HashMap * IMAPBatchOperation::uidMappings()
+{
+    return mUidMappings;
+}
+
+Array * IMAPBatchOperation::foldersPerConnection()
+{
+    if ((mOperations->count() == 0) && (mFolderUids != NULL)) {
+        Array * folders = Array::array();
+        mc_foreacharray(String, folder, mFolderUids->allKeys()) {
+            IndexSet * uids = (IndexSet *) mFolderUids->objectForKey(folder);
+            if (uids->count() > 0) {
+                folders->addObject(folder);
+            }
+        }
+
+        Array * sessions = mainSession()->sessionsForFolders(folders);
+        for(unsigned int i = 0 ; i < folders->count() ; i ++) {
+            String * folder = (String *) folders->objectAtIndex(i);
+            IMAPAsyncConnection * connection = (IMAPAsyncConnection *) sessions->objectAtIndex(i);
+            IMAPBatchFoldersOperation * op = NULL;
+            mc_foreacharray(IMAPBatchFoldersOperation, currentOp, mOperations) {
+                if (currentOp->session() == connection) {
+                    op = currentOp;
+                }
+            }
+            if (op == NULL) {
+                op = new IMAPBatchFoldersOperation(this);
+                op->setMainSession(mainSession());
+                op->setSession(connection);
+                mOperations->addObject(op);
+                op->release();
+            }
+            // The folder that is already selected goes first to save a SELECT.
+            if ((connection->lastFolder() != NULL) && connection->lastFolder()->isEqual(folder)) {
+                op->folders()->insertObject(0, folder);
+            }
+            else {
+                op->folders()->addObject(folder);
+            }
+        }
+    }
+
+    Array * result = Array::array();
+    mc_foreacharray(IMAPBatchFoldersOperation, op, mOperations) {
+        result->addObject(op->folders());
+    }
+    return result;
+}
+
+void IMAPBatchOperation::start()
+{
+    MC_SAFE_RELEASE(mFolderErrors);
+    MC_SAFE_RELEASE(mUidMappings);
+    mFolderErrors = new HashMap();
+    mUidMappings = new HashMap();
+
+    foldersPerConnection();
+    if (mOperations->count() == 0) {
+        // There's nothing to do: finish like any other operation, after start() returned.
+        retain();
+        performMethodOnCallbackThread((Object::Method) &IMAPBatchOperation::finishedOnCallbackThread, NULL);
+        return;
+    }
+
+    retain();
+    mRunning = true;
+    mc_foreacharray(IMAPBatchFoldersOperation, op, mOperations) {
+        op->session()->setLastFolder((String *) op->folders()->lastObject());
+#if __APPLE__
+        op->setCallbackDispatchQueue(this->callbackDispatchQueue());
+#endif
+        op->setCallback(this);
+        op->start();
+    }
+}
+
+void IMAPBatchOperation::finishedOnCallbackThread()
+{
+    if (!isCancelled() && (callback() != NULL)) {
+        callback()->operationFinished(this);
+    }
+    release();
+}
+
+void IMAPBatchOperation::cancel()
+{
+    IMAPOperation::cancel();
+    mc_foreacharray(IMAPOperation, op, mOperations) {
+        op->cancel();
+    }
+    // Cancelled operations won't notify us.
+    if (mRunning) {
+        mRunning = false;
+        release();
+    }
+}
+
+void IMAPBatchOperation::operationFinished(Operation * op)
+{
+    IMAPBatchFoldersOperation * foldersOp = (IMAPBatchFoldersOperation *) op;
+
+    mc_foreachhashmapKeyAndValue(String, folder, Value, folderError, foldersOp->folderErrors()) {
+        mFolderErrors->setObjectForKey(folder, folderError);
+    }
+    mc_foreachhashmapKeyAndValue(String, mappingFolder, HashMap, uidMapping, foldersOp->uidMappings()) {
+        mUidMappings->setObjectForKey(mappingFolder, uidMapping);
+    }
+    if ((error() == ErrorNone) && (foldersOp->error() != ErrorNone)) {
+        setError(foldersOp->error());
+    }
+
+    mFinishedCount ++;
+    if (mRunning && (mFinishedCount == mOperations->count())) {
+        mRunning = false;
+        if (callback() != NULL) {
+            callback()->operationFinished(this);
+        }
+        release();
+    }
+}
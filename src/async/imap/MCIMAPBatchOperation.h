@@ -0,0 +1,84 @@
+//
+//  MCIMAPBatchOperation.h
+//  mailcore2
+//
+//  Created by agent on 10/18/26.
+//  Copyright (c) 2026 MailCore. All rights reserved.
+//
+
+#ifndef MAILCORE_MCIMAPBATCHOPERATION_H
+
+#define MAILCORE_MCIMAPBATCHOPERATION_H
+
+#include <MailCore/MCIMAPOperation.h>
+
+#ifdef __cplusplus
+
+namespace mailcore {
+
+    // Runs the same action on messages spread over many folders.
+    // Folders are grouped per connection, preferring the connection that has the folder already selected,
+    // and each connection processes its folders in a row. The commands of each folder are pipelined.
+    class MAILCORE_EXPORT IMAPBatchOperation : public IMAPOperation, public OperationCallback {
+    public:
+        IMAPBatchOperation();
+        virtual ~IMAPBatchOperation();
+
+        virtual void setAction(IMAPBatchAction action);
+        virtual IMAPBatchAction action();
+
+        virtual void setFolderUids(HashMap * /* String -> IndexSet */ folderUids);
+        virtual HashMap * folderUids();
+
+        // Used by IMAPBatchActionCopy and IMAPBatchActionMove.
+        virtual void setDestFolder(String * destFolder);
+        virtual String * destFolder();
+
+        // Used by IMAPBatchActionStoreFlags.
+        virtual void setKind(IMAPStoreFlagsRequestKind kind);
+        virtual IMAPStoreFlagsRequestKind kind();
+
+        virtual void setFlags(MessageFlag flags);
+        virtual MessageFlag flags();
+
+        virtual void setCustomFlags(Array * customFlags);
+        virtual Array * customFlags();
+
+        // Result.
+        // error() is the first error that occurred.
+        virtual HashMap * /* String -> Value (ErrorCode) */ folderErrors();
+        virtual HashMap * /* String -> HashMap (uid mapping) */ uidMappings();
+
+    public: // subclass behavior
+        virtual void start();
+        virtual void cancel();
+
+    public: // OperationCallback
+        virtual void operationFinished(Operation * op);
+
+    public: // private
+        // Returns the folders to process, one array per connection, in the order they'll be processed.
+        // Folders without messages are skipped.
+        virtual Array * /* Array of String */ foldersPerConnection();
+
+    private:
+        IMAPBatchAction mAction;
+        HashMap * mFolderUids;
+        String * mDestFolder;
+        IMAPStoreFlagsRequestKind mKind;
+        MessageFlag mFlags;
+        Array * mCustomFlags;
+        HashMap * mFolderErrors;
+        HashMap * mUidMappings;
+        Array * mOperations;
+        unsigned int mFinishedCount;
+        bool mRunning;
+
+        void finishedOnCallbackThread();
+    };
+
+}
+
+#endif
+
+#endif
@@ -0,0 +1,45 @@
+//
+//  MCIMAPFetchFoldersWithStatusOperation.cpp
+//  mailcore2
+//
+//  Created by agent on 10/18/26.
+//  Copyright (c) 2026 MailCore. All rights reserved.
+//
+
+#include "MCIMAPFetchFoldersWithStatusOperation.h"
+
+#include "MCIMAPSession.h"
+#include "MCIMAPAsyncConnection.h"
+
+using namespace mailcore;
+
+IMAPFetchFoldersWithStatusOperation::IMAPFetchFoldersWithStatusOperation()
+{
+    mFolders = NULL;
+    mFolderStatuses = NULL;
+}
+
+IMAPFetchFoldersWithStatusOperation::~IMAPFetchFoldersWithStatusOperation()
+{
+    MC_SAFE_RELEASE(mFolders);
+    MC_SAFE_RELEASE(mFolderStatuses);
+}
+
+Array * IMAPFetchFoldersWithStatusOperation::folders()
+{
+    return mFolders;
+}
+
+HashMap * IMAPFetchFoldersWithStatusOperation::folderStatuses()
+{
+    return mFolderStatuses;
+}
+
+void IMAPFetchFoldersWithStatusOperation::main()
+{
+    ErrorCode error;
+    mFolders = session()->session()->fetchAllFoldersWithStatus(&mFolderStatuses, &error);
+    MC_SAFE_RETAIN(mFolders);
+    MC_SAFE_RETAIN(mFolderStatuses);
+    setError(error);
+}
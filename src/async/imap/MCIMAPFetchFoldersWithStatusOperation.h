@@ -0,0 +1,43 @@
+//
+//  MCIMAPFetchFoldersWithStatusOperation.h
+//  mailcore2
+//
+//  Created by agent on 10/18/26.
+//  Copyright (c) 2026 MailCore. All rights reserved.
+//
+
+#ifndef MAILCORE_MCIMAPFETCHFOLDERSWITHSTATUSOPERATION_H
+
+#define MAILCORE_MCIMAPFETCHFOLDERSWITHSTATUSOPERATION_H
+
+#include <MailCore/MCBaseTypes.h>
+#include <MailCore/MCIMAPOperation.h>
+
+#ifdef __cplusplus
+
+namespace mailcore {
+    
+    class MAILCORE_EXPORT IMAPFetchFoldersWithStatusOperation : public IMAPOperation {
+    public:
+        IMAPFetchFoldersWithStatusOperation();
+        virtual ~IMAPFetchFoldersWithStatusOperation();
+        
+        // Result.
+        virtual Array * /* IMAPFolder */ folders();
+        // Maps folder paths to IMAPFolderStatus.
+        virtual HashMap * folderStatuses();
+        
+    public: // subclass behavior
+        virtual void main();
+        
+    private:
+        Array * mFolders;
+        HashMap * mFolderStatuses;
+        
+    };
+    
+}
+
+#endif
+
+#endif
@@ -11,6 +11,7 @@
 #include "MCIMAPSession.h"
 #include "MCIMAPAsyncConnection.h"
 #include "MCIMAPSyncResult.h"
+#include "MCIMAPMessage.h"
 
 using namespace mailcore;
 
@@ -22,6 +23,10 @@ IMAPFetchMessagesOperation::IMAPFetchMessagesOperation()
     mVanishedMessages = NULL;
     mModSequenceValue = 0;
     mExtraHeaders = NULL;
+    mCoalescedIndexes = NULL;
+    mCoalescedMessages = NULL;
+    mCompletedIndexes = NULL;
+    mCompletedMessages = NULL;
 }
 
 IMAPFetchMessagesOperation::~IMAPFetchMessagesOperation()
@@ -30,6 +35,10 @@ IMAPFetchMessagesOperation::~IMAPFetchMessagesOperation()
     MC_SAFE_RELEASE(mMessages);
     MC_SAFE_RELEASE(mVanishedMessages);
     MC_SAFE_RELEASE(mExtraHeaders);
+    MC_SAFE_RELEASE(mCoalescedIndexes);
+    MC_SAFE_RELEASE(mCoalescedMessages);
+    MC_SAFE_RELEASE(mCompletedIndexes);
+    MC_SAFE_RELEASE(mCompletedMessages);
 }
 
 void IMAPFetchMessagesOperation::setFetchByUidEnabled(bool enabled)
@@ -80,6 +89,18 @@ Array * IMAPFetchMessagesOperation::extraHeaders() {
     return mExtraHeaders;
 }
 
+static Array * messagesMatchingIndexes(Array * messages, IndexSet * indexes, bool byUID)
+{
+    Array * result = Array::array();
+    mc_foreacharray(IMAPMessage, message, messages) {
+        uint32_t idx = byUID ? message->uid() : message->sequenceNumber();
+        if (indexes->containsIndex(idx)) {
+            result->addObject(message);
+        }
+    }
+    return result;
+}
+
 Array * IMAPFetchMessagesOperation::messages()
 {
     return mMessages;
@@ -90,9 +111,54 @@ IndexSet * IMAPFetchMessagesOperation::vanishedMessages()
     return mVanishedMessages;
 }
 
+IndexSet * IMAPFetchMessagesOperation::completedIndexes()
+{
+    return mCompletedIndexes;
+}
+
+Array * IMAPFetchMessagesOperation::completedMessages()
+{
+    return mCompletedMessages;
+}
+
+void IMAPFetchMessagesOperation::keepCompletedWindows(IndexSet * indexes)
+{
+    IMAPSession * imapSession = session()->session();
+    if (!mFetchByUidEnabled || (imapSession->lastFetchCompletedUids() == NULL)) {
+        return;
+    }
+    mCompletedIndexes = (IndexSet *) imapSession->lastFetchCompletedUids()->copy();
+    mCompletedIndexes->intersectsIndexSet(indexes);
+    mCompletedMessages = messagesMatchingIndexes(imapSession->lastFetchCompletedMessages(), indexes, true);
+    mCompletedMessages->retain();
+}
+
+
 void IMAPFetchMessagesOperation::main()
 {
     ErrorCode error;
+    if (mCoalescedIndexes != NULL) {
+        // Fetch the merged range, then keep only the requested messages.
+        if (mFetchByUidEnabled) {
+            mCoalescedMessages = session()->session()->fetchMessagesByUIDWithExtraHeaders(folder(), mKind, mCoalescedIndexes, this,
+                                                                                          mExtraHeaders, &error);
+        }
+        else {
+            mCoalescedMessages = session()->session()->fetchMessagesByNumberWithExtraHeaders(folder(), mKind, mCoalescedIndexes, this,
+                                                                                             mExtraHeaders, &error);
+        }
+        MC_SAFE_RETAIN(mCoalescedMessages);
+        if (mCoalescedMessages != NULL) {
+            mMessages = messagesMatchingIndexes(mCoalescedMessages, mIndexes, mFetchByUidEnabled);
+            MC_SAFE_RETAIN(mMessages);
+        }
+        else {
+            keepCompletedWindows(mIndexes);
+        }
+        setError(error);
+        return;
+    }
+    
     if (mFetchByUidEnabled) {
         if (mModSequenceValue != 0) {
             IMAPSyncResult * syncResult;
@@ -116,5 +182,68 @@ void IMAPFetchMessagesOperation::main()
     }
     MC_SAFE_RETAIN(mMessages);
     MC_SAFE_RETAIN(mVanishedMessages);
+    if (error != ErrorNone) {
+        keepCompletedWindows(mIndexes);
+    }
     setError(error);
 }
+
+static bool isEqualOrNull(Object * a, Object * b)
+{
+    if ((a == NULL) || (b == NULL)) {
+        return (a == NULL) && (b == NULL);
+    }
+    return a->isEqual(b);
+}
+
+bool IMAPFetchMessagesOperation::canCoalesceWithOperation(IMAPOperation * otherOperation)
+{
+    if (!otherOperation->className()->isEqual(className())) {
+        return false;
+    }
+    IMAPFetchMessagesOperation * op = (IMAPFetchMessagesOperation *) otherOperation;
+    if ((folder() == NULL) || !folder()->isEqual(op->folder())) {
+        return false;
+    }
+    // Sync requests also return vanished messages for the whole range: don't merge them.
+    if ((mModSequenceValue != 0) || (op->mModSequenceValue != 0)) {
+        return false;
+    }
+    if ((mFetchByUidEnabled != op->mFetchByUidEnabled) || (mKind != op->mKind)) {
+        return false;
+    }
+    if (!isEqualOrNull(mExtraHeaders, op->mExtraHeaders)) {
+        return false;
+    }
+    if ((mIndexes == NULL) || (op->mIndexes == NULL)) {
+        return false;
+    }
+    
+    // Only merge overlapping or adjacent ranges so that the merged request doesn't fetch
+    // messages that nobody asked for.
+    IndexSet * indexes = (mCoalescedIndexes != NULL) ? mCoalescedIndexes : mIndexes;
+    IndexSet * merged = (IndexSet *) indexes->copy();
+    merged->addIndexSet(op->mIndexes);
+    bool result = (merged->rangesCount() <= indexes->rangesCount());
+    merged->release();
+    return result;
+}
+
+void IMAPFetchMessagesOperation::coalesceOperation(IMAPOperation * otherOperation)
+{
+    IMAPFetchMessagesOperation * op = (IMAPFetchMessagesOperation *) otherOperation;
+    if (mCoalescedIndexes == NULL) {
+        mCoalescedIndexes = (IndexSet *) mIndexes->copy();
+    }
+    mCoalescedIndexes->addIndexSet(op->mIndexes);
+}
+
+void IMAPFetchMessagesOperation::applyResultToCoalescedOperation(IMAPOperation * otherOperation)
+{
+    IMAPFetchMessagesOperation * op = (IMAPFetchMessagesOperation *) otherOperation;
+    if (mCoalescedMessages == NULL) {
+        return;
+    }
+    Array * messages = messagesMatchingIndexes(mCoalescedMessages, op->mIndexes, mFetchByUidEnabled);
+    MC_SAFE_REPLACE_RETAIN(Array, op->mMessages, messages);
+}
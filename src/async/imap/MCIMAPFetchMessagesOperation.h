@@ -40,8 +40,16 @@ namespace mailcore {
         virtual Array * /* IMAPMessage */ messages();
         virtual IndexSet * vanishedMessages();
         
+        // When a windowed fetch by UID failed, the UIDs of the windows that were completed and their messages.
+        // A new operation on the other UIDs resumes the fetch. See IMAPSession::lastFetchCompletedUids().
+        virtual IndexSet * completedIndexes();
+        virtual Array * /* IMAPMessage */ completedMessages();
+        
     public: // subclass behavior
         virtual void main();
+        virtual bool canCoalesceWithOperation(IMAPOperation * otherOperation);
+        virtual void coalesceOperation(IMAPOperation * otherOperation);
+        virtual void applyResultToCoalescedOperation(IMAPOperation * otherOperation);
         
     private:
         bool mFetchByUidEnabled;
@@ -51,7 +59,12 @@ namespace mailcore {
         Array * /* IMAPMessage */ mMessages;
         IndexSet * mVanishedMessages;
         uint64_t mModSequenceValue;
+        IndexSet * mCoalescedIndexes;
+        Array * /* IMAPMessage */ mCoalescedMessages;
+        IndexSet * mCompletedIndexes;
+        Array * /* IMAPMessage */ mCompletedMessages;
         
+        void keepCompletedWindows(IndexSet * indexes);
     };
     
 }
@@ -56,3 +56,16 @@ void IMAPFolderInfoOperation::main()
     setError(error);
 }
 
+bool IMAPFolderInfoOperation::canCoalesceWithOperation(IMAPOperation * otherOperation)
+{
+    if (!otherOperation->className()->isEqual(className())) {
+        return false;
+    }
+    return (folder() != NULL) && folder()->isEqual(otherOperation->folder());
+}
+
+void IMAPFolderInfoOperation::applyResultToCoalescedOperation(IMAPOperation * otherOperation)
+{
+    IMAPFolderInfoOperation * op = (IMAPFolderInfoOperation *) otherOperation;
+    MC_SAFE_REPLACE_RETAIN(IMAPFolderInfo, op->mInfo, mInfo);
+}
@@ -27,6 +27,8 @@ namespace mailcore {
 
     public: // subclass behavior
         virtual void main();
+        virtual bool canCoalesceWithOperation(IMAPOperation * otherOperation);
+        virtual void applyResultToCoalescedOperation(IMAPOperation * otherOperation);
         
     private:
 
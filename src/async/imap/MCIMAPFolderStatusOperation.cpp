@@ -49,3 +49,16 @@ IMAPFolderStatus * IMAPFolderStatusOperation::status()
     return mStatus;
 }
 
+bool IMAPFolderStatusOperation::canCoalesceWithOperation(IMAPOperation * otherOperation)
+{
+    if (!otherOperation->className()->isEqual(className())) {
+        return false;
+    }
+    return (folder() != NULL) && folder()->isEqual(otherOperation->folder());
+}
+
+void IMAPFolderStatusOperation::applyResultToCoalescedOperation(IMAPOperation * otherOperation)
+{
+    IMAPFolderStatusOperation * op = (IMAPFolderStatusOperation *) otherOperation;
+    MC_SAFE_REPLACE_RETAIN(IMAPFolderStatus, op->mStatus, mStatus);
+}
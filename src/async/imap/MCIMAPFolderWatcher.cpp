@@ -0,0 +1,301 @@
+//
+//  MCIMAPFolderWatcher.cpp
+//  mailcore2
+//
+//  Created by agent on 10/18/26.
+//  Copyright (c) 2026 MailCore. All rights reserved.
+//
+
+#include "MCIMAPFolderWatcher.h"
+
+#include "MCIMAPSession.h"
+#include "MCIMAPFolderWatcherCallback.h"
+#include "MCOperation.h"
+#include "MCOperationQueue.h"
+
+using namespace mailcore;
+
+namespace mailcore {
+    // Runs the blocking commands of a watcher: the setup before the connection is read by the event loop,
+    // and the shutdown after.
+    class IMAPFolderWatcherOperation : public Operation {
+    public:
+        IMAPFolderWatcherOperation(IMAPFolderWatcher * watcher, bool stopping) {
+            mWatcher = watcher;
+            mWatcher->retain();
+            mStopping = stopping;
+            mEvents = NULL;
+            mFd = -1;
+            mError = ErrorNone;
+        }
+
+        virtual ~IMAPFolderWatcherOperation() {
+            MC_SAFE_RELEASE(mEvents);
+            MC_SAFE_RELEASE(mWatcher);
+        }
+
+        virtual void main() {
+            if (mStopping) {
+                mWatcher->session()->stopNotify(&mError);
+                mWatcher->session()->disconnect();
+                return;
+            }
+            mEvents = mWatcher->session()->startNotify(mWatcher->folders(), &mError);
+            MC_SAFE_RETAIN(mEvents);
+            if (mError == ErrorNone) {
+                mFd = mWatcher->session()->notifyFileDescriptor();
+            }
+        }
+
+        bool isStopping() {
+            return mStopping;
+        }
+
+        Array * events() {
+            return mEvents;
+        }
+
+        int fd() {
+            return mFd;
+        }
+
+        ErrorCode error() {
+            return mError;
+        }
+
+    private:
+        IMAPFolderWatcher * mWatcher;
+        bool mStopping;
+        Array * mEvents;
+        int mFd;
+        ErrorCode mError;
+    };
+}
+
+static OperationQueue * watchersQueue()
+{
+    static OperationQueue * queue = new OperationQueue();
+    return queue;
+}
+
+void IMAPFolderWatcher::init()
+{
+    mSession = NULL;
+    mFolders = NULL;
+    mCallback = NULL;
+    mKeepAliveInterval = 300;
+    mLastKeepAliveDate = 0;
+    mStarted = false;
+    mFd = -1;
+    pthread_mutex_init(&mLock, NULL);
+}
+
+IMAPFolderWatcher::IMAPFolderWatcher()
+{
+    init();
+}
+
+IMAPFolderWatcher::~IMAPFolderWatcher()
+{
+    pthread_mutex_destroy(&mLock);
+    MC_SAFE_RELEASE(mFolders);
+    MC_SAFE_RELEASE(mSession);
+}
+
+void IMAPFolderWatcher::setSession(IMAPSession * session)
+{
+    MC_SAFE_REPLACE_RETAIN(IMAPSession, mSession, session);
+}
+
+IMAPSession * IMAPFolderWatcher::session()
+{
+    return mSession;
+}
+
+void IMAPFolderWatcher::setFolders(Array * folders)
+{
+    MC_SAFE_REPLACE_COPY(Array, mFolders, folders);
+}
+
+Array * IMAPFolderWatcher::folders()
+{
+    return mFolders;
+}
+
+void IMAPFolderWatcher::setCallback(IMAPFolderWatcherCallback * callback)
+{
+    mCallback = callback;
+}
+
+IMAPFolderWatcherCallback * IMAPFolderWatcher::callback()
+{
+    return mCallback;
+}
+
+void IMAPFolderWatcher::setKeepAliveInterval(time_t interval)
+{
+    mKeepAliveInterval = interval;
+}
+
+time_t IMAPFolderWatcher::keepAliveInterval()
+{
+    return mKeepAliveInterval;
+}
+
+bool IMAPFolderWatcher::isStarted()
+{
+    return mStarted;
+}
+
+void IMAPFolderWatcher::start()
+{
+    if (mStarted) {
+        return;
+    }
+    mStarted = true;
+    IMAPFolderWatcherOperation * op = new IMAPFolderWatcherOperation(this, false);
+    op->setCallback(this);
+    watchersQueue()->addOperation(op);
+    op->release();
+}
+
+void IMAPFolderWatcher::stop()
+{
+    if (!mStarted) {
+        return;
+    }
+    mStarted = false;
+    // If the setup is still running, the connection will be closed once it's done.
+    if (unregisterFileDescriptor()) {
+        IMAPFolderWatcherOperation * op = new IMAPFolderWatcherOperation(this, true);
+        watchersQueue()->addOperation(op);
+        op->release();
+        release(); // (1)
+    }
+}
+
+void IMAPFolderWatcher::operationFinished(Operation * op)
+{
+    IMAPFolderWatcherOperation * watcherOp = (IMAPFolderWatcherOperation *) op;
+    if (watcherOp->isStopping()) {
+        return;
+    }
+    if (!mStarted) {
+        // Stopped during the setup.
+        IMAPFolderWatcherOperation * stopOp = new IMAPFolderWatcherOperation(this, true);
+        watchersQueue()->addOperation(stopOp);
+        stopOp->release();
+        return;
+    }
+    if (watcherOp->error() != ErrorNone) {
+        mStarted = false;
+        if (mCallback != NULL) {
+            mCallback->folderWatcherFailed(this, watcherOp->error());
+        }
+        return;
+    }
+
+    if ((watcherOp->events()->count() > 0) && (mCallback != NULL)) {
+        mCallback->folderWatcherReceivedEvents(this, watcherOp->events());
+    }
+    mLastKeepAliveDate = time(NULL);
+    pthread_mutex_lock(&mLock);
+    mFd = watcherOp->fd();
+    pthread_mutex_unlock(&mLock);
+    retain(); // (1)
+    EventLoop::sharedEventLoop()->addFileDescriptor(watcherOp->fd(), this);
+}
+
+// Returns true if the file descriptor was registered. The caller should then balance the retain (1).
+bool IMAPFolderWatcher::unregisterFileDescriptor()
+{
+    pthread_mutex_lock(&mLock);
+    int fd = mFd;
+    mFd = -1;
+    pthread_mutex_unlock(&mLock);
+    if (fd == -1) {
+        return false;
+    }
+    EventLoop::sharedEventLoop()->removeFileDescriptor(fd);
+    return true;
+}
+
+void IMAPFolderWatcher::eventLoopFileDescriptorReady(EventLoop * loop, int fd)
+{
+    readEvents(loop, fd);
+}
+
+// The keep-alive commands that could not be sent yet are sent when the connection is writable.
+void IMAPFolderWatcher::eventLoopFileDescriptorWritable(EventLoop * loop, int fd)
+{
+    readEvents(loop, fd);
+}
+
+// Called on the thread of the event loop.
+void IMAPFolderWatcher::readEvents(EventLoop * loop, int fd)
+{
+    ErrorCode error;
+    Array * events = mSession->readNotifyEvents(&error);
+    if (error != ErrorNone) {
+        failed(error);
+        return;
+    }
+    loop->setWaitsForWritability(fd, mSession->notifyWaitsForWritability());
+    if (events->count() == 0) {
+        return;
+    }
+    events->retain();
+    retain(); // (2)
+    performMethodOnMainThread((Object::Method) &IMAPFolderWatcher::eventsReceivedOnMainThread, events, false);
+}
+
+void IMAPFolderWatcher::eventLoopTimerFired(EventLoop * loop)
+{
+    if (time(NULL) - mLastKeepAliveDate < mKeepAliveInterval) {
+        return;
+    }
+    mLastKeepAliveDate = time(NULL);
+    ErrorCode error;
+    mSession->notifyKeepAlive(&error);
+    if (error != ErrorNone) {
+        failed(error);
+        return;
+    }
+    pthread_mutex_lock(&mLock);
+    int fd = mFd;
+    pthread_mutex_unlock(&mLock);
+    loop->setWaitsForWritability(fd, mSession->notifyWaitsForWritability());
+}
+
+// Called on the thread of the event loop.
+void IMAPFolderWatcher::failed(ErrorCode error)
+{
+    retain(); // (3)
+    performMethodOnMainThread((Object::Method) &IMAPFolderWatcher::failedOnMainThread, (void *) (long) error, false);
+    if (unregisterFileDescriptor()) {
+        mSession->disconnect();
+        release(); // (1)
+    }
+}
+
+void IMAPFolderWatcher::eventsReceivedOnMainThread(void * context)
+{
+    Array * events = (Array *) context;
+    if (mStarted && (mCallback != NULL)) {
+        mCallback->folderWatcherReceivedEvents(this, events);
+    }
+    events->release();
+    release(); // (2)
+}
+
+void IMAPFolderWatcher::failedOnMainThread(void * context)
+{
+    ErrorCode error = (ErrorCode) (long) context;
+    if (mStarted) {
+        mStarted = false;
+        if (mCallback != NULL) {
+            mCallback->folderWatcherFailed(this, error);
+        }
+    }
+    release(); // (3)
+}
@@ -0,0 +1,80 @@
+//
+//  MCIMAPFolderWatcher.h
+//  mailcore2
+//
+//  Created by agent on 10/18/26.
+//  Copyright (c) 2026 MailCore. All rights reserved.
+//
+
+#ifndef MAILCORE_MCIMAPFOLDERWATCHER_H
+
+#define MAILCORE_MCIMAPFOLDERWATCHER_H
+
+#include <MailCore/MCBaseTypes.h>
+#include <MailCore/MCEventLoop.h>
+#include <MailCore/MCOperationCallback.h>
+
+#ifdef __cplusplus
+
+namespace mailcore {
+    
+    class IMAPSession;
+    class IMAPFolderWatcherCallback;
+    
+    // Watches folders for changes on a dedicated connection, using NOTIFY when the server supports it and
+    // IDLE on a single folder otherwise.
+    // The connections of all the watchers are read by the thread of EventLoop::sharedEventLoop() instead of
+    // one blocked thread per folder. Connecting and logging in happen on a queue shared by the watchers.
+    class MAILCORE_EXPORT IMAPFolderWatcher : public Object, public EventLoopCallback, public OperationCallback {
+    public:
+        IMAPFolderWatcher();
+        virtual ~IMAPFolderWatcher();
+        
+        // The session shouldn't be used for anything else.
+        virtual void setSession(IMAPSession * session);
+        virtual IMAPSession * session();
+        
+        virtual void setFolders(Array * /* String */ folders);
+        virtual Array * /* String */ folders();
+        
+        virtual void setCallback(IMAPFolderWatcherCallback * callback);
+        virtual IMAPFolderWatcherCallback * callback();
+        
+        // Delay in seconds between the commands that keep the connection alive. Default is 300 seconds.
+        virtual void setKeepAliveInterval(time_t interval);
+        virtual time_t keepAliveInterval();
+        
+        // Should be called on the main thread.
+        virtual void start();
+        virtual void stop();
+        virtual bool isStarted();
+        
+    public: // subclass behavior
+        virtual void eventLoopFileDescriptorReady(EventLoop * loop, int fd);
+        virtual void eventLoopFileDescriptorWritable(EventLoop * loop, int fd);
+        virtual void eventLoopTimerFired(EventLoop * loop);
+        virtual void operationFinished(Operation * op);
+        
+    private:
+        IMAPSession * mSession;
+        Array * mFolders;
+        IMAPFolderWatcherCallback * mCallback;
+        time_t mKeepAliveInterval;
+        time_t mLastKeepAliveDate;
+        bool mStarted;
+        pthread_mutex_t mLock;
+        int mFd;
+        
+        void init();
+        bool unregisterFileDescriptor();
+        void readEvents(EventLoop * loop, int fd);
+        void failed(ErrorCode error);
+        void eventsReceivedOnMainThread(void * context);
+        void failedOnMainThread(void * context);
+    };
+    
+}
+
+#endif
+
+#endif
@@ -0,0 +1,36 @@
+//
+//  MCIMAPFolderWatcherCallback.h
+//  mailcore2
+//
+//  Created by agent on 10/18/26.
+//  Copyright (c) 2026 MailCore. All rights reserved.
+//
+
+#ifndef MAILCORE_MCIMAPFOLDERWATCHERCALLBACK_H
+
+#define MAILCORE_MCIMAPFOLDERWATCHERCALLBACK_H
+
+#include <MailCore/MCUtils.h>
+#include <MailCore/MCMessageConstants.h>
+
+#ifdef __cplusplus
+
+namespace mailcore {
+    
+    class IMAPFolderWatcher;
+    class Array;
+    
+    // The methods are called on the main thread.
+    class MAILCORE_EXPORT IMAPFolderWatcherCallback {
+    public:
+        // The first events are the status of the folders when NOTIFY is used.
+        virtual void folderWatcherReceivedEvents(IMAPFolderWatcher * watcher, Array * /* IMAPNotifyEvent */ events) {};
+        // The watcher is stopped. It can be started again.
+        virtual void folderWatcherFailed(IMAPFolderWatcher * watcher, ErrorCode error) {};
+    };
+    
+}
+
+#endif
+
+#endif
@@ -25,10 +25,17 @@ IMAPOperation::IMAPOperation()
     mError = ErrorNone;
     mFolder = NULL;
     mUrgent = false;
+    mCoalescedOperations = NULL;
+    mCoalescingClosed = false;
+    mDeferredCancel = false;
+    mMainRunning = false;
+    pthread_mutex_init(&mCoalescingLock, NULL);
 }
 
 IMAPOperation::~IMAPOperation()
 {
+    pthread_mutex_destroy(&mCoalescingLock);
+    MC_SAFE_RELEASE(mCoalescedOperations);
     MC_SAFE_RELEASE(mMainSession);
     MC_SAFE_RELEASE(mFolder);
     MC_SAFE_RELEASE(mSession);
@@ -106,6 +113,13 @@ ErrorCode IMAPOperation::error()
 
 void IMAPOperation::start()
 {
+    if ((timing() == NULL) && (mMainSession != NULL) && mMainSession->isOperationTimingEnabled()) {
+        OperationTiming * operationTiming = new OperationTiming();
+        operationTiming->setName(className());
+        operationTiming->setStatistics(mMainSession->operationTimingStatistics());
+        setTiming(operationTiming);
+        operationTiming->release();
+    }
     if (session() == NULL) {
         IMAPAsyncConnection * connection = mMainSession->sessionForFolder(mFolder, mUrgent);
         setSession(connection);
@@ -113,6 +127,134 @@ void IMAPOperation::start()
     session()->runOperation(this);
 }
 
+void IMAPOperation::cancel()
+{
+    bool deferred = false;
+    
+    // Operations attached to this one still wait for the shared result: keep running
+    // and only skip the callback of this operation.
+    pthread_mutex_lock(&mCoalescingLock);
+    if (mCoalescedOperations != NULL) {
+        mc_foreacharray(IMAPOperation, otherOperation, mCoalescedOperations) {
+            if (!otherOperation->isCancelled()) {
+                deferred = true;
+            }
+        }
+    }
+    if (deferred) {
+        mDeferredCancel = true;
+    }
+    pthread_mutex_unlock(&mCoalescingLock);
+    
+    if (!deferred) {
+        Operation::cancel();
+        
+        // Interrupt the request only when it's this operation that is using the connection.
+        pthread_mutex_lock(&mCoalescingLock);
+        if (mMainRunning) {
+            mSession->session()->cancelCurrentOperation();
+        }
+        pthread_mutex_unlock(&mCoalescingLock);
+    }
+}
+
+bool IMAPOperation::canCoalesceWithOperation(IMAPOperation * otherOperation)
+{
+    return false;
+}
+
+void IMAPOperation::coalesceOperation(IMAPOperation * otherOperation)
+{
+}
+
+void IMAPOperation::applyResultToCoalescedOperation(IMAPOperation * otherOperation)
+{
+}
+
+bool IMAPOperation::addCoalescedOperation(IMAPOperation * otherOperation)
+{
+    bool added = false;
+    
+    pthread_mutex_lock(&mCoalescingLock);
+    if (!mCoalescingClosed && !mDeferredCancel && !isCancelled() && canCoalesceWithOperation(otherOperation)) {
+        coalesceOperation(otherOperation);
+        if (mCoalescedOperations == NULL) {
+            mCoalescedOperations = new Array();
+        }
+        mCoalescedOperations->addObject(otherOperation);
+        added = true;
+    }
+    pthread_mutex_unlock(&mCoalescingLock);
+    
+    return added;
+}
+
+void IMAPOperation::cancelCoalescedOperations()
+{
+    pthread_mutex_lock(&mCoalescingLock);
+    if (mCoalescedOperations != NULL) {
+        mc_foreacharray(IMAPOperation, otherOperation, mCoalescedOperations) {
+            otherOperation->cancel();
+        }
+    }
+    pthread_mutex_unlock(&mCoalescingLock);
+}
+
+void IMAPOperation::notifyCoalescedOperations()
+{
+    Array * coalescedOperations;
+    
+    pthread_mutex_lock(&mCoalescingLock);
+    coalescedOperations = mCoalescedOperations;
+    mCoalescedOperations = NULL;
+    pthread_mutex_unlock(&mCoalescingLock);
+    
+    if (coalescedOperations == NULL) {
+        return;
+    }
+    
+    mSession->coalescedOperationsFinished(this);
+    mc_foreacharray(IMAPOperation, otherOperation, coalescedOperations) {
+        if (otherOperation->isCancelled()) {
+            continue;
+        }
+        otherOperation->setError(mError);
+        applyResultToCoalescedOperation(otherOperation);
+        otherOperation->retain();
+        otherOperation->performMethodOnCallbackThread((Object::Method) &IMAPOperation::coalescedOperationFinishedOnCallbackThread, NULL);
+    }
+    coalescedOperations->release();
+}
+
+// Same as the end of an operation run by the queue, on the callback thread of the attached operation.
+void IMAPOperation::coalescedOperationFinishedOnCallbackThread()
+{
+    afterMain();
+    if (!isCancelled()) {
+        if (callback() != NULL) {
+            callback()->operationFinished(this);
+        }
+        if (timing() != NULL) {
+            timing()->markCallbackFinished();
+        }
+    }
+    release();
+}
+
+// Returns the attached operations that still expect a result. The caller needs to release it.
+Array * IMAPOperation::coalescedOperationsForProgress()
+{
+    Array * result = NULL;
+    
+    pthread_mutex_lock(&mCoalescingLock);
+    if (mCoalescedOperations != NULL) {
+        result = (Array *) mCoalescedOperations->copy();
+    }
+    pthread_mutex_unlock(&mCoalescingLock);
+    
+    return result;
+}
+
 struct progressContext {
     unsigned int current;
     unsigned int maximum;
@@ -120,7 +262,15 @@ struct progressContext {
 
 void IMAPOperation::bodyProgress(IMAPSession * session, unsigned int current, unsigned int maximum)
 {
-    if (isCancelled())
+    Array * coalescedOperations = coalescedOperationsForProgress();
+    if (coalescedOperations != NULL) {
+        mc_foreacharray(IMAPOperation, otherOperation, coalescedOperations) {
+            otherOperation->bodyProgress(session, current, maximum);
+        }
+        coalescedOperations->release();
+    }
+    
+    if (isCancelled() || mDeferredCancel)
         return;
     
     struct progressContext * context = (struct progressContext *) calloc(sizeof(* context), 1);
@@ -132,12 +282,13 @@ void IMAPOperation::bodyProgress(IMAPSession * session, unsigned int current, un
 
 void IMAPOperation::bodyProgressOnMainThread(void * ctx)
 {
+    struct progressContext * context = (struct progressContext *) ctx;
     if (isCancelled()) {
+        free(context);
         release();
         return;
     }
     
-    struct progressContext * context = (struct progressContext *) ctx;
     if (mImapCallback != NULL) {
         mImapCallback->bodyProgress(this, context->current, context->maximum);
     }
@@ -147,7 +298,15 @@ void IMAPOperation::bodyProgressOnMainThread(void * ctx)
 
 void IMAPOperation::itemsProgress(IMAPSession * session, unsigned int current, unsigned int maximum)
 {
-    if (isCancelled())
+    Array * coalescedOperations = coalescedOperationsForProgress();
+    if (coalescedOperations != NULL) {
+        mc_foreacharray(IMAPOperation, otherOperation, coalescedOperations) {
+            otherOperation->itemsProgress(session, current, maximum);
+        }
+        coalescedOperations->release();
+    }
+    
+    if (isCancelled() || mDeferredCancel)
         return;
     
     struct progressContext * context = (struct progressContext *) calloc(sizeof(* context), 1);
@@ -159,12 +318,13 @@ void IMAPOperation::itemsProgress(IMAPSession * session, unsigned int current, u
 
 void IMAPOperation::itemsProgressOnMainThread(void * ctx)
 {
+    struct progressContext * context = (struct progressContext *) ctx;
     if (isCancelled()) {
+        free(context);
         release();
         return;
     }
     
-    struct progressContext * context = (struct progressContext *) ctx;
     if (mImapCallback != NULL) {
         mImapCallback->itemProgress(this, context->current, context->maximum);
     }
@@ -174,10 +334,58 @@ void IMAPOperation::itemsProgressOnMainThread(void * ctx)
 
 void IMAPOperation::beforeMain()
 {
+    // The request is about to be sent: nothing can be merged into it anymore.
+    pthread_mutex_lock(&mCoalescingLock);
+    mCoalescingClosed = true;
+    mMainRunning = true;
+    pthread_mutex_unlock(&mCoalescingLock);
+    
+    if (mSession != NULL) {
+        mSession->session()->setOperationTiming(timing());
+    }
+}
+
+// A cancellation that happened after the previous operation was done is dropped.
+void IMAPOperation::mainWillStart()
+{
+    mSession->session()->operationWillStart();
+    
+    // The attached operations are timed as if they had run the request themselves.
+    pthread_mutex_lock(&mCoalescingLock);
+    if (mCoalescedOperations != NULL) {
+        mc_foreacharray(IMAPOperation, otherOperation, mCoalescedOperations) {
+            if (otherOperation->timing() != NULL) {
+                otherOperation->timing()->markStarted();
+            }
+        }
+    }
+    pthread_mutex_unlock(&mCoalescingLock);
+}
+
+void IMAPOperation::mainFinished()
+{
+    pthread_mutex_lock(&mCoalescingLock);
+    mMainRunning = false;
+    if (mCoalescedOperations != NULL) {
+        mc_foreacharray(IMAPOperation, otherOperation, mCoalescedOperations) {
+            if (otherOperation->timing() != NULL) {
+                otherOperation->timing()->markFinished();
+            }
+        }
+    }
+    pthread_mutex_unlock(&mCoalescingLock);
+    
+    // An interrupted connection is dropped here: the next operation opens a new one.
+    mSession->session()->cancelledOperationFinished();
 }
 
 void IMAPOperation::afterMain()
 {
+    notifyCoalescedOperations();
+    if (mDeferredCancel) {
+        // The queue checks the cancelled state right after afterMain() and won't notify the callback.
+        Operation::cancel();
+    }
     retain();
     performMethodOnMainThread((Object::Method) &IMAPOperation::afterMainOnMainThread, NULL);
 }
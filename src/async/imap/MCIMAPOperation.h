@@ -42,15 +42,31 @@ namespace mailcore {
         virtual IMAPOperationCallback * imapCallback();
         
         virtual void beforeMain();
+        virtual void mainWillStart();
+        virtual void mainFinished();
         virtual void afterMain();
         virtual void afterMainOnMainThread();
         
         virtual void start();
+        virtual void cancel();
         
         // Result.
         virtual void setError(ErrorCode error);
         virtual ErrorCode error();
         
+    public: // subclass behavior
+        // Coalescing: when enabled on the session, an operation queued right after a compatible pending
+        // operation on the same connection is not sent to the server. It's attached to the pending one,
+        // which runs the merged request, then fans the result out. The progress of the merged request
+        // is also reported to the attached operations.
+        virtual bool canCoalesceWithOperation(IMAPOperation * otherOperation);
+        virtual void coalesceOperation(IMAPOperation * otherOperation);
+        virtual void applyResultToCoalescedOperation(IMAPOperation * otherOperation);
+        
+    public: // private
+        virtual bool addCoalescedOperation(IMAPOperation * otherOperation);
+        virtual void cancelCoalescedOperations();
+        
     private:
         IMAPAsyncSession * mMainSession;
         IMAPAsyncConnection * mSession;
@@ -58,6 +74,15 @@ namespace mailcore {
         IMAPOperationCallback * mImapCallback;
         ErrorCode mError;
         bool mUrgent;
+        Array * mCoalescedOperations;
+        bool mCoalescingClosed;
+        bool mDeferredCancel;
+        bool mMainRunning;
+        pthread_mutex_t mCoalescingLock;
+        
+        void notifyCoalescedOperations();
+        void coalescedOperationFinishedOnCallbackThread();
+        Array * coalescedOperationsForProgress();
         
     private:
         virtual void bodyProgress(IMAPSession * session, unsigned int current, unsigned int maximum);
@@ -11,6 +11,7 @@
 #include "MCIMAPSession.h"
 #include "MCIMAPAsyncConnection.h"
 #include "MCIMAPSearchExpression.h"
+#include "MCIMAPSearchResult.h"
 
 using namespace mailcore;
 
@@ -19,7 +20,11 @@ IMAPSearchOperation::IMAPSearchOperation()
     mKind = IMAPSearchKindNone;
     mSearchString = NULL;
     mExpression = NULL;
+    mReturnOptions = (IMAPSearchReturnOption) 0;
+    mPartialRange = RangeEmpty;
+    mPartialFromEnd = false;
     mUids = NULL;
+    mSearchResult = NULL;
 }
 
 IMAPSearchOperation::~IMAPSearchOperation()
@@ -27,6 +32,7 @@ IMAPSearchOperation::~IMAPSearchOperation()
     MC_SAFE_RELEASE(mSearchString);
     MC_SAFE_RELEASE(mExpression);
     MC_SAFE_RELEASE(mUids);
+    MC_SAFE_RELEASE(mSearchResult);
 }
 
 void IMAPSearchOperation::setSearchKind(IMAPSearchKind kind)
@@ -59,21 +65,69 @@ IMAPSearchExpression * IMAPSearchOperation::searchExpression()
     return mExpression;
 }
 
+void IMAPSearchOperation::setReturnOptions(IMAPSearchReturnOption options)
+{
+    mReturnOptions = options;
+}
+
+IMAPSearchReturnOption IMAPSearchOperation::returnOptions()
+{
+    return mReturnOptions;
+}
+
+void IMAPSearchOperation::setPartialRange(Range positions)
+{
+    mPartialRange = positions;
+}
+
+Range IMAPSearchOperation::partialRange()
+{
+    return mPartialRange;
+}
+
+void IMAPSearchOperation::setPartialFromEnd(bool fromEnd)
+{
+    mPartialFromEnd = fromEnd;
+}
+
+bool IMAPSearchOperation::isPartialFromEnd()
+{
+    return mPartialFromEnd;
+}
+
 IndexSet * IMAPSearchOperation::uids()
 {
     return mUids;
 }
 
+IMAPSearchResult * IMAPSearchOperation::searchResult()
+{
+    return mSearchResult;
+}
+
 void IMAPSearchOperation::main()
 {
     ErrorCode error;
-    if (mExpression != NULL) {
+    if (mPartialRange.location != UINT64_MAX) {
+        mSearchResult = session()->session()->partialSearch(folder(), mExpression, mPartialRange, mPartialFromEnd, &error);
+        if (mSearchResult != NULL) {
+            mUids = mSearchResult->uids();
+        }
+    }
+    else if (mReturnOptions != 0) {
+        mSearchResult = session()->session()->extendedSearch(folder(), mExpression, mReturnOptions, &error);
+        if (mSearchResult != NULL) {
+            mUids = mSearchResult->uids();
+        }
+    }
+    else if (mExpression != NULL) {
         mUids = session()->session()->search(folder(), mExpression, &error);
     }
     else {
         mUids = session()->session()->search(folder(), mKind, mSearchString, &error);
     }
     MC_SAFE_RETAIN(mUids);
+    MC_SAFE_RETAIN(mSearchResult);
     setError(error);
 }
 
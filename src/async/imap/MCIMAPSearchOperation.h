@@ -18,6 +18,7 @@
 namespace mailcore {
     
     class IMAPSearchExpression;
+    class IMAPSearchResult;
     
     class MAILCORE_EXPORT IMAPSearchOperation : public IMAPOperation {
     public:
@@ -33,8 +34,23 @@ namespace mailcore {
         virtual void setSearchExpression(IMAPSearchExpression * expression);
         virtual IMAPSearchExpression * searchExpression();
         
+        // When set, only the requested values are returned in searchResult().
+        virtual void setReturnOptions(IMAPSearchReturnOption options);
+        virtual IMAPSearchReturnOption returnOptions();
+        
+        // When set, only the UIDs at these positions are returned in searchResult(), with the total count.
+        // Default is RangeEmpty.
+        virtual void setPartialRange(Range positions);
+        virtual Range partialRange();
+        
+        // Positions of the partial range start from the highest UID.
+        virtual void setPartialFromEnd(bool fromEnd);
+        virtual bool isPartialFromEnd();
+        
         // Result.
         virtual IndexSet * uids();
+        // Result when return options or a partial range are set.
+        virtual IMAPSearchResult * searchResult();
         
     public: // subclass behavior
         virtual void main();
@@ -43,7 +59,11 @@ namespace mailcore {
         IMAPSearchKind mKind;
         String * mSearchString;
         IMAPSearchExpression * mExpression;
+        IMAPSearchReturnOption mReturnOptions;
+        Range mPartialRange;
+        bool mPartialFromEnd;
         IndexSet * mUids;
+        IMAPSearchResult * mSearchResult;
         
     };
     
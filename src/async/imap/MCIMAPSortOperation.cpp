@@ -0,0 +1,62 @@
+//
+//  MCIMAPSortOperation.cpp
+//  mailcore2
+//
+//  Created by agent on 10/18/26.
+//  Copyright (c) 2026 MailCore. All rights reserved.
+//
+
+#include "MCIMAPSortOperation.h"
+
+#include "MCIMAPSession.h"
+#include "MCIMAPAsyncConnection.h"
+#include "MCIMAPSearchExpression.h"
+
+using namespace mailcore;
+
+IMAPSortOperation::IMAPSortOperation()
+{
+    mCriteria = NULL;
+    mExpression = NULL;
+    mUids = NULL;
+}
+
+IMAPSortOperation::~IMAPSortOperation()
+{
+    MC_SAFE_RELEASE(mCriteria);
+    MC_SAFE_RELEASE(mExpression);
+    MC_SAFE_RELEASE(mUids);
+}
+
+void IMAPSortOperation::setCriteria(Array * criteria)
+{
+    MC_SAFE_REPLACE_RETAIN(Array, mCriteria, criteria);
+}
+
+Array * IMAPSortOperation::criteria()
+{
+    return mCriteria;
+}
+
+void IMAPSortOperation::setSearchExpression(IMAPSearchExpression * expression)
+{
+    MC_SAFE_REPLACE_RETAIN(IMAPSearchExpression, mExpression, expression);
+}
+
+IMAPSearchExpression * IMAPSortOperation::searchExpression()
+{
+    return mExpression;
+}
+
+Array * IMAPSortOperation::uids()
+{
+    return mUids;
+}
+
+void IMAPSortOperation::main()
+{
+    ErrorCode error;
+    mUids = session()->session()->sort(folder(), mCriteria, mExpression, &error);
+    MC_SAFE_RETAIN(mUids);
+    setError(error);
+}
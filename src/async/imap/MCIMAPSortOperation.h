@@ -0,0 +1,51 @@
+//
+//  MCIMAPSortOperation.h
+//  mailcore2
+//
+//  Created by agent on 10/18/26.
+//  Copyright (c) 2026 MailCore. All rights reserved.
+//
+
+#ifndef MAILCORE_MCIMAPSORTOPERATION_H
+
+#define MAILCORE_MCIMAPSORTOPERATION_H
+
+#include <MailCore/MCIMAPOperation.h>
+#include <MailCore/MCMessageConstants.h>
+
+#ifdef __cplusplus
+
+namespace mailcore {
+    
+    class IMAPSearchExpression;
+    
+    class MAILCORE_EXPORT IMAPSortOperation : public IMAPOperation {
+    public:
+        IMAPSortOperation();
+        virtual ~IMAPSortOperation();
+        
+        virtual void setCriteria(Array * /* IMAPSortCriterion */ criteria);
+        virtual Array * criteria();
+        
+        // NULL to sort all the messages of the folder.
+        virtual void setSearchExpression(IMAPSearchExpression * expression);
+        virtual IMAPSearchExpression * searchExpression();
+        
+        // Result.
+        virtual Array * /* Value */ uids();
+        
+    public: // subclass behavior
+        virtual void main();
+        
+    private:
+        Array * mCriteria;
+        IMAPSearchExpression * mExpression;
+        Array * mUids;
+        
+    };
+    
+}
+
+#endif
+
+#endif
@@ -20,6 +20,7 @@ IMAPStoreFlagsOperation::IMAPStoreFlagsOperation()
     mKind = IMAPStoreFlagsRequestKindAdd;
     mFlags = MessageFlagNone;
     mCustomFlags = NULL;
+    mCoalescedIndexes = NULL;
 }
 
 IMAPStoreFlagsOperation::~IMAPStoreFlagsOperation()
@@ -27,6 +28,7 @@ IMAPStoreFlagsOperation::~IMAPStoreFlagsOperation()
     MC_SAFE_RELEASE(mNumbers);
     MC_SAFE_RELEASE(mUids);
     MC_SAFE_RELEASE(mCustomFlags);
+    MC_SAFE_RELEASE(mCoalescedIndexes);
 }
 
 void IMAPStoreFlagsOperation::setUids(IndexSet * uids)
@@ -83,10 +85,47 @@ void IMAPStoreFlagsOperation::main()
 {
     ErrorCode error;
     if (mUids != NULL) {
-        session()->session()->storeFlagsAndCustomFlagsByUID(folder(), mUids, mKind, mFlags, mCustomFlags, &error);
+        IndexSet * uids = (mCoalescedIndexes != NULL) ? mCoalescedIndexes : mUids;
+        session()->session()->storeFlagsAndCustomFlagsByUID(folder(), uids, mKind, mFlags, mCustomFlags, &error);
     }
     else {
-        session()->session()->storeFlagsAndCustomFlagsByNumber(folder(), mNumbers, mKind, mFlags, mCustomFlags, &error);
+        IndexSet * numbers = (mCoalescedIndexes != NULL) ? mCoalescedIndexes : mNumbers;
+        session()->session()->storeFlagsAndCustomFlagsByNumber(folder(), numbers, mKind, mFlags, mCustomFlags, &error);
     }
     setError(error);
 }
+
+bool IMAPStoreFlagsOperation::canCoalesceWithOperation(IMAPOperation * otherOperation)
+{
+    if (!otherOperation->className()->isEqual(className())) {
+        return false;
+    }
+    IMAPStoreFlagsOperation * op = (IMAPStoreFlagsOperation *) otherOperation;
+    if ((folder() == NULL) || !folder()->isEqual(op->folder())) {
+        return false;
+    }
+    if ((mKind != op->mKind) || (mFlags != op->mFlags)) {
+        return false;
+    }
+    if ((mUids == NULL) != (op->mUids == NULL)) {
+        return false;
+    }
+    if ((mUids == NULL) && ((mNumbers == NULL) || (op->mNumbers == NULL))) {
+        return false;
+    }
+    if ((mCustomFlags == NULL) || (op->mCustomFlags == NULL)) {
+        return (mCustomFlags == NULL) && (op->mCustomFlags == NULL);
+    }
+    return mCustomFlags->isEqual(op->mCustomFlags);
+}
+
+void IMAPStoreFlagsOperation::coalesceOperation(IMAPOperation * otherOperation)
+{
+    IMAPStoreFlagsOperation * op = (IMAPStoreFlagsOperation *) otherOperation;
+    // Indexes are owned by the callers. Merge into a copy.
+    if (mCoalescedIndexes == NULL) {
+        IndexSet * indexes = (mUids != NULL) ? mUids : mNumbers;
+        mCoalescedIndexes = (IndexSet *) indexes->copy();
+    }
+    mCoalescedIndexes->addIndexSet((op->mUids != NULL) ? op->mUids : op->mNumbers);
+}
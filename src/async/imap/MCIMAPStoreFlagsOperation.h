@@ -38,6 +38,8 @@ namespace mailcore {
         
     public: // subclass behavior
         virtual void main();
+        virtual bool canCoalesceWithOperation(IMAPOperation * otherOperation);
+        virtual void coalesceOperation(IMAPOperation * otherOperation);
         
     private:
         IndexSet * mUids;
@@ -45,6 +47,7 @@ namespace mailcore {
         IMAPStoreFlagsRequestKind mKind;
         MessageFlag mFlags;
         Array * mCustomFlags;
+        IndexSet * mCoalescedIndexes;
     };
     
 }
@@ -0,0 +1,51 @@
+//
+//  MCIMAPSyncFolderMirrorOperation.cpp
+//  mailcore2
+//
+//  Created by agent on 10/18/26.
+//  Copyright (c) 2026 MailCore. All rights reserved.
+//
+
+#include "MCIMAPSyncFolderMirrorOperation.h"
+
+#include "MCIMAPSession.h"
+#include "MCIMAPAsyncConnection.h"
+#include "MCIMAPFolderMirror.h"
+#include "MCIMAPSyncResult.h"
+
+using namespace mailcore;
+
+IMAPSyncFolderMirrorOperation::IMAPSyncFolderMirrorOperation()
+{
+    mMirror = NULL;
+    mSyncResult = NULL;
+}
+
+IMAPSyncFolderMirrorOperation::~IMAPSyncFolderMirrorOperation()
+{
+    MC_SAFE_RELEASE(mMirror);
+    MC_SAFE_RELEASE(mSyncResult);
+}
+
+void IMAPSyncFolderMirrorOperation::setMirror(IMAPFolderMirror * mirror)
+{
+    MC_SAFE_REPLACE_RETAIN(IMAPFolderMirror, mMirror, mirror);
+}
+
+IMAPFolderMirror * IMAPSyncFolderMirrorOperation::mirror()
+{
+    return mMirror;
+}
+
+IMAPSyncResult * IMAPSyncFolderMirrorOperation::syncResult()
+{
+    return mSyncResult;
+}
+
+void IMAPSyncFolderMirrorOperation::main()
+{
+    ErrorCode error;
+    IMAPSyncResult * syncResult = mMirror->sync(session()->session(), this, &error);
+    MC_SAFE_REPLACE_RETAIN(IMAPSyncResult, mSyncResult, syncResult);
+    setError(error);
+}
@@ -0,0 +1,48 @@
+//
+//  MCIMAPSyncFolderMirrorOperation.h
+//  mailcore2
+//
+//  Created by agent on 10/18/26.
+//  Copyright (c) 2026 MailCore. All rights reserved.
+//
+
+#ifndef MAILCORE_MCIMAPSYNCFOLDERMIRROROPERATION_H
+
+#define MAILCORE_MCIMAPSYNCFOLDERMIRROROPERATION_H
+
+#include <MailCore/MCIMAPOperation.h>
+#include <MailCore/MCMessageConstants.h>
+
+#ifdef __cplusplus
+
+namespace mailcore {
+    
+    class IMAPFolderMirror;
+    class IMAPSyncResult;
+    
+    // The mirror should not be used until the operation has finished.
+    class MAILCORE_EXPORT IMAPSyncFolderMirrorOperation : public IMAPOperation {
+    public:
+        IMAPSyncFolderMirrorOperation();
+        virtual ~IMAPSyncFolderMirrorOperation();
+        
+        virtual void setMirror(IMAPFolderMirror * mirror);
+        virtual IMAPFolderMirror * mirror();
+        
+        // Result.
+        virtual IMAPSyncResult * syncResult();
+        
+    public: // subclass behavior
+        virtual void main();
+        
+    private:
+        IMAPFolderMirror * mMirror;
+        IMAPSyncResult * mSyncResult;
+        
+    };
+    
+}
+
+#endif
+
+#endif
@@ -0,0 +1,61 @@
+//
+//  MCIMAPThreadOperation.cpp
+//  mailcore2
+//
+//  Created by agent on 10/18/26.
+//  Copyright (c) 2026 MailCore. All rights reserved.
+//
+
+#include "MCIMAPThreadOperation.h"
+
+#include "MCIMAPSession.h"
+#include "MCIMAPAsyncConnection.h"
+#include "MCIMAPSearchExpression.h"
+
+using namespace mailcore;
+
+IMAPThreadOperation::IMAPThreadOperation()
+{
+    mAlgorithm = IMAPThreadAlgorithmReferences;
+    mExpression = NULL;
+    mThreads = NULL;
+}
+
+IMAPThreadOperation::~IMAPThreadOperation()
+{
+    MC_SAFE_RELEASE(mExpression);
+    MC_SAFE_RELEASE(mThreads);
+}
+
+void IMAPThreadOperation::setAlgorithm(IMAPThreadAlgorithm algorithm)
+{
+    mAlgorithm = algorithm;
+}
+
+IMAPThreadAlgorithm IMAPThreadOperation::algorithm()
+{
+    return mAlgorithm;
+}
+
+void IMAPThreadOperation::setSearchExpression(IMAPSearchExpression * expression)
+{
+    MC_SAFE_REPLACE_RETAIN(IMAPSearchExpression, mExpression, expression);
+}
+
+IMAPSearchExpression * IMAPThreadOperation::searchExpression()
+{
+    return mExpression;
+}
+
+Array * IMAPThreadOperation::threads()
+{
+    return mThreads;
+}
+
+void IMAPThreadOperation::main()
+{
+    ErrorCode error;
+    mThreads = session()->session()->thread(folder(), mAlgorithm, mExpression, &error);
+    MC_SAFE_RETAIN(mThreads);
+    setError(error);
+}
@@ -0,0 +1,51 @@
+//
+//  MCIMAPThreadOperation.h
+//  mailcore2
+//
+//  Created by agent on 10/18/26.
+//  Copyright (c) 2026 MailCore. All rights reserved.
+//
+
+#ifndef MAILCORE_MCIMAPTHREADOPERATION_H
+
+#define MAILCORE_MCIMAPTHREADOPERATION_H
+
+#include <MailCore/MCIMAPOperation.h>
+#include <MailCore/MCMessageConstants.h>
+
+#ifdef __cplusplus
+
+namespace mailcore {
+    
+    class IMAPSearchExpression;
+    
+    class MAILCORE_EXPORT IMAPThreadOperation : public IMAPOperation {
+    public:
+        IMAPThreadOperation();
+        virtual ~IMAPThreadOperation();
+        
+        virtual void setAlgorithm(IMAPThreadAlgorithm algorithm);
+        virtual IMAPThreadAlgorithm algorithm();
+        
+        // NULL to thread all the messages of the folder.
+        virtual void setSearchExpression(IMAPSearchExpression * expression);
+        virtual IMAPSearchExpression * searchExpression();
+        
+        // Result.
+        virtual Array * /* IMAPThread */ threads();
+        
+    public: // subclass behavior
+        virtual void main();
+        
+    private:
+        IMAPThreadAlgorithm mAlgorithm;
+        IMAPSearchExpression * mExpression;
+        Array * mThreads;
+        
+    };
+    
+}
+
+#endif
+
+#endif
@@ -35,11 +35,18 @@ namespace mailcore {
         virtual ErrorCode error();
         
         virtual void start();
+        virtual void cancel();
+        
+        virtual void beforeMain();
+        virtual void mainWillStart();
+        virtual void mainFinished();
         
     private:
         NNTPAsyncSession * mSession;
         NNTPOperationCallback * mPopCallback;
         ErrorCode mError;
+        bool mMainRunning;
+        pthread_mutex_t mRunningLock;
     private:
         virtual void bodyProgress(NNTPSession * session, unsigned int current, unsigned int maximum);
         virtual void bodyProgressOnMainThread(void * context);
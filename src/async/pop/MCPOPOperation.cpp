@@ -21,10 +21,13 @@ POPOperation::POPOperation()
     mSession = NULL;
     mPopCallback = NULL;
     mError = ErrorNone;
+    mMainRunning = false;
+    pthread_mutex_init(&mRunningLock, NULL);
 }
 
 POPOperation::~POPOperation()
 {
+    pthread_mutex_destroy(&mRunningLock);
     MC_SAFE_RELEASE(mSession);
 }
 
@@ -73,6 +76,39 @@ void POPOperation::start()
     mSession->runOperation(this);
 }
 
+void POPOperation::cancel()
+{
+    Operation::cancel();
+    
+    // Interrupt the request only when it's this operation that is using the connection.
+    pthread_mutex_lock(&mRunningLock);
+    if (mMainRunning) {
+        mSession->session()->cancelCurrentOperation();
+    }
+    pthread_mutex_unlock(&mRunningLock);
+}
+
+void POPOperation::beforeMain()
+{
+    pthread_mutex_lock(&mRunningLock);
+    mMainRunning = true;
+    pthread_mutex_unlock(&mRunningLock);
+}
+
+// A cancellation that happened after the previous operation was done is dropped.
+void POPOperation::mainWillStart()
+{
+    mSession->session()->operationWillStart();
+}
+
+void POPOperation::mainFinished()
+{
+    pthread_mutex_lock(&mRunningLock);
+    mMainRunning = false;
+    pthread_mutex_unlock(&mRunningLock);
+    mSession->session()->cancelledOperationFinished();
+}
+
 struct progressContext {
     unsigned int current;
     unsigned int maximum;
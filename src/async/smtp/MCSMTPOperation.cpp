@@ -21,10 +21,13 @@ SMTPOperation::SMTPOperation()
     mSession = NULL;
     mError = ErrorNone;
     mSmtpCallback = NULL;
+    mMainRunning = false;
+    pthread_mutex_init(&mRunningLock, NULL);
 }
 
 SMTPOperation::~SMTPOperation()
 {
+    pthread_mutex_destroy(&mRunningLock);
     MC_SAFE_RELEASE(mSession);
 }
 
@@ -53,6 +56,32 @@ void SMTPOperation::start()
     mSession->runOperation(this);
 }
 
+void SMTPOperation::cancel()
+{
+    Operation::cancel();
+    
+    // Interrupt the request only when it's this operation that is using the connection.
+    pthread_mutex_lock(&mRunningLock);
+    if (mMainRunning) {
+        mSession->session()->cancelMessageSending();
+    }
+    pthread_mutex_unlock(&mRunningLock);
+}
+
+void SMTPOperation::beforeMain()
+{
+    pthread_mutex_lock(&mRunningLock);
+    mMainRunning = true;
+    pthread_mutex_unlock(&mRunningLock);
+}
+
+void SMTPOperation::mainFinished()
+{
+    pthread_mutex_lock(&mRunningLock);
+    mMainRunning = false;
+    pthread_mutex_unlock(&mRunningLock);
+}
+
 void SMTPOperation::setSmtpCallback(SMTPOperationCallback * callback)
 {
     mSmtpCallback = callback;
@@ -39,11 +39,17 @@ namespace mailcore {
         virtual int lastSMTPResponseCode();
 
         virtual void start();
+        virtual void cancel();
+        
+        virtual void beforeMain();
+        virtual void mainFinished();
         
     private:
         SMTPAsyncSession * mSession;
         SMTPOperationCallback * mSmtpCallback;
         ErrorCode mError;
+        bool mMainRunning;
+        pthread_mutex_t mRunningLock;
     private:
         virtual void bodyProgress(SMTPSession * session, unsigned int current, unsigned int maximum);
         virtual void bodyProgressOnMainThread(void * context);
@@ -84,9 +84,3 @@ void SMTPSendWithDataOperation::main()
     }
     setError(error);
 }
-
-void SMTPSendWithDataOperation::cancel()
-{
-    SMTPOperation::cancel();
-    session()->session()->cancelMessageSending();
-}
@@ -2,6 +2,8 @@
 
 set(async_imap_files
   async/imap/MCIMAPAppendMessageOperation.cpp
+  async/imap/MCIMAPAppendMessagesOperation.cpp
+  async/imap/MCIMAPSyncFolderMirrorOperation.cpp
   async/imap/MCIMAPAsyncConnection.cpp
   async/imap/MCIMAPAsyncSession.cpp
   async/imap/MCIMAPCapabilityOperation.cpp
@@ -17,6 +19,7 @@ set(async_imap_files
   async/imap/MCIMAPFetchContentToFileOperation.cpp
   async/imap/MCIMAPFetchParsedContentOperation.cpp
   async/imap/MCIMAPFetchFoldersOperation.cpp
+  async/imap/MCIMAPFetchFoldersWithStatusOperation.cpp
   async/imap/MCIMAPFetchMessagesOperation.cpp
   async/imap/MCIMAPFetchNamespaceOperation.cpp
   async/imap/MCIMAPFolderInfo.cpp
@@ -28,8 +31,12 @@ set(async_imap_files
   async/imap/MCIMAPMultiDisconnectOperation.cpp
   async/imap/MCIMAPOperation.cpp
   async/imap/MCIMAPQuotaOperation.cpp
+  async/imap/MCIMAPBatchOperation.cpp
   async/imap/MCIMAPRenameFolderOperation.cpp
   async/imap/MCIMAPSearchOperation.cpp
+  async/imap/MCIMAPThreadOperation.cpp
+  async/imap/MCIMAPSortOperation.cpp
+  async/imap/MCIMAPFolderWatcher.cpp
   async/imap/MCIMAPStoreFlagsOperation.cpp
   async/imap/MCIMAPStoreLabelsOperation.cpp
   async/imap/MCIMAPSubscribeFolderOperation.cpp
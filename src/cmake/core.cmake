@@ -58,6 +58,10 @@ set(basetypes_files
   core/basetypes/MCObject.cpp
   core/basetypes/MCOperation.cpp
   core/basetypes/MCOperationQueue.cpp
+  core/basetypes/MCOperationTimingStatistics.cpp
+  core/basetypes/MCConnectionMetrics.cpp
+  core/basetypes/MCEventLoop.cpp
+  core/basetypes/MCOperationTiming.cpp
   core/basetypes/MCRange.cpp
   core/basetypes/MCSet.cpp
   core/basetypes/MCString.cpp
@@ -97,6 +101,19 @@ ENDIF()
 set(imap_files
   core/imap/MCIMAPFolder.cpp
   core/imap/MCIMAPFolderStatus.cpp
+  core/imap/MCIMAPAppendItem.cpp
+  core/imap/MCIMAPSearchResult.cpp
+  core/imap/MCIMAPNotifyEvent.cpp
+  core/imap/MCIMAPResponseBuffer.cpp
+  core/imap/MCIMAPBodyCache.cpp
+  core/imap/MCIMAPSearchIndex.cpp
+  core/imap/MCIMAPSearchEvaluator.cpp
+  core/imap/MCIMAPMessageTable.cpp
+  core/imap/MCIMAPBodyStructure.cpp
+  core/imap/MCIMAPThread.cpp
+  core/imap/MCIMAPSortCriterion.cpp
+  core/imap/MCIMAPFolderMirror.cpp
+  core/imap/MCIMAPGmailMirror.cpp
   core/imap/MCIMAPIdentity.cpp
   core/imap/MCIMAPMessage.cpp
   core/imap/MCIMAPMessagePart.cpp
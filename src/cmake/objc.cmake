@@ -40,6 +40,20 @@ set(objc_imap_files
   objc/imap/MCOIMAPOperation.mm
   objc/imap/MCOIMAPPart.mm
   objc/imap/MCOIMAPQuotaOperation.mm
+  objc/imap/MCOIMAPBodyCache.mm
+  objc/imap/MCOIMAPFolderWatcher.mm
+  objc/imap/MCOIMAPNotifyEvent.mm
+  objc/imap/MCOIMAPFetchFoldersWithStatusOperation.mm
+  objc/imap/MCOIMAPSearchResult.mm
+  objc/imap/MCOIMAPThread.mm
+  objc/imap/MCOIMAPThreadOperation.mm
+  objc/imap/MCOIMAPSortCriterion.mm
+  objc/imap/MCOIMAPSortOperation.mm
+  objc/imap/MCOIMAPFolderMirror.mm
+  objc/imap/MCOIMAPSyncFolderMirrorOperation.mm
+  objc/imap/MCOIMAPAppendMessagesOperation.mm
+  objc/imap/MCOIMAPAppendItem.mm
+  objc/imap/MCOIMAPBatchOperation.mm
   objc/imap/MCOIMAPSearchExpression.mm
   objc/imap/MCOIMAPSearchOperation.mm
   objc/imap/MCOIMAPNoopOperation.mm
@@ -27,6 +27,10 @@ core/basetypes/MCAssert.h
 core/basetypes/MCIndexSet.h
 core/basetypes/MCOperation.h
 core/basetypes/MCOperationQueue.h
+core/basetypes/MCOperationTimingStatistics.h
+core/basetypes/MCConnectionMetrics.h
+core/basetypes/MCEventLoop.h
+core/basetypes/MCOperationTiming.h
 core/basetypes/MCLibetpanTypes.h
 core/basetypes/MCOperationCallback.h
 core/basetypes/MCIterator.h
@@ -46,10 +50,24 @@ core/imap/MCIMAPNamespace.h
 core/imap/MCIMAPNamespaceItem.h
 core/imap/MCIMAPPart.h
 core/imap/MCIMAPProgressCallback.h
+core/imap/MCIMAPMessageStreamCallback.h
 core/imap/MCIMAPSearchExpression.h
 core/imap/MCIMAPSession.h
 core/imap/MCIMAPSyncResult.h
 core/imap/MCIMAPFolderStatus.h
+core/imap/MCIMAPAppendItem.h
+core/imap/MCIMAPSearchResult.h
+core/imap/MCIMAPNotifyEvent.h
+core/imap/MCIMAPResponseBuffer.h
+core/imap/MCIMAPBodyCache.h
+core/imap/MCIMAPSearchIndex.h
+core/imap/MCIMAPSearchEvaluator.h
+core/imap/MCIMAPMessageTable.h
+core/imap/MCIMAPBodyStructure.h
+core/imap/MCIMAPThread.h
+core/imap/MCIMAPSortCriterion.h
+core/imap/MCIMAPFolderMirror.h
+core/imap/MCIMAPGmailMirror.h
 core/imap/MCIMAPIdentity.h
 core/pop/MCPOP.h
 core/pop/MCPOPMessageInfo.h
@@ -86,7 +104,10 @@ async/imap/MCAsyncIMAP.h
 async/imap/MCIMAPAsyncSession.h
 async/imap/MCIMAPOperation.h
 async/imap/MCIMAPFetchFoldersOperation.h
+async/imap/MCIMAPFetchFoldersWithStatusOperation.h
 async/imap/MCIMAPAppendMessageOperation.h
+async/imap/MCIMAPAppendMessagesOperation.h
+async/imap/MCIMAPSyncFolderMirrorOperation.h
 async/imap/MCIMAPCopyMessagesOperation.h
 async/imap/MCIMAPMoveMessagesOperation.h
 async/imap/MCIMAPFetchMessagesOperation.h
@@ -98,11 +119,16 @@ async/imap/MCIMAPFolderInfo.h
 async/imap/MCIMAPFolderInfoOperation.h
 async/imap/MCIMAPFolderStatusOperation.h
 async/imap/MCIMAPSearchOperation.h
+async/imap/MCIMAPThreadOperation.h
+async/imap/MCIMAPSortOperation.h
+async/imap/MCIMAPFolderWatcher.h
 async/imap/MCIMAPFetchNamespaceOperation.h
 async/imap/MCIMAPIdentityOperation.h
 async/imap/MCIMAPCapabilityOperation.h
 async/imap/MCIMAPQuotaOperation.h
+async/imap/MCIMAPBatchOperation.h
 async/imap/MCIMAPOperationCallback.h
+async/imap/MCIMAPFolderWatcherCallback.h
 async/imap/MCIMAPMessageRenderingOperation.h
 async/imap/MCIMAPCustomCommandOperation.h
 async/imap/MCIMAPCheckAccountOperation.h
@@ -178,6 +204,20 @@ objc/imap/MCOIMAPFetchNamespaceOperation.h
 objc/imap/MCOIMAPIdentityOperation.h
 objc/imap/MCOIMAPCapabilityOperation.h
 objc/imap/MCOIMAPQuotaOperation.h
+objc/imap/MCOIMAPBodyCache.h
+objc/imap/MCOIMAPFolderWatcher.h
+objc/imap/MCOIMAPNotifyEvent.h
+objc/imap/MCOIMAPFetchFoldersWithStatusOperation.h
+objc/imap/MCOIMAPSearchResult.h
+objc/imap/MCOIMAPThread.h
+objc/imap/MCOIMAPThreadOperation.h
+objc/imap/MCOIMAPSortCriterion.h
+objc/imap/MCOIMAPSortOperation.h
+objc/imap/MCOIMAPFolderMirror.h
+objc/imap/MCOIMAPSyncFolderMirrorOperation.h
+objc/imap/MCOIMAPAppendMessagesOperation.h
+objc/imap/MCOIMAPAppendItem.h
+objc/imap/MCOIMAPBatchOperation.h
 objc/imap/MCOIMAPSearchExpression.h
 objc/imap/MCOIMAPMessageRenderingOperation.h
 objc/imap/MCOIMAPCustomCommandOperation.h
@@ -78,6 +78,7 @@ namespace mailcore {
         IMAPMessagesRequestKindExtraHeaders  = 1 << 9,
         IMAPMessagesRequestKindSize          = 1 << 10,
         IMAPMessagesRequestKindAllHeaders    = 1 << 11, // Unlike Full headers this will fetch all the non-parsed headers
+        IMAPMessagesRequestKindPreview       = 1 << 12, // Short text extract of the body, see IMAPMessage::preview().
     };
     
     enum IMAPFetchRequestType {
@@ -91,6 +92,12 @@ namespace mailcore {
         IMAPStoreFlagsRequestKindSet,
     };
     
+    enum IMAPBatchAction {
+        IMAPBatchActionStoreFlags,
+        IMAPBatchActionCopy,
+        IMAPBatchActionMove,
+    };
+    
     enum IMAPWorkaround {
         IMAPWorkaroundGmail = 1 << 0,
         IMAPWorkaroundYahoo = 1 << 1,
@@ -135,6 +142,12 @@ namespace mailcore {
         IMAPCapabilityXOAuth2,
         IMAPCapabilityXYMHighestModseq,
         IMAPCapabilityGmail,
+        IMAPCapabilityPreview,
+        IMAPCapabilityESearch,
+        IMAPCapabilityContextSearch,
+        IMAPCapabilityPartial,
+        IMAPCapabilityListStatus,
+        IMAPCapabilityNotify,
     };
     
     enum POPCapability {
@@ -211,6 +224,40 @@ namespace mailcore {
         IMAPSearchKindNot,
     };
     
+    enum IMAPSearchReturnOption {
+        IMAPSearchReturnOptionMin   = 1 << 0,
+        IMAPSearchReturnOptionMax   = 1 << 1,
+        IMAPSearchReturnOptionCount = 1 << 2,
+        IMAPSearchReturnOptionAll   = 1 << 3,
+    };
+    
+    enum IMAPNotifyEventKind {
+        // A message has been added. number() is the new message count of the folder.
+        IMAPNotifyEventKindExists,
+        // number() is the sequence number of the message that has been removed.
+        IMAPNotifyEventKindExpunge,
+        // uids() are the UIDs of the messages that have been removed.
+        IMAPNotifyEventKindVanished,
+        IMAPNotifyEventKindFlagsChange,
+        // The status of a folder that is not selected changed.
+        IMAPNotifyEventKindStatus,
+    };
+    
+    enum IMAPSortKind {
+        IMAPSortKindArrival,
+        IMAPSortKindCc,
+        IMAPSortKindDate,
+        IMAPSortKindFrom,
+        IMAPSortKindSize,
+        IMAPSortKindSubject,
+        IMAPSortKindTo,
+    };
+    
+    enum IMAPThreadAlgorithm {
+        IMAPThreadAlgorithmReferences,
+        IMAPThreadAlgorithmOrderedSubject,
+    };
+    
     enum ErrorCode {
         ErrorNone, // 0
         ErrorConnection,
@@ -22,6 +22,10 @@
 #include <MailCore/MCOperation.h>
 #include <MailCore/MCOperationQueue.h>
 #include <MailCore/MCOperationCallback.h>
+#include <MailCore/MCOperationTiming.h>
+#include <MailCore/MCOperationTimingStatistics.h>
+#include <MailCore/MCConnectionMetrics.h>
+#include <MailCore/MCEventLoop.h>
 #include <MailCore/MCLibetpanTypes.h>
 #include <MailCore/MCICUTypes.h>
 #include <MailCore/MCIterator.h>
@@ -0,0 +1,228 @@
+//
+//  MCConnectionMetrics.cpp
+//  mailcore2
+//
+//  Created by agent on 10/18/26.
+//  Copyright (c) 2026 MailCore. All rights reserved.
+//
+
+#include "MCWin32.h" // should be included first.
+
+#include "MCConnectionMetrics.h"
+
+#include <string.h>
+
+#include "MCDefines.h"
+#include "MCString.h"
+#include "MCHashMap.h"
+#include "MCValue.h"
+#include "MCJSON.h"
+#include "MCUtils.h"
+
+using namespace mailcore;
+
+ConnectionMetrics::ConnectionMetrics()
+{
+    pthread_mutex_init(&mLock, NULL);
+    reset();
+}
+
+ConnectionMetrics::~ConnectionMetrics()
+{
+    pthread_mutex_destroy(&mLock);
+}
+
+void ConnectionMetrics::addBytesSent(size_t size)
+{
+    pthread_mutex_lock(&mLock);
+    mBytesSent += size;
+    pthread_mutex_unlock(&mLock);
+}
+
+void ConnectionMetrics::addBytesReceived(size_t size)
+{
+    pthread_mutex_lock(&mLock);
+    mBytesReceived += size;
+    pthread_mutex_unlock(&mLock);
+}
+
+int ConnectionMetrics::addCommand(const char * verb, size_t length)
+{
+    if (length >= MaxVerbLength) {
+        length = MaxVerbLength - 1;
+    }
+
+    int result = -1;
+    pthread_mutex_lock(&mLock);
+    for(unsigned int i = 0 ; i < mCommandsSlotsCount ; i ++) {
+        if ((strncasecmp(mCommands[i].verb, verb, length) == 0) && (mCommands[i].verb[length] == 0)) {
+            result = (int) i;
+            break;
+        }
+    }
+    if ((result == -1) && (mCommandsSlotsCount < MaxCommandsCount)) {
+        result = (int) mCommandsSlotsCount;
+        CommandMetrics * command = &mCommands[result];
+        for(size_t i = 0 ; i < length ; i ++) {
+            char ch = verb[i];
+            if ((ch >= 'a') && (ch <= 'z')) {
+                ch = ch - 'a' + 'A';
+            }
+            command->verb[i] = ch;
+        }
+        command->verb[length] = 0;
+        command->count = 0;
+        command->roundTripCount = 0;
+        command->roundTripTotal = 0;
+        command->roundTripMax = 0;
+        mCommandsSlotsCount ++;
+    }
+    if (result == -1) {
+        mOtherCommandsCount ++;
+    }
+    else {
+        mCommands[result].count ++;
+    }
+    pthread_mutex_unlock(&mLock);
+
+    return result;
+}
+
+void ConnectionMetrics::addRoundTripDuration(int commandIndex, double duration)
+{
+    pthread_mutex_lock(&mLock);
+    if ((commandIndex >= 0) && ((unsigned int) commandIndex < mCommandsSlotsCount)) {
+        CommandMetrics * command = &mCommands[commandIndex];
+        command->roundTripCount ++;
+        command->roundTripTotal += duration;
+        if (duration > command->roundTripMax) {
+            command->roundTripMax = duration;
+        }
+    }
+    pthread_mutex_unlock(&mLock);
+}
+
+void ConnectionMetrics::addTLSHandshakeDuration(double duration)
+{
+    pthread_mutex_lock(&mLock);
+    mTLSHandshakesCount ++;
+    mTLSHandshakeTotalDuration += duration;
+    mLastTLSHandshakeDuration = duration;
+    pthread_mutex_unlock(&mLock);
+}
+
+void ConnectionMetrics::reset()
+{
+    pthread_mutex_lock(&mLock);
+    mBytesSent = 0;
+    mBytesReceived = 0;
+    mOtherCommandsCount = 0;
+    mCommandsSlotsCount = 0;
+    mTLSHandshakesCount = 0;
+    mTLSHandshakeTotalDuration = 0;
+    mLastTLSHandshakeDuration = 0;
+    pthread_mutex_unlock(&mLock);
+}
+
+uint64_t ConnectionMetrics::bytesSent()
+{
+    pthread_mutex_lock(&mLock);
+    uint64_t result = mBytesSent;
+    pthread_mutex_unlock(&mLock);
+    return result;
+}
+
+uint64_t ConnectionMetrics::bytesReceived()
+{
+    pthread_mutex_lock(&mLock);
+    uint64_t result = mBytesReceived;
+    pthread_mutex_unlock(&mLock);
+    return result;
+}
+
+unsigned int ConnectionMetrics::commandsCount()
+{
+    pthread_mutex_lock(&mLock);
+    unsigned int result = mOtherCommandsCount;
+    for(unsigned int i = 0 ; i < mCommandsSlotsCount ; i ++) {
+        result += mCommands[i].count;
+    }
+    pthread_mutex_unlock(&mLock);
+    return result;
+}
+
+unsigned int ConnectionMetrics::TLSHandshakesCount()
+{
+    pthread_mutex_lock(&mLock);
+    unsigned int result = mTLSHandshakesCount;
+    pthread_mutex_unlock(&mLock);
+    return result;
+}
+
+double ConnectionMetrics::TLSHandshakeTotalDuration()
+{
+    pthread_mutex_lock(&mLock);
+    double result = mTLSHandshakeTotalDuration;
+    pthread_mutex_unlock(&mLock);
+    return result;
+}
+
+double ConnectionMetrics::lastTLSHandshakeDuration()
+{
+    pthread_mutex_lock(&mLock);
+    double result = mLastTLSHandshakeDuration;
+    pthread_mutex_unlock(&mLock);
+    return result;
+}
+
+HashMap * ConnectionMetrics::commands()
+{
+    // Copy the counters first to avoid allocating while holding the lock.
+    CommandMetrics commandsCopy[MaxCommandsCount];
+    pthread_mutex_lock(&mLock);
+    unsigned int slotsCount = mCommandsSlotsCount;
+    unsigned int otherCount = mOtherCommandsCount;
+    memcpy(commandsCopy, mCommands, sizeof(CommandMetrics) * slotsCount);
+    pthread_mutex_unlock(&mLock);
+
+    HashMap * result = HashMap::hashMap();
+    for(unsigned int i = 0 ; i < slotsCount ; i ++) {
+        HashMap * info = HashMap::hashMap();
+        info->setObjectForKey(MCSTR("count"), Value::valueWithUnsignedIntValue(commandsCopy[i].count));
+        info->setObjectForKey(MCSTR("roundTripCount"), Value::valueWithUnsignedIntValue(commandsCopy[i].roundTripCount));
+        info->setObjectForKey(MCSTR("roundTripTotal"), Value::valueWithDoubleValue(commandsCopy[i].roundTripTotal));
+        info->setObjectForKey(MCSTR("roundTripMax"), Value::valueWithDoubleValue(commandsCopy[i].roundTripMax));
+        result->setObjectForKey(String::stringWithUTF8Characters(commandsCopy[i].verb), info);
+    }
+    if (otherCount > 0) {
+        HashMap * info = HashMap::hashMap();
+        info->setObjectForKey(MCSTR("count"), Value::valueWithUnsignedIntValue(otherCount));
+        result->setObjectForKey(MCSTR("OTHER"), info);
+    }
+    return result;
+}
+
+HashMap * ConnectionMetrics::info()
+{
+    HashMap * result = HashMap::hashMap();
+    result->setObjectForKey(MCSTR("bytesSent"), Value::valueWithUnsignedLongLongValue(bytesSent()));
+    result->setObjectForKey(MCSTR("bytesReceived"), Value::valueWithUnsignedLongLongValue(bytesReceived()));
+    result->setObjectForKey(MCSTR("commands"), commands());
+    result->setObjectForKey(MCSTR("TLSHandshakesCount"), Value::valueWithUnsignedIntValue(TLSHandshakesCount()));
+    result->setObjectForKey(MCSTR("TLSHandshakeTotalDuration"), Value::valueWithDoubleValue(TLSHandshakeTotalDuration()));
+    result->setObjectForKey(MCSTR("lastTLSHandshakeDuration"), Value::valueWithDoubleValue(lastTLSHandshakeDuration()));
+    return result;
+}
+
+String * ConnectionMetrics::JSONString()
+{
+    return JSON::objectToJSONString(info());
+}
+
+String * ConnectionMetrics::description()
+{
+    String * result = String::string();
+    result->appendUTF8Format("<%s:%p %s>", className()->UTF8Characters(), this,
+                             MCUTF8(JSONString()));
+    return result;
+}
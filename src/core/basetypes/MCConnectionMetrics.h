@@ -0,0 +1,85 @@
+//
+//  MCConnectionMetrics.h
+//  mailcore2
+//
+//  Created by agent on 10/18/26.
+//  Copyright (c) 2026 MailCore. All rights reserved.
+//
+
+#ifndef MAILCORE_MCCONNECTIONMETRICS_H
+
+#define MAILCORE_MCCONNECTIONMETRICS_H
+
+#include <pthread.h>
+#include <inttypes.h>
+#include <MailCore/MCObject.h>
+
+#ifdef __cplusplus
+
+namespace mailcore {
+
+    class String;
+    class HashMap;
+
+    // Counters fed from the connection logging callbacks.
+    // Methods used to record values don't allocate memory. It can be shared by several connections
+    // and read from any thread.
+    class MAILCORE_EXPORT ConnectionMetrics : public Object {
+    public:
+        ConnectionMetrics();
+        virtual ~ConnectionMetrics();
+
+        virtual void addBytesSent(size_t size);
+        virtual void addBytesReceived(size_t size);
+        // Returns an index to pass to addRoundTripDuration(), -1 if too many different verbs were seen.
+        virtual int addCommand(const char * verb, size_t length);
+        virtual void addRoundTripDuration(int commandIndex, double duration);
+        virtual void addTLSHandshakeDuration(double duration);
+        virtual void reset();
+
+        virtual uint64_t bytesSent();
+        virtual uint64_t bytesReceived();
+        virtual unsigned int commandsCount();
+        virtual unsigned int TLSHandshakesCount();
+        virtual double TLSHandshakeTotalDuration();
+        virtual double lastTLSHandshakeDuration();
+
+        // verb -> { "count", "roundTripCount", "roundTripTotal", "roundTripMax" }
+        virtual HashMap * commands();
+        // Snapshot of all the counters.
+        virtual HashMap * info();
+        virtual String * JSONString();
+
+    public: // subclass behavior
+        virtual String * description();
+
+    private:
+        enum {
+            MaxCommandsCount = 48,
+            MaxVerbLength = 24,
+        };
+
+        struct CommandMetrics {
+            char verb[MaxVerbLength];
+            unsigned int count;
+            unsigned int roundTripCount;
+            double roundTripTotal;
+            double roundTripMax;
+        };
+
+        pthread_mutex_t mLock;
+        uint64_t mBytesSent;
+        uint64_t mBytesReceived;
+        unsigned int mOtherCommandsCount;
+        unsigned int mCommandsSlotsCount;
+        CommandMetrics mCommands[MaxCommandsCount];
+        unsigned int mTLSHandshakesCount;
+        double mTLSHandshakeTotalDuration;
+        double mLastTLSHandshakeDuration;
+    };
+
+}
+
+#endif
+
+#endif
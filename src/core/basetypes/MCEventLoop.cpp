@@ -0,0 +1,524 @@
+//
+//  MCEventLoop.cpp
+//  mailcore2
+//
+//  Created by agent on 10/18/26.
+//  Copyright (c) 2026 MailCore. All rights reserved.
+//
+
+#include "MCWin32.h" // should be included first.
+
+#include "MCEventLoop.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <libetpan/libetpan.h>
+#ifndef _MSC_VER
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#endif
+#if defined(__linux__)
+#include <sys/epoll.h>
+#endif
+
+#include "MCAutoreleasePool.h"
+#include "MCMainThreadAndroid.h"
+#include "MCLog.h"
+
+using namespace mailcore;
+
+#define MAX_READY_FDS 64
+
+enum {
+    EVENT_READABLE = 1 << 0,
+    EVENT_WRITABLE = 1 << 1,
+};
+
+void EventLoop::init()
+{
+    pthread_mutex_init(&mLock, NULL);
+    pthread_cond_init(&mDispatchCond, NULL);
+    mStarted = false;
+    mQuitting = false;
+    mTimerInterval = 10;
+    mLastTimerDate = 0;
+    mSourcesHash = chash_new(CHASH_DEFAULTSIZE, CHASH_COPYKEY);
+    mSources = NULL;
+    mSourcesCount = 0;
+    mSourcesCapacity = 0;
+    mRemovedSources = NULL;
+    mRemovedSourcesCount = 0;
+    mRemovedSourcesCapacity = 0;
+    mDispatchingSource = NULL;
+    mPollFd = -1;
+    mWakeUpFds[0] = -1;
+    mWakeUpFds[1] = -1;
+    mPollFds = NULL;
+    mPollSources = NULL;
+    mPollFdsCount = 0;
+    mPollFdsCapacity = 0;
+    mPollFdsChanged = true;
+#ifndef _MSC_VER
+    if (pipe(mWakeUpFds) == 0) {
+        fcntl(mWakeUpFds[0], F_SETFL, O_NONBLOCK);
+        fcntl(mWakeUpFds[1], F_SETFL, O_NONBLOCK);
+    }
+    else {
+        mWakeUpFds[0] = -1;
+        mWakeUpFds[1] = -1;
+    }
+#endif
+#if defined(__linux__)
+    mPollFd = epoll_create1(EPOLL_CLOEXEC);
+    if ((mPollFd != -1) && (mWakeUpFds[0] != -1)) {
+        struct epoll_event event;
+        memset(&event, 0, sizeof(event));
+        event.events = EPOLLIN;
+        // The wake-up pipe has no source.
+        event.data.ptr = NULL;
+        epoll_ctl(mPollFd, EPOLL_CTL_ADD, mWakeUpFds[0], &event);
+    }
+#endif
+}
+
+EventLoop::EventLoop()
+{
+    init();
+}
+
+EventLoop::~EventLoop()
+{
+    stop();
+#ifndef _MSC_VER
+    if (mPollFd != -1) {
+        close(mPollFd);
+    }
+    if (mWakeUpFds[0] != -1) {
+        close(mWakeUpFds[0]);
+        close(mWakeUpFds[1]);
+    }
+#endif
+    for(unsigned int i = 0 ; i < mSourcesCount ; i ++) {
+        free(mSources[i]);
+    }
+    free(mSources);
+    freeRemovedSources();
+    free(mRemovedSources);
+    free(mPollFds);
+    free(mPollSources);
+    chash_free(mSourcesHash);
+    pthread_cond_destroy(&mDispatchCond);
+    pthread_mutex_destroy(&mLock);
+}
+
+EventLoop * EventLoop::sharedEventLoop()
+{
+    static EventLoop * instance = new EventLoop();
+    return instance;
+}
+
+void EventLoop::setTimerInterval(time_t timerInterval)
+{
+    pthread_mutex_lock(&mLock);
+    mTimerInterval = timerInterval;
+    pthread_mutex_unlock(&mLock);
+    wakeUp();
+}
+
+time_t EventLoop::timerInterval()
+{
+    pthread_mutex_lock(&mLock);
+    time_t result = mTimerInterval;
+    pthread_mutex_unlock(&mLock);
+    return result;
+}
+
+// Should be called with the lock held.
+EventLoop::Source * EventLoop::sourceForFileDescriptor(int fd)
+{
+    chashdatum key;
+    chashdatum value;
+    key.data = &fd;
+    key.len = sizeof(fd);
+    if (chash_get(mSourcesHash, &key, &value) < 0) {
+        return NULL;
+    }
+    return (Source *) value.data;
+}
+
+void EventLoop::addFileDescriptor(int fd, EventLoopCallback * callback)
+{
+    pthread_mutex_lock(&mLock);
+    Source * source = sourceForFileDescriptor(fd);
+    if (source == NULL) {
+        source = (Source *) malloc(sizeof(* source));
+        source->fd = fd;
+        source->waitsForWritability = false;
+        source->removed = false;
+        if (mSourcesCount == mSourcesCapacity) {
+            mSourcesCapacity = (mSourcesCapacity == 0) ? 8 : mSourcesCapacity * 2;
+            mSources = (Source **) realloc(mSources, sizeof(* mSources) * mSourcesCapacity);
+        }
+        source->index = mSourcesCount;
+        mSources[mSourcesCount] = source;
+        mSourcesCount ++;
+
+        chashdatum key;
+        chashdatum value;
+        key.data = &fd;
+        key.len = sizeof(fd);
+        value.data = source;
+        value.len = 0;
+        chash_set(mSourcesHash, &key, &value, NULL);
+#if defined(__linux__)
+        struct epoll_event event;
+        memset(&event, 0, sizeof(event));
+        event.events = EPOLLIN;
+        event.data.ptr = source;
+        if (epoll_ctl(mPollFd, EPOLL_CTL_ADD, fd, &event) == -1) {
+            MCLog("could not watch file descriptor %i", fd);
+        }
+#endif
+        mPollFdsChanged = true;
+    }
+    source->callback = callback;
+    pthread_mutex_unlock(&mLock);
+
+    startThreadIfNeeded();
+    wakeUp();
+}
+
+void EventLoop::removeFileDescriptor(int fd)
+{
+    pthread_mutex_lock(&mLock);
+    Source * source = sourceForFileDescriptor(fd);
+    if (source != NULL) {
+        chashdatum key;
+        key.data = &fd;
+        key.len = sizeof(fd);
+        chash_delete(mSourcesHash, &key, NULL);
+
+        mSourcesCount --;
+        if (source->index != mSourcesCount) {
+            mSources[source->index] = mSources[mSourcesCount];
+            mSources[source->index]->index = source->index;
+        }
+#if defined(__linux__)
+        epoll_ctl(mPollFd, EPOLL_CTL_DEL, fd, NULL);
+#endif
+        mPollFdsChanged = true;
+
+        // Events returned by the current wait may still refer to it.
+        source->removed = true;
+        if (mRemovedSourcesCount == mRemovedSourcesCapacity) {
+            mRemovedSourcesCapacity = (mRemovedSourcesCapacity == 0) ? 8 : mRemovedSourcesCapacity * 2;
+            mRemovedSources = (Source **) realloc(mRemovedSources, sizeof(* mRemovedSources) * mRemovedSourcesCapacity);
+        }
+        mRemovedSources[mRemovedSourcesCount] = source;
+        mRemovedSourcesCount ++;
+
+        // Wait for the callback to return if it's running on the thread of the event loop.
+        if (!isEventLoopThread()) {
+            while (mDispatchingSource == source) {
+                pthread_cond_wait(&mDispatchCond, &mLock);
+            }
+        }
+    }
+    pthread_mutex_unlock(&mLock);
+
+    wakeUp();
+}
+
+// Should be called with the lock held, on the thread of the event loop or once it's stopped.
+void EventLoop::freeRemovedSources()
+{
+    for(unsigned int i = 0 ; i < mRemovedSourcesCount ; i ++) {
+        free(mRemovedSources[i]);
+    }
+    mRemovedSourcesCount = 0;
+}
+
+void EventLoop::setWaitsForWritability(int fd, bool enabled)
+{
+    pthread_mutex_lock(&mLock);
+    Source * source = sourceForFileDescriptor(fd);
+    if ((source == NULL) || (source->waitsForWritability == enabled)) {
+        pthread_mutex_unlock(&mLock);
+        return;
+    }
+    source->waitsForWritability = enabled;
+#if defined(__linux__)
+    struct epoll_event event;
+    memset(&event, 0, sizeof(event));
+    event.events = enabled ? (EPOLLIN | EPOLLOUT) : EPOLLIN;
+    event.data.ptr = source;
+    epoll_ctl(mPollFd, EPOLL_CTL_MOD, fd, &event);
+#endif
+    mPollFdsChanged = true;
+    pthread_mutex_unlock(&mLock);
+
+    // poll() is set up again with the new events.
+    if (!isEventLoopThread()) {
+        wakeUp();
+    }
+}
+
+unsigned int EventLoop::fileDescriptorsCount()
+{
+    pthread_mutex_lock(&mLock);
+    unsigned int result = mSourcesCount;
+    pthread_mutex_unlock(&mLock);
+    return result;
+}
+
+bool EventLoop::isEventLoopThread()
+{
+    return mStarted && pthread_equal(pthread_self(), mThread);
+}
+
+void EventLoop::startThreadIfNeeded()
+{
+    pthread_mutex_lock(&mLock);
+    if (!mStarted) {
+        mStarted = true;
+        mQuitting = false;
+        mLastTimerDate = time(NULL);
+        pthread_create(&mThread, NULL, EventLoop::runOnThread, this);
+    }
+    pthread_mutex_unlock(&mLock);
+}
+
+void EventLoop::stop()
+{
+    pthread_mutex_lock(&mLock);
+    if (!mStarted || isEventLoopThread()) {
+        pthread_mutex_unlock(&mLock);
+        return;
+    }
+    mQuitting = true;
+    pthread_mutex_unlock(&mLock);
+
+    wakeUp();
+    pthread_join(mThread, NULL);
+
+    pthread_mutex_lock(&mLock);
+    mStarted = false;
+    mQuitting = false;
+    pthread_mutex_unlock(&mLock);
+}
+
+void EventLoop::wakeUp()
+{
+#ifndef _MSC_VER
+    if (mWakeUpFds[1] != -1) {
+        char value = 0;
+        // The pipe is non-blocking: when it's full, the thread will wake up anyway.
+        if (write(mWakeUpFds[1], &value, 1) == -1) {
+            return;
+        }
+    }
+#endif
+}
+
+void * EventLoop::runOnThread(void * context)
+{
+    ((EventLoop *) context)->run();
+    return NULL;
+}
+
+void EventLoop::run()
+{
+#if defined(__ANDROID) || defined(ANDROID)
+    androidSetupThread();
+#endif
+
+    while (1) {
+        AutoreleasePool * pool = new AutoreleasePool();
+
+        pthread_mutex_lock(&mLock);
+        bool quitting = mQuitting;
+        time_t interval = mTimerInterval;
+        // The events of the previous wait have all been dispatched.
+        freeRemovedSources();
+        pthread_mutex_unlock(&mLock);
+        if (quitting) {
+            pool->release();
+            break;
+        }
+
+        time_t remaining = mLastTimerDate + interval - time(NULL);
+        if (remaining < 0) {
+            remaining = 0;
+        }
+        Source * readySources[MAX_READY_FDS];
+        int readyEvents[MAX_READY_FDS];
+        int count = waitForEvents(readySources, readyEvents, MAX_READY_FDS, (int) remaining * 1000);
+        for(int i = 0 ; i < count ; i ++) {
+            if (readySources[i] == NULL) {
+#ifndef _MSC_VER
+                char buffer[64];
+                while (read(mWakeUpFds[0], buffer, sizeof(buffer)) > 0) {
+                }
+#endif
+                continue;
+            }
+            dispatch(readySources[i], readyEvents[i]);
+        }
+
+        if (time(NULL) >= mLastTimerDate + interval) {
+            mLastTimerDate = time(NULL);
+            dispatchTimer();
+        }
+
+        pool->release();
+    }
+
+#if defined(__ANDROID) || defined(ANDROID)
+    androidUnsetupThread();
+#endif
+}
+
+// The last entry is the wake-up pipe, which has no source.
+void EventLoop::updatePollFdsIfNeeded()
+{
+    pthread_mutex_lock(&mLock);
+    if (!mPollFdsChanged) {
+        pthread_mutex_unlock(&mLock);
+        return;
+    }
+    if (mSourcesCount + 1 > mPollFdsCapacity) {
+        mPollFdsCapacity = mSourcesCount + 1;
+        mPollFds = (struct pollfd *) realloc(mPollFds, sizeof(* mPollFds) * mPollFdsCapacity);
+        mPollSources = (Source **) realloc(mPollSources, sizeof(* mPollSources) * mPollFdsCapacity);
+    }
+    mPollFdsCount = 0;
+    for(unsigned int i = 0 ; i < mSourcesCount ; i ++) {
+        mPollFds[mPollFdsCount].fd = mSources[i]->fd;
+        mPollFds[mPollFdsCount].events = mSources[i]->waitsForWritability ? (POLLIN | POLLOUT) : POLLIN;
+        mPollSources[mPollFdsCount] = mSources[i];
+        mPollFdsCount ++;
+    }
+    if (mWakeUpFds[0] != -1) {
+        mPollFds[mPollFdsCount].fd = mWakeUpFds[0];
+        mPollFds[mPollFdsCount].events = POLLIN;
+        mPollSources[mPollFdsCount] = NULL;
+        mPollFdsCount ++;
+    }
+    mPollFdsChanged = false;
+    pthread_mutex_unlock(&mLock);
+}
+
+int EventLoop::waitForEvents(Source ** readySources, int * readyEvents, int maxReadySources, int timeout)
+{
+#if defined(__linux__)
+    struct epoll_event events[MAX_READY_FDS];
+    if (maxReadySources > MAX_READY_FDS) {
+        maxReadySources = MAX_READY_FDS;
+    }
+    int r = epoll_wait(mPollFd, events, maxReadySources, timeout);
+    if (r < 0) {
+        return 0;
+    }
+    for(int i = 0 ; i < r ; i ++) {
+        readySources[i] = (Source *) events[i].data.ptr;
+        readyEvents[i] = 0;
+        if ((events[i].events & EPOLLOUT) != 0) {
+            readyEvents[i] |= EVENT_WRITABLE;
+        }
+        if ((events[i].events & ~EPOLLOUT) != 0) {
+            readyEvents[i] |= EVENT_READABLE;
+        }
+    }
+    return r;
+#else
+    updatePollFdsIfNeeded();
+    for(unsigned int i = 0 ; i < mPollFdsCount ; i ++) {
+        mPollFds[i].revents = 0;
+    }
+#ifdef _MSC_VER
+    // There's no wake-up pipe: changes are taken into account after at most one second.
+    if ((timeout < 0) || (timeout > 1000)) {
+        timeout = 1000;
+    }
+    int r = WSAPoll(mPollFds, mPollFdsCount, timeout);
+#else
+    int r = poll(mPollFds, mPollFdsCount, timeout);
+#endif
+    int count = 0;
+    for(unsigned int i = 0 ; (r > 0) && (i < mPollFdsCount) && (count < maxReadySources) ; i ++) {
+        if (mPollFds[i].revents != 0) {
+            readySources[count] = mPollSources[i];
+            readyEvents[count] = 0;
+            if ((mPollFds[i].revents & POLLOUT) != 0) {
+                readyEvents[count] |= EVENT_WRITABLE;
+            }
+            if ((mPollFds[i].revents & ~POLLOUT) != 0) {
+                readyEvents[count] |= EVENT_READABLE;
+            }
+            count ++;
+        }
+    }
+    return count;
+#endif
+}
+
+void EventLoop::dispatch(Source * source, int events)
+{
+    pthread_mutex_lock(&mLock);
+    if (source->removed) {
+        pthread_mutex_unlock(&mLock);
+        return;
+    }
+    EventLoopCallback * callback = source->callback;
+    int fd = source->fd;
+    mDispatchingSource = source;
+    pthread_mutex_unlock(&mLock);
+
+    if ((events & EVENT_WRITABLE) != 0) {
+        callback->eventLoopFileDescriptorWritable(this, fd);
+    }
+    if ((events & EVENT_READABLE) != 0) {
+        // The file descriptor may have been removed by the first callback.
+        pthread_mutex_lock(&mLock);
+        bool removed = source->removed;
+        pthread_mutex_unlock(&mLock);
+        if (!removed) {
+            callback->eventLoopFileDescriptorReady(this, fd);
+        }
+    }
+
+    pthread_mutex_lock(&mLock);
+    mDispatchingSource = NULL;
+    pthread_cond_broadcast(&mDispatchCond);
+    pthread_mutex_unlock(&mLock);
+}
+
+void EventLoop::dispatchTimer()
+{
+    // The sources removed meanwhile are not freed before the next iteration of the loop.
+    pthread_mutex_lock(&mLock);
+    unsigned int sourcesCount = mSourcesCount;
+    Source ** sources = (Source **) malloc(sizeof(* sources) * (sourcesCount + 1));
+    memcpy(sources, mSources, sizeof(* sources) * sourcesCount);
+    pthread_mutex_unlock(&mLock);
+
+    for(unsigned int i = 0 ; i < sourcesCount ; i ++) {
+        pthread_mutex_lock(&mLock);
+        if (sources[i]->removed) {
+            pthread_mutex_unlock(&mLock);
+            continue;
+        }
+        EventLoopCallback * callback = sources[i]->callback;
+        mDispatchingSource = sources[i];
+        pthread_mutex_unlock(&mLock);
+
+        callback->eventLoopTimerFired(this);
+
+        pthread_mutex_lock(&mLock);
+        mDispatchingSource = NULL;
+        pthread_cond_broadcast(&mDispatchCond);
+        pthread_mutex_unlock(&mLock);
+    }
+    free(sources);
+}
@@ -0,0 +1,118 @@
+//
+//  MCEventLoop.h
+//  mailcore2
+//
+//  Created by agent on 10/18/26.
+//  Copyright (c) 2026 MailCore. All rights reserved.
+//
+
+#ifndef MAILCORE_MCEVENTLOOP_H
+
+#define MAILCORE_MCEVENTLOOP_H
+
+#include <MailCore/MCObject.h>
+
+#include <pthread.h>
+#include <time.h>
+
+#ifdef __cplusplus
+
+typedef struct chash chash;
+struct pollfd;
+
+namespace mailcore {
+
+    class EventLoop;
+
+    class MAILCORE_EXPORT EventLoopCallback {
+    public:
+        // Called on the thread of the event loop when data can be read from the file descriptor.
+        virtual void eventLoopFileDescriptorReady(EventLoop * loop, int fd) {};
+        // Called on the thread of the event loop when data can be written to the file descriptor, if it has
+        // been requested with EventLoop::setWaitsForWritability().
+        virtual void eventLoopFileDescriptorWritable(EventLoop * loop, int fd) {};
+        // Called on the thread of the event loop every timerInterval() seconds.
+        virtual void eventLoopTimerFired(EventLoop * loop) {};
+    };
+
+    // Waits for many file descriptors on a single thread, using epoll on Linux and poll() otherwise.
+    // File descriptors can be added and removed from any thread.
+    class MAILCORE_EXPORT EventLoop : public Object {
+    public:
+        EventLoop();
+        virtual ~EventLoop();
+
+        static EventLoop * sharedEventLoop();
+
+        // Default is 10 seconds.
+        virtual void setTimerInterval(time_t timerInterval);
+        virtual time_t timerInterval();
+
+        // The thread is started when the first file descriptor is added.
+        virtual void addFileDescriptor(int fd, EventLoopCallback * callback);
+        // Once it returns, the callback won't be called for this file descriptor anymore.
+        virtual void removeFileDescriptor(int fd);
+        // Writability is not watched by default.
+        virtual void setWaitsForWritability(int fd, bool enabled);
+        virtual unsigned int fileDescriptorsCount();
+
+        // Stops the thread and waits for it to finish.
+        virtual void stop();
+
+        // Returns true when called from the thread of the event loop.
+        virtual bool isEventLoopThread();
+
+    private:
+        struct Source {
+            int fd;
+            EventLoopCallback * callback;
+            bool waitsForWritability;
+            // The source is freed by the thread of the event loop once no pending event refers to it.
+            bool removed;
+            // Position in mSources.
+            unsigned int index;
+        };
+
+        pthread_mutex_t mLock;
+        pthread_cond_t mDispatchCond;
+        pthread_t mThread;
+        bool mStarted;
+        bool mQuitting;
+        time_t mTimerInterval;
+        time_t mLastTimerDate;
+        // file descriptor -> Source
+        chash * mSourcesHash;
+        Source ** mSources;
+        unsigned int mSourcesCount;
+        unsigned int mSourcesCapacity;
+        Source ** mRemovedSources;
+        unsigned int mRemovedSourcesCount;
+        unsigned int mRemovedSourcesCapacity;
+        Source * mDispatchingSource;
+        int mPollFd;
+        int mWakeUpFds[2];
+        // Arguments of poll(), set up again only when the sources change.
+        struct pollfd * mPollFds;
+        Source ** mPollSources;
+        unsigned int mPollFdsCount;
+        unsigned int mPollFdsCapacity;
+        bool mPollFdsChanged;
+
+        void init();
+        static void * runOnThread(void * context);
+        void run();
+        void wakeUp();
+        void startThreadIfNeeded();
+        Source * sourceForFileDescriptor(int fd);
+        void freeRemovedSources();
+        void updatePollFdsIfNeeded();
+        int waitForEvents(Source ** readySources, int * readyEvents, int maxReadySources, int timeout);
+        void dispatch(Source * source, int events);
+        void dispatchTimer();
+    };
+
+}
+
+#endif
+
+#endif
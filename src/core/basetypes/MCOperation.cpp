@@ -1,5 +1,7 @@
 #include "MCOperation.h"
 
+#include "MCOperationTiming.h"
+
 using namespace mailcore;
 
 Operation::Operation()
@@ -7,6 +9,7 @@ Operation::Operation()
     mCallback = NULL;
     mCancelled = false;
     mShouldRunWhenCancelled = false;
+    mTiming = NULL;
     pthread_mutex_init(&mLock, NULL);
 #if __APPLE__
     mCallbackDispatchQueue = dispatch_get_main_queue();
@@ -20,6 +23,7 @@ Operation::~Operation()
         dispatch_release(mCallbackDispatchQueue);
     }
 #endif
+    MC_SAFE_RELEASE(mTiming);
     pthread_mutex_destroy(&mLock);
 }
 
@@ -59,6 +63,16 @@ void Operation::setShouldRunWhenCancelled(bool shouldRunWhenCancelled)
     mShouldRunWhenCancelled = shouldRunWhenCancelled;
 }
 
+void Operation::setTiming(OperationTiming * timing)
+{
+    MC_SAFE_REPLACE_RETAIN(OperationTiming, mTiming, timing);
+}
+
+OperationTiming * Operation::timing()
+{
+    return mTiming;
+}
+
 void Operation::beforeMain()
 {
 }
@@ -67,6 +81,14 @@ void Operation::main()
 {
 }
 
+void Operation::mainWillStart()
+{
+}
+
+void Operation::mainFinished()
+{
+}
+
 void Operation::afterMain()
 {
 }
@@ -10,6 +10,7 @@
 namespace mailcore {
     
     class OperationCallback;
+    class OperationTiming;
     
     class MAILCORE_EXPORT Operation : public Object {
     public:
@@ -25,8 +26,15 @@ namespace mailcore {
         // Will be called on main thread.
         virtual void beforeMain();
         
+        // Will be called on the thread of the queue right before main().
+        virtual void mainWillStart();
+        
         virtual void main();
         
+        // Will be called on the thread of the queue once main() returned, or when main() has been skipped
+        // because the operation was cancelled.
+        virtual void mainFinished();
+        
         // Will be called on main thread.
         virtual void afterMain();
         
@@ -41,10 +49,15 @@ namespace mailcore {
         virtual bool shouldRunWhenCancelled();
         virtual void setShouldRunWhenCancelled(bool shouldRunWhenCancelled);
         
+        // Timestamps are collected only when a timing object has been set.
+        virtual void setTiming(OperationTiming * timing);
+        virtual OperationTiming * timing();
+        
     private:
         OperationCallback * mCallback;
         bool mCancelled;
         bool mShouldRunWhenCancelled;
+        OperationTiming * mTiming;
         pthread_mutex_t mLock;
 #ifdef __APPLE__
         dispatch_queue_t mCallbackDispatchQueue;
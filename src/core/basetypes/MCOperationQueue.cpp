@@ -12,6 +12,7 @@
 #include "MCAutoreleasePool.h"
 #include "MCMainThreadAndroid.h"
 #include "MCAssert.h"
+#include "MCOperationTiming.h"
 
 using namespace mailcore;
 
@@ -50,6 +51,9 @@ OperationQueue::~OperationQueue()
 
 void OperationQueue::addOperation(Operation * op)
 {
+    if (op->timing() != NULL) {
+        op->timing()->markEnqueued();
+    }
     pthread_mutex_lock(&mLock);
     mOperations->addObject(op);
     pthread_mutex_unlock(&mLock);
@@ -117,8 +121,16 @@ void OperationQueue::runOperations()
         performOnCallbackThread(op, (Object::Method) &OperationQueue::beforeMain, op, true);
         
         if (!op->isCancelled() || op->shouldRunWhenCancelled()) {
+            op->mainWillStart();
+            if (op->timing() != NULL) {
+                op->timing()->markStarted();
+            }
             op->main();
+            if (op->timing() != NULL) {
+                op->timing()->markFinished();
+            }
         }
+        op->mainFinished();
         
         op->retain()->autorelease();
         
@@ -182,6 +194,10 @@ void OperationQueue::callbackOnMainThread(Operation * op)
     if (op->callback() != NULL) {
         op->callback()->operationFinished(op);
     }
+    
+    if (op->timing() != NULL) {
+        op->timing()->markCallbackFinished();
+    }
 }
 
 void OperationQueue::checkRunningOnMainThread(void * context)
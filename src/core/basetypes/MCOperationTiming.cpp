@@ -0,0 +1,202 @@
+//
+//  MCOperationTiming.cpp
+//  mailcore2
+//
+//  Created by agent on 10/18/26.
+//  Copyright (c) 2026 MailCore. All rights reserved.
+//
+
+#include "MCWin32.h" // should be included first.
+
+#include "MCOperationTiming.h"
+
+#include <sys/time.h>
+
+#include "MCDefines.h"
+#include "MCString.h"
+#include "MCUtils.h"
+#include "MCOperationTimingStatistics.h"
+
+using namespace mailcore;
+
+OperationTiming::OperationTiming()
+{
+    mName = NULL;
+    mStatistics = NULL;
+    mEnqueueTime = 0;
+    mStartTime = 0;
+    mFirstByteTime = 0;
+    mFinishTime = 0;
+    mCallbackTime = 0;
+    for(unsigned int i = 0 ; i < OperationTimingPhaseCount ; i ++) {
+        mPhaseDurations[i] = 0;
+    }
+    mBytesReceived = 0;
+    mBytesSent = 0;
+}
+
+OperationTiming::~OperationTiming()
+{
+    MC_SAFE_RELEASE(mStatistics);
+    MC_SAFE_RELEASE(mName);
+}
+
+double OperationTiming::currentTime()
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (double) tv.tv_sec + (double) tv.tv_usec / 1000000.;
+}
+
+void OperationTiming::setName(String * name)
+{
+    MC_SAFE_REPLACE_COPY(String, mName, name);
+}
+
+String * OperationTiming::name()
+{
+    return mName;
+}
+
+void OperationTiming::setStatistics(OperationTimingStatistics * statistics)
+{
+    MC_SAFE_REPLACE_RETAIN(OperationTimingStatistics, mStatistics, statistics);
+}
+
+OperationTimingStatistics * OperationTiming::statistics()
+{
+    return mStatistics;
+}
+
+void OperationTiming::markEnqueued()
+{
+    mEnqueueTime = currentTime();
+}
+
+void OperationTiming::markStarted()
+{
+    mStartTime = currentTime();
+}
+
+void OperationTiming::markFinished()
+{
+    mFinishTime = currentTime();
+}
+
+void OperationTiming::markCallbackFinished()
+{
+    mCallbackTime = currentTime();
+    if (mStatistics != NULL) {
+        mStatistics->addTiming(this);
+    }
+}
+
+void OperationTiming::addBytesReceived(size_t size)
+{
+    if ((mFirstByteTime == 0) && (mStartTime != 0)) {
+        mFirstByteTime = currentTime();
+    }
+    mBytesReceived += size;
+}
+
+void OperationTiming::addBytesSent(size_t size)
+{
+    mBytesSent += size;
+}
+
+void OperationTiming::addPhaseDuration(OperationTimingPhase phase, double duration)
+{
+    mPhaseDurations[phase] += duration;
+}
+
+double OperationTiming::enqueueTime()
+{
+    return mEnqueueTime;
+}
+
+double OperationTiming::startTime()
+{
+    return mStartTime;
+}
+
+double OperationTiming::firstByteTime()
+{
+    return mFirstByteTime;
+}
+
+double OperationTiming::finishTime()
+{
+    return mFinishTime;
+}
+
+double OperationTiming::callbackTime()
+{
+    return mCallbackTime;
+}
+
+double OperationTiming::queueWaitDuration()
+{
+    if ((mEnqueueTime == 0) || (mStartTime == 0)) {
+        return 0;
+    }
+    return mStartTime - mEnqueueTime;
+}
+
+double OperationTiming::runDuration()
+{
+    if ((mStartTime == 0) || (mFinishTime == 0)) {
+        return 0;
+    }
+    return mFinishTime - mStartTime;
+}
+
+double OperationTiming::firstByteDelay()
+{
+    if ((mStartTime == 0) || (mFirstByteTime == 0)) {
+        return 0;
+    }
+    return mFirstByteTime - mStartTime;
+}
+
+double OperationTiming::callbackDelay()
+{
+    if ((mFinishTime == 0) || (mCallbackTime == 0)) {
+        return 0;
+    }
+    return mCallbackTime - mFinishTime;
+}
+
+double OperationTiming::phaseDuration(OperationTimingPhase phase)
+{
+    return mPhaseDurations[phase];
+}
+
+uint64_t OperationTiming::bytesReceived()
+{
+    return mBytesReceived;
+}
+
+uint64_t OperationTiming::bytesSent()
+{
+    return mBytesSent;
+}
+
+String * OperationTiming::description()
+{
+    String * result = String::string();
+    result->appendUTF8Format("<%s:%p %s queue: %.3fs, run: %.3fs, first byte: %.3fs, connect: %.3fs, login: %.3fs, select: %.3fs, parse: %.3fs, callback: %.3fs, received: %llu, sent: %llu>",
+                             className()->UTF8Characters(),
+                             this,
+                             mName != NULL ? mName->UTF8Characters() : "",
+                             queueWaitDuration(),
+                             runDuration(),
+                             firstByteDelay(),
+                             mPhaseDurations[OperationTimingPhaseConnect],
+                             mPhaseDurations[OperationTimingPhaseLogin],
+                             mPhaseDurations[OperationTimingPhaseSelect],
+                             mPhaseDurations[OperationTimingPhaseParse],
+                             callbackDelay(),
+                             (unsigned long long) mBytesReceived,
+                             (unsigned long long) mBytesSent);
+    return result;
+}
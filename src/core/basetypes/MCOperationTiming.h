@@ -0,0 +1,91 @@
+//
+//  MCOperationTiming.h
+//  mailcore2
+//
+//  Created by agent on 10/18/26.
+//  Copyright (c) 2026 MailCore. All rights reserved.
+//
+
+#ifndef MAILCORE_MCOPERATIONTIMING_H
+
+#define MAILCORE_MCOPERATIONTIMING_H
+
+#include <MailCore/MCObject.h>
+
+#ifdef __cplusplus
+
+#include <inttypes.h>
+
+namespace mailcore {
+
+    class String;
+    class OperationTimingStatistics;
+
+    enum OperationTimingPhase {
+        OperationTimingPhaseConnect,
+        OperationTimingPhaseLogin,
+        OperationTimingPhaseSelect,
+        OperationTimingPhaseParse,
+        OperationTimingPhaseCount,
+    };
+
+    // Timestamps are in seconds. A timestamp is 0 when the event didn't happen.
+    class MAILCORE_EXPORT OperationTiming : public Object {
+    public:
+        OperationTiming();
+        virtual ~OperationTiming();
+
+        static double currentTime();
+
+        virtual void setName(String * name);
+        virtual String * name();
+
+        // When set, the timing is added to the statistics once the callback has been called.
+        virtual void setStatistics(OperationTimingStatistics * statistics);
+        virtual OperationTimingStatistics * statistics();
+
+        virtual void markEnqueued();
+        virtual void markStarted();
+        virtual void markFinished();
+        virtual void markCallbackFinished();
+
+        virtual void addBytesReceived(size_t size);
+        virtual void addBytesSent(size_t size);
+        virtual void addPhaseDuration(OperationTimingPhase phase, double duration);
+
+        virtual double enqueueTime();
+        virtual double startTime();
+        virtual double firstByteTime();
+        virtual double finishTime();
+        virtual double callbackTime();
+
+        virtual double queueWaitDuration();
+        virtual double runDuration();
+        virtual double firstByteDelay();
+        virtual double callbackDelay();
+        virtual double phaseDuration(OperationTimingPhase phase);
+
+        virtual uint64_t bytesReceived();
+        virtual uint64_t bytesSent();
+
+    public: // subclass behavior
+        virtual String * description();
+
+    private:
+        String * mName;
+        OperationTimingStatistics * mStatistics;
+        double mEnqueueTime;
+        double mStartTime;
+        double mFirstByteTime;
+        double mFinishTime;
+        double mCallbackTime;
+        double mPhaseDurations[OperationTimingPhaseCount];
+        uint64_t mBytesReceived;
+        uint64_t mBytesSent;
+    };
+
+}
+
+#endif
+
+#endif
@@ -0,0 +1,191 @@
+//
+//  MCOperationTimingStatistics.cpp
+//  mailcore2
+//
+//  Created by agent on 10/18/26.
+//  Copyright (c) 2026 MailCore. All rights reserved.
+//
+
+#include "MCWin32.h" // should be included first.
+
+#include "MCOperationTimingStatistics.h"
+
+#include "MCDefines.h"
+#include "MCString.h"
+#include "MCArray.h"
+#include "MCHashMap.h"
+#include "MCValue.h"
+#include "MCJSON.h"
+#include "MCUtils.h"
+#include "MCIterator.h"
+#include "MCOperationTiming.h"
+
+using namespace mailcore;
+
+enum {
+    METRIC_QUEUE_WAIT,
+    METRIC_RUN,
+    METRIC_FIRST_BYTE,
+    METRIC_CONNECT,
+    METRIC_LOGIN,
+    METRIC_SELECT,
+    METRIC_PARSE,
+    METRIC_CALLBACK,
+    METRIC_COUNT,
+};
+
+#define BUCKETS_COUNT 20
+
+static const char * metricNames[METRIC_COUNT] = {
+    "queueWait",
+    "run",
+    "firstByte",
+    "connect",
+    "login",
+    "select",
+    "parse",
+    "callback",
+};
+
+namespace mailcore {
+
+    class OperationTimingHistogram : public Object {
+    public:
+        OperationTimingHistogram() {
+            mCount = 0;
+            mBytesReceived = 0;
+            mBytesSent = 0;
+            for(unsigned int i = 0 ; i < METRIC_COUNT ; i ++) {
+                mTotals[i] = 0;
+                for(unsigned int k = 0 ; k < BUCKETS_COUNT ; k ++) {
+                    mBuckets[i][k] = 0;
+                }
+            }
+        }
+
+        virtual ~OperationTimingHistogram() {
+        }
+
+        virtual void addTiming(OperationTiming * timing) {
+            double values[METRIC_COUNT];
+            values[METRIC_QUEUE_WAIT] = timing->queueWaitDuration();
+            values[METRIC_RUN] = timing->runDuration();
+            values[METRIC_FIRST_BYTE] = timing->firstByteDelay();
+            values[METRIC_CONNECT] = timing->phaseDuration(OperationTimingPhaseConnect);
+            values[METRIC_LOGIN] = timing->phaseDuration(OperationTimingPhaseLogin);
+            values[METRIC_SELECT] = timing->phaseDuration(OperationTimingPhaseSelect);
+            values[METRIC_PARSE] = timing->phaseDuration(OperationTimingPhaseParse);
+            values[METRIC_CALLBACK] = timing->callbackDelay();
+
+            mCount ++;
+            mBytesReceived += timing->bytesReceived();
+            mBytesSent += timing->bytesSent();
+            for(unsigned int i = 0 ; i < METRIC_COUNT ; i ++) {
+                mTotals[i] += values[i];
+                mBuckets[i][bucketForDuration(values[i])] ++;
+            }
+        }
+
+        virtual HashMap * info() {
+            HashMap * result = HashMap::hashMap();
+            result->setObjectForKey(MCSTR("count"), Value::valueWithUnsignedIntValue(mCount));
+            result->setObjectForKey(MCSTR("bytesReceived"), Value::valueWithUnsignedLongLongValue(mBytesReceived));
+            result->setObjectForKey(MCSTR("bytesSent"), Value::valueWithUnsignedLongLongValue(mBytesSent));
+            for(unsigned int i = 0 ; i < METRIC_COUNT ; i ++) {
+                HashMap * metric = HashMap::hashMap();
+                Array * histogram = Array::array();
+                for(unsigned int k = 0 ; k < BUCKETS_COUNT ; k ++) {
+                    histogram->addObject(Value::valueWithUnsignedIntValue(mBuckets[i][k]));
+                }
+                metric->setObjectForKey(MCSTR("total"), Value::valueWithDoubleValue(mTotals[i]));
+                metric->setObjectForKey(MCSTR("histogram"), histogram);
+                result->setObjectForKey(String::stringWithUTF8Characters(metricNames[i]), metric);
+            }
+            return result;
+        }
+
+    private:
+        unsigned int mCount;
+        uint64_t mBytesReceived;
+        uint64_t mBytesSent;
+        double mTotals[METRIC_COUNT];
+        unsigned int mBuckets[METRIC_COUNT][BUCKETS_COUNT];
+
+        static unsigned int bucketForDuration(double duration) {
+            unsigned int bucket = 0;
+            double limit = 0.001;
+            while ((duration >= limit) && (bucket < BUCKETS_COUNT - 1)) {
+                limit *= 2;
+                bucket ++;
+            }
+            return bucket;
+        }
+    };
+
+}
+
+OperationTimingStatistics::OperationTimingStatistics()
+{
+    mHistograms = new HashMap();
+    pthread_mutex_init(&mLock, NULL);
+}
+
+OperationTimingStatistics::~OperationTimingStatistics()
+{
+    pthread_mutex_destroy(&mLock);
+    MC_SAFE_RELEASE(mHistograms);
+}
+
+void OperationTimingStatistics::addTiming(OperationTiming * timing)
+{
+    // Operations that never went through a queue are not accounted.
+    if (timing->startTime() == 0) {
+        return;
+    }
+
+    String * name = timing->name();
+    if (name == NULL) {
+        name = MCSTR("");
+    }
+
+    pthread_mutex_lock(&mLock);
+    OperationTimingHistogram * histogram = (OperationTimingHistogram *) mHistograms->objectForKey(name);
+    if (histogram == NULL) {
+        histogram = new OperationTimingHistogram();
+        mHistograms->setObjectForKey(name, histogram);
+        histogram->release();
+    }
+    histogram->addTiming(timing);
+    pthread_mutex_unlock(&mLock);
+}
+
+void OperationTimingStatistics::reset()
+{
+    pthread_mutex_lock(&mLock);
+    mHistograms->removeAllObjects();
+    pthread_mutex_unlock(&mLock);
+}
+
+HashMap * OperationTimingStatistics::histograms()
+{
+    HashMap * result = HashMap::hashMap();
+    pthread_mutex_lock(&mLock);
+    mc_foreachhashmapKeyAndValue(String, name, OperationTimingHistogram, histogram, mHistograms) {
+        result->setObjectForKey(name, histogram->info());
+    }
+    pthread_mutex_unlock(&mLock);
+    return result;
+}
+
+String * OperationTimingStatistics::JSONString()
+{
+    return JSON::objectToJSONString(histograms());
+}
+
+String * OperationTimingStatistics::description()
+{
+    String * result = String::string();
+    result->appendUTF8Format("<%s:%p %s>", className()->UTF8Characters(), this,
+                             MCUTF8(JSONString()));
+    return result;
+}
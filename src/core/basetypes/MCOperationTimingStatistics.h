@@ -0,0 +1,51 @@
+//
+//  MCOperationTimingStatistics.h
+//  mailcore2
+//
+//  Created by agent on 10/18/26.
+//  Copyright (c) 2026 MailCore. All rights reserved.
+//
+
+#ifndef MAILCORE_MCOPERATIONTIMINGSTATISTICS_H
+
+#define MAILCORE_MCOPERATIONTIMINGSTATISTICS_H
+
+#include <pthread.h>
+#include <MailCore/MCObject.h>
+
+#ifdef __cplusplus
+
+namespace mailcore {
+
+    class String;
+    class HashMap;
+    class OperationTiming;
+
+    // Aggregates timings per operation name into histograms.
+    // Buckets are powers of two in milliseconds: bucket 0 is below 1ms, bucket n covers [2^(n-1), 2^n[ ms.
+    // It can be read from any thread.
+    class MAILCORE_EXPORT OperationTimingStatistics : public Object {
+    public:
+        OperationTimingStatistics();
+        virtual ~OperationTimingStatistics();
+
+        virtual void addTiming(OperationTiming * timing);
+        virtual void reset();
+
+        // operation name -> { "count", "bytesReceived", "bytesSent", metric -> { "total", "histogram" } }
+        virtual HashMap * histograms();
+        virtual String * JSONString();
+
+    public: // subclass behavior
+        virtual String * description();
+
+    private:
+        HashMap * mHistograms;
+        pthread_mutex_t mLock;
+    };
+
+}
+
+#endif
+
+#endif
@@ -10,10 +10,24 @@
 #include <MailCore/MCIMAPNamespaceItem.h>
 #include <MailCore/MCIMAPPart.h>
 #include <MailCore/MCIMAPProgressCallback.h>
+#include <MailCore/MCIMAPMessageStreamCallback.h>
 #include <MailCore/MCIMAPSearchExpression.h>
+#include <MailCore/MCIMAPSearchResult.h>
+#include <MailCore/MCIMAPNotifyEvent.h>
+#include <MailCore/MCIMAPResponseBuffer.h>
+#include <MailCore/MCIMAPBodyCache.h>
+#include <MailCore/MCIMAPSearchIndex.h>
+#include <MailCore/MCIMAPSearchEvaluator.h>
+#include <MailCore/MCIMAPMessageTable.h>
+#include <MailCore/MCIMAPBodyStructure.h>
 #include <MailCore/MCIMAPSession.h>
 #include <MailCore/MCIMAPSyncResult.h>
 #include <MailCore/MCIMAPFolderStatus.h>
+#include <MailCore/MCIMAPAppendItem.h>
+#include <MailCore/MCIMAPFolderMirror.h>
+#include <MailCore/MCIMAPGmailMirror.h>
+#include <MailCore/MCIMAPSortCriterion.h>
+#include <MailCore/MCIMAPThread.h>
 #include <MailCore/MCIMAPIdentity.h>
 
 #endif
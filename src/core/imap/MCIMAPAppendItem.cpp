@@ -0,0 +1,112 @@
+//
+//  MCIMAPAppendItem.cpp
+//  mailcore2
+//
+//  Created by agent on 10/18/26.
+//  Copyright (c) 2026 MailCore. All rights reserved.
+//
+
+#include "MCIMAPAppendItem.h"
+
+using namespace mailcore;
+
+void IMAPAppendItem::init()
+{
+    mMessageData = NULL;
+    mMessageFilepath = NULL;
+    mFlags = MessageFlagNone;
+    mCustomFlags = NULL;
+    mDate = (time_t) -1;
+}
+
+IMAPAppendItem::IMAPAppendItem()
+{
+    init();
+}
+
+IMAPAppendItem::IMAPAppendItem(IMAPAppendItem * other)
+{
+    init();
+    setMessageData(other->messageData());
+    setMessageFilepath(other->messageFilepath());
+    setFlags(other->flags());
+    setCustomFlags(other->customFlags());
+    setDate(other->date());
+}
+
+IMAPAppendItem::~IMAPAppendItem()
+{
+    MC_SAFE_RELEASE(mMessageData);
+    MC_SAFE_RELEASE(mMessageFilepath);
+    MC_SAFE_RELEASE(mCustomFlags);
+}
+
+Object * IMAPAppendItem::copy()
+{
+    return new IMAPAppendItem(this);
+}
+
+void IMAPAppendItem::setMessageData(Data * messageData)
+{
+    MC_SAFE_REPLACE_RETAIN(Data, mMessageData, messageData);
+}
+
+Data * IMAPAppendItem::messageData()
+{
+    return mMessageData;
+}
+
+void IMAPAppendItem::setMessageFilepath(String * path)
+{
+    MC_SAFE_REPLACE_COPY(String, mMessageFilepath, path);
+}
+
+String * IMAPAppendItem::messageFilepath()
+{
+    return mMessageFilepath;
+}
+
+void IMAPAppendItem::setFlags(MessageFlag flags)
+{
+    mFlags = flags;
+}
+
+MessageFlag IMAPAppendItem::flags()
+{
+    return mFlags;
+}
+
+void IMAPAppendItem::setCustomFlags(Array * customFlags)
+{
+    MC_SAFE_REPLACE_COPY(Array, mCustomFlags, customFlags);
+}
+
+Array * IMAPAppendItem::customFlags()
+{
+    return mCustomFlags;
+}
+
+void IMAPAppendItem::setDate(time_t date)
+{
+    mDate = date;
+}
+
+time_t IMAPAppendItem::date()
+{
+    return mDate;
+}
+
+String * IMAPAppendItem::description()
+{
+    String * result = String::string();
+    result->appendUTF8Format("<%s:%p ", MCUTF8(className()), this);
+    if (mMessageFilepath != NULL) {
+        result->appendUTF8Format("path: %s", MCUTF8(mMessageFilepath));
+    }
+    else if (mMessageData != NULL) {
+        result->appendUTF8Format("length: %u", mMessageData->length());
+    }
+    result->appendUTF8Format(" flags: %i", (int) mFlags);
+    result->appendUTF8Characters(">");
+    return result;
+}
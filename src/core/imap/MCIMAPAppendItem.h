@@ -0,0 +1,62 @@
+//
+//  MCIMAPAppendItem.h
+//  mailcore2
+//
+//  Created by agent on 10/18/26.
+//  Copyright (c) 2026 MailCore. All rights reserved.
+//
+
+#ifndef MAILCORE_MCIMAPAPPENDITEM_H
+
+#define MAILCORE_MCIMAPAPPENDITEM_H
+
+#include <MailCore/MCBaseTypes.h>
+#include <MailCore/MCMessageConstants.h>
+
+#ifdef __cplusplus
+
+namespace mailcore {
+    
+    // A message to append with IMAPSession::appendMessages().
+    // The content of the message is either messageData or the file at messageFilepath.
+    class MAILCORE_EXPORT IMAPAppendItem : public Object {
+    public:
+        IMAPAppendItem();
+        virtual ~IMAPAppendItem();
+        
+        virtual void setMessageData(Data * messageData);
+        virtual Data * messageData();
+        
+        virtual void setMessageFilepath(String * path);
+        virtual String * messageFilepath();
+        
+        virtual void setFlags(MessageFlag flags);
+        virtual MessageFlag flags();
+        
+        virtual void setCustomFlags(Array * customFlags);
+        virtual Array * customFlags();
+        
+        // (time_t) -1 when the server should use the current date.
+        virtual void setDate(time_t date);
+        virtual time_t date();
+        
+    public: // subclass behavior
+        IMAPAppendItem(IMAPAppendItem * other);
+        virtual Object * copy();
+        virtual String * description();
+        
+    private:
+        Data * mMessageData;
+        String * mMessageFilepath;
+        MessageFlag mFlags;
+        Array * mCustomFlags;
+        time_t mDate;
+        
+        void init();
+    };
+    
+}
+
+#endif
+
+#endif
@@ -0,0 +1,701 @@
+//
+//  MCIMAPBodyCache.cpp
+//  mailcore2
+//
+//  Created by agent on 10/18/26.
+//  Copyright (c) 2026 MailCore. All rights reserved.
+//
+
+#include "MCWin32.h" // should be included first.
+
+#include "MCIMAPBodyCache.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#ifndef _MSC_VER
+#include <unistd.h>
+#endif
+
+#include "MCDefines.h"
+#include "MCJSON.h"
+#include "MCMD5.h"
+
+using namespace mailcore;
+
+enum {
+    INDEX_VERSION = 1,
+    // Number of changes after which the index is saved.
+    SAVE_CHANGES_COUNT = 32,
+};
+
+namespace mailcore {
+    class IMAPBodyCacheBlob : public Object {
+    public:
+        IMAPBodyCacheBlob(unsigned int size, uint64_t lastAccess) {
+            mSize = size;
+            mLastAccess = lastAccess;
+            mPinsCount = 0;
+            mRemoved = false;
+        }
+
+        unsigned int mSize;
+        uint64_t mLastAccess;
+        // A pinned content is being read: its file is removed once it's unpinned.
+        unsigned int mPinsCount;
+        bool mRemoved;
+    };
+}
+
+static bool isObjectOfClass(Object * object, const char * name)
+{
+    return (object != NULL) && (strcmp(MCUTF8(object->className()), name) == 0);
+}
+
+static int compareBlobsAccess(void * a, void * b, void * context)
+{
+    HashMap * blobs = (HashMap *) context;
+    IMAPBodyCacheBlob * blobA = (IMAPBodyCacheBlob *) blobs->objectForKey((String *) a);
+    IMAPBodyCacheBlob * blobB = (IMAPBodyCacheBlob *) blobs->objectForKey((String *) b);
+    if (blobA->mLastAccess < blobB->mLastAccess) {
+        return -1;
+    }
+    else if (blobA->mLastAccess > blobB->mLastAccess) {
+        return 1;
+    }
+    return 0;
+}
+
+static void makeDirectory(String * path)
+{
+#ifdef _MSC_VER
+    mkdir(path->fileSystemRepresentation());
+#else
+    mkdir(path->fileSystemRepresentation(), 0700);
+#endif
+}
+
+static ErrorCode replaceFile(String * temporaryPath, String * path)
+{
+    if (rename(temporaryPath->fileSystemRepresentation(), path->fileSystemRepresentation()) != 0) {
+        // rename() doesn't replace an existing file on Windows.
+        unlink(path->fileSystemRepresentation());
+        if (rename(temporaryPath->fileSystemRepresentation(), path->fileSystemRepresentation()) != 0) {
+            unlink(temporaryPath->fileSystemRepresentation());
+            return ErrorFile;
+        }
+    }
+    return ErrorNone;
+}
+
+void IMAPBodyCache::init()
+{
+    pthread_mutex_init(&mLock, NULL);
+    mPath = NULL;
+    mMaximumSize = 256 * 1024 * 1024;
+    mMaximumItemSize = 16 * 1024 * 1024;
+    mKeys = new HashMap();
+    mBlobs = new HashMap();
+    mAccessClock = 0;
+    mTotalSize = 0;
+    mChangesCount = 0;
+    mHitsCount = 0;
+    mMissesCount = 0;
+    mBytesSaved = 0;
+    mBytesDeduplicated = 0;
+    mEvictionsCount = 0;
+    mTemporaryFilesCount = 0;
+}
+
+IMAPBodyCache::IMAPBodyCache()
+{
+    init();
+}
+
+IMAPBodyCache::~IMAPBodyCache()
+{
+    MC_SAFE_RELEASE(mBlobs);
+    MC_SAFE_RELEASE(mKeys);
+    MC_SAFE_RELEASE(mPath);
+    pthread_mutex_destroy(&mLock);
+}
+
+void IMAPBodyCache::setPath(String * path)
+{
+    pthread_mutex_lock(&mLock);
+    MC_SAFE_REPLACE_COPY(String, mPath, path);
+    pthread_mutex_unlock(&mLock);
+}
+
+String * IMAPBodyCache::path()
+{
+    return mPath;
+}
+
+void IMAPBodyCache::setMaximumSize(uint64_t maximumSize)
+{
+    pthread_mutex_lock(&mLock);
+    mMaximumSize = maximumSize;
+    evictIfNeeded();
+    pthread_mutex_unlock(&mLock);
+}
+
+uint64_t IMAPBodyCache::maximumSize()
+{
+    return mMaximumSize;
+}
+
+void IMAPBodyCache::setMaximumItemSize(unsigned int maximumItemSize)
+{
+    mMaximumItemSize = maximumItemSize;
+}
+
+unsigned int IMAPBodyCache::maximumItemSize()
+{
+    return mMaximumItemSize;
+}
+
+String * IMAPBodyCache::keyString(String * account, String * folder, uint32_t uidValidity, uint32_t uid, String * partID)
+{
+    return String::stringWithUTF8Format("%s\n%s\n%u\n%u\n%s", MCUTF8(account), MCUTF8(folder),
+                                        (unsigned int) uidValidity, (unsigned int) uid,
+                                        partID != NULL ? MCUTF8(partID) : "");
+}
+
+// Contents are spread in subdirectories named after the first two characters of the digest.
+String * IMAPBodyCache::blobFilename(String * digest)
+{
+    String * directory = mPath->stringByAppendingPathComponent(MCSTR("blobs"));
+    directory = directory->stringByAppendingPathComponent(digest->substringToIndex(2));
+    return directory->stringByAppendingPathComponent(digest);
+}
+
+// Called with the lock held. Marks the content as recently used.
+String * IMAPBodyCache::lookupDigest(String * key)
+{
+    String * digest = (String *) mKeys->objectForKey(key);
+    if (digest == NULL) {
+        return NULL;
+    }
+    IMAPBodyCacheBlob * blob = (IMAPBodyCacheBlob *) mBlobs->objectForKey(digest);
+    if ((blob == NULL) || blob->mRemoved) {
+        mKeys->removeObjectForKey(key);
+        return NULL;
+    }
+    mAccessClock ++;
+    blob->mLastAccess = mAccessClock;
+    return digest;
+}
+
+Data * IMAPBodyCache::dataForKey(String * account, String * folder, uint32_t uidValidity, uint32_t uid,
+                                 String * partID)
+{
+    if ((mPath == NULL) || (uidValidity == 0)) {
+        return NULL;
+    }
+
+    String * key = keyString(account, folder, uidValidity, uid, partID);
+    pthread_mutex_lock(&mLock);
+    String * filename = NULL;
+    IMAPBodyCacheBlob * blob = NULL;
+    String * digest = lookupDigest(key);
+    if (digest != NULL) {
+        filename = blobFilename(digest);
+        // The content can't be evicted while it's read without the lock.
+        blob = (IMAPBodyCacheBlob *) mBlobs->objectForKey(digest);
+        blob->retain();
+        blob->mPinsCount ++;
+    }
+    pthread_mutex_unlock(&mLock);
+
+    Data * data = NULL;
+    if (filename != NULL) {
+        data = Data::dataWithContentsOfFile(filename);
+    }
+
+    pthread_mutex_lock(&mLock);
+    if (data != NULL) {
+        mHitsCount ++;
+        mBytesSaved += data->length();
+    }
+    else {
+        mMissesCount ++;
+        if ((blob != NULL) && (mBlobs->objectForKey(digest) == blob)) {
+            // The file was removed behind our back.
+            removeDigest(digest);
+            changed();
+        }
+    }
+    if (blob != NULL) {
+        unpinBlob(digest, blob);
+    }
+    pthread_mutex_unlock(&mLock);
+
+    return data;
+}
+
+String * IMAPBodyCache::filenameForKey(String * account, String * folder, uint32_t uidValidity, uint32_t uid,
+                                       String * partID)
+{
+    if ((mPath == NULL) || (uidValidity == 0)) {
+        return NULL;
+    }
+
+    String * key = keyString(account, folder, uidValidity, uid, partID);
+    pthread_mutex_lock(&mLock);
+    String * filename = NULL;
+    String * digest = lookupDigest(key);
+    if (digest != NULL) {
+        filename = blobFilename(digest);
+        struct stat stat_info;
+        if (stat(filename->fileSystemRepresentation(), &stat_info) < 0) {
+            // The file was removed behind our back.
+            removeDigest(digest);
+            changed();
+            filename = NULL;
+        }
+    }
+    if (filename != NULL) {
+        IMAPBodyCacheBlob * blob = (IMAPBodyCacheBlob *) mBlobs->objectForKey(digest);
+        blob->retain();
+        blob->mPinsCount ++;
+        mHitsCount ++;
+        mBytesSaved += blob->mSize;
+    }
+    else {
+        mMissesCount ++;
+    }
+    pthread_mutex_unlock(&mLock);
+
+    return filename;
+}
+
+void IMAPBodyCache::unpinFilename(String * filename)
+{
+    String * digest = filename->lastPathComponent();
+    pthread_mutex_lock(&mLock);
+    IMAPBodyCacheBlob * blob = (IMAPBodyCacheBlob *) mBlobs->objectForKey(digest);
+    if ((blob != NULL) && (blob->mPinsCount > 0)) {
+        unpinBlob(digest, blob);
+    }
+    pthread_mutex_unlock(&mLock);
+}
+
+// Called with the lock held.
+void IMAPBodyCache::unpinBlob(String * digest, IMAPBodyCacheBlob * blob)
+{
+    blob->mPinsCount --;
+    if ((blob->mPinsCount == 0) && blob->mRemoved && (mBlobs->objectForKey(digest) == blob)) {
+        removeDigest(digest);
+    }
+    blob->release();
+}
+
+void IMAPBodyCache::setData(Data * data, String * account, String * folder, uint32_t uidValidity, uint32_t uid,
+                            String * partID)
+{
+    if ((mPath == NULL) || (uidValidity == 0) || (data == NULL)) {
+        return;
+    }
+    if (data->length() > mMaximumItemSize) {
+        return;
+    }
+
+    String * key = keyString(account, folder, uidValidity, uid, partID);
+    String * digest = md5String(data);
+
+    pthread_mutex_lock(&mLock);
+    // A removed content that is still pinned has its file: it's used again.
+    bool stored = (mBlobs->objectForKey(digest) != NULL);
+    if (stored) {
+        mBytesDeduplicated += data->length();
+        addBlob(key, digest, data->length());
+    }
+    String * filename = blobFilename(digest);
+    mTemporaryFilesCount ++;
+    String * temporaryPath = String::stringWithUTF8Format("%s.%u.tmp", MCUTF8(filename), mTemporaryFilesCount);
+    pthread_mutex_unlock(&mLock);
+    if (stored) {
+        return;
+    }
+
+    // The file is written without holding the lock. The same content written by two threads
+    // at the same time results in the same file.
+    makeDirectory(mPath);
+    makeDirectory(mPath->stringByAppendingPathComponent(MCSTR("blobs")));
+    makeDirectory(filename->stringByDeletingLastPathComponent());
+    if (data->writeToFile(temporaryPath) != ErrorNone) {
+        unlink(temporaryPath->fileSystemRepresentation());
+        return;
+    }
+    if (replaceFile(temporaryPath, filename) != ErrorNone) {
+        return;
+    }
+
+    pthread_mutex_lock(&mLock);
+    addBlob(key, digest, data->length());
+    pthread_mutex_unlock(&mLock);
+}
+
+void IMAPBodyCache::setDataWithContentsOfFile(String * filename, String * account, String * folder,
+                                              uint32_t uidValidity, uint32_t uid, String * partID)
+{
+    struct stat stat_info;
+    if (stat(filename->fileSystemRepresentation(), &stat_info) < 0) {
+        return;
+    }
+    if ((uint64_t) stat_info.st_size > mMaximumItemSize) {
+        return;
+    }
+    Data * data = Data::dataWithContentsOfFile(filename);
+    if (data == NULL) {
+        return;
+    }
+    setData(data, account, folder, uidValidity, uid, partID);
+}
+
+// Called with the lock held.
+void IMAPBodyCache::addBlob(String * key, String * digest, unsigned int size)
+{
+    mAccessClock ++;
+    IMAPBodyCacheBlob * blob = (IMAPBodyCacheBlob *) mBlobs->objectForKey(digest);
+    if (blob == NULL) {
+        blob = new IMAPBodyCacheBlob(size, mAccessClock);
+        mBlobs->setObjectForKey(digest, blob);
+        blob->release();
+        mTotalSize += size;
+    }
+    else {
+        blob->mLastAccess = mAccessClock;
+        blob->mRemoved = false;
+    }
+    mKeys->setObjectForKey(key, digest);
+    evictIfNeeded();
+    changed();
+}
+
+// Called with the lock held. The keys that point to the content are removed by the caller
+// or ignored on lookup. A pinned content is removed once it's unpinned.
+void IMAPBodyCache::removeDigest(String * digest)
+{
+    IMAPBodyCacheBlob * blob = (IMAPBodyCacheBlob *) mBlobs->objectForKey(digest);
+    if (blob == NULL) {
+        return;
+    }
+    if (blob->mPinsCount > 0) {
+        blob->mRemoved = true;
+        return;
+    }
+    mTotalSize -= blob->mSize;
+    unlink(blobFilename(digest)->fileSystemRepresentation());
+    mBlobs->removeObjectForKey(digest);
+}
+
+// Called with the lock held.
+void IMAPBodyCache::evictIfNeeded()
+{
+    if (mTotalSize <= mMaximumSize) {
+        return;
+    }
+
+    // Remove down to 90% of the budget so that the sort isn't done for each new content.
+    uint64_t targetSize = mMaximumSize - mMaximumSize / 10;
+    Array * digests = mBlobs->allKeys()->sortedArray(compareBlobsAccess, mBlobs);
+    for(unsigned int i = 0 ; (i < digests->count()) && (mTotalSize > targetSize) ; i ++) {
+        String * digest = (String *) digests->objectAtIndex(i);
+        IMAPBodyCacheBlob * blob = (IMAPBodyCacheBlob *) mBlobs->objectForKey(digest);
+        if (blob->mPinsCount > 0) {
+            continue;
+        }
+        removeDigest(digest);
+        mEvictionsCount ++;
+    }
+
+    Array * keys = mKeys->allKeys();
+    mc_foreacharray(String, key, keys) {
+        IMAPBodyCacheBlob * blob = (IMAPBodyCacheBlob *) mBlobs->objectForKey(mKeys->objectForKey(key));
+        if ((blob == NULL) || blob->mRemoved) {
+            mKeys->removeObjectForKey(key);
+        }
+    }
+}
+
+// Called with the lock held.
+void IMAPBodyCache::changed()
+{
+    mChangesCount ++;
+    if (mChangesCount >= SAVE_CHANGES_COUNT) {
+        saveNoLock();
+    }
+}
+
+void IMAPBodyCache::removeFolder(String * account, String * folder)
+{
+    String * prefix = String::stringWithUTF8Format("%s\n%s\n", MCUTF8(account), MCUTF8(folder));
+    pthread_mutex_lock(&mLock);
+    Array * keys = mKeys->allKeys();
+    mc_foreacharray(String, key, keys) {
+        if (key->hasPrefix(prefix)) {
+            mKeys->removeObjectForKey(key);
+        }
+    }
+    // Remove the contents that are not used by other messages.
+    HashMap * usedDigests = HashMap::hashMap();
+    Array * remainingDigests = mKeys->allValues();
+    mc_foreacharray(String, usedDigest, remainingDigests) {
+        usedDigests->setObjectForKey(usedDigest, usedDigest);
+    }
+    Array * digests = mBlobs->allKeys();
+    mc_foreacharray(String, digest, digests) {
+        if (usedDigests->objectForKey(digest) == NULL) {
+            removeDigest(digest);
+        }
+    }
+    changed();
+    pthread_mutex_unlock(&mLock);
+}
+
+void IMAPBodyCache::removeAllData()
+{
+    pthread_mutex_lock(&mLock);
+    if (mPath != NULL) {
+        // The pinned contents are removed once they're unpinned.
+        Array * digests = mBlobs->allKeys();
+        mc_foreacharray(String, digest, digests) {
+            removeDigest(digest);
+        }
+    }
+    else {
+        mBlobs->removeAllObjects();
+        mTotalSize = 0;
+    }
+    mKeys->removeAllObjects();
+    if (mPath != NULL) {
+        saveNoLock();
+    }
+    pthread_mutex_unlock(&mLock);
+}
+
+Data * IMAPBodyCache::serializedIndex()
+{
+    HashMap * blobsInfo = HashMap::hashMap();
+    Array * digests = mBlobs->allKeys();
+    mc_foreacharray(String, digest, digests) {
+        IMAPBodyCacheBlob * blob = (IMAPBodyCacheBlob *) mBlobs->objectForKey(digest);
+        if (blob->mRemoved) {
+            continue;
+        }
+        Array * blobInfo = Array::array();
+        blobInfo->addObject(Value::valueWithUnsignedIntValue(blob->mSize));
+        blobInfo->addObject(Value::valueWithUnsignedLongLongValue(blob->mLastAccess));
+        blobsInfo->setObjectForKey(digest, blobInfo);
+    }
+
+    HashMap * index = HashMap::hashMap();
+    index->setObjectForKey(MCSTR("version"), Value::valueWithUnsignedIntValue(INDEX_VERSION));
+    index->setObjectForKey(MCSTR("clock"), Value::valueWithUnsignedLongLongValue(mAccessClock));
+    index->setObjectForKey(MCSTR("keys"), mKeys);
+    index->setObjectForKey(MCSTR("blobs"), blobsInfo);
+    return JSON::objectToJSONData(index);
+}
+
+ErrorCode IMAPBodyCache::load()
+{
+    MCAssert(mPath != NULL);
+
+    pthread_mutex_lock(&mLock);
+    mKeys->removeAllObjects();
+    mBlobs->removeAllObjects();
+    mAccessClock = 0;
+    mTotalSize = 0;
+    mChangesCount = 0;
+
+    ErrorCode error = ErrorNone;
+    String * indexPath = mPath->stringByAppendingPathComponent(MCSTR("index.json"));
+    Data * data = Data::dataWithContentsOfFile(indexPath);
+    if (data != NULL) {
+        HashMap * index = (HashMap *) JSON::objectFromJSONData(data);
+        Value * version = NULL;
+        Value * clock = NULL;
+        HashMap * blobsInfo = NULL;
+        HashMap * keys = NULL;
+        if (isObjectOfClass(index, "mailcore::HashMap")) {
+            version = (Value *) index->objectForKey(MCSTR("version"));
+            clock = (Value *) index->objectForKey(MCSTR("clock"));
+            blobsInfo = (HashMap *) index->objectForKey(MCSTR("blobs"));
+            keys = (HashMap *) index->objectForKey(MCSTR("keys"));
+        }
+        bool valid = isObjectOfClass(version, "mailcore::Value") && (version->unsignedIntValue() == INDEX_VERSION) &&
+            isObjectOfClass(clock, "mailcore::Value") && isObjectOfClass(blobsInfo, "mailcore::HashMap") &&
+            isObjectOfClass(keys, "mailcore::HashMap");
+        if (valid) {
+            mAccessClock = clock->unsignedLongLongValue();
+            Array * digests = blobsInfo->allKeys();
+            mc_foreacharray(String, digest, digests) {
+                Array * blobInfo = (Array *) blobsInfo->objectForKey(digest);
+                if (!isObjectOfClass(blobInfo, "mailcore::Array") || (blobInfo->count() < 2) ||
+                    !isObjectOfClass(blobInfo->objectAtIndex(0), "mailcore::Value") ||
+                    !isObjectOfClass(blobInfo->objectAtIndex(1), "mailcore::Value") ||
+                    (digest->length() < 2)) {
+                    valid = false;
+                    break;
+                }
+                unsigned int size = ((Value *) blobInfo->objectAtIndex(0))->unsignedIntValue();
+                uint64_t lastAccess = ((Value *) blobInfo->objectAtIndex(1))->unsignedLongLongValue();
+                IMAPBodyCacheBlob * blob = new IMAPBodyCacheBlob(size, lastAccess);
+                mBlobs->setObjectForKey(digest, blob);
+                blob->release();
+                mTotalSize += size;
+            }
+        }
+        if (valid) {
+            Array * allKeys = keys->allKeys();
+            mc_foreacharray(String, key, allKeys) {
+                String * digest = (String *) keys->objectForKey(key);
+                if (!isObjectOfClass(digest, "mailcore::String")) {
+                    valid = false;
+                    break;
+                }
+                if (mBlobs->objectForKey(digest) != NULL) {
+                    mKeys->setObjectForKey(key, digest);
+                }
+            }
+        }
+        if (valid) {
+            evictIfNeeded();
+        }
+        else {
+            MCLog("invalid body cache index %s", MCUTF8(indexPath));
+            mKeys->removeAllObjects();
+            mBlobs->removeAllObjects();
+            mAccessClock = 0;
+            mTotalSize = 0;
+            error = ErrorFile;
+        }
+    }
+    pthread_mutex_unlock(&mLock);
+
+    return error;
+}
+
+ErrorCode IMAPBodyCache::save()
+{
+    pthread_mutex_lock(&mLock);
+    ErrorCode error = saveNoLock();
+    pthread_mutex_unlock(&mLock);
+    return error;
+}
+
+ErrorCode IMAPBodyCache::saveNoLock()
+{
+    MCAssert(mPath != NULL);
+
+    mChangesCount = 0;
+    makeDirectory(mPath);
+    String * indexPath = mPath->stringByAppendingPathComponent(MCSTR("index.json"));
+    // Write to a temporary file first so that an interrupted save doesn't corrupt the index.
+    String * temporaryPath = indexPath->stringByAppendingUTF8Characters(".tmp");
+    ErrorCode error = serializedIndex()->writeToFile(temporaryPath);
+    if (error != ErrorNone) {
+        unlink(temporaryPath->fileSystemRepresentation());
+        return error;
+    }
+    return replaceFile(temporaryPath, indexPath);
+}
+
+unsigned int IMAPBodyCache::hitsCount()
+{
+    pthread_mutex_lock(&mLock);
+    unsigned int result = mHitsCount;
+    pthread_mutex_unlock(&mLock);
+    return result;
+}
+
+unsigned int IMAPBodyCache::missesCount()
+{
+    pthread_mutex_lock(&mLock);
+    unsigned int result = mMissesCount;
+    pthread_mutex_unlock(&mLock);
+    return result;
+}
+
+double IMAPBodyCache::hitRate()
+{
+    pthread_mutex_lock(&mLock);
+    unsigned int total = mHitsCount + mMissesCount;
+    double result = (total == 0) ? 0 : (double) mHitsCount / (double) total;
+    pthread_mutex_unlock(&mLock);
+    return result;
+}
+
+uint64_t IMAPBodyCache::bytesSaved()
+{
+    pthread_mutex_lock(&mLock);
+    uint64_t result = mBytesSaved;
+    pthread_mutex_unlock(&mLock);
+    return result;
+}
+
+uint64_t IMAPBodyCache::bytesDeduplicated()
+{
+    pthread_mutex_lock(&mLock);
+    uint64_t result = mBytesDeduplicated;
+    pthread_mutex_unlock(&mLock);
+    return result;
+}
+
+uint64_t IMAPBodyCache::totalSize()
+{
+    pthread_mutex_lock(&mLock);
+    uint64_t result = mTotalSize;
+    pthread_mutex_unlock(&mLock);
+    return result;
+}
+
+unsigned int IMAPBodyCache::itemsCount()
+{
+    pthread_mutex_lock(&mLock);
+    unsigned int result = mKeys->count();
+    pthread_mutex_unlock(&mLock);
+    return result;
+}
+
+unsigned int IMAPBodyCache::evictionsCount()
+{
+    pthread_mutex_lock(&mLock);
+    unsigned int result = mEvictionsCount;
+    pthread_mutex_unlock(&mLock);
+    return result;
+}
+
+void IMAPBodyCache::resetStatistics()
+{
+    pthread_mutex_lock(&mLock);
+    mHitsCount = 0;
+    mMissesCount = 0;
+    mBytesSaved = 0;
+    mBytesDeduplicated = 0;
+    mEvictionsCount = 0;
+    pthread_mutex_unlock(&mLock);
+}
+
+HashMap * IMAPBodyCache::info()
+{
+    HashMap * result = HashMap::hashMap();
+    result->setObjectForKey(MCSTR("hits"), Value::valueWithUnsignedIntValue(hitsCount()));
+    result->setObjectForKey(MCSTR("misses"), Value::valueWithUnsignedIntValue(missesCount()));
+    result->setObjectForKey(MCSTR("hitRate"), Value::valueWithDoubleValue(hitRate()));
+    result->setObjectForKey(MCSTR("bytesSaved"), Value::valueWithUnsignedLongLongValue(bytesSaved()));
+    result->setObjectForKey(MCSTR("bytesDeduplicated"), Value::valueWithUnsignedLongLongValue(bytesDeduplicated()));
+    result->setObjectForKey(MCSTR("totalSize"), Value::valueWithUnsignedLongLongValue(totalSize()));
+    result->setObjectForKey(MCSTR("itemsCount"), Value::valueWithUnsignedIntValue(itemsCount()));
+    result->setObjectForKey(MCSTR("evictions"), Value::valueWithUnsignedIntValue(evictionsCount()));
+    return result;
+}
+
+String * IMAPBodyCache::description()
+{
+    return String::stringWithUTF8Format("<%s:%p %s %s>", MCUTF8(className()), this, MCUTF8(mPath),
+                                        MCUTF8(info()));
+}
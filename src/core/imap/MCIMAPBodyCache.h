@@ -0,0 +1,119 @@
+//
+//  MCIMAPBodyCache.h
+//  mailcore2
+//
+//  Created by agent on 10/18/26.
+//  Copyright (c) 2026 MailCore. All rights reserved.
+//
+
+#ifndef MAILCORE_MCIMAPBODYCACHE_H
+
+#define MAILCORE_MCIMAPBODYCACHE_H
+
+#include <pthread.h>
+#include <MailCore/MCBaseTypes.h>
+
+#ifdef __cplusplus
+
+namespace mailcore {
+
+    // On-disk cache of message contents and decoded parts, keyed by
+    // (account, folder, UIDVALIDITY, UID, part ID). An empty part ID is the whole message.
+    // Contents are stored once per MD5 digest, so the same attachment in several messages uses
+    // the disk space once. Each content is a plain file that can be mapped in memory.
+    // When the total size goes over maximumSize(), the least recently used contents are removed.
+    // It can be shared by several sessions and used from any thread.
+    class IMAPBodyCacheBlob;
+
+    class MAILCORE_EXPORT IMAPBodyCache : public Object {
+    public:
+        IMAPBodyCache();
+        virtual ~IMAPBodyCache();
+
+        // Directory of the cache. It's created if needed.
+        virtual void setPath(String * path);
+        virtual String * path();
+
+        // Default is 256MB.
+        virtual void setMaximumSize(uint64_t maximumSize);
+        virtual uint64_t maximumSize();
+
+        // Larger contents are not stored. Default is 16MB.
+        virtual void setMaximumItemSize(unsigned int maximumItemSize);
+        virtual unsigned int maximumItemSize();
+
+        virtual ErrorCode load();
+        // The index is also saved every few changes.
+        virtual ErrorCode save();
+
+        // Returns NULL if the content is not in the cache.
+        virtual Data * dataForKey(String * account, String * folder, uint32_t uidValidity, uint32_t uid,
+                                  String * partID);
+        // Path of the file with the content, to map it in memory. Returns NULL if it's not in the cache.
+        // The file is kept until unpinFilename() is called with the returned path.
+        virtual String * filenameForKey(String * account, String * folder, uint32_t uidValidity, uint32_t uid,
+                                        String * partID);
+        virtual void unpinFilename(String * filename);
+        virtual void setData(Data * data, String * account, String * folder, uint32_t uidValidity, uint32_t uid,
+                             String * partID);
+        // Stores the content of the given file.
+        virtual void setDataWithContentsOfFile(String * filename, String * account, String * folder,
+                                               uint32_t uidValidity, uint32_t uid, String * partID);
+        virtual void removeFolder(String * account, String * folder);
+        virtual void removeAllData();
+
+        virtual unsigned int hitsCount();
+        virtual unsigned int missesCount();
+        virtual double hitRate();
+        // Bytes that didn't need to be downloaded.
+        virtual uint64_t bytesSaved();
+        // Bytes that didn't need to be written because the same content was already stored.
+        virtual uint64_t bytesDeduplicated();
+        virtual uint64_t totalSize();
+        virtual unsigned int itemsCount();
+        virtual unsigned int evictionsCount();
+        virtual void resetStatistics();
+
+        // Snapshot of the statistics.
+        virtual HashMap * info();
+
+    public: // subclass behavior
+        virtual String * description();
+
+    private:
+        pthread_mutex_t mLock;
+        String * mPath;
+        uint64_t mMaximumSize;
+        unsigned int mMaximumItemSize;
+        // key -> digest
+        HashMap * mKeys;
+        // digest -> IMAPBodyCacheBlob
+        HashMap * mBlobs;
+        uint64_t mAccessClock;
+        uint64_t mTotalSize;
+        unsigned int mChangesCount;
+        unsigned int mHitsCount;
+        unsigned int mMissesCount;
+        uint64_t mBytesSaved;
+        uint64_t mBytesDeduplicated;
+        unsigned int mEvictionsCount;
+        unsigned int mTemporaryFilesCount;
+
+        void init();
+        String * keyString(String * account, String * folder, uint32_t uidValidity, uint32_t uid, String * partID);
+        String * blobFilename(String * digest);
+        String * lookupDigest(String * key);
+        void addBlob(String * key, String * digest, unsigned int size);
+        void removeDigest(String * digest);
+        void unpinBlob(String * digest, IMAPBodyCacheBlob * blob);
+        void evictIfNeeded();
+        void changed();
+        Data * serializedIndex();
+        ErrorCode saveNoLock();
+    };
+
+}
+
+#endif
+
+#endif
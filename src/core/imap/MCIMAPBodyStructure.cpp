@@ -0,0 +1,522 @@
+//
+//  MCIMAPBodyStructure.cpp
+//  mailcore2
+//
+//  Created by agent on 10/18/26.
+//  Copyright (c) 2026 MailCore. All rights reserved.
+//
+
+#include "MCWin32.h" // should be included first.
+
+#include "MCIMAPBodyStructure.h"
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "MCDefines.h"
+#include "MCIMAPPart.h"
+#include "MCIMAPMultipart.h"
+#include "MCIMAPMessagePart.h"
+#include "MCMessageHeader.h"
+
+using namespace mailcore;
+
+enum {
+    // Server-provided mime types can be anything: the shared ones are bounded.
+    MIME_TYPES_MAX_COUNT = 512,
+};
+
+// Mime types shared by all the body structures. They're never released.
+static pthread_mutex_t s_mimeTypesLock = PTHREAD_MUTEX_INITIALIZER;
+static Array * s_mimeTypes = NULL;
+static HashMap * s_mimeTypesIndexes = NULL;
+
+// Returns -2 if there's no room for a new mime type.
+static int32_t internedMimeType(String * mimeType)
+{
+    if (mimeType == NULL) {
+        return -1;
+    }
+    int32_t result;
+    pthread_mutex_lock(&s_mimeTypesLock);
+    if (s_mimeTypes == NULL) {
+        s_mimeTypes = new Array();
+        s_mimeTypesIndexes = new HashMap();
+    }
+    Value * index = (Value *) s_mimeTypesIndexes->objectForKey(mimeType);
+    if (index != NULL) {
+        result = index->intValue();
+    }
+    else if (s_mimeTypes->count() >= MIME_TYPES_MAX_COUNT) {
+        result = -2;
+    }
+    else {
+        result = (int32_t) s_mimeTypes->count();
+        String * value = (String *) mimeType->copy();
+        s_mimeTypes->addObject(value);
+        s_mimeTypesIndexes->setObjectForKey(value, Value::valueWithIntValue(result));
+        value->release();
+    }
+    pthread_mutex_unlock(&s_mimeTypesLock);
+    return result;
+}
+
+static String * mimeTypeForIndex(int32_t idx)
+{
+    if (idx == -1) {
+        return NULL;
+    }
+    pthread_mutex_lock(&s_mimeTypesLock);
+    String * result = (String *) s_mimeTypes->objectAtIndex(idx);
+    pthread_mutex_unlock(&s_mimeTypesLock);
+    return result;
+}
+
+struct index_sort_context {
+    const char * strings;
+    const char * nodes;
+    size_t nodeSize;
+    size_t fieldOffset;
+};
+
+static const char * stringForNode(struct index_sort_context * context, uint32_t nodeIndex)
+{
+    const char * node = context->nodes + context->nodeSize * nodeIndex;
+    uint32_t offset;
+    memcpy(&offset, node + context->fieldOffset, sizeof(offset));
+    return context->strings + offset;
+}
+
+// Stable sort, so that the first part in depth-first order is found when several parts have the same value.
+static void mergeSortIndexes(uint32_t * items, uint32_t * scratch, unsigned int count,
+                             struct index_sort_context * context)
+{
+    if (count < 2) {
+        return;
+    }
+    unsigned int middle = count / 2;
+    mergeSortIndexes(items, scratch, middle, context);
+    mergeSortIndexes(items + middle, scratch, count - middle, context);
+    memcpy(scratch, items, sizeof(* items) * middle);
+    unsigned int left = 0;
+    unsigned int right = middle;
+    unsigned int position = 0;
+    while ((left < middle) && (right < count)) {
+        if (strcmp(stringForNode(context, items[right]), stringForNode(context, scratch[left])) < 0) {
+            items[position ++] = items[right ++];
+        }
+        else {
+            items[position ++] = scratch[left ++];
+        }
+    }
+    while (left < middle) {
+        items[position ++] = scratch[left ++];
+    }
+}
+
+void IMAPBodyStructure::init()
+{
+    mNodes = NULL;
+    mNodesCount = 0;
+    mNodesCapacity = 0;
+    mStrings = NULL;
+    mStringsLength = 0;
+    mStringsCapacity = 0;
+    mPartIDIndexes = NULL;
+    mPartIDIndexesCount = 0;
+    mContentIDIndexes = NULL;
+    mContentIDIndexesCount = 0;
+    mUniqueIDIndexes = NULL;
+    mUniqueIDIndexesCount = 0;
+    mHeaders = new Array();
+}
+
+IMAPBodyStructure::IMAPBodyStructure()
+{
+    init();
+}
+
+IMAPBodyStructure::~IMAPBodyStructure()
+{
+    MC_SAFE_RELEASE(mHeaders);
+    free(mUniqueIDIndexes);
+    free(mContentIDIndexes);
+    free(mPartIDIndexes);
+    free(mStrings);
+    free(mNodes);
+}
+
+IMAPBodyStructure * IMAPBodyStructure::bodyStructureWithPart(AbstractPart * part)
+{
+    IMAPBodyStructure * result = new IMAPBodyStructure();
+    // The offset 0 is used for the missing values.
+    result->mStringsCapacity = 256;
+    result->mStrings = (char *) malloc(result->mStringsCapacity);
+    result->mStrings[0] = 0;
+    result->mStringsLength = 1;
+    if (part != NULL) {
+        result->addPart(part);
+    }
+    result->buildIndexes();
+    return (IMAPBodyStructure *) result->autorelease();
+}
+
+uint32_t IMAPBodyStructure::addString(String * value)
+{
+    if (value == NULL) {
+        return 0;
+    }
+    const char * utf8 = value->UTF8Characters();
+    unsigned int length = (unsigned int) strlen(utf8) + 1;
+    if (mStringsLength + length > mStringsCapacity) {
+        while (mStringsLength + length > mStringsCapacity) {
+            mStringsCapacity *= 2;
+        }
+        mStrings = (char *) realloc(mStrings, mStringsCapacity);
+    }
+    uint32_t offset = mStringsLength;
+    memcpy(mStrings + offset, utf8, length);
+    mStringsLength += length;
+    return offset;
+}
+
+String * IMAPBodyStructure::stringAtOffset(uint32_t offset)
+{
+    if (offset == 0) {
+        return NULL;
+    }
+    return String::stringWithUTF8Characters(mStrings + offset);
+}
+
+void IMAPBodyStructure::addPart(AbstractPart * part)
+{
+    if (mNodesCount >= mNodesCapacity) {
+        mNodesCapacity = (mNodesCapacity == 0) ? 4 : mNodesCapacity * 2;
+        mNodes = (Node *) realloc(mNodes, sizeof(* mNodes) * mNodesCapacity);
+    }
+    unsigned int nodeIndex = mNodesCount;
+    mNodesCount ++;
+
+    Node node;
+    node.partType = (uint8_t) part->partType();
+    node.encoding = 0;
+    node.attachment = part->isAttachment();
+    node.inlineAttachment = part->isInlineAttachment();
+    node.mimeType = internedMimeType(part->mimeType());
+    node.mimeTypeString = 0;
+    if (node.mimeType == -2) {
+        node.mimeTypeString = addString(part->mimeType());
+    }
+    node.size = 0;
+    node.childrenCount = 0;
+    node.partID = 0;
+    node.filename = addString(part->filename());
+    node.charset = addString(part->charset());
+    node.uniqueID = addString(part->uniqueID());
+    node.contentID = addString(part->contentID());
+    node.contentLocation = addString(part->contentLocation());
+    node.contentDescription = addString(part->contentDescription());
+    node.parameters = 0;
+    node.parametersCount = 0;
+    node.header = -1;
+
+    Array * names = part->allContentTypeParametersNames();
+    mc_foreacharray(String, name, names) {
+        uint32_t offset = addString(name);
+        addString(part->contentTypeParameterValueForName(name));
+        if (node.parametersCount == 0) {
+            node.parameters = offset;
+        }
+        node.parametersCount ++;
+    }
+
+    switch (part->partType()) {
+        case PartTypeSingle:
+        {
+            IMAPPart * imapPart = (IMAPPart *) part;
+            node.partID = addString(imapPart->partID());
+            node.encoding = (int8_t) imapPart->encoding();
+            node.size = imapPart->size();
+            break;
+        }
+        case PartTypeMessage:
+        {
+            IMAPMessagePart * messagePart = (IMAPMessagePart *) part;
+            node.partID = addString(messagePart->partID());
+            node.header = (int32_t) mHeaders->count();
+            mHeaders->addObject(messagePart->header());
+            if (messagePart->mainPart() != NULL) {
+                node.childrenCount = 1;
+            }
+            mNodes[nodeIndex] = node;
+            if (messagePart->mainPart() != NULL) {
+                addPart(messagePart->mainPart());
+            }
+            return;
+        }
+        case PartTypeMultipartMixed:
+        case PartTypeMultipartRelated:
+        case PartTypeMultipartAlternative:
+        case PartTypeMultipartSigned:
+        {
+            IMAPMultipart * multipart = (IMAPMultipart *) part;
+            node.partID = addString(multipart->partID());
+            node.childrenCount = multipart->parts()->count();
+            mNodes[nodeIndex] = node;
+            mc_foreacharray(AbstractPart, subpart, multipart->parts()) {
+                addPart(subpart);
+            }
+            return;
+        }
+    }
+    mNodes[nodeIndex] = node;
+}
+
+uint32_t * IMAPBodyStructure::sortedIndexes(size_t fieldOffset, bool singleOnly, unsigned int * pCount)
+{
+    uint32_t * indexes = (uint32_t *) malloc(sizeof(* indexes) * (mNodesCount > 0 ? mNodesCount : 1));
+    unsigned int count = 0;
+    for(unsigned int i = 0 ; i < mNodesCount ; i ++) {
+        if (singleOnly && (mNodes[i].partType != PartTypeSingle)) {
+            continue;
+        }
+        uint32_t offset;
+        memcpy(&offset, ((char *) &mNodes[i]) + fieldOffset, sizeof(offset));
+        if (offset == 0) {
+            continue;
+        }
+        indexes[count] = i;
+        count ++;
+    }
+    uint32_t * scratch = (uint32_t *) malloc(sizeof(* scratch) * (count > 0 ? count : 1));
+    struct index_sort_context context;
+    context.strings = mStrings;
+    context.nodes = (const char *) mNodes;
+    context.nodeSize = sizeof(Node);
+    context.fieldOffset = fieldOffset;
+    mergeSortIndexes(indexes, scratch, count, &context);
+    free(scratch);
+    * pCount = count;
+    return indexes;
+}
+
+void IMAPBodyStructure::buildIndexes()
+{
+    mPartIDIndexes = sortedIndexes(offsetof(Node, partID), false, &mPartIDIndexesCount);
+    mContentIDIndexes = sortedIndexes(offsetof(Node, contentID), true, &mContentIDIndexesCount);
+    mUniqueIDIndexes = sortedIndexes(offsetof(Node, uniqueID), true, &mUniqueIDIndexesCount);
+}
+
+int IMAPBodyStructure::indexForValue(uint32_t * indexes, unsigned int count, size_t fieldOffset, String * value)
+{
+    if (value == NULL) {
+        return -1;
+    }
+    struct index_sort_context context;
+    context.strings = mStrings;
+    context.nodes = (const char *) mNodes;
+    context.nodeSize = sizeof(Node);
+    context.fieldOffset = fieldOffset;
+    const char * utf8 = value->UTF8Characters();
+    unsigned int low = 0;
+    unsigned int high = count;
+    while (low < high) {
+        unsigned int middle = (low + high) / 2;
+        if (strcmp(stringForNode(&context, indexes[middle]), utf8) < 0) {
+            low = middle + 1;
+        }
+        else {
+            high = middle;
+        }
+    }
+    if ((low < count) && (strcmp(stringForNode(&context, indexes[low]), utf8) == 0)) {
+        return (int) indexes[low];
+    }
+    return -1;
+}
+
+int IMAPBodyStructure::indexForPartID(String * partID)
+{
+    return indexForValue(mPartIDIndexes, mPartIDIndexesCount, offsetof(Node, partID), partID);
+}
+
+int IMAPBodyStructure::indexForContentID(String * contentID)
+{
+    return indexForValue(mContentIDIndexes, mContentIDIndexesCount, offsetof(Node, contentID), contentID);
+}
+
+int IMAPBodyStructure::indexForUniqueID(String * uniqueID)
+{
+    return indexForValue(mUniqueIDIndexes, mUniqueIDIndexesCount, offsetof(Node, uniqueID), uniqueID);
+}
+
+unsigned int IMAPBodyStructure::partsCount()
+{
+    return mNodesCount;
+}
+
+AbstractPart * IMAPBodyStructure::createPart(unsigned int * pIndex, Array * parts)
+{
+    unsigned int nodeIndex = * pIndex;
+    Node * node = &mNodes[nodeIndex];
+    (* pIndex) ++;
+
+    AbstractPart * part;
+    switch ((PartType) node->partType) {
+        case PartTypeSingle:
+        default:
+        {
+            IMAPPart * imapPart = new IMAPPart();
+            imapPart->setPartID(stringAtOffset(node->partID));
+            imapPart->setEncoding((Encoding) node->encoding);
+            imapPart->setSize(node->size);
+            part = imapPart;
+            break;
+        }
+        case PartTypeMessage:
+        {
+            IMAPMessagePart * messagePart = new IMAPMessagePart();
+            messagePart->setPartID(stringAtOffset(node->partID));
+            messagePart->setHeader((MessageHeader *) mHeaders->objectAtIndex(node->header));
+            part = messagePart;
+            break;
+        }
+        case PartTypeMultipartMixed:
+        case PartTypeMultipartRelated:
+        case PartTypeMultipartAlternative:
+        case PartTypeMultipartSigned:
+        {
+            IMAPMultipart * multipart = new IMAPMultipart();
+            multipart->setPartID(stringAtOffset(node->partID));
+            part = multipart;
+            break;
+        }
+    }
+    part->setPartType((PartType) node->partType);
+    part->setMimeType(mimeTypeOfNode(node));
+    part->setFilename(stringAtOffset(node->filename));
+    part->setCharset(stringAtOffset(node->charset));
+    part->setUniqueID(stringAtOffset(node->uniqueID));
+    part->setContentID(stringAtOffset(node->contentID));
+    part->setContentLocation(stringAtOffset(node->contentLocation));
+    part->setContentDescription(stringAtOffset(node->contentDescription));
+    part->setAttachment(node->attachment);
+    part->setInlineAttachment(node->inlineAttachment);
+    uint32_t offset = node->parameters;
+    for(unsigned int i = 0 ; i < node->parametersCount ; i ++) {
+        String * name = stringAtOffset(offset);
+        offset += (uint32_t) strlen(mStrings + offset) + 1;
+        String * value = stringAtOffset(offset);
+        offset += (uint32_t) strlen(mStrings + offset) + 1;
+        part->setContentTypeParameter(name, value);
+    }
+    if (parts != NULL) {
+        parts->addObject(part);
+    }
+
+    // node can't be used anymore after this point since the children are created recursively.
+    unsigned int childrenCount = node->childrenCount;
+    if (part->partType() == PartTypeMessage) {
+        if (childrenCount > 0) {
+            ((IMAPMessagePart *) part)->setMainPart(createPart(pIndex, parts));
+        }
+    }
+    else if (part->partType() != PartTypeSingle) {
+        Array * subparts = Array::array();
+        for(unsigned int i = 0 ; i < childrenCount ; i ++) {
+            subparts->addObject(createPart(pIndex, parts));
+        }
+        ((IMAPMultipart *) part)->setParts(subparts);
+    }
+
+    part->autorelease();
+    return part;
+}
+
+AbstractPart * IMAPBodyStructure::mainPart()
+{
+    return mainPartAndParts(NULL);
+}
+
+AbstractPart * IMAPBodyStructure::mainPartAndParts(Array * parts)
+{
+    if (mNodesCount == 0) {
+        return NULL;
+    }
+    unsigned int nodeIndex = 0;
+    return createPart(&nodeIndex, parts);
+}
+
+PartType IMAPBodyStructure::partTypeAtIndex(unsigned int idx)
+{
+    MCAssert(idx < mNodesCount);
+    return (PartType) mNodes[idx].partType;
+}
+
+String * IMAPBodyStructure::partIDAtIndex(unsigned int idx)
+{
+    MCAssert(idx < mNodesCount);
+    return stringAtOffset(mNodes[idx].partID);
+}
+
+String * IMAPBodyStructure::mimeTypeOfNode(Node * node)
+{
+    if (node->mimeType == -2) {
+        return stringAtOffset(node->mimeTypeString);
+    }
+    return mimeTypeForIndex(node->mimeType);
+}
+
+String * IMAPBodyStructure::mimeTypeAtIndex(unsigned int idx)
+{
+    MCAssert(idx < mNodesCount);
+    return mimeTypeOfNode(&mNodes[idx]);
+}
+
+Encoding IMAPBodyStructure::encodingAtIndex(unsigned int idx)
+{
+    MCAssert(idx < mNodesCount);
+    return (Encoding) mNodes[idx].encoding;
+}
+
+String * IMAPBodyStructure::charsetAtIndex(unsigned int idx)
+{
+    MCAssert(idx < mNodesCount);
+    return stringAtOffset(mNodes[idx].charset);
+}
+
+String * IMAPBodyStructure::filenameAtIndex(unsigned int idx)
+{
+    MCAssert(idx < mNodesCount);
+    return stringAtOffset(mNodes[idx].filename);
+}
+
+unsigned int IMAPBodyStructure::sizeAtIndex(unsigned int idx)
+{
+    MCAssert(idx < mNodesCount);
+    return mNodes[idx].size;
+}
+
+bool IMAPBodyStructure::isAttachmentAtIndex(unsigned int idx)
+{
+    MCAssert(idx < mNodesCount);
+    return mNodes[idx].attachment;
+}
+
+size_t IMAPBodyStructure::memoryUsage()
+{
+    size_t result = sizeof(* this);
+    result += sizeof(* mNodes) * mNodesCapacity + mStringsCapacity;
+    result += sizeof(uint32_t) * (mPartIDIndexesCount + mContentIDIndexesCount + mUniqueIDIndexesCount);
+    // Headers of the message parts are objects, this is an approximation.
+    result += 512 * mHeaders->count();
+    return result;
+}
+
+String * IMAPBodyStructure::description()
+{
+    return String::stringWithUTF8Format("<%s:%p %u parts, %u bytes of strings>", MCUTF8(className()), this,
+                                        mNodesCount, mStringsLength);
+}
@@ -0,0 +1,122 @@
+//
+//  MCIMAPBodyStructure.h
+//  mailcore2
+//
+//  Created by agent on 10/18/26.
+//  Copyright (c) 2026 MailCore. All rights reserved.
+//
+
+#ifndef MAILCORE_MCIMAPBODYSTRUCTURE_H
+
+#define MAILCORE_MCIMAPBODYSTRUCTURE_H
+
+#include <MailCore/MCBaseTypes.h>
+#include <MailCore/MCMessageConstants.h>
+
+#ifdef __cplusplus
+
+namespace mailcore {
+
+    class AbstractPart;
+
+    // Compact and immutable copy of a tree of IMAPPart, IMAPMultipart and IMAPMessagePart.
+    // Parts are stored in a flat array in depth-first order and their strings in a single buffer.
+    // Common mime types are shared by all the body structures, up to a limit: the other ones are stored with the
+    // strings of the body structure.
+    // The parts are looked up by part ID, content-ID or unique ID using sorted indexes.
+    class MAILCORE_EXPORT IMAPBodyStructure : public Object {
+    public:
+        IMAPBodyStructure();
+        virtual ~IMAPBodyStructure();
+
+        static IMAPBodyStructure * bodyStructureWithPart(AbstractPart * part);
+
+        virtual unsigned int partsCount();
+
+        // Creates a new tree of parts.
+        virtual AbstractPart * mainPart();
+        // Creates a new tree of parts. The created parts are added to the given array in the order
+        // of the indexes.
+        virtual AbstractPart * mainPartAndParts(Array * /* AbstractPart */ parts);
+
+        // Return -1 if there's no such part. Like AbstractPart::partForContentID() and
+        // AbstractPart::partForUniqueID(), only single parts are matched by content-ID and unique ID.
+        virtual int indexForPartID(String * partID);
+        virtual int indexForContentID(String * contentID);
+        virtual int indexForUniqueID(String * uniqueID);
+
+        virtual PartType partTypeAtIndex(unsigned int idx);
+        virtual String * partIDAtIndex(unsigned int idx);
+        virtual String * mimeTypeAtIndex(unsigned int idx);
+        virtual Encoding encodingAtIndex(unsigned int idx);
+        virtual String * charsetAtIndex(unsigned int idx);
+        virtual String * filenameAtIndex(unsigned int idx);
+        virtual unsigned int sizeAtIndex(unsigned int idx);
+        virtual bool isAttachmentAtIndex(unsigned int idx);
+
+        // Approximate number of bytes used by the body structure.
+        virtual size_t memoryUsage();
+
+    public: // subclass behavior
+        virtual String * description();
+
+    private:
+        struct Node {
+            uint8_t partType;
+            int8_t encoding;
+            uint8_t attachment;
+            uint8_t inlineAttachment;
+            // Index in the shared mime types, -1 when there's no value, -2 when it's in mimeTypeString.
+            int32_t mimeType;
+            // Offset in mStrings of a mime type that is not shared.
+            uint32_t mimeTypeString;
+            uint32_t size;
+            // Children follow the part.
+            uint32_t childrenCount;
+            // Offsets in mStrings, 0 when there's no value.
+            uint32_t partID;
+            uint32_t filename;
+            uint32_t charset;
+            uint32_t uniqueID;
+            uint32_t contentID;
+            uint32_t contentLocation;
+            uint32_t contentDescription;
+            // Names and values of the content-type parameters, one after the other.
+            uint32_t parameters;
+            uint32_t parametersCount;
+            // Index in mHeaders, -1 for a part that is not a message.
+            int32_t header;
+        };
+
+        Node * mNodes;
+        unsigned int mNodesCount;
+        unsigned int mNodesCapacity;
+        char * mStrings;
+        unsigned int mStringsLength;
+        unsigned int mStringsCapacity;
+        // Indexes of the nodes, sorted by part ID, content-ID and unique ID.
+        uint32_t * mPartIDIndexes;
+        unsigned int mPartIDIndexesCount;
+        uint32_t * mContentIDIndexes;
+        unsigned int mContentIDIndexesCount;
+        uint32_t * mUniqueIDIndexes;
+        unsigned int mUniqueIDIndexesCount;
+        // Headers of the message parts.
+        Array * mHeaders;
+
+        void init();
+        uint32_t addString(String * value);
+        String * stringAtOffset(uint32_t offset);
+        String * mimeTypeOfNode(Node * node);
+        void addPart(AbstractPart * part);
+        void buildIndexes();
+        uint32_t * sortedIndexes(size_t fieldOffset, bool singleOnly, unsigned int * pCount);
+        int indexForValue(uint32_t * indexes, unsigned int count, size_t fieldOffset, String * value);
+        AbstractPart * createPart(unsigned int * pIndex, Array * parts);
+    };
+
+}
+
+#endif
+
+#endif
@@ -0,0 +1,591 @@
+//
+//  MCIMAPFolderMirror.cpp
+//  mailcore2
+//
+//  Created by agent on 10/18/26.
+//  Copyright (c) 2026 MailCore. All rights reserved.
+//
+
+#include "MCWin32.h" // should be included first.
+
+#include "MCIMAPFolderMirror.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifndef _MSC_VER
+#include <unistd.h>
+#endif
+
+#include "MCDefines.h"
+#include "MCIMAPSession.h"
+#include "MCIMAPMessage.h"
+#include "MCIMAPSyncResult.h"
+#include "MCJSON.h"
+
+using namespace mailcore;
+
+// File format, integers are big endian:
+// "MCFM" version:32 uidValidity:32 uidNext:32 modSequenceValue:64 count:32
+// followed by count records:
+// uid:32 flags:32 modSeq:64 length:32 serialized message (JSON, length bytes)
+
+#define MIRROR_MAGIC "MCFM"
+
+enum {
+    MIRROR_VERSION = 1,
+    MIRROR_HEADER_SIZE = 28,
+    MIRROR_RECORD_HEADER_SIZE = 20,
+};
+
+static void appendUInt32(Data * data, uint32_t value)
+{
+    char bytes[4];
+    bytes[0] = (char) ((value >> 24) & 0xff);
+    bytes[1] = (char) ((value >> 16) & 0xff);
+    bytes[2] = (char) ((value >> 8) & 0xff);
+    bytes[3] = (char) (value & 0xff);
+    data->appendBytes(bytes, 4);
+}
+
+static void appendUInt64(Data * data, uint64_t value)
+{
+    appendUInt32(data, (uint32_t) (value >> 32));
+    appendUInt32(data, (uint32_t) (value & 0xffffffff));
+}
+
+static uint32_t readUInt32(const char * bytes)
+{
+    const unsigned char * p = (const unsigned char *) bytes;
+    return ((uint32_t) p[0] << 24) | ((uint32_t) p[1] << 16) | ((uint32_t) p[2] << 8) | (uint32_t) p[3];
+}
+
+static uint64_t readUInt64(const char * bytes)
+{
+    return ((uint64_t) readUInt32(bytes) << 32) | (uint64_t) readUInt32(bytes + 4);
+}
+
+static bool sameStrings(Array * strings, Array * otherStrings)
+{
+    unsigned int count = (strings != NULL) ? strings->count() : 0;
+    unsigned int otherCount = (otherStrings != NULL) ? otherStrings->count() : 0;
+    if (count != otherCount) {
+        return false;
+    }
+    if (count == 0) {
+        return true;
+    }
+    return strings->isEqual(otherStrings);
+}
+
+void IMAPFolderMirror::init()
+{
+    mFolder = NULL;
+    mPath = NULL;
+    mRequestKind = (IMAPMessagesRequestKind) (IMAPMessagesRequestKindHeaders | IMAPMessagesRequestKindInternalDate);
+    mUidValidity = 0;
+    mUidNext = 0;
+    mModSequenceValue = 0;
+    mRecords = NULL;
+    mCount = 0;
+    mCapacity = 0;
+    mMessagesData = new Array();
+}
+
+IMAPFolderMirror::IMAPFolderMirror()
+{
+    init();
+}
+
+IMAPFolderMirror::~IMAPFolderMirror()
+{
+    free(mRecords);
+    MC_SAFE_RELEASE(mMessagesData);
+    MC_SAFE_RELEASE(mPath);
+    MC_SAFE_RELEASE(mFolder);
+}
+
+String * IMAPFolderMirror::description()
+{
+    String * result = String::string();
+    result->appendUTF8Format("<%s:%p %s %u messages uidValidity:%u uidNext:%u modseq:%llu>",
+                             MCUTF8(className()), this, MCUTF8(mFolder), mCount,
+                             (unsigned int) mUidValidity, (unsigned int) mUidNext,
+                             (unsigned long long) mModSequenceValue);
+    return result;
+}
+
+void IMAPFolderMirror::setFolder(String * folder)
+{
+    MC_SAFE_REPLACE_COPY(String, mFolder, folder);
+}
+
+String * IMAPFolderMirror::folder()
+{
+    return mFolder;
+}
+
+void IMAPFolderMirror::setPath(String * path)
+{
+    MC_SAFE_REPLACE_COPY(String, mPath, path);
+}
+
+String * IMAPFolderMirror::path()
+{
+    return mPath;
+}
+
+void IMAPFolderMirror::setRequestKind(IMAPMessagesRequestKind requestKind)
+{
+    mRequestKind = requestKind;
+}
+
+IMAPMessagesRequestKind IMAPFolderMirror::requestKind()
+{
+    return mRequestKind;
+}
+
+uint32_t IMAPFolderMirror::uidValidity()
+{
+    return mUidValidity;
+}
+
+uint32_t IMAPFolderMirror::uidNext()
+{
+    return mUidNext;
+}
+
+uint64_t IMAPFolderMirror::modSequenceValue()
+{
+    return mModSequenceValue;
+}
+
+unsigned int IMAPFolderMirror::count()
+{
+    return mCount;
+}
+
+IndexSet * IMAPFolderMirror::uids()
+{
+    IndexSet * result = IndexSet::indexSet();
+    unsigned int i = 0;
+    while (i < mCount) {
+        // Add consecutive UIDs as a single range.
+        unsigned int last = i;
+        while ((last + 1 < mCount) && (mRecords[last + 1].uid == mRecords[last].uid + 1)) {
+            last ++;
+        }
+        result->addRange(RangeMake(mRecords[i].uid, mRecords[last].uid - mRecords[i].uid));
+        i = last + 1;
+    }
+    return result;
+}
+
+int IMAPFolderMirror::indexForUID(uint32_t uid)
+{
+    int left = 0;
+    int right = (int) mCount - 1;
+    while (left <= right) {
+        int middle = (left + right) / 2;
+        if (mRecords[middle].uid == uid) {
+            return middle;
+        }
+        if (mRecords[middle].uid < uid) {
+            left = middle + 1;
+        }
+        else {
+            right = middle - 1;
+        }
+    }
+    return -1;
+}
+
+bool IMAPFolderMirror::containsUID(uint32_t uid)
+{
+    return indexForUID(uid) != -1;
+}
+
+MessageFlag IMAPFolderMirror::flagsForUID(uint32_t uid)
+{
+    int idx = indexForUID(uid);
+    if (idx == -1) {
+        return MessageFlagNone;
+    }
+    return (MessageFlag) mRecords[idx].flags;
+}
+
+IMAPMessage * IMAPFolderMirror::messageAtIndex(unsigned int idx)
+{
+    IMAPMessage * message = NULL;
+    Data * data = (Data *) mMessagesData->objectAtIndex(idx);
+    if (data->length() > 0) {
+        HashMap * serializable = (HashMap *) JSON::objectFromJSONData(data);
+        if (serializable != NULL) {
+            message = (IMAPMessage *) Object::objectWithSerializable(serializable);
+        }
+    }
+    if (message == NULL) {
+        message = new IMAPMessage();
+        message->autorelease();
+    }
+    // The record is more recent than the serialized message.
+    message->setUid(mRecords[idx].uid);
+    message->setFlags((MessageFlag) mRecords[idx].flags);
+    message->setOriginalFlags((MessageFlag) mRecords[idx].flags);
+    message->setModSeqValue(mRecords[idx].modSeq);
+    return message;
+}
+
+IMAPMessage * IMAPFolderMirror::messageForUID(uint32_t uid)
+{
+    int idx = indexForUID(uid);
+    if (idx == -1) {
+        return NULL;
+    }
+    return messageAtIndex((unsigned int) idx);
+}
+
+Array * IMAPFolderMirror::messagesForUIDs(IndexSet * uids)
+{
+    Array * result = Array::array();
+    for(unsigned int i = 0 ; i < mCount ; i ++) {
+        if (uids->containsIndex(mRecords[i].uid)) {
+            result->addObject(messageAtIndex(i));
+        }
+    }
+    return result;
+}
+
+void IMAPFolderMirror::addMessage(IMAPMessage * message)
+{
+    if (mCount == mCapacity) {
+        mCapacity = (mCapacity == 0) ? 256 : mCapacity * 2;
+        mRecords = (Record *) realloc(mRecords, sizeof(* mRecords) * mCapacity);
+    }
+
+    // New messages usually have the highest UIDs.
+    unsigned int idx = mCount;
+    while ((idx > 0) && (mRecords[idx - 1].uid > message->uid())) {
+        idx --;
+    }
+    if (idx < mCount) {
+        memmove(&mRecords[idx + 1], &mRecords[idx], sizeof(* mRecords) * (mCount - idx));
+    }
+    mRecords[idx].uid = message->uid();
+    mRecords[idx].flags = (uint32_t) message->flags();
+    mRecords[idx].modSeq = message->modSeqValue();
+    mMessagesData->insertObject(idx, JSON::objectToJSONData(message->serializable()));
+    mCount ++;
+}
+
+bool IMAPFolderMirror::updateMessage(IMAPMessage * message)
+{
+    int idx = indexForUID(message->uid());
+    if (idx == -1) {
+        return false;
+    }
+
+    Record * record = &mRecords[idx];
+    bool changed = (record->flags != (uint32_t) message->flags());
+    record->flags = (uint32_t) message->flags();
+    if (message->modSeqValue() != 0) {
+        record->modSeq = message->modSeqValue();
+    }
+
+    // Custom flags and Gmail labels are kept in the serialized message.
+    IMAPMessage * storedMessage = messageAtIndex((unsigned int) idx);
+    bool storedMessageChanged = false;
+    if (!sameStrings(storedMessage->customFlags(), message->customFlags())) {
+        storedMessage->setCustomFlags(message->customFlags());
+        storedMessageChanged = true;
+    }
+    if (((mRequestKind & IMAPMessagesRequestKindGmailLabels) != 0) &&
+        !sameStrings(storedMessage->gmailLabels(), message->gmailLabels())) {
+        storedMessage->setGmailLabels(message->gmailLabels());
+        storedMessageChanged = true;
+    }
+    if (storedMessageChanged) {
+        mMessagesData->replaceObject((unsigned int) idx, JSON::objectToJSONData(storedMessage->serializable()));
+        changed = true;
+    }
+    return changed;
+}
+
+void IMAPFolderMirror::removeUIDs(IndexSet * uids)
+{
+    if (uids->count() == 0) {
+        return;
+    }
+
+    Array * messagesData = new Array();
+    unsigned int count = 0;
+    for(unsigned int i = 0 ; i < mCount ; i ++) {
+        if (uids->containsIndex(mRecords[i].uid)) {
+            continue;
+        }
+        mRecords[count] = mRecords[i];
+        messagesData->addObject(mMessagesData->objectAtIndex(i));
+        count ++;
+    }
+    mCount = count;
+    MC_SAFE_RELEASE(mMessagesData);
+    mMessagesData = messagesData;
+}
+
+void IMAPFolderMirror::reset()
+{
+    mUidValidity = 0;
+    mUidNext = 0;
+    mModSequenceValue = 0;
+    mCount = 0;
+    mMessagesData->removeAllObjects();
+}
+
+Data * IMAPFolderMirror::serializedData()
+{
+    Data * data = Data::data();
+    data->appendBytes(MIRROR_MAGIC, 4);
+    appendUInt32(data, MIRROR_VERSION);
+    appendUInt32(data, mUidValidity);
+    appendUInt32(data, mUidNext);
+    appendUInt64(data, mModSequenceValue);
+    appendUInt32(data, mCount);
+    for(unsigned int i = 0 ; i < mCount ; i ++) {
+        Data * messageData = (Data *) mMessagesData->objectAtIndex(i);
+        appendUInt32(data, mRecords[i].uid);
+        appendUInt32(data, mRecords[i].flags);
+        appendUInt64(data, mRecords[i].modSeq);
+        appendUInt32(data, messageData->length());
+        data->appendData(messageData);
+    }
+    return data;
+}
+
+bool IMAPFolderMirror::importSerializedData(Data * data)
+{
+    const char * bytes = data->bytes();
+    unsigned int length = data->length();
+
+    if ((length < MIRROR_HEADER_SIZE) || (memcmp(bytes, MIRROR_MAGIC, 4) != 0) ||
+        (readUInt32(bytes + 4) != MIRROR_VERSION)) {
+        return false;
+    }
+    uint32_t count = readUInt32(bytes + 24);
+    // Each record needs at least its header.
+    if (count > (length - MIRROR_HEADER_SIZE) / MIRROR_RECORD_HEADER_SIZE) {
+        return false;
+    }
+
+    Record * records = (Record *) malloc(sizeof(* records) * (count > 0 ? count : 1));
+    Array * messagesData = new Array();
+    unsigned int position = MIRROR_HEADER_SIZE;
+    for(uint32_t i = 0 ; i < count ; i ++) {
+        if (length - position < MIRROR_RECORD_HEADER_SIZE) {
+            break;
+        }
+        records[i].uid = readUInt32(bytes + position);
+        records[i].flags = readUInt32(bytes + position + 4);
+        records[i].modSeq = readUInt64(bytes + position + 8);
+        uint32_t messageLength = readUInt32(bytes + position + 16);
+        position += MIRROR_RECORD_HEADER_SIZE;
+        if ((messageLength > length - position) || ((i > 0) && (records[i].uid <= records[i - 1].uid))) {
+            break;
+        }
+        messagesData->addObject(Data::dataWithBytes(bytes + position, messageLength));
+        position += messageLength;
+    }
+    if (messagesData->count() != count) {
+        free(records);
+        MC_SAFE_RELEASE(messagesData);
+        return false;
+    }
+
+    free(mRecords);
+    mRecords = records;
+    mCount = count;
+    mCapacity = (count > 0) ? count : 1;
+    MC_SAFE_RELEASE(mMessagesData);
+    mMessagesData = messagesData;
+    mUidValidity = readUInt32(bytes + 8);
+    mUidNext = readUInt32(bytes + 12);
+    mModSequenceValue = readUInt64(bytes + 16);
+    return true;
+}
+
+ErrorCode IMAPFolderMirror::load()
+{
+    MCAssert(mPath != NULL);
+
+    reset();
+    Data * data = Data::dataWithContentsOfFile(mPath);
+    if (data == NULL) {
+        return ErrorNone;
+    }
+    if (!importSerializedData(data)) {
+        MCLog("invalid folder mirror %s", MCUTF8(mPath));
+        reset();
+        return ErrorFile;
+    }
+    return ErrorNone;
+}
+
+ErrorCode IMAPFolderMirror::save()
+{
+    MCAssert(mPath != NULL);
+
+    // Write to a temporary file first so that an interrupted save doesn't corrupt the store.
+    String * temporaryPath = mPath->stringByAppendingUTF8Characters(".tmp");
+    ErrorCode error = serializedData()->writeToFile(temporaryPath);
+    if (error != ErrorNone) {
+        unlink(temporaryPath->fileSystemRepresentation());
+        return error;
+    }
+    if (rename(temporaryPath->fileSystemRepresentation(), mPath->fileSystemRepresentation()) != 0) {
+        // rename() doesn't replace an existing file on Windows.
+        unlink(mPath->fileSystemRepresentation());
+        if (rename(temporaryPath->fileSystemRepresentation(), mPath->fileSystemRepresentation()) != 0) {
+            unlink(temporaryPath->fileSystemRepresentation());
+            return ErrorFile;
+        }
+    }
+    return ErrorNone;
+}
+
+IMAPSyncResult * IMAPFolderMirror::sync(IMAPSession * session, IMAPProgressCallback * progressCallback, ErrorCode * pError)
+{
+    MCAssert(mFolder != NULL);
+
+    // The SELECT response has the state of the folder.
+    session->select(mFolder, pError);
+    if (* pError != ErrorNone) {
+        return NULL;
+    }
+    uint32_t serverUidValidity = session->uidValidity();
+    uint32_t serverUidNext = session->uidNext();
+    uint64_t serverModSequenceValue = session->modSequenceValue();
+    unsigned int serverCount = session->lastFolderMessageCount();
+
+    Array * changedMessages = Array::array();
+    IndexSet * vanishedMessages = IndexSet::indexSet();
+
+    if ((mUidValidity != 0) && (mUidValidity != serverUidValidity)) {
+        MCLog("uidvalidity of %s changed, resetting mirror", MCUTF8(mFolder));
+        vanishedMessages->addIndexSet(uids());
+        reset();
+    }
+
+    uint32_t lastUID = (mCount > 0) ? mRecords[mCount - 1].uid : 0;
+    bool useModSequence = (mModSequenceValue != 0) && (serverModSequenceValue != 0) &&
+        (session->isCondstoreEnabled() || session->isQResyncEnabled());
+    bool checkExpunged = false;
+    // Changes of Gmail labels also change the mod-sequence of the message.
+    IMAPMessagesRequestKind changesRequestKind = (IMAPMessagesRequestKind)
+        (IMAPMessagesRequestKindFlags | (mRequestKind & IMAPMessagesRequestKindGmailLabels));
+
+    if (mCount > 0) {
+        if (useModSequence) {
+            // Only the messages changed since the last sync are returned.
+            // The messages removed are returned too with QRESYNC.
+            if (serverModSequenceValue != mModSequenceValue) {
+                // A SELECT with QRESYNC may already have returned the changes. They're used when they go back
+                // at least to the last sync. They only have the flags.
+                IMAPSyncResult * changes = NULL;
+                uint64_t changesModSequenceValue = 0;
+                if (changesRequestKind == IMAPMessagesRequestKindFlags) {
+                    changes = session->changesSinceLastSelect(&changesModSequenceValue);
+                    if ((changes != NULL) && (changesModSequenceValue > mModSequenceValue)) {
+                        changes = NULL;
+                    }
+                }
+                if (changes == NULL) {
+                    changes = session->syncMessagesByUID(mFolder, changesRequestKind,
+                                                         IndexSet::indexSetWithRange(RangeMake(1, lastUID - 1)),
+                                                         mModSequenceValue, NULL, pError);
+                    if (* pError != ErrorNone) {
+                        return NULL;
+                    }
+                }
+                mc_foreacharray(IMAPMessage, changedMessage, changes->modifiedOrAddedMessages()) {
+                    if (updateMessage(changedMessage)) {
+                        changedMessages->addObject(messageForUID(changedMessage->uid()));
+                    }
+                }
+                if (changes->vanishedMessages() != NULL) {
+                    IndexSet * removed = (IndexSet *) changes->vanishedMessages()->copy()->autorelease();
+                    removed->intersectsIndexSet(uids());
+                    removeUIDs(removed);
+                    vanishedMessages->addIndexSet(removed);
+                }
+            }
+            checkExpunged = !session->isQResyncEnabled();
+        }
+        else {
+            // Compare the flags of all the messages.
+            Array * messages = session->fetchMessagesByUID(mFolder, changesRequestKind,
+                                                           IndexSet::indexSetWithRange(RangeMake(1, lastUID - 1)),
+                                                           NULL, pError);
+            if (* pError != ErrorNone) {
+                return NULL;
+            }
+            IndexSet * removed = uids();
+            mc_foreacharray(IMAPMessage, message, messages) {
+                removed->removeIndex(message->uid());
+                if (updateMessage(message)) {
+                    changedMessages->addObject(messageForUID(message->uid()));
+                }
+            }
+            removeUIDs(removed);
+            vanishedMessages->addIndexSet(removed);
+        }
+    }
+
+    // Fetch the new messages.
+    if ((serverCount > 0) && ((mCount == 0) || (serverUidNext == 0) || (serverUidNext > lastUID + 1))) {
+        IMAPMessagesRequestKind requestKind = (IMAPMessagesRequestKind) (mRequestKind | IMAPMessagesRequestKindFlags);
+        Array * messages = session->fetchMessagesByUID(mFolder, requestKind,
+                                                       IndexSet::indexSetWithRange(RangeMake(lastUID + 1, UINT64_MAX)),
+                                                       progressCallback, pError);
+        if (* pError != ErrorNone) {
+            return NULL;
+        }
+        mc_foreacharray(IMAPMessage, message, messages) {
+            // n:* always returns the last message.
+            if ((message->uid() <= lastUID) || containsUID(message->uid())) {
+                continue;
+            }
+            addMessage(message);
+            changedMessages->addObject(message);
+        }
+    }
+
+    // CONDSTORE doesn't report the removed messages: the UIDs are compared if the count doesn't match.
+    if (checkExpunged && (mCount != serverCount)) {
+        Array * messages = session->fetchMessagesByUID(mFolder, IMAPMessagesRequestKindUid,
+                                                       IndexSet::indexSetWithRange(RangeMake(1, UINT64_MAX)),
+                                                       NULL, pError);
+        if (* pError != ErrorNone) {
+            return NULL;
+        }
+        IndexSet * removed = uids();
+        mc_foreacharray(IMAPMessage, message, messages) {
+            removed->removeIndex(message->uid());
+        }
+        removeUIDs(removed);
+        vanishedMessages->addIndexSet(removed);
+    }
+
+    mUidValidity = serverUidValidity;
+    mUidNext = serverUidNext;
+    mModSequenceValue = serverModSequenceValue;
+
+    * pError = save();
+    if (* pError != ErrorNone) {
+        return NULL;
+    }
+
+    IMAPSyncResult * result = new IMAPSyncResult();
+    result->setModifiedOrAddedMessages(changedMessages);
+    result->setVanishedMessages(vanishedMessages);
+    result->autorelease();
+    return result;
+}
@@ -0,0 +1,107 @@
+//
+//  MCIMAPFolderMirror.h
+//  mailcore2
+//
+//  Created by agent on 10/18/26.
+//  Copyright (c) 2026 MailCore. All rights reserved.
+//
+
+#ifndef MAILCORE_MCIMAPFOLDERMIRROR_H
+
+#define MAILCORE_MCIMAPFOLDERMIRROR_H
+
+#include <MailCore/MCBaseTypes.h>
+#include <MailCore/MCMessageConstants.h>
+
+#ifdef __cplusplus
+
+namespace mailcore {
+
+    class IMAPSession;
+    class IMAPMessage;
+    class IMAPSyncResult;
+    class IMAPProgressCallback;
+
+    // Local copy of the UIDs, flags, mod-sequences and headers of the messages of a folder,
+    // stored in a file. sync() brings it up to date using QRESYNC or CONDSTORE when available,
+    // and compares the UIDs and the flags otherwise.
+    // It's not thread-safe: it should be used from one thread at a time.
+    class MAILCORE_EXPORT IMAPFolderMirror : public Object {
+    public:
+        IMAPFolderMirror();
+        virtual ~IMAPFolderMirror();
+
+        virtual void setFolder(String * folder);
+        virtual String * folder();
+
+        // Location of the store.
+        virtual void setPath(String * path);
+        virtual String * path();
+
+        // Attributes fetched for new messages. Flags are always fetched, and Gmail labels are fetched
+        // with the changes of flags when they are requested.
+        // Default is IMAPMessagesRequestKindHeaders | IMAPMessagesRequestKindInternalDate.
+        virtual void setRequestKind(IMAPMessagesRequestKind requestKind);
+        virtual IMAPMessagesRequestKind requestKind();
+
+        virtual uint32_t uidValidity();
+        virtual uint32_t uidNext();
+        virtual uint64_t modSequenceValue();
+
+        virtual unsigned int count();
+        virtual IndexSet * uids();
+        virtual bool containsUID(uint32_t uid);
+        virtual MessageFlag flagsForUID(uint32_t uid);
+        // Returns NULL if the message is not in the mirror.
+        virtual IMAPMessage * messageForUID(uint32_t uid);
+        virtual Array * /* IMAPMessage */ messagesForUIDs(IndexSet * uids);
+
+        // Reads the store. A missing file is not an error: the mirror is then empty.
+        virtual ErrorCode load();
+        virtual ErrorCode save();
+        // Removes all the messages.
+        virtual void reset();
+
+        // Updates the mirror from the server and saves it. The result contains the messages that have been added
+        // or whose flags changed, and the UIDs of the messages that have been removed.
+        // If the UIDVALIDITY of the folder changed, the mirror is reset before fetching the messages again.
+        virtual IMAPSyncResult * sync(IMAPSession * session, IMAPProgressCallback * progressCallback, ErrorCode * pError);
+
+    public: // subclass behavior
+        virtual String * description();
+
+    private:
+        struct Record {
+            uint32_t uid;
+            uint32_t flags;
+            uint64_t modSeq;
+        };
+
+        String * mFolder;
+        String * mPath;
+        IMAPMessagesRequestKind mRequestKind;
+        uint32_t mUidValidity;
+        uint32_t mUidNext;
+        uint64_t mModSequenceValue;
+        // Sorted by UID.
+        Record * mRecords;
+        unsigned int mCount;
+        unsigned int mCapacity;
+        // Serialized messages, in the same order as mRecords.
+        Array * /* Data */ mMessagesData;
+
+        void init();
+        int indexForUID(uint32_t uid);
+        void addMessage(IMAPMessage * message);
+        bool updateMessage(IMAPMessage * message);
+        void removeUIDs(IndexSet * uids);
+        IMAPMessage * messageAtIndex(unsigned int idx);
+        Data * serializedData();
+        bool importSerializedData(Data * data);
+    };
+
+}
+
+#endif
+
+#endif
@@ -0,0 +1,271 @@
+//
+//  MCIMAPGmailMirror.cpp
+//  mailcore2
+//
+//  Created by agent on 10/18/26.
+//  Copyright (c) 2026 MailCore. All rights reserved.
+//
+
+#include "MCWin32.h" // should be included first.
+
+#include "MCIMAPGmailMirror.h"
+
+#include "MCDefines.h"
+#include "MCIMAPSession.h"
+#include "MCIMAPMessage.h"
+#include "MCIMAPFolder.h"
+#include "MCIMAPSyncResult.h"
+#include "MCIMAPSearchExpression.h"
+
+using namespace mailcore;
+
+static IMAPMessagesRequestKind gmailRequestKind(IMAPMessagesRequestKind requestKind)
+{
+    return (IMAPMessagesRequestKind) (requestKind | IMAPMessagesRequestKindGmailMessageID |
+                                      IMAPMessagesRequestKindGmailThreadID | IMAPMessagesRequestKindGmailLabels);
+}
+
+void IMAPGmailMirror::init()
+{
+    mLabels = new HashMap();
+    mMessageIDs = new HashMap();
+    mThreadIDs = new HashMap();
+    mIndexesBuilt = false;
+    IMAPFolderMirror::setRequestKind(gmailRequestKind(requestKind()));
+}
+
+IMAPGmailMirror::IMAPGmailMirror()
+{
+    init();
+}
+
+IMAPGmailMirror::~IMAPGmailMirror()
+{
+    MC_SAFE_RELEASE(mThreadIDs);
+    MC_SAFE_RELEASE(mMessageIDs);
+    MC_SAFE_RELEASE(mLabels);
+}
+
+String * IMAPGmailMirror::description()
+{
+    return String::stringWithUTF8Format("<%s:%p %s %u messages>", MCUTF8(className()), this,
+                                        MCUTF8(folder()), count());
+}
+
+void IMAPGmailMirror::setRequestKind(IMAPMessagesRequestKind requestKind)
+{
+    IMAPFolderMirror::setRequestKind(gmailRequestKind(requestKind));
+}
+
+void IMAPGmailMirror::reset()
+{
+    // It's also called when the mirror is loaded.
+    IMAPFolderMirror::reset();
+    mLabels->removeAllObjects();
+    mMessageIDs->removeAllObjects();
+    mThreadIDs->removeAllObjects();
+    mIndexesBuilt = false;
+}
+
+void IMAPGmailMirror::addMessageToIndexes(IMAPMessage * message)
+{
+    Value * uid = Value::valueWithUnsignedIntValue(message->uid());
+    if (message->gmailMessageID() != 0) {
+        mMessageIDs->setObjectForKey(Value::valueWithUnsignedLongLongValue(message->gmailMessageID()), uid);
+    }
+    if (message->gmailThreadID() != 0) {
+        Value * threadID = Value::valueWithUnsignedLongLongValue(message->gmailThreadID());
+        IndexSet * threadUids = (IndexSet *) mThreadIDs->objectForKey(threadID);
+        if (threadUids == NULL) {
+            threadUids = IndexSet::indexSet();
+            mThreadIDs->setObjectForKey(threadID, threadUids);
+        }
+        threadUids->addIndex(message->uid());
+    }
+    if (message->gmailLabels() != NULL) {
+        mc_foreacharray(String, label, message->gmailLabels()) {
+            IndexSet * labelUids = (IndexSet *) mLabels->objectForKey(label);
+            if (labelUids == NULL) {
+                labelUids = IndexSet::indexSet();
+                mLabels->setObjectForKey(label, labelUids);
+            }
+            labelUids->addIndex(message->uid());
+        }
+    }
+}
+
+void IMAPGmailMirror::removeUIDsFromIndexes(IndexSet * uids)
+{
+    if (uids->count() == 0) {
+        return;
+    }
+
+    Array * emptyKeys = Array::array();
+    mc_foreachhashmapKeyAndValue(String, label, IndexSet, labelUids, mLabels) {
+        labelUids->removeIndexSet(uids);
+        if (labelUids->count() == 0) {
+            emptyKeys->addObject(label);
+        }
+    }
+    mc_foreacharray(String, emptyLabel, emptyKeys) {
+        mLabels->removeObjectForKey(emptyLabel);
+    }
+
+    emptyKeys->removeAllObjects();
+    mc_foreachhashmapKeyAndValue(Value, threadID, IndexSet, threadUids, mThreadIDs) {
+        threadUids->removeIndexSet(uids);
+        if (threadUids->count() == 0) {
+            emptyKeys->addObject(threadID);
+        }
+    }
+    mc_foreacharray(Value, emptyThreadID, emptyKeys) {
+        mThreadIDs->removeObjectForKey(emptyThreadID);
+    }
+
+    emptyKeys->removeAllObjects();
+    mc_foreachhashmapKeyAndValue(Value, messageID, Value, uid, mMessageIDs) {
+        if (uids->containsIndex(uid->unsignedIntValue())) {
+            emptyKeys->addObject(messageID);
+        }
+    }
+    mc_foreacharray(Value, removedMessageID, emptyKeys) {
+        mMessageIDs->removeObjectForKey(removedMessageID);
+    }
+}
+
+void IMAPGmailMirror::buildIndexesIfNeeded()
+{
+    if (mIndexesBuilt) {
+        return;
+    }
+    mc_foreacharray(IMAPMessage, message, messagesForUIDs(uids())) {
+        addMessageToIndexes(message);
+    }
+    mIndexesBuilt = true;
+}
+
+Array * IMAPGmailMirror::labels()
+{
+    buildIndexesIfNeeded();
+    return mLabels->allKeys();
+}
+
+IndexSet * IMAPGmailMirror::uidsForLabel(String * label)
+{
+    buildIndexesIfNeeded();
+    IndexSet * labelUids = (IndexSet *) mLabels->objectForKey(label);
+    if (labelUids == NULL) {
+        return IndexSet::indexSet();
+    }
+    return (IndexSet *) labelUids->copy()->autorelease();
+}
+
+Array * IMAPGmailMirror::messagesForLabel(String * label)
+{
+    return messagesForUIDs(uidsForLabel(label));
+}
+
+IndexSet * IMAPGmailMirror::uidsForGmailThreadID(uint64_t threadID)
+{
+    buildIndexesIfNeeded();
+    IndexSet * threadUids = (IndexSet *) mThreadIDs->objectForKey(Value::valueWithUnsignedLongLongValue(threadID));
+    if (threadUids == NULL) {
+        return IndexSet::indexSet();
+    }
+    return (IndexSet *) threadUids->copy()->autorelease();
+}
+
+uint32_t IMAPGmailMirror::uidForGmailMessageID(uint64_t messageID)
+{
+    buildIndexesIfNeeded();
+    Value * uid = (Value *) mMessageIDs->objectForKey(Value::valueWithUnsignedLongLongValue(messageID));
+    if (uid == NULL) {
+        return 0;
+    }
+    return uid->unsignedIntValue();
+}
+
+IMAPMessage * IMAPGmailMirror::messageForGmailMessageID(uint64_t messageID)
+{
+    uint32_t uid = uidForGmailMessageID(messageID);
+    if (uid == 0) {
+        return NULL;
+    }
+    return messageForUID(uid);
+}
+
+static String * folderWithFlag(IMAPSession * session, IMAPFolderFlag flag, ErrorCode * pError)
+{
+    Array * folders = session->fetchAllFolders(pError);
+    if (* pError != ErrorNone) {
+        return NULL;
+    }
+    mc_foreacharray(IMAPFolder, imapFolder, folders) {
+        if ((imapFolder->flags() & flag) != 0) {
+            return imapFolder->path();
+        }
+    }
+    return NULL;
+}
+
+String * IMAPGmailMirror::allMailFolder(IMAPSession * session, ErrorCode * pError)
+{
+    return folderWithFlag(session, IMAPFolderFlagAllMail, pError);
+}
+
+String * IMAPGmailMirror::spamFolder(IMAPSession * session, ErrorCode * pError)
+{
+    return folderWithFlag(session, IMAPFolderFlagSpam, pError);
+}
+
+String * IMAPGmailMirror::trashFolder(IMAPSession * session, ErrorCode * pError)
+{
+    return folderWithFlag(session, IMAPFolderFlagTrash, pError);
+}
+
+IndexSet * IMAPGmailMirror::search(IMAPSession * session, String * query, ErrorCode * pError)
+{
+    MCAssert(folder() != NULL);
+
+    IndexSet * result = session->search(folder(), IMAPSearchExpression::searchGmailRaw(query), pError);
+    if (* pError != ErrorNone) {
+        return NULL;
+    }
+    // Messages added since the last sync are not returned.
+    result->intersectsIndexSet(uids());
+    return result;
+}
+
+IMAPSyncResult * IMAPGmailMirror::sync(IMAPSession * session, IMAPProgressCallback * progressCallback, ErrorCode * pError)
+{
+    if (folder() == NULL) {
+        String * path = allMailFolder(session, pError);
+        if (* pError != ErrorNone) {
+            return NULL;
+        }
+        if (path == NULL) {
+            * pError = ErrorNonExistantFolder;
+            return NULL;
+        }
+        setFolder(path);
+    }
+
+    IMAPSyncResult * result = IMAPFolderMirror::sync(session, progressCallback, pError);
+    if (* pError != ErrorNone) {
+        return NULL;
+    }
+
+    // A reset during the sync clears the indexes: they're then built again when needed.
+    if (mIndexesBuilt) {
+        removeUIDsFromIndexes(result->vanishedMessages());
+        IndexSet * changedUids = IndexSet::indexSet();
+        mc_foreacharray(IMAPMessage, changedMessage, result->modifiedOrAddedMessages()) {
+            changedUids->addIndex(changedMessage->uid());
+        }
+        removeUIDsFromIndexes(changedUids);
+        mc_foreacharray(IMAPMessage, message, result->modifiedOrAddedMessages()) {
+            addMessageToIndexes(message);
+        }
+    }
+    return result;
+}
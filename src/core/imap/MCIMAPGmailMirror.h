@@ -0,0 +1,78 @@
+//
+//  MCIMAPGmailMirror.h
+//  mailcore2
+//
+//  Created by agent on 10/18/26.
+//  Copyright (c) 2026 MailCore. All rights reserved.
+//
+
+#ifndef MAILCORE_MCIMAPGMAILMIRROR_H
+
+#define MAILCORE_MCIMAPGMAILMIRROR_H
+
+#include <MailCore/MCIMAPFolderMirror.h>
+
+#ifdef __cplusplus
+
+namespace mailcore {
+
+    // Mirror of the All Mail folder of a Gmail account. Each message is fetched once, with its Gmail
+    // message ID, thread ID and labels, instead of once per label folder. The messages of a label are then
+    // found locally. System labels are named by Gmail with a backslash: \Inbox, \Sent, \Draft, \Important.
+    // Messages in Spam and Trash are not in All Mail and are not synced by this mirror. Their UIDs are not in
+    // the UID space of All Mail: they can be synced with an IMAPFolderMirror of spamFolder() and trashFolder().
+    // It's not thread-safe: it should be used from one thread at a time.
+    class MAILCORE_EXPORT IMAPGmailMirror : public IMAPFolderMirror {
+    public:
+        IMAPGmailMirror();
+        virtual ~IMAPGmailMirror();
+
+        // Gmail message ID, thread ID and labels are always fetched.
+        virtual void setRequestKind(IMAPMessagesRequestKind requestKind);
+
+        // Labels of the messages of the mirror.
+        virtual Array * /* String */ labels();
+        virtual IndexSet * uidsForLabel(String * label);
+        virtual Array * /* IMAPMessage */ messagesForLabel(String * label);
+        virtual IndexSet * uidsForGmailThreadID(uint64_t threadID);
+        // Returns 0 if the message is not in the mirror.
+        virtual uint32_t uidForGmailMessageID(uint64_t messageID);
+        // Returns NULL if the message is not in the mirror.
+        virtual IMAPMessage * messageForGmailMessageID(uint64_t messageID);
+
+        // Searches All Mail on the server with the Gmail search syntax (X-GM-RAW).
+        // Returns the UIDs of the matching messages that are in the mirror.
+        virtual IndexSet * search(IMAPSession * session, String * query, ErrorCode * pError);
+
+        // Return the path of the All Mail, Spam and Trash folders of the account, NULL if it has not been found.
+        static String * allMailFolder(IMAPSession * session, ErrorCode * pError);
+        static String * spamFolder(IMAPSession * session, ErrorCode * pError);
+        static String * trashFolder(IMAPSession * session, ErrorCode * pError);
+
+    public: // subclass behavior
+        virtual String * description();
+        virtual void reset();
+        // If no folder has been set, the All Mail folder is looked up first.
+        virtual IMAPSyncResult * sync(IMAPSession * session, IMAPProgressCallback * progressCallback, ErrorCode * pError);
+
+    private:
+        // label -> IndexSet of UIDs
+        HashMap * mLabels;
+        // Gmail message ID -> UID
+        HashMap * mMessageIDs;
+        // Gmail thread ID -> IndexSet of UIDs
+        HashMap * mThreadIDs;
+        // The indexes are built from the messages when they're first needed.
+        bool mIndexesBuilt;
+
+        void init();
+        void buildIndexesIfNeeded();
+        void addMessageToIndexes(IMAPMessage * message);
+        void removeUIDsFromIndexes(IndexSet * uids);
+    };
+
+}
+
+#endif
+
+#endif
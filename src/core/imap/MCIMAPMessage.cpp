@@ -5,6 +5,7 @@
 #include "MCIMAPPart.h"
 #include "MCIMAPMessagePart.h"
 #include "MCIMAPMultipart.h"
+#include "MCIMAPBodyStructure.h"
 #include "MCHTMLRenderer.h"
 #include "MCHTMLRendererCallback.h"
 
@@ -22,11 +23,14 @@ void IMAPMessage::init()
     mOriginalFlags = MessageFlagNone;
     mCustomFlags = NULL;
     mMainPart = NULL;
+    mBodyStructure = NULL;
+    mBodyStructureParts = NULL;
     mGmailLabels = NULL;
     mModSeqValue = 0;
     mGmailThreadID = 0;
     mGmailMessageID = 0;
     mSize = 0;
+    mPreview = NULL;
 }
 
 IMAPMessage::IMAPMessage()
@@ -42,7 +46,11 @@ IMAPMessage::IMAPMessage(IMAPMessage * other) : AbstractMessage(other)
     setFlags(other->flags());
     setOriginalFlags(other->originalFlags());
     setCustomFlags(other->customFlags());
-    if (other->mainPart() != NULL) {
+    if (other->bodyStructure() != NULL) {
+        // The body structure is immutable.
+        setBodyStructure(other->bodyStructure());
+    }
+    else if (other->mainPart() != NULL) {
         setMainPart((AbstractPart *) other->mainPart()->copy()->autorelease());
     }
     else {
@@ -51,10 +59,14 @@ IMAPMessage::IMAPMessage(IMAPMessage * other) : AbstractMessage(other)
     setGmailLabels(other->gmailLabels());
     setGmailThreadID(other->gmailThreadID());
     setGmailMessageID(other->gmailMessageID());
+    setPreview(other->preview());
 }
 
 IMAPMessage::~IMAPMessage()
 {
+    MC_SAFE_RELEASE(mPreview);
+    MC_SAFE_RELEASE(mBodyStructureParts);
+    MC_SAFE_RELEASE(mBodyStructure);
     MC_SAFE_RELEASE(mMainPart);
     MC_SAFE_RELEASE(mGmailLabels);
     MC_SAFE_RELEASE(mCustomFlags);
@@ -151,13 +163,41 @@ uint64_t IMAPMessage::modSeqValue()
 void IMAPMessage::setMainPart(AbstractPart * mainPart)
 {
     MC_SAFE_REPLACE_RETAIN(AbstractPart, mMainPart, mainPart);
+    MC_SAFE_RELEASE(mBodyStructure);
+    MC_SAFE_RELEASE(mBodyStructureParts);
 }
 
 AbstractPart * IMAPMessage::mainPart()
 {
+    if ((mMainPart == NULL) && (mBodyStructure != NULL)) {
+        mBodyStructureParts = new Array();
+        mMainPart = mBodyStructure->mainPartAndParts(mBodyStructureParts);
+        MC_SAFE_RETAIN(mMainPart);
+    }
     return mMainPart;
 }
 
+void IMAPMessage::setBodyStructure(IMAPBodyStructure * bodyStructure)
+{
+    MC_SAFE_REPLACE_RETAIN(IMAPBodyStructure, mBodyStructure, bodyStructure);
+    MC_SAFE_RELEASE(mBodyStructureParts);
+    MC_SAFE_RELEASE(mMainPart);
+}
+
+IMAPBodyStructure * IMAPMessage::bodyStructure()
+{
+    return mBodyStructure;
+}
+
+AbstractPart * IMAPMessage::bodyStructurePartAtIndex(int idx)
+{
+    if (idx == -1) {
+        return NULL;
+    }
+    mainPart();
+    return (AbstractPart *) mBodyStructureParts->objectAtIndex(idx);
+}
+
 void IMAPMessage::setGmailLabels(Array * labels)
 {
     MC_SAFE_REPLACE_COPY(Array, mGmailLabels, labels);
@@ -188,8 +228,21 @@ uint64_t IMAPMessage::gmailThreadID()
     return mGmailThreadID;
 }
 
+void IMAPMessage::setPreview(String * preview)
+{
+    MC_SAFE_REPLACE_COPY(String, mPreview, preview);
+}
+
+String * IMAPMessage::preview()
+{
+    return mPreview;
+}
+
 AbstractPart * IMAPMessage::partForPartID(String * partID)
 {
+    if (mBodyStructure != NULL) {
+        return bodyStructurePartAtIndex(mBodyStructure->indexForPartID(partID));
+    }
     return partForPartIDInPart(mainPart(), partID);
 }
 
@@ -237,11 +290,17 @@ static AbstractPart * partForPartIDInMultipart(AbstractMultipart * part, String
 
 AbstractPart * IMAPMessage::partForContentID(String * contentID)
 {
+    if (mBodyStructure != NULL) {
+        return bodyStructurePartAtIndex(mBodyStructure->indexForContentID(contentID));
+    }
     return mainPart()->partForContentID(contentID);
 }
 
 AbstractPart * IMAPMessage::partForUniqueID(String * uniqueID)
 {
+    if (mBodyStructure != NULL) {
+        return bodyStructurePartAtIndex(mBodyStructure->indexForUniqueID(uniqueID));
+    }
     return mainPart()->partForUniqueID(uniqueID);
 }
 
@@ -264,8 +323,8 @@ HashMap * IMAPMessage::serializable()
     if (customFlags() != NULL) {
         result->setObjectForKey(MCSTR("customFlags"), customFlags());
     }
-    if (mMainPart != NULL) {
-        result->setObjectForKey(MCSTR("mainPart"), mMainPart->serializable());
+    if (mainPart() != NULL) {
+        result->setObjectForKey(MCSTR("mainPart"), mainPart()->serializable());
     }
     if (gmailLabels() != NULL) {
         result->setObjectForKey(MCSTR("gmailLabels"), gmailLabels());
@@ -276,6 +335,9 @@ HashMap * IMAPMessage::serializable()
     if (gmailThreadID() != 0) {
         result->setObjectForKey(MCSTR("gmailThreadID"), String::stringWithUTF8Format("%llu", (long long unsigned) gmailThreadID()));
     }
+    if (preview() != NULL) {
+        result->setObjectForKey(MCSTR("preview"), preview());
+    }
     return result;
 }
 
@@ -317,6 +379,7 @@ void IMAPMessage::importSerializable(HashMap * serializable)
     if (gmailThreadID != NULL) {
         setGmailThreadID(gmailThreadID->unsignedLongLongValue());
     }
+    setPreview((String *) serializable->objectForKey(MCSTR("preview")));
 }
 
 static void * createObject()
@@ -12,6 +12,7 @@
 namespace mailcore {
     
     class IMAPPart;
+    class IMAPBodyStructure;
     class HTMLRendererIMAPCallback;
     class HTMLRendererTemplateCallback;
     
@@ -44,6 +45,11 @@ namespace mailcore {
         virtual void setMainPart(AbstractPart * mainPart);
         virtual AbstractPart * mainPart();
         
+        // The tree of parts is created from the body structure when it's needed.
+        // The parts are then looked up using the indexes of the body structure.
+        virtual void setBodyStructure(IMAPBodyStructure * bodyStructure);
+        virtual IMAPBodyStructure * bodyStructure();
+        
         virtual void setGmailLabels(Array * /* String */ labels);
         virtual Array * /* String */ gmailLabels();
         
@@ -53,6 +59,10 @@ namespace mailcore {
         virtual void setGmailThreadID(uint64_t threadID);
         virtual uint64_t gmailThreadID();
         
+        // Short plain text extract of the body, set when fetched with IMAPMessagesRequestKindPreview.
+        virtual void setPreview(String * preview);
+        virtual String * preview();
+        
         virtual AbstractPart * partForPartID(String * partID);
         
         virtual AbstractPart * partForContentID(String * contentID);
@@ -79,10 +89,15 @@ namespace mailcore {
         MessageFlag mOriginalFlags;
         Array * /* String */ mCustomFlags;
         AbstractPart * mMainPart;
+        IMAPBodyStructure * mBodyStructure;
+        // Parts of mMainPart in the order of the indexes of mBodyStructure.
+        Array * /* AbstractPart */ mBodyStructureParts;
         Array * /* String */ mGmailLabels;
         uint64_t mGmailMessageID;
         uint64_t mGmailThreadID;
+        String * mPreview;
         void init();
+        AbstractPart * bodyStructurePartAtIndex(int idx);
     };
     
 }
@@ -0,0 +1,33 @@
+//
+//  MCIMAPMessageStreamCallback.h
+//  mailcore2
+//
+//  Created by agent on 10/18/26.
+//  Copyright (c) 2026 MailCore. All rights reserved.
+//
+
+#ifndef MAILCORE_MCIMAPMESSAGESTREAMCALLBACK_H
+
+#define MAILCORE_MCIMAPMESSAGESTREAMCALLBACK_H
+
+#ifdef __cplusplus
+
+#include <MailCore/MCUtils.h>
+
+namespace mailcore {
+
+    class IMAPSession;
+    class IMAPMessage;
+
+    class MAILCORE_EXPORT IMAPMessageStreamCallback {
+    public:
+        // Called as soon as the FETCH response of the message has been parsed.
+        // The message should be retained to be kept.
+        virtual void messageFetched(IMAPSession * session, IMAPMessage * message) {};
+    };
+
+}
+
+#endif
+
+#endif
@@ -0,0 +1,929 @@
+//
+//  MCIMAPMessageTable.cpp
+//  mailcore2
+//
+//  Created by agent on 10/18/26.
+//  Copyright (c) 2026 MailCore. All rights reserved.
+//
+
+#include "MCWin32.h" // should be included first.
+
+#include "MCIMAPMessageTable.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "MCDefines.h"
+#include "MCIMAPMessage.h"
+#include "MCIMAPSearchEvaluator.h"
+#include "MCIMAPSortCriterion.h"
+#include "MCMessageHeader.h"
+#include "MCAddress.h"
+
+using namespace mailcore;
+
+template <typename T> static void resizeColumn(T ** column, unsigned int capacity)
+{
+    * column = (T *) realloc(* column, sizeof(T) * capacity);
+}
+
+template <typename T> static void permuteColumn(T * column, uint32_t * permutation, unsigned int count)
+{
+    T * original = (T *) malloc(sizeof(T) * count);
+    memcpy(original, column, sizeof(T) * count);
+    for(unsigned int i = 0 ; i < count ; i ++) {
+        column[i] = original[permutation[i]];
+    }
+    free(original);
+}
+
+typedef int (* IndexCompareFunction)(uint32_t a, uint32_t b, void * context);
+
+// Stable sort of indexes.
+static void mergeSortIndexes(uint32_t * items, uint32_t * scratch, unsigned int count,
+                             IndexCompareFunction compare, void * context)
+{
+    if (count < 2) {
+        return;
+    }
+    unsigned int middle = count / 2;
+    mergeSortIndexes(items, scratch, middle, compare, context);
+    mergeSortIndexes(items + middle, scratch, count - middle, compare, context);
+    if (compare(items[middle - 1], items[middle], context) <= 0) {
+        return;
+    }
+    memcpy(scratch, items, sizeof(* items) * middle);
+    unsigned int left = 0;
+    unsigned int right = middle;
+    unsigned int position = 0;
+    while ((left < middle) && (right < count)) {
+        if (compare(items[right], scratch[left], context) < 0) {
+            items[position ++] = items[right ++];
+        }
+        else {
+            items[position ++] = scratch[left ++];
+        }
+    }
+    while (left < middle) {
+        items[position ++] = scratch[left ++];
+    }
+}
+
+static int compareStrings(uint32_t a, uint32_t b, void * context)
+{
+    Array * strings = (Array *) context;
+    return ((String *) strings->objectAtIndex(a))->compare((String *) strings->objectAtIndex(b));
+}
+
+// Gives the same rank to equal strings, in the order of the strings.
+static int32_t * ranksForStrings(Array * strings)
+{
+    unsigned int count = strings->count();
+    int32_t * ranks = (int32_t *) malloc(sizeof(* ranks) * (count > 0 ? count : 1));
+    uint32_t * order = (uint32_t *) malloc(sizeof(* order) * (count > 0 ? count : 1));
+    uint32_t * scratch = (uint32_t *) malloc(sizeof(* scratch) * (count > 0 ? count : 1));
+    for(unsigned int i = 0 ; i < count ; i ++) {
+        order[i] = i;
+    }
+    mergeSortIndexes(order, scratch, count, compareStrings, strings);
+    int32_t rank = 0;
+    for(unsigned int i = 0 ; i < count ; i ++) {
+        if ((i > 0) && (compareStrings(order[i - 1], order[i], strings) != 0)) {
+            rank ++;
+        }
+        ranks[order[i]] = rank;
+    }
+    free(scratch);
+    free(order);
+    return ranks;
+}
+
+struct sort_context {
+    unsigned int criteriaCount;
+    int64_t ** keys;
+    bool * reversed;
+    uint32_t * uids;
+};
+
+static int compareRows(uint32_t a, uint32_t b, void * context)
+{
+    struct sort_context * sortContext = (struct sort_context *) context;
+    for(unsigned int i = 0 ; i < sortContext->criteriaCount ; i ++) {
+        int64_t * keys = sortContext->keys[i];
+        int result = 0;
+        if (keys[a] < keys[b]) {
+            result = -1;
+        }
+        else if (keys[a] > keys[b]) {
+            result = 1;
+        }
+        if (result != 0) {
+            return sortContext->reversed[i] ? -result : result;
+        }
+    }
+    if (sortContext->uids[a] < sortContext->uids[b]) {
+        return -1;
+    }
+    if (sortContext->uids[a] > sortContext->uids[b]) {
+        return 1;
+    }
+    return 0;
+}
+
+static String * addressText(Address * address)
+{
+    String * result = String::string();
+    if (address->displayName() != NULL) {
+        result->appendString(address->displayName());
+        result->appendUTF8Characters(" ");
+    }
+    if (address->mailbox() != NULL) {
+        result->appendUTF8Characters("<");
+        result->appendString(address->mailbox());
+        result->appendUTF8Characters(">");
+    }
+    return result;
+}
+
+// Returns the new index of an entry of a pool, adding it to the new pool if needed.
+static int32_t remappedPoolIndex(int32_t idx, int32_t * indexesMap, Array * pool, Array * newPool, HashMap * newPoolIndexes)
+{
+    if (idx == -1) {
+        return -1;
+    }
+    if (indexesMap[idx] == -1) {
+        Object * value = pool->objectAtIndex(idx);
+        indexesMap[idx] = (int32_t) newPool->count();
+        newPool->addObject(value);
+        if (newPoolIndexes != NULL) {
+            newPoolIndexes->setObjectForKey(value, Value::valueWithIntValue(indexesMap[idx]));
+        }
+    }
+    return indexesMap[idx];
+}
+
+static int32_t * newIndexesMap(Array * pool)
+{
+    unsigned int count = pool->count();
+    int32_t * indexesMap = (int32_t *) malloc(sizeof(* indexesMap) * (count > 0 ? count : 1));
+    for(unsigned int i = 0 ; i < count ; i ++) {
+        indexesMap[i] = -1;
+    }
+    return indexesMap;
+}
+
+static String * tableText(void * context, unsigned int row, String * header)
+{
+    return ((IMAPMessageTable *) context)->lowercasedTextAtIndex(row, header);
+}
+
+static bool hasSpamFlag(IMAPMessage * message)
+{
+    Array * customFlags = message->customFlags();
+    if (customFlags == NULL) {
+        return false;
+    }
+    mc_foreacharray(String, flag, customFlags) {
+        if (flag->isEqualCaseInsensitive(MCSTR("Junk"))) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void IMAPMessageTable::init()
+{
+    mCount = 0;
+    mCapacity = 0;
+    mUids = NULL;
+    mNumbers = NULL;
+    mFlags = NULL;
+    mSizes = NULL;
+    mSpam = NULL;
+    mDates = NULL;
+    mReceivedDates = NULL;
+    mModSeqs = NULL;
+    mGmailThreadIDs = NULL;
+    mGmailMessageIDs = NULL;
+    mSubjectIndexes = NULL;
+    mFromIndexes = NULL;
+    mMessageIDIndexes = NULL;
+    mRecipientsStarts = NULL;
+    mToCounts = NULL;
+    mCcCounts = NULL;
+    mBccCounts = NULL;
+    mRecipients = NULL;
+    mRecipientsCount = 0;
+    mRecipientsCapacity = 0;
+    mSubjects = new Array();
+    mSubjectsIndexes = new HashMap();
+    mAddresses = new Array();
+    mAddressesIndexes = new HashMap();
+    mMessageIDs = new Array();
+    mDays = NULL;
+    mReceivedDays = NULL;
+    mSortedByUID = true;
+}
+
+IMAPMessageTable::IMAPMessageTable()
+{
+    init();
+}
+
+IMAPMessageTable::~IMAPMessageTable()
+{
+    invalidateDays();
+    free(mRecipients);
+    free(mBccCounts);
+    free(mCcCounts);
+    free(mToCounts);
+    free(mRecipientsStarts);
+    free(mMessageIDIndexes);
+    free(mFromIndexes);
+    free(mSubjectIndexes);
+    free(mGmailMessageIDs);
+    free(mGmailThreadIDs);
+    free(mModSeqs);
+    free(mReceivedDates);
+    free(mDates);
+    free(mSpam);
+    free(mSizes);
+    free(mFlags);
+    free(mNumbers);
+    free(mUids);
+    MC_SAFE_RELEASE(mMessageIDs);
+    MC_SAFE_RELEASE(mAddressesIndexes);
+    MC_SAFE_RELEASE(mAddresses);
+    MC_SAFE_RELEASE(mSubjectsIndexes);
+    MC_SAFE_RELEASE(mSubjects);
+}
+
+unsigned int IMAPMessageTable::count()
+{
+    return mCount;
+}
+
+void IMAPMessageTable::setCapacity(unsigned int capacity)
+{
+    resizeColumn(&mUids, capacity);
+    resizeColumn(&mNumbers, capacity);
+    resizeColumn(&mFlags, capacity);
+    resizeColumn(&mSizes, capacity);
+    resizeColumn(&mSpam, capacity);
+    resizeColumn(&mDates, capacity);
+    resizeColumn(&mReceivedDates, capacity);
+    resizeColumn(&mModSeqs, capacity);
+    resizeColumn(&mGmailThreadIDs, capacity);
+    resizeColumn(&mGmailMessageIDs, capacity);
+    resizeColumn(&mSubjectIndexes, capacity);
+    resizeColumn(&mFromIndexes, capacity);
+    resizeColumn(&mMessageIDIndexes, capacity);
+    resizeColumn(&mRecipientsStarts, capacity);
+    resizeColumn(&mToCounts, capacity);
+    resizeColumn(&mCcCounts, capacity);
+    resizeColumn(&mBccCounts, capacity);
+    mCapacity = capacity;
+}
+
+void IMAPMessageTable::invalidateDays()
+{
+    free(mDays);
+    mDays = NULL;
+    free(mReceivedDays);
+    mReceivedDays = NULL;
+}
+
+int32_t IMAPMessageTable::internedSubject(String * subject)
+{
+    if (subject == NULL) {
+        return -1;
+    }
+    Value * index = (Value *) mSubjectsIndexes->objectForKey(subject);
+    if (index != NULL) {
+        return index->intValue();
+    }
+    int32_t result = (int32_t) mSubjects->count();
+    mSubjects->addObject(subject);
+    mSubjectsIndexes->setObjectForKey(subject, Value::valueWithIntValue(result));
+    return result;
+}
+
+int32_t IMAPMessageTable::internedAddress(Address * address)
+{
+    if (address == NULL) {
+        return -1;
+    }
+    Value * index = (Value *) mAddressesIndexes->objectForKey(address);
+    if (index != NULL) {
+        return index->intValue();
+    }
+    int32_t result = (int32_t) mAddresses->count();
+    mAddresses->addObject(address);
+    mAddressesIndexes->setObjectForKey(address, Value::valueWithIntValue(result));
+    return result;
+}
+
+void IMAPMessageTable::appendRecipients(Array * addresses)
+{
+    if (addresses == NULL) {
+        return;
+    }
+    mc_foreacharray(Address, address, addresses) {
+        if (mRecipientsCount >= mRecipientsCapacity) {
+            mRecipientsCapacity = (mRecipientsCapacity == 0) ? 256 : mRecipientsCapacity * 2;
+            resizeColumn(&mRecipients, mRecipientsCapacity);
+        }
+        mRecipients[mRecipientsCount] = (uint32_t) internedAddress(address);
+        mRecipientsCount ++;
+    }
+}
+
+void IMAPMessageTable::setRowWithMessage(unsigned int idx, IMAPMessage * message)
+{
+    MessageHeader * header = message->header();
+    mUids[idx] = message->uid();
+    mNumbers[idx] = message->sequenceNumber();
+    mFlags[idx] = (uint32_t) message->flags();
+    mSizes[idx] = message->size();
+    mSpam[idx] = hasSpamFlag(message);
+    mDates[idx] = (int64_t) header->date();
+    mReceivedDates[idx] = (int64_t) header->receivedDate();
+    mModSeqs[idx] = message->modSeqValue();
+    mGmailThreadIDs[idx] = message->gmailThreadID();
+    mGmailMessageIDs[idx] = message->gmailMessageID();
+    mSubjectIndexes[idx] = internedSubject(header->subject());
+    mFromIndexes[idx] = internedAddress(header->from());
+    if (header->messageID() != NULL) {
+        mMessageIDIndexes[idx] = (int32_t) mMessageIDs->count();
+        mMessageIDs->addObject(header->messageID());
+    }
+    else {
+        mMessageIDIndexes[idx] = -1;
+    }
+    mRecipientsStarts[idx] = mRecipientsCount;
+    mToCounts[idx] = (header->to() != NULL) ? (uint16_t) header->to()->count() : 0;
+    mCcCounts[idx] = (header->cc() != NULL) ? (uint16_t) header->cc()->count() : 0;
+    mBccCounts[idx] = (header->bcc() != NULL) ? (uint16_t) header->bcc()->count() : 0;
+    appendRecipients(header->to());
+    appendRecipients(header->cc());
+    appendRecipients(header->bcc());
+}
+
+void IMAPMessageTable::addMessage(IMAPMessage * message)
+{
+    invalidateDays();
+
+    int idx = indexOfUID(message->uid());
+    if (idx != -1) {
+        // Updates of known messages only have the flags.
+        mFlags[idx] = (uint32_t) message->flags();
+        mSpam[idx] = hasSpamFlag(message);
+        if (message->modSeqValue() != 0) {
+            mModSeqs[idx] = message->modSeqValue();
+        }
+        return;
+    }
+
+    if (mCount >= mCapacity) {
+        setCapacity((mCapacity == 0) ? 256 : mCapacity * 2);
+    }
+    if ((mCount > 0) && (message->uid() < mUids[mCount - 1])) {
+        mSortedByUID = false;
+    }
+    setRowWithMessage(mCount, message);
+    mCount ++;
+}
+
+void IMAPMessageTable::addMessages(Array * messages)
+{
+    mc_foreacharray(IMAPMessage, message, messages) {
+        addMessage(message);
+    }
+}
+
+void IMAPMessageTable::messageFetched(IMAPSession * session, IMAPMessage * message)
+{
+    addMessage(message);
+}
+
+// Removes the recipients of the removed rows.
+void IMAPMessageTable::compactRecipients()
+{
+    uint32_t * recipients = (uint32_t *) malloc(sizeof(* recipients) * (mRecipientsCount > 0 ? mRecipientsCount : 1));
+    unsigned int recipientsCount = 0;
+    for(unsigned int i = 0 ; i < mCount ; i ++) {
+        unsigned int rowCount = mToCounts[i] + mCcCounts[i] + mBccCounts[i];
+        memcpy(recipients + recipientsCount, mRecipients + mRecipientsStarts[i], sizeof(* recipients) * rowCount);
+        mRecipientsStarts[i] = recipientsCount;
+        recipientsCount += rowCount;
+    }
+    free(mRecipients);
+    mRecipients = recipients;
+    mRecipientsCount = recipientsCount;
+    mRecipientsCapacity = (mRecipientsCount > 0) ? mRecipientsCount : 1;
+}
+
+// Removes the subjects, addresses and message-ids that are not used by the rows anymore.
+void IMAPMessageTable::compactPools()
+{
+    Array * subjects = new Array();
+    HashMap * subjectsIndexes = new HashMap();
+    int32_t * subjectsMap = newIndexesMap(mSubjects);
+    Array * addresses = new Array();
+    HashMap * addressesIndexes = new HashMap();
+    int32_t * addressesMap = newIndexesMap(mAddresses);
+    Array * messageIDs = new Array();
+    int32_t * messageIDsMap = newIndexesMap(mMessageIDs);
+    for(unsigned int i = 0 ; i < mCount ; i ++) {
+        mSubjectIndexes[i] = remappedPoolIndex(mSubjectIndexes[i], subjectsMap, mSubjects, subjects, subjectsIndexes);
+        mFromIndexes[i] = remappedPoolIndex(mFromIndexes[i], addressesMap, mAddresses, addresses, addressesIndexes);
+        mMessageIDIndexes[i] = remappedPoolIndex(mMessageIDIndexes[i], messageIDsMap, mMessageIDs, messageIDs, NULL);
+    }
+    for(unsigned int i = 0 ; i < mRecipientsCount ; i ++) {
+        mRecipients[i] = (uint32_t) remappedPoolIndex((int32_t) mRecipients[i], addressesMap, mAddresses, addresses,
+                                                      addressesIndexes);
+    }
+    free(messageIDsMap);
+    free(addressesMap);
+    free(subjectsMap);
+
+    MC_SAFE_RELEASE(mSubjects);
+    mSubjects = subjects;
+    MC_SAFE_RELEASE(mSubjectsIndexes);
+    mSubjectsIndexes = subjectsIndexes;
+    MC_SAFE_RELEASE(mAddresses);
+    mAddresses = addresses;
+    MC_SAFE_RELEASE(mAddressesIndexes);
+    mAddressesIndexes = addressesIndexes;
+    MC_SAFE_RELEASE(mMessageIDs);
+    mMessageIDs = messageIDs;
+}
+
+void IMAPMessageTable::removeUIDs(IndexSet * uids)
+{
+    if ((uids == NULL) || (uids->count() == 0)) {
+        return;
+    }
+    invalidateDays();
+
+    unsigned int kept = 0;
+    for(unsigned int i = 0 ; i < mCount ; i ++) {
+        if (uids->containsIndex(mUids[i])) {
+            continue;
+        }
+        if (kept != i) {
+            mUids[kept] = mUids[i];
+            mNumbers[kept] = mNumbers[i];
+            mFlags[kept] = mFlags[i];
+            mSizes[kept] = mSizes[i];
+            mSpam[kept] = mSpam[i];
+            mDates[kept] = mDates[i];
+            mReceivedDates[kept] = mReceivedDates[i];
+            mModSeqs[kept] = mModSeqs[i];
+            mGmailThreadIDs[kept] = mGmailThreadIDs[i];
+            mGmailMessageIDs[kept] = mGmailMessageIDs[i];
+            mSubjectIndexes[kept] = mSubjectIndexes[i];
+            mFromIndexes[kept] = mFromIndexes[i];
+            mMessageIDIndexes[kept] = mMessageIDIndexes[i];
+            mRecipientsStarts[kept] = mRecipientsStarts[i];
+            mToCounts[kept] = mToCounts[i];
+            mCcCounts[kept] = mCcCounts[i];
+            mBccCounts[kept] = mBccCounts[i];
+        }
+        kept ++;
+    }
+    if (kept == mCount) {
+        return;
+    }
+    mCount = kept;
+    compactRecipients();
+    compactPools();
+}
+
+void IMAPMessageTable::removeAllMessages()
+{
+    invalidateDays();
+    mCount = 0;
+    mRecipientsCount = 0;
+    mSubjects->removeAllObjects();
+    mSubjectsIndexes->removeAllObjects();
+    mAddresses->removeAllObjects();
+    mAddressesIndexes->removeAllObjects();
+    mMessageIDs->removeAllObjects();
+    mSortedByUID = true;
+}
+
+void IMAPMessageTable::setFlagsForUID(uint32_t uid, MessageFlag flags)
+{
+    int idx = indexOfUID(uid);
+    if (idx == -1) {
+        return;
+    }
+    mFlags[idx] = (uint32_t) flags;
+}
+
+int IMAPMessageTable::indexOfUID(uint32_t uid)
+{
+    if (mSortedByUID) {
+        unsigned int low = 0;
+        unsigned int high = mCount;
+        while (low < high) {
+            unsigned int middle = (low + high) / 2;
+            if (mUids[middle] < uid) {
+                low = middle + 1;
+            }
+            else {
+                high = middle;
+            }
+        }
+        if ((low < mCount) && (mUids[low] == uid)) {
+            return (int) low;
+        }
+        return -1;
+    }
+    for(unsigned int i = 0 ; i < mCount ; i ++) {
+        if (mUids[i] == uid) {
+            return (int) i;
+        }
+    }
+    return -1;
+}
+
+IndexSet * IMAPMessageTable::uids()
+{
+    IndexSet * result = IndexSet::indexSet();
+    for(unsigned int i = 0 ; i < mCount ; i ++) {
+        result->addIndex(mUids[i]);
+    }
+    return result;
+}
+
+uint32_t IMAPMessageTable::uidAtIndex(unsigned int idx)
+{
+    MCAssert(idx < mCount);
+    return mUids[idx];
+}
+
+MessageFlag IMAPMessageTable::flagsAtIndex(unsigned int idx)
+{
+    MCAssert(idx < mCount);
+    return (MessageFlag) mFlags[idx];
+}
+
+uint32_t IMAPMessageTable::sizeAtIndex(unsigned int idx)
+{
+    MCAssert(idx < mCount);
+    return mSizes[idx];
+}
+
+time_t IMAPMessageTable::dateAtIndex(unsigned int idx)
+{
+    MCAssert(idx < mCount);
+    return (time_t) mDates[idx];
+}
+
+time_t IMAPMessageTable::receivedDateAtIndex(unsigned int idx)
+{
+    MCAssert(idx < mCount);
+    return (time_t) mReceivedDates[idx];
+}
+
+uint64_t IMAPMessageTable::gmailThreadIDAtIndex(unsigned int idx)
+{
+    MCAssert(idx < mCount);
+    return mGmailThreadIDs[idx];
+}
+
+String * IMAPMessageTable::subjectAtIndex(unsigned int idx)
+{
+    MCAssert(idx < mCount);
+    if (mSubjectIndexes[idx] == -1) {
+        return NULL;
+    }
+    return (String *) mSubjects->objectAtIndex(mSubjectIndexes[idx]);
+}
+
+Address * IMAPMessageTable::fromAtIndex(unsigned int idx)
+{
+    MCAssert(idx < mCount);
+    if (mFromIndexes[idx] == -1) {
+        return NULL;
+    }
+    return (Address *) mAddresses->objectAtIndex(mFromIndexes[idx]);
+}
+
+IMAPMessage * IMAPMessageTable::messageAtIndex(unsigned int idx)
+{
+    MCAssert(idx < mCount);
+    IMAPMessage * message = new IMAPMessage();
+    message->setUid(mUids[idx]);
+    message->setSequenceNumber(mNumbers[idx]);
+    message->setFlags((MessageFlag) mFlags[idx]);
+    message->setOriginalFlags((MessageFlag) mFlags[idx]);
+    if (mSpam[idx]) {
+        message->setCustomFlags(Array::arrayWithObject(MCSTR("Junk")));
+    }
+    message->setSize(mSizes[idx]);
+    message->setModSeqValue(mModSeqs[idx]);
+    message->setGmailThreadID(mGmailThreadIDs[idx]);
+    message->setGmailMessageID(mGmailMessageIDs[idx]);
+
+    MessageHeader * header = message->header();
+    header->setDate((time_t) mDates[idx]);
+    header->setReceivedDate((time_t) mReceivedDates[idx]);
+    header->setSubject(subjectAtIndex(idx));
+    header->setFrom(fromAtIndex(idx));
+    if (mMessageIDIndexes[idx] != -1) {
+        header->setMessageID((String *) mMessageIDs->objectAtIndex(mMessageIDIndexes[idx]));
+    }
+    Array * to = Array::array();
+    Array * cc = Array::array();
+    Array * bcc = Array::array();
+    uint32_t * recipients = mRecipients + mRecipientsStarts[idx];
+    for(unsigned int i = 0 ; i < mToCounts[idx] ; i ++) {
+        to->addObject(mAddresses->objectAtIndex(recipients[i]));
+    }
+    for(unsigned int i = 0 ; i < mCcCounts[idx] ; i ++) {
+        cc->addObject(mAddresses->objectAtIndex(recipients[mToCounts[idx] + i]));
+    }
+    for(unsigned int i = 0 ; i < mBccCounts[idx] ; i ++) {
+        bcc->addObject(mAddresses->objectAtIndex(recipients[mToCounts[idx] + mCcCounts[idx] + i]));
+    }
+    header->setTo(to);
+    header->setCc(cc);
+    header->setBcc(bcc);
+
+    message->autorelease();
+    return message;
+}
+
+Array * IMAPMessageTable::messagesForUIDs(IndexSet * uids)
+{
+    Array * result = Array::array();
+    for(unsigned int i = 0 ; i < mCount ; i ++) {
+        if (uids->containsIndex(mUids[i])) {
+            result->addObject(messageAtIndex(i));
+        }
+    }
+    return result;
+}
+
+String * IMAPMessageTable::lowercasedTextAtIndex(unsigned int idx, String * header)
+{
+    String * text = NULL;
+    if (header->isEqual(MCSTR("subject"))) {
+        text = subjectAtIndex(idx);
+    }
+    else if (header->isEqual(MCSTR("from"))) {
+        if (mFromIndexes[idx] != -1) {
+            text = addressText(fromAtIndex(idx));
+        }
+    }
+    else if (header->isEqual(MCSTR("to")) || header->isEqual(MCSTR("cc")) || header->isEqual(MCSTR("bcc"))) {
+        uint32_t * recipients = mRecipients + mRecipientsStarts[idx];
+        unsigned int count = mToCounts[idx];
+        if (header->isEqual(MCSTR("cc"))) {
+            recipients += mToCounts[idx];
+            count = mCcCounts[idx];
+        }
+        else if (header->isEqual(MCSTR("bcc"))) {
+            recipients += mToCounts[idx] + mCcCounts[idx];
+            count = mBccCounts[idx];
+        }
+        String * result = String::string();
+        for(unsigned int i = 0 ; i < count ; i ++) {
+            if (i > 0) {
+                result->appendUTF8Characters(", ");
+            }
+            result->appendString(addressText((Address *) mAddresses->objectAtIndex(recipients[i])));
+        }
+        text = result;
+    }
+    else if (header->isEqual(MCSTR("message-id"))) {
+        if (mMessageIDIndexes[idx] != -1) {
+            text = (String *) mMessageIDs->objectAtIndex(mMessageIDIndexes[idx]);
+        }
+    }
+    if (text == NULL) {
+        return NULL;
+    }
+    return text->lowercaseString();
+}
+
+// Rank of each subject of the pool, using the subject without the prefixes of replies and forwards.
+int32_t * IMAPMessageTable::rankedSubjects()
+{
+    Array * sortStrings = Array::array();
+    mc_foreacharray(String, subject, mSubjects) {
+        sortStrings->addObject(subject->extractedSubject()->lowercaseString());
+    }
+    return ranksForStrings(sortStrings);
+}
+
+// Rank of each address of the pool, using the mailbox.
+int32_t * IMAPMessageTable::rankedAddresses()
+{
+    Array * sortStrings = Array::array();
+    mc_foreacharray(Address, address, mAddresses) {
+        String * mailbox = address->mailbox();
+        sortStrings->addObject(mailbox != NULL ? mailbox->lowercaseString() : MCSTR(""));
+    }
+    return ranksForStrings(sortStrings);
+}
+
+// A missing value is ranked first, like an empty string.
+int64_t * IMAPMessageTable::sortKeys(int kind, int32_t * subjectRanks, int32_t * addressRanks)
+{
+    int64_t * keys = (int64_t *) malloc(sizeof(* keys) * (mCount > 0 ? mCount : 1));
+    for(unsigned int i = 0 ; i < mCount ; i ++) {
+        switch (kind) {
+            case IMAPSortKindArrival:
+                keys[i] = mReceivedDates[i];
+                break;
+            case IMAPSortKindDate:
+                // RFC 5256: the internal date is used when there's no sent date.
+                keys[i] = (mDates[i] == -1) ? mReceivedDates[i] : mDates[i];
+                break;
+            case IMAPSortKindSize:
+                keys[i] = mSizes[i];
+                break;
+            case IMAPSortKindSubject:
+                keys[i] = (mSubjectIndexes[i] == -1) ? -1 : subjectRanks[mSubjectIndexes[i]];
+                break;
+            case IMAPSortKindFrom:
+                keys[i] = (mFromIndexes[i] == -1) ? -1 : addressRanks[mFromIndexes[i]];
+                break;
+            case IMAPSortKindTo:
+                keys[i] = (mToCounts[i] == 0) ? -1 : addressRanks[mRecipients[mRecipientsStarts[i]]];
+                break;
+            case IMAPSortKindCc:
+                keys[i] = (mCcCounts[i] == 0) ? -1 : addressRanks[mRecipients[mRecipientsStarts[i] + mToCounts[i]]];
+                break;
+        }
+    }
+    return keys;
+}
+
+void IMAPMessageTable::applyPermutation(uint32_t * permutation)
+{
+    permuteColumn(mUids, permutation, mCount);
+    permuteColumn(mNumbers, permutation, mCount);
+    permuteColumn(mFlags, permutation, mCount);
+    permuteColumn(mSizes, permutation, mCount);
+    permuteColumn(mSpam, permutation, mCount);
+    permuteColumn(mDates, permutation, mCount);
+    permuteColumn(mReceivedDates, permutation, mCount);
+    permuteColumn(mModSeqs, permutation, mCount);
+    permuteColumn(mGmailThreadIDs, permutation, mCount);
+    permuteColumn(mGmailMessageIDs, permutation, mCount);
+    permuteColumn(mSubjectIndexes, permutation, mCount);
+    permuteColumn(mFromIndexes, permutation, mCount);
+    permuteColumn(mMessageIDIndexes, permutation, mCount);
+    permuteColumn(mRecipientsStarts, permutation, mCount);
+    permuteColumn(mToCounts, permutation, mCount);
+    permuteColumn(mCcCounts, permutation, mCount);
+    permuteColumn(mBccCounts, permutation, mCount);
+}
+
+void IMAPMessageTable::sortWithCriteria(Array * criteria)
+{
+    if (mCount < 2) {
+        return;
+    }
+    invalidateDays();
+
+    // Strings are compared once per pool entry, rows are then sorted with integers.
+    int32_t * subjectRanks = NULL;
+    int32_t * addressRanks = NULL;
+    unsigned int criteriaCount = criteria->count();
+    int64_t ** keys = (int64_t **) malloc(sizeof(* keys) * (criteriaCount > 0 ? criteriaCount : 1));
+    bool * reversed = (bool *) malloc(sizeof(* reversed) * (criteriaCount > 0 ? criteriaCount : 1));
+    for(unsigned int i = 0 ; i < criteriaCount ; i ++) {
+        IMAPSortCriterion * criterion = (IMAPSortCriterion *) criteria->objectAtIndex(i);
+        IMAPSortKind kind = criterion->kind();
+        if ((kind == IMAPSortKindSubject) && (subjectRanks == NULL)) {
+            subjectRanks = rankedSubjects();
+        }
+        if (((kind == IMAPSortKindFrom) || (kind == IMAPSortKindTo) || (kind == IMAPSortKindCc)) &&
+            (addressRanks == NULL)) {
+            addressRanks = rankedAddresses();
+        }
+        keys[i] = sortKeys(kind, subjectRanks, addressRanks);
+        reversed[i] = criterion->isReversed();
+    }
+
+    uint32_t * permutation = (uint32_t *) malloc(sizeof(* permutation) * mCount);
+    uint32_t * scratch = (uint32_t *) malloc(sizeof(* scratch) * mCount);
+    for(unsigned int i = 0 ; i < mCount ; i ++) {
+        permutation[i] = i;
+    }
+    struct sort_context context;
+    context.criteriaCount = criteriaCount;
+    context.keys = keys;
+    context.reversed = reversed;
+    context.uids = mUids;
+    mergeSortIndexes(permutation, scratch, mCount, compareRows, &context);
+    applyPermutation(permutation);
+
+    mSortedByUID = true;
+    for(unsigned int i = 1 ; i < mCount ; i ++) {
+        if (mUids[i - 1] > mUids[i]) {
+            mSortedByUID = false;
+            break;
+        }
+    }
+
+    free(scratch);
+    free(permutation);
+    for(unsigned int i = 0 ; i < criteriaCount ; i ++) {
+        free(keys[i]);
+    }
+    free(reversed);
+    free(keys);
+    free(addressRanks);
+    free(subjectRanks);
+}
+
+IndexSet * IMAPMessageTable::matchingUIDs(IMAPSearchEvaluator * evaluator)
+{
+    mc_foreacharray(String, header, evaluator->headers()) {
+        if (!header->isEqual(MCSTR("subject")) && !header->isEqual(MCSTR("from")) && !header->isEqual(MCSTR("to")) &&
+            !header->isEqual(MCSTR("cc")) && !header->isEqual(MCSTR("bcc")) && !header->isEqual(MCSTR("message-id"))) {
+            return NULL;
+        }
+    }
+
+    IndexSet * result = IndexSet::indexSet();
+    if (mCount == 0) {
+        return result;
+    }
+    if (mDays == NULL) {
+        mDays = (int32_t *) malloc(sizeof(* mDays) * mCount);
+        mReceivedDays = (int32_t *) malloc(sizeof(* mReceivedDays) * mCount);
+        for(unsigned int i = 0 ; i < mCount ; i ++) {
+            mDays[i] = IMAPSearchEvaluator::dayForDate((time_t) mDates[i]);
+            mReceivedDays[i] = IMAPSearchEvaluator::dayForDate((time_t) mReceivedDates[i]);
+        }
+    }
+
+    IMAPSearchEvaluator::Rows rows;
+    rows.count = mCount;
+    rows.uids = mUids;
+    rows.numbers = mNumbers;
+    rows.flags = mFlags;
+    rows.sizes = mSizes;
+    rows.days = mDays;
+    rows.receivedDays = mReceivedDays;
+    rows.gmailThreadIDs = mGmailThreadIDs;
+    rows.gmailMessageIDs = mGmailMessageIDs;
+    rows.spam = mSpam;
+    rows.text = tableText;
+    rows.textContext = this;
+
+    uint8_t * matches = (uint8_t *) malloc(mCount);
+    evaluator->evaluateRows(&rows, matches);
+    for(unsigned int i = 0 ; i < mCount ; i ++) {
+        if (matches[i]) {
+            result->addIndex(mUids[i]);
+        }
+    }
+    free(matches);
+    return result;
+}
+
+size_t IMAPMessageTable::memoryUsage()
+{
+    size_t rowSize = sizeof(* mUids) + sizeof(* mNumbers) + sizeof(* mFlags) + sizeof(* mSizes) + sizeof(* mSpam) +
+        sizeof(* mDates) + sizeof(* mReceivedDates) + sizeof(* mModSeqs) + sizeof(* mGmailThreadIDs) +
+        sizeof(* mGmailMessageIDs) + sizeof(* mSubjectIndexes) + sizeof(* mFromIndexes) +
+        sizeof(* mMessageIDIndexes) + sizeof(* mRecipientsStarts) + sizeof(* mToCounts) + sizeof(* mCcCounts) +
+        sizeof(* mBccCounts);
+    size_t result = rowSize * mCapacity + sizeof(* mRecipients) * mRecipientsCapacity;
+    if (mDays != NULL) {
+        result += (sizeof(* mDays) + sizeof(* mReceivedDays)) * mCount;
+    }
+    // Approximation of the size of the objects of the pools.
+    const size_t objectSize = 64;
+    mc_foreacharray(String, subject, mSubjects) {
+        result += objectSize * 2 + subject->length() * sizeof(UChar);
+    }
+    mc_foreacharray(Address, address, mAddresses) {
+        result += objectSize * 2;
+        if (address->displayName() != NULL) {
+            result += objectSize + address->displayName()->length() * sizeof(UChar);
+        }
+        if (address->mailbox() != NULL) {
+            result += objectSize + address->mailbox()->length() * sizeof(UChar);
+        }
+    }
+    mc_foreacharray(String, messageID, mMessageIDs) {
+        result += objectSize + messageID->length() * sizeof(UChar);
+    }
+    return result;
+}
+
+String * IMAPMessageTable::description()
+{
+    return String::stringWithUTF8Format("<%s:%p %u messages, %u subjects, %u addresses>", MCUTF8(className()), this,
+                                        mCount, mSubjects->count(), mAddresses->count());
+}
@@ -0,0 +1,137 @@
+//
+//  MCIMAPMessageTable.h
+//  mailcore2
+//
+//  Created by agent on 10/18/26.
+//  Copyright (c) 2026 MailCore. All rights reserved.
+//
+
+#ifndef MAILCORE_MCIMAPMESSAGETABLE_H
+
+#define MAILCORE_MCIMAPMESSAGETABLE_H
+
+#include <MailCore/MCBaseTypes.h>
+#include <MailCore/MCMessageConstants.h>
+#include <MailCore/MCIMAPMessageStreamCallback.h>
+
+#ifdef __cplusplus
+
+namespace mailcore {
+
+    class IMAPMessage;
+    class IMAPSearchEvaluator;
+    class Address;
+
+    // Summary of the messages of a folder stored by column: UIDs, flags, dates and sizes are in arrays,
+    // subjects and addresses are stored once in pools and referenced by index.
+    // It can be filled by IMAPSession::streamMessagesByUID() since it's a stream callback: the
+    // IMAPMessage objects are then released as soon as they've been parsed.
+    // IMAPMessage objects are only created when requested. They only have the values stored in the table:
+    // UID, sequence number, flags, size, mod-sequence, Gmail ids, dates, from, to, cc, bcc, subject and message-id.
+    // Subjects and addresses that are not used anymore are dropped when messages are removed.
+    // It's not thread-safe: it should be used from one thread at a time.
+    class MAILCORE_EXPORT IMAPMessageTable : public Object, public IMAPMessageStreamCallback {
+    public:
+        IMAPMessageTable();
+        virtual ~IMAPMessageTable();
+
+        virtual unsigned int count();
+
+        // If the UID is already in the table, only the flags and the mod-sequence of its row are updated.
+        virtual void addMessage(IMAPMessage * message);
+        virtual void addMessages(Array * /* IMAPMessage */ messages);
+        virtual void removeUIDs(IndexSet * uids);
+        virtual void removeAllMessages();
+        virtual void setFlagsForUID(uint32_t uid, MessageFlag flags);
+
+        // Returns -1 if the UID is not in the table.
+        virtual int indexOfUID(uint32_t uid);
+        virtual IndexSet * uids();
+
+        virtual uint32_t uidAtIndex(unsigned int idx);
+        virtual MessageFlag flagsAtIndex(unsigned int idx);
+        virtual uint32_t sizeAtIndex(unsigned int idx);
+        virtual time_t dateAtIndex(unsigned int idx);
+        virtual time_t receivedDateAtIndex(unsigned int idx);
+        virtual uint64_t gmailThreadIDAtIndex(unsigned int idx);
+        virtual String * subjectAtIndex(unsigned int idx);
+        virtual Address * fromAtIndex(unsigned int idx);
+
+        // Creates the message of the row.
+        virtual IMAPMessage * messageAtIndex(unsigned int idx);
+        virtual Array * /* IMAPMessage */ messagesForUIDs(IndexSet * uids);
+
+        // Reorders the rows using the rules of RFC 5256, like IMAPSortCriterion::sortedMessages().
+        virtual void sortWithCriteria(Array * /* IMAPSortCriterion */ criteria);
+
+        // Returns NULL if the expression of the evaluator uses headers that are not stored in the table.
+        virtual IndexSet * matchingUIDs(IMAPSearchEvaluator * evaluator);
+
+        // Approximate number of bytes used by the table.
+        virtual size_t memoryUsage();
+
+    public: // subclass behavior
+        virtual String * description();
+        virtual void messageFetched(IMAPSession * session, IMAPMessage * message);
+
+    public: // private
+        virtual String * lowercasedTextAtIndex(unsigned int idx, String * header);
+
+    private:
+        unsigned int mCount;
+        unsigned int mCapacity;
+        uint32_t * mUids;
+        uint32_t * mNumbers;
+        uint32_t * mFlags;
+        uint32_t * mSizes;
+        uint8_t * mSpam;
+        int64_t * mDates;
+        int64_t * mReceivedDates;
+        uint64_t * mModSeqs;
+        uint64_t * mGmailThreadIDs;
+        uint64_t * mGmailMessageIDs;
+        // Indexes in mSubjects and mAddresses, -1 when there's no value.
+        int32_t * mSubjectIndexes;
+        int32_t * mFromIndexes;
+        // Indexes in mMessageIDs, -1 when there's no value.
+        int32_t * mMessageIDIndexes;
+        // The to, cc then bcc addresses of a row are in mRecipients from mRecipientsStarts.
+        uint32_t * mRecipientsStarts;
+        uint16_t * mToCounts;
+        uint16_t * mCcCounts;
+        uint16_t * mBccCounts;
+        uint32_t * mRecipients;
+        unsigned int mRecipientsCount;
+        unsigned int mRecipientsCapacity;
+        // Pools.
+        Array * mSubjects;
+        HashMap * mSubjectsIndexes;
+        Array * mAddresses;
+        HashMap * mAddressesIndexes;
+        Array * mMessageIDs;
+        // Days of the dates for IMAPSearchEvaluator, computed when needed.
+        int32_t * mDays;
+        int32_t * mReceivedDays;
+        // UIDs are in increasing order, until the table is sorted.
+        bool mSortedByUID;
+
+        void init();
+        void setCapacity(unsigned int capacity);
+        void invalidateDays();
+        void setRowWithMessage(unsigned int idx, IMAPMessage * message);
+        int32_t internedSubject(String * subject);
+        int32_t internedAddress(Address * address);
+        void appendRecipients(Array * addresses);
+        void compactRecipients();
+        void compactPools();
+        int32_t * rankedSubjects();
+        int32_t * rankedAddresses();
+        int64_t * sortKeys(int kind, int32_t * subjectRanks, int32_t * addressRanks);
+        void applyPermutation(uint32_t * permutation);
+    };
+
+}
+
+#endif
+
+#endif
@@ -0,0 +1,161 @@
+//
+//  MCIMAPNotifyEvent.cpp
+//  mailcore2
+//
+//  Created by agent on 10/18/26.
+//  Copyright (c) 2026 MailCore. All rights reserved.
+//
+
+#include "MCIMAPNotifyEvent.h"
+
+#include "MCIMAPFolderStatus.h"
+
+using namespace mailcore;
+
+void IMAPNotifyEvent::init()
+{
+    mKind = IMAPNotifyEventKindExists;
+    mFolder = NULL;
+    mNumber = 0;
+    mUid = 0;
+    mFlags = MessageFlagNone;
+    mModSequenceValue = 0;
+    mUids = NULL;
+    mStatus = NULL;
+}
+
+IMAPNotifyEvent::IMAPNotifyEvent()
+{
+    init();
+}
+
+IMAPNotifyEvent::IMAPNotifyEvent(IMAPNotifyEvent * other)
+{
+    init();
+    setKind(other->kind());
+    setFolder(other->folder());
+    setNumber(other->number());
+    setUid(other->uid());
+    setFlags(other->flags());
+    setModSequenceValue(other->modSequenceValue());
+    setUids(other->uids());
+    setStatus(other->status());
+}
+
+IMAPNotifyEvent::~IMAPNotifyEvent()
+{
+    MC_SAFE_RELEASE(mFolder);
+    MC_SAFE_RELEASE(mUids);
+    MC_SAFE_RELEASE(mStatus);
+}
+
+Object * IMAPNotifyEvent::copy()
+{
+    return new IMAPNotifyEvent(this);
+}
+
+void IMAPNotifyEvent::setKind(IMAPNotifyEventKind kind)
+{
+    mKind = kind;
+}
+
+IMAPNotifyEventKind IMAPNotifyEvent::kind()
+{
+    return mKind;
+}
+
+void IMAPNotifyEvent::setFolder(String * folder)
+{
+    MC_SAFE_REPLACE_COPY(String, mFolder, folder);
+}
+
+String * IMAPNotifyEvent::folder()
+{
+    return mFolder;
+}
+
+void IMAPNotifyEvent::setNumber(uint32_t number)
+{
+    mNumber = number;
+}
+
+uint32_t IMAPNotifyEvent::number()
+{
+    return mNumber;
+}
+
+void IMAPNotifyEvent::setUid(uint32_t uid)
+{
+    mUid = uid;
+}
+
+uint32_t IMAPNotifyEvent::uid()
+{
+    return mUid;
+}
+
+void IMAPNotifyEvent::setFlags(MessageFlag flags)
+{
+    mFlags = flags;
+}
+
+MessageFlag IMAPNotifyEvent::flags()
+{
+    return mFlags;
+}
+
+void IMAPNotifyEvent::setModSequenceValue(uint64_t modSequenceValue)
+{
+    mModSequenceValue = modSequenceValue;
+}
+
+uint64_t IMAPNotifyEvent::modSequenceValue()
+{
+    return mModSequenceValue;
+}
+
+void IMAPNotifyEvent::setUids(IndexSet * uids)
+{
+    MC_SAFE_REPLACE_COPY(IndexSet, mUids, uids);
+}
+
+IndexSet * IMAPNotifyEvent::uids()
+{
+    return mUids;
+}
+
+void IMAPNotifyEvent::setStatus(IMAPFolderStatus * status)
+{
+    MC_SAFE_REPLACE_RETAIN(IMAPFolderStatus, mStatus, status);
+}
+
+IMAPFolderStatus * IMAPNotifyEvent::status()
+{
+    return mStatus;
+}
+
+String * IMAPNotifyEvent::description()
+{
+    static const char * kindNames[] = { "exists", "expunge", "vanished", "flags", "status" };
+    String * result = String::string();
+    result->appendUTF8Format("<%s:%p %s folder: %s", MCUTF8(className()), this,
+                             kindNames[mKind], MCUTF8(mFolder));
+    switch (mKind) {
+        case IMAPNotifyEventKindExists:
+        case IMAPNotifyEventKindExpunge:
+            result->appendUTF8Format(" number: %u", (unsigned int) mNumber);
+            break;
+        case IMAPNotifyEventKindFlagsChange:
+            result->appendUTF8Format(" number: %u uid: %u flags: %i", (unsigned int) mNumber,
+                                     (unsigned int) mUid, (int) mFlags);
+            break;
+        case IMAPNotifyEventKindVanished:
+            result->appendUTF8Format(" uids: %s", MCUTF8(mUids));
+            break;
+        case IMAPNotifyEventKindStatus:
+            result->appendUTF8Format(" status: %s", MCUTF8(mStatus));
+            break;
+    }
+    result->appendUTF8Characters(">");
+    return result;
+}
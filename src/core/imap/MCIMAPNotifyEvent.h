@@ -0,0 +1,77 @@
+//
+//  MCIMAPNotifyEvent.h
+//  mailcore2
+//
+//  Created by agent on 10/18/26.
+//  Copyright (c) 2026 MailCore. All rights reserved.
+//
+
+#ifndef MAILCORE_MCIMAPNOTIFYEVENT_H
+
+#define MAILCORE_MCIMAPNOTIFYEVENT_H
+
+#include <MailCore/MCBaseTypes.h>
+#include <MailCore/MCMessageConstants.h>
+
+#ifdef __cplusplus
+
+namespace mailcore {
+
+    class IMAPFolderStatus;
+
+    // Change reported by the server while a folder is watched with IDLE or NOTIFY.
+    class MAILCORE_EXPORT IMAPNotifyEvent : public Object {
+    public:
+        IMAPNotifyEvent();
+        virtual ~IMAPNotifyEvent();
+
+        virtual void setKind(IMAPNotifyEventKind kind);
+        virtual IMAPNotifyEventKind kind();
+
+        virtual void setFolder(String * folder);
+        virtual String * folder();
+
+        // Message count for IMAPNotifyEventKindExists, sequence number for IMAPNotifyEventKindExpunge
+        // and IMAPNotifyEventKindFlagsChange.
+        virtual void setNumber(uint32_t number);
+        virtual uint32_t number();
+
+        // Set for IMAPNotifyEventKindFlagsChange when the server sent it.
+        virtual void setUid(uint32_t uid);
+        virtual uint32_t uid();
+
+        virtual void setFlags(MessageFlag flags);
+        virtual MessageFlag flags();
+
+        virtual void setModSequenceValue(uint64_t modSequenceValue);
+        virtual uint64_t modSequenceValue();
+
+        virtual void setUids(IndexSet * uids);
+        virtual IndexSet * uids();
+
+        virtual void setStatus(IMAPFolderStatus * status);
+        virtual IMAPFolderStatus * status();
+
+    public: // subclass behavior
+        IMAPNotifyEvent(IMAPNotifyEvent * other);
+        virtual Object * copy();
+        virtual String * description();
+
+    private:
+        IMAPNotifyEventKind mKind;
+        String * mFolder;
+        uint32_t mNumber;
+        uint32_t mUid;
+        MessageFlag mFlags;
+        uint64_t mModSequenceValue;
+        IndexSet * mUids;
+        IMAPFolderStatus * mStatus;
+
+        void init();
+    };
+
+}
+
+#endif
+
+#endif
@@ -0,0 +1,144 @@
+//
+//  MCIMAPResponseBuffer.cpp
+//  mailcore2
+//
+//  Created by agent on 10/18/26.
+//  Copyright (c) 2026 MailCore. All rights reserved.
+//
+
+#include "MCIMAPResponseBuffer.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+using namespace mailcore;
+
+void IMAPResponseBuffer::init()
+{
+    mBytes = NULL;
+    mLength = 0;
+    mCapacity = 0;
+    mPosition = 0;
+    mResponse = NULL;
+    mLiteralRemaining = 0;
+    mInLiteral = false;
+}
+
+IMAPResponseBuffer::IMAPResponseBuffer()
+{
+    init();
+}
+
+IMAPResponseBuffer::~IMAPResponseBuffer()
+{
+    MC_SAFE_RELEASE(mResponse);
+    free(mBytes);
+}
+
+void IMAPResponseBuffer::appendBytes(const char * bytes, unsigned int length)
+{
+    compact();
+    if (mLength + length > mCapacity) {
+        while (mLength + length > mCapacity) {
+            mCapacity = (mCapacity == 0) ? 4096 : mCapacity * 2;
+        }
+        mBytes = (char *) realloc(mBytes, mCapacity);
+    }
+    memcpy(mBytes + mLength, bytes, length);
+    mLength += length;
+}
+
+// Removes the bytes that have been consumed.
+void IMAPResponseBuffer::compact()
+{
+    if (mPosition == 0) {
+        return;
+    }
+    memmove(mBytes, mBytes + mPosition, mLength - mPosition);
+    mLength -= mPosition;
+    mPosition = 0;
+}
+
+unsigned int IMAPResponseBuffer::pendingLength()
+{
+    unsigned int result = mLength - mPosition;
+    if (mResponse != NULL) {
+        result += mResponse->length();
+    }
+    return result;
+}
+
+void IMAPResponseBuffer::reset()
+{
+    mLength = 0;
+    mPosition = 0;
+    MC_SAFE_RELEASE(mResponse);
+    mLiteralRemaining = 0;
+    mInLiteral = false;
+}
+
+Data * IMAPResponseBuffer::nextResponse()
+{
+    while (1) {
+        if (mInLiteral) {
+            unsigned int available = mLength - mPosition;
+            if (available > mLiteralRemaining) {
+                available = mLiteralRemaining;
+            }
+            for(unsigned int i = 0 ; i < available ; i ++) {
+                char ch = mBytes[mPosition + i];
+                if ((ch == '"') || (ch == '\\')) {
+                    mResponse->appendBytes("\\", 1);
+                }
+                mResponse->appendBytes(&ch, 1);
+            }
+            mPosition += available;
+            mLiteralRemaining -= available;
+            if (mLiteralRemaining > 0) {
+                return NULL;
+            }
+            mResponse->appendBytes("\"", 1);
+            mInLiteral = false;
+        }
+
+        if (mPosition == mLength) {
+            return NULL;
+        }
+        const char * line = mBytes + mPosition;
+        const char * end = (const char *) memchr(line, '\n', mLength - mPosition);
+        if (end == NULL) {
+            return NULL;
+        }
+        mPosition += (unsigned int) (end - line) + 1;
+        unsigned int length = (unsigned int) (end - line);
+        if ((length > 0) && (line[length - 1] == '\r')) {
+            length --;
+        }
+
+        if (mResponse == NULL) {
+            mResponse = new Data();
+        }
+        const char * literal = NULL;
+        if ((length > 0) && (line[length - 1] == '}')) {
+            literal = line + length - 1;
+            while ((literal > line) && (* literal != '{')) {
+                literal --;
+            }
+            if (* literal != '{') {
+                literal = NULL;
+            }
+        }
+        if (literal == NULL) {
+            mResponse->appendBytes(line, length);
+            mResponse->appendBytes("", 1);
+            Data * result = mResponse;
+            mResponse = NULL;
+            return (Data *) result->autorelease();
+        }
+
+        mResponse->appendBytes(line, (unsigned int) (literal - line));
+        mResponse->appendBytes("\"", 1);
+        mLiteralRemaining = (unsigned int) strtoul(literal + 1, NULL, 10);
+        mInLiteral = true;
+    }
+}
@@ -0,0 +1,55 @@
+//
+//  MCIMAPResponseBuffer.h
+//  mailcore2
+//
+//  Created by agent on 10/18/26.
+//  Copyright (c) 2026 MailCore. All rights reserved.
+//
+
+#ifndef MAILCORE_MCIMAPRESPONSEBUFFER_H
+
+#define MAILCORE_MCIMAPRESPONSEBUFFER_H
+
+#include <MailCore/MCBaseTypes.h>
+
+#ifdef __cplusplus
+
+namespace mailcore {
+
+    // Splits the data received from an IMAP server into responses as it arrives, so that a partial
+    // response never blocks the reader.
+    class MAILCORE_EXPORT IMAPResponseBuffer : public Object {
+    public:
+        IMAPResponseBuffer();
+        virtual ~IMAPResponseBuffer();
+
+        virtual void appendBytes(const char * bytes, unsigned int length);
+
+        // Returns the next complete response, or NULL if more data is needed.
+        // Literals are replaced by quoted strings so that the response can be parsed as a single line.
+        // The result is NUL-terminated and doesn't include the end of line.
+        virtual Data * nextResponse();
+
+        // Number of bytes received that are not part of a returned response.
+        virtual unsigned int pendingLength();
+        virtual void reset();
+
+    private:
+        char * mBytes;
+        unsigned int mLength;
+        unsigned int mCapacity;
+        unsigned int mPosition;
+        // Response being read when it contains literals.
+        Data * mResponse;
+        unsigned int mLiteralRemaining;
+        bool mInLiteral;
+
+        void init();
+        void compact();
+    };
+
+}
+
+#endif
+
+#endif
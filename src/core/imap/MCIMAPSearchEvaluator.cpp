@@ -0,0 +1,576 @@
+//
+//  MCIMAPSearchEvaluator.cpp
+//  mailcore2
+//
+//  Created by agent on 10/18/26.
+//  Copyright (c) 2026 MailCore. All rights reserved.
+//
+
+#include "MCWin32.h" // should be included first.
+
+#include "MCIMAPSearchEvaluator.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "MCDefines.h"
+#include "MCIMAPMessage.h"
+#include "MCIMAPFolderMirror.h"
+#include "MCIMAPSearchExpression.h"
+#include "MCMessageHeader.h"
+#include "MCAddress.h"
+
+using namespace mailcore;
+
+enum {
+    OPCODE_ALL,
+    OPCODE_NONE,
+    OPCODE_TEXT,
+    OPCODE_UIDS,
+    OPCODE_NUMBERS,
+    OPCODE_FLAG_SET,
+    OPCODE_FLAG_UNSET,
+    OPCODE_SPAM,
+    OPCODE_BEFORE_DAY,
+    OPCODE_ON_DAY,
+    OPCODE_SINCE_DAY,
+    OPCODE_BEFORE_RECEIVED_DAY,
+    OPCODE_ON_RECEIVED_DAY,
+    OPCODE_SINCE_RECEIVED_DAY,
+    OPCODE_SIZE_LARGER,
+    OPCODE_SIZE_SMALLER,
+    OPCODE_GMAIL_THREAD_ID,
+    OPCODE_GMAIL_MESSAGE_ID,
+    OPCODE_AND,
+    OPCODE_OR,
+    OPCODE_NOT,
+};
+
+static String * addressText(Address * address)
+{
+    if (address == NULL) {
+        return NULL;
+    }
+    String * result = String::string();
+    if (address->displayName() != NULL) {
+        result->appendString(address->displayName());
+        result->appendUTF8Characters(" ");
+    }
+    if (address->mailbox() != NULL) {
+        result->appendUTF8Characters("<");
+        result->appendString(address->mailbox());
+        result->appendUTF8Characters(">");
+    }
+    return result;
+}
+
+static String * addressesText(Array * addresses)
+{
+    if (addresses == NULL) {
+        return NULL;
+    }
+    String * result = String::string();
+    mc_foreacharray(Address, address, addresses) {
+        if (result->length() > 0) {
+            result->appendUTF8Characters(", ");
+        }
+        result->appendString(addressText(address));
+    }
+    return result;
+}
+
+static String * messageText(void * context, unsigned int row, String * header)
+{
+    IMAPMessage * message = (IMAPMessage *) ((Array *) context)->objectAtIndex(row);
+    MessageHeader * messageHeader = message->header();
+    String * text;
+    if (header->isEqual(MCSTR("from"))) {
+        text = addressText(messageHeader->from());
+    }
+    else if (header->isEqual(MCSTR("to"))) {
+        text = addressesText(messageHeader->to());
+    }
+    else if (header->isEqual(MCSTR("cc"))) {
+        text = addressesText(messageHeader->cc());
+    }
+    else if (header->isEqual(MCSTR("bcc"))) {
+        text = addressesText(messageHeader->bcc());
+    }
+    else if (header->isEqual(MCSTR("subject"))) {
+        text = messageHeader->subject();
+    }
+    else if (header->isEqual(MCSTR("message-id"))) {
+        text = messageHeader->messageID();
+    }
+    else {
+        text = messageHeader->extraHeaderValueForName(header);
+    }
+    if (text == NULL) {
+        return NULL;
+    }
+    return text->lowercaseString();
+}
+
+static bool hasSpamFlag(IMAPMessage * message)
+{
+    Array * customFlags = message->customFlags();
+    if (customFlags == NULL) {
+        return false;
+    }
+    mc_foreacharray(String, flag, customFlags) {
+        if (flag->isEqualCaseInsensitive(MCSTR("Junk"))) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void IMAPSearchEvaluator::init()
+{
+    mExpression = NULL;
+    mInstructions = NULL;
+    mInstructionsCount = 0;
+    mInstructionsCapacity = 0;
+    mStackDepth = 0;
+    mObjects = new Array();
+}
+
+IMAPSearchEvaluator::IMAPSearchEvaluator()
+{
+    init();
+}
+
+IMAPSearchEvaluator::~IMAPSearchEvaluator()
+{
+    free(mInstructions);
+    MC_SAFE_RELEASE(mObjects);
+    MC_SAFE_RELEASE(mExpression);
+}
+
+bool IMAPSearchEvaluator::canEvaluate(IMAPSearchExpression * expression)
+{
+    switch (expression->kind()) {
+        case IMAPSearchKindContent:
+        case IMAPSearchKindBody:
+        case IMAPSearchKindGmailRaw:
+            return false;
+        case IMAPSearchKindOr:
+        case IMAPSearchKindAnd:
+            return canEvaluate(expression->leftExpression()) && canEvaluate(expression->rightExpression());
+        case IMAPSearchKindNot:
+            return canEvaluate(expression->leftExpression());
+        default:
+            return true;
+    }
+}
+
+int32_t IMAPSearchEvaluator::dayForDate(time_t date)
+{
+    struct tm timeinfo;
+    localtime_r(&date, &timeinfo);
+    return (timeinfo.tm_year + 1900) * 10000 + (timeinfo.tm_mon + 1) * 100 + timeinfo.tm_mday;
+}
+
+void IMAPSearchEvaluator::setExpression(IMAPSearchExpression * expression)
+{
+    MCAssert((expression == NULL) || canEvaluate(expression));
+    MC_SAFE_REPLACE_COPY(IMAPSearchExpression, mExpression, expression);
+    clearInstructions();
+    if (mExpression != NULL) {
+        mStackDepth = compile(mExpression);
+    }
+}
+
+IMAPSearchExpression * IMAPSearchEvaluator::expression()
+{
+    return mExpression;
+}
+
+void IMAPSearchEvaluator::clearInstructions()
+{
+    mInstructionsCount = 0;
+    mStackDepth = 0;
+    mObjects->removeAllObjects();
+}
+
+void IMAPSearchEvaluator::addInstruction(int opcode, uint64_t number, String * value, String * header, IndexSet * indexSet)
+{
+    if (mInstructionsCount >= mInstructionsCapacity) {
+        mInstructionsCapacity = (mInstructionsCapacity == 0) ? 16 : mInstructionsCapacity * 2;
+        mInstructions = (Instruction *) realloc(mInstructions, sizeof(* mInstructions) * mInstructionsCapacity);
+    }
+    if (value != NULL) {
+        value = value->lowercaseString();
+        mObjects->addObject(value);
+    }
+    if (header != NULL) {
+        header = header->lowercaseString();
+        mObjects->addObject(header);
+    }
+    if (indexSet != NULL) {
+        mObjects->addObject(indexSet);
+    }
+    Instruction * instruction = &mInstructions[mInstructionsCount];
+    instruction->opcode = opcode;
+    instruction->number = number;
+    instruction->value = value;
+    instruction->header = header;
+    instruction->indexSet = indexSet;
+    mInstructionsCount ++;
+}
+
+// Instructions are in postfix order. Returns the number of intermediate results needed to evaluate
+// the expression.
+unsigned int IMAPSearchEvaluator::compile(IMAPSearchExpression * expression)
+{
+    switch (expression->kind()) {
+        case IMAPSearchKindAll:
+            addInstruction(OPCODE_ALL, 0, NULL, NULL, NULL);
+            return 1;
+        case IMAPSearchKindNone:
+            addInstruction(OPCODE_NONE, 0, NULL, NULL, NULL);
+            return 1;
+        case IMAPSearchKindFrom:
+            addInstruction(OPCODE_TEXT, 0, expression->value(), MCSTR("from"), NULL);
+            return 1;
+        case IMAPSearchKindTo:
+            addInstruction(OPCODE_TEXT, 0, expression->value(), MCSTR("to"), NULL);
+            return 1;
+        case IMAPSearchKindCc:
+            addInstruction(OPCODE_TEXT, 0, expression->value(), MCSTR("cc"), NULL);
+            return 1;
+        case IMAPSearchKindBcc:
+            addInstruction(OPCODE_TEXT, 0, expression->value(), MCSTR("bcc"), NULL);
+            return 1;
+        case IMAPSearchKindRecipient:
+            addInstruction(OPCODE_TEXT, 0, expression->value(), MCSTR("to"), NULL);
+            addInstruction(OPCODE_TEXT, 0, expression->value(), MCSTR("cc"), NULL);
+            addInstruction(OPCODE_OR, 0, NULL, NULL, NULL);
+            addInstruction(OPCODE_TEXT, 0, expression->value(), MCSTR("bcc"), NULL);
+            addInstruction(OPCODE_OR, 0, NULL, NULL, NULL);
+            return 2;
+        case IMAPSearchKindSubject:
+            addInstruction(OPCODE_TEXT, 0, expression->value(), MCSTR("subject"), NULL);
+            return 1;
+        case IMAPSearchKindHeader:
+            addInstruction(OPCODE_TEXT, 0, expression->value(), expression->header(), NULL);
+            return 1;
+        case IMAPSearchKindUIDs:
+            addInstruction(OPCODE_UIDS, 0, NULL, NULL, expression->uids());
+            return 1;
+        case IMAPSearchKindNumbers:
+            addInstruction(OPCODE_NUMBERS, 0, NULL, NULL, expression->numbers());
+            return 1;
+        case IMAPSearchKindRead:
+            addInstruction(OPCODE_FLAG_SET, MessageFlagSeen, NULL, NULL, NULL);
+            return 1;
+        case IMAPSearchKindUnread:
+            addInstruction(OPCODE_FLAG_UNSET, MessageFlagSeen, NULL, NULL, NULL);
+            return 1;
+        case IMAPSearchKindFlagged:
+            addInstruction(OPCODE_FLAG_SET, MessageFlagFlagged, NULL, NULL, NULL);
+            return 1;
+        case IMAPSearchKindUnflagged:
+            addInstruction(OPCODE_FLAG_UNSET, MessageFlagFlagged, NULL, NULL, NULL);
+            return 1;
+        case IMAPSearchKindAnswered:
+            addInstruction(OPCODE_FLAG_SET, MessageFlagAnswered, NULL, NULL, NULL);
+            return 1;
+        case IMAPSearchKindUnanswered:
+            addInstruction(OPCODE_FLAG_UNSET, MessageFlagAnswered, NULL, NULL, NULL);
+            return 1;
+        case IMAPSearchKindDraft:
+            addInstruction(OPCODE_FLAG_SET, MessageFlagDraft, NULL, NULL, NULL);
+            return 1;
+        case IMAPSearchKindUndraft:
+            addInstruction(OPCODE_FLAG_UNSET, MessageFlagDraft, NULL, NULL, NULL);
+            return 1;
+        case IMAPSearchKindDeleted:
+            addInstruction(OPCODE_FLAG_SET, MessageFlagDeleted, NULL, NULL, NULL);
+            return 1;
+        case IMAPSearchKindSpam:
+            addInstruction(OPCODE_SPAM, 0, NULL, NULL, NULL);
+            return 1;
+        case IMAPSearchKindBeforeDate:
+            addInstruction(OPCODE_BEFORE_DAY, dayForDate(expression->date()), NULL, NULL, NULL);
+            return 1;
+        case IMAPSearchKindOnDate:
+            addInstruction(OPCODE_ON_DAY, dayForDate(expression->date()), NULL, NULL, NULL);
+            return 1;
+        case IMAPSearchKindSinceDate:
+            addInstruction(OPCODE_SINCE_DAY, dayForDate(expression->date()), NULL, NULL, NULL);
+            return 1;
+        case IMAPSearchKindBeforeReceivedDate:
+            addInstruction(OPCODE_BEFORE_RECEIVED_DAY, dayForDate(expression->date()), NULL, NULL, NULL);
+            return 1;
+        case IMAPSearchKindOnReceivedDate:
+            addInstruction(OPCODE_ON_RECEIVED_DAY, dayForDate(expression->date()), NULL, NULL, NULL);
+            return 1;
+        case IMAPSearchKindSinceReceivedDate:
+            addInstruction(OPCODE_SINCE_RECEIVED_DAY, dayForDate(expression->date()), NULL, NULL, NULL);
+            return 1;
+        case IMAPSearchKindSizeLarger:
+            addInstruction(OPCODE_SIZE_LARGER, expression->longNumber(), NULL, NULL, NULL);
+            return 1;
+        case IMAPSearchKindSizeSmaller:
+            addInstruction(OPCODE_SIZE_SMALLER, expression->longNumber(), NULL, NULL, NULL);
+            return 1;
+        case IMAPSearchKindGmailThreadID:
+            addInstruction(OPCODE_GMAIL_THREAD_ID, expression->longNumber(), NULL, NULL, NULL);
+            return 1;
+        case IMAPSearchKindGmailMessageID:
+            addInstruction(OPCODE_GMAIL_MESSAGE_ID, expression->longNumber(), NULL, NULL, NULL);
+            return 1;
+        case IMAPSearchKindOr:
+        case IMAPSearchKindAnd:
+        {
+            unsigned int leftDepth = compile(expression->leftExpression());
+            unsigned int rightDepth = compile(expression->rightExpression());
+            addInstruction(expression->kind() == IMAPSearchKindOr ? OPCODE_OR : OPCODE_AND, 0, NULL, NULL, NULL);
+            return (leftDepth > rightDepth + 1) ? leftDepth : rightDepth + 1;
+        }
+        case IMAPSearchKindNot:
+        {
+            unsigned int depth = compile(expression->leftExpression());
+            addInstruction(OPCODE_NOT, 0, NULL, NULL, NULL);
+            return depth;
+        }
+        default:
+            MCAssert(0);
+            return 0;
+    }
+}
+
+void IMAPSearchEvaluator::evaluateRows(Rows * rows, uint8_t * result)
+{
+    unsigned int count = rows->count;
+    if ((count == 0) || (mInstructionsCount == 0)) {
+        return;
+    }
+
+    // Stack of intermediate results, one byte per row.
+    uint8_t * stack = (uint8_t *) malloc(mStackDepth * count);
+    unsigned int stackCount = 0;
+    for(unsigned int k = 0 ; k < mInstructionsCount ; k ++) {
+        Instruction * instruction = &mInstructions[k];
+        uint8_t * top = (stackCount > 0) ? stack + (stackCount - 1) * count : NULL;
+        uint8_t * next = stack + stackCount * count;
+        uint32_t number32 = (uint32_t) instruction->number;
+        int32_t day = (int32_t) instruction->number;
+        switch (instruction->opcode) {
+            case OPCODE_AND:
+            {
+                uint8_t * left = stack + (stackCount - 2) * count;
+                for(unsigned int i = 0 ; i < count ; i ++) {
+                    left[i] &= top[i];
+                }
+                stackCount --;
+                continue;
+            }
+            case OPCODE_OR:
+            {
+                uint8_t * left = stack + (stackCount - 2) * count;
+                for(unsigned int i = 0 ; i < count ; i ++) {
+                    left[i] |= top[i];
+                }
+                stackCount --;
+                continue;
+            }
+            case OPCODE_NOT:
+                for(unsigned int i = 0 ; i < count ; i ++) {
+                    top[i] ^= 1;
+                }
+                continue;
+            case OPCODE_ALL:
+                memset(next, 1, count);
+                break;
+            case OPCODE_NONE:
+                memset(next, 0, count);
+                break;
+            case OPCODE_TEXT:
+                for(unsigned int i = 0 ; i < count ; i ++) {
+                    String * text = rows->text(rows->textContext, i, instruction->header);
+                    next[i] = (text != NULL) && (text->locationOfString(instruction->value) != -1);
+                }
+                break;
+            case OPCODE_UIDS:
+                for(unsigned int i = 0 ; i < count ; i ++) {
+                    next[i] = instruction->indexSet->containsIndex(rows->uids[i]);
+                }
+                break;
+            case OPCODE_NUMBERS:
+                for(unsigned int i = 0 ; i < count ; i ++) {
+                    next[i] = instruction->indexSet->containsIndex(rows->numbers[i]);
+                }
+                break;
+            case OPCODE_FLAG_SET:
+                for(unsigned int i = 0 ; i < count ; i ++) {
+                    next[i] = (rows->flags[i] & number32) != 0;
+                }
+                break;
+            case OPCODE_FLAG_UNSET:
+                for(unsigned int i = 0 ; i < count ; i ++) {
+                    next[i] = (rows->flags[i] & number32) == 0;
+                }
+                break;
+            case OPCODE_SPAM:
+                memcpy(next, rows->spam, count);
+                break;
+            case OPCODE_BEFORE_DAY:
+                for(unsigned int i = 0 ; i < count ; i ++) {
+                    next[i] = rows->days[i] < day;
+                }
+                break;
+            case OPCODE_ON_DAY:
+                for(unsigned int i = 0 ; i < count ; i ++) {
+                    next[i] = rows->days[i] == day;
+                }
+                break;
+            case OPCODE_SINCE_DAY:
+                for(unsigned int i = 0 ; i < count ; i ++) {
+                    next[i] = rows->days[i] >= day;
+                }
+                break;
+            case OPCODE_BEFORE_RECEIVED_DAY:
+                for(unsigned int i = 0 ; i < count ; i ++) {
+                    next[i] = rows->receivedDays[i] < day;
+                }
+                break;
+            case OPCODE_ON_RECEIVED_DAY:
+                for(unsigned int i = 0 ; i < count ; i ++) {
+                    next[i] = rows->receivedDays[i] == day;
+                }
+                break;
+            case OPCODE_SINCE_RECEIVED_DAY:
+                for(unsigned int i = 0 ; i < count ; i ++) {
+                    next[i] = rows->receivedDays[i] >= day;
+                }
+                break;
+            case OPCODE_SIZE_LARGER:
+                for(unsigned int i = 0 ; i < count ; i ++) {
+                    next[i] = rows->sizes[i] > number32;
+                }
+                break;
+            case OPCODE_SIZE_SMALLER:
+                for(unsigned int i = 0 ; i < count ; i ++) {
+                    next[i] = rows->sizes[i] < number32;
+                }
+                break;
+            case OPCODE_GMAIL_THREAD_ID:
+                for(unsigned int i = 0 ; i < count ; i ++) {
+                    next[i] = rows->gmailThreadIDs[i] == instruction->number;
+                }
+                break;
+            case OPCODE_GMAIL_MESSAGE_ID:
+                for(unsigned int i = 0 ; i < count ; i ++) {
+                    next[i] = rows->gmailMessageIDs[i] == instruction->number;
+                }
+                break;
+        }
+        stackCount ++;
+    }
+    memcpy(result, stack, count);
+    free(stack);
+}
+
+IndexSet * IMAPSearchEvaluator::matchingUIDs(Array * messages)
+{
+    IndexSet * result = IndexSet::indexSet();
+    Array * matchingMessages = filteredMessages(messages);
+    mc_foreacharray(IMAPMessage, message, matchingMessages) {
+        result->addIndex(message->uid());
+    }
+    return result;
+}
+
+Array * IMAPSearchEvaluator::filteredMessages(Array * messages)
+{
+    MCAssert(mExpression != NULL);
+
+    unsigned int count = messages->count();
+    Array * result = Array::array();
+    if (count == 0) {
+        return result;
+    }
+
+    uint32_t * uids = (uint32_t *) malloc(sizeof(* uids) * count);
+    uint32_t * numbers = (uint32_t *) malloc(sizeof(* numbers) * count);
+    uint32_t * flags = (uint32_t *) malloc(sizeof(* flags) * count);
+    uint32_t * sizes = (uint32_t *) malloc(sizeof(* sizes) * count);
+    int32_t * days = (int32_t *) malloc(sizeof(* days) * count);
+    int32_t * receivedDays = (int32_t *) malloc(sizeof(* receivedDays) * count);
+    uint64_t * gmailThreadIDs = (uint64_t *) malloc(sizeof(* gmailThreadIDs) * count);
+    uint64_t * gmailMessageIDs = (uint64_t *) malloc(sizeof(* gmailMessageIDs) * count);
+    uint8_t * spam = (uint8_t *) malloc(count);
+    uint8_t * matches = (uint8_t *) malloc(count);
+    for(unsigned int i = 0 ; i < count ; i ++) {
+        IMAPMessage * message = (IMAPMessage *) messages->objectAtIndex(i);
+        uids[i] = message->uid();
+        numbers[i] = message->sequenceNumber();
+        flags[i] = (uint32_t) message->flags();
+        sizes[i] = message->size();
+        days[i] = dayForDate(message->header()->date());
+        receivedDays[i] = dayForDate(message->header()->receivedDate());
+        gmailThreadIDs[i] = message->gmailThreadID();
+        gmailMessageIDs[i] = message->gmailMessageID();
+        spam[i] = hasSpamFlag(message);
+    }
+
+    Rows rows;
+    rows.count = count;
+    rows.uids = uids;
+    rows.numbers = numbers;
+    rows.flags = flags;
+    rows.sizes = sizes;
+    rows.days = days;
+    rows.receivedDays = receivedDays;
+    rows.gmailThreadIDs = gmailThreadIDs;
+    rows.gmailMessageIDs = gmailMessageIDs;
+    rows.spam = spam;
+    rows.text = messageText;
+    rows.textContext = messages;
+    evaluateRows(&rows, matches);
+
+    for(unsigned int i = 0 ; i < count ; i ++) {
+        if (matches[i]) {
+            result->addObject(messages->objectAtIndex(i));
+        }
+    }
+
+    free(matches);
+    free(spam);
+    free(gmailMessageIDs);
+    free(gmailThreadIDs);
+    free(receivedDays);
+    free(days);
+    free(sizes);
+    free(flags);
+    free(numbers);
+    free(uids);
+
+    return result;
+}
+
+IndexSet * IMAPSearchEvaluator::matchingUIDsInFolderMirror(IMAPFolderMirror * mirror)
+{
+    return matchingUIDs(mirror->messagesForUIDs(mirror->uids()));
+}
+
+Array * IMAPSearchEvaluator::headers()
+{
+    Array * result = Array::array();
+    for(unsigned int i = 0 ; i < mInstructionsCount ; i ++) {
+        String * header = mInstructions[i].header;
+        if ((header != NULL) && !result->containsObject(header)) {
+            result->addObject(header);
+        }
+    }
+    return result;
+}
+
+String * IMAPSearchEvaluator::description()
+{
+    return String::stringWithUTF8Format("<%s:%p %s %u instructions>", MCUTF8(className()), this,
+                                        MCUTF8(mExpression), mInstructionsCount);
+}
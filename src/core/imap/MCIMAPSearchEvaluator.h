@@ -0,0 +1,102 @@
+//
+//  MCIMAPSearchEvaluator.h
+//  mailcore2
+//
+//  Created by agent on 10/18/26.
+//  Copyright (c) 2026 MailCore. All rights reserved.
+//
+
+#ifndef MAILCORE_MCIMAPSEARCHEVALUATOR_H
+
+#define MAILCORE_MCIMAPSEARCHEVALUATOR_H
+
+#include <MailCore/MCBaseTypes.h>
+#include <MailCore/MCMessageConstants.h>
+
+#ifdef __cplusplus
+
+namespace mailcore {
+
+    class IMAPMessage;
+    class IMAPFolderMirror;
+    class IMAPSearchExpression;
+
+    // Evaluates an IMAPSearchExpression on messages that are available locally, without the server.
+    // The expression is compiled into a list of instructions. Each instruction is applied to all the messages
+    // at once, using arrays of UIDs, flags, dates and sizes.
+    // Text criteria are case-insensitive substring matches, as on the server. Dates are compared
+    // by day in the local time zone.
+    class MAILCORE_EXPORT IMAPSearchEvaluator : public Object {
+    public:
+        IMAPSearchEvaluator();
+        virtual ~IMAPSearchEvaluator();
+
+        // Returns false if the expression has criteria that need the server: content, body, gmail raw search.
+        static bool canEvaluate(IMAPSearchExpression * expression);
+
+        // canEvaluate() needs to return true for the expression.
+        virtual void setExpression(IMAPSearchExpression * expression);
+        virtual IMAPSearchExpression * expression();
+
+        virtual IndexSet * matchingUIDs(Array * /* IMAPMessage */ messages);
+        virtual Array * /* IMAPMessage */ filteredMessages(Array * /* IMAPMessage */ messages);
+        virtual IndexSet * matchingUIDsInFolderMirror(IMAPFolderMirror * mirror);
+
+        // Lowercased names of the headers used by the text criteria of the expression.
+        virtual Array * /* String */ headers();
+
+    public: // subclass behavior
+        virtual String * description();
+
+    public: // private
+        // Values of the messages used by the instructions, one entry per message.
+        struct Rows {
+            unsigned int count;
+            const uint32_t * uids;
+            const uint32_t * numbers;
+            const uint32_t * flags;
+            const uint32_t * sizes;
+            const int32_t * days;
+            const int32_t * receivedDays;
+            const uint64_t * gmailThreadIDs;
+            const uint64_t * gmailMessageIDs;
+            const uint8_t * spam;
+            // Returns the lowercased text of the given header for the row.
+            String * (* text)(void * context, unsigned int row, String * header);
+            void * textContext;
+        };
+
+        // Sets result[i] to 1 for the rows that match.
+        virtual void evaluateRows(Rows * rows, uint8_t * result);
+        static int32_t dayForDate(time_t date);
+
+    private:
+        struct Instruction {
+            int opcode;
+            uint64_t number;
+            // Lowercased.
+            String * value;
+            // Lowercased.
+            String * header;
+            IndexSet * indexSet;
+        };
+
+        IMAPSearchExpression * mExpression;
+        Instruction * mInstructions;
+        unsigned int mInstructionsCount;
+        unsigned int mInstructionsCapacity;
+        unsigned int mStackDepth;
+        // Keeps the values of the instructions.
+        Array * mObjects;
+
+        void init();
+        void clearInstructions();
+        unsigned int compile(IMAPSearchExpression * expression);
+        void addInstruction(int opcode, uint64_t number, String * value, String * header, IndexSet * indexSet);
+    };
+
+}
+
+#endif
+
+#endif
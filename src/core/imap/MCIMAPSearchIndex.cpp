@@ -0,0 +1,919 @@
+//
+//  MCIMAPSearchIndex.cpp
+//  mailcore2
+//
+//  Created by agent on 10/18/26.
+//  Copyright (c) 2026 MailCore. All rights reserved.
+//
+
+#include "MCWin32.h" // should be included first.
+
+#include "MCIMAPSearchIndex.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifndef _MSC_VER
+#include <unistd.h>
+#endif
+
+#include "MCDefines.h"
+#include "MCIMAPSession.h"
+#include "MCIMAPMessage.h"
+#include "MCIMAPSyncResult.h"
+#include "MCIMAPSearchExpression.h"
+#include "MCMessageHeader.h"
+#include "MCAddress.h"
+
+using namespace mailcore;
+
+// File format, fixed size integers are big endian, varints use 7 bits per byte, least significant first:
+// "MCSI" version:32 uidValidity:32 uids bodyUids termsCount:varint
+// followed by termsCount terms:
+// length:varint UTF-16 characters (length * 16 bits) uids
+// A set of UIDs is stored as rangesCount:varint followed by, for each range,
+// the distance to the end of the previous range:varint and the length of the range:varint.
+//
+// Journal: "MCSJ" version:32 uidValidity:32 followed by records, each one prefixed with its size:varint.
+// A record is either
+// 'a' uid:varint indexed:8 termsCount:varint terms, when a message is indexed. indexed is a combination
+// of JOURNAL_INDEXED_HEADERS and JOURNAL_INDEXED_BODY.
+// 'r' uids, when messages are removed.
+// Records only add or remove UIDs: applying the journal again to an index that has it already gives
+// the same index, in case the file has been written but the journal could not be removed.
+
+#define INDEX_MAGIC "MCSI"
+#define JOURNAL_MAGIC "MCSJ"
+
+#define JOURNAL_RECORD_ADD 'a'
+#define JOURNAL_RECORD_REMOVE 'r'
+
+enum {
+    JOURNAL_INDEXED_HEADERS = 1 << 0,
+    JOURNAL_INDEXED_BODY = 1 << 1,
+};
+
+enum {
+    INDEX_VERSION = 1,
+    INDEX_HEADER_SIZE = 12,
+    JOURNAL_VERSION = 1,
+    MIN_WORD_LENGTH = 2,
+    MAX_WORD_LENGTH = 32,
+};
+
+// Terms are prefixed with the code of the field they come from followed by ':'.
+#define FIELD_FROM 'f'
+#define FIELD_TO 't'
+#define FIELD_CC 'c'
+#define FIELD_BCC 'b'
+#define FIELD_SUBJECT 's'
+#define FIELD_BODY 'x'
+
+static void appendUInt32(Data * data, uint32_t value)
+{
+    char bytes[4];
+    bytes[0] = (char) ((value >> 24) & 0xff);
+    bytes[1] = (char) ((value >> 16) & 0xff);
+    bytes[2] = (char) ((value >> 8) & 0xff);
+    bytes[3] = (char) (value & 0xff);
+    data->appendBytes(bytes, 4);
+}
+
+static uint32_t readUInt32(const char * bytes)
+{
+    const unsigned char * p = (const unsigned char *) bytes;
+    return ((uint32_t) p[0] << 24) | ((uint32_t) p[1] << 16) | ((uint32_t) p[2] << 8) | (uint32_t) p[3];
+}
+
+static void appendVarint(Data * data, uint64_t value)
+{
+    char bytes[10];
+    unsigned int length = 0;
+    while (value >= 0x80) {
+        bytes[length] = (char) ((value & 0x7f) | 0x80);
+        value >>= 7;
+        length ++;
+    }
+    bytes[length] = (char) value;
+    length ++;
+    data->appendBytes(bytes, length);
+}
+
+static void appendIndexSet(Data * data, IndexSet * indexSet)
+{
+    Range * ranges = indexSet->allRanges();
+    appendVarint(data, indexSet->rangesCount());
+    uint64_t previousEnd = 0;
+    for(unsigned int i = 0 ; i < indexSet->rangesCount() ; i ++) {
+        appendVarint(data, ranges[i].location - previousEnd);
+        appendVarint(data, ranges[i].length);
+        previousEnd = ranges[i].location + ranges[i].length + 1;
+    }
+}
+
+struct IndexReader {
+    const char * bytes;
+    unsigned int length;
+    unsigned int position;
+    bool failed;
+};
+
+static uint64_t readVarint(IndexReader * reader)
+{
+    uint64_t value = 0;
+    unsigned int shift = 0;
+    while (1) {
+        if ((reader->position >= reader->length) || (shift > 63)) {
+            reader->failed = true;
+            return 0;
+        }
+        unsigned char byte = (unsigned char) reader->bytes[reader->position];
+        reader->position ++;
+        value |= (uint64_t) (byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0) {
+            break;
+        }
+        shift += 7;
+    }
+    return value;
+}
+
+static void appendTerm(Data * data, String * term)
+{
+    const UChar * characters = term->unicodeCharacters();
+    appendVarint(data, term->length());
+    for(unsigned int i = 0 ; i < term->length() ; i ++) {
+        char bytes[2];
+        bytes[0] = (char) ((characters[i] >> 8) & 0xff);
+        bytes[1] = (char) (characters[i] & 0xff);
+        data->appendBytes(bytes, 2);
+    }
+}
+
+static String * readTerm(IndexReader * reader)
+{
+    uint64_t termLength = readVarint(reader);
+    if (reader->failed || (termLength > MAX_WORD_LENGTH + 2) || (termLength * 2 > reader->length - reader->position)) {
+        reader->failed = true;
+        return NULL;
+    }
+    UChar term[MAX_WORD_LENGTH + 2];
+    const unsigned char * p = (const unsigned char *) (reader->bytes + reader->position);
+    for(unsigned int k = 0 ; k < termLength ; k ++) {
+        term[k] = (UChar) ((p[k * 2] << 8) | p[k * 2 + 1]);
+    }
+    reader->position += (unsigned int) termLength * 2;
+    return String::stringWithCharacters(term, (unsigned int) termLength);
+}
+
+static IndexSet * readIndexSet(IndexReader * reader)
+{
+    IndexSet * result = IndexSet::indexSet();
+    uint64_t rangesCount = readVarint(reader);
+    uint64_t previousEnd = 0;
+    for(uint64_t i = 0 ; (i < rangesCount) && !reader->failed ; i ++) {
+        Range range;
+        range.location = previousEnd + readVarint(reader);
+        range.length = readVarint(reader);
+        result->addRange(range);
+        previousEnd = range.location + range.length + 1;
+    }
+    return result;
+}
+
+// Punctuation and symbols separate the words. Other characters outside of the ASCII range are
+// considered as letters.
+static bool isWordCharacter(UChar ch)
+{
+    if (((ch >= '0') && (ch <= '9')) || ((ch >= 'a') && (ch <= 'z'))) {
+        return true;
+    }
+    if ((ch < 0xc0) || (ch == 0xd7) || (ch == 0xf7)) {
+        return false;
+    }
+    // General punctuation, CJK punctuation, fullwidth punctuation.
+    if (((ch >= 0x2000) && (ch <= 0x206f)) || ((ch >= 0x3000) && (ch <= 0x303f)) ||
+        ((ch >= 0xff00) && (ch <= 0xff0f)) || (ch == 0xfeff)) {
+        return false;
+    }
+    return true;
+}
+
+// Lowercased words of the text. Long words are truncated.
+static Array * wordsInText(String * text, unsigned int minimumLength)
+{
+    Array * result = Array::array();
+    if (text == NULL) {
+        return result;
+    }
+    text = text->lowercaseString();
+    const UChar * characters = text->unicodeCharacters();
+    unsigned int length = text->length();
+    unsigned int i = 0;
+    while (i < length) {
+        while ((i < length) && !isWordCharacter(characters[i])) {
+            i ++;
+        }
+        unsigned int start = i;
+        while ((i < length) && isWordCharacter(characters[i])) {
+            i ++;
+        }
+        unsigned int wordLength = i - start;
+        if ((wordLength == 0) || (wordLength < minimumLength)) {
+            continue;
+        }
+        if (wordLength > MAX_WORD_LENGTH) {
+            wordLength = MAX_WORD_LENGTH;
+        }
+        result->addObject(String::stringWithCharacters(characters + start, wordLength));
+    }
+    return result;
+}
+
+static bool hasWords(String * text)
+{
+    return wordsInText(text, 1)->count() > 0;
+}
+
+static String * termPrefix(char field)
+{
+    UChar prefix[2];
+    prefix[0] = (UChar) field;
+    prefix[1] = ':';
+    return String::stringWithCharacters(prefix, 2);
+}
+
+static void addWords(HashMap * terms, char field, String * text)
+{
+    Array * words = wordsInText(text, MIN_WORD_LENGTH);
+    if (words->count() == 0) {
+        return;
+    }
+    String * prefix = termPrefix(field);
+    mc_foreacharray(String, word, words) {
+        String * term = prefix->stringByAppendingString(word);
+        terms->setObjectForKey(term, term);
+    }
+}
+
+static void addAddressWords(HashMap * terms, char field, Address * address)
+{
+    if (address == NULL) {
+        return;
+    }
+    addWords(terms, field, address->displayName());
+    addWords(terms, field, address->mailbox());
+}
+
+static void addAddressesWords(HashMap * terms, char field, Array * addresses)
+{
+    if (addresses == NULL) {
+        return;
+    }
+    mc_foreacharray(Address, address, addresses) {
+        addAddressWords(terms, field, address);
+    }
+}
+
+static const char * fieldsForHeaderName(String * header)
+{
+    if (header == NULL) {
+        return NULL;
+    }
+    if (header->isEqualCaseInsensitive(MCSTR("from"))) {
+        return "f";
+    }
+    else if (header->isEqualCaseInsensitive(MCSTR("to"))) {
+        return "t";
+    }
+    else if (header->isEqualCaseInsensitive(MCSTR("cc"))) {
+        return "c";
+    }
+    else if (header->isEqualCaseInsensitive(MCSTR("bcc"))) {
+        return "b";
+    }
+    else if (header->isEqualCaseInsensitive(MCSTR("subject"))) {
+        return "s";
+    }
+    return NULL;
+}
+
+static int compareTerms(void * a, void * b, void * context)
+{
+    return ((String *) a)->compare((String *) b);
+}
+
+void IMAPSearchIndex::init()
+{
+    mFolder = NULL;
+    mPath = NULL;
+    mUidValidity = 0;
+    mUids = new IndexSet();
+    mBodyUids = new IndexSet();
+    mPostings = new HashMap();
+    mSortedTerms = NULL;
+    mJournal = new Data();
+    mNeedsCompaction = false;
+    mFileSize = 0;
+    mJournalFileSize = 0;
+}
+
+IMAPSearchIndex::IMAPSearchIndex()
+{
+    init();
+}
+
+IMAPSearchIndex::~IMAPSearchIndex()
+{
+    MC_SAFE_RELEASE(mJournal);
+    MC_SAFE_RELEASE(mSortedTerms);
+    MC_SAFE_RELEASE(mPostings);
+    MC_SAFE_RELEASE(mBodyUids);
+    MC_SAFE_RELEASE(mUids);
+    MC_SAFE_RELEASE(mPath);
+    MC_SAFE_RELEASE(mFolder);
+}
+
+void IMAPSearchIndex::setFolder(String * folder)
+{
+    MC_SAFE_REPLACE_COPY(String, mFolder, folder);
+}
+
+String * IMAPSearchIndex::folder()
+{
+    return mFolder;
+}
+
+void IMAPSearchIndex::setPath(String * path)
+{
+    MC_SAFE_REPLACE_COPY(String, mPath, path);
+}
+
+String * IMAPSearchIndex::path()
+{
+    return mPath;
+}
+
+void IMAPSearchIndex::setUidValidity(uint32_t uidValidity)
+{
+    if ((mUidValidity != 0) && (mUidValidity != uidValidity)) {
+        MCLog("uidvalidity of %s changed, resetting search index", MCUTF8(mFolder));
+        reset();
+    }
+    mUidValidity = uidValidity;
+}
+
+uint32_t IMAPSearchIndex::uidValidity()
+{
+    return mUidValidity;
+}
+
+IndexSet * IMAPSearchIndex::uids()
+{
+    return mUids;
+}
+
+IndexSet * IMAPSearchIndex::bodyUids()
+{
+    return mBodyUids;
+}
+
+unsigned int IMAPSearchIndex::termsCount()
+{
+    return mPostings->count();
+}
+
+void IMAPSearchIndex::reset()
+{
+    mUidValidity = 0;
+    mUids->removeAllIndexes();
+    mBodyUids->removeAllIndexes();
+    mPostings->removeAllObjects();
+    MC_SAFE_RELEASE(mSortedTerms);
+    mJournal->setBytes("", 0);
+    mNeedsCompaction = true;
+}
+
+void IMAPSearchIndex::addJournalRecord(Data * record)
+{
+    if (mNeedsCompaction) {
+        // The whole index will be written.
+        return;
+    }
+    appendVarint(mJournal, record->length());
+    mJournal->appendData(record);
+}
+
+void IMAPSearchIndex::addTerms(HashMap * terms, uint32_t uid)
+{
+    Array * allTerms = terms->allKeys();
+    mc_foreacharray(String, term, allTerms) {
+        IndexSet * termUids = (IndexSet *) mPostings->objectForKey(term);
+        if (termUids == NULL) {
+            termUids = new IndexSet();
+            mPostings->setObjectForKey(term, termUids);
+            termUids->release();
+            MC_SAFE_RELEASE(mSortedTerms);
+        }
+        termUids->addIndex(uid);
+    }
+}
+
+void IMAPSearchIndex::addMessage(IMAPMessage * message, String * body)
+{
+    uint32_t uid = message->uid();
+    HashMap * terms = HashMap::hashMap();
+    int indexed = 0;
+    if (!mUids->containsIndex(uid)) {
+        MessageHeader * header = message->header();
+        addAddressWords(terms, FIELD_FROM, header->from());
+        addAddressesWords(terms, FIELD_TO, header->to());
+        addAddressesWords(terms, FIELD_CC, header->cc());
+        addAddressesWords(terms, FIELD_BCC, header->bcc());
+        addWords(terms, FIELD_SUBJECT, header->subject());
+        mUids->addIndex(uid);
+        indexed |= JOURNAL_INDEXED_HEADERS;
+    }
+    if ((body != NULL) && !mBodyUids->containsIndex(uid)) {
+        addWords(terms, FIELD_BODY, body);
+        mBodyUids->addIndex(uid);
+        indexed |= JOURNAL_INDEXED_BODY;
+    }
+    if (indexed == 0) {
+        return;
+    }
+    addTerms(terms, uid);
+
+    Data * record = Data::data();
+    char byte = JOURNAL_RECORD_ADD;
+    record->appendBytes(&byte, 1);
+    appendVarint(record, uid);
+    byte = (char) indexed;
+    record->appendBytes(&byte, 1);
+    Array * allTerms = terms->allKeys();
+    appendVarint(record, allTerms->count());
+    mc_foreacharray(String, term, allTerms) {
+        appendTerm(record, term);
+    }
+    addJournalRecord(record);
+}
+
+void IMAPSearchIndex::removeUIDs(IndexSet * uids)
+{
+    if ((uids == NULL) || (uids->count() == 0)) {
+        return;
+    }
+    mUids->removeIndexSet(uids);
+    mBodyUids->removeIndexSet(uids);
+
+    Data * record = Data::data();
+    char recordType = JOURNAL_RECORD_REMOVE;
+    record->appendBytes(&recordType, 1);
+    appendIndexSet(record, uids);
+    addJournalRecord(record);
+
+    Array * allTerms = mPostings->allKeys();
+    mc_foreacharray(String, term, allTerms) {
+        IndexSet * termUids = (IndexSet *) mPostings->objectForKey(term);
+        termUids->removeIndexSet(uids);
+        if (termUids->count() == 0) {
+            mPostings->removeObjectForKey(term);
+            MC_SAFE_RELEASE(mSortedTerms);
+        }
+    }
+}
+
+void IMAPSearchIndex::updateWithSyncResult(IMAPSyncResult * result)
+{
+    removeUIDs(result->vanishedMessages());
+    Array * messages = result->modifiedOrAddedMessages();
+    if (messages == NULL) {
+        return;
+    }
+    mc_foreacharray(IMAPMessage, message, messages) {
+        addMessage(message, NULL);
+    }
+}
+
+void IMAPSearchIndex::indexBodies(IMAPSession * session, Array * messages, ErrorCode * pError)
+{
+    MCAssert(mFolder != NULL);
+
+    * pError = ErrorNone;
+    mc_foreacharray(IMAPMessage, message, messages) {
+        if (mBodyUids->containsIndex(message->uid())) {
+            continue;
+        }
+        AutoreleasePool * pool = new AutoreleasePool();
+        ErrorCode error = ErrorNone;
+        String * body = session->plainTextBodyRendering(message, mFolder, true, &error);
+        if (error == ErrorNone) {
+            addMessage(message, body);
+        }
+        pool->release();
+        if (error != ErrorNone) {
+            * pError = error;
+            return;
+        }
+    }
+}
+
+Array * IMAPSearchIndex::sortedTerms()
+{
+    if (mSortedTerms == NULL) {
+        mSortedTerms = mPostings->allKeys()->sortedArray(compareTerms, NULL);
+        mSortedTerms->retain();
+    }
+    return mSortedTerms;
+}
+
+// Terms with the same prefix are next to each other in the sorted terms.
+IndexSet * IMAPSearchIndex::uidsForPrefix(String * prefix)
+{
+    Array * terms = sortedTerms();
+    unsigned int low = 0;
+    unsigned int high = terms->count();
+    while (low < high) {
+        unsigned int middle = (low + high) / 2;
+        if (((String *) terms->objectAtIndex(middle))->compare(prefix) < 0) {
+            low = middle + 1;
+        }
+        else {
+            high = middle;
+        }
+    }
+
+    IndexSet * result = IndexSet::indexSet();
+    for(unsigned int i = low ; i < terms->count() ; i ++) {
+        String * term = (String *) terms->objectAtIndex(i);
+        if (!term->hasPrefix(prefix)) {
+            break;
+        }
+        result->addIndexSet((IndexSet *) mPostings->objectForKey(term));
+    }
+    return result;
+}
+
+// Each word of the text needs to match in one of the given fields.
+// Returns NULL if the text has no words: canSearch() returns false for such a criterion.
+IndexSet * IMAPSearchIndex::uidsForText(const char * fields, String * text)
+{
+    Array * words = wordsInText(text, 1);
+    if (words->count() == 0) {
+        return NULL;
+    }
+
+    IndexSet * result = NULL;
+    mc_foreacharray(String, word, words) {
+        IndexSet * wordUids = IndexSet::indexSet();
+        for(const char * field = fields ; * field != 0 ; field ++) {
+            wordUids->addIndexSet(uidsForPrefix(termPrefix(* field)->stringByAppendingString(word)));
+        }
+        if (result == NULL) {
+            result = wordUids;
+        }
+        else {
+            result->intersectsIndexSet(wordUids);
+        }
+        if (result->count() == 0) {
+            break;
+        }
+    }
+    return result;
+}
+
+bool IMAPSearchIndex::canSearch(IMAPSearchExpression * expression)
+{
+    switch (expression->kind()) {
+        case IMAPSearchKindAll:
+        case IMAPSearchKindNone:
+        case IMAPSearchKindUIDs:
+            return true;
+        case IMAPSearchKindFrom:
+        case IMAPSearchKindTo:
+        case IMAPSearchKindCc:
+        case IMAPSearchKindBcc:
+        case IMAPSearchKindRecipient:
+        case IMAPSearchKindSubject:
+        case IMAPSearchKindContent:
+        case IMAPSearchKindBody:
+            // Punctuation only can't be looked up in the index.
+            return hasWords(expression->value());
+        case IMAPSearchKindHeader:
+            return (fieldsForHeaderName(expression->header()) != NULL) && hasWords(expression->value());
+        case IMAPSearchKindOr:
+        case IMAPSearchKindAnd:
+            return canSearch(expression->leftExpression()) && canSearch(expression->rightExpression());
+        case IMAPSearchKindNot:
+            return canSearch(expression->leftExpression());
+        default:
+            return false;
+    }
+}
+
+IndexSet * IMAPSearchIndex::search(IMAPSearchExpression * expression)
+{
+    if (!canSearch(expression)) {
+        return NULL;
+    }
+    return evaluate(expression);
+}
+
+IndexSet * IMAPSearchIndex::evaluate(IMAPSearchExpression * expression)
+{
+    switch (expression->kind()) {
+        case IMAPSearchKindAll:
+            return (IndexSet *) mUids->copy()->autorelease();
+        case IMAPSearchKindNone:
+            return IndexSet::indexSet();
+        case IMAPSearchKindFrom:
+            return uidsForText("f", expression->value());
+        case IMAPSearchKindTo:
+            return uidsForText("t", expression->value());
+        case IMAPSearchKindCc:
+            return uidsForText("c", expression->value());
+        case IMAPSearchKindBcc:
+            return uidsForText("b", expression->value());
+        case IMAPSearchKindRecipient:
+            return uidsForText("tcb", expression->value());
+        case IMAPSearchKindSubject:
+            return uidsForText("s", expression->value());
+        case IMAPSearchKindContent:
+            return uidsForText("ftcbsx", expression->value());
+        case IMAPSearchKindBody:
+            return uidsForText("x", expression->value());
+        case IMAPSearchKindHeader:
+            return uidsForText(fieldsForHeaderName(expression->header()), expression->value());
+        case IMAPSearchKindUIDs:
+        {
+            IndexSet * result = (IndexSet *) expression->uids()->copy()->autorelease();
+            result->intersectsIndexSet(mUids);
+            return result;
+        }
+        case IMAPSearchKindOr:
+        {
+            IndexSet * result = evaluate(expression->leftExpression());
+            result->addIndexSet(evaluate(expression->rightExpression()));
+            return result;
+        }
+        case IMAPSearchKindAnd:
+        {
+            IndexSet * result = evaluate(expression->leftExpression());
+            if (result->count() > 0) {
+                result->intersectsIndexSet(evaluate(expression->rightExpression()));
+            }
+            return result;
+        }
+        case IMAPSearchKindNot:
+        {
+            IndexSet * result = (IndexSet *) mUids->copy()->autorelease();
+            result->removeIndexSet(evaluate(expression->leftExpression()));
+            return result;
+        }
+        default:
+            MCAssert(0);
+            return NULL;
+    }
+}
+
+Data * IMAPSearchIndex::serializedData()
+{
+    Data * data = Data::data();
+    data->appendBytes(INDEX_MAGIC, 4);
+    appendUInt32(data, INDEX_VERSION);
+    appendUInt32(data, mUidValidity);
+    appendIndexSet(data, mUids);
+    appendIndexSet(data, mBodyUids);
+    Array * terms = sortedTerms();
+    appendVarint(data, terms->count());
+    mc_foreacharray(String, term, terms) {
+        appendTerm(data, term);
+        appendIndexSet(data, (IndexSet *) mPostings->objectForKey(term));
+    }
+    return data;
+}
+
+bool IMAPSearchIndex::importSerializedData(Data * data)
+{
+    const char * bytes = data->bytes();
+    unsigned int length = data->length();
+
+    if ((length < INDEX_HEADER_SIZE) || (memcmp(bytes, INDEX_MAGIC, 4) != 0) ||
+        (readUInt32(bytes + 4) != INDEX_VERSION)) {
+        return false;
+    }
+
+    IndexReader reader;
+    reader.bytes = bytes;
+    reader.length = length;
+    reader.position = INDEX_HEADER_SIZE;
+    reader.failed = false;
+
+    IndexSet * uids = readIndexSet(&reader);
+    IndexSet * bodyUids = readIndexSet(&reader);
+    uint64_t termsCount = readVarint(&reader);
+    HashMap * postings = HashMap::hashMap();
+    for(uint64_t i = 0 ; (i < termsCount) && !reader.failed ; i ++) {
+        String * term = readTerm(&reader);
+        if (term == NULL) {
+            break;
+        }
+        IndexSet * termUids = readIndexSet(&reader);
+        postings->setObjectForKey(term, termUids);
+    }
+    if (reader.failed) {
+        return false;
+    }
+
+    mUidValidity = readUInt32(bytes + 8);
+    MC_SAFE_REPLACE_RETAIN(IndexSet, mUids, uids);
+    MC_SAFE_REPLACE_RETAIN(IndexSet, mBodyUids, bodyUids);
+    MC_SAFE_REPLACE_RETAIN(HashMap, mPostings, postings);
+    MC_SAFE_RELEASE(mSortedTerms);
+    return true;
+}
+
+// An interrupted append can leave an incomplete record at the end: the records before it are applied.
+bool IMAPSearchIndex::importJournal(Data * data)
+{
+    const char * bytes = data->bytes();
+    unsigned int length = data->length();
+
+    if ((length < INDEX_HEADER_SIZE) || (memcmp(bytes, JOURNAL_MAGIC, 4) != 0) ||
+        (readUInt32(bytes + 4) != JOURNAL_VERSION) || (readUInt32(bytes + 8) != mUidValidity)) {
+        return false;
+    }
+
+    IndexReader reader;
+    reader.bytes = bytes;
+    reader.length = length;
+    reader.position = INDEX_HEADER_SIZE;
+    reader.failed = false;
+
+    while (reader.position < reader.length) {
+        uint64_t recordLength = readVarint(&reader);
+        if (reader.failed || (recordLength == 0) || (recordLength > reader.length - reader.position)) {
+            return false;
+        }
+        IndexReader recordReader;
+        recordReader.bytes = bytes + reader.position;
+        recordReader.length = (unsigned int) recordLength;
+        recordReader.position = 1;
+        recordReader.failed = false;
+        reader.position += (unsigned int) recordLength;
+
+        if (recordReader.bytes[0] == JOURNAL_RECORD_ADD) {
+            uint32_t uid = (uint32_t) readVarint(&recordReader);
+            if (recordReader.position >= recordReader.length) {
+                return false;
+            }
+            int indexed = (unsigned char) recordReader.bytes[recordReader.position];
+            recordReader.position ++;
+            uint64_t termsCount = readVarint(&recordReader);
+            HashMap * terms = HashMap::hashMap();
+            for(uint64_t i = 0 ; (i < termsCount) && !recordReader.failed ; i ++) {
+                String * term = readTerm(&recordReader);
+                if (term != NULL) {
+                    terms->setObjectForKey(term, term);
+                }
+            }
+            if (recordReader.failed) {
+                return false;
+            }
+            if ((indexed & JOURNAL_INDEXED_HEADERS) != 0) {
+                mUids->addIndex(uid);
+            }
+            if ((indexed & JOURNAL_INDEXED_BODY) != 0) {
+                mBodyUids->addIndex(uid);
+            }
+            addTerms(terms, uid);
+        }
+        else if (recordReader.bytes[0] == JOURNAL_RECORD_REMOVE) {
+            IndexSet * uids = readIndexSet(&recordReader);
+            if (recordReader.failed) {
+                return false;
+            }
+            removeUIDs(uids);
+        }
+        else {
+            return false;
+        }
+    }
+    return true;
+}
+
+String * IMAPSearchIndex::journalPath()
+{
+    return mPath->stringByAppendingUTF8Characters(".log");
+}
+
+ErrorCode IMAPSearchIndex::load()
+{
+    MCAssert(mPath != NULL);
+
+    reset();
+    mFileSize = 0;
+    mJournalFileSize = 0;
+    Data * data = Data::dataWithContentsOfFile(mPath);
+    if (data != NULL) {
+        if (!importSerializedData(data)) {
+            MCLog("invalid search index %s", MCUTF8(mPath));
+            reset();
+            return ErrorFile;
+        }
+        mFileSize = data->length();
+    }
+
+    Data * journal = Data::dataWithContentsOfFile(journalPath());
+    if (journal != NULL) {
+        if (!importJournal(journal)) {
+            // The changes that could be read are kept. The index will be written again.
+            MCLog("invalid search index journal %s", MCUTF8(journalPath()));
+            mJournal->setBytes("", 0);
+            mNeedsCompaction = true;
+            return ErrorNone;
+        }
+        mJournalFileSize = journal->length();
+    }
+    // Applying the journal doesn't need to write it again.
+    mJournal->setBytes("", 0);
+    mNeedsCompaction = (data == NULL) && (journal == NULL);
+    return ErrorNone;
+}
+
+ErrorCode IMAPSearchIndex::save()
+{
+    MCAssert(mPath != NULL);
+
+    if (mNeedsCompaction || (mFileSize == 0) || (mJournalFileSize + mJournal->length() > mFileSize)) {
+        return compact();
+    }
+    if (mJournal->length() == 0) {
+        return ErrorNone;
+    }
+
+    Data * header = NULL;
+    if (mJournalFileSize == 0) {
+        header = Data::data();
+        header->appendBytes(JOURNAL_MAGIC, 4);
+        appendUInt32(header, JOURNAL_VERSION);
+        appendUInt32(header, mUidValidity);
+    }
+    FILE * f = fopen(journalPath()->fileSystemRepresentation(), (header != NULL) ? "wb" : "ab");
+    if (f == NULL) {
+        return ErrorFile;
+    }
+    bool written = true;
+    if ((header != NULL) && (fwrite(header->bytes(), 1, header->length(), f) != header->length())) {
+        written = false;
+    }
+    if (written && (fwrite(mJournal->bytes(), 1, mJournal->length(), f) != mJournal->length())) {
+        written = false;
+    }
+    if (fclose(f) != 0) {
+        written = false;
+    }
+    if (!written) {
+        // The journal may end with an incomplete record: the index is written again on the next save.
+        mNeedsCompaction = true;
+        return ErrorFile;
+    }
+    mJournalFileSize += ((header != NULL) ? header->length() : 0) + mJournal->length();
+    mJournal->setBytes("", 0);
+    return ErrorNone;
+}
+
+// Writes the whole index and removes the journal.
+ErrorCode IMAPSearchIndex::compact()
+{
+    // Write to a temporary file first so that an interrupted save doesn't corrupt the index.
+    String * temporaryPath = mPath->stringByAppendingUTF8Characters(".tmp");
+    Data * data = serializedData();
+    ErrorCode error = data->writeToFile(temporaryPath);
+    if (error != ErrorNone) {
+        unlink(temporaryPath->fileSystemRepresentation());
+        mNeedsCompaction = true;
+        return error;
+    }
+    if (rename(temporaryPath->fileSystemRepresentation(), mPath->fileSystemRepresentation()) != 0) {
+        // rename() doesn't replace an existing file on Windows.
+        unlink(mPath->fileSystemRepresentation());
+        if (rename(temporaryPath->fileSystemRepresentation(), mPath->fileSystemRepresentation()) != 0) {
+            unlink(temporaryPath->fileSystemRepresentation());
+            mNeedsCompaction = true;
+            return ErrorFile;
+        }
+    }
+    unlink(journalPath()->fileSystemRepresentation());
+    mFileSize = data->length();
+    mJournalFileSize = 0;
+    mJournal->setBytes("", 0);
+    mNeedsCompaction = false;
+    return ErrorNone;
+}
+
+String * IMAPSearchIndex::description()
+{
+    return String::stringWithUTF8Format("<%s:%p %s %u messages, %u bodies, %u terms>", MCUTF8(className()), this,
+                                        MCUTF8(mFolder), mUids->count(), mBodyUids->count(), mPostings->count());
+}
@@ -0,0 +1,113 @@
+//
+//  MCIMAPSearchIndex.h
+//  mailcore2
+//
+//  Created by agent on 10/18/26.
+//  Copyright (c) 2026 MailCore. All rights reserved.
+//
+
+#ifndef MAILCORE_MCIMAPSEARCHINDEX_H
+
+#define MAILCORE_MCIMAPSEARCHINDEX_H
+
+#include <MailCore/MCBaseTypes.h>
+#include <MailCore/MCMessageConstants.h>
+
+#ifdef __cplusplus
+
+namespace mailcore {
+
+    class IMAPSession;
+    class IMAPMessage;
+    class IMAPSyncResult;
+    class IMAPSearchExpression;
+
+    // Local full-text index of the messages of a folder, stored in a file.
+    // The changes since the file was last written are appended to a journal next to it, path() followed by ".log".
+    // The file is written again, and the journal removed, when the journal gets larger than the file.
+    // Words of the From, To, Cc, Bcc and Subject headers and of the text of the body are mapped to the UIDs
+    // of the messages that contain them. A word of a query matches the indexed words that start with it.
+    // It's not thread-safe: it should be used from one thread at a time.
+    class MAILCORE_EXPORT IMAPSearchIndex : public Object {
+    public:
+        IMAPSearchIndex();
+        virtual ~IMAPSearchIndex();
+
+        virtual void setFolder(String * folder);
+        virtual String * folder();
+
+        // Location of the index.
+        virtual void setPath(String * path);
+        virtual String * path();
+
+        // The index is emptied if the UIDVALIDITY changes.
+        virtual void setUidValidity(uint32_t uidValidity);
+        virtual uint32_t uidValidity();
+
+        // UIDs of the indexed messages.
+        virtual IndexSet * uids();
+        // UIDs of the messages whose body has been indexed.
+        virtual IndexSet * bodyUids();
+        virtual unsigned int termsCount();
+
+        // Reads the index and applies the journal. A missing file is not an error: the index is then empty.
+        virtual ErrorCode load();
+        // Appends the changes to the journal, or writes the whole index when the journal is too large.
+        virtual ErrorCode save();
+        virtual void reset();
+
+        // Indexes the headers of the message and the given body text, which can be NULL.
+        // Headers of a message that is already indexed are not indexed again.
+        virtual void addMessage(IMAPMessage * message, String * body);
+        virtual void removeUIDs(IndexSet * uids);
+        // Indexes the headers of the added messages and removes the vanished ones.
+        virtual void updateWithSyncResult(IMAPSyncResult * result);
+        // Fetches and indexes the text of the body of the messages whose body is not indexed yet.
+        virtual void indexBodies(IMAPSession * session, Array * /* IMAPMessage */ messages, ErrorCode * pError);
+
+        // Returns true if the expression only has criteria that the index can evaluate:
+        // text criteria with at least one word, UIDs, and, or and not.
+        virtual bool canSearch(IMAPSearchExpression * expression);
+        // Returns the UIDs of the matching messages, NULL if canSearch() returns false.
+        // Messages whose body is not indexed can only match the text criteria on their headers.
+        virtual IndexSet * search(IMAPSearchExpression * expression);
+
+    public: // subclass behavior
+        virtual String * description();
+
+    private:
+        String * mFolder;
+        String * mPath;
+        uint32_t mUidValidity;
+        IndexSet * mUids;
+        IndexSet * mBodyUids;
+        // term -> IndexSet of UIDs
+        HashMap * mPostings;
+        // Sorted terms, to look up the terms with a given prefix. NULL when it needs to be computed.
+        Array * mSortedTerms;
+        // Records of the changes that are not saved yet.
+        Data * mJournal;
+        // The whole index needs to be written on the next save.
+        bool mNeedsCompaction;
+        unsigned int mFileSize;
+        unsigned int mJournalFileSize;
+
+        void init();
+        void addTerms(HashMap * terms, uint32_t uid);
+        Array * sortedTerms();
+        IndexSet * uidsForPrefix(String * prefix);
+        IndexSet * uidsForText(const char * fields, String * text);
+        IndexSet * evaluate(IMAPSearchExpression * expression);
+        void addJournalRecord(Data * record);
+        Data * serializedData();
+        bool importSerializedData(Data * data);
+        bool importJournal(Data * data);
+        String * journalPath();
+        ErrorCode compact();
+    };
+
+}
+
+#endif
+
+#endif
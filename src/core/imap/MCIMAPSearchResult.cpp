@@ -0,0 +1,95 @@
+//
+//  MCIMAPSearchResult.cpp
+//  mailcore2
+//
+//  Created by agent on 10/18/26.
+//  Copyright (c) 2026 MailCore. All rights reserved.
+//
+
+#include "MCIMAPSearchResult.h"
+
+using namespace mailcore;
+
+void IMAPSearchResult::init()
+{
+    mMinUID = 0;
+    mMaxUID = 0;
+    mCount = 0;
+    mUids = NULL;
+}
+
+IMAPSearchResult::IMAPSearchResult()
+{
+    init();
+}
+
+IMAPSearchResult::IMAPSearchResult(IMAPSearchResult * other)
+{
+    init();
+    setMinUID(other->minUID());
+    setMaxUID(other->maxUID());
+    setCount(other->count());
+    setUids(other->uids());
+}
+
+IMAPSearchResult::~IMAPSearchResult()
+{
+    MC_SAFE_RELEASE(mUids);
+}
+
+Object * IMAPSearchResult::copy()
+{
+    return new IMAPSearchResult(this);
+}
+
+void IMAPSearchResult::setMinUID(uint32_t minUID)
+{
+    mMinUID = minUID;
+}
+
+uint32_t IMAPSearchResult::minUID()
+{
+    return mMinUID;
+}
+
+void IMAPSearchResult::setMaxUID(uint32_t maxUID)
+{
+    mMaxUID = maxUID;
+}
+
+uint32_t IMAPSearchResult::maxUID()
+{
+    return mMaxUID;
+}
+
+void IMAPSearchResult::setCount(uint32_t count)
+{
+    mCount = count;
+}
+
+uint32_t IMAPSearchResult::count()
+{
+    return mCount;
+}
+
+void IMAPSearchResult::setUids(IndexSet * uids)
+{
+    MC_SAFE_REPLACE_COPY(IndexSet, mUids, uids);
+}
+
+IndexSet * IMAPSearchResult::uids()
+{
+    return mUids;
+}
+
+String * IMAPSearchResult::description()
+{
+    String * result = String::string();
+    result->appendUTF8Format("<%s:%p min: %u max: %u count: %u", MCUTF8(className()), this,
+                             (unsigned int) mMinUID, (unsigned int) mMaxUID, (unsigned int) mCount);
+    if (mUids != NULL) {
+        result->appendUTF8Format(" uids: %s", MCUTF8(mUids->description()));
+    }
+    result->appendUTF8Characters(">");
+    return result;
+}
@@ -0,0 +1,60 @@
+//
+//  MCIMAPSearchResult.h
+//  mailcore2
+//
+//  Created by agent on 10/18/26.
+//  Copyright (c) 2026 MailCore. All rights reserved.
+//
+
+#ifndef MAILCORE_MCIMAPSEARCHRESULT_H
+
+#define MAILCORE_MCIMAPSEARCHRESULT_H
+
+#include <MailCore/MCBaseTypes.h>
+#include <MailCore/MCMessageConstants.h>
+
+#ifdef __cplusplus
+
+namespace mailcore {
+    
+    // Result of IMAPSession::extendedSearch() and IMAPSession::partialSearch().
+    // Only the values that have been requested are set.
+    class MAILCORE_EXPORT IMAPSearchResult : public Object {
+    public:
+        IMAPSearchResult();
+        virtual ~IMAPSearchResult();
+        
+        // 0 when nothing matched.
+        virtual void setMinUID(uint32_t minUID);
+        virtual uint32_t minUID();
+        
+        virtual void setMaxUID(uint32_t maxUID);
+        virtual uint32_t maxUID();
+        
+        // Number of matching messages.
+        virtual void setCount(uint32_t count);
+        virtual uint32_t count();
+        
+        // All the matching UIDs, or the UIDs of the requested page for a partial search.
+        virtual void setUids(IndexSet * uids);
+        virtual IndexSet * uids();
+        
+    public: // subclass behavior
+        IMAPSearchResult(IMAPSearchResult * other);
+        virtual Object * copy();
+        virtual String * description();
+        
+    private:
+        uint32_t mMinUID;
+        uint32_t mMaxUID;
+        uint32_t mCount;
+        IndexSet * mUids;
+        
+        void init();
+    };
+    
+}
+
+#endif
+
+#endif
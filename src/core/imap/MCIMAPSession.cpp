@@ -5,12 +5,19 @@
 #include <libetpan/libetpan.h>
 #include <string.h>
 #include <stdlib.h>
+#include <sys/stat.h>
+#ifndef _MSC_VER
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#endif
 
 #include "MCDefines.h"
 #include "MCIMAPSearchExpression.h"
 #include "MCIMAPFolder.h"
 #include "MCIMAPMessage.h"
 #include "MCIMAPPart.h"
+#include "MCIMAPBodyStructure.h"
 #include "MCMessageHeader.h"
 #include "MCAbstractPart.h"
 #include "MCIMAPProgressCallback.h"
@@ -28,6 +35,25 @@
 #include "MCIMAPIdentity.h"
 #include "MCLibetpan.h"
 #include "MCDataStreamDecoder.h"
+#include "MCDataDecoderUtils.h"
+#include "MCOperationTiming.h"
+#include "MCConnectionMetrics.h"
+#include "MCIMAPBodyCache.h"
+#include "MCIMAPMessageStreamCallback.h"
+#include "MCIMAPAppendItem.h"
+#include "MCIMAPSortCriterion.h"
+#include "MCIMAPThread.h"
+#include "MCIMAPSearchResult.h"
+#include "MCIMAPNotifyEvent.h"
+#include "MCIMAPResponseBuffer.h"
+
+// libetpan uses OpenSSL on Linux: the TLS connection of the watched folders is then read and written
+// without blocking.
+#if defined(__linux__) && !defined(ANDROID) && !defined(__ANDROID__)
+#define NOTIFY_USES_OPENSSL 1
+#include <openssl/ssl.h>
+#include <openssl/err.h>
+#endif
 
 using namespace mailcore;
 
@@ -84,6 +110,81 @@ void LoadByChunkProgress::bodyProgress(IMAPSession * session, unsigned int curre
     mProgressCallback->bodyProgress(session, current, maximum);
 }
 
+class FetchWindowProgress : public Object, public IMAPProgressCallback {
+public:
+    FetchWindowProgress();
+    virtual ~FetchWindowProgress();
+
+    virtual void setOffset(unsigned int offset);
+    virtual void setEstimatedCount(unsigned int estimatedCount);
+    virtual void setProgressCallback(IMAPProgressCallback * progressCallback);
+
+    virtual void bodyProgress(IMAPSession * session, unsigned int current, unsigned int maximum);
+    virtual void itemsProgress(IMAPSession * session, unsigned int current, unsigned int maximum);
+
+private:
+    unsigned int mOffset;
+    unsigned int mEstimatedCount;
+    IMAPProgressCallback * mProgressCallback; // non retained
+};
+
+FetchWindowProgress::FetchWindowProgress()
+{
+    mOffset = 0;
+    mEstimatedCount = 0;
+    mProgressCallback = NULL;
+}
+
+FetchWindowProgress::~FetchWindowProgress()
+{
+}
+
+void FetchWindowProgress::setOffset(unsigned int offset)
+{
+    mOffset = offset;
+}
+
+void FetchWindowProgress::setEstimatedCount(unsigned int estimatedCount)
+{
+    mEstimatedCount = estimatedCount;
+}
+
+void FetchWindowProgress::setProgressCallback(IMAPProgressCallback * progressCallback)
+{
+    mProgressCallback = progressCallback;
+}
+
+void FetchWindowProgress::bodyProgress(IMAPSession * session, unsigned int current, unsigned int maximum)
+{
+    mProgressCallback->bodyProgress(session, current, maximum);
+}
+
+void FetchWindowProgress::itemsProgress(IMAPSession * session, unsigned int current, unsigned int maximum)
+{
+    // Report the progress of the whole range instead of the progress of the window.
+    current += mOffset;
+    if (current > mEstimatedCount) {
+        mEstimatedCount = current;
+    }
+    mProgressCallback->itemsProgress(session, current, mEstimatedCount);
+}
+
+enum {
+    APPEND_CHUNK_SIZE = 64 * 1024,
+    MULTIAPPEND_MAX_MESSAGES = 100,
+    MULTIAPPEND_MAX_SIZE = 32 * 1024 * 1024,
+};
+
+enum {
+    FETCH_WINDOW_DEFAULT_SIZE = 1000,
+    FETCH_WINDOW_MIN_SIZE = 100,
+    FETCH_WINDOW_MAX_SIZE = 50000,
+    FETCH_WINDOW_MAX_RETRIES = 3,
+};
+
+// Duration of a window the window size is adjusted to, in seconds.
+#define FETCH_WINDOW_TARGET_DURATION 2.0
+
 enum {
     STATE_DISCONNECTED,
     STATE_CONNECTED,
@@ -91,6 +192,19 @@ enum {
     STATE_SELECTED,
 };
 
+enum {
+    NOTIFY_MODE_NONE,
+    NOTIFY_MODE_NOTIFY,
+    NOTIFY_MODE_IDLE,
+};
+
+enum {
+    // Read and written through libetpan, which may block.
+    NOTIFY_TRANSPORT_STREAM,
+    NOTIFY_TRANSPORT_SOCKET,
+    NOTIFY_TRANSPORT_SSL,
+};
+
 String * mailcore::IMAPNamespacePersonal = NULL;
 String * mailcore::IMAPNamespaceOther = NULL;
 String * mailcore::IMAPNamespaceShared = NULL;
@@ -293,6 +407,168 @@ static Array * arrayFromSet(struct mailimap_set * imap_set)
     return result;
 }
 
+// Helpers to write the commands sent in a pipeline.
+
+static void appendSetToCommand(String * command, struct mailimap_set * set)
+{
+    bool first = true;
+    for(clistiter * iter = clist_begin(set->set_list) ; iter != NULL ; iter = clist_next(iter)) {
+        struct mailimap_set_item * item;
+        
+        item = (struct mailimap_set_item *) clist_content(iter);
+        if (!first) {
+            command->appendUTF8Characters(",");
+        }
+        first = false;
+        if (item->set_first == item->set_last) {
+            command->appendUTF8Format("%u", (unsigned int) item->set_first);
+        }
+        else if (item->set_last == 0) {
+            command->appendUTF8Format("%u:*", (unsigned int) item->set_first);
+        }
+        else {
+            command->appendUTF8Format("%u:%u", (unsigned int) item->set_first, (unsigned int) item->set_last);
+        }
+    }
+}
+
+// Returns false if the string would need to be sent as a literal.
+static bool appendAStringToCommand(String * command, const char * str)
+{
+    bool isAtom = (str[0] != 0);
+    for(const char * p = str ; * p != 0 ; p ++) {
+        unsigned char ch = (unsigned char) * p;
+        if ((ch >= 0x80) || (ch == '\r') || (ch == '\n')) {
+            return false;
+        }
+        if ((ch <= 0x20) || (ch == 0x7f) || (strchr("(){%*\"\\]", ch) != NULL)) {
+            isAtom = false;
+        }
+    }
+    if (isAtom) {
+        command->appendUTF8Characters(str);
+        return true;
+    }
+    
+    command->appendUTF8Characters("\"");
+    for(const char * p = str ; * p != 0 ; p ++) {
+        char quoted[3];
+        if ((* p == '"') || (* p == '\\')) {
+            quoted[0] = '\\';
+            quoted[1] = * p;
+            quoted[2] = 0;
+        }
+        else {
+            quoted[0] = * p;
+            quoted[1] = 0;
+        }
+        command->appendUTF8Characters(quoted);
+    }
+    command->appendUTF8Characters("\"");
+    return true;
+}
+
+static void appendFlagListToCommand(String * command, MessageFlag flags, Array * customFlags)
+{
+    Array * flagsNames = Array::array();
+    if ((flags & MessageFlagSeen) != 0) {
+        flagsNames->addObject(MCSTR("\\Seen"));
+    }
+    if ((flags & MessageFlagAnswered) != 0) {
+        flagsNames->addObject(MCSTR("\\Answered"));
+    }
+    if ((flags & MessageFlagFlagged) != 0) {
+        flagsNames->addObject(MCSTR("\\Flagged"));
+    }
+    if ((flags & MessageFlagDeleted) != 0) {
+        flagsNames->addObject(MCSTR("\\Deleted"));
+    }
+    if ((flags & MessageFlagDraft) != 0) {
+        flagsNames->addObject(MCSTR("\\Draft"));
+    }
+    if ((flags & MessageFlagMDNSent) != 0) {
+        flagsNames->addObject(MCSTR("$MDNSent"));
+    }
+    if ((flags & MessageFlagForwarded) != 0) {
+        flagsNames->addObject(MCSTR("$Forwarded"));
+    }
+    if ((flags & MessageFlagSubmitPending) != 0) {
+        flagsNames->addObject(MCSTR("$SubmitPending"));
+    }
+    if ((flags & MessageFlagSubmitted) != 0) {
+        flagsNames->addObject(MCSTR("$Submitted"));
+    }
+    if (customFlags != NULL) {
+        flagsNames->addObjectsFromArray(customFlags);
+    }
+    command->appendUTF8Characters("(");
+    command->appendString(flagsNames->componentsJoinedByString(MCSTR(" ")));
+    command->appendUTF8Characters(")");
+}
+
+static void appendDateToCommand(String * command, time_t date)
+{
+    static const char * monthNames[] = {"Jan", "Feb", "Mar", "Apr", "May", "Jun",
+        "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"};
+    struct mailimap_date_time * imap_date = imapDateFromTimestamp(date);
+    int zone = imap_date->dt_zone;
+    command->appendUTF8Format("\"%02i-%s-%04i %02i:%02i:%02i %c%04i\"",
+                              imap_date->dt_day, monthNames[imap_date->dt_month - 1], imap_date->dt_year,
+                              imap_date->dt_hour, imap_date->dt_min, imap_date->dt_sec,
+                              (zone < 0) ? '-' : '+', (zone < 0) ? -zone : zone);
+    mailimap_date_time_free(imap_date);
+}
+
+static void addAppendedUIDsFromResponse(mailimap * imap, uint32_t * pUidValidity, IndexSet * uids)
+{
+    for(clistiter * cur = clist_begin(imap->imap_response_info->rsp_extension_list) ; cur != NULL ; cur = clist_next(cur)) {
+        struct mailimap_extension_data * ext_data;
+        struct mailimap_uidplus_resp_code_apnd * resp_code_apnd;
+        
+        ext_data = (struct mailimap_extension_data *) clist_content(cur);
+        if (ext_data->ext_extension->ext_id != MAILIMAP_EXTENSION_UIDPLUS) {
+            continue;
+        }
+        if (ext_data->ext_type != MAILIMAP_UIDPLUS_RESP_CODE_APND) {
+            continue;
+        }
+        
+        resp_code_apnd = (struct mailimap_uidplus_resp_code_apnd *) ext_data->ext_data;
+        if (pUidValidity != NULL) {
+            * pUidValidity = resp_code_apnd->uid_uidvalidity;
+        }
+        if (resp_code_apnd->uid_set != NULL) {
+            uids->addIndexSet(indexSetFromSet(resp_code_apnd->uid_set));
+        }
+    }
+}
+
+static void addUidMappingFromResponse(mailimap * imap, HashMap * uidMapping)
+{
+    for(clistiter * cur = clist_begin(imap->imap_response_info->rsp_extension_list) ; cur != NULL ; cur = clist_next(cur)) {
+        struct mailimap_extension_data * ext_data;
+        struct mailimap_uidplus_resp_code_copy * resp_code_copy;
+        
+        ext_data = (struct mailimap_extension_data *) clist_content(cur);
+        if (ext_data->ext_extension->ext_id != MAILIMAP_EXTENSION_UIDPLUS) {
+            continue;
+        }
+        if (ext_data->ext_type != MAILIMAP_UIDPLUS_RESP_CODE_COPY) {
+            continue;
+        }
+        
+        resp_code_copy = (struct mailimap_uidplus_resp_code_copy *) ext_data->ext_data;
+        if ((resp_code_copy->uid_source_set == NULL) || (resp_code_copy->uid_dest_set == NULL)) {
+            continue;
+        }
+        Array * srcUidsArray = arrayFromSet(resp_code_copy->uid_source_set);
+        Array * destUidsArray = arrayFromSet(resp_code_copy->uid_dest_set);
+        for(unsigned int i = 0 ; i < srcUidsArray->count() && i < destUidsArray->count() ; i ++) {
+            uidMapping->setObjectForKey(srcUidsArray->objectAtIndex(i), destUidsArray->objectAtIndex(i));
+        }
+    }
+}
+
 static clist * splitSet(struct mailimap_set * set, unsigned int splitCount)
 {
     struct mailimap_set * current_set;
@@ -359,6 +635,121 @@ static IndexSet * indexSetFromSet(struct mailimap_set * imap_set)
     return indexSet;
 }
 
+// libetpan doesn't know about PREVIEW (RFC 8970): the FETCH response item
+// "PREVIEW" SP nstring is parsed by this extension.
+static int preview_extension_parser(int calling_parser, mailstream * fd,
+                                    MMAPString * buffer, struct mailimap_parser_context * parser_ctx,
+                                    size_t * indx, struct mailimap_extension_data ** result,
+                                    size_t progr_rate, progress_function * progr_fun);
+static void preview_extension_free(struct mailimap_extension_data * ext_data);
+
+static struct mailimap_extension_api preview_extension = {
+    /* name */          (char *) "PREVIEW",
+    /* extension_id */  -1,
+    /* parser */        preview_extension_parser,
+    /* free */          preview_extension_free,
+};
+
+static int preview_extension_parser(int calling_parser, mailstream * fd,
+                                    MMAPString * buffer, struct mailimap_parser_context * parser_ctx,
+                                    size_t * indx, struct mailimap_extension_data ** result,
+                                    size_t progr_rate, progress_function * progr_fun)
+{
+    if (calling_parser != MAILIMAP_EXTENDED_PARSER_FETCH_DATA) {
+        return MAILIMAP_ERROR_PARSE;
+    }
+
+    size_t cur_token = * indx;
+    if ((buffer->len < cur_token + 8) || (strncasecmp(buffer->str + cur_token, "PREVIEW ", 8) != 0)) {
+        return MAILIMAP_ERROR_PARSE;
+    }
+    cur_token += 8;
+
+    char * preview = NULL;
+    if ((buffer->len >= cur_token + 3) && (strncasecmp(buffer->str + cur_token, "NIL", 3) == 0)) {
+        cur_token += 3;
+    }
+    else if ((cur_token < buffer->len) && (buffer->str[cur_token] == '"')) {
+        // quoted string
+        MMAPString * value = mmap_string_new("");
+        bool terminated = false;
+        cur_token ++;
+        while (cur_token < buffer->len) {
+            char ch = buffer->str[cur_token];
+            cur_token ++;
+            if (ch == '"') {
+                terminated = true;
+                break;
+            }
+            if ((ch == '\\') && (cur_token < buffer->len)) {
+                ch = buffer->str[cur_token];
+                cur_token ++;
+            }
+            mmap_string_append_c(value, ch);
+        }
+        if (!terminated) {
+            mmap_string_free(value);
+            return MAILIMAP_ERROR_PARSE;
+        }
+        preview = strdup(value->str);
+        mmap_string_free(value);
+    }
+    else if ((cur_token < buffer->len) && (buffer->str[cur_token] == '{')) {
+        // literal: the line ends with {n} and the content has not been read yet.
+        char * end = NULL;
+        unsigned long length = strtoul(buffer->str + cur_token + 1, &end, 10);
+        if ((end == NULL) || (* end != '}')) {
+            return MAILIMAP_ERROR_PARSE;
+        }
+        preview = (char *) malloc(length + 1);
+        size_t readLength = 0;
+        while (readLength < length) {
+            ssize_t count = mailstream_read(fd, preview + readLength, length - readLength);
+            if (count <= 0) {
+                free(preview);
+                return MAILIMAP_ERROR_STREAM;
+            }
+            readLength += count;
+        }
+        preview[length] = 0;
+
+        // Keep the literal in the buffer, as libetpan does, and continue with the rest of the response.
+        if (mmap_string_append_len(buffer, preview, length) == NULL) {
+            free(preview);
+            return MAILIMAP_ERROR_MEMORY;
+        }
+        cur_token = buffer->len;
+        if (mailstream_read_line_append(fd, buffer) == NULL) {
+            free(preview);
+            return MAILIMAP_ERROR_STREAM;
+        }
+    }
+    else {
+        return MAILIMAP_ERROR_PARSE;
+    }
+
+    * result = mailimap_extension_data_new(&preview_extension, 0, preview);
+    if (* result == NULL) {
+        free(preview);
+        return MAILIMAP_ERROR_MEMORY;
+    }
+    * indx = cur_token;
+    return MAILIMAP_NO_ERROR;
+}
+
+static void preview_extension_free(struct mailimap_extension_data * ext_data)
+{
+    free(ext_data->ext_data);
+    free(ext_data);
+}
+
+static pthread_once_t previewExtensionOnce = PTHREAD_ONCE_INIT;
+
+static void registerPreviewExtension()
+{
+    mailimap_extension_register(&preview_extension);
+}
+
 void IMAPSession::init()
 {
     mHostname = NULL;
@@ -381,6 +772,10 @@ void IMAPSession::init()
     mIdentityEnabled = false;
     mNamespaceEnabled = false;
     mCompressionEnabled = false;
+    mBinaryEnabled = false;
+    mPreviewEnabled = false;
+    mNotifyEnabled = false;
+    mNotifyMode = NOTIFY_MODE_NONE;
     mIsGmail = false;
     mAllowsNewPermanentFlags = false;
     mWelcomeString = NULL;
@@ -400,6 +795,19 @@ void IMAPSession::init()
     mQipServer = false;
     mLastFetchedSequenceNumber = 0;
     mCurrentFolder = NULL;
+    mCachedFolderStatuses = new HashMap();
+    mNotifyBuffer = new IMAPResponseBuffer();
+    mNotifyOutput = new Data();
+    mNotifyTransport = NOTIFY_TRANSPORT_STREAM;
+    mNotifyWaitsForWritability = false;
+    mNotifySocketFlags = 0;
+    mNotifySSL = NULL;
+    mSelectChanges = NULL;
+    mSelectChangesModSequenceValue = 0;
+    pthread_mutex_init(&mSelectionLock, NULL);
+    mSelectedFolder = NULL;
+    mSelectsCount = 0;
+    mSelectsAvoidedCount = 0;
     pthread_mutex_init(&mIdleLock, NULL);
     mState = STATE_DISCONNECTED;
     mImap = NULL;
@@ -407,6 +815,17 @@ void IMAPSession::init()
     mProgressItemsCount = 0;
     mConnectionLogger = NULL;
     pthread_mutex_init(&mConnectionLoggerLock, NULL);
+    mOperationTiming = NULL;
+    mConnectionMetrics = NULL;
+    mBodyCache = NULL;
+    mOperationCancelled = false;
+    mCancellationTime = 0;
+    mLastCancellationDelay = 0;
+    resetMetricsState();
+    mFetchWindowSize = FETCH_WINDOW_DEFAULT_SIZE;
+    mLastFetchCompletedUids = NULL;
+    mLastFetchCompletedMessages = NULL;
+    mMaximumPipelinedCommands = 1;
     mAutomaticConfigurationEnabled = true;
     mAutomaticConfigurationDone = false;
     mShouldDisconnect = false;
@@ -418,10 +837,14 @@ void IMAPSession::init()
 IMAPSession::IMAPSession()
 {
     init();
+    pthread_once(&previewExtensionOnce, registerPreviewExtension);
 }
 
 IMAPSession::~IMAPSession()
 {
+    MC_SAFE_RELEASE(mBodyCache);
+    MC_SAFE_RELEASE(mConnectionMetrics);
+    MC_SAFE_RELEASE(mOperationTiming);
     MC_SAFE_RELEASE(mUnparsedResponseData);
     MC_SAFE_RELEASE(mGmailUserDisplayName);
     MC_SAFE_RELEASE(mLoginResponse);
@@ -434,6 +857,14 @@ IMAPSession::~IMAPSession()
     MC_SAFE_RELEASE(mWelcomeString);
     MC_SAFE_RELEASE(mDefaultNamespace);
     MC_SAFE_RELEASE(mCurrentFolder);
+    MC_SAFE_RELEASE(mSelectedFolder);
+    MC_SAFE_RELEASE(mLastFetchCompletedMessages);
+    MC_SAFE_RELEASE(mLastFetchCompletedUids);
+    MC_SAFE_RELEASE(mSelectChanges);
+    MC_SAFE_RELEASE(mCachedFolderStatuses);
+    MC_SAFE_RELEASE(mNotifyOutput);
+    MC_SAFE_RELEASE(mNotifyBuffer);
+    pthread_mutex_destroy(&mSelectionLock);
     pthread_mutex_destroy(&mIdleLock);
     pthread_mutex_destroy(&mConnectionLoggerLock);
 }
@@ -538,6 +969,36 @@ bool IMAPSession::isVoIPEnabled()
     return mVoIPEnabled;
 }
 
+void IMAPSession::setFetchWindowSize(unsigned int windowSize)
+{
+    mFetchWindowSize = windowSize;
+}
+
+unsigned int IMAPSession::fetchWindowSize()
+{
+    return mFetchWindowSize;
+}
+
+IndexSet * IMAPSession::lastFetchCompletedUids()
+{
+    return mLastFetchCompletedUids;
+}
+
+Array * IMAPSession::lastFetchCompletedMessages()
+{
+    return mLastFetchCompletedMessages;
+}
+
+void IMAPSession::setMaximumPipelinedCommands(unsigned int maximumPipelinedCommands)
+{
+    mMaximumPipelinedCommands = maximumPipelinedCommands;
+}
+
+unsigned int IMAPSession::maximumPipelinedCommands()
+{
+    return mMaximumPipelinedCommands;
+}
+
 String * IMAPSession::loginResponse()
 {
     return mLoginResponse;
@@ -580,8 +1041,23 @@ void IMAPSession::items_progress(size_t current, size_t maximum, void * context)
 static void logger(mailimap * imap, int log_type, const char * buffer, size_t size, void * context)
 {
     IMAPSession * session = (IMAPSession *) context;
+    
+    OperationTiming * timing = session->operationTiming();
+    if (timing != NULL) {
+        if (log_type == MAILSTREAM_LOG_TYPE_DATA_RECEIVED) {
+            timing->addBytesReceived(size);
+        }
+        else if ((log_type == MAILSTREAM_LOG_TYPE_DATA_SENT) || (log_type == MAILSTREAM_LOG_TYPE_DATA_SENT_PRIVATE)) {
+            timing->addBytesSent(size);
+        }
+    }
+    
     session->lockConnectionLogger();
 
+    if (session->connectionMetricsNoLock() != NULL) {
+        session->recordMetrics(imap, log_type, buffer, size);
+    }
+    
     if (session->connectionLoggerNoLock() == NULL) {
         session->unlockConnectionLogger();
         return;
@@ -607,65 +1083,377 @@ static void logger(mailimap * imap, int log_type, const char * buffer, size_t si
     session->unlockConnectionLogger();
 }
 
-void IMAPSession::setup()
+// Tags of the commands written outside of libetpan are formatted and matched like libetpan does:
+// they're prefixed with C when the 163.com workaround is enabled.
+static void formatTag(mailimap * imap, int tag, char * buffer, size_t size)
 {
-    MCAssert(mImap == NULL);
-    
-    mImap = mailimap_new(0, NULL);
-    mailimap_set_timeout(mImap, timeout());
-    mailimap_set_progress_callback(mImap, body_progress, IMAPSession::items_progress, this);
-    mailimap_set_logger(mImap, logger, this);
+#ifdef LIBETPAN_HAS_MAILIMAP_163_WORKAROUND
+    if (mailimap_is_163_workaround_enabled(imap)) {
+        snprintf(buffer, size, "C%i", tag);
+        return;
+    }
+#endif
+    snprintf(buffer, size, "%i", tag);
 }
 
-void IMAPSession::unsetup()
+// Returns the tag of a tagged response line and sets pCondition to the text following the tag.
+// Returns -1 for untagged responses and continuation requests.
+static int tagOfResponseLine(mailimap * imap, const char * line, const char ** pCondition)
 {
-    mailimap * imap;
-    
-    LOCK();
-    imap = mImap;
-    mImap = NULL;
-    mIdleEnabled = false;
-    UNLOCK();
-    
-    if (imap != NULL) {
-        if (imap->imap_stream != NULL) {
-            mailstream_close(imap->imap_stream);
-            imap->imap_stream = NULL;
+    const char * p = line;
+#ifdef LIBETPAN_HAS_MAILIMAP_163_WORKAROUND
+    if (mailimap_is_163_workaround_enabled(imap)) {
+        if (* p != 'C') {
+            return -1;
         }
-        mailimap_free(imap);
-        imap = NULL;
+        p ++;
     }
-    
-    mState = STATE_DISCONNECTED;
+#endif
+    if ((* p < '0') || (* p > '9')) {
+        return -1;
+    }
+    int tag = 0;
+    while ((* p >= '0') && (* p <= '9')) {
+        tag = tag * 10 + (* p - '0');
+        p ++;
+    }
+    if (* p != ' ') {
+        return -1;
+    }
+    if (pCondition != NULL) {
+        * pCondition = p + 1;
+    }
+    return tag;
 }
 
-void IMAPSession::connect(ErrorCode * pError)
+// Returns true if the line is the completion of the given tag. pSucceeded is set if it's OK.
+static bool isCompletionOfTag(mailimap * imap, const char * line, int tag, bool * pSucceeded)
 {
-    int r;
-    
-    setup();
+    const char * condition;
+    if (tagOfResponseLine(imap, line, &condition) != tag) {
+        return false;
+    }
+    if (pSucceeded != NULL) {
+        * pSucceeded = (strncasecmp(condition, "OK", 2) == 0);
+    }
+    return true;
+}
 
-    MCLog("connect %s", MCUTF8DESC(this));
+void IMAPSession::recordMetrics(mailimap * imap, int logType, const char * buffer, size_t size)
+{
+    switch (logType) {
+        case MAILSTREAM_LOG_TYPE_DATA_RECEIVED:
+            mConnectionMetrics->addBytesReceived(size);
+            metricsDataReceived(buffer, size);
+            break;
+        case MAILSTREAM_LOG_TYPE_DATA_SENT:
+        case MAILSTREAM_LOG_TYPE_DATA_SENT_PRIVATE:
+            mConnectionMetrics->addBytesSent(size);
+            metricsCommandSent(imap, buffer, size);
+            break;
+    }
+}
 
-    MCAssert(mState == STATE_DISCONNECTED);
+void IMAPSession::resetMetricsState()
+{
+    mMetricsAtLineStart = true;
+    mMetricsReceivedTagLength = 0;
+    mMetricsLineTailLength = 0;
+    mMetricsLiteralRemaining = 0;
+    mMetricsLastSentTag = 0;
+    mMetricsTLSConnectTime = 0;
+    mMetricsPendingCount = 0;
+}
 
-    if (mHostname == NULL) {
-        * pError = ErrorConnection;
-        goto close;
+// Returns the length of the name of the command: UID FETCH, UID STORE, etc. are counted separately.
+static size_t commandNameLength(const char * command, size_t size)
+{
+    size_t i = 0;
+    while ((i < size) && (command[i] != ' ') && (command[i] != '\r') && (command[i] != '\n')) {
+        i ++;
     }
-
-    switch (mConnectionType) {
-        case ConnectionTypeStartTLS:
-        MCLog("STARTTLS connect");
-        r = mailimap_socket_connect_voip(mImap, MCUTF8(mHostname), mPort, isVoIPEnabled());
-        if (hasError(r)) {
-            * pError = ErrorConnection;
-            goto close;
+    if ((i == 3) && (strncasecmp(command, "UID", 3) == 0) && (i < size) && (command[i] == ' ')) {
+        i ++;
+        while ((i < size) && (command[i] != ' ') && (command[i] != '\r') && (command[i] != '\n')) {
+            i ++;
         }
+    }
+    return i;
+}
 
-        r = mailimap_socket_starttls(mImap);
-        if (hasError(r)) {
-            MCLog("no TLS %i", r);
+// Commands written by libetpan start with the tag that it has just generated, followed by the command.
+// The commands written by writeTaggedCommand() have already been counted.
+void IMAPSession::metricsCommandSent(mailimap * imap, const char * buffer, size_t size)
+{
+    size_t i = 0;
+#ifdef LIBETPAN_HAS_MAILIMAP_163_WORKAROUND
+    if (mailimap_is_163_workaround_enabled(imap)) {
+        if ((size == 0) || (buffer[0] != 'C')) {
+            return;
+        }
+        i ++;
+    }
+#endif
+    size_t digitsStart = i;
+    int tag = 0;
+    while ((i < size) && (buffer[i] >= '0') && (buffer[i] <= '9')) {
+        tag = tag * 10 + (buffer[i] - '0');
+        i ++;
+    }
+    // Literal data, IDLE DONE or authentication continuation.
+    if ((i == digitsStart) || (i >= size) || (buffer[i] != ' ') || (tag != imap->imap_tag) || (tag <= mMetricsLastSentTag)) {
+        return;
+    }
+    mMetricsLastSentTag = tag;
+    char tagString[16];
+    formatTag(imap, tag, tagString, sizeof(tagString));
+    metricsCommandStarted(tagString, buffer + i + 1, size - i - 1);
+}
+
+void IMAPSession::metricsCommandStarted(const char * tag, const char * command, size_t size)
+{
+    size_t nameLength = commandNameLength(command, size);
+    if ((nameLength == 0) || (strlen(tag) >= sizeof(mMetricsPendingTags[0]))) {
+        return;
+    }
+    
+    int commandIndex = mConnectionMetrics->addCommand(command, nameLength);
+    if (mMetricsPendingCount == sizeof(mMetricsPendingTags) / sizeof(mMetricsPendingTags[0])) {
+        // The oldest command didn't get a response. Forget about it.
+        memmove(&mMetricsPendingTags[0], &mMetricsPendingTags[1], sizeof(mMetricsPendingTags[0]) * (mMetricsPendingCount - 1));
+        memmove(&mMetricsPendingCommands[0], &mMetricsPendingCommands[1], sizeof(mMetricsPendingCommands[0]) * (mMetricsPendingCount - 1));
+        memmove(&mMetricsPendingTimes[0], &mMetricsPendingTimes[1], sizeof(mMetricsPendingTimes[0]) * (mMetricsPendingCount - 1));
+        mMetricsPendingCount --;
+    }
+    strcpy(mMetricsPendingTags[mMetricsPendingCount], tag);
+    mMetricsPendingCommands[mMetricsPendingCount] = commandIndex;
+    mMetricsPendingTimes[mMetricsPendingCount] = OperationTiming::currentTime();
+    mMetricsPendingCount ++;
+}
+
+// Returns true if the line ends with a literal: {size} followed by CR.
+static bool literalSizeAtEndOfLine(const char * tail, unsigned int length, uint64_t * pSize)
+{
+    if ((length < 4) || (tail[length - 1] != '\r') || (tail[length - 2] != '}')) {
+        return false;
+    }
+    int i = (int) length - 3;
+    // LITERAL+ syntax.
+    if (tail[i] == '+') {
+        i --;
+    }
+    int digitsEnd = i;
+    while ((i >= 0) && (tail[i] >= '0') && (tail[i] <= '9')) {
+        i --;
+    }
+    if ((i < 0) || (i == digitsEnd) || (tail[i] != '{')) {
+        return false;
+    }
+    uint64_t size = 0;
+    for(int k = i + 1 ; k <= digitsEnd ; k ++) {
+        size = size * 10 + (tail[k] - '0');
+    }
+    * pSize = size;
+    return true;
+}
+
+void IMAPSession::metricsLineEnded()
+{
+    uint64_t literalSize;
+    if (literalSizeAtEndOfLine(mMetricsLineTail, mMetricsLineTailLength, &literalSize)) {
+        // The response continues after the literal.
+        mMetricsLiteralRemaining = literalSize;
+    }
+    else {
+        mMetricsAtLineStart = true;
+        mMetricsReceivedTagLength = 0;
+    }
+    mMetricsLineTailLength = 0;
+}
+
+// Looks for tagged responses at the beginning of each line. Literals are skipped since their content might look
+// like a tagged response. A line might be split across buffers.
+void IMAPSession::metricsDataReceived(const char * buffer, size_t size)
+{
+    if (mMetricsTLSConnectTime != 0) {
+        // The greeting is received once the TLS handshake is done.
+        mConnectionMetrics->addTLSHandshakeDuration(OperationTiming::currentTime() - mMetricsTLSConnectTime);
+        mMetricsTLSConnectTime = 0;
+    }
+    
+    size_t i = 0;
+    while (i < size) {
+        if (mMetricsLiteralRemaining > 0) {
+            size_t skipped = size - i;
+            if (skipped > mMetricsLiteralRemaining) {
+                skipped = (size_t) mMetricsLiteralRemaining;
+            }
+            i += skipped;
+            mMetricsLiteralRemaining -= skipped;
+            continue;
+        }
+        
+        if (!mMetricsAtLineStart) {
+            const char * endOfLine = (const char *) memchr(buffer + i, '\n', size - i);
+            size_t lineEnd = (endOfLine == NULL) ? size : endOfLine - buffer;
+            // Only the end of the line is needed.
+            size_t tailStart = i;
+            if (lineEnd - tailStart > sizeof(mMetricsLineTail)) {
+                tailStart = lineEnd - sizeof(mMetricsLineTail);
+            }
+            size_t tailLength = lineEnd - tailStart;
+            if (mMetricsLineTailLength + tailLength > sizeof(mMetricsLineTail)) {
+                unsigned int kept = (unsigned int) (sizeof(mMetricsLineTail) - tailLength);
+                memmove(mMetricsLineTail, mMetricsLineTail + mMetricsLineTailLength - kept, kept);
+                mMetricsLineTailLength = kept;
+            }
+            memcpy(mMetricsLineTail + mMetricsLineTailLength, buffer + tailStart, tailLength);
+            mMetricsLineTailLength += (unsigned int) tailLength;
+            if (endOfLine == NULL) {
+                return;
+            }
+            i = lineEnd + 1;
+            metricsLineEnded();
+            continue;
+        }
+        
+        char ch = buffer[i];
+        // Tags are made of letters and digits. Untagged responses and continuation requests start with * and +.
+        if (((ch >= '0') && (ch <= '9')) || ((ch >= 'A') && (ch <= 'Z')) || ((ch >= 'a') && (ch <= 'z'))) {
+            if (mMetricsReceivedTagLength + 1 < sizeof(mMetricsReceivedTag)) {
+                mMetricsReceivedTag[mMetricsReceivedTagLength] = ch;
+            }
+            mMetricsReceivedTagLength ++;
+            i ++;
+            continue;
+        }
+        
+        if ((ch == ' ') && (mMetricsReceivedTagLength > 0) && (mMetricsReceivedTagLength < sizeof(mMetricsReceivedTag))) {
+            mMetricsReceivedTag[mMetricsReceivedTagLength] = 0;
+            for(unsigned int k = 0 ; k < mMetricsPendingCount ; k ++) {
+                if (strcmp(mMetricsPendingTags[k], mMetricsReceivedTag) != 0) {
+                    continue;
+                }
+                mConnectionMetrics->addRoundTripDuration(mMetricsPendingCommands[k], OperationTiming::currentTime() - mMetricsPendingTimes[k]);
+                memmove(&mMetricsPendingTags[k], &mMetricsPendingTags[k + 1], sizeof(mMetricsPendingTags[0]) * (mMetricsPendingCount - k - 1));
+                memmove(&mMetricsPendingCommands[k], &mMetricsPendingCommands[k + 1], sizeof(mMetricsPendingCommands[0]) * (mMetricsPendingCount - k - 1));
+                memmove(&mMetricsPendingTimes[k], &mMetricsPendingTimes[k + 1], sizeof(mMetricsPendingTimes[0]) * (mMetricsPendingCount - k - 1));
+                mMetricsPendingCount --;
+                break;
+            }
+        }
+        mMetricsAtLineStart = false;
+    }
+}
+
+#if NOTIFY_USES_OPENSSL
+// The TLS connection is kept when the handshake is done so that it can be used without blocking by NOTIFY.
+static void notifySSLInfoCallback(const SSL * ssl, int where, int ret)
+{
+    if ((where & SSL_CB_HANDSHAKE_DONE) == 0) {
+        return;
+    }
+    void ** pSSL = (void **) SSL_CTX_get_app_data(SSL_get_SSL_CTX(ssl));
+    if (pSSL != NULL) {
+        * pSSL = (void *) ssl;
+    }
+}
+
+static void notifySSLContextCallback(struct mailstream_ssl_context * sslContext, void * data)
+{
+    SSL_CTX * ctx = (SSL_CTX *) mailstream_ssl_get_openssl_ssl_ctx(sslContext);
+    // NULL when libetpan uses GnuTLS: the connection is then read through libetpan.
+    if (ctx == NULL) {
+        return;
+    }
+    SSL_CTX_set_app_data(ctx, data);
+    SSL_CTX_set_info_callback(ctx, notifySSLInfoCallback);
+}
+#endif
+
+void IMAPSession::setup()
+{
+    MCAssert(mImap == NULL);
+    
+    resetMetricsState();
+    
+    mailimap * imap = mailimap_new(0, NULL);
+    mailimap_set_timeout(imap, timeout());
+    mailimap_set_progress_callback(imap, body_progress, IMAPSession::items_progress, this);
+    mailimap_set_logger(imap, logger, this);
+    
+    // cancelCurrentOperation() reads it from another thread.
+    LOCK();
+    mImap = imap;
+    UNLOCK();
+}
+
+void IMAPSession::unsetup()
+{
+    mailimap * imap;
+    
+    LOCK();
+    imap = mImap;
+    mImap = NULL;
+    mIdleEnabled = false;
+    UNLOCK();
+    mNotifyMode = NOTIFY_MODE_NONE;
+    mNotifyTransport = NOTIFY_TRANSPORT_STREAM;
+    mNotifyWaitsForWritability = false;
+    MC_SAFE_RELEASE(mNotifyOutput);
+    mNotifyOutput = new Data();
+    mNotifySSL = NULL;
+    
+    if (imap != NULL) {
+        if (imap->imap_stream != NULL) {
+            mailstream_close(imap->imap_stream);
+            imap->imap_stream = NULL;
+        }
+        mailimap_free(imap);
+        imap = NULL;
+    }
+    
+    mState = STATE_DISCONNECTED;
+    setSelectedFolder(NULL);
+}
+
+void IMAPSession::connect(ErrorCode * pError)
+{
+    int r;
+    
+    setup();
+
+    MCLog("connect %s", MCUTF8DESC(this));
+
+    MCAssert(mState == STATE_DISCONNECTED);
+
+    if (mHostname == NULL) {
+        * pError = ErrorConnection;
+        goto close;
+    }
+
+    switch (mConnectionType) {
+        case ConnectionTypeStartTLS:
+        MCLog("STARTTLS connect");
+        r = mailimap_socket_connect_voip(mImap, MCUTF8(mHostname), mPort, isVoIPEnabled());
+        if (hasError(r)) {
+            * pError = ErrorConnection;
+            goto close;
+        }
+
+        {
+            double startTime = (mConnectionMetrics != NULL) ? OperationTiming::currentTime() : 0;
+#if NOTIFY_USES_OPENSSL
+            r = mailimap_socket_starttls_with_callback(mImap, notifySSLContextCallback, &mNotifySSL);
+#else
+            r = mailimap_socket_starttls(mImap);
+#endif
+            if ((mConnectionMetrics != NULL) && !hasError(r)) {
+                mConnectionMetrics->addTLSHandshakeDuration(OperationTiming::currentTime() - startTime);
+            }
+        }
+        if (hasError(r)) {
+            MCLog("no TLS %i", r);
             * pError = ErrorTLSNotAvailable;
             goto close;
         }
@@ -678,7 +1466,17 @@ void IMAPSession::connect(ErrorCode * pError)
         break;
 
         case ConnectionTypeTLS:
+        if (mConnectionMetrics != NULL) {
+            // Includes the TCP connection.
+            mMetricsTLSConnectTime = OperationTiming::currentTime();
+        }
+#if NOTIFY_USES_OPENSSL
+        r = mailimap_ssl_connect_voip_with_callback(mImap, MCUTF8(mHostname), mPort, isVoIPEnabled(),
+                                                    notifySSLContextCallback, &mNotifySSL);
+#else
         r = mailimap_ssl_connect_voip(mImap, MCUTF8(mHostname), mPort, isVoIPEnabled());
+#endif
+        mMetricsTLSConnectTime = 0;
         MCLog("TLS ssl connect %s %u %u", MCUTF8(mHostname), mPort, r);
         if (hasError(r)) {
             MCLog("connect error %i", r);
@@ -764,7 +1562,11 @@ void IMAPSession::connectIfNeeded(ErrorCode * pError)
     }
     
     if (mState == STATE_DISCONNECTED) {
+        double startTime = (mOperationTiming != NULL) ? OperationTiming::currentTime() : 0;
         connect(pError);
+        if (mOperationTiming != NULL) {
+            mOperationTiming->addPhaseDuration(OperationTimingPhaseConnect, OperationTiming::currentTime() - startTime);
+        }
     }
     else {
         * pError = ErrorNone;
@@ -778,7 +1580,11 @@ void IMAPSession::loginIfNeeded(ErrorCode * pError)
         return;
     
     if (mState == STATE_CONNECTED) {
+        double startTime = (mOperationTiming != NULL) ? OperationTiming::currentTime() : 0;
         login(pError);
+        if (mOperationTiming != NULL) {
+            mOperationTiming->addPhaseDuration(OperationTimingPhaseLogin, OperationTiming::currentTime() - startTime);
+        }
     }
     else {
         * pError = ErrorNone;
@@ -1071,18 +1877,104 @@ void IMAPSession::selectIfNeeded(String * folder, ErrorCode * pError)
     if (* pError != ErrorNone)
         return;
     
+    bool needsSelect = false;
     if (mState == STATE_SELECTED) {
         MCAssert(mCurrentFolder != NULL);
-        if (mCurrentFolder->caseInsensitiveCompare(folder) != 0) {
-            select(folder, pError);
-        }
+        needsSelect = (mCurrentFolder->caseInsensitiveCompare(folder) != 0);
     }
     else if (mState == STATE_LOGGEDIN) {
+        needsSelect = true;
+    }
+    
+    if (needsSelect) {
+        double startTime = (mOperationTiming != NULL) ? OperationTiming::currentTime() : 0;
         select(folder, pError);
+        if (mOperationTiming != NULL) {
+            mOperationTiming->addPhaseDuration(OperationTimingPhaseSelect, OperationTiming::currentTime() - startTime);
+        }
     }
     else {
+        selectAvoided();
+        * pError = ErrorNone;
+    }
+}
+
+// Folder management commands don't need a selected folder. The folder is only left when it's the one
+// that is renamed or deleted.
+void IMAPSession::leaveFolderIfNeeded(String * folder, ErrorCode * pError)
+{
+    loginIfNeeded(pError);
+    if (* pError != ErrorNone)
+        return;
+    
+    if ((folder != NULL) && (mState == STATE_SELECTED) && (mCurrentFolder->caseInsensitiveCompare(folder) == 0)) {
+        unselect(pError);
+        return;
+    }
+    * pError = ErrorNone;
+}
+
+void IMAPSession::unselect(ErrorCode * pError)
+{
+    loginIfNeeded(pError);
+    if (* pError != ErrorNone)
+        return;
+    
+    if (mState != STATE_SELECTED) {
+        * pError = ErrorNone;
+        return;
+    }
+    
+    if (!mailimap_has_extension(mImap, (char *) "UNSELECT")) {
+        // CLOSE would expunge the messages: another folder is selected instead.
+        if (mCurrentFolder->caseInsensitiveCompare(MCSTR("INBOX")) != 0) {
+            selectIfNeeded(MCSTR("INBOX"), pError);
+            return;
+        }
+        // INBOX can't be deleted and renaming it leaves an empty INBOX: it can stay selected.
         * pError = ErrorNone;
+        return;
+    }
+    
+    // libetpan doesn't know about UNSELECT.
+    int r = writeTaggedCommand(MCSTR("UNSELECT"));
+    if ((r == MAILIMAP_NO_ERROR) && (mailstream_write(mImap->imap_stream, "\r\n", 2) == -1)) {
+        r = MAILIMAP_ERROR_STREAM;
+    }
+    if ((r == MAILIMAP_NO_ERROR) && (mailstream_flush(mImap->imap_stream) == -1)) {
+        r = MAILIMAP_ERROR_STREAM;
+    }
+    bool succeeded = false;
+    while (r == MAILIMAP_NO_ERROR) {
+        Data * lineData = readResponseLineWithLiterals();
+        if (lineData == NULL) {
+            r = MAILIMAP_ERROR_STREAM;
+            break;
+        }
+        const char * line = lineData->bytes();
+        if (isCompletionOfTag(mImap, line, mImap->imap_tag, &succeeded)) {
+            break;
+        }
+        if (strncasecmp(line, "* BYE", 5) == 0) {
+            r = MAILIMAP_ERROR_STREAM;
+            break;
+        }
+        handleUntaggedResponseLine(line);
     }
+    if (r != MAILIMAP_NO_ERROR) {
+        mShouldDisconnect = true;
+        * pError = ErrorConnection;
+        return;
+    }
+    if (!succeeded) {
+        selectIfNeeded(MCSTR("INBOX"), pError);
+        return;
+    }
+    
+    mState = STATE_LOGGEDIN;
+    MC_SAFE_RELEASE(mCurrentFolder);
+    setSelectedFolder(NULL);
+    * pError = ErrorNone;
 }
 
 static uint64_t get_mod_sequence_value(mailimap * session)
@@ -1152,7 +2044,24 @@ void IMAPSession::select(String * folder, ErrorCode * pError)
     MCLog("select");
     MCAssert(mState == STATE_LOGGEDIN || mState == STATE_SELECTED);
 
-    r = mailimap_select(mImap, MCUTF8(folder));
+    pthread_mutex_lock(&mSelectionLock);
+    mSelectsCount ++;
+    pthread_mutex_unlock(&mSelectionLock);
+    MC_SAFE_RELEASE(mSelectChanges);
+    mSelectChangesModSequenceValue = 0;
+    IMAPFolderStatus * knownStatus = NULL;
+    if (mQResyncEnabled) {
+        knownStatus = (IMAPFolderStatus *) mCachedFolderStatuses->objectForKey(folder);
+        if ((knownStatus != NULL) && ((knownStatus->uidValidity() == 0) || (knownStatus->highestModSeqValue() == 0))) {
+            knownStatus = NULL;
+        }
+    }
+    if (knownStatus != NULL) {
+        r = selectWithKnownStatus(folder, knownStatus);
+    }
+    else {
+        r = mailimap_select(mImap, MCUTF8(folder));
+    }
     MCLog("select error : %i", r);
     if (r == MAILIMAP_ERROR_STREAM) {
         mShouldDisconnect = true;
@@ -1169,10 +2078,12 @@ void IMAPSession::select(String * folder, ErrorCode * pError)
         * pError = ErrorNonExistantFolder;
         mState = STATE_LOGGEDIN;
         MC_SAFE_RELEASE(mCurrentFolder);
+        setSelectedFolder(NULL);
         return;
     }
 
     MC_SAFE_REPLACE_COPY(String, mCurrentFolder, folder);
+    setSelectedFolder(folder);
 
     if (mImap->imap_selection_info != NULL) {
         mUIDValidity = mImap->imap_selection_info->sel_uidvalidity;
@@ -1204,6 +2115,14 @@ void IMAPSession::select(String * folder, ErrorCode * pError)
         }
       
         mModSequenceValue = get_mod_sequence_value(mImap);
+        
+        IMAPFolderStatus * status = new IMAPFolderStatus();
+        status->setUidValidity(mUIDValidity);
+        status->setUidNext(mUIDNext);
+        status->setHighestModSeqValue(mModSequenceValue);
+        status->setMessageCount(mFolderMsgCount);
+        mCachedFolderStatuses->setObjectForKey(folder, status);
+        status->release();
     }
 
     mState = STATE_SELECTED;
@@ -1215,6 +2134,41 @@ void IMAPSession::select(String * folder, ErrorCode * pError)
 
 
 
+static void setFolderStatusWithStatusData(IMAPFolderStatus * fs, struct mailimap_mailbox_data_status * status)
+{
+    for(clistiter * cur = clist_begin(status->st_info_list) ; cur != NULL ; cur = clist_next(cur)) {
+        struct mailimap_status_info * status_info;
+        
+        status_info = (struct mailimap_status_info *) clist_content(cur);
+        
+        switch (status_info->st_att) {
+            case MAILIMAP_STATUS_ATT_UNSEEN:
+                fs->setUnseenCount(status_info->st_value);
+                break;
+            case MAILIMAP_STATUS_ATT_MESSAGES:
+                fs->setMessageCount(status_info->st_value);
+                break;
+            case MAILIMAP_STATUS_ATT_RECENT:
+                fs->setRecentCount(status_info->st_value);
+                break;
+            case MAILIMAP_STATUS_ATT_UIDNEXT:
+                fs->setUidNext(status_info->st_value);
+                break;
+            case MAILIMAP_STATUS_ATT_UIDVALIDITY:
+                fs->setUidValidity(status_info->st_value);
+                break;
+            case MAILIMAP_STATUS_ATT_EXTENSION: {
+                struct mailimap_extension_data * ext_data = status_info->st_ext_data;
+                if (ext_data->ext_extension == &mailimap_extension_condstore) {
+                    struct mailimap_condstore_status_info * condstore_info = (struct mailimap_condstore_status_info *) ext_data->ext_data;
+                    fs->setHighestModSeqValue(condstore_info->cs_highestmodseq_value);
+                }
+                break;
+            }
+        }
+    }
+}
+
 IMAPFolderStatus * IMAPSession::folderStatus(String * folder, ErrorCode * pError)
 {
     int r;
@@ -1262,44 +2216,8 @@ IMAPFolderStatus * IMAPSession::folderStatus(String * folder, ErrorCode * pError
         return fs;
     }
     
-    clistiter * cur;
-    
-    
     if (status != NULL) {
-        
-            struct mailimap_status_info * status_info;
-            for(cur = clist_begin(status->st_info_list) ; cur != NULL ;
-                cur = clist_next(cur)) {                
-                
-                status_info = (struct mailimap_status_info *) clist_content(cur);
-                                
-                switch (status_info->st_att) {
-                    case MAILIMAP_STATUS_ATT_UNSEEN:
-                        fs->setUnseenCount(status_info->st_value);
-                        break;
-                    case MAILIMAP_STATUS_ATT_MESSAGES:
-                        fs->setMessageCount(status_info->st_value);
-                        break;
-                    case MAILIMAP_STATUS_ATT_RECENT:
-                        fs->setRecentCount(status_info->st_value);
-                        break;
-                    case MAILIMAP_STATUS_ATT_UIDNEXT:
-                        fs->setUidNext(status_info->st_value);
-                        break;                        
-                    case MAILIMAP_STATUS_ATT_UIDVALIDITY:
-                        fs->setUidValidity(status_info->st_value);
-                        break;
-                    case MAILIMAP_STATUS_ATT_EXTENSION: {
-                        struct mailimap_extension_data * ext_data = status_info->st_ext_data;
-                        if (ext_data->ext_extension == &mailimap_extension_condstore) {
-                            struct mailimap_condstore_status_info * status_info = (struct mailimap_condstore_status_info *) ext_data->ext_data;
-                            fs->setHighestModSeqValue(status_info->cs_highestmodseq_value);
-                        }
-                        break;
-                    }
-                }
-            }            
-
+        setFolderStatusWithStatusData(fs, status);
         mailimap_mailbox_data_status_free(status);
     }
 
@@ -1519,11 +2437,9 @@ Array * /* IMAPFolder */ IMAPSession::fetchSubscribedFolders(ErrorCode * pError)
     return result;
 }
 
-Array * /* IMAPFolder */ IMAPSession::fetchAllFolders(ErrorCode * pError)
+// Returns the reference used to list all the folders.
+String * IMAPSession::allFoldersPrefix(ErrorCode * pError)
 {
-    int r;
-    clist * imap_folders;
-    
     loginIfNeeded(pError);
     if (* pError != ErrorNone)
         return NULL;
@@ -1551,6 +2467,17 @@ Array * /* IMAPFolder */ IMAPSession::fetchAllFolders(ErrorCode * pError)
             prefix = prefix->stringByAppendingUTF8Format("%c", mDelimiter);
         }
     }
+    return prefix;
+}
+
+Array * /* IMAPFolder */ IMAPSession::fetchAllFolders(ErrorCode * pError)
+{
+    int r;
+    clist * imap_folders;
+    
+    String * prefix = allFoldersPrefix(pError);
+    if (* pError != ErrorNone)
+        return NULL;
     
     if (mXListEnabled) {
         r = mailimap_xlist(mImap, MCUTF8(prefix), "*", &imap_folders);
@@ -1594,29 +2521,447 @@ Array * /* IMAPFolder */ IMAPSession::fetchAllFolders(ErrorCode * pError)
     return result;
 }
 
-void IMAPSession::renameFolder(String * folder, String * otherName, ErrorCode * pError)
+#pragma mark folders with status
+
+// Reads a response line. Literals are replaced by quoted strings so that the line can be parsed as a whole.
+// The result is NUL-terminated and doesn't include the end of line.
+Data * IMAPSession::readResponseLineWithLiterals()
 {
-    int r;
-    
-    selectIfNeeded(MCSTR("INBOX"), pError);
-    if (* pError != ErrorNone)
-        return;
-    
-    r = mailimap_rename(mImap, MCUTF8(folder), MCUTF8(otherName));
-    if (r == MAILIMAP_ERROR_STREAM) {
-        mShouldDisconnect = true;
-        * pError = ErrorConnection;
-        return;
-    }
-    else if (r == MAILIMAP_ERROR_PARSE) {
-        mShouldDisconnect = true;
-        * pError = ErrorParse;
-        return;
-    }
-    else if (hasError(r)) {
-        * pError = ErrorRename;
-        return;
+    Data * result = Data::data();
+    while (1) {
+        char * line = mailimap_read_line(mImap);
+        if (line == NULL) {
+            return NULL;
+        }
+        size_t length = strlen(line);
+        while ((length > 0) && ((line[length - 1] == '\r') || (line[length - 1] == '\n'))) {
+            length --;
+        }
+        char * literal = NULL;
+        if ((length > 0) && (line[length - 1] == '}')) {
+            literal = line + length - 1;
+            while ((literal > line) && (* literal != '{')) {
+                literal --;
+            }
+            if (* literal != '{') {
+                literal = NULL;
+            }
+        }
+        if (literal == NULL) {
+            result->appendBytes(line, (unsigned int) length);
+            break;
+        }
+
+        size_t literalLength = strtoul(literal + 1, NULL, 10);
+        result->appendBytes(line, (unsigned int) (literal - line));
+        result->appendBytes("\"", 1);
+        while (literalLength > 0) {
+            char buffer[1024];
+            size_t chunkLength = literalLength;
+            if (chunkLength > sizeof(buffer)) {
+                chunkLength = sizeof(buffer);
+            }
+            ssize_t count = mailstream_read(mImap->imap_stream, buffer, chunkLength);
+            if (count <= 0) {
+                return NULL;
+            }
+            for(ssize_t i = 0 ; i < count ; i ++) {
+                if ((buffer[i] == '"') || (buffer[i] == '\\')) {
+                    result->appendBytes("\\", 1);
+                }
+                result->appendBytes(&buffer[i], 1);
+            }
+            literalLength -= count;
+        }
+        result->appendBytes("\"", 1);
+    }
+    result->appendBytes("", 1);
+    return result;
+}
+
+// Parses a quoted string, an atom or NIL. The result is NULL for NIL.
+static const char * parseListAString(const char * p, Data ** pValue)
+{
+    while (* p == ' ') {
+        p ++;
+    }
+    * pValue = NULL;
+    if (* p == '"') {
+        Data * value = Data::data();
+        p ++;
+        while ((* p != 0) && (* p != '"')) {
+            if ((* p == '\\') && (p[1] != 0)) {
+                p ++;
+            }
+            value->appendBytes(p, 1);
+            p ++;
+        }
+        if (* p == '"') {
+            p ++;
+        }
+        value->appendBytes("", 1);
+        * pValue = value;
+        return p;
+    }
+    const char * begin = p;
+    while ((* p != 0) && (* p != ' ') && (* p != '(') && (* p != ')')) {
+        p ++;
+    }
+    if ((p - begin == 3) && (strncasecmp(begin, "NIL", 3) == 0)) {
+        return p;
+    }
+    Data * value = Data::dataWithBytes(begin, (unsigned int) (p - begin));
+    value->appendBytes("", 1);
+    * pValue = value;
+    return p;
+}
+
+static String * folderPathWithName(Data * name)
+{
+    String * path = String::stringWithUTF8Characters(name->bytes());
+    if (path->uppercaseString()->isEqual(MCSTR("INBOX"))) {
+        return MCSTR("INBOX");
+    }
+    return path;
+}
+
+// * LIST (\HasNoChildren \Sent) "/" "Sent Messages"
+static IMAPFolder * folderWithListResponse(const char * line)
+{
+    const char * p = line + strlen("* LIST ");
+    if (* p != '(') {
+        return NULL;
+    }
+    p ++;
+    int flags = IMAPFolderFlagNone;
+    while ((* p != 0) && (* p != ')')) {
+        while (* p == ' ') {
+            p ++;
+        }
+        if (* p == '\\') {
+            p ++;
+        }
+        const char * flag = p;
+        while ((* p != 0) && (* p != ' ') && (* p != ')')) {
+            p ++;
+        }
+        size_t flagLength = p - flag;
+        if (flagLength == 0) {
+            continue;
+        }
+        if (((flagLength == 8) && (strncasecmp(flag, "Noselect", 8) == 0)) ||
+            ((flagLength == 11) && (strncasecmp(flag, "NonExistent", 11) == 0))) {
+            flags |= IMAPFolderFlagNoSelect;
+        }
+        else if ((flagLength == 11) && (strncasecmp(flag, "Noinferiors", 11) == 0)) {
+            flags |= IMAPFolderFlagNoInferiors;
+        }
+        else if ((flagLength == 6) && (strncasecmp(flag, "Marked", 6) == 0)) {
+            flags |= IMAPFolderFlagMarked;
+        }
+        else if ((flagLength == 8) && (strncasecmp(flag, "Unmarked", 8) == 0)) {
+            flags |= IMAPFolderFlagUnmarked;
+        }
+        else {
+            for(unsigned int i = 0 ; i < sizeof(mb_keyword_flag) / sizeof(mb_keyword_flag[0]) ; i ++) {
+                if ((strlen(mb_keyword_flag[i].name) == flagLength) &&
+                    (strncasecmp(mb_keyword_flag[i].name, flag, flagLength) == 0)) {
+                    flags |= mb_keyword_flag[i].flag;
+                }
+            }
+        }
+    }
+    if (* p != ')') {
+        return NULL;
+    }
+    p ++;
+
+    Data * delimiter;
+    p = parseListAString(p, &delimiter);
+    Data * name;
+    p = parseListAString(p, &name);
+    if (name == NULL) {
+        return NULL;
+    }
+
+    IMAPFolder * folder = new IMAPFolder();
+    folder->setPath(folderPathWithName(name));
+    folder->setDelimiter((delimiter != NULL) ? delimiter->bytes()[0] : 0);
+    folder->setFlags((IMAPFolderFlag) flags);
+    folder->autorelease();
+    return folder;
+}
+
+// * STATUS "INBOX" (MESSAGES 231 UNSEEN 3 UIDNEXT 44292)
+static void addFolderStatusWithStatusResponse(const char * line, HashMap * folderStatuses)
+{
+    Data * name;
+    const char * p = parseListAString(line + strlen("* STATUS "), &name);
+    if (name == NULL) {
+        return;
+    }
+    while (* p == ' ') {
+        p ++;
+    }
+    if (* p != '(') {
+        return;
+    }
+    p ++;
+
+    IMAPFolderStatus * fs = new IMAPFolderStatus();
+    while ((* p != 0) && (* p != ')')) {
+        while (* p == ' ') {
+            p ++;
+        }
+        const char * item = p;
+        while ((* p != 0) && (* p != ' ') && (* p != ')')) {
+            p ++;
+        }
+        size_t itemLength = p - item;
+        if (itemLength == 0) {
+            continue;
+        }
+        char * end;
+        unsigned long long value = strtoull(p, &end, 10);
+        p = end;
+        if ((itemLength == 8) && (strncasecmp(item, "MESSAGES", 8) == 0)) {
+            fs->setMessageCount((uint32_t) value);
+        }
+        else if ((itemLength == 6) && (strncasecmp(item, "UNSEEN", 6) == 0)) {
+            fs->setUnseenCount((uint32_t) value);
+        }
+        else if ((itemLength == 6) && (strncasecmp(item, "RECENT", 6) == 0)) {
+            fs->setRecentCount((uint32_t) value);
+        }
+        else if ((itemLength == 7) && (strncasecmp(item, "UIDNEXT", 7) == 0)) {
+            fs->setUidNext((uint32_t) value);
+        }
+        else if ((itemLength == 11) && (strncasecmp(item, "UIDVALIDITY", 11) == 0)) {
+            fs->setUidValidity((uint32_t) value);
+        }
+        else if ((itemLength == 13) && (strncasecmp(item, "HIGHESTMODSEQ", 13) == 0)) {
+            fs->setHighestModSeqValue(value);
+        }
+    }
+    folderStatuses->setObjectForKey(folderPathWithName(name), fs);
+    fs->release();
+}
+
+String * IMAPSession::folderStatusAttributes()
+{
+    if (mCondstoreEnabled || mXYMHighestModseqEnabled) {
+        return MCSTR("MESSAGES UNSEEN RECENT UIDNEXT UIDVALIDITY HIGHESTMODSEQ");
+    }
+    return MCSTR("MESSAGES UNSEEN RECENT UIDNEXT UIDVALIDITY");
+}
+
+// libetpan doesn't know about LIST-STATUS: the command is written and the response is read here.
+Array * IMAPSession::fetchAllFoldersWithListStatus(HashMap * folderStatuses, ErrorCode * pError)
+{
+    String * prefix = allFoldersPrefix(pError);
+    if (* pError != ErrorNone)
+        return NULL;
+
+    String * command = String::string();
+    command->appendUTF8Characters("LIST ");
+    if (!appendAStringToCommand(command, MCUTF8(prefix))) {
+        * pError = ErrorNonExistantFolder;
+        return NULL;
+    }
+    command->appendUTF8Characters(" * RETURN (");
+    if (mailimap_has_extension(mImap, (char *) "SPECIAL-USE")) {
+        command->appendUTF8Characters("SPECIAL-USE ");
+    }
+    command->appendUTF8Format("STATUS (%s))", MCUTF8(folderStatusAttributes()));
+
+    Array * result = Array::array();
+    int r = writeTaggedCommand(command);
+    if ((r == MAILIMAP_NO_ERROR) && (mailstream_write(mImap->imap_stream, "\r\n", 2) == -1)) {
+        r = MAILIMAP_ERROR_STREAM;
+    }
+    if ((r == MAILIMAP_NO_ERROR) && (mailstream_flush(mImap->imap_stream) == -1)) {
+        r = MAILIMAP_ERROR_STREAM;
+    }
+    bool completed = false;
+    while ((r == MAILIMAP_NO_ERROR) && !completed) {
+        Data * lineData = readResponseLineWithLiterals();
+        if (lineData == NULL) {
+            r = MAILIMAP_ERROR_STREAM;
+            break;
+        }
+        const char * line = lineData->bytes();
+        bool succeeded;
+        if (isCompletionOfTag(mImap, line, mImap->imap_tag, &succeeded)) {
+            if (!succeeded) {
+                r = MAILIMAP_ERROR_LIST;
+            }
+            completed = true;
+        }
+        else if (strncasecmp(line, "* LIST ", 7) == 0) {
+            IMAPFolder * folder = folderWithListResponse(line);
+            if (folder != NULL) {
+                result->addObject(folder);
+            }
+        }
+        else if (strncasecmp(line, "* STATUS ", 9) == 0) {
+            addFolderStatusWithStatusResponse(line, folderStatuses);
+        }
+        else if (strncasecmp(line, "* BYE", 5) == 0) {
+            r = MAILIMAP_ERROR_STREAM;
+        }
+        else {
+            handleUntaggedResponseLine(line);
+        }
+    }
+
+    if (r == MAILIMAP_ERROR_STREAM) {
+        mShouldDisconnect = true;
+        * pError = ErrorConnection;
+        return NULL;
+    }
+    else if (hasError(r)) {
+        * pError = ErrorNonExistantFolder;
+        return NULL;
+    }
+
+    bool hasInbox = false;
+    mc_foreacharray(IMAPFolder, folder, result) {
+        if (folder->path()->isEqual(MCSTR("INBOX"))) {
+            hasInbox = true;
+        }
+    }
+    if (!hasInbox) {
+        mc_foreacharray(IMAPFolder, inboxFolder, result) {
+            if (inboxFolder->flags() & IMAPFolderFlagInbox) {
+                // some mail providers use non-standart name for inbox folder
+                Object * status = folderStatuses->objectForKey(inboxFolder->path());
+                if (status != NULL) {
+                    folderStatuses->setObjectForKey(MCSTR("INBOX"), status);
+                    folderStatuses->removeObjectForKey(inboxFolder->path());
+                }
+                hasInbox = true;
+                inboxFolder->setPath(MCSTR("INBOX"));
+                break;
+            }
+        }
+    }
+    if (!hasInbox) {
+        clist * imap_folders;
+        r = mailimap_list(mImap, "", "INBOX", &imap_folders);
+        Array * inboxResult = resultsWithError(r, imap_folders, pError);
+        if (* pError == ErrorConnection || * pError == ErrorParse)
+            mShouldDisconnect = true;
+        if (* pError != ErrorNone)
+            return NULL;
+        result->addObjectsFromArray(inboxResult);
+    }
+
+    * pError = ErrorNone;
+    return result;
+}
+
+// STATUS commands are pipelined: they don't change the state of the connection.
+static unsigned int const maximumPipelinedStatusCommands = 20;
+
+Array * /* IMAPFolder */ IMAPSession::fetchAllFoldersWithStatus(HashMap ** pFolderStatuses, ErrorCode * pError)
+{
+    loginIfNeeded(pError);
+    if (* pError != ErrorNone)
+        return NULL;
+
+    HashMap * folderStatuses = HashMap::hashMap();
+    Array * result;
+    if (mailimap_has_extension(mImap, (char *) "LIST-STATUS")) {
+        result = fetchAllFoldersWithListStatus(folderStatuses, pError);
+    }
+    else {
+        result = fetchAllFolders(pError);
+    }
+    if (* pError != ErrorNone)
+        return NULL;
+
+    // Status of the folders that were not returned by LIST-STATUS.
+    Array * commands = Array::array();
+    Array * missingFolders = Array::array();
+    mc_foreacharray(IMAPFolder, folder, result) {
+        if (((folder->flags() & IMAPFolderFlagNoSelect) != 0) || (folderStatuses->objectForKey(folder->path()) != NULL)) {
+            continue;
+        }
+        missingFolders->addObject(folder->path());
+        String * command = String::string();
+        command->appendUTF8Characters("STATUS ");
+        if (!appendAStringToCommand(command, MCUTF8(folder->path()))) {
+            continue;
+        }
+        command->appendUTF8Format(" (%s)", MCUTF8(folderStatusAttributes()));
+        commands->addObject(command);
+    }
+
+    if (commands->count() > 1) {
+        int r = sendPipelinedCommands(commands, maximumPipelinedStatusCommands, NULL, folderStatuses);
+        if (r == MAILIMAP_ERROR_STREAM) {
+            mShouldDisconnect = true;
+            * pError = ErrorConnection;
+            return NULL;
+        }
+        else if (r == MAILIMAP_ERROR_PARSE) {
+            mShouldDisconnect = true;
+            * pError = ErrorParse;
+            return NULL;
+        }
+        else if ((r != MAILIMAP_NO_ERROR) && (r != MAILIMAP_ERROR_PROTOCOL)) {
+            mShouldDisconnect = true;
+            * pError = ErrorConnection;
+            return NULL;
+        }
+        // When a folder has been rejected, the remaining ones are requested one by one.
+    }
+
+    mc_foreacharray(String, path, missingFolders) {
+        if (folderStatuses->objectForKey(path) != NULL) {
+            continue;
+        }
+        IMAPFolderStatus * fs = folderStatus(path, pError);
+        if ((* pError == ErrorConnection) || (* pError == ErrorParse)) {
+            return NULL;
+        }
+        if (* pError == ErrorNone) {
+            folderStatuses->setObjectForKey(path, fs);
+        }
+    }
+
+    if (pFolderStatuses != NULL) {
+        * pFolderStatuses = folderStatuses;
+    }
+    * pError = ErrorNone;
+    return result;
+}
+
+void IMAPSession::renameFolder(String * folder, String * otherName, ErrorCode * pError)
+{
+    int r;
+    
+    leaveFolderIfNeeded(folder, pError);
+    if (* pError != ErrorNone)
+        return;
+    
+    r = mailimap_rename(mImap, MCUTF8(folder), MCUTF8(otherName));
+    if (r == MAILIMAP_ERROR_STREAM) {
+        mShouldDisconnect = true;
+        * pError = ErrorConnection;
+        return;
+    }
+    else if (r == MAILIMAP_ERROR_PARSE) {
+        mShouldDisconnect = true;
+        * pError = ErrorParse;
+        return;
+    }
+    else if (hasError(r)) {
+        * pError = ErrorRename;
+        return;
     }
+    mCachedFolderStatuses->removeObjectForKey(folder);
+    mCachedFolderStatuses->removeObjectForKey(otherName);
     * pError = ErrorNone;
 }
 
@@ -1624,7 +2969,7 @@ void IMAPSession::deleteFolder(String * folder, ErrorCode * pError)
 {
     int r;
     
-    selectIfNeeded(MCSTR("INBOX"), pError);
+    leaveFolderIfNeeded(folder, pError);
     if (* pError != ErrorNone)
         return;
     
@@ -1643,6 +2988,7 @@ void IMAPSession::deleteFolder(String * folder, ErrorCode * pError)
         * pError = ErrorDelete;
         return;
     }
+    mCachedFolderStatuses->removeObjectForKey(folder);
     * pError = ErrorNone;
 }
 
@@ -1650,7 +2996,7 @@ void IMAPSession::createFolder(String * folder, ErrorCode * pError)
 {
     int r;
     
-    selectIfNeeded(MCSTR("INBOX"), pError);
+    leaveFolderIfNeeded(NULL, pError);
     if (* pError != ErrorNone)
         return;
     
@@ -1678,7 +3024,7 @@ void IMAPSession::subscribeFolder(String * folder, ErrorCode * pError)
 {
     int r;
     
-    selectIfNeeded(MCSTR("INBOX"), pError);
+    leaveFolderIfNeeded(NULL, pError);
     if (* pError != ErrorNone)
         return;
     
@@ -1704,7 +3050,7 @@ void IMAPSession::unsubscribeFolder(String * folder, ErrorCode * pError)
 {
     int r;
     
-    selectIfNeeded(MCSTR("INBOX"), pError);
+    leaveFolderIfNeeded(NULL, pError);
     if (* pError != ErrorNone)
         return;
     
@@ -1799,101 +3145,569 @@ void IMAPSession::appendMessageWithCustomFlagsAndDate(String * folder, Data * me
 void IMAPSession::appendMessageWithCustomFlagsAndDate(String * folder, String * messagePath, MessageFlag flags, Array * customFlags, time_t date,
                                                       IMAPProgressCallback * progressCallback, uint32_t * createdUID, ErrorCode * pError)
 {
-    Data * messageData = Data::dataWithContentsOfFile(messagePath);
-    if (!messageData) {
+    String * command = String::string();
+    command->appendUTF8Characters("APPEND ");
+    if (!appendAStringToCommand(command, MCUTF8(folder))) {
+        // The folder name would need a literal.
+        Data * messageData = Data::dataWithContentsOfFile(messagePath);
+        if (!messageData) {
+            * pError = ErrorFile;
+            return;
+        }
+
+        return appendMessageWithCustomFlagsAndDate(folder, messageData, flags, customFlags, date, progressCallback, createdUID, pError);
+    }
+
+    // The message is sent by chunks while reading the file.
+    FILE * f = fopen(messagePath->fileSystemRepresentation(), "rb");
+    if (f == NULL) {
+        * pError = ErrorFile;
+        return;
+    }
+    struct stat stat_buf;
+    if (fstat(fileno(f), &stat_buf) < 0) {
+        fclose(f);
         * pError = ErrorFile;
         return;
     }
-
-    return appendMessageWithCustomFlagsAndDate(folder, messageData, flags, customFlags, date, progressCallback, createdUID, pError);
-}
-
-void IMAPSession::copyMessages(String * folder, IndexSet * uidSet, String * destFolder,
-     HashMap ** pUidMapping, ErrorCode * pError)
-{
-    int r;
-    struct mailimap_set * set;
-    struct mailimap_set * src_uid;
-    struct mailimap_set * dest_uid;
-    uint32_t uidvalidity;
-    clist * setList;
-    IndexSet * uidSetResult;
-    HashMap * uidMapping = NULL;
 
     selectIfNeeded(folder, pError);
-    if (* pError != ErrorNone)
+    if (* pError != ErrorNone) {
+        fclose(f);
         return;
+    }
 
-    set = setFromIndexSet(uidSet);
-    if (clist_count(set->set_list) == 0) {
-        mailimap_set_free(set);
+    mProgressCallback = progressCallback;
+    bool literalPlus = mailimap_has_extension(mImap, (char *) "LITERAL+");
+    bool fileError = false;
+    IndexSet * createdUIDs = IndexSet::indexSet();
+    int r = writeTaggedCommand(command);
+    if (r == MAILIMAP_NO_ERROR) {
+        r = writeAppendedMessage(NULL, f, (size_t) stat_buf.st_size, flags, customFlags, date, literalPlus, &fileError);
+    }
+    if ((r == MAILIMAP_NO_ERROR) && (mailstream_write(mImap->imap_stream, "\r\n", 2) == -1)) {
+        r = MAILIMAP_ERROR_STREAM;
+    }
+    if (r == MAILIMAP_NO_ERROR) {
+        r = readAppendResponse(mImap->imap_tag, NULL, createdUIDs);
+    }
+    mProgressCallback = NULL;
+    fclose(f);
+
+    if (fileError) {
+        mShouldDisconnect = true;
+        * pError = ErrorFile;
+        return;
+    }
+    else if (r == MAILIMAP_ERROR_STREAM) {
+        mShouldDisconnect = true;
+        * pError = ErrorConnection;
+        return;
+    }
+    else if (r == MAILIMAP_ERROR_PARSE) {
+        mShouldDisconnect = true;
+        * pError = ErrorParse;
+        return;
+    }
+    else if (hasError(r)) {
+        * pError = ErrorAppend;
         return;
     }
 
-    setList = splitSet(set, 10);
-    uidSetResult = NULL;
+    * createdUID = (createdUIDs->count() > 0) ? (uint32_t) RangeLeftBound(createdUIDs->allRanges()[0]) : 0;
+    * pError = ErrorNone;
+}
 
-    for(clistiter * iter = clist_begin(setList) ; iter != NULL ; iter = clist_next(iter)) {
-        struct mailimap_set * current_set;
-
-        current_set = (struct mailimap_set *) clist_content(iter);
+static size_t appendItemLength(IMAPAppendItem * item, bool * pFileError)
+{
+    if (item->messageFilepath() != NULL) {
+        struct stat stat_buf;
+        if (stat(item->messageFilepath()->fileSystemRepresentation(), &stat_buf) < 0) {
+            * pFileError = true;
+            return 0;
+        }
+        return (size_t) stat_buf.st_size;
+    }
+    else if (item->messageData() != NULL) {
+        return item->messageData()->length();
+    }
+    else {
+        return 0;
+    }
+}
 
-        r = mailimap_uidplus_uid_copy(mImap, current_set, MCUTF8(destFolder),
-            &uidvalidity, &src_uid, &dest_uid);
-        if (r == MAILIMAP_ERROR_STREAM) {
-            mShouldDisconnect = true;
-            * pError = ErrorConnection;
-            goto release;
+IndexSet * IMAPSession::appendMessages(String * folder, Array * items, IMAPProgressCallback * progressCallback, ErrorCode * pError)
+{
+    String * command = String::string();
+    command->appendUTF8Characters("APPEND ");
+    if (!appendAStringToCommand(command, MCUTF8(folder))) {
+        // The folder name would need a literal.
+        IndexSet * result = IndexSet::indexSet();
+        for(unsigned int i = 0 ; i < items->count() ; i ++) {
+            IMAPAppendItem * item = (IMAPAppendItem *) items->objectAtIndex(i);
+            uint32_t createdUID = 0;
+            if (item->messageFilepath() != NULL) {
+                appendMessageWithCustomFlagsAndDate(folder, item->messageFilepath(), item->flags(), item->customFlags(), item->date(),
+                                                    progressCallback, &createdUID, pError);
+            }
+            else {
+                appendMessageWithCustomFlagsAndDate(folder, item->messageData(), item->flags(), item->customFlags(), item->date(),
+                                                    progressCallback, &createdUID, pError);
+            }
+            if (* pError != ErrorNone) {
+                return NULL;
+            }
+            if (createdUID != 0) {
+                result->addIndex(createdUID);
+            }
         }
-        else if (r == MAILIMAP_ERROR_PARSE) {
-            mShouldDisconnect = true;
-            * pError = ErrorParse;
-            goto release;
+        return result;
+    }
+    
+    // Sizes are needed before sending anything.
+    bool fileError = false;
+    size_t * lengths = (size_t *) malloc(sizeof(* lengths) * (items->count() + 1));
+    for(unsigned int i = 0 ; i < items->count() ; i ++) {
+        lengths[i] = appendItemLength((IMAPAppendItem *) items->objectAtIndex(i), &fileError);
+        if (fileError) {
+            free(lengths);
+            * pError = ErrorFile;
+            return NULL;
         }
-        else if (hasError(r)) {
-            * pError = ErrorCopy;
-            goto release;
+    }
+    
+    selectIfNeeded(folder, pError);
+    if (* pError != ErrorNone) {
+        free(lengths);
+        return NULL;
+    }
+    
+    mProgressItemsCount = 0;
+    mProgressCallback = progressCallback;
+    
+    // With MULTIAPPEND, messages are sent by batches in a single command. Otherwise, an APPEND command is sent
+    // for each message. When LITERAL+ is available, these commands are pipelined.
+    bool multiAppend = mailimap_has_extension(mImap, (char *) "MULTIAPPEND");
+    bool literalPlus = mailimap_has_extension(mImap, (char *) "LITERAL+");
+    unsigned int maxPendingCommands = 1;
+    if (!multiAppend && literalPlus && (mMaximumPipelinedCommands > 1)) {
+        maxPendingCommands = mMaximumPipelinedCommands;
+    }
+    IndexSet * createdUIDs = IndexSet::indexSet();
+    unsigned int pendingCommands = 0;
+    unsigned int batchCount = 0;
+    size_t batchSize = 0;
+    int result = MAILIMAP_NO_ERROR;
+    int r = MAILIMAP_NO_ERROR;
+    
+    for(unsigned int i = 0 ; i < items->count() ; i ++) {
+        IMAPAppendItem * item = (IMAPAppendItem *) items->objectAtIndex(i);
+        
+        if (batchCount == 0) {
+            r = writeTaggedCommand(command);
+            if (r != MAILIMAP_NO_ERROR) {
+                break;
+            }
+            pendingCommands ++;
         }
-
-        if ((src_uid != NULL) && (dest_uid != NULL)) {
-            if (uidMapping == NULL) {
-                uidMapping = HashMap::hashMap();
+        
+        FILE * f = NULL;
+        if (item->messageFilepath() != NULL) {
+            f = fopen(item->messageFilepath()->fileSystemRepresentation(), "rb");
+            if (f == NULL) {
+                fileError = true;
+                r = MAILIMAP_ERROR_STREAM;
+                break;
             }
-            
-            Array * srcUidsArray = arrayFromSet(src_uid);
-            Array * destUidsArray = arrayFromSet(dest_uid);
-
-            for(int i = 0 ; i < srcUidsArray->count() && i < destUidsArray->count() ; i ++) {
-                uidMapping->setObjectForKey(srcUidsArray->objectAtIndex(i), destUidsArray->objectAtIndex(i));
+        }
+        r = writeAppendedMessage(item->messageData(), f, lengths[i], item->flags(), item->customFlags(), item->date(),
+                                 literalPlus, &fileError);
+        if (f != NULL) {
+            fclose(f);
+        }
+        if (r != MAILIMAP_NO_ERROR) {
+            break;
+        }
+        batchCount ++;
+        batchSize += lengths[i];
+        itemsProgress(i + 1, items->count());
+        
+        bool lastItem = (i == items->count() - 1);
+        if (multiAppend && !lastItem && (batchCount < MULTIAPPEND_MAX_MESSAGES) &&
+            (batchSize + lengths[i + 1] <= MULTIAPPEND_MAX_SIZE)) {
+            continue;
+        }
+        
+        if (mailstream_write(mImap->imap_stream, "\r\n", 2) == -1) {
+            r = MAILIMAP_ERROR_STREAM;
+            break;
+        }
+        batchCount = 0;
+        batchSize = 0;
+        
+        if ((pendingCommands >= maxPendingCommands) || lastItem) {
+            while (pendingCommands > 0) {
+                // Completions come in the order of the commands.
+                r = readAppendResponse(mImap->imap_tag - (int) pendingCommands + 1, NULL, createdUIDs);
+                pendingCommands --;
+                if ((r == MAILIMAP_ERROR_STREAM) || (r == MAILIMAP_ERROR_PARSE)) {
+                    break;
+                }
+                if (r != MAILIMAP_NO_ERROR) {
+                    result = r;
+                }
+                if (!lastItem && (result == MAILIMAP_NO_ERROR)) {
+                    // Keep the pipeline full.
+                    break;
+                }
+            }
+            if ((r == MAILIMAP_ERROR_STREAM) || (r == MAILIMAP_ERROR_PARSE)) {
+                break;
+            }
+            if (result != MAILIMAP_NO_ERROR) {
+                // All pending commands have completed.
+                break;
             }
         }
+    }
+    if ((r == MAILIMAP_NO_ERROR) && (result != MAILIMAP_NO_ERROR)) {
+        r = result;
+    }
+    
+    mProgressCallback = NULL;
+    free(lengths);
+    
+    if (fileError) {
+        mShouldDisconnect = true;
+        * pError = ErrorFile;
+        return NULL;
+    }
+    else if (r == MAILIMAP_ERROR_STREAM) {
+        mShouldDisconnect = true;
+        * pError = ErrorConnection;
+        return NULL;
+    }
+    else if (r == MAILIMAP_ERROR_PARSE) {
+        mShouldDisconnect = true;
+        * pError = ErrorParse;
+        return NULL;
+    }
+    else if (hasError(r)) {
+        * pError = ErrorAppend;
+        return NULL;
+    }
+    
+    * pError = ErrorNone;
+    return createdUIDs;
+}
 
-        if (src_uid != NULL) {
-            mailimap_set_free(src_uid);
+// Writes a new tag followed by the command. The end of line is not written.
+int IMAPSession::writeTaggedCommand(String * command)
+{
+    const char * commandBytes = command->UTF8Characters();
+    char tag[16];
+    
+    mImap->imap_tag ++;
+    formatTag(mImap, mImap->imap_tag, tag, sizeof(tag));
+    if ((mailstream_write(mImap->imap_stream, tag, strlen(tag)) == -1) ||
+        (mailstream_write(mImap->imap_stream, " ", 1) == -1) ||
+        (mailstream_write(mImap->imap_stream, commandBytes, strlen(commandBytes)) == -1)) {
+        return MAILIMAP_ERROR_STREAM;
+    }
+    // Counted here since pipelined commands are sent together.
+    lockConnectionLogger();
+    mMetricsLastSentTag = mImap->imap_tag;
+    if (mConnectionMetrics != NULL) {
+        metricsCommandStarted(tag, commandBytes, strlen(commandBytes));
+    }
+    unlockConnectionLogger();
+    return MAILIMAP_NO_ERROR;
+}
+
+// Keeps the number of messages of the selected folder up to date when untagged responses are read
+// outside of libetpan.
+void IMAPSession::handleUntaggedResponseLine(const char * line)
+{
+    if ((mState != STATE_SELECTED) || (strncmp(line, "* ", 2) != 0)) {
+        return;
+    }
+    const char * p = line + 2;
+    char * end;
+    unsigned long value = strtoul(p, &end, 10);
+    if ((end == p) || (* end != ' ')) {
+        return;
+    }
+    p = end + 1;
+    if (strncasecmp(p, "EXISTS", 6) == 0) {
+        mFolderMsgCount = (unsigned int) value;
+        if (mImap->imap_selection_info != NULL) {
+            mImap->imap_selection_info->sel_exists = (uint32_t) value;
+        }
+    }
+    else if (strncasecmp(p, "EXPUNGE", 7) == 0) {
+        if (mFolderMsgCount > 0) {
+            mFolderMsgCount --;
+        }
+        if ((mImap->imap_selection_info != NULL) && (mImap->imap_selection_info->sel_exists > 0)) {
+            mImap->imap_selection_info->sel_exists --;
         }
+    }
+}
 
-        if (dest_uid != NULL) {
-            mailimap_set_free(dest_uid);
+// Waits for the server to accept a synchronizing literal. Untagged responses received meanwhile are processed.
+int IMAPSession::waitContinuationRequest()
+{
+    if (mailstream_flush(mImap->imap_stream) == -1) {
+        return MAILIMAP_ERROR_STREAM;
+    }
+    while (1) {
+        Data * lineData = readResponseLineWithLiterals();
+        if (lineData == NULL) {
+            return MAILIMAP_ERROR_STREAM;
+        }
+        const char * line = lineData->bytes();
+        if (line[0] == '+') {
+            return MAILIMAP_NO_ERROR;
         }
+        if (isCompletionOfTag(mImap, line, mImap->imap_tag, NULL)) {
+            // The command has been rejected.
+            return MAILIMAP_ERROR_APPEND;
+        }
+        if (strncasecmp(line, "* BYE", 5) == 0) {
+            return MAILIMAP_ERROR_STREAM;
+        }
+        handleUntaggedResponseLine(line);
     }
-    if (pUidMapping != NULL) {
-        * pUidMapping = uidMapping;
+}
+
+// Writes the flags, the date and the message of an APPEND command. When the message is a file,
+// it's read by chunks. pFileError is set if the file could not be read: the connection can't be used anymore.
+int IMAPSession::writeAppendedMessage(Data * messageData, FILE * messageFile, size_t length,
+                                      MessageFlag flags, Array * customFlags, time_t date,
+                                      bool literalPlus, bool * pFileError)
+{
+    String * header = String::string();
+    header->appendUTF8Characters(" ");
+    appendFlagListToCommand(header, flags, customFlags);
+    if (date != (time_t) -1) {
+        header->appendUTF8Characters(" ");
+        appendDateToCommand(header, date);
     }
-    * pError = ErrorNone;
+    header->appendUTF8Format(" {%lu%s}\r\n", (unsigned long) length, literalPlus ? "+" : "");
+    if (mailstream_write(mImap->imap_stream, header->UTF8Characters(), strlen(header->UTF8Characters())) == -1) {
+        return MAILIMAP_ERROR_STREAM;
+    }
+    if (!literalPlus) {
+        int r = waitContinuationRequest();
+        if (r != MAILIMAP_NO_ERROR) {
+            return r;
+        }
+    }
+    
+    char * buffer = NULL;
+    if (messageData == NULL) {
+        buffer = (char *) malloc(APPEND_CHUNK_SIZE);
+    }
+    int result = MAILIMAP_NO_ERROR;
+    size_t written = 0;
+    bodyProgress(0, (unsigned int) length);
+    while (written < length) {
+        size_t chunkLength = length - written;
+        if (chunkLength > APPEND_CHUNK_SIZE) {
+            chunkLength = APPEND_CHUNK_SIZE;
+        }
+        
+        const char * chunk;
+        if (messageData != NULL) {
+            chunk = messageData->bytes() + written;
+        }
+        else {
+            if (fread(buffer, 1, chunkLength, messageFile) != chunkLength) {
+                * pFileError = true;
+                result = MAILIMAP_ERROR_STREAM;
+                break;
+            }
+            chunk = buffer;
+        }
+        if (mailstream_write(mImap->imap_stream, chunk, chunkLength) == -1) {
+            result = MAILIMAP_ERROR_STREAM;
+            break;
+        }
+        written += chunkLength;
+        bodyProgress((unsigned int) written, (unsigned int) length);
+    }
+    free(buffer);
+    
+    return result;
+}
 
-    release:
+// libetpan only accepts the completion of the last tag that has been sent: a completion line that has
+// already been read is parsed alone, as the completion of its own command.
+int IMAPSession::parseCompletionLine(const char * line, int tag, struct mailimap_response ** pResponse)
+{
+    int lastTag = mImap->imap_tag;
+    mmap_string_assign(mImap->imap_stream_buffer, line);
+    mmap_string_append(mImap->imap_stream_buffer, "\r\n");
+    mImap->imap_tag = tag;
+    int r = mailimap_parse_response(mImap, pResponse);
+    mImap->imap_tag = lastTag;
+    if (r == MAILIMAP_ERROR_STREAM) {
+        return r;
+    }
+    else if (r != MAILIMAP_NO_ERROR) {
+        return MAILIMAP_ERROR_PARSE;
+    }
+    if ((* pResponse)->rsp_resp_done->rsp_type != MAILIMAP_RESP_DONE_TYPE_TAGGED) {
+        mailimap_response_free(* pResponse);
+        return MAILIMAP_ERROR_PARSE;
+    }
+    return MAILIMAP_NO_ERROR;
+}
+
+// Reads the completion of the APPEND command with the given tag and the UIDs of the appended messages.
+// Untagged responses received meanwhile are processed.
+int IMAPSession::readAppendResponse(int tag, uint32_t * pUidValidity, IndexSet * createdUIDs)
+{
+    if (mailstream_flush(mImap->imap_stream) == -1) {
+        return MAILIMAP_ERROR_STREAM;
+    }
+    while (1) {
+        Data * lineData = readResponseLineWithLiterals();
+        if (lineData == NULL) {
+            return MAILIMAP_ERROR_STREAM;
+        }
+        const char * line = lineData->bytes();
+        int lineTag = tagOfResponseLine(mImap, line, NULL);
+        if (lineTag == -1) {
+            if (strncasecmp(line, "* BYE", 5) == 0) {
+                return MAILIMAP_ERROR_STREAM;
+            }
+            handleUntaggedResponseLine(line);
+            continue;
+        }
+        if (lineTag != tag) {
+            return MAILIMAP_ERROR_PARSE;
+        }
+        
+        struct mailimap_response * response;
+        int r = parseCompletionLine(line, tag, &response);
+        if (r != MAILIMAP_NO_ERROR) {
+            return r;
+        }
+        if (response->rsp_resp_done->rsp_data.rsp_tagged->rsp_cond_state->rsp_type != MAILIMAP_RESP_COND_STATE_OK) {
+            mailimap_response_free(response);
+            return MAILIMAP_ERROR_APPEND;
+        }
+        addAppendedUIDsFromResponse(mImap, pUidValidity, createdUIDs);
+        mailimap_response_free(response);
+        return MAILIMAP_NO_ERROR;
+    }
+}
+
+// Sends the commands without waiting for the previous ones to complete, with at most
+// maximumPipelinedCommands commands in flight. Completions are matched by tag.
+// Once a command fails, no more commands are sent and the ones in flight are drained.
+// When MAILIMAP_ERROR_STREAM or MAILIMAP_ERROR_PARSE is returned, the responses of the commands in flight
+// have not been read: the connection can't be used anymore.
+int IMAPSession::sendPipelinedCommands(Array * commands, unsigned int maximumPipelinedCommands,
+                                       HashMap * uidMapping, HashMap * folderStatuses)
+{
+    IndexSet * pendingTags = IndexSet::indexSet();
+    unsigned int sentCount = 0;
+    int result = MAILIMAP_NO_ERROR;
+    
+    while (1) {
+        while ((result == MAILIMAP_NO_ERROR) && (sentCount < commands->count()) &&
+               (pendingTags->count() < maximumPipelinedCommands)) {
+            String * command = (String *) commands->objectAtIndex(sentCount);
+            int r = writeTaggedCommand(command);
+            if ((r == MAILIMAP_NO_ERROR) && (mailstream_write(mImap->imap_stream, "\r\n", 2) == -1)) {
+                r = MAILIMAP_ERROR_STREAM;
+            }
+            if (r != MAILIMAP_NO_ERROR) {
+                mShouldDisconnect = true;
+                return MAILIMAP_ERROR_STREAM;
+            }
+            pendingTags->addIndex(mImap->imap_tag);
+            sentCount ++;
+        }
+        
+        if (pendingTags->count() == 0) {
+            break;
+        }
+        
+        if (mailstream_flush(mImap->imap_stream) == -1) {
+            mShouldDisconnect = true;
+            return MAILIMAP_ERROR_STREAM;
+        }
+        Data * lineData = readResponseLineWithLiterals();
+        if (lineData == NULL) {
+            mShouldDisconnect = true;
+            return MAILIMAP_ERROR_STREAM;
+        }
+        const char * line = lineData->bytes();
+        
+        int tag = tagOfResponseLine(mImap, line, NULL);
+        if (tag == -1) {
+            if (strncasecmp(line, "* BYE", 5) == 0) {
+                mShouldDisconnect = true;
+                return MAILIMAP_ERROR_STREAM;
+            }
+            if ((folderStatuses != NULL) && (strncasecmp(line, "* STATUS ", 9) == 0)) {
+                addFolderStatusWithStatusResponse(line, folderStatuses);
+            }
+            else {
+                handleUntaggedResponseLine(line);
+            }
+            continue;
+        }
+        if (!pendingTags->containsIndex(tag)) {
+            mShouldDisconnect = true;
+            return MAILIMAP_ERROR_PARSE;
+        }
+        pendingTags->removeIndex(tag);
+        
+        struct mailimap_response * response;
+        int r = parseCompletionLine(line, tag, &response);
+        if (r != MAILIMAP_NO_ERROR) {
+            mShouldDisconnect = true;
+            return r;
+        }
+        
+        struct mailimap_response_tagged * tagged = response->rsp_resp_done->rsp_data.rsp_tagged;
+        if (tagged->rsp_cond_state->rsp_type != MAILIMAP_RESP_COND_STATE_OK) {
+            result = MAILIMAP_ERROR_PROTOCOL;
+        }
+        else if (uidMapping != NULL) {
+            addUidMappingFromResponse(mImap, uidMapping);
+        }
+        mailimap_response_free(response);
+    }
+    
+    return result;
+}
 
+// Returns NULL if the commands can't be pipelined.
+static Array * copyCommands(clist * setList, const char * verb, String * destFolder)
+{
+    Array * commands = Array::array();
     for(clistiter * iter = clist_begin(setList) ; iter != NULL ; iter = clist_next(iter)) {
         struct mailimap_set * current_set;
-
+        String * command = String::string();
+        
         current_set = (struct mailimap_set *) clist_content(iter);
-        mailimap_set_free(current_set);
+        command->appendUTF8Format("UID %s ", verb);
+        appendSetToCommand(command, current_set);
+        command->appendUTF8Characters(" ");
+        if (!appendAStringToCommand(command, MCUTF8(destFolder))) {
+            return NULL;
+        }
+        commands->addObject(command);
     }
-    clist_free(setList);
-    mailimap_set_free(set);
+    return commands;
 }
 
-void IMAPSession::moveMessages(String * folder, IndexSet * uidSet, String * destFolder,
+void IMAPSession::copyMessages(String * folder, IndexSet * uidSet, String * destFolder,
      HashMap ** pUidMapping, ErrorCode * pError)
 {
     int r;
@@ -1918,12 +3732,39 @@ void IMAPSession::moveMessages(String * folder, IndexSet * uidSet, String * dest
     setList = splitSet(set, 10);
     uidSetResult = NULL;
 
+    if ((mMaximumPipelinedCommands > 1) && (clist_count(setList) > 1)) {
+        Array * commands = copyCommands(setList, "COPY", destFolder);
+        if (commands != NULL) {
+            uidMapping = HashMap::hashMap();
+            r = sendPipelinedCommands(commands, mMaximumPipelinedCommands, uidMapping, NULL);
+            if (r == MAILIMAP_ERROR_STREAM) {
+                mShouldDisconnect = true;
+                * pError = ErrorConnection;
+                goto release;
+            }
+            else if (r == MAILIMAP_ERROR_PARSE) {
+                mShouldDisconnect = true;
+                * pError = ErrorParse;
+                goto release;
+            }
+            else if (hasError(r)) {
+                * pError = ErrorCopy;
+                goto release;
+            }
+            if (pUidMapping != NULL) {
+                * pUidMapping = (uidMapping->count() > 0) ? uidMapping : NULL;
+            }
+            * pError = ErrorNone;
+            goto release;
+        }
+    }
+
     for(clistiter * iter = clist_begin(setList) ; iter != NULL ; iter = clist_next(iter)) {
         struct mailimap_set * current_set;
 
         current_set = (struct mailimap_set *) clist_content(iter);
 
-        r = mailimap_uidplus_uid_move(mImap, current_set, MCUTF8(destFolder),
+        r = mailimap_uidplus_uid_copy(mImap, current_set, MCUTF8(destFolder),
             &uidvalidity, &src_uid, &dest_uid);
         if (r == MAILIMAP_ERROR_STREAM) {
             mShouldDisconnect = true;
@@ -1978,10 +3819,122 @@ void IMAPSession::moveMessages(String * folder, IndexSet * uidSet, String * dest
     mailimap_set_free(set);
 }
 
-void IMAPSession::expunge(String * folder, ErrorCode * pError)
+void IMAPSession::moveMessages(String * folder, IndexSet * uidSet, String * destFolder,
+     HashMap ** pUidMapping, ErrorCode * pError)
 {
     int r;
-    
+    struct mailimap_set * set;
+    struct mailimap_set * src_uid;
+    struct mailimap_set * dest_uid;
+    uint32_t uidvalidity;
+    clist * setList;
+    IndexSet * uidSetResult;
+    HashMap * uidMapping = NULL;
+
+    selectIfNeeded(folder, pError);
+    if (* pError != ErrorNone)
+        return;
+
+    set = setFromIndexSet(uidSet);
+    if (clist_count(set->set_list) == 0) {
+        mailimap_set_free(set);
+        return;
+    }
+
+    setList = splitSet(set, 10);
+    uidSetResult = NULL;
+
+    if ((mMaximumPipelinedCommands > 1) && (clist_count(setList) > 1)) {
+        Array * commands = copyCommands(setList, "MOVE", destFolder);
+        if (commands != NULL) {
+            uidMapping = HashMap::hashMap();
+            r = sendPipelinedCommands(commands, mMaximumPipelinedCommands, uidMapping, NULL);
+            if (r == MAILIMAP_ERROR_STREAM) {
+                mShouldDisconnect = true;
+                * pError = ErrorConnection;
+                goto release;
+            }
+            else if (r == MAILIMAP_ERROR_PARSE) {
+                mShouldDisconnect = true;
+                * pError = ErrorParse;
+                goto release;
+            }
+            else if (hasError(r)) {
+                * pError = ErrorCopy;
+                goto release;
+            }
+            if (pUidMapping != NULL) {
+                * pUidMapping = (uidMapping->count() > 0) ? uidMapping : NULL;
+            }
+            * pError = ErrorNone;
+            goto release;
+        }
+    }
+
+    for(clistiter * iter = clist_begin(setList) ; iter != NULL ; iter = clist_next(iter)) {
+        struct mailimap_set * current_set;
+
+        current_set = (struct mailimap_set *) clist_content(iter);
+
+        r = mailimap_uidplus_uid_move(mImap, current_set, MCUTF8(destFolder),
+            &uidvalidity, &src_uid, &dest_uid);
+        if (r == MAILIMAP_ERROR_STREAM) {
+            mShouldDisconnect = true;
+            * pError = ErrorConnection;
+            goto release;
+        }
+        else if (r == MAILIMAP_ERROR_PARSE) {
+            mShouldDisconnect = true;
+            * pError = ErrorParse;
+            goto release;
+        }
+        else if (hasError(r)) {
+            * pError = ErrorCopy;
+            goto release;
+        }
+
+        if ((src_uid != NULL) && (dest_uid != NULL)) {
+            if (uidMapping == NULL) {
+                uidMapping = HashMap::hashMap();
+            }
+            
+            Array * srcUidsArray = arrayFromSet(src_uid);
+            Array * destUidsArray = arrayFromSet(dest_uid);
+
+            for(int i = 0 ; i < srcUidsArray->count() && i < destUidsArray->count() ; i ++) {
+                uidMapping->setObjectForKey(srcUidsArray->objectAtIndex(i), destUidsArray->objectAtIndex(i));
+            }
+        }
+
+        if (src_uid != NULL) {
+            mailimap_set_free(src_uid);
+        }
+
+        if (dest_uid != NULL) {
+            mailimap_set_free(dest_uid);
+        }
+    }
+    if (pUidMapping != NULL) {
+        * pUidMapping = uidMapping;
+    }
+    * pError = ErrorNone;
+
+    release:
+
+    for(clistiter * iter = clist_begin(setList) ; iter != NULL ; iter = clist_next(iter)) {
+        struct mailimap_set * current_set;
+
+        current_set = (struct mailimap_set *) clist_content(iter);
+        mailimap_set_free(current_set);
+    }
+    clist_free(setList);
+    mailimap_set_free(set);
+}
+
+void IMAPSession::expunge(String * folder, ErrorCode * pError)
+{
+    int r;
+    
     selectIfNeeded(folder, pError);
     if (* pError != ErrorNone)
         return;
@@ -2169,8 +4122,180 @@ struct msg_att_handler_data {
     bool needsGmailLabels;
     bool needsGmailMessageID;
     bool needsGmailThreadID;
+    OperationTiming * timing;
+    IMAPSession * session;
+    IMAPMessageStreamCallback * streamCallback;
+    unsigned int fetchedCount;
+};
+
+enum {
+    PREVIEW_LENGTH = 200,
+    PREVIEW_FETCH_SIZE = 2048,
 };
 
+static String * previewWithText(String * text)
+{
+    String * result = text->stripWhitespace();
+    if (result->length() > PREVIEW_LENGTH) {
+        result = result->substringToIndex(PREVIEW_LENGTH);
+    }
+    return result;
+}
+
+static bool previewLooksLikeBase64(const char * bytes, size_t length)
+{
+    size_t lineLength = 0;
+    while ((lineLength < length) && (bytes[lineLength] != '\r') && (bytes[lineLength] != '\n')) {
+        char ch = bytes[lineLength];
+        if (!(((ch >= 'a') && (ch <= 'z')) || ((ch >= 'A') && (ch <= 'Z')) || ((ch >= '0') && (ch <= '9')) ||
+              (ch == '+') || (ch == '/') || (ch == '='))) {
+            return false;
+        }
+        lineLength ++;
+    }
+    return lineLength >= 60;
+}
+
+// Reads the MIME headers of a part: bytes is moved to the content.
+static void previewParseMIMEHeaders(const char ** pBytes, size_t * pLength,
+                                    Encoding * pEncoding, String ** pCharset, bool * pIsHTML)
+{
+    const char * bytes = * pBytes;
+    size_t length = * pLength;
+    size_t headersLength = 0;
+    while (headersLength < length) {
+        if ((bytes[headersLength] == '\n') &&
+            ((headersLength + 1 == length) || (bytes[headersLength + 1] == '\n') ||
+             ((bytes[headersLength + 1] == '\r') && (headersLength + 2 < length) && (bytes[headersLength + 2] == '\n')))) {
+            break;
+        }
+        headersLength ++;
+    }
+
+    String * headers = Data::dataWithBytes(bytes, (unsigned int) headersLength)->stringWithCharset("iso-8859-1");
+    if (headers != NULL) {
+        headers = headers->lowercaseString();
+        int location = headers->locationOfString(MCSTR("content-transfer-encoding:"));
+        if (location != -1) {
+            String * value = headers->substringFromIndex(location + 26)->stripWhitespace();
+            if (value->hasPrefix(MCSTR("base64"))) {
+                * pEncoding = EncodingBase64;
+            }
+            else if (value->hasPrefix(MCSTR("quoted-printable"))) {
+                * pEncoding = EncodingQuotedPrintable;
+            }
+        }
+        location = headers->locationOfString(MCSTR("charset="));
+        if (location != -1) {
+            String * value = headers->substringFromIndex(location + 8);
+            unsigned int i = 0;
+            while ((i < value->length()) && (value->characterAtIndex(i) != ';') && (value->characterAtIndex(i) != ' ') &&
+                   (value->characterAtIndex(i) != '\r') && (value->characterAtIndex(i) != '\n')) {
+                i ++;
+            }
+            value = value->substringToIndex(i);
+            value->replaceOccurrencesOfString(MCSTR("\""), MCSTR(""));
+            * pCharset = value;
+        }
+        * pIsHTML = (headers->locationOfString(MCSTR("text/html")) != -1);
+    }
+
+    while ((headersLength < length) && ((bytes[headersLength] == '\r') || (bytes[headersLength] == '\n'))) {
+        headersLength ++;
+    }
+    * pBytes = bytes + headersLength;
+    * pLength = length - headersLength;
+}
+
+// When the first part is a multipart, moves to the content of its first part.
+static bool previewSkipMultipart(const char ** pBytes, size_t * pLength,
+                                 Encoding * pEncoding, String ** pCharset, bool * pIsHTML)
+{
+    const char * bytes = * pBytes;
+    size_t length = * pLength;
+    size_t lineStart = 0;
+    while (lineStart + 2 < length) {
+        if ((bytes[lineStart] == '-') && (bytes[lineStart + 1] == '-')) {
+            size_t lineEnd = lineStart;
+            while ((lineEnd < length) && (bytes[lineEnd] != '\n')) {
+                lineEnd ++;
+            }
+            if ((lineEnd + 9 < length) && (strncasecmp(bytes + lineEnd + 1, "content-", 8) == 0)) {
+                * pBytes = bytes + lineEnd + 1;
+                * pLength = length - (lineEnd + 1);
+                previewParseMIMEHeaders(pBytes, pLength, pEncoding, pCharset, pIsHTML);
+                return true;
+            }
+        }
+        while ((lineStart < length) && (bytes[lineStart] != '\n')) {
+            lineStart ++;
+        }
+        lineStart ++;
+    }
+    return false;
+}
+
+// Builds a preview from the first bytes of the first part of the message.
+static String * previewWithPartialBody(IMAPMessage * msg, Data * data)
+{
+    const char * bytes = data->bytes();
+    size_t length = data->length();
+    Encoding encoding = Encoding8Bit;
+    String * charset = NULL;
+    bool isHTML = false;
+
+    // The compact structure is used when it's available, without creating the tree of parts.
+    bool structureKnown = false;
+    IMAPBodyStructure * bodyStructure = msg->bodyStructure();
+    if (bodyStructure != NULL) {
+        int idx = bodyStructure->indexForPartID(MCSTR("1"));
+        if ((idx != -1) && (bodyStructure->partTypeAtIndex(idx) == PartTypeSingle)) {
+            encoding = bodyStructure->encodingAtIndex(idx);
+            charset = bodyStructure->charsetAtIndex(idx);
+            String * mimeType = bodyStructure->mimeTypeAtIndex(idx);
+            isHTML = (mimeType != NULL) && mimeType->isEqualCaseInsensitive(MCSTR("text/html"));
+            structureKnown = true;
+        }
+    }
+    else if (msg->mainPart() != NULL) {
+        AbstractPart * part = msg->partForPartID(MCSTR("1"));
+        if ((part != NULL) && (part->partType() == PartTypeSingle)) {
+            encoding = ((IMAPPart *) part)->encoding();
+            charset = part->charset();
+            isHTML = (part->mimeType() != NULL) && part->mimeType()->isEqualCaseInsensitive(MCSTR("text/html"));
+            structureKnown = true;
+        }
+    }
+    if (!structureKnown) {
+        // Without the structure, the content is guessed.
+        for(unsigned int level = 0 ; level < 3 ; level ++) {
+            if (!previewSkipMultipart(&bytes, &length, &encoding, &charset, &isHTML)) {
+                break;
+            }
+        }
+        if ((encoding == Encoding8Bit) && previewLooksLikeBase64(bytes, length)) {
+            encoding = EncodingBase64;
+        }
+        if (!isHTML && (length > 0) && (bytes[0] == '<')) {
+            isHTML = true;
+        }
+    }
+
+    Data * remaining = NULL;
+    Data * decoded = MCDecodeData(Data::dataWithBytes(bytes, (unsigned int) length), encoding, true, &remaining);
+    if (decoded == NULL) {
+        return NULL;
+    }
+    String * text = decoded->stringWithDetectedCharset(charset, isHTML);
+    if (text == NULL) {
+        return NULL;
+    }
+    if (isHTML) {
+        text = text->flattenHTML();
+    }
+    return previewWithText(text);
+}
+
 static void msg_att_handler(struct mailimap_msg_att * msg_att, void * context)
 {
     clistiter * item_iter;
@@ -2196,6 +4321,7 @@ static void msg_att_handler(struct mailimap_msg_att * msg_att, void * context)
     bool needsGmailThreadID;
     IndexSet * uidsFilter;
     IndexSet * numbersFilter;
+    Data * previewData;
     
     msg_att_context = (struct msg_att_handler_data *) context;
     uidsFilter = msg_att_context->uidsFilter;
@@ -2217,6 +4343,7 @@ static void msg_att_handler(struct mailimap_msg_att * msg_att, void * context)
     hasGmailLabels = false;
     hasGmailMessageID = false;
     hasGmailThreadID = false;
+    previewData = NULL;
     
     if (numbersFilter != NULL) {
         if (!numbersFilter->containsIndex((uint64_t) msg_att->att_number)) {
@@ -2265,7 +4392,14 @@ static void msg_att_handler(struct mailimap_msg_att * msg_att, void * context)
                 hasHeader = true;
             }
             else if (att_static->att_type == MAILIMAP_MSG_ATT_BODY_SECTION) {
-                if ((requestKind & IMAPMessagesRequestKindFullHeaders) != 0 ||
+                struct mailimap_section * section = att_static->att_data.att_body_section->sec_section;
+                if ((section != NULL) && (section->sec_spec != NULL) &&
+                    (section->sec_spec->sec_type == MAILIMAP_SECTION_SPEC_SECTION_PART)) {
+                    // first bytes of the body for the preview.
+                    previewData = Data::dataWithBytes(att_static->att_data.att_body_section->sec_body_part,
+                                                      (unsigned int) att_static->att_data.att_body_section->sec_length);
+                }
+                else if ((requestKind & IMAPMessagesRequestKindFullHeaders) != 0 ||
                     (requestKind & IMAPMessagesRequestKindExtraHeaders) != 0) {
                     char * bytes;
                     size_t length;
@@ -2292,7 +4426,8 @@ static void msg_att_handler(struct mailimap_msg_att * msg_att, void * context)
                 
                 // bodystructure
                 mainPart = IMAPPart::attachmentWithIMAPBody(att_static->att_data.att_body);
-                msg->setMainPart(mainPart);
+                // The parts are only kept in the compact form until they're used.
+                msg->setBodyStructure(IMAPBodyStructure::bodyStructureWithPart(mainPart));
                 hasBody = true;
             }
         }
@@ -2341,6 +4476,14 @@ static void msg_att_handler(struct mailimap_msg_att * msg_att, void * context)
                 msg->setGmailMessageID(*msgID);
                 hasGmailMessageID = true;
             }
+            else if (ext_data->ext_extension == &preview_extension) {
+                char * preview;
+                
+                preview = (char *) ext_data->ext_data;
+                if (preview != NULL) {
+                    msg->setPreview(previewWithText(String::stringWithUTF8Characters(preview)));
+                }
+            }
         }
     }
     for(item_iter = clist_begin(msg_att->att_list) ; item_iter != NULL ; item_iter = clist_next(item_iter)) {
@@ -2359,6 +4502,10 @@ static void msg_att_handler(struct mailimap_msg_att * msg_att, void * context)
         }
     }
     
+    if (previewData != NULL) {
+        msg->setPreview(previewWithPartialBody(msg, previewData));
+    }
+    
     if (needsBody && !hasBody) {
         msg->release();
         return;
@@ -2398,16 +4545,93 @@ static void msg_att_handler(struct mailimap_msg_att * msg_att, void * context)
         }
     }
     
-    result->addObject(msg);
+    msg_att_context->fetchedCount ++;
+    if (msg_att_context->streamCallback != NULL) {
+        msg_att_context->streamCallback->messageFetched(msg_att_context->session, msg);
+    }
+    else {
+        result->addObject(msg);
+    }
     msg->release();
     
     msg_att_context->mLastFetchedSequenceNumber = mLastFetchedSequenceNumber;
 }
 
+// Selects the folder with QRESYNC, using the state of the folder when it was last selected. The messages
+// changed and removed since then are returned with the response: they're kept in mSelectChanges.
+int IMAPSession::selectWithKnownStatus(String * folder, IMAPFolderStatus * knownStatus)
+{
+    Array * messages = Array::array();
+    struct msg_att_handler_data msg_att_data;
+    
+    memset(&msg_att_data, 0, sizeof(msg_att_data));
+    msg_att_data.fetchByUID = true;
+    msg_att_data.result = messages;
+    msg_att_data.requestKind = IMAPMessagesRequestKindFlags;
+    msg_att_data.mLastFetchedSequenceNumber = mLastFetchedSequenceNumber;
+    msg_att_data.needsFlags = true;
+    msg_att_data.session = this;
+    mailimap_set_msg_att_handler(mImap, msg_att_handler, &msg_att_data);
+    
+    clist * fetch_result = NULL;
+    struct mailimap_qresync_vanished * vanished = NULL;
+    uint64_t modseq = 0;
+    int r = mailimap_select_qresync(mImap, MCUTF8(folder), knownStatus->uidValidity(), knownStatus->highestModSeqValue(),
+                                    NULL, NULL, NULL, &fetch_result, &vanished, &modseq);
+    mailimap_set_msg_att_handler(mImap, NULL, NULL);
+    if (r != MAILIMAP_NO_ERROR) {
+        return r;
+    }
+    
+    // The changes are not returned when UIDVALIDITY has changed.
+    if ((mImap->imap_selection_info != NULL) && (mImap->imap_selection_info->sel_uidvalidity == knownStatus->uidValidity())) {
+        mSelectChanges = new IMAPSyncResult();
+        mSelectChanges->setModifiedOrAddedMessages(messages);
+        mSelectChanges->setVanishedMessages((vanished != NULL) ? indexSetFromSet(vanished->qr_known_uids) : IndexSet::indexSet());
+        mSelectChangesModSequenceValue = knownStatus->highestModSeqValue();
+    }
+    if (fetch_result != NULL) {
+        mailimap_fetch_list_free(fetch_result);
+    }
+    if (vanished != NULL) {
+        mailimap_qresync_vanished_free(vanished);
+    }
+    return MAILIMAP_NO_ERROR;
+}
+
+static void timed_msg_att_handler(struct mailimap_msg_att * msg_att, void * context)
+{
+    struct msg_att_handler_data * msg_att_context = (struct msg_att_handler_data *) context;
+    double startTime = OperationTiming::currentTime();
+    msg_att_handler(msg_att, context);
+    msg_att_context->timing->addPhaseDuration(OperationTimingPhaseParse, OperationTiming::currentTime() - startTime);
+}
+
+static void streamed_msg_att_handler(struct mailimap_msg_att * msg_att, void * context)
+{
+    struct msg_att_handler_data * msg_att_context = (struct msg_att_handler_data *) context;
+    
+    AutoreleasePool * pool = new AutoreleasePool();
+    if (msg_att_context->timing != NULL) {
+        timed_msg_att_handler(msg_att, context);
+    }
+    else {
+        msg_att_handler(msg_att, context);
+    }
+    pool->release();
+    
+    // libetpan keeps the message in the response list until the command completes:
+    // free its attributes now and leave an empty shell.
+    clist_foreach(msg_att->att_list, (clist_func) mailimap_msg_att_item_free, NULL);
+    clist_free(msg_att->att_list);
+    msg_att->att_list = clist_new();
+}
+
 IMAPSyncResult * IMAPSession::fetchMessages(String * folder, IMAPMessagesRequestKind requestKind, bool fetchByUID,
                                             struct mailimap_set * imapset, IndexSet * uidsFilter, IndexSet * numbersFilter,
                                             uint64_t modseq, HashMap * mapping,
-                                            IMAPProgressCallback * progressCallback, Array * extraHeaders, ErrorCode * pError)
+                                            IMAPProgressCallback * progressCallback, Array * extraHeaders,
+                                            IMAPMessageStreamCallback * streamCallback, ErrorCode * pError)
 {
     struct mailimap_fetch_type * fetch_type;
     clist * fetch_result;
@@ -2537,6 +4761,25 @@ IMAPSyncResult * IMAPSession::fetchMessages(String * folder, IMAPMessagesRequest
         fetch_att = mailimap_fetch_att_new_internaldate();
         mailimap_fetch_type_new_fetch_att_list_add(fetch_type, fetch_att);
     }
+    if ((requestKind & IMAPMessagesRequestKindPreview) != 0) {
+        if (mPreviewEnabled) {
+            fetch_att = mailimap_fetch_att_new_extension(strdup("PREVIEW"));
+        }
+        else {
+            // first bytes of the first part.
+            struct mailimap_section * section;
+            clist * sec_list;
+            uint32_t * value;
+            
+            sec_list = clist_new();
+            value = (uint32_t *) malloc(sizeof(* value));
+            * value = 1;
+            clist_append(sec_list, value);
+            section = mailimap_section_new_part(mailimap_section_part_new(sec_list));
+            fetch_att = mailimap_fetch_att_new_body_peek_section_partial(section, 0, PREVIEW_FETCH_SIZE);
+        }
+        mailimap_fetch_type_new_fetch_att_list_add(fetch_type, fetch_att);
+    }
     if ((requestKind & IMAPMessagesRequestKindExtraHeaders) != 0) {
         // custom header request
         char * header;
@@ -2590,7 +4833,19 @@ IMAPSyncResult * IMAPSession::fetchMessages(String * folder, IMAPMessagesRequest
     msg_att_data.needsGmailLabels = needsGmailLabels;
     msg_att_data.needsGmailMessageID = needsGmailMessageID;
     msg_att_data.needsGmailThreadID = needsGmailThreadID;
-    mailimap_set_msg_att_handler(mImap, msg_att_handler, &msg_att_data);
+    msg_att_data.timing = mOperationTiming;
+    msg_att_data.session = this;
+    msg_att_data.streamCallback = streamCallback;
+    msg_att_data.fetchedCount = 0;
+    if (streamCallback != NULL) {
+        mailimap_set_msg_att_handler(mImap, streamed_msg_att_handler, &msg_att_data);
+    }
+    else if (mOperationTiming != NULL) {
+        mailimap_set_msg_att_handler(mImap, timed_msg_att_handler, &msg_att_data);
+    }
+    else {
+        mailimap_set_msg_att_handler(mImap, msg_att_handler, &msg_att_data);
+    }
     
     mBodyProgressEnabled = false;
     vanished = NULL;
@@ -2665,7 +4920,7 @@ IMAPSyncResult * IMAPSession::fetchMessages(String * folder, IMAPMessagesRequest
     result->autorelease();
     
     if ((requestKind & IMAPMessagesRequestKindHeaders) != 0) {
-        if (messages->count() == 0) {
+        if (msg_att_data.fetchedCount == 0) {
             unsigned int count;
             
             count = clist_count(fetch_result);
@@ -2675,8 +4930,12 @@ IMAPSyncResult * IMAPSession::fetchMessages(String * folder, IMAPMessagesRequest
 
                 result = fetchMessages(folder, requestKind, fetchByUID,
                     imapset, uidsFilter, numbersFilter,
-                    modseq, NULL, progressCallback, extraHeaders, pError);
-                if (result != NULL) {
+                    modseq, NULL, progressCallback, extraHeaders, streamCallback, pError);
+                if ((result != NULL) && (streamCallback != NULL)) {
+                    // The messages have been delivered through the stream callback.
+                    mNeedsMboxMailWorkaround = true;
+                }
+                else if (result != NULL) {
                     if (result->modifiedOrAddedMessages() != NULL) {
                         if (result->modifiedOrAddedMessages()->count() > 0) {
                             mNeedsMboxMailWorkaround = true;
@@ -2693,69 +4952,246 @@ IMAPSyncResult * IMAPSession::fetchMessages(String * folder, IMAPMessagesRequest
     return result;
 }
 
-Array * IMAPSession::fetchMessagesByUID(String * folder, IMAPMessagesRequestKind requestKind,
-                                        IndexSet * uids, IMAPProgressCallback * progressCallback, ErrorCode * pError)
-{
-    return fetchMessagesByUIDWithExtraHeaders(folder, requestKind, uids, progressCallback, NULL, pError);
-}
-
-
-Array * IMAPSession::fetchMessagesByUIDWithExtraHeaders(String * folder, IMAPMessagesRequestKind requestKind,
-                                                        IndexSet * uids, IMAPProgressCallback * progressCallback,
-                                                        Array * extraHeaders, ErrorCode * pError)
-{
-    struct mailimap_set * imapset = setFromIndexSet(uids);
-    IMAPSyncResult * syncResult = fetchMessages(folder, requestKind, true, imapset, uids, NULL, 0, NULL,
-                                                progressCallback, extraHeaders, pError);
-    if (syncResult == NULL) {
-        mailimap_set_free(imapset);
-        return NULL;
-    }
-    Array * result = syncResult->modifiedOrAddedMessages();
-    result->retain()->autorelease();
-    mailimap_set_free(imapset);
-    return result;
-}
-
-Array * IMAPSession::fetchMessagesByNumber(String * folder, IMAPMessagesRequestKind requestKind,
-                                           IndexSet * numbers, IMAPProgressCallback * progressCallback,
-                                           ErrorCode * pError)
-{
-    return fetchMessagesByNumberWithExtraHeaders(folder, requestKind, numbers, progressCallback, NULL, pError);
-}
-
-Array * IMAPSession::fetchMessagesByNumberWithExtraHeaders(String * folder, IMAPMessagesRequestKind requestKind,
-                                                           IndexSet * numbers, IMAPProgressCallback * progressCallback,
-                                                           Array * extraHeaders, ErrorCode * pError)
-{
-    struct mailimap_set * imapset = setFromIndexSet(numbers);
-    IMAPSyncResult * syncResult = fetchMessages(folder, requestKind, false, imapset, NULL, numbers, 0, NULL,
-                                                progressCallback, extraHeaders, pError);
-    if (syncResult == NULL) {
-        mailimap_set_free(imapset);
-        return NULL;
-    }
-    Array * result = syncResult->modifiedOrAddedMessages();
-    result->retain()->autorelease();
-    mailimap_set_free(imapset);
-    return result;
-}
-
-static int fetch_rfc822(mailimap * session, bool identifier_is_uid,
-                        uint32_t identifier, char ** result, size_t * result_len)
+IMAPSyncResult * IMAPSession::fetchMessagesByUIDWindows(String * folder, IMAPMessagesRequestKind requestKind,
+                                                        IndexSet * uids, uint64_t modseq,
+                                                        IMAPProgressCallback * progressCallback, Array * extraHeaders,
+                                                        IMAPMessageStreamCallback * streamCallback, ErrorCode * pError)
 {
-    struct mailimap_section * section;
-    struct mailimap_fetch_att * fetch_att;
-    struct mailimap_fetch_type * fetch_type;
+    uint64_t lowestUID = 0;
+    uint64_t highestUID = 0;
+    bool openEnded = false;
     
-    section = mailimap_section_new(NULL);
-    fetch_att = mailimap_fetch_att_new_body_peek_section(section);
-    fetch_type = mailimap_fetch_type_new_fetch_att(fetch_att);
-    int r = fetch_imap(session, identifier_is_uid, identifier,
-                       fetch_type, result, result_len);
-    mailimap_fetch_type_free(fetch_type);
-    
-    return r;
+    MC_SAFE_RELEASE(mLastFetchCompletedUids);
+    MC_SAFE_RELEASE(mLastFetchCompletedMessages);
+    
+    if ((mFetchWindowSize != 0) && (uids->rangesCount() > 0)) {
+        selectIfNeeded(folder, pError);
+        if (* pError != ErrorNone)
+            return NULL;
+        
+        lowestUID = RangeLeftBound(uids->allRanges()[0]);
+        highestUID = RangeRightBound(uids->allRanges()[uids->rangesCount() - 1]);
+        if (highestUID == UINT64_MAX) {
+            openEnded = true;
+            highestUID = (mUIDNext > 0) ? mUIDNext - 1 : 0;
+        }
+        if (lowestUID == 0) {
+            lowestUID = 1;
+        }
+    }
+    
+    // Changes since a mod-sequence are usually few: they're fetched in one command.
+    bool changedSince = (modseq != 0) && (mCondstoreEnabled || mQResyncEnabled);
+    // UIDs can be sparse: the number of messages tells whether it's worth several commands.
+    if ((mFetchWindowSize == 0) || changedSince || (highestUID < lowestUID) ||
+        (highestUID - lowestUID < 2 * (uint64_t) mFetchWindowSize) ||
+        (mFolderMsgCount < 2 * mFetchWindowSize)) {
+        struct mailimap_set * imapset = setFromIndexSet(uids);
+        IMAPSyncResult * result = fetchMessages(folder, requestKind, true, imapset, uids, NULL, modseq, NULL,
+                                                progressCallback, extraHeaders, streamCallback, pError);
+        mailimap_set_free(imapset);
+        return result;
+    }
+    
+    // The UID space is fetched by windows, starting with the most recent messages.
+    // The size of the next window is adjusted to the duration of the previous one.
+    unsigned int estimatedCount = mFolderMsgCount;
+    if (highestUID - lowestUID + 1 < estimatedCount) {
+        estimatedCount = (unsigned int) (highestUID - lowestUID + 1);
+    }
+    Array * windowsMessages = Array::array();
+    IndexSet * completedUids = IndexSet::indexSet();
+    IndexSet * vanishedMessages = NULL;
+    unsigned int fetchedCount = 0;
+    uint64_t windowSize = mFetchWindowSize;
+    uint64_t windowHigh = highestUID;
+    bool firstWindow = true;
+    int nRetries = 0;
+    ErrorCode error = ErrorNone;
+    
+    while (1) {
+        uint64_t windowLow = lowestUID;
+        if (windowHigh - lowestUID + 1 > windowSize) {
+            windowLow = windowHigh - windowSize + 1;
+        }
+        
+        IndexSet * windowUids = (IndexSet *) uids->copy()->autorelease();
+        if (firstWindow && openEnded) {
+            // Also get the messages that were added after the folder was selected.
+            windowUids->intersectsRange(RangeMake(windowLow, UINT64_MAX));
+        }
+        else {
+            windowUids->intersectsRange(RangeMake(windowLow, windowHigh - windowLow));
+        }
+        
+        if (windowUids->count() > 0) {
+            if (isOperationCancelled()) {
+                error = ErrorConnection;
+                break;
+            }
+            
+            AutoreleasePool * pool = new AutoreleasePool();
+            
+            FetchWindowProgress * windowProgressCallback = NULL;
+            if (progressCallback != NULL) {
+                windowProgressCallback = new FetchWindowProgress();
+                windowProgressCallback->setOffset(fetchedCount);
+                windowProgressCallback->setEstimatedCount(estimatedCount);
+                windowProgressCallback->setProgressCallback(progressCallback);
+            }
+            
+            double startTime = OperationTiming::currentTime();
+            struct mailimap_set * imapset = setFromIndexSet(windowUids);
+            IMAPSyncResult * windowResult = fetchMessages(folder, requestKind, true, imapset, windowUids, NULL, modseq, NULL,
+                                                          windowProgressCallback, extraHeaders, streamCallback, &error);
+            mailimap_set_free(imapset);
+            double duration = OperationTiming::currentTime() - startTime;
+            
+            MC_SAFE_RELEASE(windowProgressCallback);
+            
+            if (error != ErrorNone) {
+                pool->release();
+                // Resume from the last completed window once reconnected.
+                if (((error == ErrorConnection) || (error == ErrorParse)) && (nRetries < FETCH_WINDOW_MAX_RETRIES) &&
+                    !isOperationCancelled()) {
+                    error = ErrorNone;
+                    nRetries ++;
+                    continue;
+                }
+                break;
+            }
+            nRetries = 0;
+            completedUids->addIndexSet(windowUids);
+            
+            Array * messages = windowResult->modifiedOrAddedMessages();
+            if (messages != NULL) {
+                windowsMessages->addObject(messages);
+                fetchedCount += messages->count();
+            }
+            if (windowResult->vanishedMessages() != NULL) {
+                if (vanishedMessages == NULL) {
+                    vanishedMessages = new IndexSet();
+                }
+                vanishedMessages->addIndexSet(windowResult->vanishedMessages());
+            }
+            if (progressCallback != NULL) {
+                if (fetchedCount > estimatedCount) {
+                    estimatedCount = fetchedCount;
+                }
+                progressCallback->itemsProgress(this, fetchedCount, estimatedCount);
+            }
+            
+            pool->release();
+            
+            if (duration > 0) {
+                double factor = FETCH_WINDOW_TARGET_DURATION / duration;
+                if (factor > 4) {
+                    factor = 4;
+                }
+                else if (factor < 0.25) {
+                    factor = 0.25;
+                }
+                windowSize = (uint64_t) (windowSize * factor);
+                if (windowSize < FETCH_WINDOW_MIN_SIZE) {
+                    windowSize = FETCH_WINDOW_MIN_SIZE;
+                }
+                else if (windowSize > FETCH_WINDOW_MAX_SIZE) {
+                    windowSize = FETCH_WINDOW_MAX_SIZE;
+                }
+            }
+        }
+        
+        firstWindow = false;
+        if (windowLow <= lowestUID) {
+            break;
+        }
+        windowHigh = windowLow - 1;
+    }
+    
+    // Windows were fetched from the most recent messages but messages are returned in ascending order.
+    Array * messages = Array::array();
+    for(int i = (int) windowsMessages->count() - 1 ; i >= 0 ; i --) {
+        messages->addObjectsFromArray((Array *) windowsMessages->objectAtIndex(i));
+    }
+    
+    if (error != ErrorNone) {
+        // The caller can resume from the last completed window.
+        mLastFetchCompletedUids = (IndexSet *) completedUids->retain();
+        mLastFetchCompletedMessages = (Array *) messages->retain();
+        MC_SAFE_RELEASE(vanishedMessages);
+        * pError = error;
+        return NULL;
+    }
+    
+    IMAPSyncResult * result = new IMAPSyncResult();
+    result->setModifiedOrAddedMessages(messages);
+    result->setVanishedMessages(vanishedMessages);
+    result->autorelease();
+    MC_SAFE_RELEASE(vanishedMessages);
+    * pError = ErrorNone;
+    return result;
+}
+
+Array * IMAPSession::fetchMessagesByUID(String * folder, IMAPMessagesRequestKind requestKind,
+                                        IndexSet * uids, IMAPProgressCallback * progressCallback, ErrorCode * pError)
+{
+    return fetchMessagesByUIDWithExtraHeaders(folder, requestKind, uids, progressCallback, NULL, pError);
+}
+
+
+Array * IMAPSession::fetchMessagesByUIDWithExtraHeaders(String * folder, IMAPMessagesRequestKind requestKind,
+                                                        IndexSet * uids, IMAPProgressCallback * progressCallback,
+                                                        Array * extraHeaders, ErrorCode * pError)
+{
+    IMAPSyncResult * syncResult = fetchMessagesByUIDWindows(folder, requestKind, uids, 0,
+                                                            progressCallback, extraHeaders, NULL, pError);
+    if (syncResult == NULL) {
+        return NULL;
+    }
+    Array * result = syncResult->modifiedOrAddedMessages();
+    result->retain()->autorelease();
+    return result;
+}
+
+Array * IMAPSession::fetchMessagesByNumber(String * folder, IMAPMessagesRequestKind requestKind,
+                                           IndexSet * numbers, IMAPProgressCallback * progressCallback,
+                                           ErrorCode * pError)
+{
+    return fetchMessagesByNumberWithExtraHeaders(folder, requestKind, numbers, progressCallback, NULL, pError);
+}
+
+Array * IMAPSession::fetchMessagesByNumberWithExtraHeaders(String * folder, IMAPMessagesRequestKind requestKind,
+                                                           IndexSet * numbers, IMAPProgressCallback * progressCallback,
+                                                           Array * extraHeaders, ErrorCode * pError)
+{
+    struct mailimap_set * imapset = setFromIndexSet(numbers);
+    IMAPSyncResult * syncResult = fetchMessages(folder, requestKind, false, imapset, NULL, numbers, 0, NULL,
+                                                progressCallback, extraHeaders, NULL, pError);
+    if (syncResult == NULL) {
+        mailimap_set_free(imapset);
+        return NULL;
+    }
+    Array * result = syncResult->modifiedOrAddedMessages();
+    result->retain()->autorelease();
+    mailimap_set_free(imapset);
+    return result;
+}
+
+static int fetch_rfc822(mailimap * session, bool identifier_is_uid,
+                        uint32_t identifier, char ** result, size_t * result_len)
+{
+    struct mailimap_section * section;
+    struct mailimap_fetch_att * fetch_att;
+    struct mailimap_fetch_type * fetch_type;
+    
+    section = mailimap_section_new(NULL);
+    fetch_att = mailimap_fetch_att_new_body_peek_section(section);
+    fetch_type = mailimap_fetch_type_new_fetch_att(fetch_att);
+    int r = fetch_imap(session, identifier_is_uid, identifier,
+                       fetch_type, result, result_len);
+    mailimap_fetch_type_free(fetch_type);
+    
+    return r;
     
 #if 0
     int r;
@@ -2847,6 +5283,15 @@ Data * IMAPSession::fetchMessage(String * folder, bool identifier_is_uid, uint32
     if (* pError != ErrorNone)
         return NULL;
     
+    bool useCache = identifier_is_uid && (mBodyCache != NULL);
+    if (useCache) {
+        data = mBodyCache->dataForKey(bodyCacheAccount(), folder, mUIDValidity, identifier, NULL);
+        if (data != NULL) {
+            bodyCacheHitProgress(data, progressCallback);
+            return data;
+        }
+    }
+    
     mProgressItemsCount = 0;
     mProgressCallback = progressCallback;
     
@@ -2888,6 +5333,10 @@ Data * IMAPSession::fetchMessage(String * folder, bool identifier_is_uid, uint32
     mailimap_nstring_free(rfc822);
     * pError = ErrorNone;
     
+    if (useCache) {
+        mBodyCache->setData(data, bodyCacheAccount(), folder, mUIDValidity, identifier, NULL);
+    }
+    
     return data;
 }
 
@@ -2911,10 +5360,6 @@ Data * IMAPSession::fetchNonDecodedMessageAttachment(String * folder, bool ident
     size_t text_length = 0;
     Data * data;
 
-    selectIfNeeded(folder, pError);
-    if (* pError != ErrorNone)
-        return NULL;
-
     mProgressItemsCount = 0;
     mProgressCallback = progressCallback;
     bodyProgress(0, 0);
@@ -2979,10 +5424,251 @@ Data * IMAPSession::fetchNonDecodedMessageAttachment(String * folder, bool ident
     return data;
 }
 
+// The server decodes base64 and quoted-printable when it supports BINARY.
+static bool canFetchBinary(Encoding encoding)
+{
+    return (encoding == EncodingBase64) || (encoding == EncodingQuotedPrintable);
+}
+
+// Returns the value of a FETCH item, such as "BINARY[", in a response line, or NULL when the line doesn't have it.
+// Quoted strings are skipped so that an item name or a brace they contain is not taken into account.
+static const char * fetchItemValue(const char * line, const char * name)
+{
+    size_t nameLength = strlen(name);
+    bool quoted = false;
+    for(const char * p = line ; * p != '\0' ; p ++) {
+        if (quoted) {
+            if ((* p == '\\') && (p[1] != '\0')) {
+                p ++;
+            }
+            else if (* p == '"') {
+                quoted = false;
+            }
+            continue;
+        }
+        if (* p == '"') {
+            quoted = true;
+            continue;
+        }
+        if (((p == line) || (p[-1] == ' ') || (p[-1] == '(')) && (strncasecmp(p, name, nameLength) == 0)) {
+            // BINARY[1.2] or BINARY[1.2]<0> for a partial fetch.
+            const char * value = strchr(p + nameLength, ']');
+            if (value == NULL) {
+                return NULL;
+            }
+            value ++;
+            if (* value == '<') {
+                value = strchr(value, '>');
+                if (value == NULL) {
+                    return NULL;
+                }
+                value ++;
+            }
+            while (* value == ' ') {
+                value ++;
+            }
+            return value;
+        }
+    }
+    return NULL;
+}
+
+// libetpan doesn't know about BINARY: the command is written and the response is read here.
+// pUnsupported is set when the server can't return the decoded part: the encoded content should be fetched instead.
+// When pBinarySize is not NULL, the decoded size of the whole part is also requested with BINARY.SIZE.
+// The folder is expected to be selected.
+Data * IMAPSession::fetchBinaryMessageAttachment(String * folder, bool identifier_is_uid,
+                                                 uint32_t identifier, String * partID,
+                                                 bool wholePart, uint32_t offset, uint32_t length,
+                                                 IMAPProgressCallback * progressCallback,
+                                                 uint32_t * pBinarySize, bool * pUnsupported, ErrorCode * pError)
+{
+    * pUnsupported = false;
+
+    String * command = String::string();
+    command->appendUTF8Format("%sFETCH %u (BINARY.PEEK[%s]", identifier_is_uid ? "UID " : "",
+                              (unsigned int) identifier, MCUTF8(partID));
+    if (!wholePart) {
+        command->appendUTF8Format("<%u.%u>", (unsigned int) offset, (unsigned int) length);
+    }
+    if (pBinarySize != NULL) {
+        * pBinarySize = 0;
+        command->appendUTF8Format(" BINARY.SIZE[%s]", MCUTF8(partID));
+    }
+    command->appendUTF8Characters(")");
+
+    mProgressItemsCount = 0;
+    mProgressCallback = progressCallback;
+    bodyProgress(0, 0);
+
+    Data * data = NULL;
+    bool completed = false;
+    // The line that follows a literal continues the same response.
+    bool continuation = false;
+    int r = writeTaggedCommand(command);
+    if ((r == MAILIMAP_NO_ERROR) && (mailstream_write(mImap->imap_stream, "\r\n", 2) == -1)) {
+        r = MAILIMAP_ERROR_STREAM;
+    }
+    if ((r == MAILIMAP_NO_ERROR) && (mailstream_flush(mImap->imap_stream) == -1)) {
+        r = MAILIMAP_ERROR_STREAM;
+    }
+    while ((r == MAILIMAP_NO_ERROR) && !completed) {
+        char * line = mailimap_read_line(mImap);
+        if (line == NULL) {
+            r = MAILIMAP_ERROR_STREAM;
+            break;
+        }
+
+        const char * condition;
+        if (!continuation && (tagOfResponseLine(mImap, line, &condition) == mImap->imap_tag)) {
+            if (strncasecmp(condition, "OK", 2) != 0) {
+                r = MAILIMAP_ERROR_FETCH;
+                // BAD when the command is not understood, NO [UNKNOWN-CTE] when the server can't decode the part.
+                // Any other NO is a genuine failure, such as a message that has been expunged.
+                if ((strncasecmp(condition, "BAD", 3) == 0) || (strncasecmp(condition, "NO [UNKNOWN-CTE]", 16) == 0)) {
+                    * pUnsupported = true;
+                }
+            }
+            completed = true;
+            continue;
+        }
+
+        if (!continuation && (strncasecmp(line, "* BYE", 5) == 0)) {
+            r = MAILIMAP_ERROR_STREAM;
+            break;
+        }
+
+        // * 12 FETCH (UID 34 BINARY[1.2] ~{2048}
+        const char * value = NULL;
+        const char * sizeValue = NULL;
+        if (continuation || ((strncmp(line, "* ", 2) == 0) && (strstr(line, " FETCH (") != NULL))) {
+            value = fetchItemValue(line, "BINARY[");
+            sizeValue = fetchItemValue(line, "BINARY.SIZE[");
+        }
+        continuation = false;
+        if ((sizeValue != NULL) && (pBinarySize != NULL)) {
+            * pBinarySize = (uint32_t) strtoul(sizeValue, NULL, 10);
+        }
+        if ((value == NULL) || (data != NULL)) {
+            handleUntaggedResponseLine(line);
+            continue;
+        }
+
+        if (strncasecmp(value, "NIL", 3) == 0) {
+            data = Data::data();
+        }
+        else if (* value == '"') {
+            data = Data::data();
+            const char * p = value + 1;
+            while ((* p != '"') && (* p != '\0')) {
+                if ((* p == '\\') && (p[1] != '\0')) {
+                    p ++;
+                }
+                data->appendBytes(p, 1);
+                p ++;
+            }
+            if (* p != '"') {
+                r = MAILIMAP_ERROR_PARSE;
+            }
+        }
+        else if ((* value == '{') || ((value[0] == '~') && (value[1] == '{'))) {
+            // A literal8 (RFC 3516) may hold any byte.
+            size_t literalLength = strtoul(strchr(value, '{') + 1, NULL, 10);
+            size_t readLength = 0;
+            char buffer[8192];
+            data = Data::data();
+            bodyProgress(0, (unsigned int) literalLength);
+            while (readLength < literalLength) {
+                size_t chunkLength = literalLength - readLength;
+                if (chunkLength > sizeof(buffer)) {
+                    chunkLength = sizeof(buffer);
+                }
+                ssize_t count = mailstream_read(mImap->imap_stream, buffer, chunkLength);
+                if (count <= 0) {
+                    r = MAILIMAP_ERROR_STREAM;
+                    break;
+                }
+                data->appendBytes(buffer, (unsigned int) count);
+                readLength += count;
+                bodyProgress((unsigned int) readLength, (unsigned int) literalLength);
+            }
+            continuation = true;
+        }
+        else {
+            r = MAILIMAP_ERROR_PARSE;
+        }
+    }
+
+    mProgressCallback = NULL;
+
+    if (r == MAILIMAP_ERROR_STREAM) {
+        mShouldDisconnect = true;
+        * pError = ErrorConnection;
+        return NULL;
+    }
+    else if (r == MAILIMAP_ERROR_PARSE) {
+        // The rest of the response can't be skipped reliably.
+        mShouldDisconnect = true;
+        * pError = ErrorParse;
+        return NULL;
+    }
+    else if (hasError(r)) {
+        * pError = ErrorFetch;
+        return NULL;
+    }
+    else if (data == NULL) {
+        // The server didn't return the part in a form that could be read.
+        * pUnsupported = true;
+        * pError = ErrorFetch;
+        return NULL;
+    }
+
+    * pError = ErrorNone;
+    return data;
+}
+
 Data * IMAPSession::fetchMessageAttachment(String * folder, bool identifier_is_uid,
                                            uint32_t identifier, String * partID,
                                            Encoding encoding, IMAPProgressCallback * progressCallback, ErrorCode * pError)
 {
+    // UIDVALIDITY and BINARY availability are known once the folder is selected.
+    selectIfNeeded(folder, pError);
+    if (* pError != ErrorNone)
+        return NULL;
+
+    bool useCache = identifier_is_uid && (mBodyCache != NULL);
+    if (useCache) {
+        Data * data = mBodyCache->dataForKey(bodyCacheAccount(), folder, mUIDValidity, identifier, partID);
+        if (data != NULL) {
+            bodyCacheHitProgress(data, progressCallback);
+            return data;
+        }
+    }
+
+    Data * data = fetchMessageAttachmentNoCache(folder, identifier_is_uid, identifier, partID, encoding,
+                                                progressCallback, pError);
+    if (useCache && (data != NULL)) {
+        mBodyCache->setData(data, bodyCacheAccount(), folder, mUIDValidity, identifier, partID);
+    }
+    return data;
+}
+
+Data * IMAPSession::fetchMessageAttachmentNoCache(String * folder, bool identifier_is_uid,
+                                                  uint32_t identifier, String * partID,
+                                                  Encoding encoding, IMAPProgressCallback * progressCallback,
+                                                  ErrorCode * pError)
+{
+    // The folder has been selected by the caller.
+    if (canFetchBinary(encoding) && mBinaryEnabled) {
+        bool unsupported;
+        Data * data = fetchBinaryMessageAttachment(folder, identifier_is_uid, identifier, partID, true, 0, 0,
+                                                   progressCallback, NULL, &unsupported, pError);
+        if (!unsupported) {
+            return data;
+        }
+        // Fall back to the encoded content.
+    }
+
     Data * data = fetchNonDecodedMessageAttachment(folder, identifier_is_uid, identifier, partID, true, 0, 0, encoding, progressCallback, pError);
     if (data) {
         data = data->decodedDataUsingEncoding(encoding);
@@ -3007,23 +5693,59 @@ void IMAPSession::fetchMessageAttachmentToFileByChunksByUID(String * folder, uin
                                                     String * outputFile, uint32_t chunkSize,
                                                     IMAPProgressCallback * progressCallback, ErrorCode * pError)
 {
+    selectIfNeeded(folder, pError);
+    if (* pError != ErrorNone)
+        return;
+
+    bool useBinary = canFetchBinary(encoding) && mBinaryEnabled;
+
     DataStreamDecoder * decoder = new DataStreamDecoder();
-    decoder->setEncoding(encoding);
+    // Chunks fetched with BINARY are already decoded.
+    decoder->setEncoding(useBinary ? EncodingBinary : encoding);
     decoder->setFilename(outputFile);
 
     int nRetries = 0;
     int const maxRetries = 3;
     ErrorCode error = ErrorNone;
     uint32_t offset = 0;
+    // With BINARY, offsets count decoded bytes: the size of the decoded part is requested with the first chunk.
+    uint32_t binarySize = 0;
     while (1) {
+        if (nRetries > 0) {
+            // The connection has been reset: the folder needs to be selected again.
+            selectIfNeeded(folder, &error);
+            if (error != ErrorNone) {
+                if ((error == ErrorConnection || error == ErrorParse) && nRetries < maxRetries) {
+                    error = ErrorNone;
+                    nRetries++;
+                    continue;
+                }
+                break;
+            }
+        }
+
         AutoreleasePool * pool = new AutoreleasePool();
 
         LoadByChunkProgress * chunkProgressCallback = new LoadByChunkProgress();
         chunkProgressCallback->setOffset(offset);
-        chunkProgressCallback->setEstimatedSize(estimatedSize);
+        chunkProgressCallback->setEstimatedSize((useBinary && (binarySize > 0)) ? binarySize : estimatedSize);
         chunkProgressCallback->setProgressCallback(progressCallback);
 
-        Data * data = fetchNonDecodedMessageAttachment(folder, true, uid, partID, false, offset, chunkSize, encoding, chunkProgressCallback, &error);
+        Data * data;
+        if (useBinary) {
+            bool unsupported;
+            data = fetchBinaryMessageAttachment(folder, true, uid, partID, false, offset, chunkSize, chunkProgressCallback,
+                                                (offset == 0) ? &binarySize : NULL, &unsupported, &error);
+            if (unsupported && (offset == 0)) {
+                // The server can't decode this part.
+                useBinary = false;
+                decoder->setEncoding(encoding);
+                data = fetchNonDecodedMessageAttachment(folder, true, uid, partID, false, offset, chunkSize, encoding, chunkProgressCallback, &error);
+            }
+        }
+        else {
+            data = fetchNonDecodedMessageAttachment(folder, true, uid, partID, false, offset, chunkSize, encoding, chunkProgressCallback, &error);
+        }
 
         MC_SAFE_RELEASE(chunkProgressCallback);
 
@@ -3064,9 +5786,16 @@ void IMAPSession::fetchMessageAttachmentToFileByChunksByUID(String * folder, uin
         // Estimated size (extracted from BODYSTRUCTURE info) may be incorrect.
         // Also, server may return chunk with size less than requested.
         // So this detection is some tricky.
-        bool endOfPart = ((encodedSize == 0) ||
-                          (estimatedSize > 0 && (estimatedSize <= offset) && (encodedSize != chunkSize)) ||
-                          (estimatedSize == 0 && encodedSize < chunkSize));
+        bool endOfPart;
+        if (useBinary) {
+            // The server returns a short chunk only at the end of the part.
+            endOfPart = ((encodedSize < chunkSize) || ((binarySize > 0) && (offset >= binarySize)));
+        }
+        else {
+            endOfPart = ((encodedSize == 0) ||
+                         (estimatedSize > 0 && (estimatedSize <= offset) && (encodedSize != chunkSize)) ||
+                         (estimatedSize == 0 && encodedSize < chunkSize));
+        }
         if (endOfPart) {
             break;
         }
@@ -3107,10 +5836,21 @@ void IMAPSession::fetchMessageAttachmentToFileByUID(String * folder, uint32_t ui
     ErrorCode error = ErrorNone;
     selectIfNeeded(folder, &error);
     if (error != ErrorNone) {
+        MC_SAFE_RELEASE(decoder);
         * pError = error;
         return;
     }
 
+    if (mBodyCache != NULL) {
+        Data * data = mBodyCache->dataForKey(bodyCacheAccount(), folder, mUIDValidity, uid, partID);
+        if (data != NULL) {
+            MC_SAFE_RELEASE(decoder);
+            bodyCacheHitProgress(data, progressCallback);
+            * pError = data->writeToFile(outputFile);
+            return;
+        }
+    }
+
     mailimap_set_msg_body_handler(mImap, msg_body_handler, decoder);
 
     fetchNonDecodedMessageAttachment(folder, true, uid, partID, true, 0, 0, encoding, progressCallback, &error);
@@ -3123,6 +5863,10 @@ void IMAPSession::fetchMessageAttachmentToFileByUID(String * folder, uint32_t ui
 
     MC_SAFE_RELEASE(decoder);
 
+    if ((error == ErrorNone) && (mBodyCache != NULL)) {
+        mBodyCache->setDataWithContentsOfFile(outputFile, bodyCacheAccount(), folder, mUIDValidity, uid, partID);
+    }
+
     * pError = error;
 }
 
@@ -3525,14 +6269,733 @@ IndexSet * IMAPSession::search(String * folder, IMAPSearchExpression * expressio
     return result;
 }
 
-void IMAPSession::getQuota(uint32_t *usage, uint32_t *limit, ErrorCode * pError)
+#pragma mark extended search
+
+// libetpan can't send ESEARCH return options: the search expression is written here.
+// parts alternates the text of the command and the strings that need to be sent as literals.
+
+static void appendSearchTextToCommand(Array * parts, const char * text)
 {
-    mailimap_quota_complete_data *quota_data;
-    
-    int r = mailimap_quota_getquotaroot(mImap, "INBOX", &quota_data);
-    if (r == MAILIMAP_ERROR_STREAM) {
-        mShouldDisconnect = true;
-        * pError = ErrorConnection;
+    ((String *) parts->lastObject())->appendUTF8Characters(text);
+}
+
+static void appendSearchStringToCommand(Array * parts, String * value)
+{
+    const char * str = value->UTF8Characters();
+    if (appendAStringToCommand((String *) parts->lastObject(), str)) {
+        return;
+    }
+    parts->addObject(Data::dataWithBytes(str, (unsigned int) strlen(str)));
+    parts->addObject(String::string());
+}
+
+static void appendSearchDateToCommand(Array * parts, time_t date)
+{
+    static const char * months[] = { "Jan", "Feb", "Mar", "Apr", "May", "Jun",
+        "Jul", "Aug", "Sep", "Oct", "Nov", "Dec" };
+    struct tm timeinfo;
+    localtime_r(&date, &timeinfo);
+    ((String *) parts->lastObject())->appendUTF8Format("%i-%s-%i", timeinfo.tm_mday, months[timeinfo.tm_mon],
+                                                       timeinfo.tm_year + 1900);
+}
+
+static void appendSearchSetToCommand(Array * parts, IndexSet * indexSet)
+{
+    struct mailimap_set * set = setFromIndexSet(indexSet);
+    appendSetToCommand((String *) parts->lastObject(), set);
+    mailimap_set_free(set);
+}
+
+static void appendSearchExpressionToCommand(Array * parts, IMAPSearchExpression * expression)
+{
+    switch (expression->kind()) {
+        case IMAPSearchKindAll:
+            appendSearchTextToCommand(parts, "ALL");
+            break;
+        case IMAPSearchKindFrom:
+            appendSearchTextToCommand(parts, "FROM ");
+            appendSearchStringToCommand(parts, expression->value());
+            break;
+        case IMAPSearchKindTo:
+            appendSearchTextToCommand(parts, "TO ");
+            appendSearchStringToCommand(parts, expression->value());
+            break;
+        case IMAPSearchKindCc:
+            appendSearchTextToCommand(parts, "CC ");
+            appendSearchStringToCommand(parts, expression->value());
+            break;
+        case IMAPSearchKindBcc:
+            appendSearchTextToCommand(parts, "BCC ");
+            appendSearchStringToCommand(parts, expression->value());
+            break;
+        case IMAPSearchKindRecipient:
+            appendSearchTextToCommand(parts, "OR OR TO ");
+            appendSearchStringToCommand(parts, expression->value());
+            appendSearchTextToCommand(parts, " CC ");
+            appendSearchStringToCommand(parts, expression->value());
+            appendSearchTextToCommand(parts, " BCC ");
+            appendSearchStringToCommand(parts, expression->value());
+            break;
+        case IMAPSearchKindSubject:
+            appendSearchTextToCommand(parts, "SUBJECT ");
+            appendSearchStringToCommand(parts, expression->value());
+            break;
+        case IMAPSearchKindContent:
+            appendSearchTextToCommand(parts, "TEXT ");
+            appendSearchStringToCommand(parts, expression->value());
+            break;
+        case IMAPSearchKindBody:
+            appendSearchTextToCommand(parts, "BODY ");
+            appendSearchStringToCommand(parts, expression->value());
+            break;
+        case IMAPSearchKindUIDs:
+            appendSearchTextToCommand(parts, "UID ");
+            appendSearchSetToCommand(parts, expression->uids());
+            break;
+        case IMAPSearchKindNumbers:
+            appendSearchSetToCommand(parts, expression->numbers());
+            break;
+        case IMAPSearchKindHeader:
+            appendSearchTextToCommand(parts, "HEADER ");
+            appendSearchStringToCommand(parts, expression->header());
+            appendSearchTextToCommand(parts, " ");
+            appendSearchStringToCommand(parts, expression->value());
+            break;
+        case IMAPSearchKindRead:
+            appendSearchTextToCommand(parts, "SEEN");
+            break;
+        case IMAPSearchKindUnread:
+            appendSearchTextToCommand(parts, "UNSEEN");
+            break;
+        case IMAPSearchKindFlagged:
+            appendSearchTextToCommand(parts, "FLAGGED");
+            break;
+        case IMAPSearchKindUnflagged:
+            appendSearchTextToCommand(parts, "UNFLAGGED");
+            break;
+        case IMAPSearchKindAnswered:
+            appendSearchTextToCommand(parts, "ANSWERED");
+            break;
+        case IMAPSearchKindUnanswered:
+            appendSearchTextToCommand(parts, "UNANSWERED");
+            break;
+        case IMAPSearchKindDraft:
+            appendSearchTextToCommand(parts, "DRAFT");
+            break;
+        case IMAPSearchKindUndraft:
+            appendSearchTextToCommand(parts, "UNDRAFT");
+            break;
+        case IMAPSearchKindDeleted:
+            appendSearchTextToCommand(parts, "DELETED");
+            break;
+        case IMAPSearchKindSpam:
+            appendSearchTextToCommand(parts, "KEYWORD Junk");
+            break;
+        case IMAPSearchKindBeforeDate:
+            appendSearchTextToCommand(parts, "SENTBEFORE ");
+            appendSearchDateToCommand(parts, expression->date());
+            break;
+        case IMAPSearchKindOnDate:
+            appendSearchTextToCommand(parts, "SENTON ");
+            appendSearchDateToCommand(parts, expression->date());
+            break;
+        case IMAPSearchKindSinceDate:
+            appendSearchTextToCommand(parts, "SENTSINCE ");
+            appendSearchDateToCommand(parts, expression->date());
+            break;
+        case IMAPSearchKindBeforeReceivedDate:
+            appendSearchTextToCommand(parts, "BEFORE ");
+            appendSearchDateToCommand(parts, expression->date());
+            break;
+        case IMAPSearchKindOnReceivedDate:
+            appendSearchTextToCommand(parts, "ON ");
+            appendSearchDateToCommand(parts, expression->date());
+            break;
+        case IMAPSearchKindSinceReceivedDate:
+            appendSearchTextToCommand(parts, "SINCE ");
+            appendSearchDateToCommand(parts, expression->date());
+            break;
+        case IMAPSearchKindSizeLarger:
+            ((String *) parts->lastObject())->appendUTF8Format("LARGER %u", (unsigned int) expression->longNumber());
+            break;
+        case IMAPSearchKindSizeSmaller:
+            ((String *) parts->lastObject())->appendUTF8Format("SMALLER %u", (unsigned int) expression->longNumber());
+            break;
+        case IMAPSearchKindGmailThreadID:
+            ((String *) parts->lastObject())->appendUTF8Format("X-GM-THRID %llu", (unsigned long long) expression->longNumber());
+            break;
+        case IMAPSearchKindGmailMessageID:
+            ((String *) parts->lastObject())->appendUTF8Format("X-GM-MSGID %llu", (unsigned long long) expression->longNumber());
+            break;
+        case IMAPSearchKindGmailRaw:
+            appendSearchTextToCommand(parts, "X-GM-RAW ");
+            appendSearchStringToCommand(parts, expression->value());
+            break;
+        case IMAPSearchKindOr:
+            appendSearchTextToCommand(parts, "OR ");
+            appendSearchExpressionToCommand(parts, expression->leftExpression());
+            appendSearchTextToCommand(parts, " ");
+            appendSearchExpressionToCommand(parts, expression->rightExpression());
+            break;
+        case IMAPSearchKindAnd:
+            appendSearchTextToCommand(parts, "(");
+            appendSearchExpressionToCommand(parts, expression->leftExpression());
+            appendSearchTextToCommand(parts, " ");
+            appendSearchExpressionToCommand(parts, expression->rightExpression());
+            appendSearchTextToCommand(parts, ")");
+            break;
+        case IMAPSearchKindNot:
+            appendSearchTextToCommand(parts, "NOT ");
+            appendSearchExpressionToCommand(parts, expression->leftExpression());
+            break;
+
+        default:
+            MCAssert(0);
+            break;
+    }
+}
+
+static bool isSearchKeyword(const char * keyword, size_t length, const char * name)
+{
+    return (strlen(name) == length) && (strncasecmp(keyword, name, length) == 0);
+}
+
+static const char * skipSearchSpaces(const char * p)
+{
+    while (* p == ' ') {
+        p ++;
+    }
+    return p;
+}
+
+// Parses a sequence set such as 2,10:11 directly into ranges.
+static const char * parseSearchSequenceSet(const char * p, IndexSet * result)
+{
+    while (1) {
+        char * end;
+        uint64_t first = strtoull(p, &end, 10);
+        if (end == p) {
+            return p;
+        }
+        uint64_t last = first;
+        p = end;
+        if (* p == ':') {
+            p ++;
+            last = strtoull(p, &end, 10);
+            p = end;
+        }
+        if (last < first) {
+            uint64_t value = first;
+            first = last;
+            last = value;
+        }
+        result->addRange(RangeMake(first, last - first));
+        if (* p != ',') {
+            return p;
+        }
+        p ++;
+    }
+}
+
+// * ESEARCH (TAG "12") UID MIN 2 MAX 47 COUNT 3 ALL 2,10:11
+// * ESEARCH (TAG "13") UID PARTIAL (1:100 2,10:11) COUNT 3
+static void parseESearchResponse(const char * line, IMAPSearchResult * result)
+{
+    const char * p = line + strlen("* ESEARCH");
+    while (1) {
+        p = skipSearchSpaces(p);
+        if (* p == '(') {
+            // Search correlator.
+            p = strchr(p, ')');
+            if (p == NULL) {
+                return;
+            }
+            p ++;
+            continue;
+        }
+
+        const char * keyword = p;
+        while ((* p != 0) && (* p != ' ') && (* p != '\r') && (* p != '\n')) {
+            p ++;
+        }
+        size_t keywordLength = p - keyword;
+        if (keywordLength == 0) {
+            return;
+        }
+        p = skipSearchSpaces(p);
+
+        char * end = NULL;
+        if (isSearchKeyword(keyword, keywordLength, "UID")) {
+            continue;
+        }
+        else if (isSearchKeyword(keyword, keywordLength, "MIN")) {
+            result->setMinUID((uint32_t) strtoul(p, &end, 10));
+            p = end;
+        }
+        else if (isSearchKeyword(keyword, keywordLength, "MAX")) {
+            result->setMaxUID((uint32_t) strtoul(p, &end, 10));
+            p = end;
+        }
+        else if (isSearchKeyword(keyword, keywordLength, "COUNT")) {
+            result->setCount((uint32_t) strtoul(p, &end, 10));
+            p = end;
+        }
+        else if (isSearchKeyword(keyword, keywordLength, "ALL")) {
+            IndexSet * uids = IndexSet::indexSet();
+            p = parseSearchSequenceSet(p, uids);
+            result->setUids(uids);
+        }
+        else if (isSearchKeyword(keyword, keywordLength, "PARTIAL")) {
+            if (* p != '(') {
+                return;
+            }
+            // Skip the requested range.
+            p = strchr(p, ' ');
+            if (p == NULL) {
+                return;
+            }
+            p = skipSearchSpaces(p);
+            IndexSet * uids = IndexSet::indexSet();
+            if (strncasecmp(p, "NIL", 3) == 0) {
+                p += 3;
+            }
+            else {
+                p = parseSearchSequenceSet(p, uids);
+            }
+            if (* p == ')') {
+                p ++;
+            }
+            result->setUids(uids);
+        }
+        else if (* p == '(') {
+            // Unknown return data, such as MODSEQ.
+            int depth = 0;
+            while (* p != 0) {
+                if (* p == '(') {
+                    depth ++;
+                }
+                else if (* p == ')') {
+                    depth --;
+                    if (depth == 0) {
+                        p ++;
+                        break;
+                    }
+                }
+                p ++;
+            }
+        }
+        else {
+            while ((* p != 0) && (* p != ' ') && (* p != '\r') && (* p != '\n')) {
+                p ++;
+            }
+        }
+    }
+}
+
+static void setSearchResultWithUIDs(IMAPSearchResult * result, IndexSet * uids, IMAPSearchReturnOption options)
+{
+    result->setCount(uids->count());
+    if (uids->rangesCount() > 0) {
+        result->setMinUID((uint32_t) uids->allRanges()[0].location);
+        result->setMaxUID((uint32_t) RangeRightBound(uids->allRanges()[uids->rangesCount() - 1]));
+    }
+    if ((options & IMAPSearchReturnOptionAll) != 0) {
+        result->setUids(uids);
+    }
+}
+
+// Returns the indexes at the given positions. Position 0 is the lowest index, or the highest one when fromEnd is true.
+static IndexSet * indexSetWithPositions(IndexSet * indexes, Range positions, bool fromEnd)
+{
+    IndexSet * result = IndexSet::indexSet();
+    uint64_t skipped = positions.location;
+    uint64_t remaining = (positions.length == UINT64_MAX) ? UINT64_MAX : positions.length + 1;
+    unsigned int rangesCount = indexes->rangesCount();
+    Range * ranges = indexes->allRanges();
+    for(unsigned int i = 0 ; (i < rangesCount) && (remaining > 0) ; i ++) {
+        Range range = ranges[fromEnd ? rangesCount - 1 - i : i];
+        uint64_t rangeCount = range.length + 1;
+        if (skipped >= rangeCount) {
+            skipped -= rangeCount;
+            continue;
+        }
+        uint64_t taken = rangeCount - skipped;
+        if (taken > remaining) {
+            taken = remaining;
+        }
+        uint64_t first = fromEnd ? RangeRightBound(range) - skipped - taken + 1 : range.location + skipped;
+        result->addRange(RangeMake(first, taken - 1));
+        remaining -= taken;
+        skipped = 0;
+    }
+    return result;
+}
+
+// Writes a command containing literals. They're synchronizing unless the server supports LITERAL+.
+int IMAPSession::writeCommandWithLiterals(Array * parts)
+{
+    bool literalPlus = mailimap_has_extension(mImap, (char *) "LITERAL+");
+    int r = writeTaggedCommand((String *) parts->objectAtIndex(0));
+    for(unsigned int i = 1 ; (r == MAILIMAP_NO_ERROR) && (i + 1 < parts->count()) ; i += 2) {
+        Data * literal = (Data *) parts->objectAtIndex(i);
+        char literalHeader[32];
+        snprintf(literalHeader, sizeof(literalHeader), literalPlus ? "{%u+}\r\n" : "{%u}\r\n", literal->length());
+        if (mailstream_write(mImap->imap_stream, literalHeader, strlen(literalHeader)) == -1) {
+            return MAILIMAP_ERROR_STREAM;
+        }
+        if (!literalPlus) {
+            r = waitContinuationRequest();
+            if (r != MAILIMAP_NO_ERROR) {
+                return r;
+            }
+        }
+        const char * text = ((String *) parts->objectAtIndex(i + 1))->UTF8Characters();
+        if ((mailstream_write(mImap->imap_stream, literal->bytes(), literal->length()) == -1) ||
+            (mailstream_write(mImap->imap_stream, text, strlen(text)) == -1)) {
+            return MAILIMAP_ERROR_STREAM;
+        }
+    }
+    if ((r == MAILIMAP_NO_ERROR) && (mailstream_write(mImap->imap_stream, "\r\n", 2) == -1)) {
+        r = MAILIMAP_ERROR_STREAM;
+    }
+    if ((r == MAILIMAP_NO_ERROR) && (mailstream_flush(mImap->imap_stream) == -1)) {
+        r = MAILIMAP_ERROR_STREAM;
+    }
+    return r;
+}
+
+IMAPSearchResult * IMAPSession::sendExtendedSearch(IMAPSearchExpression * expression, String * returnOptions, ErrorCode * pError)
+{
+    Array * parts = Array::array();
+    String * command = String::string();
+    command->appendUTF8Format("UID SEARCH RETURN (%s) ", MCUTF8(returnOptions));
+    if (!mYahooServer) {
+        command->appendUTF8Characters("CHARSET utf-8 ");
+    }
+    parts->addObject(command);
+    if (expression == NULL) {
+        appendSearchTextToCommand(parts, "ALL");
+    }
+    else {
+        appendSearchExpressionToCommand(parts, expression);
+    }
+
+    IMAPSearchResult * result = new IMAPSearchResult();
+    result->autorelease();
+    int r = writeCommandWithLiterals(parts);
+    bool completed = false;
+    while ((r == MAILIMAP_NO_ERROR) && !completed) {
+        Data * lineData = readResponseLineWithLiterals();
+        if (lineData == NULL) {
+            r = MAILIMAP_ERROR_STREAM;
+            break;
+        }
+        const char * line = lineData->bytes();
+        bool succeeded;
+        if (isCompletionOfTag(mImap, line, mImap->imap_tag, &succeeded)) {
+            if (!succeeded) {
+                r = MAILIMAP_ERROR_UID_SEARCH;
+            }
+            completed = true;
+        }
+        else if (strncasecmp(line, "* ESEARCH", 9) == 0) {
+            parseESearchResponse(line, result);
+        }
+        else if (strncasecmp(line, "* BYE", 5) == 0) {
+            r = MAILIMAP_ERROR_STREAM;
+        }
+        else {
+            // The folder may change while the search runs.
+            handleUntaggedResponseLine(line);
+        }
+    }
+
+    if (r == MAILIMAP_ERROR_STREAM) {
+        mShouldDisconnect = true;
+        * pError = ErrorConnection;
+        return NULL;
+    }
+    else if (r == MAILIMAP_ERROR_PARSE) {
+        mShouldDisconnect = true;
+        * pError = ErrorParse;
+        return NULL;
+    }
+    else if (hasError(r)) {
+        * pError = ErrorFetch;
+        return NULL;
+    }
+
+    * pError = ErrorNone;
+    return result;
+}
+
+IMAPSearchResult * IMAPSession::extendedSearch(String * folder, IMAPSearchExpression * expression,
+                                               IMAPSearchReturnOption options, ErrorCode * pError)
+{
+    selectIfNeeded(folder, pError);
+    if (* pError != ErrorNone)
+        return NULL;
+
+    if (!mailimap_has_extension(mImap, (char *) "ESEARCH")) {
+        if (expression == NULL) {
+            expression = IMAPSearchExpression::searchAll();
+        }
+        IndexSet * uids = search(folder, expression, pError);
+        if (* pError != ErrorNone)
+            return NULL;
+        IMAPSearchResult * result = new IMAPSearchResult();
+        result->autorelease();
+        setSearchResultWithUIDs(result, uids, options);
+        return result;
+    }
+
+    Array * returnOptions = Array::array();
+    if ((options & IMAPSearchReturnOptionMin) != 0) {
+        returnOptions->addObject(MCSTR("MIN"));
+    }
+    if ((options & IMAPSearchReturnOptionMax) != 0) {
+        returnOptions->addObject(MCSTR("MAX"));
+    }
+    if ((options & IMAPSearchReturnOptionCount) != 0) {
+        returnOptions->addObject(MCSTR("COUNT"));
+    }
+    if ((options & IMAPSearchReturnOptionAll) != 0) {
+        returnOptions->addObject(MCSTR("ALL"));
+    }
+    IMAPSearchResult * result = sendExtendedSearch(expression, returnOptions->componentsJoinedByString(MCSTR(" ")), pError);
+    if ((result != NULL) && ((options & IMAPSearchReturnOptionAll) != 0) && (result->uids() == NULL)) {
+        // ALL is omitted when nothing matched.
+        result->setUids(IndexSet::indexSet());
+    }
+    return result;
+}
+
+IMAPSearchResult * IMAPSession::partialSearch(String * folder, IMAPSearchExpression * expression,
+                                              Range positions, bool fromEnd, ErrorCode * pError)
+{
+    selectIfNeeded(folder, pError);
+    if (* pError != ErrorNone)
+        return NULL;
+
+    // RFC 5267 only allows positive ranges: positions from the end need RFC 9394.
+    bool hasPartial = mailimap_has_extension(mImap, (char *) "PARTIAL") ||
+        (!fromEnd && mailimap_has_extension(mImap, (char *) "CONTEXT=SEARCH"));
+    if (!hasPartial) {
+        IMAPSearchResult * result = extendedSearch(folder, expression,
+                                                   (IMAPSearchReturnOption) (IMAPSearchReturnOptionAll | IMAPSearchReturnOptionCount),
+                                                   pError);
+        if (result == NULL)
+            return NULL;
+        result->setUids(indexSetWithPositions(result->uids(), positions, fromEnd));
+        return result;
+    }
+
+    // Positions are 1-based in the command.
+    uint64_t first = positions.location + 1;
+    uint64_t last = UINT32_MAX;
+    if (positions.length < UINT32_MAX - positions.location) {
+        last = first + positions.length;
+    }
+    if (first > last) {
+        first = last;
+    }
+    String * returnOptions = String::stringWithUTF8Format("PARTIAL %s%llu:%s%llu COUNT",
+                                                          fromEnd ? "-" : "", (unsigned long long) first,
+                                                          fromEnd ? "-" : "", (unsigned long long) last);
+    IMAPSearchResult * result = sendExtendedSearch(expression, returnOptions, pError);
+    if ((result != NULL) && (result->uids() == NULL)) {
+        result->setUids(IndexSet::indexSet());
+    }
+    return result;
+}
+
+static int sortKeyTypeWithKind(IMAPSortKind kind)
+{
+    switch (kind) {
+        case IMAPSortKindArrival:
+            return MAILIMAP_SORT_KEY_ARRIVAL;
+        case IMAPSortKindCc:
+            return MAILIMAP_SORT_KEY_CC;
+        case IMAPSortKindDate:
+            return MAILIMAP_SORT_KEY_DATE;
+        case IMAPSortKindFrom:
+            return MAILIMAP_SORT_KEY_FROM;
+        case IMAPSortKindSize:
+            return MAILIMAP_SORT_KEY_SIZE;
+        case IMAPSortKindSubject:
+            return MAILIMAP_SORT_KEY_SUBJECT;
+        case IMAPSortKindTo:
+            return MAILIMAP_SORT_KEY_TO;
+    }
+    MCAssert(0);
+    return MAILIMAP_SORT_KEY_ARRIVAL;
+}
+
+// Fetches the headers of the messages matching the expression, for the local implementations of SORT and THREAD.
+Array * IMAPSession::fetchMessagesMatchingExpression(String * folder, IMAPSearchExpression * expression, ErrorCode * pError)
+{
+    IndexSet * uids;
+    if (expression == NULL) {
+        uids = IndexSet::indexSetWithRange(RangeMake(1, UINT64_MAX));
+    }
+    else {
+        uids = search(folder, expression, pError);
+        if (* pError != ErrorNone) {
+            return NULL;
+        }
+        if (uids->count() == 0) {
+            return Array::array();
+        }
+    }
+    IMAPMessagesRequestKind requestKind = (IMAPMessagesRequestKind) (IMAPMessagesRequestKindHeaders |
+        IMAPMessagesRequestKindInternalDate | IMAPMessagesRequestKindSize);
+    return fetchMessagesByUID(folder, requestKind, uids, NULL, pError);
+}
+
+Array * IMAPSession::sort(String * folder, Array * criteria, IMAPSearchExpression * expression, ErrorCode * pError)
+{
+    selectIfNeeded(folder, pError);
+    if (* pError != ErrorNone)
+        return NULL;
+
+    if (!mailimap_has_extension(mImap, (char *) "SORT")) {
+        Array * messages = fetchMessagesMatchingExpression(folder, expression, pError);
+        if (* pError != ErrorNone)
+            return NULL;
+        Array * result = Array::array();
+        mc_foreacharray(IMAPMessage, message, IMAPSortCriterion::sortedMessages(messages, criteria)) {
+            result->addObject(Value::valueWithUnsignedIntValue(message->uid()));
+        }
+        return result;
+    }
+
+    const char * charset = "utf-8";
+    if (mYahooServer) {
+        charset = NULL;
+    }
+
+    struct mailimap_sort_key * sortKey = mailimap_sort_key_new_multiple_empty();
+    mc_foreacharray(IMAPSortCriterion, criterion, criteria) {
+        mailimap_sort_key_multiple_add(sortKey, mailimap_sort_key_new(sortKeyTypeWithKind(criterion->kind()),
+                                                                      criterion->isReversed(), NULL));
+    }
+    struct mailimap_search_key * key;
+    if (expression == NULL) {
+        key = mailimap_search_key_new_all();
+    }
+    else {
+        key = searchKeyFromSearchExpression(expression);
+    }
+
+    clist * result_list = NULL;
+    int r = mailimap_uid_sort(mImap, charset, sortKey, key, &result_list);
+    mailimap_sort_key_free(sortKey);
+    mailimap_search_key_free(key);
+    if (r == MAILIMAP_ERROR_STREAM) {
+        mShouldDisconnect = true;
+        * pError = ErrorConnection;
+        return NULL;
+    }
+    else if (r == MAILIMAP_ERROR_PARSE) {
+        mShouldDisconnect = true;
+        * pError = ErrorParse;
+        return NULL;
+    }
+    else if (hasError(r)) {
+        * pError = ErrorFetch;
+        return NULL;
+    }
+
+    Array * result = Array::array();
+    for(clistiter * cur = clist_begin(result_list) ; cur != NULL ; cur = clist_next(cur)) {
+        uint32_t * uid = (uint32_t *) clist_content(cur);
+        result->addObject(Value::valueWithUnsignedIntValue(* uid));
+    }
+    mailimap_sort_result_free(result_list);
+    * pError = ErrorNone;
+    return result;
+}
+
+static Array * threadsWithThreadList(clist * threadList)
+{
+    Array * result = Array::array();
+    for(clistiter * cur = clist_begin(threadList) ; cur != NULL ; cur = clist_next(cur)) {
+        struct mailimap_thread * item = (struct mailimap_thread *) clist_content(cur);
+        IMAPThread * thread = new IMAPThread();
+        thread->setUid(item->th_uid);
+        if ((item->th_children != NULL) && (clist_count(item->th_children) > 0)) {
+            thread->setChildren(threadsWithThreadList(item->th_children));
+        }
+        result->addObject(thread);
+        thread->release();
+    }
+    return result;
+}
+
+Array * IMAPSession::thread(String * folder, IMAPThreadAlgorithm algorithm, IMAPSearchExpression * expression, ErrorCode * pError)
+{
+    selectIfNeeded(folder, pError);
+    if (* pError != ErrorNone)
+        return NULL;
+
+    const char * algorithmName = NULL;
+    switch (algorithm) {
+        case IMAPThreadAlgorithmReferences:
+            algorithmName = MAILIMAP_THREAD_REFERENCES;
+            break;
+        case IMAPThreadAlgorithmOrderedSubject:
+            algorithmName = MAILIMAP_THREAD_ORDEREDSUBJECT;
+            break;
+    }
+
+    String * capability = String::stringWithUTF8Format("THREAD=%s", algorithmName);
+    if (!mailimap_has_extension(mImap, (char *) capability->UTF8Characters())) {
+        Array * messages = fetchMessagesMatchingExpression(folder, expression, pError);
+        if (* pError != ErrorNone)
+            return NULL;
+        return IMAPThread::threadsWithMessages(messages, algorithm);
+    }
+
+    struct mailimap_search_key * key;
+    if (expression == NULL) {
+        key = mailimap_search_key_new_all();
+    }
+    else {
+        key = searchKeyFromSearchExpression(expression);
+    }
+
+    clist * result_list = NULL;
+    int r = mailimap_uid_thread(mImap, algorithmName, key, &result_list);
+    mailimap_search_key_free(key);
+    if (r == MAILIMAP_ERROR_STREAM) {
+        mShouldDisconnect = true;
+        * pError = ErrorConnection;
+        return NULL;
+    }
+    else if (r == MAILIMAP_ERROR_PARSE) {
+        mShouldDisconnect = true;
+        * pError = ErrorParse;
+        return NULL;
+    }
+    else if (hasError(r)) {
+        * pError = ErrorFetch;
+        return NULL;
+    }
+
+    Array * result = threadsWithThreadList(result_list);
+    mailimap_thread_list_free(result_list);
+    * pError = ErrorNone;
+    return result;
+}
+
+void IMAPSession::getQuota(uint32_t *usage, uint32_t *limit, ErrorCode * pError)
+{
+    mailimap_quota_complete_data *quota_data;
+    
+    int r = mailimap_quota_getquotaroot(mImap, "INBOX", &quota_data);
+    if (r == MAILIMAP_ERROR_STREAM) {
+        mShouldDisconnect = true;
+        * pError = ErrorConnection;
         return;
     }
     else if (r == MAILIMAP_ERROR_PARSE) {
@@ -3595,91 +7058,731 @@ void IMAPSession::idle(String * folder, uint32_t lastKnownUID, ErrorCode * pErro
             }
         }
     }
-    
-    r = mailimap_idle(mImap);
-    if (r == MAILIMAP_ERROR_STREAM) {
-        mShouldDisconnect = true;
-        * pError = ErrorConnection;
+    
+    r = mailimap_idle(mImap);
+    if (r == MAILIMAP_ERROR_STREAM) {
+        mShouldDisconnect = true;
+        * pError = ErrorConnection;
+        return;
+    }
+    else if (r == MAILIMAP_ERROR_PARSE) {
+        mShouldDisconnect = true;
+        * pError = ErrorParse;
+        return;
+    }
+    else if (hasError(r)) {
+        * pError = ErrorIdle;
+        return;
+    }
+    
+    if (!mImap->imap_selection_info->sel_has_exists && !mImap->imap_selection_info->sel_has_recent) {
+        int r;
+        r = mailstream_wait_idle(mImap->imap_stream, MAX_IDLE_DELAY);
+        switch (r) {
+            case MAILSTREAM_IDLE_ERROR:
+            case MAILSTREAM_IDLE_CANCELLED:
+            {
+                mShouldDisconnect = true;
+                * pError = ErrorConnection;
+                MCLog("error or cancelled");
+                return;
+            }
+            case MAILSTREAM_IDLE_INTERRUPTED:
+                MCLog("interrupted by user");
+                break;
+            case MAILSTREAM_IDLE_HASDATA:
+                MCLog("something on the socket");
+                break;
+            case MAILSTREAM_IDLE_TIMEOUT:
+                MCLog("idle timeout");
+                break;
+        }
+    }
+    else {
+        MCLog("found info before idling");
+    }
+    
+    r = mailimap_idle_done(mImap);
+    if (r == MAILIMAP_ERROR_STREAM) {
+        mShouldDisconnect = true;
+        * pError = ErrorConnection;
+        return;
+    }
+    else if (r == MAILIMAP_ERROR_PARSE) {
+        mShouldDisconnect = true;
+        * pError = ErrorParse;
+        return;
+    }
+    else if (hasError(r)) {
+        * pError = ErrorIdle;
+        return;
+    }
+    * pError = ErrorNone;
+}
+
+void IMAPSession::interruptIdle()
+{
+    // main thread
+    LOCK();
+    if (mIdleEnabled) {
+        mailstream_interrupt_idle(mImap->imap_stream);
+    }
+    UNLOCK();
+}
+
+void IMAPSession::unsetupIdle()
+{
+    // main thread
+    LOCK();
+    if (mIdleEnabled) {
+        mailstream_unsetup_idle(mImap->imap_stream);
+    }
+    UNLOCK();
+}
+
+#pragma mark notify
+
+static MessageFlag notifyFlagWithName(const char * name, size_t length)
+{
+    static struct {
+        const char * name;
+        MessageFlag flag;
+    } flagNames[] = {
+        {"\\Seen", MessageFlagSeen},
+        {"\\Answered", MessageFlagAnswered},
+        {"\\Flagged", MessageFlagFlagged},
+        {"\\Deleted", MessageFlagDeleted},
+        {"\\Draft", MessageFlagDraft},
+        {"$Forwarded", MessageFlagForwarded},
+        {"$MDNSent", MessageFlagMDNSent},
+        {"$SubmitPending", MessageFlagSubmitPending},
+        {"$Submitted", MessageFlagSubmitted},
+    };
+    for(unsigned int i = 0 ; i < sizeof(flagNames) / sizeof(flagNames[0]) ; i ++) {
+        if ((strlen(flagNames[i].name) == length) && (strncasecmp(flagNames[i].name, name, length) == 0)) {
+            return flagNames[i].flag;
+        }
+    }
+    return MessageFlagNone;
+}
+
+// (UID 4827 FLAGS (\Seen $Forwarded) MODSEQ (12121231000))
+static void parseNotifyFetchResponse(const char * p, IMAPNotifyEvent * event)
+{
+    p = strchr(p, '(');
+    if (p == NULL) {
+        return;
+    }
+    p ++;
+    while ((* p != 0) && (* p != ')')) {
+        while (* p == ' ') {
+            p ++;
+        }
+        const char * item = p;
+        while ((* p != 0) && (* p != ' ') && (* p != ')')) {
+            p ++;
+        }
+        size_t itemLength = p - item;
+        if (itemLength == 0) {
+            break;
+        }
+        while (* p == ' ') {
+            p ++;
+        }
+        char * end;
+        if ((itemLength == 3) && (strncasecmp(item, "UID", 3) == 0)) {
+            event->setUid((uint32_t) strtoul(p, &end, 10));
+            p = end;
+        }
+        else if ((itemLength == 5) && (strncasecmp(item, "FLAGS", 5) == 0) && (* p == '(')) {
+            p ++;
+            int flags = MessageFlagNone;
+            while ((* p != 0) && (* p != ')')) {
+                while (* p == ' ') {
+                    p ++;
+                }
+                const char * name = p;
+                while ((* p != 0) && (* p != ' ') && (* p != ')')) {
+                    p ++;
+                }
+                flags |= notifyFlagWithName(name, p - name);
+            }
+            if (* p == ')') {
+                p ++;
+            }
+            event->setFlags((MessageFlag) flags);
+        }
+        else if ((itemLength == 6) && (strncasecmp(item, "MODSEQ", 6) == 0) && (* p == '(')) {
+            event->setModSequenceValue(strtoull(p + 1, &end, 10));
+            p = end;
+            if (* p == ')') {
+                p ++;
+            }
+        }
+        else {
+            // Other attributes are not requested.
+            break;
+        }
+    }
+}
+
+// Returns NULL for the responses that are not changes.
+static IMAPNotifyEvent * notifyEventWithResponse(const char * line, String * selectedFolder)
+{
+    if (strncmp(line, "* ", 2) != 0) {
+        return NULL;
+    }
+    const char * p = line + 2;
+    if (strncasecmp(p, "STATUS ", 7) == 0) {
+        HashMap * folderStatuses = HashMap::hashMap();
+        addFolderStatusWithStatusResponse(line, folderStatuses);
+        if (folderStatuses->count() == 0) {
+            return NULL;
+        }
+        String * folder = (String *) folderStatuses->allKeys()->objectAtIndex(0);
+        IMAPNotifyEvent * event = new IMAPNotifyEvent();
+        event->setKind(IMAPNotifyEventKindStatus);
+        event->setFolder(folder);
+        event->setStatus((IMAPFolderStatus *) folderStatuses->objectForKey(folder));
+        return (IMAPNotifyEvent *) event->autorelease();
+    }
+    if (strncasecmp(p, "VANISHED ", 9) == 0) {
+        p += 9;
+        if (strncasecmp(p, "(EARLIER) ", 10) == 0) {
+            p += 10;
+        }
+        IndexSet * uids = IndexSet::indexSet();
+        parseSearchSequenceSet(p, uids);
+        IMAPNotifyEvent * event = new IMAPNotifyEvent();
+        event->setKind(IMAPNotifyEventKindVanished);
+        event->setFolder(selectedFolder);
+        event->setUids(uids);
+        return (IMAPNotifyEvent *) event->autorelease();
+    }
+    if ((* p < '0') || (* p > '9')) {
+        return NULL;
+    }
+
+    char * end;
+    uint32_t number = (uint32_t) strtoul(p, &end, 10);
+    p = end;
+    IMAPNotifyEventKind kind;
+    if (strncasecmp(p, " EXISTS", 7) == 0) {
+        kind = IMAPNotifyEventKindExists;
+    }
+    else if (strncasecmp(p, " EXPUNGE", 8) == 0) {
+        kind = IMAPNotifyEventKindExpunge;
+    }
+    else if (strncasecmp(p, " FETCH ", 7) == 0) {
+        kind = IMAPNotifyEventKindFlagsChange;
+    }
+    else {
+        return NULL;
+    }
+    IMAPNotifyEvent * event = new IMAPNotifyEvent();
+    event->setKind(kind);
+    event->setFolder(selectedFolder);
+    event->setNumber(number);
+    if (kind == IMAPNotifyEventKindFlagsChange) {
+        parseNotifyFetchResponse(p, event);
+    }
+    return (IMAPNotifyEvent *) event->autorelease();
+}
+
+int IMAPSession::writeNotifyCommand(const char * command)
+{
+    int r = writeTaggedCommand(String::stringWithUTF8Characters(command));
+    if ((r == MAILIMAP_NO_ERROR) && (mailstream_write(mImap->imap_stream, "\r\n", 2) == -1)) {
+        r = MAILIMAP_ERROR_STREAM;
+    }
+    if ((r == MAILIMAP_NO_ERROR) && (mailstream_flush(mImap->imap_stream) == -1)) {
+        r = MAILIMAP_ERROR_STREAM;
+    }
+    return r;
+}
+
+// libetpan doesn't know about NOTIFY and its IDLE implementation waits for a single folder on a blocked thread:
+// the commands are written and the responses are read here, so that the caller can wait for many connections
+// at once.
+Array * IMAPSession::startNotify(Array * folders, ErrorCode * pError)
+{
+    loginIfNeeded(pError);
+    if (* pError != ErrorNone)
+        return NULL;
+
+    int r;
+    if (mNotifyEnabled) {
+        Array * parts = Array::array();
+        parts->addObject(String::stringWithUTF8Characters("NOTIFY SET STATUS (MAILBOXES ("));
+        for(unsigned int i = 0 ; i < folders->count() ; i ++) {
+            String * command = (String *) parts->lastObject();
+            if (i > 0) {
+                command->appendUTF8Characters(" ");
+            }
+            const char * folder = ((String *) folders->objectAtIndex(i))->UTF8Characters();
+            if (!appendAStringToCommand(command, folder)) {
+                parts->addObject(Data::dataWithBytes(folder, (unsigned int) strlen(folder)));
+                parts->addObject(String::string());
+            }
+        }
+        ((String *) parts->lastObject())->appendUTF8Characters(") (MessageNew MessageExpunge FlagChange))");
+        r = writeCommandWithLiterals(parts);
+    }
+    else {
+        // Only one folder can be watched with IDLE.
+        if (!isIdleEnabled() || (folders->count() != 1)) {
+            * pError = ErrorCapability;
+            return NULL;
+        }
+        selectIfNeeded((String *) folders->objectAtIndex(0), pError);
+        if (* pError != ErrorNone)
+            return NULL;
+        r = writeNotifyCommand("IDLE");
+    }
+
+    Array * result = Array::array();
+    bool completed = false;
+    while ((r == MAILIMAP_NO_ERROR) && !completed) {
+        Data * lineData = readResponseLineWithLiterals();
+        if (lineData == NULL) {
+            r = MAILIMAP_ERROR_STREAM;
+            break;
+        }
+        const char * line = lineData->bytes();
+        bool succeeded;
+        if (isCompletionOfTag(mImap, line, mImap->imap_tag, &succeeded)) {
+            // NOTIFY completes immediately. IDLE only completes when it's rejected.
+            if (!mNotifyEnabled || !succeeded) {
+                * pError = ErrorIdle;
+                return NULL;
+            }
+            completed = true;
+        }
+        else if ((line[0] == '+') && !mNotifyEnabled) {
+            completed = true;
+        }
+        else if (strncasecmp(line, "* BYE", 5) == 0) {
+            r = MAILIMAP_ERROR_STREAM;
+        }
+        else {
+            IMAPNotifyEvent * event = notifyEventWithResponse(line, mCurrentFolder);
+            if (event != NULL) {
+                result->addObject(event);
+            }
+        }
+    }
+    if (r == MAILIMAP_ERROR_STREAM) {
+        mShouldDisconnect = true;
+        * pError = ErrorConnection;
+        return NULL;
+    }
+    else if (hasError(r)) {
+        * pError = ErrorIdle;
+        return NULL;
+    }
+
+    mNotifyMode = mNotifyEnabled ? NOTIFY_MODE_NOTIFY : NOTIFY_MODE_IDLE;
+    mNotifyBuffer->reset();
+    startNotifyTransport();
+    * pError = ErrorNone;
+    return result;
+}
+
+// From now on, the connection is read and written without libetpan when it's a plain socket or an OpenSSL
+// connection, so that the thread of the event loop never waits for the network. Otherwise (COMPRESS,
+// CFNetwork or GnuTLS streams), it falls back to libetpan: a read only happens when the socket is readable
+// but it may wait for the rest of a TLS record.
+void IMAPSession::startNotifyTransport()
+{
+    mNotifyTransport = NOTIFY_TRANSPORT_STREAM;
+    mNotifyWaitsForWritability = false;
+#ifndef _MSC_VER
+    mailstream_low * low = mailstream_get_low(mImap->imap_stream);
+    if (low->driver == mailstream_socket_driver) {
+        mNotifyTransport = NOTIFY_TRANSPORT_SOCKET;
+    }
+#if NOTIFY_USES_OPENSSL
+    else if ((low->driver == mailstream_ssl_driver) && (mNotifySSL != NULL)) {
+        mNotifyTransport = NOTIFY_TRANSPORT_SSL;
+        // The pending data of a write that would block is sent again with the commands queued meanwhile.
+        SSL_set_mode((SSL *) mNotifySSL, SSL_MODE_ENABLE_PARTIAL_WRITE | SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER);
+    }
+#endif
+    if (mNotifyTransport != NOTIFY_TRANSPORT_STREAM) {
+        int fd = notifyFileDescriptor();
+        mNotifySocketFlags = fcntl(fd, F_GETFL);
+        fcntl(fd, F_SETFL, mNotifySocketFlags | O_NONBLOCK);
+    }
+#endif
+}
+
+// libetpan can be used again once the connection is blocking.
+void IMAPSession::stopNotifyTransport()
+{
+#ifndef _MSC_VER
+    if (mNotifyTransport != NOTIFY_TRANSPORT_STREAM) {
+        fcntl(notifyFileDescriptor(), F_SETFL, mNotifySocketFlags);
+    }
+#if NOTIFY_USES_OPENSSL
+    if (mNotifyTransport == NOTIFY_TRANSPORT_SSL) {
+        SSL_clear_mode((SSL *) mNotifySSL, SSL_MODE_ENABLE_PARTIAL_WRITE | SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER);
+    }
+#endif
+#endif
+    mNotifyTransport = NOTIFY_TRANSPORT_STREAM;
+    mNotifyWaitsForWritability = false;
+}
+
+// Returns the number of bytes read, 0 if it would block and -1 on error.
+int IMAPSession::readNotifySocket(char * buffer, size_t size)
+{
+    ssize_t count = -1;
+#if NOTIFY_USES_OPENSSL
+    if (mNotifyTransport == NOTIFY_TRANSPORT_SSL) {
+        SSL * ssl = (SSL *) mNotifySSL;
+        ERR_clear_error();
+        int r = SSL_read(ssl, buffer, (int) size);
+        if (r <= 0) {
+            switch (SSL_get_error(ssl, r)) {
+                case SSL_ERROR_WANT_READ:
+                    return 0;
+                case SSL_ERROR_WANT_WRITE:
+                    // The TLS layer needs to send data first.
+                    mNotifyWaitsForWritability = true;
+                    return 0;
+                default:
+                    return -1;
+            }
+        }
+        count = r;
+    }
+#endif
+#ifndef _MSC_VER
+    if (mNotifyTransport == NOTIFY_TRANSPORT_SOCKET) {
+        count = recv(notifyFileDescriptor(), buffer, size, 0);
+        if ((count < 0) && ((errno == EAGAIN) || (errno == EWOULDBLOCK) || (errno == EINTR))) {
+            return 0;
+        }
+        if (count == 0) {
+            // Closed by the server.
+            return -1;
+        }
+    }
+#endif
+    if (count > 0) {
+        logger(mImap, MAILSTREAM_LOG_TYPE_DATA_RECEIVED, buffer, (size_t) count, this);
+    }
+    return (int) count;
+}
+
+// Returns the number of bytes written, 0 if it would block and -1 on error.
+int IMAPSession::writeNotifySocket(const char * bytes, size_t size)
+{
+    ssize_t count = -1;
+#if NOTIFY_USES_OPENSSL
+    if (mNotifyTransport == NOTIFY_TRANSPORT_SSL) {
+        SSL * ssl = (SSL *) mNotifySSL;
+        ERR_clear_error();
+        int r = SSL_write(ssl, bytes, (int) size);
+        if (r <= 0) {
+            switch (SSL_get_error(ssl, r)) {
+                case SSL_ERROR_WANT_WRITE:
+                    mNotifyWaitsForWritability = true;
+                    return 0;
+                case SSL_ERROR_WANT_READ:
+                    // Sent again when the connection is readable.
+                    return 0;
+                default:
+                    return -1;
+            }
+        }
+        count = r;
+    }
+#endif
+#ifndef _MSC_VER
+    if (mNotifyTransport == NOTIFY_TRANSPORT_SOCKET) {
+        int flags = 0;
+#ifdef MSG_NOSIGNAL
+        flags |= MSG_NOSIGNAL;
+#endif
+        count = send(notifyFileDescriptor(), bytes, size, flags);
+        if ((count < 0) && ((errno == EAGAIN) || (errno == EWOULDBLOCK) || (errno == EINTR))) {
+            mNotifyWaitsForWritability = true;
+            return 0;
+        }
+    }
+#endif
+    if (count > 0) {
+        logger(mImap, MAILSTREAM_LOG_TYPE_DATA_SENT, bytes, (size_t) count, this);
+    }
+    return (int) count;
+}
+
+// Tagged like writeTaggedCommand() does. The command is sent by writeNotifyOutput().
+void IMAPSession::queueNotifyCommand(const char * command)
+{
+    char tag[16];
+
+    mImap->imap_tag ++;
+    formatTag(mImap, mImap->imap_tag, tag, sizeof(tag));
+    mNotifyOutput->appendBytes(tag, (unsigned int) strlen(tag));
+    mNotifyOutput->appendBytes(" ", 1);
+    mNotifyOutput->appendBytes(command, (unsigned int) strlen(command));
+    mNotifyOutput->appendBytes("\r\n", 2);
+    lockConnectionLogger();
+    mMetricsLastSentTag = mImap->imap_tag;
+    if (mConnectionMetrics != NULL) {
+        metricsCommandStarted(tag, command, strlen(command));
+    }
+    unlockConnectionLogger();
+}
+
+// Sends what the connection accepts without blocking. The rest is kept for the next call.
+int IMAPSession::writeNotifyOutput()
+{
+    if (mNotifyOutput->length() == 0) {
+        return MAILIMAP_NO_ERROR;
+    }
+    if (mNotifyTransport == NOTIFY_TRANSPORT_STREAM) {
+        int r = MAILIMAP_NO_ERROR;
+        if ((mailstream_write(mImap->imap_stream, mNotifyOutput->bytes(), mNotifyOutput->length()) == -1) ||
+            (mailstream_flush(mImap->imap_stream) == -1)) {
+            r = MAILIMAP_ERROR_STREAM;
+        }
+        MC_SAFE_RELEASE(mNotifyOutput);
+        mNotifyOutput = new Data();
+        return r;
+    }
+
+    unsigned int written = 0;
+    while (written < mNotifyOutput->length()) {
+        int count = writeNotifySocket(mNotifyOutput->bytes() + written, mNotifyOutput->length() - written);
+        if (count < 0) {
+            return MAILIMAP_ERROR_STREAM;
+        }
+        if (count == 0) {
+            break;
+        }
+        written += (unsigned int) count;
+    }
+    if (written > 0) {
+        mNotifyOutput->setData(Data::dataWithBytes(mNotifyOutput->bytes() + written, mNotifyOutput->length() - written));
+    }
+    return MAILIMAP_NO_ERROR;
+}
+
+// Takes the data received by the connection. What libetpan has already buffered is taken first: the socket
+// won't be reported as readable for it.
+int IMAPSession::fillNotifyBuffer()
+{
+    char buffer[4096];
+    if ((mNotifyTransport == NOTIFY_TRANSPORT_STREAM) || (mImap->imap_stream->read_buffer_len > 0)) {
+        // Through libetpan, when nothing has been buffered, a single read is done: it doesn't block when the
+        // connection is readable.
+        do {
+            size_t length = sizeof(buffer);
+            if ((mImap->imap_stream->read_buffer_len > 0) && (mImap->imap_stream->read_buffer_len < length)) {
+                length = mImap->imap_stream->read_buffer_len;
+            }
+            ssize_t count = mailstream_read(mImap->imap_stream, buffer, length);
+            if (count <= 0) {
+                return MAILIMAP_ERROR_STREAM;
+            }
+            mNotifyBuffer->appendBytes(buffer, (unsigned int) count);
+        } while (mImap->imap_stream->read_buffer_len > 0);
+    }
+    if (mNotifyTransport == NOTIFY_TRANSPORT_STREAM) {
+        return MAILIMAP_NO_ERROR;
+    }
+
+    // Until it would block, so that what OpenSSL has decrypted is taken as well.
+    while (1) {
+        int count = readNotifySocket(buffer, sizeof(buffer));
+        if (count < 0) {
+            return MAILIMAP_ERROR_STREAM;
+        }
+        if (count == 0) {
+            break;
+        }
+        mNotifyBuffer->appendBytes(buffer, (unsigned int) count);
+    }
+    return MAILIMAP_NO_ERROR;
+}
+
+// A partial response is kept until the rest of it is received.
+Array * IMAPSession::readNotifyEvents(ErrorCode * pError)
+{
+    mNotifyWaitsForWritability = false;
+    if ((writeNotifyOutput() != MAILIMAP_NO_ERROR) || (fillNotifyBuffer() != MAILIMAP_NO_ERROR)) {
+        mShouldDisconnect = true;
+        * pError = ErrorConnection;
+        return NULL;
+    }
+
+    Array * result = Array::array();
+    while (1) {
+        Data * lineData = mNotifyBuffer->nextResponse();
+        if (lineData == NULL) {
+            break;
+        }
+        const char * line = lineData->bytes();
+        if (strncasecmp(line, "* BYE", 5) == 0) {
+            mShouldDisconnect = true;
+            * pError = ErrorConnection;
+            return NULL;
+        }
+        // Responses to the keep-alive commands and continuation requests are ignored.
+        IMAPNotifyEvent * event = notifyEventWithResponse(line, mCurrentFolder);
+        if (event != NULL) {
+            result->addObject(event);
+        }
+    }
+
+    * pError = ErrorNone;
+    return result;
+}
+
+bool IMAPSession::notifyWaitsForWritability()
+{
+    return mNotifyWaitsForWritability;
+}
+
+void IMAPSession::notifyKeepAlive(ErrorCode * pError)
+{
+    if (mNotifyMode == NOTIFY_MODE_IDLE) {
+        // Servers close IDLE connections after 30 minutes: IDLE is restarted.
+        mNotifyOutput->appendBytes("DONE\r\n", 6);
+        queueNotifyCommand("IDLE");
+    }
+    else if (mNotifyMode == NOTIFY_MODE_NOTIFY) {
+        queueNotifyCommand("NOOP");
+    }
+    else {
+        * pError = ErrorIdle;
         return;
     }
-    else if (r == MAILIMAP_ERROR_PARSE) {
+    if (writeNotifyOutput() != MAILIMAP_NO_ERROR) {
         mShouldDisconnect = true;
-        * pError = ErrorParse;
+        * pError = ErrorConnection;
         return;
     }
-    else if (hasError(r)) {
-        * pError = ErrorIdle;
+    * pError = ErrorNone;
+}
+
+void IMAPSession::stopNotify(ErrorCode * pError)
+{
+    if (mNotifyMode == NOTIFY_MODE_NONE) {
+        * pError = ErrorNone;
         return;
     }
-    
-    if (!mImap->imap_selection_info->sel_has_exists && !mImap->imap_selection_info->sel_has_recent) {
-        int r;
-        r = mailstream_wait_idle(mImap->imap_stream, MAX_IDLE_DELAY);
-        switch (r) {
-            case MAILSTREAM_IDLE_ERROR:
-            case MAILSTREAM_IDLE_CANCELLED:
-            {
-                mShouldDisconnect = true;
-                * pError = ErrorConnection;
-                MCLog("error or cancelled");
-                return;
+    // The commands that have not been sent yet are written before the last one.
+    stopNotifyTransport();
+    int r = writeNotifyOutput();
+    if (r == MAILIMAP_NO_ERROR) {
+        if (mNotifyMode == NOTIFY_MODE_IDLE) {
+            if ((mailstream_write(mImap->imap_stream, "DONE\r\n", 6) == -1) ||
+                (mailstream_flush(mImap->imap_stream) == -1)) {
+                r = MAILIMAP_ERROR_STREAM;
             }
-            case MAILSTREAM_IDLE_INTERRUPTED:
-                MCLog("interrupted by user");
-                break;
-            case MAILSTREAM_IDLE_HASDATA:
-                MCLog("something on the socket");
-                break;
-            case MAILSTREAM_IDLE_TIMEOUT:
-                MCLog("idle timeout");
-                break;
+        }
+        else {
+            r = writeNotifyCommand("NOTIFY NONE");
         }
     }
-    else {
-        MCLog("found info before idling");
+    mNotifyMode = NOTIFY_MODE_NONE;
+
+    // Waits for the response of the last command, the responses to the keep-alive commands are skipped.
+    // Some of them may already have been received by readNotifyEvents().
+    while (r == MAILIMAP_NO_ERROR) {
+        Data * lineData = mNotifyBuffer->nextResponse();
+        if (lineData == NULL) {
+            r = fillNotifyBuffer();
+            continue;
+        }
+        if (isCompletionOfTag(mImap, lineData->bytes(), mImap->imap_tag, NULL)) {
+            break;
+        }
     }
-    
-    r = mailimap_idle_done(mImap);
-    if (r == MAILIMAP_ERROR_STREAM) {
+    mNotifyBuffer->reset();
+    if (r != MAILIMAP_NO_ERROR) {
         mShouldDisconnect = true;
         * pError = ErrorConnection;
         return;
     }
-    else if (r == MAILIMAP_ERROR_PARSE) {
-        mShouldDisconnect = true;
-        * pError = ErrorParse;
-        return;
-    }
-    else if (hasError(r)) {
-        * pError = ErrorIdle;
-        return;
+    // The changes of the selected folder were not tracked by libetpan: it will be selected again.
+    if (mState == STATE_SELECTED) {
+        mState = STATE_LOGGEDIN;
+        setSelectedFolder(NULL);
     }
     * pError = ErrorNone;
 }
 
-void IMAPSession::interruptIdle()
+int IMAPSession::notifyFileDescriptor()
 {
-    // main thread
+    if ((mImap == NULL) || (mImap->imap_stream == NULL)) {
+        return -1;
+    }
+    return mailstream_low_get_fd(mailstream_get_low(mImap->imap_stream));
+}
+
+void IMAPSession::disconnect()
+{
+    unsetup();
+}
+
+void IMAPSession::cancelCurrentOperation()
+{
+    // any thread
     LOCK();
-    if (mIdleEnabled) {
-        mailstream_interrupt_idle(mImap->imap_stream);
+    if ((mImap != NULL) && (mImap->imap_stream != NULL) && !mOperationCancelled) {
+        mOperationCancelled = true;
+        mCancellationTime = OperationTiming::currentTime();
+        mailstream_cancel(mImap->imap_stream);
     }
     UNLOCK();
 }
 
-void IMAPSession::unsetupIdle()
+bool IMAPSession::isOperationCancelled()
 {
-    // main thread
     LOCK();
-    if (mIdleEnabled) {
-        mailstream_unsetup_idle(mImap->imap_stream);
-    }
+    bool cancelled = mOperationCancelled;
     UNLOCK();
+    return cancelled;
 }
 
-void IMAPSession::disconnect()
+double IMAPSession::lastCancellationDelay()
+{
+    return mLastCancellationDelay;
+}
+
+void IMAPSession::operationWillStart()
+{
+    resetCancellation();
+}
+
+void IMAPSession::cancelledOperationFinished()
+{
+    double cancellationTime = mCancellationTime;
+    if (resetCancellation()) {
+        mLastCancellationDelay = OperationTiming::currentTime() - cancellationTime;
+        MCLog("operation interrupted in %g s", mLastCancellationDelay);
+    }
+}
+
+// A cancelled stream can't be used anymore. Returns true if the session had to be disconnected.
+bool IMAPSession::resetCancellation()
 {
+    LOCK();
+    bool cancelled = mOperationCancelled;
+    mOperationCancelled = false;
+    UNLOCK();
+    
+    if (!cancelled) {
+        return false;
+    }
     unsetup();
+    mShouldDisconnect = false;
+    return true;
 }
 
 IMAPIdentity * IMAPSession::identity(IMAPIdentity * clientIdentity, ErrorCode * pError)
@@ -3741,6 +7844,13 @@ IMAPIdentity * IMAPSession::identity(IMAPIdentity * clientIdentity, ErrorCode *
     return result;
 }
 
+void IMAPSession::bodyCacheHitProgress(Data * data, IMAPProgressCallback * progressCallback)
+{
+    mProgressCallback = progressCallback;
+    bodyProgress(data->length(), data->length());
+    mProgressCallback = NULL;
+}
+
 void IMAPSession::bodyProgress(unsigned int current, unsigned int maximum)
 {
     if (!mBodyProgressEnabled)
@@ -3871,6 +7981,48 @@ void IMAPSession::storeFlagsAndCustomFlags(String * folder, bool identifier_is_u
 
     setList = splitSet(imap_set, 50);
 
+    if ((mMaximumPipelinedCommands > 1) && (clist_count(setList) > 1) && !mQipServer) {
+        Array * commands = Array::array();
+        for(clistiter * iter = clist_begin(setList) ; iter != NULL ; iter = clist_next(iter)) {
+            struct mailimap_set * current_set;
+            String * command = String::string();
+
+            current_set = (struct mailimap_set *) clist_content(iter);
+            command->appendUTF8Characters(identifier_is_uid ? "UID STORE " : "STORE ");
+            appendSetToCommand(command, current_set);
+            switch (kind) {
+                case IMAPStoreFlagsRequestKindRemove:
+                command->appendUTF8Characters(" -FLAGS.SILENT ");
+                break;
+                case IMAPStoreFlagsRequestKindAdd:
+                command->appendUTF8Characters(" +FLAGS.SILENT ");
+                break;
+                case IMAPStoreFlagsRequestKindSet:
+                command->appendUTF8Characters(" FLAGS.SILENT ");
+                break;
+            }
+            appendFlagListToCommand(command, flags, customFlags);
+            commands->addObject(command);
+        }
+
+        r = sendPipelinedCommands(commands, mMaximumPipelinedCommands, NULL, NULL);
+        if (r == MAILIMAP_ERROR_STREAM) {
+            mShouldDisconnect = true;
+            * pError = ErrorConnection;
+        }
+        else if (r == MAILIMAP_ERROR_PARSE) {
+            mShouldDisconnect = true;
+            * pError = ErrorParse;
+        }
+        else if (hasError(r)) {
+            * pError = ErrorStore;
+        }
+        else {
+            * pError = ErrorNone;
+        }
+        goto release_sets;
+    }
+
     flag_list = mailimap_flag_list_new_empty();
     if ((flags & MessageFlagSeen) != 0) {
         struct mailimap_flag * f;
@@ -3990,6 +8142,9 @@ void IMAPSession::storeFlagsAndCustomFlags(String * folder, bool identifier_is_u
     * pError = ErrorNone;
 
     release:
+    mailimap_store_att_flags_free(store_att_flags);
+
+    release_sets:
     for(clistiter * iter = clist_begin(setList) ; iter != NULL ; iter = clist_next(iter)) {
         struct mailimap_set * current_set;
 
@@ -3997,7 +8152,6 @@ void IMAPSession::storeFlagsAndCustomFlags(String * folder, bool identifier_is_u
         mailimap_set_free(current_set);
     }
     clist_free(setList);
-    mailimap_store_att_flags_free(store_att_flags);
     mailimap_set_free(imap_set);
 }
 
@@ -4046,6 +8200,66 @@ void IMAPSession::storeLabels(String * folder, bool identifier_is_uid, IndexSet
         mailimap_msg_att_xgmlabels_add(xgmlabels, strdup(label->UTF8Characters()));
     }
 
+    if ((mMaximumPipelinedCommands > 1) && (clist_count(setList) > 1)) {
+        String * labelsList = String::string();
+        bool canPipeline = true;
+        labelsList->appendUTF8Characters("(");
+        for(unsigned int i = 0 ; i < labels->count() ; i ++) {
+            String * label = (String *) labels->objectAtIndex(i);
+            if (i > 0) {
+                labelsList->appendUTF8Characters(" ");
+            }
+            if (!appendAStringToCommand(labelsList, label->UTF8Characters())) {
+                canPipeline = false;
+                break;
+            }
+        }
+        labelsList->appendUTF8Characters(")");
+
+        if (canPipeline) {
+            Array * commands = Array::array();
+            for(clistiter * iter = clist_begin(setList) ; iter != NULL ; iter = clist_next(iter)) {
+                struct mailimap_set * current_set;
+                String * command = String::string();
+
+                current_set = (struct mailimap_set *) clist_content(iter);
+                command->appendUTF8Characters(identifier_is_uid ? "UID STORE " : "STORE ");
+                appendSetToCommand(command, current_set);
+                switch (kind) {
+                    case IMAPStoreFlagsRequestKindRemove:
+                    command->appendUTF8Characters(" -X-GM-LABELS.SILENT ");
+                    break;
+                    case IMAPStoreFlagsRequestKindAdd:
+                    command->appendUTF8Characters(" +X-GM-LABELS.SILENT ");
+                    break;
+                    case IMAPStoreFlagsRequestKindSet:
+                    command->appendUTF8Characters(" X-GM-LABELS.SILENT ");
+                    break;
+                }
+                command->appendString(labelsList);
+                commands->addObject(command);
+            }
+
+            r = sendPipelinedCommands(commands, mMaximumPipelinedCommands, NULL, NULL);
+            if (r == MAILIMAP_ERROR_STREAM) {
+                mShouldDisconnect = true;
+                * pError = ErrorConnection;
+                goto release;
+            }
+            else if (r == MAILIMAP_ERROR_PARSE) {
+                mShouldDisconnect = true;
+                * pError = ErrorParse;
+                goto release;
+            }
+            else if (hasError(r)) {
+                * pError = ErrorStore;
+                goto release;
+            }
+            * pError = ErrorNone;
+            goto release;
+        }
+    }
+
     for(clistiter * iter = clist_begin(setList) ; iter != NULL ; iter = clist_next(iter)) {
         struct mailimap_set * current_set;
         int fl_sign;
@@ -4123,6 +8337,69 @@ uint32_t IMAPSession::firstUnseenUid()
     return mFirstUnseenUid;
 }
 
+IMAPFolderStatus * IMAPSession::cachedFolderStatus(String * folder)
+{
+    IMAPFolderStatus * status = (IMAPFolderStatus *) mCachedFolderStatuses->objectForKey(folder);
+    if (status == NULL) {
+        return NULL;
+    }
+    return (IMAPFolderStatus *) status->copy()->autorelease();
+}
+
+IMAPSyncResult * IMAPSession::changesSinceLastSelect(uint64_t * pModSequenceValue)
+{
+    if ((mState != STATE_SELECTED) || (mSelectChanges == NULL)) {
+        return NULL;
+    }
+    * pModSequenceValue = mSelectChangesModSequenceValue;
+    return mSelectChanges;
+}
+
+void IMAPSession::setSelectedFolder(String * folder)
+{
+    pthread_mutex_lock(&mSelectionLock);
+    MC_SAFE_REPLACE_COPY(String, mSelectedFolder, folder);
+    pthread_mutex_unlock(&mSelectionLock);
+}
+
+String * IMAPSession::selectedFolder()
+{
+    String * result;
+    pthread_mutex_lock(&mSelectionLock);
+    result = mSelectedFolder;
+    MC_SAFE_RETAIN(result);
+    pthread_mutex_unlock(&mSelectionLock);
+    if (result == NULL) {
+        return NULL;
+    }
+    return (String *) result->autorelease();
+}
+
+void IMAPSession::selectAvoided()
+{
+    pthread_mutex_lock(&mSelectionLock);
+    mSelectsAvoidedCount ++;
+    pthread_mutex_unlock(&mSelectionLock);
+}
+
+unsigned int IMAPSession::selectsCount()
+{
+    unsigned int result;
+    pthread_mutex_lock(&mSelectionLock);
+    result = mSelectsCount;
+    pthread_mutex_unlock(&mSelectionLock);
+    return result;
+}
+
+unsigned int IMAPSession::selectsAvoidedCount()
+{
+    unsigned int result;
+    pthread_mutex_lock(&mSelectionLock);
+    result = mSelectsAvoidedCount;
+    pthread_mutex_unlock(&mSelectionLock);
+    return result;
+}
+
 IMAPSyncResult * IMAPSession::syncMessagesByUID(String * folder, IMAPMessagesRequestKind requestKind,
                                                 IndexSet * uids, uint64_t modseq,
                                                 IMAPProgressCallback * progressCallback, ErrorCode * pError)
@@ -4135,14 +8412,32 @@ IMAPSyncResult * IMAPSession::syncMessagesByUIDWithExtraHeaders(String * folder,
                                                 IMAPProgressCallback * progressCallback, Array * extraHeaders,
                                                 ErrorCode * pError)
 {
-    struct mailimap_set * imapset = setFromIndexSet(uids);
-    IMAPSyncResult * result = fetchMessages(folder, requestKind, true, imapset,
-                                            uids, NULL,
-                                            modseq, NULL,
-                                            progressCallback, extraHeaders, pError);
-    mailimap_set_free(imapset);
-    return result;
+    return fetchMessagesByUIDWindows(folder, requestKind, uids, modseq,
+                                     progressCallback, extraHeaders, NULL, pError);
+}
+
+IndexSet * IMAPSession::streamMessagesByUID(String * folder, IMAPMessagesRequestKind requestKind,
+                                            IndexSet * uids, uint64_t modseq, Array * extraHeaders,
+                                            IMAPMessageStreamCallback * streamCallback,
+                                            IMAPProgressCallback * progressCallback, ErrorCode * pError)
+{
+    IMAPSyncResult * result = fetchMessagesByUIDWindows(folder, requestKind, uids, modseq,
+                                                        progressCallback, extraHeaders, streamCallback, pError);
+    if (result == NULL) {
+        return NULL;
+    }
+    return result->vanishedMessages();
+}
 
+void IMAPSession::streamMessagesByNumber(String * folder, IMAPMessagesRequestKind requestKind,
+                                         IndexSet * numbers, Array * extraHeaders,
+                                         IMAPMessageStreamCallback * streamCallback,
+                                         IMAPProgressCallback * progressCallback, ErrorCode * pError)
+{
+    struct mailimap_set * imapset = setFromIndexSet(numbers);
+    fetchMessages(folder, requestKind, false, imapset, NULL, numbers, 0, NULL,
+                  progressCallback, extraHeaders, streamCallback, pError);
+    mailimap_set_free(imapset);
 }
 
 IndexSet * IMAPSession::capability(ErrorCode * pError)
@@ -4238,6 +8533,42 @@ void IMAPSession::capabilitySetWithSessionState(IndexSet * capabilities)
     if (mailimap_has_enable(mImap)) {
         capabilities->addIndex(IMAPCapabilityEnable);
     }
+    if (mailimap_has_extension(mImap, (char *)"BINARY")) {
+        capabilities->addIndex(IMAPCapabilityBinary);
+    }
+    if (mailimap_has_extension(mImap, (char *)"PREVIEW")) {
+        capabilities->addIndex(IMAPCapabilityPreview);
+    }
+    if (mailimap_has_extension(mImap, (char *)"LITERAL+")) {
+        capabilities->addIndex(IMAPCapabilityLiteralPlus);
+    }
+    if (mailimap_has_extension(mImap, (char *)"MULTIAPPEND")) {
+        capabilities->addIndex(IMAPCapabilityMultiAppend);
+    }
+    if (mailimap_has_extension(mImap, (char *)"SORT")) {
+        capabilities->addIndex(IMAPCapabilitySort);
+    }
+    if (mailimap_has_extension(mImap, (char *)"THREAD=REFERENCES")) {
+        capabilities->addIndex(IMAPCapabilityThreadReferences);
+    }
+    if (mailimap_has_extension(mImap, (char *)"THREAD=ORDEREDSUBJECT")) {
+        capabilities->addIndex(IMAPCapabilityThreadOrderedSubject);
+    }
+    if (mailimap_has_extension(mImap, (char *)"ESEARCH")) {
+        capabilities->addIndex(IMAPCapabilityESearch);
+    }
+    if (mailimap_has_extension(mImap, (char *)"CONTEXT=SEARCH")) {
+        capabilities->addIndex(IMAPCapabilityContextSearch);
+    }
+    if (mailimap_has_extension(mImap, (char *)"PARTIAL")) {
+        capabilities->addIndex(IMAPCapabilityPartial);
+    }
+    if (mailimap_has_extension(mImap, (char *)"LIST-STATUS")) {
+        capabilities->addIndex(IMAPCapabilityListStatus);
+    }
+    if (mailimap_has_extension(mImap, (char *)"NOTIFY")) {
+        capabilities->addIndex(IMAPCapabilityNotify);
+    }
     applyCapabilities(capabilities);
 }
 
@@ -4293,6 +8624,15 @@ void IMAPSession::applyCapabilities(IndexSet * capabilities)
     if (capabilities->containsIndex(IMAPCapabilityCompressDeflate)) {
         mCompressionEnabled = true;
     }
+    if (capabilities->containsIndex(IMAPCapabilityBinary)) {
+        mBinaryEnabled = true;
+    }
+    if (capabilities->containsIndex(IMAPCapabilityPreview)) {
+        mPreviewEnabled = true;
+    }
+    if (capabilities->containsIndex(IMAPCapabilityNotify)) {
+        mNotifyEnabled = true;
+    }
 }
 
 bool IMAPSession::isIdleEnabled()
@@ -4338,6 +8678,16 @@ bool IMAPSession::isCompressionEnabled()
     return mCompressionEnabled;
 }
 
+bool IMAPSession::isBinaryEnabled()
+{
+    return mBinaryEnabled;
+}
+
+bool IMAPSession::isNotifyEnabled()
+{
+    return mNotifyEnabled;
+}
+
 bool IMAPSession::allowsNewPermanentFlags() {
     return mAllowsNewPermanentFlags;
 }
@@ -4375,11 +8725,56 @@ void IMAPSession::unlockConnectionLogger()
     pthread_mutex_unlock(&mConnectionLoggerLock);
 }
 
+void IMAPSession::setOperationTiming(OperationTiming * timing)
+{
+    MC_SAFE_REPLACE_RETAIN(OperationTiming, mOperationTiming, timing);
+}
+
+OperationTiming * IMAPSession::operationTiming()
+{
+    return mOperationTiming;
+}
+
 ConnectionLogger * IMAPSession::connectionLoggerNoLock()
 {
     return mConnectionLogger;
 }
 
+void IMAPSession::setConnectionMetrics(ConnectionMetrics * metrics)
+{
+    lockConnectionLogger();
+    MC_SAFE_REPLACE_RETAIN(ConnectionMetrics, mConnectionMetrics, metrics);
+    unlockConnectionLogger();
+}
+
+ConnectionMetrics * IMAPSession::connectionMetrics()
+{
+    lockConnectionLogger();
+    ConnectionMetrics * result = mConnectionMetrics;
+    unlockConnectionLogger();
+    return result;
+}
+
+ConnectionMetrics * IMAPSession::connectionMetricsNoLock()
+{
+    return mConnectionMetrics;
+}
+
+void IMAPSession::setBodyCache(IMAPBodyCache * cache)
+{
+    MC_SAFE_REPLACE_RETAIN(IMAPBodyCache, mBodyCache, cache);
+}
+
+IMAPBodyCache * IMAPSession::bodyCache()
+{
+    return mBodyCache;
+}
+
+String * IMAPSession::bodyCacheAccount()
+{
+    return String::stringWithUTF8Format("%s@%s", MCUTF8(mUsername), MCUTF8(mHostname));
+}
+
 String * IMAPSession::htmlRendering(IMAPMessage * message, String * folder, ErrorCode * pError)
 {
     HTMLRendererIMAPDataCallback * dataCallback = new HTMLRendererIMAPDataCallback(this, message->uid());
@@ -8,6 +8,8 @@
 
 #ifdef __cplusplus
 
+#include <stdio.h>
+
 namespace mailcore {
     
     extern String * IMAPNamespacePersonal;
@@ -18,9 +20,14 @@ namespace mailcore {
     class IMAPSearchExpression;
     class IMAPFolder;
     class IMAPProgressCallback;
+    class IMAPMessageStreamCallback;
     class IMAPSyncResult;
     class IMAPFolderStatus;
+    class IMAPSearchResult;
+    class IMAPNotifyEvent;
+    class IMAPResponseBuffer;
     class IMAPIdentity;
+    class IMAPBodyCache;
     
     class MAILCORE_EXPORT IMAPSession : public Object {
     public:
@@ -59,6 +66,24 @@ namespace mailcore {
         virtual void setVoIPEnabled(bool enabled);
         virtual bool isVoIPEnabled();
         
+        // Large UID ranges are fetched by windows, starting from the most recent messages. The size of the
+        // windows adapts to the throughput of the server. This is the size of the first window, in UIDs.
+        // Windowing is used only when the folder has at least twice as many messages.
+        // 0 disables windowing. Default is 1000.
+        virtual void setFetchWindowSize(unsigned int windowSize);
+        virtual unsigned int fetchWindowSize();
+        
+        // When a windowed fetch fails, returns the UIDs covered by the windows that were completed, and their
+        // messages. Fetching the other requested UIDs resumes it, for example after reconnecting.
+        // They're NULL when the last fetch by UID succeeded.
+        virtual IndexSet * lastFetchCompletedUids();
+        virtual Array * /* IMAPMessage */ lastFetchCompletedMessages();
+        
+        // When a store flags, store labels, copy or move request is split into several commands, up to this
+        // number of commands are sent before waiting for their completion. Default is 1: no pipelining.
+        virtual void setMaximumPipelinedCommands(unsigned int maximumPipelinedCommands);
+        virtual unsigned int maximumPipelinedCommands();
+        
         // Needed for fetchSubscribedFolders() and fetchAllFolders().
         virtual void setDefaultNamespace(IMAPNamespace * ns);
         virtual IMAPNamespace * defaultNamespace();
@@ -72,6 +97,10 @@ namespace mailcore {
         
         virtual Array * /* IMAPFolder */ fetchSubscribedFolders(ErrorCode * pError);
         virtual Array * /* IMAPFolder */ fetchAllFolders(ErrorCode * pError); // will use xlist if available
+        // Returns all the folders, and sets pFolderStatuses to a map of folder paths to IMAPFolderStatus.
+        // Uses LIST-STATUS (RFC 5819) when available. Otherwise the STATUS commands are pipelined.
+        // Folders that can't be selected have no status.
+        virtual Array * /* IMAPFolder */ fetchAllFoldersWithStatus(HashMap ** pFolderStatuses, ErrorCode * pError);
         
         virtual void renameFolder(String * folder, String * otherName, ErrorCode * pError);
         virtual void deleteFolder(String * folder, ErrorCode * pError);
@@ -86,9 +115,16 @@ namespace mailcore {
                                    IMAPProgressCallback * progressCallback, uint32_t * createdUID, ErrorCode * pError);
         virtual void appendMessageWithCustomFlagsAndDate(String * folder, Data * messageData, MessageFlag flags, Array * customFlags, time_t date,
                                                          IMAPProgressCallback * progressCallback, uint32_t * createdUID, ErrorCode * pError);
+        // The message is read from the file by chunks while it's sent. LITERAL+ is used when available.
         virtual void appendMessageWithCustomFlagsAndDate(String * folder, String * messagePath, MessageFlag flags, Array * customFlags, time_t date,
                                                          IMAPProgressCallback * progressCallback, uint32_t * createdUID, ErrorCode * pError);
 
+        // Bulk import of IMAPAppendItem. MULTIAPPEND is used when available. Otherwise, the APPEND commands are
+        // pipelined (see setMaximumPipelinedCommands()) if the server supports LITERAL+. Returns the UIDs
+        // of the created messages if the server supports UIDPLUS.
+        virtual IndexSet * appendMessages(String * folder, Array * /* IMAPAppendItem */ items,
+                                          IMAPProgressCallback * progressCallback, ErrorCode * pError);
+
         virtual void copyMessages(String * folder, IndexSet * uidSet, String * destFolder,
                                   HashMap ** pUidMapping, ErrorCode * pError);
         
@@ -145,6 +181,18 @@ namespace mailcore {
                                                                    IMAPProgressCallback * progressCallback,
                                                                    Array * extraHeaders, ErrorCode * pError);
         
+        /* Streaming fetch: each message is handed to streamCallback as soon as its FETCH response has been parsed
+           and the parsed response is freed right away. Messages are not accumulated. When modseq is not 0,
+           changes since modseq are fetched and the vanished messages are returned (QRESYNC only). */
+        virtual IndexSet * streamMessagesByUID(String * folder, IMAPMessagesRequestKind requestKind,
+                                               IndexSet * uids, uint64_t modseq, Array * extraHeaders,
+                                               IMAPMessageStreamCallback * streamCallback,
+                                               IMAPProgressCallback * progressCallback, ErrorCode * pError);
+        virtual void streamMessagesByNumber(String * folder, IMAPMessagesRequestKind requestKind,
+                                            IndexSet * numbers, Array * extraHeaders,
+                                            IMAPMessageStreamCallback * streamCallback,
+                                            IMAPProgressCallback * progressCallback, ErrorCode * pError);
+        
         virtual void storeFlagsByUID(String * folder, IndexSet * uids, IMAPStoreFlagsRequestKind kind, MessageFlag flags, ErrorCode * pError);
         virtual void storeFlagsAndCustomFlagsByUID(String * folder, IndexSet * uids, IMAPStoreFlagsRequestKind kind, MessageFlag flags, Array * customFlags, ErrorCode * pError);
         virtual void storeFlagsByNumber(String * folder, IndexSet * numbers, IMAPStoreFlagsRequestKind kind, MessageFlag flags, ErrorCode * pError);
@@ -155,6 +203,24 @@ namespace mailcore {
         
         virtual IndexSet * search(String * folder, IMAPSearchKind kind, String * searchString, ErrorCode * pError);
         virtual IndexSet * search(String * folder, IMAPSearchExpression * expression, ErrorCode * pError);
+        // Returns only the values requested in options, using ESEARCH (RFC 4731) when available.
+        // Otherwise they are computed from a regular search.
+        virtual IMAPSearchResult * extendedSearch(String * folder, IMAPSearchExpression * expression,
+                                                  IMAPSearchReturnOption options, ErrorCode * pError);
+        // Returns one page of the matching UIDs, and the total count. positions are the positions of the UIDs
+        // in the sorted results, starting at 0, from the highest UID when fromEnd is true.
+        // Uses PARTIAL (RFC 5267 and RFC 9394) when available.
+        virtual IMAPSearchResult * partialSearch(String * folder, IMAPSearchExpression * expression,
+                                                 Range positions, bool fromEnd, ErrorCode * pError);
+        
+        // Returns the UIDs of the messages matching the expression (all the messages when NULL), ordered by
+        // the IMAPSortCriterion. Uses SORT (RFC 5256) when available and sorts locally otherwise.
+        virtual Array * /* Value */ sort(String * folder, Array * /* IMAPSortCriterion */ criteria,
+                                         IMAPSearchExpression * expression, ErrorCode * pError);
+        // Returns the conversations of the messages matching the expression (all the messages when NULL).
+        // Uses THREAD (RFC 5256) when the server supports the algorithm and threads locally otherwise.
+        virtual Array * /* IMAPThread */ thread(String * folder, IMAPThreadAlgorithm algorithm,
+                                                IMAPSearchExpression * expression, ErrorCode * pError);
         virtual void getQuota(uint32_t *usage, uint32_t *limit, ErrorCode * pError);
         
         virtual bool setupIdle();
@@ -162,9 +228,35 @@ namespace mailcore {
         virtual void interruptIdle();
         virtual void unsetupIdle();
         
+        // Watches folders for changes without blocking a thread: the connection should be dedicated to it.
+        // Uses NOTIFY (RFC 5465) when available, which watches any number of folders, and IDLE on a single
+        // folder otherwise. Returns the current status of the folders reported by NOTIFY.
+        virtual Array * /* IMAPNotifyEvent */ startNotify(Array * /* String */ folders, ErrorCode * pError);
+        // Reads the changes received from the server. It should be called when notifyFileDescriptor() is readable,
+        // and when it's writable if notifyWaitsForWritability() is true. The connection is used without blocking
+        // when it's a plain socket or an OpenSSL connection. A partial response is kept until the rest of it
+        // is received.
+        virtual Array * /* IMAPNotifyEvent */ readNotifyEvents(ErrorCode * pError);
+        // Should be called every few minutes so that the server and the routers don't close the connection.
+        // It doesn't wait for the response. What can't be sent yet is sent by readNotifyEvents().
+        virtual void notifyKeepAlive(ErrorCode * pError);
+        // Returns true when the connection needs to be writable to go on.
+        virtual bool notifyWaitsForWritability();
+        virtual void stopNotify(ErrorCode * pError);
+        // Socket of the connection, -1 when it's not connected.
+        virtual int notifyFileDescriptor();
+        
         virtual void connect(ErrorCode * pError);
         virtual void disconnect();
         
+        /** Interrupts the network read or write that is in progress. It can be called from any thread.
+         The interrupted operation fails. When the session is used without an operation queue,
+         cancelledOperationFinished() should then be called: the session will reconnect on the next operation. */
+        virtual void cancelCurrentOperation();
+        virtual void cancelledOperationFinished();
+        /** Delay in seconds between the last cancelCurrentOperation() and the return of the interrupted operation. */
+        virtual double lastCancellationDelay();
+        
         virtual void noop(ErrorCode * pError);
         
         virtual HashMap * fetchNamespace(ErrorCode * pError);
@@ -183,6 +275,24 @@ namespace mailcore {
         virtual unsigned int lastFolderMessageCount();
         virtual uint32_t firstUnseenUid();
         
+        /** State of a folder when it was last selected by this session: UIDVALIDITY, UIDNEXT,
+         HIGHESTMODSEQ and number of messages. Returns NULL if the folder has not been selected. */
+        virtual IMAPFolderStatus * cachedFolderStatus(String * folder);
+        /** When QRESYNC is enabled, a folder that has already been selected is selected again with its cached
+         UIDVALIDITY and HIGHESTMODSEQ: the server returns the flags of the messages changed since then and
+         the UIDs of the messages removed. Returns these changes for the selected folder, NULL if the last
+         SELECT didn't return them. pModSequenceValue is set to the mod-sequence they're relative to. */
+        virtual IMAPSyncResult * changesSinceLastSelect(uint64_t * pModSequenceValue);
+        /** Folder that is currently selected, NULL if there's none. It can be called from any thread. */
+        virtual String * selectedFolder();
+        /** Leaves the selected folder without expunging it. UNSELECT is used when the server supports it,
+         otherwise INBOX is selected. */
+        virtual void unselect(ErrorCode * pError);
+        /** Number of SELECT sent and number of SELECT that were not needed because the folder was
+         already selected. They can be called from any thread. */
+        virtual unsigned int selectsCount();
+        virtual unsigned int selectsAvoidedCount();
+        
         virtual bool isIdleEnabled();
         virtual bool isXListEnabled();
         virtual bool isCondstoreEnabled();
@@ -191,6 +301,9 @@ namespace mailcore {
         virtual bool isXOAuthEnabled();
         virtual bool isNamespaceEnabled();
         virtual bool isCompressionEnabled();
+        // Attachments encoded in base64 or quoted-printable are fetched decoded by the server (RFC 3516).
+        virtual bool isBinaryEnabled();
+        virtual bool isNotifyEnabled();
         virtual bool allowsNewPermanentFlags();
       
         virtual String * gmailUserDisplayName() DEPRECATED_ATTRIBUTE;
@@ -198,6 +311,21 @@ namespace mailcore {
         virtual void setConnectionLogger(ConnectionLogger * logger);
         virtual ConnectionLogger * connectionLogger();
         
+        /** Timing of the operation that is currently running. Bytes transferred, connect, login, select
+         and parse durations are added to it. */
+        virtual void setOperationTiming(OperationTiming * timing);
+        virtual OperationTiming * operationTiming();
+        
+        /** Counters of bytes, commands, round-trip durations and TLS handshake durations.
+         It can be shared by several sessions. */
+        virtual void setConnectionMetrics(ConnectionMetrics * metrics);
+        virtual ConnectionMetrics * connectionMetrics();
+        
+        /** On-disk cache used by fetchMessageByUID(), fetchMessageAttachmentByUID() and
+         fetchMessageAttachmentToFileByUID(). It can be shared by several sessions. */
+        virtual void setBodyCache(IMAPBodyCache * cache);
+        virtual IMAPBodyCache * bodyCache();
+        
         /** HTML rendering of the body of the message to be displayed in a web view.*/
         virtual String * htmlRendering(IMAPMessage * message, String * folder, ErrorCode * pError);
         
@@ -233,6 +361,9 @@ namespace mailcore {
         virtual void lockConnectionLogger();
         virtual void unlockConnectionLogger();
         virtual ConnectionLogger * connectionLoggerNoLock();
+        virtual ConnectionMetrics * connectionMetricsNoLock();
+        virtual void operationWillStart();
+        virtual void recordMetrics(mailimap * imap, int logType, const char * buffer, size_t size);
 
     private:
         String * mHostname;
@@ -260,6 +391,19 @@ namespace mailcore {
         bool mXOauth2Enabled;
         bool mNamespaceEnabled;
         bool mCompressionEnabled;
+        bool mBinaryEnabled;
+        bool mPreviewEnabled;
+        bool mNotifyEnabled;
+        int mNotifyMode;
+        // Responses received while folders are watched.
+        IMAPResponseBuffer * mNotifyBuffer;
+        // Commands waiting for the connection to be writable.
+        Data * mNotifyOutput;
+        int mNotifyTransport;
+        bool mNotifyWaitsForWritability;
+        int mNotifySocketFlags;
+        // SSL * of the connection when libetpan uses OpenSSL.
+        void * mNotifySSL;
         bool mIsGmail;
         bool mAllowsNewPermanentFlags;
         String * mWelcomeString;
@@ -276,13 +420,47 @@ namespace mailcore {
         
         unsigned int mLastFetchedSequenceNumber;
         String * mCurrentFolder;
+        // folder -> IMAPFolderStatus
+        HashMap * mCachedFolderStatuses;
+        // Changes returned by the last SELECT with QRESYNC.
+        IMAPSyncResult * mSelectChanges;
+        uint64_t mSelectChangesModSequenceValue;
+        // Copy of mCurrentFolder and counters that can be read from other threads.
+        pthread_mutex_t mSelectionLock;
+        String * mSelectedFolder;
+        unsigned int mSelectsCount;
+        unsigned int mSelectsAvoidedCount;
         pthread_mutex_t mIdleLock;
+        bool mOperationCancelled;
+        double mCancellationTime;
+        double mLastCancellationDelay;
         int mState;
         mailimap * mImap;
         IMAPProgressCallback * mProgressCallback;
         unsigned int mProgressItemsCount;
         ConnectionLogger * mConnectionLogger;
         pthread_mutex_t mConnectionLoggerLock;
+        OperationTiming * mOperationTiming;
+        ConnectionMetrics * mConnectionMetrics;
+        IMAPBodyCache * mBodyCache;
+        bool mMetricsAtLineStart;
+        char mMetricsReceivedTag[16];
+        unsigned int mMetricsReceivedTagLength;
+        // End of the response line being received, to find the literals.
+        char mMetricsLineTail[24];
+        unsigned int mMetricsLineTailLength;
+        uint64_t mMetricsLiteralRemaining;
+        // Last libetpan tag that has been counted.
+        int mMetricsLastSentTag;
+        double mMetricsTLSConnectTime;
+        unsigned int mMetricsPendingCount;
+        char mMetricsPendingTags[8][16];
+        int mMetricsPendingCommands[8];
+        double mMetricsPendingTimes[8];
+        unsigned int mFetchWindowSize;
+        IndexSet * mLastFetchCompletedUids;
+        Array * mLastFetchCompletedMessages;
+        unsigned int mMaximumPipelinedCommands;
         bool mAutomaticConfigurationEnabled;
         bool mAutomaticConfigurationDone;
         bool mShouldDisconnect;
@@ -299,13 +477,49 @@ namespace mailcore {
         static void items_progress(size_t current, size_t maximum, void * context);
         void setup();
         void unsetup();
+        bool resetCancellation();
+        bool isOperationCancelled();
+        int writeTaggedCommand(String * command);
+        void handleUntaggedResponseLine(const char * line);
+        int waitContinuationRequest();
+        int writeNotifyCommand(const char * command);
+        void startNotifyTransport();
+        void stopNotifyTransport();
+        int readNotifySocket(char * buffer, size_t size);
+        int writeNotifySocket(const char * bytes, size_t size);
+        void queueNotifyCommand(const char * command);
+        int writeNotifyOutput();
+        int fillNotifyBuffer();
+        String * bodyCacheAccount();
+        void bodyCacheHitProgress(Data * data, IMAPProgressCallback * progressCallback);
+        void setSelectedFolder(String * folder);
+        void selectAvoided();
+        void leaveFolderIfNeeded(String * folder, ErrorCode * pError);
+        int selectWithKnownStatus(String * folder, IMAPFolderStatus * knownStatus);
+        int writeAppendedMessage(Data * messageData, FILE * messageFile, size_t length,
+                                 MessageFlag flags, Array * customFlags, time_t date,
+                                 bool literalPlus, bool * pFileError);
+        int parseCompletionLine(const char * line, int tag, struct mailimap_response ** pResponse);
+        int readAppendResponse(int tag, uint32_t * pUidValidity, IndexSet * createdUIDs);
+        int sendPipelinedCommands(Array * commands, unsigned int maximumPipelinedCommands,
+                                  HashMap * uidMapping, HashMap * folderStatuses);
+        void resetMetricsState();
+        void metricsCommandSent(mailimap * imap, const char * buffer, size_t size);
+        void metricsCommandStarted(const char * tag, const char * command, size_t size);
+        void metricsDataReceived(const char * buffer, size_t size);
+        void metricsLineEnded();
         char fetchDelimiterIfNeeded(char defaultDelimiter, ErrorCode * pError);
         IMAPSyncResult * fetchMessages(String * folder, IMAPMessagesRequestKind requestKind,
                                        bool fetchByUID, struct mailimap_set * imapset,
                                        IndexSet * uidsFilter, IndexSet * numbersFilter,
                                        uint64_t modseq,
                                        HashMap * mapping, IMAPProgressCallback * progressCallback,
-                                       Array * extraHeaders, ErrorCode * pError);
+                                       Array * extraHeaders, IMAPMessageStreamCallback * streamCallback,
+                                       ErrorCode * pError);
+        IMAPSyncResult * fetchMessagesByUIDWindows(String * folder, IMAPMessagesRequestKind requestKind,
+                                                   IndexSet * uids, uint64_t modseq,
+                                                   IMAPProgressCallback * progressCallback, Array * extraHeaders,
+                                                   IMAPMessageStreamCallback * streamCallback, ErrorCode * pError);
         void capabilitySetWithSessionState(IndexSet * capabilities);
         bool enableFeature(String * feature);
         void enableFeatures();
@@ -316,12 +530,28 @@ namespace mailcore {
         Data * fetchMessageAttachment(String * folder, bool identifier_is_uid,
                                       uint32_t identifier, String * partID,
                                       Encoding encoding, IMAPProgressCallback * progressCallback, ErrorCode * pError);
+        Data * fetchMessageAttachmentNoCache(String * folder, bool identifier_is_uid,
+                                             uint32_t identifier, String * partID,
+                                             Encoding encoding, IMAPProgressCallback * progressCallback, ErrorCode * pError);
         // in case of wholePart is false, receives range [offset, length]
+        // The folder is expected to be selected.
         Data * fetchNonDecodedMessageAttachment(String * folder, bool identifier_is_uid,
                                       uint32_t identifier, String * partID,
                                       bool wholePart, uint32_t offset, uint32_t length,
                                       Encoding encoding, IMAPProgressCallback * progressCallback, ErrorCode * pError);
+        Data * fetchBinaryMessageAttachment(String * folder, bool identifier_is_uid,
+                                            uint32_t identifier, String * partID,
+                                            bool wholePart, uint32_t offset, uint32_t length,
+                                            IMAPProgressCallback * progressCallback,
+                                            uint32_t * pBinarySize, bool * pUnsupported, ErrorCode * pError);
         void storeLabels(String * folder, bool identifier_is_uid, IndexSet * identifiers, IMAPStoreFlagsRequestKind kind, Array * labels, ErrorCode * pError);
+        Array * fetchMessagesMatchingExpression(String * folder, IMAPSearchExpression * expression, ErrorCode * pError);
+        int writeCommandWithLiterals(Array * parts);
+        Data * readResponseLineWithLiterals();
+        String * allFoldersPrefix(ErrorCode * pError);
+        String * folderStatusAttributes();
+        Array * fetchAllFoldersWithListStatus(HashMap * folderStatuses, ErrorCode * pError);
+        IMAPSearchResult * sendExtendedSearch(IMAPSearchExpression * expression, String * returnOptions, ErrorCode * pError);
     };
 
 }
@@ -0,0 +1,198 @@
+//
+//  MCIMAPSortCriterion.cpp
+//  mailcore2
+//
+//  Created by agent on 10/18/26.
+//  Copyright (c) 2026 MailCore. All rights reserved.
+//
+
+#include "MCIMAPSortCriterion.h"
+
+#include "MCIMAPMessage.h"
+#include "MCMessageHeader.h"
+#include "MCAddress.h"
+
+using namespace mailcore;
+
+void IMAPSortCriterion::init()
+{
+    mKind = IMAPSortKindArrival;
+    mReversed = false;
+}
+
+IMAPSortCriterion::IMAPSortCriterion()
+{
+    init();
+}
+
+IMAPSortCriterion::IMAPSortCriterion(IMAPSortCriterion * other)
+{
+    init();
+    setKind(other->kind());
+    setReversed(other->isReversed());
+}
+
+IMAPSortCriterion::~IMAPSortCriterion()
+{
+}
+
+IMAPSortCriterion * IMAPSortCriterion::criterion(IMAPSortKind kind, bool reversed)
+{
+    IMAPSortCriterion * result = new IMAPSortCriterion();
+    result->setKind(kind);
+    result->setReversed(reversed);
+    result->autorelease();
+    return result;
+}
+
+Object * IMAPSortCriterion::copy()
+{
+    return new IMAPSortCriterion(this);
+}
+
+String * IMAPSortCriterion::description()
+{
+    static const char * names[] = { "arrival", "cc", "date", "from", "size", "subject", "to" };
+    return String::stringWithUTF8Format("<%s:%p %s%s>", MCUTF8(className()), this,
+                                        mReversed ? "reverse " : "", names[mKind]);
+}
+
+void IMAPSortCriterion::setKind(IMAPSortKind kind)
+{
+    mKind = kind;
+}
+
+IMAPSortKind IMAPSortCriterion::kind()
+{
+    return mKind;
+}
+
+void IMAPSortCriterion::setReversed(bool reversed)
+{
+    mReversed = reversed;
+}
+
+bool IMAPSortCriterion::isReversed()
+{
+    return mReversed;
+}
+
+// Sort values are computed once per message.
+struct sort_item {
+    IMAPMessage * message;
+    Array * values;
+};
+
+static String * firstMailbox(Array * addresses)
+{
+    if ((addresses == NULL) || (addresses->count() == 0)) {
+        return MCSTR("");
+    }
+    String * mailbox = ((Address *) addresses->objectAtIndex(0))->mailbox();
+    if (mailbox == NULL) {
+        return MCSTR("");
+    }
+    return mailbox->lowercaseString();
+}
+
+static Object * sortValue(IMAPMessage * message, IMAPSortKind kind)
+{
+    MessageHeader * header = message->header();
+    switch (kind) {
+        case IMAPSortKindArrival:
+            return Value::valueWithLongLongValue((long long) header->receivedDate());
+        case IMAPSortKindCc:
+            return firstMailbox(header->cc());
+        case IMAPSortKindDate:
+            // RFC 5256: the internal date is used when there's no sent date.
+            if (header->date() == (time_t) -1) {
+                return Value::valueWithLongLongValue((long long) header->receivedDate());
+            }
+            return Value::valueWithLongLongValue((long long) header->date());
+        case IMAPSortKindFrom:
+            if (header->from() == NULL) {
+                return MCSTR("");
+            }
+            return firstMailbox(Array::arrayWithObject(header->from()));
+        case IMAPSortKindSize:
+            return Value::valueWithUnsignedLongLongValue(message->size());
+        case IMAPSortKindSubject:
+            if (header->subject() == NULL) {
+                return MCSTR("");
+            }
+            return header->subject()->extractedSubject()->lowercaseString();
+        case IMAPSortKindTo:
+            return firstMailbox(header->to());
+    }
+    return MCSTR("");
+}
+
+static int compareValues(IMAPSortKind kind, Object * value, Object * otherValue)
+{
+    if ((kind == IMAPSortKindCc) || (kind == IMAPSortKindFrom) || (kind == IMAPSortKindSubject) ||
+        (kind == IMAPSortKindTo)) {
+        return ((String *) value)->compare((String *) otherValue);
+    }
+    long long number = ((Value *) value)->longLongValue();
+    long long otherNumber = ((Value *) otherValue)->longLongValue();
+    if (number < otherNumber) {
+        return -1;
+    }
+    if (number > otherNumber) {
+        return 1;
+    }
+    return 0;
+}
+
+struct sort_context {
+    Array * criteria;
+};
+
+static int compareItems(void * a, void * b, void * context)
+{
+    struct sort_item * item = (struct sort_item *) ((Value *) a)->pointerValue();
+    struct sort_item * otherItem = (struct sort_item *) ((Value *) b)->pointerValue();
+    Array * criteria = ((struct sort_context *) context)->criteria;
+
+    for(unsigned int i = 0 ; i < criteria->count() ; i ++) {
+        IMAPSortCriterion * criterion = (IMAPSortCriterion *) criteria->objectAtIndex(i);
+        int result = compareValues(criterion->kind(), item->values->objectAtIndex(i), otherItem->values->objectAtIndex(i));
+        if (result != 0) {
+            return criterion->isReversed() ? -result : result;
+        }
+    }
+    if (item->message->uid() < otherItem->message->uid()) {
+        return -1;
+    }
+    if (item->message->uid() > otherItem->message->uid()) {
+        return 1;
+    }
+    return 0;
+}
+
+Array * IMAPSortCriterion::sortedMessages(Array * messages, Array * criteria)
+{
+    unsigned int count = messages->count();
+    struct sort_item * items = (struct sort_item *) malloc(sizeof(* items) * (count > 0 ? count : 1));
+    Array * pointers = Array::array();
+    for(unsigned int i = 0 ; i < count ; i ++) {
+        IMAPMessage * message = (IMAPMessage *) messages->objectAtIndex(i);
+        items[i].message = message;
+        items[i].values = Array::array();
+        mc_foreacharray(IMAPSortCriterion, criterion, criteria) {
+            items[i].values->addObject(sortValue(message, criterion->kind()));
+        }
+        pointers->addObject(Value::valueWithPointerValue(&items[i]));
+    }
+
+    struct sort_context context;
+    context.criteria = criteria;
+    pointers->sortArray(compareItems, &context);
+
+    Array * result = Array::array();
+    mc_foreacharray(Value, pointer, pointers) {
+        result->addObject(((struct sort_item *) pointer->pointerValue())->message);
+    }
+    free(items);
+    return result;
+}
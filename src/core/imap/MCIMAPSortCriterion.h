@@ -0,0 +1,56 @@
+//
+//  MCIMAPSortCriterion.h
+//  mailcore2
+//
+//  Created by agent on 10/18/26.
+//  Copyright (c) 2026 MailCore. All rights reserved.
+//
+
+#ifndef MAILCORE_MCIMAPSORTCRITERION_H
+
+#define MAILCORE_MCIMAPSORTCRITERION_H
+
+#include <MailCore/MCBaseTypes.h>
+#include <MailCore/MCMessageConstants.h>
+
+#ifdef __cplusplus
+
+namespace mailcore {
+    
+    // A key of IMAPSession::sort() (RFC 5256).
+    class MAILCORE_EXPORT IMAPSortCriterion : public Object {
+    public:
+        IMAPSortCriterion();
+        virtual ~IMAPSortCriterion();
+        
+        static IMAPSortCriterion * criterion(IMAPSortKind kind, bool reversed = false);
+        
+        virtual void setKind(IMAPSortKind kind);
+        virtual IMAPSortKind kind();
+        
+        virtual void setReversed(bool reversed);
+        virtual bool isReversed();
+        
+        // Sorts the messages locally using the rules of RFC 5256. Messages should have been fetched
+        // with the headers, the internal date for IMAPSortKindArrival and the size for IMAPSortKindSize.
+        // The UID is used when the criteria are equal.
+        static Array * /* IMAPMessage */ sortedMessages(Array * /* IMAPMessage */ messages,
+                                                        Array * /* IMAPSortCriterion */ criteria);
+        
+    public: // subclass behavior
+        IMAPSortCriterion(IMAPSortCriterion * other);
+        virtual Object * copy();
+        virtual String * description();
+        
+    private:
+        IMAPSortKind mKind;
+        bool mReversed;
+        
+        void init();
+    };
+    
+}
+
+#endif
+
+#endif
@@ -0,0 +1,501 @@
+//
+//  MCIMAPThread.cpp
+//  mailcore2
+//
+//  Created by agent on 10/18/26.
+//  Copyright (c) 2026 MailCore. All rights reserved.
+//
+
+#include "MCIMAPThread.h"
+
+#include <stdlib.h>
+
+#include "MCIMAPMessage.h"
+#include "MCMessageHeader.h"
+
+using namespace mailcore;
+
+void IMAPThread::init()
+{
+    mUid = 0;
+    mChildren = NULL;
+}
+
+IMAPThread::IMAPThread()
+{
+    init();
+}
+
+IMAPThread::IMAPThread(IMAPThread * other)
+{
+    init();
+    setUid(other->uid());
+    if (other->children() != NULL) {
+        Array * children = Array::array();
+        mc_foreacharray(IMAPThread, child, other->children()) {
+            children->addObject(child->copy()->autorelease());
+        }
+        setChildren(children);
+    }
+}
+
+IMAPThread::~IMAPThread()
+{
+    MC_SAFE_RELEASE(mChildren);
+}
+
+Object * IMAPThread::copy()
+{
+    return new IMAPThread(this);
+}
+
+String * IMAPThread::description()
+{
+    String * result = String::string();
+    result->appendUTF8Format("<%s:%p %u", MCUTF8(className()), this, (unsigned int) mUid);
+    if ((mChildren != NULL) && (mChildren->count() > 0)) {
+        result->appendUTF8Format(" %s", MCUTF8(mChildren->description()));
+    }
+    result->appendUTF8Characters(">");
+    return result;
+}
+
+void IMAPThread::setUid(uint32_t uid)
+{
+    mUid = uid;
+}
+
+uint32_t IMAPThread::uid()
+{
+    return mUid;
+}
+
+void IMAPThread::setChildren(Array * children)
+{
+    MC_SAFE_REPLACE_RETAIN(Array, mChildren, children);
+}
+
+Array * IMAPThread::children()
+{
+    return mChildren;
+}
+
+static void addUIDs(IMAPThread * thread, IndexSet * result)
+{
+    if (thread->uid() != 0) {
+        result->addIndex(thread->uid());
+    }
+    if (thread->children() != NULL) {
+        mc_foreacharray(IMAPThread, child, thread->children()) {
+            addUIDs(child, result);
+        }
+    }
+}
+
+IndexSet * IMAPThread::allUIDs()
+{
+    IndexSet * result = IndexSet::indexSet();
+    addUIDs(this, result);
+    return result;
+}
+
+#pragma mark threading
+
+// Containers are stored in an array and linked by index. Container 0 is the parent of the roots.
+struct thread_container {
+    IMAPMessage * message; // not retained
+    int parent;
+    int firstChild;
+    int nextSibling;
+    time_t date;
+};
+
+struct thread_context {
+    struct thread_container * containers;
+    unsigned int count;
+    unsigned int capacity;
+};
+
+static int addContainer(struct thread_context * context, IMAPMessage * message)
+{
+    if (context->count == context->capacity) {
+        context->capacity = (context->capacity == 0) ? 1024 : context->capacity * 2;
+        context->containers = (struct thread_container *) realloc(context->containers,
+                                                                  sizeof(* context->containers) * context->capacity);
+    }
+    int idx = (int) context->count;
+    context->count ++;
+    context->containers[idx].message = message;
+    context->containers[idx].parent = -1;
+    context->containers[idx].firstChild = -1;
+    context->containers[idx].nextSibling = -1;
+    context->containers[idx].date = 0;
+    return idx;
+}
+
+static int containerForMessageID(struct thread_context * context, HashMap * idTable, String * messageID)
+{
+    Value * value = (Value *) idTable->objectForKey(messageID);
+    if (value != NULL) {
+        return value->intValue();
+    }
+    int idx = addContainer(context, NULL);
+    idTable->setObjectForKey(messageID, Value::valueWithIntValue(idx));
+    return idx;
+}
+
+static bool isAncestor(struct thread_context * context, int ancestor, int node)
+{
+    while (node != -1) {
+        if (node == ancestor) {
+            return true;
+        }
+        node = context->containers[node].parent;
+    }
+    return false;
+}
+
+static void unlinkContainer(struct thread_context * context, int node)
+{
+    int parent = context->containers[node].parent;
+    if (parent == -1) {
+        return;
+    }
+    int * pNext = &context->containers[parent].firstChild;
+    while (* pNext != -1) {
+        if (* pNext == node) {
+            * pNext = context->containers[node].nextSibling;
+            break;
+        }
+        pNext = &context->containers[* pNext].nextSibling;
+    }
+    context->containers[node].parent = -1;
+    context->containers[node].nextSibling = -1;
+}
+
+static void linkContainer(struct thread_context * context, int parent, int node)
+{
+    context->containers[node].parent = parent;
+    context->containers[node].nextSibling = context->containers[parent].firstChild;
+    context->containers[parent].firstChild = node;
+}
+
+static void moveChildren(struct thread_context * context, int from, int to)
+{
+    while (context->containers[from].firstChild != -1) {
+        int child = context->containers[from].firstChild;
+        unlinkContainer(context, child);
+        linkContainer(context, to, child);
+    }
+}
+
+static int childrenCount(struct thread_context * context, int node)
+{
+    int count = 0;
+    for(int child = context->containers[node].firstChild ; child != -1 ; child = context->containers[child].nextSibling) {
+        count ++;
+    }
+    return count;
+}
+
+// Removes the containers without message, promoting their children.
+static void pruneContainer(struct thread_context * context, int node)
+{
+    int child = context->containers[node].firstChild;
+    while (child != -1) {
+        int next = context->containers[child].nextSibling;
+        pruneContainer(context, child);
+        if (context->containers[child].message == NULL) {
+            int count = childrenCount(context, child);
+            if (count == 0) {
+                unlinkContainer(context, child);
+            }
+            else if ((node != 0) || (count == 1)) {
+                // Children of an empty root are only promoted when there's only one.
+                unlinkContainer(context, child);
+                moveChildren(context, child, node);
+            }
+        }
+        child = next;
+    }
+}
+
+static String * containerSubject(struct thread_context * context, int node, bool * pIsReply)
+{
+    IMAPMessage * message = context->containers[node].message;
+    if (message == NULL) {
+        int child = context->containers[node].firstChild;
+        if (child == -1) {
+            return NULL;
+        }
+        message = context->containers[child].message;
+        if (message == NULL) {
+            return NULL;
+        }
+    }
+    String * subject = message->header()->subject();
+    if (subject == NULL) {
+        return NULL;
+    }
+    String * baseSubject = subject->extractedSubject();
+    if (pIsReply != NULL) {
+        * pIsReply = !baseSubject->isEqual(subject->stripWhitespace());
+    }
+    if (baseSubject->length() == 0) {
+        return NULL;
+    }
+    return baseSubject->lowercaseString();
+}
+
+// Groups the roots having the same base subject.
+static void groupBySubject(struct thread_context * context)
+{
+    HashMap * subjectTable = HashMap::hashMap();
+    for(int root = context->containers[0].firstChild ; root != -1 ; root = context->containers[root].nextSibling) {
+        bool isReply = false;
+        String * subject = containerSubject(context, root, &isReply);
+        if (subject == NULL) {
+            continue;
+        }
+        Value * value = (Value *) subjectTable->objectForKey(subject);
+        if (value == NULL) {
+            subjectTable->setObjectForKey(subject, Value::valueWithIntValue(root));
+            continue;
+        }
+        int existing = value->intValue();
+        bool existingIsReply = false;
+        containerSubject(context, existing, &existingIsReply);
+        // Prefer an empty container, then a message that is not a reply.
+        if (((context->containers[root].message == NULL) && (context->containers[existing].message != NULL)) ||
+            (existingIsReply && !isReply && (context->containers[existing].message != NULL))) {
+            subjectTable->setObjectForKey(subject, Value::valueWithIntValue(root));
+        }
+    }
+
+    int root = context->containers[0].firstChild;
+    while (root != -1) {
+        int next = context->containers[root].nextSibling;
+        bool isReply = false;
+        String * subject = containerSubject(context, root, &isReply);
+        if (subject == NULL) {
+            root = next;
+            continue;
+        }
+        int other = ((Value *) subjectTable->objectForKey(subject))->intValue();
+        if (other == root) {
+            root = next;
+            continue;
+        }
+
+        bool rootEmpty = (context->containers[root].message == NULL);
+        bool otherEmpty = (context->containers[other].message == NULL);
+        bool otherIsReply = false;
+        containerSubject(context, other, &otherIsReply);
+        unlinkContainer(context, root);
+        if (rootEmpty && otherEmpty) {
+            moveChildren(context, root, other);
+        }
+        else if (otherEmpty || (isReply && !otherIsReply)) {
+            linkContainer(context, other, root);
+        }
+        else {
+            // Both are messages of the same level: they're grouped under a new empty container.
+            int group = addContainer(context, NULL);
+            unlinkContainer(context, other);
+            linkContainer(context, group, other);
+            linkContainer(context, group, root);
+            linkContainer(context, 0, group);
+            subjectTable->setObjectForKey(subject, Value::valueWithIntValue(group));
+        }
+        root = next;
+    }
+}
+
+static time_t messageDate(IMAPMessage * message)
+{
+    time_t date = message->header()->date();
+    if (date == (time_t) -1) {
+        date = message->header()->receivedDate();
+    }
+    return date;
+}
+
+struct sort_entry {
+    int node;
+    time_t date;
+    uint32_t uid;
+};
+
+static int compareEntries(const void * a, const void * b)
+{
+    const struct sort_entry * entry = (const struct sort_entry *) a;
+    const struct sort_entry * otherEntry = (const struct sort_entry *) b;
+    if (entry->date != otherEntry->date) {
+        return (entry->date < otherEntry->date) ? -1 : 1;
+    }
+    if (entry->uid != otherEntry->uid) {
+        return (entry->uid < otherEntry->uid) ? -1 : 1;
+    }
+    return 0;
+}
+
+// Sorts the children by date. An empty container has the date of its first child.
+static void sortChildren(struct thread_context * context, int node)
+{
+    int count = childrenCount(context, node);
+    if (count == 0) {
+        return;
+    }
+    struct sort_entry * entries = (struct sort_entry *) malloc(sizeof(* entries) * count);
+    int i = 0;
+    for(int child = context->containers[node].firstChild ; child != -1 ; child = context->containers[child].nextSibling) {
+        sortChildren(context, child);
+        IMAPMessage * message = context->containers[child].message;
+        if (message == NULL) {
+            int firstChild = context->containers[child].firstChild;
+            context->containers[child].date = (firstChild != -1) ? context->containers[firstChild].date : 0;
+        }
+        else {
+            context->containers[child].date = messageDate(message);
+        }
+        entries[i].node = child;
+        entries[i].date = context->containers[child].date;
+        entries[i].uid = (message != NULL) ? message->uid() : 0;
+        i ++;
+    }
+    qsort(entries, count, sizeof(* entries), compareEntries);
+    context->containers[node].firstChild = entries[0].node;
+    for(i = 0 ; i < count ; i ++) {
+        context->containers[entries[i].node].nextSibling = (i + 1 < count) ? entries[i + 1].node : -1;
+    }
+    free(entries);
+}
+
+static Array * threadsForChildren(struct thread_context * context, int node)
+{
+    Array * result = Array::array();
+    for(int child = context->containers[node].firstChild ; child != -1 ; child = context->containers[child].nextSibling) {
+        IMAPThread * thread = new IMAPThread();
+        IMAPMessage * message = context->containers[child].message;
+        if (message != NULL) {
+            thread->setUid(message->uid());
+        }
+        if (context->containers[child].firstChild != -1) {
+            thread->setChildren(threadsForChildren(context, child));
+        }
+        result->addObject(thread);
+        thread->release();
+    }
+    return result;
+}
+
+static void threadByReferences(struct thread_context * context, Array * messages)
+{
+    HashMap * idTable = HashMap::hashMap();
+    mc_foreacharray(IMAPMessage, message, messages) {
+        MessageHeader * header = message->header();
+        String * messageID = header->messageID();
+        int node;
+        if ((messageID == NULL) || header->isMessageIDAutoGenerated()) {
+            node = addContainer(context, message);
+        }
+        else {
+            node = containerForMessageID(context, idTable, messageID);
+            if (context->containers[node].message != NULL) {
+                // Duplicate Message-ID.
+                node = addContainer(context, NULL);
+            }
+            context->containers[node].message = message;
+        }
+
+        Array * references = Array::array();
+        if (header->references() != NULL) {
+            references->addObjectsFromArray(header->references());
+        }
+        if ((header->inReplyTo() != NULL) && (header->inReplyTo()->count() > 0)) {
+            String * inReplyTo = (String *) header->inReplyTo()->lastObject();
+            if ((references->count() == 0) || !inReplyTo->isEqual(references->lastObject())) {
+                references->addObject(inReplyTo);
+            }
+        }
+
+        // Link the references together, keeping existing links.
+        int previous = -1;
+        mc_foreacharray(String, reference, references) {
+            int referenceNode = containerForMessageID(context, idTable, reference);
+            if ((previous != -1) && (referenceNode != previous) &&
+                (context->containers[referenceNode].parent == -1) && !isAncestor(context, referenceNode, previous)) {
+                linkContainer(context, previous, referenceNode);
+            }
+            previous = referenceNode;
+        }
+
+        // The last reference is the parent of the message.
+        unlinkContainer(context, node);
+        if ((previous != -1) && (previous != node) && !isAncestor(context, node, previous)) {
+            linkContainer(context, previous, node);
+        }
+    }
+
+    for(unsigned int i = 1 ; i < context->count ; i ++) {
+        if (context->containers[i].parent == -1) {
+            linkContainer(context, 0, (int) i);
+        }
+    }
+    pruneContainer(context, 0);
+    groupBySubject(context);
+}
+
+static void threadByOrderedSubject(struct thread_context * context, Array * messages)
+{
+    // The messages with the same base subject are children of the first one.
+    HashMap * subjectTable = HashMap::hashMap();
+    mc_foreacharray(IMAPMessage, message, messages) {
+        addContainer(context, message);
+    }
+    for(unsigned int i = 1 ; i < context->count ; i ++) {
+        linkContainer(context, 0, (int) i);
+    }
+    sortChildren(context, 0);
+
+    int node = context->containers[0].firstChild;
+    while (node != -1) {
+        int next = context->containers[node].nextSibling;
+        String * subject = containerSubject(context, node, NULL);
+        if (subject == NULL) {
+            subject = MCSTR("");
+        }
+        Value * value = (Value *) subjectTable->objectForKey(subject);
+        if (value == NULL) {
+            subjectTable->setObjectForKey(subject, Value::valueWithIntValue(node));
+        }
+        else {
+            unlinkContainer(context, node);
+            linkContainer(context, value->intValue(), node);
+        }
+        node = next;
+    }
+}
+
+Array * IMAPThread::threadsWithMessages(Array * messages, IMAPThreadAlgorithm algorithm)
+{
+    struct thread_context context;
+    context.containers = NULL;
+    context.count = 0;
+    context.capacity = 0;
+    addContainer(&context, NULL);
+
+    switch (algorithm) {
+        case IMAPThreadAlgorithmReferences:
+            threadByReferences(&context, messages);
+            break;
+        case IMAPThreadAlgorithmOrderedSubject:
+            threadByOrderedSubject(&context, messages);
+            break;
+    }
+    sortChildren(&context, 0);
+
+    Array * result = threadsForChildren(&context, 0);
+    free(context.containers);
+    return result;
+}
@@ -0,0 +1,58 @@
+//
+//  MCIMAPThread.h
+//  mailcore2
+//
+//  Created by agent on 10/18/26.
+//  Copyright (c) 2026 MailCore. All rights reserved.
+//
+
+#ifndef MAILCORE_MCIMAPTHREAD_H
+
+#define MAILCORE_MCIMAPTHREAD_H
+
+#include <MailCore/MCBaseTypes.h>
+#include <MailCore/MCMessageConstants.h>
+
+#ifdef __cplusplus
+
+namespace mailcore {
+    
+    // A node of a conversation tree, as returned by IMAPSession::thread().
+    class MAILCORE_EXPORT IMAPThread : public Object {
+    public:
+        IMAPThread();
+        virtual ~IMAPThread();
+        
+        // 0 when the message is not available: the node only groups its children.
+        virtual void setUid(uint32_t uid);
+        virtual uint32_t uid();
+        
+        virtual void setChildren(Array * /* IMAPThread */ children);
+        virtual Array * /* IMAPThread */ children();
+        
+        // UIDs of the messages of this node and of its descendants.
+        virtual IndexSet * allUIDs();
+        
+        // Threads the messages locally with the algorithms of RFC 5256. REFERENCES uses the
+        // algorithm of Jamie Zawinski over Message-ID, References and In-Reply-To.
+        // Messages should have been fetched with the headers.
+        static Array * /* IMAPThread */ threadsWithMessages(Array * /* IMAPMessage */ messages,
+                                                             IMAPThreadAlgorithm algorithm);
+        
+    public: // subclass behavior
+        IMAPThread(IMAPThread * other);
+        virtual Object * copy();
+        virtual String * description();
+        
+    private:
+        uint32_t mUid;
+        Array * mChildren;
+        
+        void init();
+    };
+    
+}
+
+#endif
+
+#endif
@@ -18,6 +18,7 @@
 #include "MCNNTPProgressCallback.h"
 #include "MCConnectionLoggerUtils.h"
 #include "MCCertificateUtils.h"
+#include "MCOperationTiming.h"
 #include "MCLibetpan.h"
 
 #define NNTP_DEFAULT_PORT  119
@@ -50,6 +51,10 @@ void NNTPSession::init()
     mState = STATE_DISCONNECTED;
     mConnectionLogger = NULL;
     pthread_mutex_init(&mConnectionLoggerLock, NULL);
+    pthread_mutex_init(&mCancelLock, NULL);
+    mOperationCancelled = false;
+    mCancellationTime = 0;
+    mLastCancellationDelay = 0;
 }
 
 NNTPSession::NNTPSession()
@@ -59,6 +64,7 @@ NNTPSession::NNTPSession()
 
 NNTPSession::~NNTPSession()
 {
+    pthread_mutex_destroy(&mCancelLock);
     pthread_mutex_destroy(&mConnectionLoggerLock);
     MC_SAFE_RELEASE(mHostname);
     MC_SAFE_RELEASE(mUsername);
@@ -183,22 +189,79 @@ static void logger(newsnntp * nntp, int log_type, const char * buffer, size_t si
 
 void NNTPSession::setup()
 {
-    mNNTP = newsnntp_new(0, NULL);
-    newsnntp_set_logger(mNNTP, logger, this);
+    newsnntp * nntp = newsnntp_new(0, NULL);
+    newsnntp_set_logger(nntp, logger, this);
+    
+    pthread_mutex_lock(&mCancelLock);
+    mNNTP = nntp;
+    pthread_mutex_unlock(&mCancelLock);
 }
 
 void NNTPSession::unsetup()
 {
-    if (mNNTP != NULL) {
-        if (mNNTP->nntp_stream != NULL) {
-            mailstream_close(mNNTP->nntp_stream);
-            mNNTP->nntp_stream = NULL;
+    newsnntp * nntp;
+    
+    pthread_mutex_lock(&mCancelLock);
+    nntp = mNNTP;
+    mNNTP = NULL;
+    pthread_mutex_unlock(&mCancelLock);
+    
+    if (nntp != NULL) {
+        if (nntp->nntp_stream != NULL) {
+            mailstream_close(nntp->nntp_stream);
+            nntp->nntp_stream = NULL;
         }
-        newsnntp_free(mNNTP);
-        mNNTP = NULL;
+        newsnntp_free(nntp);
     }
 }
 
+void NNTPSession::cancelCurrentOperation()
+{
+    // any thread
+    pthread_mutex_lock(&mCancelLock);
+    if ((mNNTP != NULL) && (mNNTP->nntp_stream != NULL) && !mOperationCancelled) {
+        mOperationCancelled = true;
+        mCancellationTime = OperationTiming::currentTime();
+        mailstream_cancel(mNNTP->nntp_stream);
+    }
+    pthread_mutex_unlock(&mCancelLock);
+}
+
+double NNTPSession::lastCancellationDelay()
+{
+    return mLastCancellationDelay;
+}
+
+void NNTPSession::operationWillStart()
+{
+    resetCancellation();
+}
+
+void NNTPSession::cancelledOperationFinished()
+{
+    double cancellationTime = mCancellationTime;
+    if (resetCancellation()) {
+        mLastCancellationDelay = OperationTiming::currentTime() - cancellationTime;
+        MCLog("operation interrupted in %g s", mLastCancellationDelay);
+    }
+}
+
+// A cancelled stream can't be used anymore. Returns true if the session had to be disconnected.
+bool NNTPSession::resetCancellation()
+{
+    pthread_mutex_lock(&mCancelLock);
+    bool cancelled = mOperationCancelled;
+    mOperationCancelled = false;
+    pthread_mutex_unlock(&mCancelLock);
+    
+    if (!cancelled) {
+        return false;
+    }
+    unsetup();
+    mState = STATE_DISCONNECTED;
+    return true;
+}
+
 void NNTPSession::loginIfNeeded(ErrorCode * pError)
 {
     connectIfNeeded(pError);
@@ -10,6 +10,7 @@
 #include "MCMessageHeader.h"
 #include "MCConnectionLoggerUtils.h"
 #include "MCCertificateUtils.h"
+#include "MCOperationTiming.h"
 
 using namespace mailcore;
 
@@ -37,6 +38,10 @@ void POPSession::init()
     mState = STATE_DISCONNECTED;
     mConnectionLogger = NULL;
     pthread_mutex_init(&mConnectionLoggerLock, NULL);
+    pthread_mutex_init(&mCancelLock, NULL);
+    mOperationCancelled = false;
+    mCancellationTime = 0;
+    mLastCancellationDelay = 0;
 }
 
 POPSession::POPSession()
@@ -46,6 +51,7 @@ POPSession::POPSession()
 
 POPSession::~POPSession()
 {
+    pthread_mutex_destroy(&mCancelLock);
     pthread_mutex_destroy(&mConnectionLoggerLock);
     MC_SAFE_RELEASE(mHostname);
     MC_SAFE_RELEASE(mUsername);
@@ -179,24 +185,81 @@ static void logger(mailpop3 * pop3, int log_type, const char * buffer, size_t si
 
 void POPSession::setup()
 {
-    mPop = mailpop3_new(0, NULL);
-    mailpop3_set_timeout(mPop, timeout());
-    mailpop3_set_progress_callback(mPop, POPSession::body_progress, this);
-    mailpop3_set_logger(mPop, logger, this);
+    mailpop3 * pop = mailpop3_new(0, NULL);
+    mailpop3_set_timeout(pop, timeout());
+    mailpop3_set_progress_callback(pop, POPSession::body_progress, this);
+    mailpop3_set_logger(pop, logger, this);
+    
+    pthread_mutex_lock(&mCancelLock);
+    mPop = pop;
+    pthread_mutex_unlock(&mCancelLock);
 }
 
 void POPSession::unsetup()
 {
-    if (mPop != NULL) {
-        if (mPop->pop3_stream != NULL) {
-            mailstream_close(mPop->pop3_stream);
-            mPop->pop3_stream = NULL;
+    mailpop3 * pop;
+    
+    pthread_mutex_lock(&mCancelLock);
+    pop = mPop;
+    mPop = NULL;
+    pthread_mutex_unlock(&mCancelLock);
+    
+    if (pop != NULL) {
+        if (pop->pop3_stream != NULL) {
+            mailstream_close(pop->pop3_stream);
+            pop->pop3_stream = NULL;
         }
-        mailpop3_free(mPop);
-        mPop = NULL;
+        mailpop3_free(pop);
     }
 }
 
+void POPSession::cancelCurrentOperation()
+{
+    // any thread
+    pthread_mutex_lock(&mCancelLock);
+    if ((mPop != NULL) && (mPop->pop3_stream != NULL) && !mOperationCancelled) {
+        mOperationCancelled = true;
+        mCancellationTime = OperationTiming::currentTime();
+        mailstream_cancel(mPop->pop3_stream);
+    }
+    pthread_mutex_unlock(&mCancelLock);
+}
+
+double POPSession::lastCancellationDelay()
+{
+    return mLastCancellationDelay;
+}
+
+void POPSession::operationWillStart()
+{
+    resetCancellation();
+}
+
+void POPSession::cancelledOperationFinished()
+{
+    double cancellationTime = mCancellationTime;
+    if (resetCancellation()) {
+        mLastCancellationDelay = OperationTiming::currentTime() - cancellationTime;
+        MCLog("operation interrupted in %g s", mLastCancellationDelay);
+    }
+}
+
+// A cancelled stream can't be used anymore. Returns true if the session had to be disconnected.
+bool POPSession::resetCancellation()
+{
+    pthread_mutex_lock(&mCancelLock);
+    bool cancelled = mOperationCancelled;
+    mOperationCancelled = false;
+    pthread_mutex_unlock(&mCancelLock);
+    
+    if (!cancelled) {
+        return false;
+    }
+    unsetup();
+    mState = STATE_DISCONNECTED;
+    return true;
+}
+
 void POPSession::connectIfNeeded(ErrorCode * pError)
 {
     if (mState == STATE_DISCONNECTED) {
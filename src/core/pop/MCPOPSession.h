@@ -45,6 +45,14 @@ namespace mailcore {
         virtual void connect(ErrorCode * pError);
         virtual void disconnect();
         
+        /** Interrupts the network read or write that is in progress. It can be called from any thread.
+         The interrupted operation fails. When the session is used without an operation queue,
+         cancelledOperationFinished() should then be called: the session will reconnect on the next operation. */
+        virtual void cancelCurrentOperation();
+        virtual void cancelledOperationFinished();
+        /** Delay in seconds between the last cancelCurrentOperation() and the return of the interrupted operation. */
+        virtual double lastCancellationDelay();
+        
         virtual void login(ErrorCode * pError);
         
         virtual void checkAccount(ErrorCode * pError);
@@ -69,6 +77,7 @@ namespace mailcore {
         virtual void lockConnectionLogger();
         virtual void unlockConnectionLogger();
         virtual ConnectionLogger * connectionLoggerNoLock();
+        virtual void operationWillStart();
 
     private:
         String * mHostname;
@@ -88,12 +97,18 @@ namespace mailcore {
         ConnectionLogger * mConnectionLogger;
         pthread_mutex_t mConnectionLoggerLock;
         
+        pthread_mutex_t mCancelLock;
+        bool mOperationCancelled;
+        double mCancellationTime;
+        double mLastCancellationDelay;
+        
         void init();
         void bodyProgress(unsigned int current, unsigned int maximum);
         bool checkCertificate();
         static void body_progress(size_t current, size_t maximum, void * context);
         void setup();
         void unsetup();
+        bool resetCancellation();
         void connectIfNeeded(ErrorCode * pError);
         void loginIfNeeded(ErrorCode * pError);
         void listIfNeeded(ErrorCode * pError);
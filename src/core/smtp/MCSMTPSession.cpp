@@ -12,6 +12,7 @@
 #include "MCSMTPProgressCallback.h"
 #include "MCConnectionLoggerUtils.h"
 #include "MCCertificateUtils.h"
+#include "MCOperationTiming.h"
 
 using namespace mailcore;
 
@@ -41,6 +42,8 @@ void SMTPSession::init()
     mUseHeloIPEnabled = false;
     mShouldDisconnect = false;
     mSendingCancelled = false;
+    mCancellationTime = 0;
+    mLastCancellationDelay = 0;
     mCanCancel = false;
     
     mSmtp = NULL;
@@ -754,9 +757,7 @@ void SMTPSession::internalSendMessage(Address * from, Array * recipients, Data *
         r = mailesmtp_send_quit_no_disconnect(mSmtp, MCUTF8(from->mailbox()), 0, NULL,
                                               address_list,
                                               messageData->bytes(), messageData->length());
-        CAN_CANCEL_LOCK();
-        mCanCancel = false;
-        CAN_CANCEL_UNLOCK();
+        cancellableSendFinished();
         if (mSmtp->stream != NULL) {
             mailstream_close(mSmtp->stream);
             mSmtp->stream = NULL;
@@ -767,9 +768,7 @@ void SMTPSession::internalSendMessage(Address * from, Array * recipients, Data *
         r = mailesmtp_send(mSmtp, MCUTF8(from->mailbox()), 0, NULL,
             address_list,
             messageData->bytes(), messageData->length());
-        CAN_CANCEL_LOCK();
-        mCanCancel = false;
-        CAN_CANCEL_UNLOCK();
+        cancellableSendFinished();
         mailsmtp_quit(mSmtp);
     }
     esmtp_address_list_free(address_list);
@@ -982,12 +981,34 @@ void SMTPSession::cancelMessageSending()
     CAN_CANCEL_LOCK();
     if (mCanCancel) {
         if (mSmtp != NULL && mSmtp->stream != NULL) {
+            if (mCancellationTime == 0) {
+                mCancellationTime = OperationTiming::currentTime();
+            }
             mailstream_cancel(mSmtp->stream);
         }
     }
     CAN_CANCEL_UNLOCK();
 }
 
+void SMTPSession::cancellableSendFinished()
+{
+    CAN_CANCEL_LOCK();
+    mCanCancel = false;
+    double cancellationTime = mCancellationTime;
+    mCancellationTime = 0;
+    CAN_CANCEL_UNLOCK();
+    
+    if (cancellationTime != 0) {
+        mLastCancellationDelay = OperationTiming::currentTime() - cancellationTime;
+        MCLog("sending interrupted in %g s", mLastCancellationDelay);
+    }
+}
+
+double SMTPSession::lastCancellationDelay()
+{
+    return mLastCancellationDelay;
+}
+
 bool SMTPSession::isDisconnected()
 {
     return mState == STATE_DISCONNECTED;
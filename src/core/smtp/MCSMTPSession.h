@@ -68,6 +68,8 @@ namespace mailcore {
                                  SMTPProgressCallback * callback, ErrorCode * pError);
 
         virtual void cancelMessageSending();
+        /** Delay in seconds between the last cancelMessageSending() and the return of the interrupted sending. */
+        virtual double lastCancellationDelay();
 
         virtual void setConnectionLogger(ConnectionLogger * logger);
         virtual ConnectionLogger * connectionLogger();
@@ -102,6 +104,8 @@ namespace mailcore {
         int mLastSMTPResponseCode;
         pthread_mutex_t mCancelLock;
         pthread_mutex_t mCanCancelLock;
+        double mCancellationTime;
+        double mLastCancellationDelay;
         
         ConnectionLogger * mConnectionLogger;
         pthread_mutex_t mConnectionLoggerLock;
@@ -117,6 +121,7 @@ namespace mailcore {
         void connectIfNeeded(ErrorCode * pError);
         bool checkCertificate();
         void setSendingCancelled(bool isCancelled);
+        void cancellableSendFinished();
         
         void sendMessage(MessageBuilder * msg, SMTPProgressCallback * callback, ErrorCode * pError);
         void internalSendMessage(Address * from, Array * /* Address */ recipients, Data * messageData,
@@ -242,6 +242,58 @@ typedef NS_ENUM(NSInteger, MCOIMAPSearchKind) {
     MCOIMAPSearchKindNot,
 };
 
+/** Values returned by an extended search. See ESEARCH RFC 4731.*/
+typedef NS_OPTIONS(NSInteger, MCOIMAPSearchReturnOption) {
+    /** Lowest matching UID.*/
+    MCOIMAPSearchReturnOptionMin   = 1 << 0,
+    /** Highest matching UID.*/
+    MCOIMAPSearchReturnOptionMax   = 1 << 1,
+    /** Number of matching messages.*/
+    MCOIMAPSearchReturnOptionCount = 1 << 2,
+    /** All the matching UIDs.*/
+    MCOIMAPSearchReturnOptionAll   = 1 << 3,
+};
+
+/** Sort keys. See SORT RFC 5256.*/
+typedef NS_ENUM(NSInteger, MCOIMAPSortKind) {
+    /** Internal date.*/
+    MCOIMAPSortKindArrival,
+    /** First address of Cc.*/
+    MCOIMAPSortKindCc,
+    /** Date header.*/
+    MCOIMAPSortKindDate,
+    /** First address of From.*/
+    MCOIMAPSortKindFrom,
+    /** Size of the message.*/
+    MCOIMAPSortKindSize,
+    /** Base subject.*/
+    MCOIMAPSortKindSubject,
+    /** First address of To.*/
+    MCOIMAPSortKindTo,
+};
+
+/** Threading algorithms. See THREAD RFC 5256.*/
+typedef NS_ENUM(NSInteger, MCOIMAPThreadAlgorithm) {
+    /** Threads using References and In-Reply-To headers.*/
+    MCOIMAPThreadAlgorithmReferences,
+    /** Threads by base subject.*/
+    MCOIMAPThreadAlgorithmOrderedSubject,
+};
+
+/** Kind of the changes reported by a folder watcher.*/
+typedef NS_ENUM(NSInteger, MCOIMAPNotifyEventKind) {
+    /** A message has been added. number is the new message count of the folder.*/
+    MCOIMAPNotifyEventKindExists,
+    /** number is the sequence number of the message that has been removed.*/
+    MCOIMAPNotifyEventKindExpunge,
+    /** uids are the UIDs of the messages that have been removed.*/
+    MCOIMAPNotifyEventKindVanished,
+    /** Flags of a message changed.*/
+    MCOIMAPNotifyEventKindFlagsChange,
+    /** The status of a folder that is not selected changed.*/
+    MCOIMAPNotifyEventKindStatus,
+};
+
 /** Keys for the namespace dictionary.*/
 #define MCOIMAPNamespacePersonal @"IMAPNamespacePersonal"
 #define MCOIMAPNamespaceOther @"IMAPNamespaceOther"
@@ -44,5 +44,19 @@
 #import <MailCore/MCOIMAPSearchExpression.h>
 #import <MailCore/MCOIMAPMessageRenderingOperation.h>
 #import <MailCore/MCOIMAPCustomCommandOperation.h>
+#import <MailCore/MCOIMAPBatchOperation.h>
+#import <MailCore/MCOIMAPAppendItem.h>
+#import <MailCore/MCOIMAPAppendMessagesOperation.h>
+#import <MailCore/MCOIMAPSyncFolderMirrorOperation.h>
+#import <MailCore/MCOIMAPFolderMirror.h>
+#import <MailCore/MCOIMAPSortOperation.h>
+#import <MailCore/MCOIMAPSortCriterion.h>
+#import <MailCore/MCOIMAPThreadOperation.h>
+#import <MailCore/MCOIMAPThread.h>
+#import <MailCore/MCOIMAPSearchResult.h>
+#import <MailCore/MCOIMAPFetchFoldersWithStatusOperation.h>
+#import <MailCore/MCOIMAPNotifyEvent.h>
+#import <MailCore/MCOIMAPFolderWatcher.h>
+#import <MailCore/MCOIMAPBodyCache.h>
 
 #endif
@@ -0,0 +1,39 @@
+//
+//  MCOIMAPAppendItem.h
+//  mailcore2
+//
+//  Created by agent on 10/18/26.
+//  Copyright (c) 2026 MailCore. All rights reserved.
+//
+
+#ifndef MAILCORE_MCOIMAPAPPENDITEM_H
+
+#define MAILCORE_MCOIMAPAPPENDITEM_H
+
+#import <Foundation/Foundation.h>
+#import <MailCore/MCOConstants.h>
+
+/** A message to add to a folder with an append messages operation. */
+
+NS_ASSUME_NONNULL_BEGIN
+@interface MCOIMAPAppendItem : NSObject <NSCopying>
+
+/** Content of the message. */
+@property (nonatomic, copy, nullable) NSData * messageData;
+
+/** Path of a file with the content of the message. It's used when messageData is nil. */
+@property (nonatomic, copy, nullable) NSString * messageFilepath;
+
+/** Flags of the message. */
+@property (nonatomic, assign) MCOMessageFlag flags;
+
+/** Custom flags of the message. */
+@property (nonatomic, copy, nullable) NSArray * customFlags;
+
+/** Internal date of the message. When nil, the server sets the date. */
+@property (nonatomic, strong, nullable) NSDate * date;
+
+@end
+NS_ASSUME_NONNULL_END
+
+#endif
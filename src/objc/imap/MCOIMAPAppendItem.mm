@@ -0,0 +1,97 @@
+//
+//  MCOIMAPAppendItem.mm
+//  mailcore2
+//
+//  Created by agent on 10/18/26.
+//  Copyright (c) 2026 MailCore. All rights reserved.
+//
+
+#import "MCOIMAPAppendItem.h"
+
+#include "MCIMAP.h"
+
+#import "MCOUtils.h"
+
+#define nativeType mailcore::IMAPAppendItem
+
+@implementation MCOIMAPAppendItem {
+    mailcore::IMAPAppendItem * _nativeItem;
+}
+
++ (void) load
+{
+    MCORegisterClass(self, &typeid(nativeType));
+}
+
+- (instancetype) initWithMCAppendItem:(mailcore::IMAPAppendItem *)item
+{
+    self = [super init];
+    
+    item->retain();
+    _nativeItem = item;
+    
+    return self;
+}
+
+- (void) dealloc
+{
+    MC_SAFE_RELEASE(_nativeItem);
+    [super dealloc];
+}
+
++ (NSObject *) mco_objectWithMCObject:(mailcore::Object *)object
+{
+    mailcore::IMAPAppendItem * item = (mailcore::IMAPAppendItem *) object;
+    return [[[self alloc] initWithMCAppendItem:item] autorelease];
+}
+
+- (instancetype) init
+{
+    mailcore::IMAPAppendItem * item = new mailcore::IMAPAppendItem();
+    self = [self initWithMCAppendItem:item];
+    item->release();
+    
+    return self;
+}
+
+- (mailcore::Object *) mco_mcObject
+{
+    return _nativeItem;
+}
+
+- (id) copyWithZone:(NSZone *)zone
+{
+    nativeType * nativeObject = (nativeType *) [self mco_mcObject]->copy();
+    id result = [[self class] mco_objectWithMCObject:nativeObject];
+    MC_SAFE_RELEASE(nativeObject);
+    return [result retain];
+}
+
+- (NSString *) description
+{
+    return MCO_OBJC_BRIDGE_GET(description);
+}
+
+MCO_OBJC_SYNTHESIZE_DATA(setMessageData, messageData)
+MCO_OBJC_SYNTHESIZE_STRING(setMessageFilepath, messageFilepath)
+MCO_OBJC_SYNTHESIZE_SCALAR(MCOMessageFlag, mailcore::MessageFlag, setFlags, flags)
+MCO_OBJC_SYNTHESIZE_ARRAY(setCustomFlags, customFlags)
+
+- (NSDate *) date
+{
+    if (MCO_NATIVE_INSTANCE->date() == (time_t) -1) {
+        return nil;
+    }
+    return [NSDate dateWithTimeIntervalSince1970:MCO_NATIVE_INSTANCE->date()];
+}
+
+- (void) setDate:(NSDate *)date
+{
+    if (date == nil) {
+        MCO_NATIVE_INSTANCE->setDate((time_t) -1);
+        return;
+    }
+    MCO_NATIVE_INSTANCE->setDate([date timeIntervalSince1970]);
+}
+
+@end
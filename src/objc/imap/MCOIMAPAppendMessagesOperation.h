@@ -0,0 +1,37 @@
+//
+//  MCOIMAPAppendMessagesOperation.h
+//  mailcore2
+//
+//  Created by agent on 10/18/26.
+//  Copyright (c) 2026 MailCore. All rights reserved.
+//
+
+#ifndef MAILCORE_MCOIMAPAPPENDMESSAGESOPERATION_H
+
+#define MAILCORE_MCOIMAPAPPENDMESSAGESOPERATION_H
+
+#import <MailCore/MCOIMAPBaseOperation.h>
+
+/** This class adds many messages to a folder in a single operation. It uses MULTIAPPEND (RFC 3502) when available. */
+
+@class MCOIndexSet;
+
+NS_ASSUME_NONNULL_BEGIN
+@interface MCOIMAPAppendMessagesOperation : MCOIMAPBaseOperation
+
+/**
+ Starts the asynchronous operation.
+
+ @param completionBlock Called when the operation is finished.
+
+ - On success `error` will be nil and `createdUIDs` will contain the UIDs of the added messages when the server supports UIDPLUS
+
+ - On failure, `error` will be set with `MCOErrorDomain` as domain and an
+ error code available in `MCOConstants.h`, `createdUIDs` will be nil
+*/
+- (void) start:(void (^)(NSError * __nullable error, MCOIndexSet * __nullable createdUIDs))completionBlock;
+
+@end
+NS_ASSUME_NONNULL_END
+
+#endif
@@ -0,0 +1,39 @@
+//
+//  MCOIMAPBatchOperation.h
+//  mailcore2
+//
+//  Created by agent on 10/18/26.
+//  Copyright (c) 2026 MailCore. All rights reserved.
+//
+
+#ifndef MAILCORE_MCOIMAPBATCHOPERATION_H
+
+#define MAILCORE_MCOIMAPBATCHOPERATION_H
+
+#import <MailCore/MCOIMAPBaseOperation.h>
+
+/**
+ This class runs the same action on messages spread over many folders.
+ The folders are processed in parallel on the connections of the session.
+ */
+
+NS_ASSUME_NONNULL_BEGIN
+@interface MCOIMAPBatchOperation : MCOIMAPBaseOperation
+
+/**
+ Starts the asynchronous operation.
+
+ @param completionBlock Called when the operation is finished.
+
+ - `error` is nil when the action succeeded in all the folders. Otherwise, it's the first error that occurred.
+
+ - `folderErrors` maps the names of the folders where the action failed to the error code, as NSNumber.
+
+ - `uidMappings` maps the names of the source folders to the UID mapping of the copy or the move, as NSDictionary.
+*/
+- (void) start:(void (^)(NSError * __nullable error, NSDictionary * folderErrors, NSDictionary * uidMappings))completionBlock;
+
+@end
+NS_ASSUME_NONNULL_END
+
+#endif
@@ -0,0 +1,70 @@
+//
+//  MCOIMAPBatchOperation.mm
+//  mailcore2
+//
+//  Created by agent on 10/18/26.
+//  Copyright (c) 2026 MailCore. All rights reserved.
+//
+
+#import "MCOIMAPBatchOperation.h"
+
+#include "MCAsyncIMAP.h"
+
+#import "MCOOperation+Private.h"
+#import "MCOUtils.h"
+
+typedef void (^CompletionType)(NSError *error, NSDictionary * folderErrors, NSDictionary * uidMappings);
+
+@implementation MCOIMAPBatchOperation {
+    CompletionType _completionBlock;
+}
+
+#define nativeType mailcore::IMAPBatchOperation
+
++ (void) load
+{
+    MCORegisterClass(self, &typeid(nativeType));
+}
+
++ (NSObject *) mco_objectWithMCObject:(mailcore::Object *)object
+{
+    nativeType * op = (nativeType *) object;
+    return [[[self alloc] initWithMCOperation:op] autorelease];
+}
+
+- (void) dealloc
+{
+    [_completionBlock release];
+    [super dealloc];
+}
+
+- (void) start:(void (^)(NSError *error, NSDictionary * folderErrors, NSDictionary * uidMappings))completionBlock
+{
+    _completionBlock = [completionBlock copy];
+    [self start];
+}
+
+- (void) cancel
+{
+    [_completionBlock release];
+    _completionBlock = nil;
+    [super cancel];
+}
+
+- (void) operationCompleted
+{
+    if (_completionBlock == NULL)
+        return;
+    
+    nativeType *op = MCO_NATIVE_INSTANCE;
+    NSError * error = nil;
+    if (op->error() != mailcore::ErrorNone) {
+        error = [NSError mco_errorWithErrorCode:op->error()];
+    }
+    // Folders can succeed even when another one failed.
+    _completionBlock(error, MCO_TO_OBJC(op->folderErrors()), MCO_TO_OBJC(op->uidMappings()));
+    [_completionBlock release];
+    _completionBlock = nil;
+}
+
+@end
@@ -0,0 +1,80 @@
+//
+//  MCOIMAPBodyCache.h
+//  mailcore2
+//
+//  Created by agent on 10/18/26.
+//  Copyright (c) 2026 MailCore. All rights reserved.
+//
+
+#ifndef MAILCORE_MCOIMAPBODYCACHE_H
+
+#define MAILCORE_MCOIMAPBODYCACHE_H
+
+#import <Foundation/Foundation.h>
+#import <MailCore/MCOConstants.h>
+
+/** On-disk cache of message contents and attachments fetched by UID. Identical contents are stored once. It can be shared by sessions and used from any thread. */
+
+NS_ASSUME_NONNULL_BEGIN
+@interface MCOIMAPBodyCache : NSObject
+
+/** Directory of the cache. */
+@property (nonatomic, copy) NSString * path;
+
+/** Size in bytes above which the least recently used contents are removed. */
+@property (nonatomic, assign) uint64_t maximumSize;
+
+/** Contents larger than this size in bytes are not stored. */
+@property (nonatomic, assign) unsigned int maximumItemSize;
+
+/** Reads the index of the cache. A missing index is not an error: the cache is then empty. */
+- (MCOErrorCode) load;
+
+/** Writes the index of the cache. */
+- (MCOErrorCode) save;
+
+/** Returns nil if the content is not in the cache. partID is nil for the whole message. */
+- (NSData * __nullable) dataForAccount:(NSString *)account folder:(NSString *)folder uidValidity:(uint32_t)uidValidity
+                                   uid:(uint32_t)uid partID:(NSString * __nullable)partID;
+
+/** Stores a content. partID is nil for the whole message. */
+- (void) setData:(NSData *)data forAccount:(NSString *)account folder:(NSString *)folder uidValidity:(uint32_t)uidValidity
+             uid:(uint32_t)uid partID:(NSString * __nullable)partID;
+
+/** Removes the contents of a folder. */
+- (void) removeFolder:(NSString *)folder account:(NSString *)account;
+
+/** Removes all the contents. */
+- (void) removeAllData;
+
+/** Number of contents found in the cache. */
+@property (nonatomic, assign, readonly) unsigned int hitsCount;
+
+/** Number of contents not found in the cache. */
+@property (nonatomic, assign, readonly) unsigned int missesCount;
+
+/** Ratio of contents found in the cache. */
+@property (nonatomic, assign, readonly) double hitRate;
+
+/** Number of bytes that have not been downloaded thanks to the cache. */
+@property (nonatomic, assign, readonly) uint64_t bytesSaved;
+
+/** Number of bytes not stored because an identical content was already stored. */
+@property (nonatomic, assign, readonly) uint64_t bytesDeduplicated;
+
+/** Size in bytes of the stored contents. */
+@property (nonatomic, assign, readonly) uint64_t totalSize;
+
+/** Number of stored contents. */
+@property (nonatomic, assign, readonly) unsigned int itemsCount;
+
+/** Number of contents removed because the cache was full. */
+@property (nonatomic, assign, readonly) unsigned int evictionsCount;
+
+/** Resets the counters. */
+- (void) resetStatistics;
+
+@end
+NS_ASSUME_NONNULL_END
+
+#endif
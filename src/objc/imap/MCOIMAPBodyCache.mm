@@ -0,0 +1,150 @@
+//
+//  MCOIMAPBodyCache.mm
+//  mailcore2
+//
+//  Created by agent on 10/18/26.
+//  Copyright (c) 2026 MailCore. All rights reserved.
+//
+
+#import "MCOIMAPBodyCache.h"
+
+#include "MCIMAP.h"
+
+#import "MCOUtils.h"
+
+#define nativeType mailcore::IMAPBodyCache
+
+@implementation MCOIMAPBodyCache {
+    mailcore::IMAPBodyCache * _nativeBodyCache;
+}
+
++ (void) load
+{
+    MCORegisterClass(self, &typeid(nativeType));
+}
+
+- (instancetype) initWithMCBodyCache:(mailcore::IMAPBodyCache *)object
+{
+    self = [super init];
+    
+    object->retain();
+    _nativeBodyCache = object;
+    
+    return self;
+}
+
+- (void) dealloc
+{
+    MC_SAFE_RELEASE(_nativeBodyCache);
+    [super dealloc];
+}
+
++ (NSObject *) mco_objectWithMCObject:(mailcore::Object *)object
+{
+    mailcore::IMAPBodyCache * nativeBodyCache = (mailcore::IMAPBodyCache *) object;
+    return [[[self alloc] initWithMCBodyCache:nativeBodyCache] autorelease];
+}
+
+- (instancetype) init
+{
+    mailcore::IMAPBodyCache * nativeBodyCache = new mailcore::IMAPBodyCache();
+    self = [self initWithMCBodyCache:nativeBodyCache];
+    nativeBodyCache->release();
+    
+    return self;
+}
+
+- (mailcore::Object *) mco_mcObject
+{
+    return _nativeBodyCache;
+}
+
+- (NSString *) description
+{
+    return MCO_OBJC_BRIDGE_GET(description);
+}
+
+MCO_OBJC_SYNTHESIZE_STRING(setPath, path)
+MCO_OBJC_SYNTHESIZE_SCALAR(uint64_t, uint64_t, setMaximumSize, maximumSize)
+MCO_OBJC_SYNTHESIZE_SCALAR(unsigned int, unsigned int, setMaximumItemSize, maximumItemSize)
+
+- (MCOErrorCode) load
+{
+    return (MCOErrorCode) MCO_NATIVE_INSTANCE->load();
+}
+
+- (MCOErrorCode) save
+{
+    return (MCOErrorCode) MCO_NATIVE_INSTANCE->save();
+}
+
+- (NSData *) dataForAccount:(NSString *)account folder:(NSString *)folder uidValidity:(uint32_t)uidValidity
+                        uid:(uint32_t)uid partID:(NSString *)partID
+{
+    return MCO_TO_OBJC(MCO_NATIVE_INSTANCE->dataForKey([account mco_mcString], [folder mco_mcString], uidValidity, uid,
+                                                       [partID mco_mcString]));
+}
+
+- (void) setData:(NSData *)data forAccount:(NSString *)account folder:(NSString *)folder uidValidity:(uint32_t)uidValidity
+             uid:(uint32_t)uid partID:(NSString *)partID
+{
+    MCO_NATIVE_INSTANCE->setData([data mco_mcData], [account mco_mcString], [folder mco_mcString], uidValidity, uid,
+                                 [partID mco_mcString]);
+}
+
+- (void) removeFolder:(NSString *)folder account:(NSString *)account
+{
+    MCO_NATIVE_INSTANCE->removeFolder([account mco_mcString], [folder mco_mcString]);
+}
+
+- (void) removeAllData
+{
+    MCO_NATIVE_INSTANCE->removeAllData();
+}
+
+- (unsigned int) hitsCount
+{
+    return MCO_NATIVE_INSTANCE->hitsCount();
+}
+
+- (unsigned int) missesCount
+{
+    return MCO_NATIVE_INSTANCE->missesCount();
+}
+
+- (double) hitRate
+{
+    return MCO_NATIVE_INSTANCE->hitRate();
+}
+
+- (uint64_t) bytesSaved
+{
+    return MCO_NATIVE_INSTANCE->bytesSaved();
+}
+
+- (uint64_t) bytesDeduplicated
+{
+    return MCO_NATIVE_INSTANCE->bytesDeduplicated();
+}
+
+- (uint64_t) totalSize
+{
+    return MCO_NATIVE_INSTANCE->totalSize();
+}
+
+- (unsigned int) itemsCount
+{
+    return MCO_NATIVE_INSTANCE->itemsCount();
+}
+
+- (unsigned int) evictionsCount
+{
+    return MCO_NATIVE_INSTANCE->evictionsCount();
+}
+
+- (void) resetStatistics
+{
+    MCO_NATIVE_INSTANCE->resetStatistics();
+}
+
+@end
@@ -0,0 +1,36 @@
+//
+//  MCOIMAPFetchFoldersWithStatusOperation.h
+//  mailcore2
+//
+//  Created by agent on 10/18/26.
+//  Copyright (c) 2026 MailCore. All rights reserved.
+//
+
+#ifndef MAILCORE_MCOIMAPFETCHFOLDERSWITHSTATUSOPERATION_H
+
+#define MAILCORE_MCOIMAPFETCHFOLDERSWITHSTATUSOPERATION_H
+
+#import <MailCore/MCOIMAPBaseOperation.h>
+
+/** This class fetches all the folders and their status. It uses LIST-STATUS (RFC 5819) when available. */
+
+NS_ASSUME_NONNULL_BEGIN
+@interface MCOIMAPFetchFoldersWithStatusOperation : MCOIMAPBaseOperation
+
+/**
+ Starts the asynchronous operation.
+
+ @param completionBlock Called when the operation is finished.
+
+ - On success `error` will be nil, `folders` will contain the folders and `folderStatuses` will map
+ the paths of the folders to their status
+
+ - On failure, `error` will be set with `MCOErrorDomain` as domain and an
+ error code available in `MCOConstants.h`, `folders` and `folderStatuses` will be nil
+*/
+- (void) start:(void (^)(NSError * __nullable error, NSArray * /* MCOIMAPFolder */ __nullable folders, NSDictionary * /* NSString -> MCOIMAPFolderStatus */ __nullable folderStatuses))completionBlock;
+
+@end
+NS_ASSUME_NONNULL_END
+
+#endif
@@ -0,0 +1,69 @@
+//
+//  MCOIMAPFetchFoldersWithStatusOperation.mm
+//  mailcore2
+//
+//  Created by agent on 10/18/26.
+//  Copyright (c) 2026 MailCore. All rights reserved.
+//
+
+#import "MCOIMAPFetchFoldersWithStatusOperation.h"
+
+#include "MCAsyncIMAP.h"
+
+#import "MCOOperation+Private.h"
+#import "MCOUtils.h"
+
+typedef void (^CompletionType)(NSError *error, NSArray * folders, NSDictionary * folderStatuses);
+
+@implementation MCOIMAPFetchFoldersWithStatusOperation {
+    CompletionType _completionBlock;
+}
+
+#define nativeType mailcore::IMAPFetchFoldersWithStatusOperation
+
++ (void) load
+{
+    MCORegisterClass(self, &typeid(nativeType));
+}
+
++ (NSObject *) mco_objectWithMCObject:(mailcore::Object *)object
+{
+    nativeType * op = (nativeType *) object;
+    return [[[self alloc] initWithMCOperation:op] autorelease];
+}
+
+- (void) dealloc
+{
+    [_completionBlock release];
+    [super dealloc];
+}
+
+- (void) start:(void (^)(NSError *error, NSArray * folders, NSDictionary * folderStatuses))completionBlock
+{
+    _completionBlock = [completionBlock copy];
+    [self start];
+}
+
+- (void) cancel
+{
+    [_completionBlock release];
+    _completionBlock = nil;
+    [super cancel];
+}
+
+- (void) operationCompleted
+{
+    if (_completionBlock == NULL)
+        return;
+    
+    nativeType *op = MCO_NATIVE_INSTANCE;
+    if (op->error() == mailcore::ErrorNone) {
+        _completionBlock(nil, MCO_TO_OBJC(op->folders()), MCO_TO_OBJC(op->folderStatuses()));
+    } else {
+        _completionBlock([NSError mco_errorWithErrorCode:op->error()], nil, nil);
+    }
+    [_completionBlock release];
+    _completionBlock = nil;
+}
+
+@end
@@ -0,0 +1,72 @@
+//
+//  MCOIMAPFolderMirror.h
+//  mailcore2
+//
+//  Created by agent on 10/18/26.
+//  Copyright (c) 2026 MailCore. All rights reserved.
+//
+
+#ifndef MAILCORE_MCOIMAPFOLDERMIRROR_H
+
+#define MAILCORE_MCOIMAPFOLDERMIRROR_H
+
+#import <Foundation/Foundation.h>
+#import <MailCore/MCOConstants.h>
+
+@class MCOIndexSet;
+@class MCOIMAPMessage;
+
+/** Local copy of the messages of a folder, stored in a file and updated with a sync folder mirror operation. It should be used from one thread at a time. */
+
+NS_ASSUME_NONNULL_BEGIN
+@interface MCOIMAPFolderMirror : NSObject
+
+/** Path of the folder on the server. */
+@property (nonatomic, copy) NSString * folder;
+
+/** Location of the store. */
+@property (nonatomic, copy) NSString * path;
+
+/** Attributes fetched for new messages. Flags are always fetched. */
+@property (nonatomic, assign) MCOIMAPMessagesRequestKind requestKind;
+
+/** UIDVALIDITY of the folder at the last sync. */
+@property (nonatomic, assign, readonly) uint32_t uidValidity;
+
+/** UIDNEXT of the folder at the last sync. */
+@property (nonatomic, assign, readonly) uint32_t uidNext;
+
+/** HIGHESTMODSEQ of the folder at the last sync. */
+@property (nonatomic, assign, readonly) uint64_t modSequenceValue;
+
+/** Number of messages in the mirror. */
+@property (nonatomic, assign, readonly) unsigned int count;
+
+/** UIDs of the messages in the mirror. */
+@property (nonatomic, strong, readonly) MCOIndexSet * uids;
+
+/** Returns YES if the message is in the mirror. */
+- (BOOL) containsUID:(uint32_t)uid;
+
+/** Returns the flags of the message. */
+- (MCOMessageFlag) flagsForUID:(uint32_t)uid;
+
+/** Returns nil if the message is not in the mirror. */
+- (MCOIMAPMessage * __nullable) messageForUID:(uint32_t)uid;
+
+/** Returns the messages of the mirror with the given UIDs. */
+- (NSArray * /* MCOIMAPMessage */) messagesForUIDs:(MCOIndexSet *)uids;
+
+/** Reads the store. A missing file is not an error: the mirror is then empty. */
+- (MCOErrorCode) load;
+
+/** Writes the store. */
+- (MCOErrorCode) save;
+
+/** Removes all the messages. */
+- (void) reset;
+
+@end
+NS_ASSUME_NONNULL_END
+
+#endif
@@ -0,0 +1,131 @@
+//
+//  MCOIMAPFolderMirror.mm
+//  mailcore2
+//
+//  Created by agent on 10/18/26.
+//  Copyright (c) 2026 MailCore. All rights reserved.
+//
+
+#import "MCOIMAPFolderMirror.h"
+
+#include "MCIMAP.h"
+
+#import "MCOUtils.h"
+
+#define nativeType mailcore::IMAPFolderMirror
+
+@implementation MCOIMAPFolderMirror {
+    mailcore::IMAPFolderMirror * _nativeFolderMirror;
+}
+
++ (void) load
+{
+    MCORegisterClass(self, &typeid(nativeType));
+}
+
+- (instancetype) initWithMCFolderMirror:(mailcore::IMAPFolderMirror *)object
+{
+    self = [super init];
+    
+    object->retain();
+    _nativeFolderMirror = object;
+    
+    return self;
+}
+
+- (void) dealloc
+{
+    MC_SAFE_RELEASE(_nativeFolderMirror);
+    [super dealloc];
+}
+
++ (NSObject *) mco_objectWithMCObject:(mailcore::Object *)object
+{
+    mailcore::IMAPFolderMirror * nativeFolderMirror = (mailcore::IMAPFolderMirror *) object;
+    return [[[self alloc] initWithMCFolderMirror:nativeFolderMirror] autorelease];
+}
+
+- (instancetype) init
+{
+    mailcore::IMAPFolderMirror * nativeFolderMirror = new mailcore::IMAPFolderMirror();
+    self = [self initWithMCFolderMirror:nativeFolderMirror];
+    nativeFolderMirror->release();
+    
+    return self;
+}
+
+- (mailcore::Object *) mco_mcObject
+{
+    return _nativeFolderMirror;
+}
+
+- (NSString *) description
+{
+    return MCO_OBJC_BRIDGE_GET(description);
+}
+
+MCO_OBJC_SYNTHESIZE_STRING(setFolder, folder)
+MCO_OBJC_SYNTHESIZE_STRING(setPath, path)
+MCO_OBJC_SYNTHESIZE_SCALAR(MCOIMAPMessagesRequestKind, mailcore::IMAPMessagesRequestKind, setRequestKind, requestKind)
+
+- (uint32_t) uidValidity
+{
+    return MCO_NATIVE_INSTANCE->uidValidity();
+}
+
+- (uint32_t) uidNext
+{
+    return MCO_NATIVE_INSTANCE->uidNext();
+}
+
+- (uint64_t) modSequenceValue
+{
+    return MCO_NATIVE_INSTANCE->modSequenceValue();
+}
+
+- (unsigned int) count
+{
+    return MCO_NATIVE_INSTANCE->count();
+}
+
+- (MCOIndexSet *) uids
+{
+    return MCO_OBJC_BRIDGE_GET(uids);
+}
+
+- (BOOL) containsUID:(uint32_t)uid
+{
+    return MCO_NATIVE_INSTANCE->containsUID(uid);
+}
+
+- (MCOMessageFlag) flagsForUID:(uint32_t)uid
+{
+    return (MCOMessageFlag) MCO_NATIVE_INSTANCE->flagsForUID(uid);
+}
+
+- (MCOIMAPMessage *) messageForUID:(uint32_t)uid
+{
+    return MCO_TO_OBJC(MCO_NATIVE_INSTANCE->messageForUID(uid));
+}
+
+- (NSArray *) messagesForUIDs:(MCOIndexSet *)uids
+{
+    return MCO_TO_OBJC(MCO_NATIVE_INSTANCE->messagesForUIDs(MCO_FROM_OBJC(mailcore::IndexSet, uids)));
+}
+
+- (MCOErrorCode) load
+{
+    return (MCOErrorCode) MCO_NATIVE_INSTANCE->load();
+}
+
+- (MCOErrorCode) save
+{
+    return (MCOErrorCode) MCO_NATIVE_INSTANCE->save();
+}
+
+- (void) reset
+{
+    MCO_NATIVE_INSTANCE->reset();
+}
+
+@end
@@ -0,0 +1,50 @@
+//
+//  MCOIMAPFolderWatcher.h
+//  mailcore2
+//
+//  Created by agent on 10/18/26.
+//  Copyright (c) 2026 MailCore. All rights reserved.
+//
+
+#ifndef MAILCORE_MCOIMAPFOLDERWATCHER_H
+
+#define MAILCORE_MCOIMAPFOLDERWATCHER_H
+
+#import <Foundation/Foundation.h>
+
+/**
+ This class watches folders for changes on a dedicated connection. It uses NOTIFY (RFC 5465) when the
+ server supports it, and IDLE on a single folder otherwise.
+ The connections of all the watchers are read by a single thread.
+ The blocks are called on the main thread.
+ */
+
+NS_ASSUME_NONNULL_BEGIN
+@interface MCOIMAPFolderWatcher : NSObject
+
+/** Paths of the watched folders. */
+@property (nonatomic, copy) NSArray * /* NSString */ folders;
+
+/** Delay in seconds between the commands that keep the connection alive. Default is 300 seconds. */
+@property (nonatomic, assign) NSTimeInterval keepAliveInterval;
+
+/** YES when the watcher has been started and has not failed or been stopped. */
+@property (nonatomic, assign, readonly, getter=isStarted) BOOL started;
+
+/**
+ Starts watching the folders.
+
+ @param eventsBlock Called with the changes as MCOIMAPNotifyEvent. When NOTIFY is used, the first events are the status of the folders.
+
+ @param failureBlock Called when the watcher stopped because of an error. It can be started again.
+*/
+- (void) startWithEventsBlock:(void (^)(NSArray * /* MCOIMAPNotifyEvent */ events))eventsBlock
+                 failureBlock:(void (^)(NSError * error))failureBlock;
+
+/** Stops watching the folders. */
+- (void) stop;
+
+@end
+NS_ASSUME_NONNULL_END
+
+#endif
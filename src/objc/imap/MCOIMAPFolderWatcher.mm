@@ -0,0 +1,160 @@
+//
+//  MCOIMAPFolderWatcher.mm
+//  mailcore2
+//
+//  Created by agent on 10/18/26.
+//  Copyright (c) 2026 MailCore. All rights reserved.
+//
+
+#import "MCOIMAPFolderWatcher.h"
+
+#include "MCAsyncIMAP.h"
+
+#import "MCOUtils.h"
+
+typedef void (^EventsType)(NSArray * events);
+typedef void (^FailureType)(NSError * error);
+
+@interface MCOIMAPFolderWatcher ()
+
+- (void) _receivedEvents:(NSArray *)events;
+- (void) _failedWithErrorCode:(mailcore::ErrorCode)errorCode;
+- (void) _finished;
+
+@end
+
+class MCOIMAPFolderWatcherCallbackBridge : public mailcore::IMAPFolderWatcherCallback {
+public:
+    MCOIMAPFolderWatcherCallbackBridge(MCOIMAPFolderWatcher * watcher)
+    {
+        mWatcher = watcher;
+    }
+    
+    virtual void folderWatcherReceivedEvents(mailcore::IMAPFolderWatcher * watcher, mailcore::Array * events)
+    {
+        @autoreleasepool {
+            [mWatcher _receivedEvents:MCO_TO_OBJC(events)];
+        }
+    }
+    
+    virtual void folderWatcherFailed(mailcore::IMAPFolderWatcher * watcher, mailcore::ErrorCode error)
+    {
+        @autoreleasepool {
+            [mWatcher _failedWithErrorCode:error];
+        }
+    }
+    
+private:
+    MCOIMAPFolderWatcher * mWatcher;
+};
+
+@implementation MCOIMAPFolderWatcher {
+    mailcore::IMAPFolderWatcher * _nativeWatcher;
+    MCOIMAPFolderWatcherCallbackBridge * _callbackBridge;
+    EventsType _eventsBlock;
+    FailureType _failureBlock;
+}
+
+#define nativeType mailcore::IMAPFolderWatcher
+
++ (void) load
+{
+    MCORegisterClass(self, &typeid(nativeType));
+}
+
++ (NSObject *) mco_objectWithMCObject:(mailcore::Object *)object
+{
+    nativeType * watcher = (nativeType *) object;
+    return [[[self alloc] initWithMCFolderWatcher:watcher] autorelease];
+}
+
+- (instancetype) initWithMCFolderWatcher:(mailcore::IMAPFolderWatcher *)watcher
+{
+    self = [super init];
+    
+    watcher->retain();
+    _nativeWatcher = watcher;
+    _callbackBridge = new MCOIMAPFolderWatcherCallbackBridge(self);
+    _nativeWatcher->setCallback(_callbackBridge);
+    
+    return self;
+}
+
+- (void) dealloc
+{
+    _nativeWatcher->stop();
+    _nativeWatcher->setCallback(NULL);
+    delete _callbackBridge;
+    MC_SAFE_RELEASE(_nativeWatcher);
+    [_eventsBlock release];
+    [_failureBlock release];
+    [super dealloc];
+}
+
+- (mailcore::Object *) mco_mcObject
+{
+    return _nativeWatcher;
+}
+
+- (NSString *) description
+{
+    return MCO_OBJC_BRIDGE_GET(description);
+}
+
+MCO_OBJC_SYNTHESIZE_ARRAY(setFolders, folders)
+MCO_OBJC_SYNTHESIZE_SCALAR(NSTimeInterval, time_t, setKeepAliveInterval, keepAliveInterval)
+
+- (BOOL) isStarted
+{
+    return MCO_NATIVE_INSTANCE->isStarted();
+}
+
+- (void) startWithEventsBlock:(void (^)(NSArray * events))eventsBlock
+                 failureBlock:(void (^)(NSError * error))failureBlock
+{
+    if (MCO_NATIVE_INSTANCE->isStarted()) {
+        return;
+    }
+    _eventsBlock = [eventsBlock copy];
+    _failureBlock = [failureBlock copy];
+    // Keeps the watcher alive while it's running.
+    [self retain];
+    MCO_NATIVE_INSTANCE->start();
+}
+
+- (void) stop
+{
+    if (!MCO_NATIVE_INSTANCE->isStarted()) {
+        return;
+    }
+    MCO_NATIVE_INSTANCE->stop();
+    [self _finished];
+}
+
+- (void) _finished
+{
+    [_eventsBlock release];
+    _eventsBlock = nil;
+    [_failureBlock release];
+    _failureBlock = nil;
+    [self autorelease];
+}
+
+- (void) _receivedEvents:(NSArray *)events
+{
+    if (_eventsBlock != NULL) {
+        _eventsBlock(events);
+    }
+}
+
+- (void) _failedWithErrorCode:(mailcore::ErrorCode)errorCode
+{
+    FailureType failureBlock = [_failureBlock retain];
+    [self _finished];
+    if (failureBlock != NULL) {
+        failureBlock([NSError mco_errorWithErrorCode:errorCode]);
+    }
+    [failureBlock release];
+}
+
+@end
@@ -0,0 +1,51 @@
+//
+//  MCOIMAPNotifyEvent.h
+//  mailcore2
+//
+//  Created by agent on 10/18/26.
+//  Copyright (c) 2026 MailCore. All rights reserved.
+//
+
+#ifndef MAILCORE_MCOIMAPNOTIFYEVENT_H
+
+#define MAILCORE_MCOIMAPNOTIFYEVENT_H
+
+#import <Foundation/Foundation.h>
+#import <MailCore/MCOConstants.h>
+
+@class MCOIndexSet;
+@class MCOIMAPFolderStatus;
+
+/** A change of a folder reported by a folder watcher. */
+
+NS_ASSUME_NONNULL_BEGIN
+@interface MCOIMAPNotifyEvent : NSObject <NSCopying>
+
+/** Kind of the change. */
+@property (nonatomic, assign) MCOIMAPNotifyEventKind kind;
+
+/** Path of the folder. */
+@property (nonatomic, copy) NSString * folder;
+
+/** New message count or sequence number of the message, depending on the kind. */
+@property (nonatomic, assign) uint32_t number;
+
+/** UID of the message whose flags changed. */
+@property (nonatomic, assign) uint32_t uid;
+
+/** Flags of the message. */
+@property (nonatomic, assign) MCOMessageFlag flags;
+
+/** Modification sequence of the message. */
+@property (nonatomic, assign) uint64_t modSequenceValue;
+
+/** UIDs of the messages that have been removed. */
+@property (nonatomic, copy, nullable) MCOIndexSet * uids;
+
+/** Status of a folder that is not selected. */
+@property (nonatomic, copy, nullable) MCOIMAPFolderStatus * status;
+
+@end
+NS_ASSUME_NONNULL_END
+
+#endif
@@ -0,0 +1,85 @@
+//
+//  MCOIMAPNotifyEvent.mm
+//  mailcore2
+//
+//  Created by agent on 10/18/26.
+//  Copyright (c) 2026 MailCore. All rights reserved.
+//
+
+#import "MCOIMAPNotifyEvent.h"
+
+#include "MCIMAP.h"
+
+#import "MCOUtils.h"
+#import "MCOIMAPFolderStatus.h"
+
+#define nativeType mailcore::IMAPNotifyEvent
+
+@implementation MCOIMAPNotifyEvent {
+    mailcore::IMAPNotifyEvent * _nativeNotifyEvent;
+}
+
++ (void) load
+{
+    MCORegisterClass(self, &typeid(nativeType));
+}
+
+- (instancetype) initWithMCNotifyEvent:(mailcore::IMAPNotifyEvent *)object
+{
+    self = [super init];
+    
+    object->retain();
+    _nativeNotifyEvent = object;
+    
+    return self;
+}
+
+- (void) dealloc
+{
+    MC_SAFE_RELEASE(_nativeNotifyEvent);
+    [super dealloc];
+}
+
++ (NSObject *) mco_objectWithMCObject:(mailcore::Object *)object
+{
+    mailcore::IMAPNotifyEvent * nativeNotifyEvent = (mailcore::IMAPNotifyEvent *) object;
+    return [[[self alloc] initWithMCNotifyEvent:nativeNotifyEvent] autorelease];
+}
+
+- (instancetype) init
+{
+    mailcore::IMAPNotifyEvent * nativeNotifyEvent = new mailcore::IMAPNotifyEvent();
+    self = [self initWithMCNotifyEvent:nativeNotifyEvent];
+    nativeNotifyEvent->release();
+    
+    return self;
+}
+
+- (mailcore::Object *) mco_mcObject
+{
+    return _nativeNotifyEvent;
+}
+
+- (id) copyWithZone:(NSZone *)zone
+{
+    nativeType * nativeObject = (nativeType *) [self mco_mcObject]->copy();
+    id result = [[self class] mco_objectWithMCObject:nativeObject];
+    MC_SAFE_RELEASE(nativeObject);
+    return [result retain];
+}
+
+- (NSString *) description
+{
+    return MCO_OBJC_BRIDGE_GET(description);
+}
+
+MCO_OBJC_SYNTHESIZE_SCALAR(MCOIMAPNotifyEventKind, mailcore::IMAPNotifyEventKind, setKind, kind)
+MCO_OBJC_SYNTHESIZE_STRING(setFolder, folder)
+MCO_OBJC_SYNTHESIZE_SCALAR(uint32_t, uint32_t, setNumber, number)
+MCO_OBJC_SYNTHESIZE_SCALAR(uint32_t, uint32_t, setUid, uid)
+MCO_OBJC_SYNTHESIZE_SCALAR(MCOMessageFlag, mailcore::MessageFlag, setFlags, flags)
+MCO_OBJC_SYNTHESIZE_SCALAR(uint64_t, uint64_t, setModSequenceValue, modSequenceValue)
+MCO_OBJC_SYNTHESIZE(IndexSet, setUids, uids)
+MCO_OBJC_SYNTHESIZE(IMAPFolderStatus, setStatus, status)
+
+@end
@@ -15,6 +15,7 @@
 #import <MailCore/MCOIMAPBaseOperation.h>
 
 @class MCOIndexSet;
+@class MCOIMAPSearchResult;
 
 NS_ASSUME_NONNULL_BEGIN
 @interface MCOIMAPSearchOperation : MCOIMAPBaseOperation
@@ -32,6 +33,19 @@ NS_ASSUME_NONNULL_BEGIN
 
 - (void) start:(void (^)(NSError * __nullable error, MCOIndexSet * __nullable searchResult))completionBlock;
 
+/**
+ Starts the asynchronous extended or partial search operation.
+
+ @param completionBlock Called when the operation is finished.
+
+ - On success `error` will be nil and `result` will contain the requested values
+
+ - On failure, `error` will be set with `MCOErrorDomain` as domain and an
+   error code available in MCOConstants.h, `result` will be nil
+*/
+
+- (void) startWithResult:(void (^)(NSError * __nullable error, MCOIMAPSearchResult * __nullable result))completionBlock;
+
 @end
 NS_ASSUME_NONNULL_END
 
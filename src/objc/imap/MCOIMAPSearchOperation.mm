@@ -9,15 +9,19 @@
 #import "MCOIMAPSearchOperation.h"
 
 #include "MCAsyncIMAP.h"
+#include "MCIMAP.h"
 
 #import "MCOOperation+Private.h"
 #import "MCOUtils.h"
 #import "MCOIndexSet.h"
+#import "MCOIMAPSearchResult.h"
 
 typedef void (^CompletionType)(NSError *error, MCOIndexSet * searchResult);
+typedef void (^ResultCompletionType)(NSError *error, MCOIMAPSearchResult * result);
 
 @implementation MCOIMAPSearchOperation {
     CompletionType _completionBlock;
+    ResultCompletionType _resultCompletionBlock;
 }
 
 #define nativeType mailcore::IMAPSearchOperation
@@ -36,6 +40,7 @@ typedef void (^CompletionType)(NSError *error, MCOIndexSet * searchResult);
 - (void) dealloc
 {
     [_completionBlock release];
+    [_resultCompletionBlock release];
     [super dealloc];
 }
 
@@ -45,15 +50,27 @@ typedef void (^CompletionType)(NSError *error, MCOIndexSet * searchResult);
     [self start];
 }
 
+- (void) startWithResult:(void (^)(NSError *error, MCOIMAPSearchResult * result))completionBlock
+{
+    _resultCompletionBlock = [completionBlock copy];
+    [self start];
+}
+
 - (void) cancel
 {
     [_completionBlock release];
     _completionBlock = nil;
+    [_resultCompletionBlock release];
+    _resultCompletionBlock = nil;
     [super cancel];
 }
 
 - (void) operationCompleted
 {
+    if (_resultCompletionBlock != NULL) {
+        [self _resultOperationCompleted];
+        return;
+    }
     if (_completionBlock == NULL)
         return;
     
@@ -67,4 +84,16 @@ typedef void (^CompletionType)(NSError *error, MCOIndexSet * searchResult);
     _completionBlock = nil;
 }
 
+- (void) _resultOperationCompleted
+{
+    nativeType *op = MCO_NATIVE_INSTANCE;
+    if (op->error() == mailcore::ErrorNone) {
+        _resultCompletionBlock(nil, MCO_TO_OBJC(op->searchResult()));
+    } else {
+        _resultCompletionBlock([NSError mco_errorWithErrorCode:op->error()], nil);
+    }
+    [_resultCompletionBlock release];
+    _resultCompletionBlock = nil;
+}
+
 @end
@@ -0,0 +1,38 @@
+//
+//  MCOIMAPSearchResult.h
+//  mailcore2
+//
+//  Created by agent on 10/18/26.
+//  Copyright (c) 2026 MailCore. All rights reserved.
+//
+
+#ifndef MAILCORE_MCOIMAPSEARCHRESULT_H
+
+#define MAILCORE_MCOIMAPSEARCHRESULT_H
+
+#import <Foundation/Foundation.h>
+#import <MailCore/MCOConstants.h>
+
+@class MCOIndexSet;
+
+/** Result of an extended or partial search. */
+
+NS_ASSUME_NONNULL_BEGIN
+@interface MCOIMAPSearchResult : NSObject <NSCopying>
+
+/** Lowest matching UID. */
+@property (nonatomic, assign) uint32_t minUID;
+
+/** Highest matching UID. */
+@property (nonatomic, assign) uint32_t maxUID;
+
+/** Number of matching messages. */
+@property (nonatomic, assign) uint32_t count;
+
+/** Matching UIDs. For a partial search, only the UIDs of the requested positions. */
+@property (nonatomic, copy, nullable) MCOIndexSet * uids;
+
+@end
+NS_ASSUME_NONNULL_END
+
+#endif
@@ -0,0 +1,80 @@
+//
+//  MCOIMAPSearchResult.mm
+//  mailcore2
+//
+//  Created by agent on 10/18/26.
+//  Copyright (c) 2026 MailCore. All rights reserved.
+//
+
+#import "MCOIMAPSearchResult.h"
+
+#include "MCIMAP.h"
+
+#import "MCOUtils.h"
+
+#define nativeType mailcore::IMAPSearchResult
+
+@implementation MCOIMAPSearchResult {
+    mailcore::IMAPSearchResult * _nativeSearchResult;
+}
+
++ (void) load
+{
+    MCORegisterClass(self, &typeid(nativeType));
+}
+
+- (instancetype) initWithMCSearchResult:(mailcore::IMAPSearchResult *)object
+{
+    self = [super init];
+    
+    object->retain();
+    _nativeSearchResult = object;
+    
+    return self;
+}
+
+- (void) dealloc
+{
+    MC_SAFE_RELEASE(_nativeSearchResult);
+    [super dealloc];
+}
+
++ (NSObject *) mco_objectWithMCObject:(mailcore::Object *)object
+{
+    mailcore::IMAPSearchResult * nativeSearchResult = (mailcore::IMAPSearchResult *) object;
+    return [[[self alloc] initWithMCSearchResult:nativeSearchResult] autorelease];
+}
+
+- (instancetype) init
+{
+    mailcore::IMAPSearchResult * nativeSearchResult = new mailcore::IMAPSearchResult();
+    self = [self initWithMCSearchResult:nativeSearchResult];
+    nativeSearchResult->release();
+    
+    return self;
+}
+
+- (mailcore::Object *) mco_mcObject
+{
+    return _nativeSearchResult;
+}
+
+- (id) copyWithZone:(NSZone *)zone
+{
+    nativeType * nativeObject = (nativeType *) [self mco_mcObject]->copy();
+    id result = [[self class] mco_objectWithMCObject:nativeObject];
+    MC_SAFE_RELEASE(nativeObject);
+    return [result retain];
+}
+
+- (NSString *) description
+{
+    return MCO_OBJC_BRIDGE_GET(description);
+}
+
+MCO_OBJC_SYNTHESIZE_SCALAR(uint32_t, uint32_t, setMinUID, minUID)
+MCO_OBJC_SYNTHESIZE_SCALAR(uint32_t, uint32_t, setMaxUID, maxUID)
+MCO_OBJC_SYNTHESIZE_SCALAR(uint32_t, uint32_t, setCount, count)
+MCO_OBJC_SYNTHESIZE(IndexSet, setUids, uids)
+
+@end
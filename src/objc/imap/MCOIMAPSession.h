@@ -12,6 +12,7 @@
 
 #import <Foundation/Foundation.h>
 #import <MailCore/MCOConstants.h>
+#import <MailCore/MCORange.h>
 
 @class MCOIMAPFetchFoldersOperation;
 @class MCOIMAPOperation;
@@ -37,6 +38,15 @@
 @class MCOIMAPMessage;
 @class MCOIMAPIdentity;
 @class MCOIMAPCustomCommandOperation;
+@class MCOIMAPFetchFoldersWithStatusOperation;
+@class MCOIMAPAppendMessagesOperation;
+@class MCOIMAPBatchOperation;
+@class MCOIMAPFolderMirror;
+@class MCOIMAPSyncFolderMirrorOperation;
+@class MCOIMAPSortOperation;
+@class MCOIMAPThreadOperation;
+@class MCOIMAPFolderWatcher;
+@class MCOIMAPBodyCache;
 
 /**
  This is the main IMAP class from which all operations are created
@@ -115,6 +125,18 @@
 */
 @property (nonatomic, assign) unsigned int maximumConnections;
 
+/**
+ When set to YES, folder info, folder status, store flags and fetch messages operations
+ queued right after a compatible pending operation are merged into a single request.
+*/
+@property (nonatomic, assign, getter=isOperationCoalescingEnabled) BOOL operationCoalescingEnabled;
+
+/** Number of round trips saved by merging operations. */
+@property (nonatomic, assign, readonly) unsigned int coalescedOperationsCount;
+
+/** On-disk cache of message contents and attachments fetched by UID, shared by all the connections. */
+@property (nonatomic, strong) MCOIMAPBodyCache * bodyCache;
+
 /**
  Sets logger callback. The network traffic will be sent to this block.
 
@@ -209,6 +231,17 @@
 */
 - (MCOIMAPFetchFoldersOperation *) fetchAllFoldersOperation;
 
+/**
+ Returns an operation that gets all folders and their status.
+ It uses LIST-STATUS (RFC 5819) when available and STATUS for each folder otherwise.
+
+     MCOIMAPFetchFoldersWithStatusOperation * op = [session fetchAllFoldersWithStatusOperation];
+     [op start:^(NSError * __nullable error, NSArray * folders, NSDictionary * folderStatuses) {
+          ...
+     }];
+*/
+- (MCOIMAPFetchFoldersWithStatusOperation *) fetchAllFoldersWithStatusOperation;
+
 /**
  Creates an operation for renaming a folder
 
@@ -466,6 +499,51 @@
                                                  kind:(MCOIMAPStoreFlagsRequestKind)kind
                                                labels:(NSArray<NSString *> *)labels;
 
+/**
+ Returns an operation to add many messages to a folder. It uses MULTIAPPEND (RFC 3502) when available.
+
+     MCOIMAPAppendItem * item = [[MCOIMAPAppendItem alloc] init];
+     [item setMessageData:rfc822Data];
+     MCOIMAPAppendMessagesOperation * op = [session appendMessagesOperationWithFolder:@"Archive"
+                                                                                items:@[item]];
+     [op start:^(NSError * __nullable error, MCOIndexSet * createdUIDs) {
+          ...
+     }];
+*/
+- (MCOIMAPAppendMessagesOperation *) appendMessagesOperationWithFolder:(NSString *)folder
+                                                                 items:(NSArray * /* MCOIMAPAppendItem */)items;
+
+/**
+ Returns an operation to change flags of messages in many folders.
+ folderUids maps the names of the folders to the MCOIndexSet of the UIDs.
+
+     MCOIMAPBatchOperation * op = [session batchStoreFlagsOperationWithFolderUids:@{@"INBOX": uids, @"Work": otherUids}
+                                                                             kind:MCOIMAPStoreFlagsRequestKindAdd
+                                                                            flags:MCOMessageFlagSeen
+                                                                      customFlags:nil];
+     [op start:^(NSError * __nullable error, NSDictionary * folderErrors, NSDictionary * uidMappings) {
+          ...
+     }];
+*/
+- (MCOIMAPBatchOperation *) batchStoreFlagsOperationWithFolderUids:(NSDictionary *)folderUids
+                                                              kind:(MCOIMAPStoreFlagsRequestKind)kind
+                                                             flags:(MCOMessageFlag)flags
+                                                       customFlags:(NSArray<NSString *> *)customFlags;
+
+/**
+ Returns an operation to copy messages of many folders to a folder.
+ folderUids maps the names of the folders to the MCOIndexSet of the UIDs.
+*/
+- (MCOIMAPBatchOperation *) batchCopyMessagesOperationWithFolderUids:(NSDictionary *)folderUids
+                                                          destFolder:(NSString *)destFolder;
+
+/**
+ Returns an operation to move messages of many folders to a folder.
+ folderUids maps the names of the folders to the MCOIndexSet of the UIDs.
+*/
+- (MCOIMAPBatchOperation *) batchMoveMessagesOperationWithFolderUids:(NSDictionary *)folderUids
+                                                          destFolder:(NSString *)destFolder;
+
 /** @name Fetching Messages */
 
 /**
@@ -914,6 +992,34 @@ vanishedMessages will be set only for servers that support QRESYNC. See [RFC5162
 */
 - (MCOIMAPFetchNamespaceOperation *) fetchNamespaceOperation;
 
+/**
+ Returns an operation to update a folder mirror from the server and save it.
+ The mirror should not be used until the operation has finished.
+
+     MCOIMAPFolderMirror * mirror = [[MCOIMAPFolderMirror alloc] init];
+     [mirror setFolder:@"INBOX"];
+     [mirror setPath:path];
+     [mirror load];
+     MCOIMAPSyncFolderMirrorOperation * op = [session syncFolderMirrorOperation:mirror];
+     [op start:^(NSError * __nullable error, NSArray * modifiedOrAddedMessages, MCOIndexSet * vanishedMessages) {
+          ...
+     }];
+*/
+- (MCOIMAPSyncFolderMirrorOperation *) syncFolderMirrorOperation:(MCOIMAPFolderMirror *)mirror;
+
+/**
+ Returns a watcher of folders with its own connection. Many watchers can be started without using
+ one thread each.
+
+     MCOIMAPFolderWatcher * watcher = [session folderWatcherWithFolders:@[@"INBOX", @"Work"]];
+     [watcher startWithEventsBlock:^(NSArray * events) {
+          ...
+     } failureBlock:^(NSError * error) {
+          ...
+     }];
+*/
+- (MCOIMAPFolderWatcher *) folderWatcherWithFolders:(NSArray * /* NSString */)folders;
+
 /**
  Returns an operation to send the client or get the server identity.
 
@@ -1002,6 +1108,69 @@ vanishedMessages will be set only for servers that support QRESYNC. See [RFC5162
 - (MCOIMAPSearchOperation *) searchExpressionOperationWithFolder:(NSString *)folder
                                                       expression:(MCOIMAPSearchExpression *)expression;
 
+/**
+ Returns an operation to search for messages that only returns the requested values.
+ It uses ESEARCH (RFC 4731) when available.
+
+     MCOIMAPSearchOperation * op = [session extendedSearchOperationWithFolder:@"INBOX"
+                                                                   expression:expr
+                                                                returnOptions:MCOIMAPSearchReturnOptionCount];
+     [op startWithResult:^(NSError * __nullable error, MCOIMAPSearchResult * result) {
+          ...
+     }];
+*/
+- (MCOIMAPSearchOperation *) extendedSearchOperationWithFolder:(NSString *)folder
+                                                    expression:(MCOIMAPSearchExpression *)expression
+                                                 returnOptions:(MCOIMAPSearchReturnOption)returnOptions;
+
+/**
+ Returns an operation to search for one page of the matching messages, and their total count.
+ positions are the positions of the UIDs in the results, starting at 0, from the highest UID when fromEnd is YES.
+ It uses PARTIAL (RFC 5267 and RFC 9394) when available.
+
+     MCOIMAPSearchOperation * op = [session partialSearchOperationWithFolder:@"INBOX"
+                                                                  expression:expr
+                                                                   positions:MCORangeMake(0, 49)
+                                                                     fromEnd:YES];
+     [op startWithResult:^(NSError * __nullable error, MCOIMAPSearchResult * result) {
+          ...
+     }];
+*/
+- (MCOIMAPSearchOperation *) partialSearchOperationWithFolder:(NSString *)folder
+                                                   expression:(MCOIMAPSearchExpression *)expression
+                                                    positions:(MCORange)positions
+                                                      fromEnd:(BOOL)fromEnd;
+
+/**
+ Returns an operation to sort the messages matching the expression, or all the messages when it's nil.
+ It uses SORT (RFC 5256) when available and sorts locally otherwise.
+
+     MCOIMAPSortOperation * op = [session sortOperationWithFolder:@"INBOX"
+                                                         criteria:@[[MCOIMAPSortCriterion criterionWithKind:MCOIMAPSortKindDate reversed:YES]]
+                                                       expression:nil];
+     [op start:^(NSError * __nullable error, NSArray * uids) {
+          ...
+     }];
+*/
+- (MCOIMAPSortOperation *) sortOperationWithFolder:(NSString *)folder
+                                          criteria:(NSArray * /* MCOIMAPSortCriterion */)criteria
+                                        expression:(MCOIMAPSearchExpression *)expression;
+
+/**
+ Returns an operation to group by conversation the messages matching the expression, or all the messages when it's nil.
+ It uses THREAD (RFC 5256) when the server supports the algorithm and threads locally otherwise.
+
+     MCOIMAPThreadOperation * op = [session threadOperationWithFolder:@"INBOX"
+                                                            algorithm:MCOIMAPThreadAlgorithmReferences
+                                                           expression:nil];
+     [op start:^(NSError * __nullable error, NSArray * threads) {
+          ...
+     }];
+*/
+- (MCOIMAPThreadOperation *) threadOperationWithFolder:(NSString *)folder
+                                             algorithm:(MCOIMAPThreadAlgorithm)algorithm
+                                            expression:(MCOIMAPSearchExpression *)expression;
+
 /** @name Rendering Operations */
 
 /**
@@ -16,6 +16,8 @@
 #import "MCOIMAPBaseOperation+Private.h"
 #import "MCOIMAPMessageRenderingOperation.h"
 #import "MCOIMAPIdentity.h"
+#import "MCOIMAPBodyCache.h"
+#import "MCOIMAPFolderMirror.h"
 
 #import "MCOUtils.h"
 
@@ -107,6 +109,8 @@ MCO_OBJC_SYNTHESIZE_BOOL(setCheckCertificateEnabled, isCheckCertificateEnabled)
 MCO_OBJC_SYNTHESIZE_BOOL(setVoIPEnabled, isVoIPEnabled)
 MCO_OBJC_SYNTHESIZE_SCALAR(BOOL, BOOL, setAllowsFolderConcurrentAccessEnabled, allowsFolderConcurrentAccessEnabled)
 MCO_OBJC_SYNTHESIZE_SCALAR(unsigned int, unsigned int, setMaximumConnections, maximumConnections)
+MCO_OBJC_SYNTHESIZE_BOOL(setOperationCoalescingEnabled, isOperationCoalescingEnabled)
+MCO_OBJC_SYNTHESIZE(IMAPBodyCache, setBodyCache, bodyCache)
 MCO_OBJC_SYNTHESIZE_SCALAR(dispatch_queue_t, dispatch_queue_t, setDispatchQueue, dispatchQueue);
 
 - (void) setDefaultNamespace:(MCOIMAPNamespace *)defaultNamespace
@@ -227,6 +231,12 @@ MCO_OBJC_SYNTHESIZE_SCALAR(dispatch_queue_t, dispatch_queue_t, setDispatchQueue,
     return MCO_TO_OBJC_OP(coreOp);
 }
 
+- (MCOIMAPFetchFoldersWithStatusOperation *) fetchAllFoldersWithStatusOperation
+{
+    IMAPFetchFoldersWithStatusOperation * coreOp = MCO_NATIVE_INSTANCE->fetchAllFoldersWithStatusOperation();
+    return MCO_TO_OBJC_OP(coreOp);
+}
+
 - (MCOIMAPOperation *) renameFolderOperation:(NSString *)folder otherName:(NSString *)otherName
 {
     IMAPOperation *coreOp = MCO_NATIVE_INSTANCE->renameFolderOperation([folder mco_mcString], [otherName mco_mcString]);
@@ -587,6 +597,42 @@ MCO_OBJC_SYNTHESIZE_SCALAR(dispatch_queue_t, dispatch_queue_t, setDispatchQueue,
     return OPAQUE_OPERATION(coreOp);
 }
 
+- (MCOIMAPAppendMessagesOperation *) appendMessagesOperationWithFolder:(NSString *)folder
+                                                                 items:(NSArray *)items
+{
+    IMAPAppendMessagesOperation * coreOp = MCO_NATIVE_INSTANCE->appendMessagesOperation([folder mco_mcString],
+                                                                                        MCO_FROM_OBJC(Array, items));
+    return MCO_TO_OBJC_OP(coreOp);
+}
+
+- (MCOIMAPBatchOperation *) batchStoreFlagsOperationWithFolderUids:(NSDictionary *)folderUids
+                                                              kind:(MCOIMAPStoreFlagsRequestKind)kind
+                                                             flags:(MCOMessageFlag)flags
+                                                       customFlags:(NSArray<NSString *> *)customFlags
+{
+    IMAPBatchOperation * coreOp = MCO_NATIVE_INSTANCE->batchStoreFlagsOperation(MCO_FROM_OBJC(HashMap, folderUids),
+                                                                                (IMAPStoreFlagsRequestKind) kind,
+                                                                                (MessageFlag) flags,
+                                                                                MCO_FROM_OBJC(Array, customFlags));
+    return MCO_TO_OBJC_OP(coreOp);
+}
+
+- (MCOIMAPBatchOperation *) batchCopyMessagesOperationWithFolderUids:(NSDictionary *)folderUids
+                                                          destFolder:(NSString *)destFolder
+{
+    IMAPBatchOperation * coreOp = MCO_NATIVE_INSTANCE->batchCopyMessagesOperation(MCO_FROM_OBJC(HashMap, folderUids),
+                                                                                  [destFolder mco_mcString]);
+    return MCO_TO_OBJC_OP(coreOp);
+}
+
+- (MCOIMAPBatchOperation *) batchMoveMessagesOperationWithFolderUids:(NSDictionary *)folderUids
+                                                          destFolder:(NSString *)destFolder
+{
+    IMAPBatchOperation * coreOp = MCO_NATIVE_INSTANCE->batchMoveMessagesOperation(MCO_FROM_OBJC(HashMap, folderUids),
+                                                                                  [destFolder mco_mcString]);
+    return MCO_TO_OBJC_OP(coreOp);
+}
+
 - (MCOIMAPSearchOperation *) searchOperationWithFolder:(NSString *)folder
                                                   kind:(MCOIMAPSearchKind)kind
                                           searchString:(NSString *)searchString
@@ -605,6 +651,48 @@ MCO_OBJC_SYNTHESIZE_SCALAR(dispatch_queue_t, dispatch_queue_t, setDispatchQueue,
     return MCO_TO_OBJC_OP(coreOp);
 }
 
+- (MCOIMAPSearchOperation *) extendedSearchOperationWithFolder:(NSString *)folder
+                                                    expression:(MCOIMAPSearchExpression *)expression
+                                                 returnOptions:(MCOIMAPSearchReturnOption)returnOptions
+{
+    IMAPSearchOperation * coreOp = MCO_NATIVE_INSTANCE->extendedSearchOperation([folder mco_mcString],
+                                                                                MCO_FROM_OBJC(IMAPSearchExpression, expression),
+                                                                                (IMAPSearchReturnOption) returnOptions);
+    return MCO_TO_OBJC_OP(coreOp);
+}
+
+- (MCOIMAPSearchOperation *) partialSearchOperationWithFolder:(NSString *)folder
+                                                   expression:(MCOIMAPSearchExpression *)expression
+                                                    positions:(MCORange)positions
+                                                      fromEnd:(BOOL)fromEnd
+{
+    IMAPSearchOperation * coreOp = MCO_NATIVE_INSTANCE->partialSearchOperation([folder mco_mcString],
+                                                                               MCO_FROM_OBJC(IMAPSearchExpression, expression),
+                                                                               MCORangeToMCRange(positions),
+                                                                               fromEnd);
+    return MCO_TO_OBJC_OP(coreOp);
+}
+
+- (MCOIMAPSortOperation *) sortOperationWithFolder:(NSString *)folder
+                                          criteria:(NSArray *)criteria
+                                        expression:(MCOIMAPSearchExpression *)expression
+{
+    IMAPSortOperation * coreOp = MCO_NATIVE_INSTANCE->sortOperation([folder mco_mcString],
+                                                                    MCO_FROM_OBJC(Array, criteria),
+                                                                    MCO_FROM_OBJC(IMAPSearchExpression, expression));
+    return MCO_TO_OBJC_OP(coreOp);
+}
+
+- (MCOIMAPThreadOperation *) threadOperationWithFolder:(NSString *)folder
+                                             algorithm:(MCOIMAPThreadAlgorithm)algorithm
+                                            expression:(MCOIMAPSearchExpression *)expression
+{
+    IMAPThreadOperation * coreOp = MCO_NATIVE_INSTANCE->threadOperation([folder mco_mcString],
+                                                                        (IMAPThreadAlgorithm) algorithm,
+                                                                        MCO_FROM_OBJC(IMAPSearchExpression, expression));
+    return MCO_TO_OBJC_OP(coreOp);
+}
+
 - (MCOIMAPIdleOperation *) idleOperationWithFolder:(NSString *)folder
                                       lastKnownUID:(uint32_t)lastKnownUID
 {
@@ -618,6 +706,17 @@ MCO_OBJC_SYNTHESIZE_SCALAR(dispatch_queue_t, dispatch_queue_t, setDispatchQueue,
     return MCO_TO_OBJC_OP(coreOp);
 }
 
+- (MCOIMAPSyncFolderMirrorOperation *) syncFolderMirrorOperation:(MCOIMAPFolderMirror *)mirror
+{
+    IMAPSyncFolderMirrorOperation * coreOp = MCO_NATIVE_INSTANCE->syncFolderMirrorOperation(MCO_FROM_OBJC(IMAPFolderMirror, mirror));
+    return MCO_TO_OBJC_OP(coreOp);
+}
+
+- (MCOIMAPFolderWatcher *) folderWatcherWithFolders:(NSArray *)folders
+{
+    return MCO_TO_OBJC(MCO_NATIVE_INSTANCE->folderWatcher(MCO_FROM_OBJC(Array, folders)));
+}
+
 - (MCOIMAPIdentityOperation *) identityOperationWithClientIdentity:(MCOIMAPIdentity *)identity
 {
     IMAPIdentityOperation * coreOp = MCO_NATIVE_INSTANCE->identityOperation(MCO_FROM_OBJC(IMAPIdentity, identity));
@@ -713,4 +812,9 @@ MCO_OBJC_SYNTHESIZE_SCALAR(dispatch_queue_t, dispatch_queue_t, setDispatchQueue,
     return _session->isOperationQueueRunning();
 }
 
+- (unsigned int) coalescedOperationsCount
+{
+    return _session->coalescedOperationsCount();
+}
+
 @end
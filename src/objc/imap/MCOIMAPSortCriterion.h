@@ -0,0 +1,33 @@
+//
+//  MCOIMAPSortCriterion.h
+//  mailcore2
+//
+//  Created by agent on 10/18/26.
+//  Copyright (c) 2026 MailCore. All rights reserved.
+//
+
+#ifndef MAILCORE_MCOIMAPSORTCRITERION_H
+
+#define MAILCORE_MCOIMAPSORTCRITERION_H
+
+#import <Foundation/Foundation.h>
+#import <MailCore/MCOConstants.h>
+
+/** A sort key of a sort operation. */
+
+NS_ASSUME_NONNULL_BEGIN
+@interface MCOIMAPSortCriterion : NSObject <NSCopying>
+
+/** Returns a criterion. When reversed is YES, the order of the key is reversed. */
++ (MCOIMAPSortCriterion *) criterionWithKind:(MCOIMAPSortKind)kind reversed:(BOOL)reversed;
+
+/** Sort key. */
+@property (nonatomic, assign) MCOIMAPSortKind kind;
+
+/** The order of the key is reversed. */
+@property (nonatomic, assign, getter=isReversed) BOOL reversed;
+
+@end
+NS_ASSUME_NONNULL_END
+
+#endif
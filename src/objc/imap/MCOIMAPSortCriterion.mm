@@ -0,0 +1,83 @@
+//
+//  MCOIMAPSortCriterion.mm
+//  mailcore2
+//
+//  Created by agent on 10/18/26.
+//  Copyright (c) 2026 MailCore. All rights reserved.
+//
+
+#import "MCOIMAPSortCriterion.h"
+
+#include "MCIMAP.h"
+
+#import "MCOUtils.h"
+
+#define nativeType mailcore::IMAPSortCriterion
+
+@implementation MCOIMAPSortCriterion {
+    mailcore::IMAPSortCriterion * _nativeSortCriterion;
+}
+
++ (void) load
+{
+    MCORegisterClass(self, &typeid(nativeType));
+}
+
+- (instancetype) initWithMCSortCriterion:(mailcore::IMAPSortCriterion *)object
+{
+    self = [super init];
+    
+    object->retain();
+    _nativeSortCriterion = object;
+    
+    return self;
+}
+
+- (void) dealloc
+{
+    MC_SAFE_RELEASE(_nativeSortCriterion);
+    [super dealloc];
+}
+
++ (NSObject *) mco_objectWithMCObject:(mailcore::Object *)object
+{
+    mailcore::IMAPSortCriterion * nativeSortCriterion = (mailcore::IMAPSortCriterion *) object;
+    return [[[self alloc] initWithMCSortCriterion:nativeSortCriterion] autorelease];
+}
+
+- (instancetype) init
+{
+    mailcore::IMAPSortCriterion * nativeSortCriterion = new mailcore::IMAPSortCriterion();
+    self = [self initWithMCSortCriterion:nativeSortCriterion];
+    nativeSortCriterion->release();
+    
+    return self;
+}
+
+- (mailcore::Object *) mco_mcObject
+{
+    return _nativeSortCriterion;
+}
+
+- (id) copyWithZone:(NSZone *)zone
+{
+    nativeType * nativeObject = (nativeType *) [self mco_mcObject]->copy();
+    id result = [[self class] mco_objectWithMCObject:nativeObject];
+    MC_SAFE_RELEASE(nativeObject);
+    return [result retain];
+}
+
+- (NSString *) description
+{
+    return MCO_OBJC_BRIDGE_GET(description);
+}
+
++ (MCOIMAPSortCriterion *) criterionWithKind:(MCOIMAPSortKind)kind reversed:(BOOL)reversed
+{
+    return MCO_TO_OBJC(mailcore::IMAPSortCriterion::criterion((mailcore::IMAPSortKind) kind, reversed));
+}
+
+MCO_OBJC_SYNTHESIZE_SCALAR(MCOIMAPSortKind, mailcore::IMAPSortKind, setKind, kind)
+MCO_OBJC_SYNTHESIZE_BOOL(setReversed, isReversed)
+
+@end
@@ -0,0 +1,35 @@
+//
+//  MCOIMAPSortOperation.h
+//  mailcore2
+//
+//  Created by agent on 10/18/26.
+//  Copyright (c) 2026 MailCore. All rights reserved.
+//
+
+#ifndef MAILCORE_MCOIMAPSORTOPERATION_H
+
+#define MAILCORE_MCOIMAPSORTOPERATION_H
+
+#import <MailCore/MCOIMAPBaseOperation.h>
+
+/** This class sorts the messages of a folder. It uses SORT (RFC 5256) when available and sorts locally otherwise. */
+
+NS_ASSUME_NONNULL_BEGIN
+@interface MCOIMAPSortOperation : MCOIMAPBaseOperation
+
+/**
+ Starts the asynchronous operation.
+
+ @param completionBlock Called when the operation is finished.
+
+ - On success `error` will be nil and `uids` will contain the UIDs of the messages in order
+
+ - On failure, `error` will be set with `MCOErrorDomain` as domain and an
+ error code available in `MCOConstants.h`, `uids` will be nil
+*/
+- (void) start:(void (^)(NSError * __nullable error, NSArray * /* NSNumber */ __nullable uids))completionBlock;
+
+@end
+NS_ASSUME_NONNULL_END
+
+#endif
@@ -0,0 +1,38 @@
+//
+//  MCOIMAPSyncFolderMirrorOperation.h
+//  mailcore2
+//
+//  Created by agent on 10/18/26.
+//  Copyright (c) 2026 MailCore. All rights reserved.
+//
+
+#ifndef MAILCORE_MCOIMAPSYNCFOLDERMIRROROPERATION_H
+
+#define MAILCORE_MCOIMAPSYNCFOLDERMIRROROPERATION_H
+
+#import <MailCore/MCOIMAPBaseOperation.h>
+
+/** This class updates a folder mirror from the server and saves it. The mirror should not be used until the operation has finished. */
+
+@class MCOIndexSet;
+
+NS_ASSUME_NONNULL_BEGIN
+@interface MCOIMAPSyncFolderMirrorOperation : MCOIMAPBaseOperation
+
+/**
+ Starts the asynchronous operation.
+
+ @param completionBlock Called when the operation is finished.
+
+ - On success `error` will be nil, `modifiedOrAddedMessages` will contain the messages that have been added
+ or whose flags changed and `vanishedMessages` the UIDs of the messages that have been removed
+
+ - On failure, `error` will be set with `MCOErrorDomain` as domain and an
+ error code available in `MCOConstants.h`, `modifiedOrAddedMessages` and `vanishedMessages` will be nil
+*/
+- (void) start:(void (^)(NSError * __nullable error, NSArray * /* MCOIMAPMessage */ __nullable modifiedOrAddedMessages, MCOIndexSet * __nullable vanishedMessages))completionBlock;
+
+@end
+NS_ASSUME_NONNULL_END
+
+#endif
@@ -0,0 +1,70 @@
+//
+//  MCOIMAPSyncFolderMirrorOperation.mm
+//  mailcore2
+//
+//  Created by agent on 10/18/26.
+//  Copyright (c) 2026 MailCore. All rights reserved.
+//
+
+#import "MCOIMAPSyncFolderMirrorOperation.h"
+
+#include "MCAsyncIMAP.h"
+#include "MCIMAP.h"
+
+#import "MCOOperation+Private.h"
+#import "MCOUtils.h"
+
+typedef void (^CompletionType)(NSError *error, NSArray * modifiedOrAddedMessages, MCOIndexSet * vanishedMessages);
+
+@implementation MCOIMAPSyncFolderMirrorOperation {
+    CompletionType _completionBlock;
+}
+
+#define nativeType mailcore::IMAPSyncFolderMirrorOperation
+
++ (void) load
+{
+    MCORegisterClass(self, &typeid(nativeType));
+}
+
++ (NSObject *) mco_objectWithMCObject:(mailcore::Object *)object
+{
+    nativeType * op = (nativeType *) object;
+    return [[[self alloc] initWithMCOperation:op] autorelease];
+}
+
+- (void) dealloc
+{
+    [_completionBlock release];
+    [super dealloc];
+}
+
+- (void) start:(void (^)(NSError *error, NSArray * modifiedOrAddedMessages, MCOIndexSet * vanishedMessages))completionBlock
+{
+    _completionBlock = [completionBlock copy];
+    [self start];
+}
+
+- (void) cancel
+{
+    [_completionBlock release];
+    _completionBlock = nil;
+    [super cancel];
+}
+
+- (void) operationCompleted
+{
+    if (_completionBlock == NULL)
+        return;
+    
+    nativeType *op = MCO_NATIVE_INSTANCE;
+    if (op->error() == mailcore::ErrorNone) {
+        _completionBlock(nil, MCO_TO_OBJC(op->syncResult()->modifiedOrAddedMessages()), MCO_TO_OBJC(op->syncResult()->vanishedMessages()));
+    } else {
+        _completionBlock([NSError mco_errorWithErrorCode:op->error()], nil, nil);
+    }
+    [_completionBlock release];
+    _completionBlock = nil;
+}
+
+@end
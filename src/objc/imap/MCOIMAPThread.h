@@ -0,0 +1,35 @@
+//
+//  MCOIMAPThread.h
+//  mailcore2
+//
+//  Created by agent on 10/18/26.
+//  Copyright (c) 2026 MailCore. All rights reserved.
+//
+
+#ifndef MAILCORE_MCOIMAPTHREAD_H
+
+#define MAILCORE_MCOIMAPTHREAD_H
+
+#import <Foundation/Foundation.h>
+#import <MailCore/MCOConstants.h>
+
+@class MCOIndexSet;
+
+/** A message of a conversation returned by a thread operation, with its replies. */
+
+NS_ASSUME_NONNULL_BEGIN
+@interface MCOIMAPThread : NSObject <NSCopying>
+
+/** UID of the message. It's 0 when the message is not in the folder and only groups its replies. */
+@property (nonatomic, assign) uint32_t uid;
+
+/** Replies to the message. */
+@property (nonatomic, copy) NSArray * /* MCOIMAPThread */ children;
+
+/** UIDs of the message and all its replies. */
+@property (nonatomic, strong, readonly) MCOIndexSet * allUIDs;
+
+@end
+NS_ASSUME_NONNULL_END
+
+#endif
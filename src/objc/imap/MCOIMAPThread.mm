@@ -0,0 +1,83 @@
+//
+//  MCOIMAPThread.mm
+//  mailcore2
+//
+//  Created by agent on 10/18/26.
+//  Copyright (c) 2026 MailCore. All rights reserved.
+//
+
+#import "MCOIMAPThread.h"
+
+#include "MCIMAP.h"
+
+#import "MCOUtils.h"
+
+#define nativeType mailcore::IMAPThread
+
+@implementation MCOIMAPThread {
+    mailcore::IMAPThread * _nativeThread;
+}
+
++ (void) load
+{
+    MCORegisterClass(self, &typeid(nativeType));
+}
+
+- (instancetype) initWithMCThread:(mailcore::IMAPThread *)object
+{
+    self = [super init];
+    
+    object->retain();
+    _nativeThread = object;
+    
+    return self;
+}
+
+- (void) dealloc
+{
+    MC_SAFE_RELEASE(_nativeThread);
+    [super dealloc];
+}
+
++ (NSObject *) mco_objectWithMCObject:(mailcore::Object *)object
+{
+    mailcore::IMAPThread * nativeThread = (mailcore::IMAPThread *) object;
+    return [[[self alloc] initWithMCThread:nativeThread] autorelease];
+}
+
+- (instancetype) init
+{
+    mailcore::IMAPThread * nativeThread = new mailcore::IMAPThread();
+    self = [self initWithMCThread:nativeThread];
+    nativeThread->release();
+    
+    return self;
+}
+
+- (mailcore::Object *) mco_mcObject
+{
+    return _nativeThread;
+}
+
+- (id) copyWithZone:(NSZone *)zone
+{
+    nativeType * nativeObject = (nativeType *) [self mco_mcObject]->copy();
+    id result = [[self class] mco_objectWithMCObject:nativeObject];
+    MC_SAFE_RELEASE(nativeObject);
+    return [result retain];
+}
+
+- (NSString *) description
+{
+    return MCO_OBJC_BRIDGE_GET(description);
+}
+
+MCO_OBJC_SYNTHESIZE_SCALAR(uint32_t, uint32_t, setUid, uid)
+MCO_OBJC_SYNTHESIZE_ARRAY(setChildren, children)
+
+- (MCOIndexSet *) allUIDs
+{
+    return MCO_OBJC_BRIDGE_GET(allUIDs);
+}
+
+@end
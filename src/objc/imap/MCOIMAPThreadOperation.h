@@ -0,0 +1,35 @@
+//
+//  MCOIMAPThreadOperation.h
+//  mailcore2
+//
+//  Created by agent on 10/18/26.
+//  Copyright (c) 2026 MailCore. All rights reserved.
+//
+
+#ifndef MAILCORE_MCOIMAPTHREADOPERATION_H
+
+#define MAILCORE_MCOIMAPTHREADOPERATION_H
+
+#import <MailCore/MCOIMAPBaseOperation.h>
+
+/** This class groups the messages of a folder by conversation. It uses THREAD (RFC 5256) when available and threads locally otherwise. */
+
+NS_ASSUME_NONNULL_BEGIN
+@interface MCOIMAPThreadOperation : MCOIMAPBaseOperation
+
+/**
+ Starts the asynchronous operation.
+
+ @param completionBlock Called when the operation is finished.
+
+ - On success `error` will be nil and `threads` will contain the roots of the conversations
+
+ - On failure, `error` will be set with `MCOErrorDomain` as domain and an
+ error code available in `MCOConstants.h`, `threads` will be nil
+*/
+- (void) start:(void (^)(NSError * __nullable error, NSArray * /* MCOIMAPThread */ __nullable threads))completionBlock;
+
+@end
+NS_ASSUME_NONNULL_END
+
+#endif
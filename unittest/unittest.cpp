@@ -2,6 +2,7 @@
 #include <dirent.h>
 #include <math.h>
 #include <time.h>
+#include <unistd.h>
 
 using namespace mailcore;
 
@@ -333,6 +334,625 @@ static void testMUTF7(void)
     global_success ++;
 }
 
+static void testBatchOperation(void)
+{
+    int failure = 0;
+    int success = 0;
+    IMAPAsyncSession * session = new IMAPAsyncSession();
+    session->setMaximumConnections(2);
+    // Archive is selected on the only connection.
+    session->sessionForFolder(MCSTR("Archive"));
+
+    HashMap * folderUids = HashMap::hashMap();
+    folderUids->setObjectForKey(MCSTR("INBOX"), IndexSet::indexSetWithRange(RangeMake(1, 9)));
+    folderUids->setObjectForKey(MCSTR("Sent"), IndexSet::indexSetWithIndex(4));
+    folderUids->setObjectForKey(MCSTR("Archive"), IndexSet::indexSetWithIndex(12));
+    folderUids->setObjectForKey(MCSTR("Drafts"), IndexSet::indexSet());
+    IMAPBatchOperation * op = session->batchStoreFlagsOperation(folderUids, IMAPStoreFlagsRequestKindAdd, MessageFlagSeen);
+    Array * groups = op->foldersPerConnection();
+    // The idle connection takes all the folders, starting with the selected one. Drafts has nothing to do.
+    Array * folders = (groups->count() == 1) ? (Array *) groups->objectAtIndex(0) : NULL;
+    if ((folders == NULL) || (folders->count() != 3) || !MCSTR("Archive")->isEqual(folders->objectAtIndex(0)) ||
+        (folders->indexOfObject(MCSTR("Drafts")) != -1)) {
+        fprintf(stderr, "grouping: %s\n", MCUTF8(groups));
+        failure ++;
+    }
+    else {
+        success ++;
+    }
+    session->release();
+
+    if (failure > 0) {
+        printf("testBatchOperation failed: %i succeeded, %i failed\n", success, failure);
+        global_failure ++;
+        return;
+    }
+    printf("testBatchOperation ok: %i succeeded\n", success);
+    global_success ++;
+}
+
+static IMAPMessage * testMessage(uint32_t uid, const char * from, const char * subject, time_t date)
+{
+    IMAPMessage * message = new IMAPMessage();
+    message->autorelease();
+    message->setUid(uid);
+    message->setSize(uid * 100);
+    message->header()->setFrom(Address::addressWithMailbox(String::stringWithUTF8Characters(from)));
+    message->header()->setSubject(String::stringWithUTF8Characters(subject));
+    message->header()->setDate(date);
+    message->header()->setReceivedDate(date);
+    message->header()->setMessageID(String::stringWithUTF8Format("%u@example.com", uid));
+    return message;
+}
+
+static Array * testMessages(void)
+{
+    time_t date = referenceDate();
+    Array * messages = Array::array();
+    messages->addObject(testMessage(1, "alice@example.com", "Quarterly report", date + 3 * 86400));
+    messages->addObject(testMessage(2, "bob@example.com", "Lunch tomorrow", date + 86400));
+    messages->addObject(testMessage(3, "carol@example.org", "Re: Quarterly report", date + 2 * 86400));
+    ((IMAPMessage *) messages->objectAtIndex(1))->setFlags(MessageFlagFlagged);
+    return messages;
+}
+
+static String * temporaryDirectory(void)
+{
+    char path[] = "/tmp/mailcore-unittest-XXXXXX";
+    if (mkdtemp(path) == NULL) {
+        return NULL;
+    }
+    return String::stringWithFileSystemRepresentation(path);
+}
+
+static void removeDirectory(String * path)
+{
+    DIR * dir = opendir(path->fileSystemRepresentation());
+    if (dir != NULL) {
+        struct dirent * ent;
+        while ((ent = readdir(dir)) != NULL) {
+            if ((strcmp(ent->d_name, ".") == 0) || (strcmp(ent->d_name, "..") == 0)) {
+                continue;
+            }
+            String * filename = path->stringByAppendingPathComponent(String::stringWithFileSystemRepresentation(ent->d_name));
+            if (unlink(filename->fileSystemRepresentation()) < 0) {
+                removeDirectory(filename);
+            }
+        }
+        closedir(dir);
+    }
+    rmdir(path->fileSystemRepresentation());
+}
+
+static bool checkUIDs(const char * name, IndexSet * uids, const char * expected, int * pFailure, int * pSuccess)
+{
+    const char * current = (uids != NULL) ? MCUTF8(uids) : "(null)";
+    if (strcmp(current, expected) != 0) {
+        fprintf(stderr, "%s: current: %s, expected: %s\n", name, current, expected);
+        (* pFailure) ++;
+        return false;
+    }
+    (* pSuccess) ++;
+    return true;
+}
+
+static void testSearchIndex(void)
+{
+    int failure = 0;
+    int success = 0;
+    String * directory = temporaryDirectory();
+    MCAssert(directory != NULL);
+    String * path = directory->stringByAppendingPathComponent(MCSTR("index"));
+
+    IMAPSearchIndex * index = new IMAPSearchIndex();
+    index->setPath(path);
+    index->setUidValidity(42);
+    Array * messages = testMessages();
+    index->addMessage((IMAPMessage *) messages->objectAtIndex(0), MCSTR("The figures are attached."));
+    index->addMessage((IMAPMessage *) messages->objectAtIndex(1), NULL);
+    if (index->save() != ErrorNone) {
+        failure ++;
+    }
+    // Appended to the journal.
+    index->addMessage((IMAPMessage *) messages->objectAtIndex(2), MCSTR("Thanks for the figures."));
+    index->removeUIDs(IndexSet::indexSetWithIndex(2));
+    if (index->save() != ErrorNone) {
+        failure ++;
+    }
+    index->release();
+
+    index = new IMAPSearchIndex();
+    index->setPath(path);
+    if (index->load() != ErrorNone) {
+        failure ++;
+    }
+    checkUIDs("uids", index->uids(), "1,3", &failure, &success);
+    checkUIDs("subject", index->search(IMAPSearchExpression::searchSubject(MCSTR("quarter"))), "1,3", &failure, &success);
+    checkUIDs("body", index->search(IMAPSearchExpression::searchBody(MCSTR("FIGURES"))), "1,3", &failure, &success);
+    checkUIDs("from", index->search(IMAPSearchExpression::searchFrom(MCSTR("carol"))), "3", &failure, &success);
+    checkUIDs("not", index->search(IMAPSearchExpression::searchAnd(IMAPSearchExpression::searchSubject(MCSTR("report")),
+                                                                   IMAPSearchExpression::searchNot(IMAPSearchExpression::searchFrom(MCSTR("alice"))))),
+              "3", &failure, &success);
+    // Punctuation only is left to the server.
+    if (index->canSearch(IMAPSearchExpression::searchFrom(MCSTR("@")))) {
+        fprintf(stderr, "canSearch: text without words\n");
+        failure ++;
+    }
+    else {
+        success ++;
+    }
+    // A different UIDVALIDITY empties the index.
+    index->setUidValidity(43);
+    checkUIDs("uidvalidity", index->uids(), "", &failure, &success);
+    index->release();
+
+    removeDirectory(directory);
+    if (failure > 0) {
+        printf("testSearchIndex failed: %i succeeded, %i failed\n", success, failure);
+        global_failure ++;
+        return;
+    }
+    printf("testSearchIndex ok: %i succeeded\n", success);
+    global_success ++;
+}
+
+static void testSearchEvaluator(void)
+{
+    int failure = 0;
+    int success = 0;
+    Array * messages = testMessages();
+    time_t date = referenceDate();
+
+    IMAPSearchEvaluator * evaluator = new IMAPSearchEvaluator();
+    evaluator->setExpression(IMAPSearchExpression::searchSubject(MCSTR("QUARTERLY")));
+    checkUIDs("subject", evaluator->matchingUIDs(messages), "1,3", &failure, &success);
+    evaluator->setExpression(IMAPSearchExpression::searchOr(IMAPSearchExpression::searchFlagged(),
+                                                            IMAPSearchExpression::searchFrom(MCSTR("example.org"))));
+    checkUIDs("or", evaluator->matchingUIDs(messages), "2-3", &failure, &success);
+    evaluator->setExpression(IMAPSearchExpression::searchSinceDate(date + 2 * 86400));
+    checkUIDs("since", evaluator->matchingUIDs(messages), "1,3", &failure, &success);
+    evaluator->setExpression(IMAPSearchExpression::searchSizeLarger(150));
+    checkUIDs("larger", evaluator->matchingUIDs(messages), "2-3", &failure, &success);
+    // UIDs 1 to 2.
+    evaluator->setExpression(IMAPSearchExpression::searchNot(IMAPSearchExpression::searchUIDs(IndexSet::indexSetWithRange(RangeMake(1, 1)))));
+    checkUIDs("uids", evaluator->matchingUIDs(messages), "3", &failure, &success);
+    evaluator->release();
+
+    if (IMAPSearchEvaluator::canEvaluate(IMAPSearchExpression::searchBody(MCSTR("figures")))) {
+        fprintf(stderr, "canEvaluate: body\n");
+        failure ++;
+    }
+    else {
+        success ++;
+    }
+
+    if (failure > 0) {
+        printf("testSearchEvaluator failed: %i succeeded, %i failed\n", success, failure);
+        global_failure ++;
+        return;
+    }
+    printf("testSearchEvaluator ok: %i succeeded\n", success);
+    global_success ++;
+}
+
+static String * tableUIDs(IMAPMessageTable * table)
+{
+    String * result = String::string();
+    for(unsigned int i = 0 ; i < table->count() ; i ++) {
+        result->appendUTF8Format(i == 0 ? "%u" : ",%u", table->uidAtIndex(i));
+    }
+    return result;
+}
+
+static void testMessageTable(void)
+{
+    int failure = 0;
+    int success = 0;
+
+    IMAPMessageTable * table = new IMAPMessageTable();
+    table->addMessages(testMessages());
+    table->sortWithCriteria(Array::arrayWithObject(IMAPSortCriterion::criterion(IMAPSortKindDate)));
+    if (!tableUIDs(table)->isEqual(MCSTR("2,3,1"))) {
+        fprintf(stderr, "sort by date: %s\n", MCUTF8(tableUIDs(table)));
+        failure ++;
+    }
+    else {
+        success ++;
+    }
+    // The base subject of "Re: Quarterly report" is "Quarterly report".
+    Array * criteria = Array::array();
+    criteria->addObject(IMAPSortCriterion::criterion(IMAPSortKindSubject, true));
+    criteria->addObject(IMAPSortCriterion::criterion(IMAPSortKindDate));
+    table->sortWithCriteria(criteria);
+    if (!tableUIDs(table)->isEqual(MCSTR("3,1,2"))) {
+        fprintf(stderr, "sort by subject: %s\n", MCUTF8(tableUIDs(table)));
+        failure ++;
+    }
+    else {
+        success ++;
+    }
+    if (table->indexOfUID(2) != 2) {
+        fprintf(stderr, "indexOfUID: %i\n", table->indexOfUID(2));
+        failure ++;
+    }
+    else {
+        success ++;
+    }
+
+    IMAPSearchEvaluator * evaluator = new IMAPSearchEvaluator();
+    evaluator->setExpression(IMAPSearchExpression::searchFrom(MCSTR("bob")));
+    checkUIDs("matchingUIDs", table->matchingUIDs(evaluator), "2", &failure, &success);
+    evaluator->release();
+
+    table->removeUIDs(IndexSet::indexSetWithIndex(1));
+    checkUIDs("removeUIDs", table->uids(), "2-3", &failure, &success);
+    if ((table->subjectAtIndex((unsigned int) table->indexOfUID(3)) == NULL) ||
+        !table->subjectAtIndex((unsigned int) table->indexOfUID(3))->isEqual(MCSTR("Re: Quarterly report"))) {
+        fprintf(stderr, "subjectAtIndex\n");
+        failure ++;
+    }
+    else {
+        success ++;
+    }
+    table->release();
+
+    if (failure > 0) {
+        printf("testMessageTable failed: %i succeeded, %i failed\n", success, failure);
+        global_failure ++;
+        return;
+    }
+    printf("testMessageTable ok: %i succeeded\n", success);
+    global_success ++;
+}
+
+static IMAPPart * testPart(const char * partID, const char * mimeType, const char * contentID, const char * filename)
+{
+    IMAPPart * part = new IMAPPart();
+    part->autorelease();
+    part->setPartID(String::stringWithUTF8Characters(partID));
+    part->setMimeType(String::stringWithUTF8Characters(mimeType));
+    part->setEncoding(EncodingBase64);
+    part->setSize(1000);
+    if (contentID != NULL) {
+        part->setContentID(String::stringWithUTF8Characters(contentID));
+    }
+    if (filename != NULL) {
+        part->setFilename(String::stringWithUTF8Characters(filename));
+        part->setAttachment(true);
+    }
+    return part;
+}
+
+static void testBodyStructure(void)
+{
+    int failure = 0;
+    int success = 0;
+
+    IMAPMultipart * alternative = new IMAPMultipart();
+    alternative->autorelease();
+    alternative->setPartID(MCSTR("1"));
+    alternative->setMimeType(MCSTR("multipart/alternative"));
+    Array * alternativeParts = Array::array();
+    alternativeParts->addObject(testPart("1.1", "text/plain", NULL, NULL));
+    alternativeParts->addObject(testPart("1.2", "text/html", NULL, NULL));
+    alternative->setParts(alternativeParts);
+    IMAPMultipart * mixed = new IMAPMultipart();
+    mixed->autorelease();
+    mixed->setPartID(MCSTR(""));
+    mixed->setMimeType(MCSTR("multipart/mixed"));
+    Array * parts = Array::array();
+    parts->addObject(alternative);
+    parts->addObject(testPart("2", "image/png", "image@example.com", "image.png"));
+    parts->addObject(testPart("3", "application/x-unusual", NULL, "data.bin"));
+    mixed->setParts(parts);
+
+    IMAPBodyStructure * structure = IMAPBodyStructure::bodyStructureWithPart(mixed);
+    if (structure->partsCount() != 6) {
+        fprintf(stderr, "partsCount: %u\n", structure->partsCount());
+        failure ++;
+    }
+    else {
+        success ++;
+    }
+    int idx = structure->indexForPartID(MCSTR("1.2"));
+    if ((idx < 0) || !structure->mimeTypeAtIndex(idx)->isEqual(MCSTR("text/html"))) {
+        fprintf(stderr, "indexForPartID: %i\n", idx);
+        failure ++;
+    }
+    else {
+        success ++;
+    }
+    idx = structure->indexForContentID(MCSTR("image@example.com"));
+    if ((idx < 0) || !structure->partIDAtIndex(idx)->isEqual(MCSTR("2")) || !structure->isAttachmentAtIndex(idx) ||
+        (structure->encodingAtIndex(idx) != EncodingBase64)) {
+        fprintf(stderr, "indexForContentID: %i\n", idx);
+        failure ++;
+    }
+    else {
+        success ++;
+    }
+    idx = structure->indexForPartID(MCSTR("3"));
+    if ((idx < 0) || !structure->mimeTypeAtIndex(idx)->isEqual(MCSTR("application/x-unusual")) ||
+        !structure->filenameAtIndex(idx)->isEqual(MCSTR("data.bin"))) {
+        fprintf(stderr, "mimeTypeAtIndex: %i\n", idx);
+        failure ++;
+    }
+    else {
+        success ++;
+    }
+    if ((structure->indexForPartID(MCSTR("4")) != -1) || (structure->indexForContentID(MCSTR("missing@example.com")) != -1)) {
+        fprintf(stderr, "missing part\n");
+        failure ++;
+    }
+    else {
+        success ++;
+    }
+    AbstractPart * mainPart = structure->mainPart();
+    AbstractPart * image = mainPart->partForContentID(MCSTR("image@example.com"));
+    if ((image == NULL) || !image->filename()->isEqual(MCSTR("image.png"))) {
+        fprintf(stderr, "mainPart\n");
+        failure ++;
+    }
+    else {
+        success ++;
+    }
+
+    if (failure > 0) {
+        printf("testBodyStructure failed: %i succeeded, %i failed\n", success, failure);
+        global_failure ++;
+        return;
+    }
+    printf("testBodyStructure ok: %i succeeded\n", success);
+    global_success ++;
+}
+
+static Data * testContent(char ch, unsigned int length)
+{
+    Data * data = Data::data();
+    for(unsigned int i = 0 ; i < length ; i ++) {
+        data->appendBytes(&ch, 1);
+    }
+    return data;
+}
+
+static void testBodyCache(void)
+{
+    int failure = 0;
+    int success = 0;
+    String * directory = temporaryDirectory();
+    MCAssert(directory != NULL);
+    String * account = MCSTR("user@example.com");
+    String * folder = MCSTR("INBOX");
+
+    IMAPBodyCache * cache = new IMAPBodyCache();
+    cache->setPath(directory);
+    cache->setMaximumSize(250);
+    // The same attachment in two messages is stored once.
+    cache->setData(testContent('a', 100), account, folder, 1, 10, MCSTR("2"));
+    cache->setData(testContent('a', 100), account, folder, 1, 11, MCSTR("2"));
+    if ((cache->itemsCount() != 2) || (cache->totalSize() != 100) || (cache->bytesDeduplicated() != 100)) {
+        fprintf(stderr, "dedup: %u items, %llu bytes\n", cache->itemsCount(), (unsigned long long) cache->totalSize());
+        failure ++;
+    }
+    else {
+        success ++;
+    }
+    cache->setData(testContent('b', 100), account, folder, 1, 12, MCSTR(""));
+    // Makes the first content the most recently used.
+    Data * data = cache->dataForKey(account, folder, 1, 11, MCSTR("2"));
+    if ((data == NULL) || !data->isEqual(testContent('a', 100))) {
+        fprintf(stderr, "dataForKey\n");
+        failure ++;
+    }
+    else {
+        success ++;
+    }
+    cache->setData(testContent('c', 100), account, folder, 1, 13, MCSTR(""));
+    if ((cache->dataForKey(account, folder, 1, 12, MCSTR("")) != NULL) ||
+        (cache->dataForKey(account, folder, 1, 10, MCSTR("2")) == NULL) ||
+        (cache->dataForKey(account, folder, 1, 13, MCSTR("")) == NULL) || (cache->evictionsCount() != 1)) {
+        fprintf(stderr, "eviction: %u evictions\n", cache->evictionsCount());
+        failure ++;
+    }
+    else {
+        success ++;
+    }
+    // A different UIDVALIDITY is a different message.
+    if (cache->dataForKey(account, folder, 2, 10, MCSTR("2")) != NULL) {
+        fprintf(stderr, "uidvalidity\n");
+        failure ++;
+    }
+    else {
+        success ++;
+    }
+    if (cache->save() != ErrorNone) {
+        failure ++;
+    }
+    cache->release();
+
+    cache = new IMAPBodyCache();
+    cache->setPath(directory);
+    if ((cache->load() != ErrorNone) || (cache->itemsCount() != 3) ||
+        (cache->dataForKey(account, folder, 1, 13, MCSTR("")) == NULL)) {
+        fprintf(stderr, "load: %u items\n", cache->itemsCount());
+        failure ++;
+    }
+    else {
+        success ++;
+    }
+    cache->removeFolder(account, folder);
+    if (cache->dataForKey(account, folder, 1, 13, MCSTR("")) != NULL) {
+        fprintf(stderr, "removeFolder\n");
+        failure ++;
+    }
+    else {
+        success ++;
+    }
+    cache->release();
+
+    removeDirectory(directory);
+    if (failure > 0) {
+        printf("testBodyCache failed: %i succeeded, %i failed\n", success, failure);
+        global_failure ++;
+        return;
+    }
+    printf("testBodyCache ok: %i succeeded\n", success);
+    global_success ++;
+}
+
+static void appendBigEndian(Data * data, uint64_t value, int size)
+{
+    for(int i = size - 1 ; i >= 0 ; i --) {
+        char byte = (char) ((value >> (i * 8)) & 0xff);
+        data->appendBytes(&byte, 1);
+    }
+}
+
+static void testFolderMirrorFormat(void)
+{
+    int failure = 0;
+    int success = 0;
+    String * directory = temporaryDirectory();
+    MCAssert(directory != NULL);
+    String * path = directory->stringByAppendingPathComponent(MCSTR("mirror"));
+
+    // "MCFM" version uidValidity uidNext modSequenceValue count, then uid flags modSeq length message.
+    Data * data = Data::data();
+    data->appendBytes("MCFM", 4);
+    appendBigEndian(data, 1, 4);
+    appendBigEndian(data, 42, 4);
+    appendBigEndian(data, 4, 4);
+    appendBigEndian(data, 1000, 8);
+    appendBigEndian(data, 2, 4);
+    Array * messages = testMessages();
+    for(unsigned int i = 0 ; i < 2 ; i ++) {
+        IMAPMessage * message = (IMAPMessage *) messages->objectAtIndex(i);
+        Data * messageData = JSON::objectToJSONData(message->serializable());
+        appendBigEndian(data, message->uid(), 4);
+        appendBigEndian(data, MessageFlagSeen, 4);
+        appendBigEndian(data, 900 + i, 8);
+        appendBigEndian(data, messageData->length(), 4);
+        data->appendData(messageData);
+    }
+    data->writeToFile(path);
+
+    IMAPFolderMirror * mirror = new IMAPFolderMirror();
+    mirror->setPath(path);
+    if ((mirror->load() != ErrorNone) || (mirror->uidValidity() != 42) || (mirror->uidNext() != 4) ||
+        (mirror->modSequenceValue() != 1000) || (mirror->count() != 2)) {
+        fprintf(stderr, "load\n");
+        failure ++;
+    }
+    else {
+        success ++;
+    }
+    IMAPMessage * message = mirror->messageForUID(2);
+    if ((message == NULL) || !message->header()->subject()->isEqual(MCSTR("Lunch tomorrow")) ||
+        (message->flags() != MessageFlagSeen) || (message->modSeqValue() != 901)) {
+        fprintf(stderr, "messageForUID\n");
+        failure ++;
+    }
+    else {
+        success ++;
+    }
+    // Saved in the same format.
+    if ((mirror->save() != ErrorNone) || !Data::dataWithContentsOfFile(path)->isEqual(data)) {
+        fprintf(stderr, "save\n");
+        failure ++;
+    }
+    else {
+        success ++;
+    }
+    mirror->release();
+
+    // A truncated file is not loaded.
+    Data::dataWithBytes(data->bytes(), data->length() - 10)->writeToFile(path);
+    mirror = new IMAPFolderMirror();
+    mirror->setPath(path);
+    if ((mirror->load() != ErrorFile) || (mirror->count() != 0)) {
+        fprintf(stderr, "truncated file\n");
+        failure ++;
+    }
+    else {
+        success ++;
+    }
+    mirror->release();
+
+    removeDirectory(directory);
+    if (failure > 0) {
+        printf("testFolderMirrorFormat failed: %i succeeded, %i failed\n", success, failure);
+        global_failure ++;
+        return;
+    }
+    printf("testFolderMirrorFormat ok: %i succeeded\n", success);
+    global_success ++;
+}
+
+static IMAPThread * threadWithUID(Array * threads, uint32_t uid)
+{
+    mc_foreacharray(IMAPThread, thread, threads) {
+        if (thread->uid() == uid) {
+            return thread;
+        }
+    }
+    return NULL;
+}
+
+static void testThreading(void)
+{
+    int failure = 0;
+    int success = 0;
+    Array * messages = testMessages();
+    IMAPMessage * reply = (IMAPMessage *) messages->objectAtIndex(2);
+    reply->header()->setReferences(Array::arrayWithObject(MCSTR("1@example.com")));
+    reply->header()->setInReplyTo(Array::arrayWithObject(MCSTR("1@example.com")));
+    // Both refer to a message that is not available.
+    IMAPMessage * message = testMessage(4, "dave@example.com", "Re: Trip", referenceDate());
+    message->header()->setReferences(Array::arrayWithObject(MCSTR("missing@example.com")));
+    messages->addObject(message);
+    message = testMessage(5, "erin@example.com", "Re: Trip", referenceDate() + 3600);
+    message->header()->setReferences(Array::arrayWithObject(MCSTR("missing@example.com")));
+    messages->addObject(message);
+
+    Array * threads = IMAPThread::threadsWithMessages(messages, IMAPThreadAlgorithmReferences);
+    IMAPThread * thread = threadWithUID(threads, 1);
+    if ((threads->count() != 3) || (thread == NULL) || (thread->children()->count() != 1) ||
+        (((IMAPThread *) thread->children()->objectAtIndex(0))->uid() != 3)) {
+        fprintf(stderr, "references: %s\n", MCUTF8(threads));
+        failure ++;
+    }
+    else {
+        success ++;
+    }
+    // The missing parent groups its children.
+    thread = threadWithUID(threads, 0);
+    if ((thread == NULL) || !MCSTR("4-5")->isEqual(thread->allUIDs()->description())) {
+        fprintf(stderr, "missing parent: %s\n", MCUTF8(threads));
+        failure ++;
+    }
+    else {
+        success ++;
+    }
+
+    threads = IMAPThread::threadsWithMessages(messages, IMAPThreadAlgorithmOrderedSubject);
+    thread = threadWithUID(threads, 3);
+    if ((threads->count() != 3) || (thread == NULL) || !MCSTR("1,3")->isEqual(thread->allUIDs()->description())) {
+        fprintf(stderr, "ordered subject: %s\n", MCUTF8(threads));
+        failure ++;
+    }
+    else {
+        success ++;
+    }
+
+    if (failure > 0) {
+        printf("testThreading failed: %i succeeded, %i failed\n", success, failure);
+        global_failure ++;
+        return;
+    }
+    printf("testThreading ok: %i succeeded\n", success);
+    global_success ++;
+}
+
 int main(int argc, char ** argv)
 {
     setenv("TZ", "EST8EDT", 1);
@@ -356,6 +976,14 @@ int main(int argc, char ** argv)
     testCharsetDetection(path->stringByAppendingPathComponent(MCSTR("charset-detection")));
     testSummary(path->stringByAppendingPathComponent(MCSTR("summary")));
     testMUTF7();
+    testBatchOperation();
+    testSearchIndex();
+    testSearchEvaluator();
+    testMessageTable();
+    testBodyStructure();
+    testBodyCache();
+    testFolderMirrorFormat();
+    testThreading();
 
     printf("%i tests succeeded, %i tests failed\n", global_success, global_failure);
 